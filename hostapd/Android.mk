@@ -140,12 +140,18 @@ ifdef CONFIG_ELOOP_EPOLL
 L_CFLAGS += -DCONFIG_ELOOP_EPOLL
 endif
 
+ifdef CONFIG_WORKER_POOL
+L_CFLAGS += -DCONFIG_WORKER_POOL
+OBJS += src/utils/worker_pool.c
+endif
+
 OBJS += src/utils/common.c
 OBJS += src/utils/wpa_debug.c
 OBJS += src/utils/wpabuf.c
 OBJS += src/utils/os_$(CONFIG_OS).c
 OBJS += src/utils/ip_addr.c
 OBJS += src/utils/crc32.c
+OBJS += src/utils/hash_table.c
 
 OBJS += src/common/ieee802_11_common.c
 OBJS += src/common/wpa_common.c
@@ -169,12 +175,18 @@ else
 OBJS += src/radius/radius.c
 OBJS += src/radius/radius_client.c
 OBJS += src/radius/radius_das.c
+ifdef CONFIG_RADIUS_TLS
+L_CFLAGS += -DCONFIG_RADIUS_TLS
+OBJS += src/radius/radius_tls.c
+TLS_FUNCS=y
+endif
 endif
 
 ifdef CONFIG_NO_ACCOUNTING
 L_CFLAGS += -DCONFIG_NO_ACCOUNTING
 else
 OBJS += src/ap/accounting.c
+OBJS += src/ap/accounting_spool.c
 endif
 
 ifdef CONFIG_NO_VLAN
@@ -242,6 +254,11 @@ NEED_ETH_P_OUI=y
 NEED_HMAC_SHA256_KDF=y
 endif
 
+ifdef CONFIG_PMKSA_CACHE_FILE
+L_CFLAGS += -DCONFIG_PMKSA_CACHE_FILE
+NEED_AES_SIV=y
+endif
+
 ifdef NEED_ETH_P_OUI
 L_CFLAGS += -DCONFIG_ETH_P_OUI
 OBJS += src/ap/eth_p_oui.c
@@ -794,6 +811,9 @@ ifdef NEED_AES_ENCBLOCK
 AESOBJS += src/crypto/aes-encblock.c
 endif
 AESOBJS += src/crypto/aes-omac1.c
+ifneq ($(CONFIG_TLS), openssl)
+AESOBJS += src/crypto/crypto_mac.c
+endif
 ifdef NEED_AES_UNWRAP
 ifneq ($(CONFIG_TLS), openssl)
 NEED_AES_DEC=y
@@ -19,6 +19,9 @@
 #include "drivers/driver.h"
 #include "eap_server/eap.h"
 #include "radius/radius_client.h"
+#ifdef CONFIG_RADIUS_TLS
+#include "radius/radius_tls.h"
+#endif /* CONFIG_RADIUS_TLS */
 #include "ap/wpa_auth.h"
 #include "ap/ap_config.h"
 #include "config_file.h"
@@ -652,6 +655,40 @@ hostapd_config_read_radius_addr(struct hostapd_radius_server **server,
 }
 
 
+static int hostapd_config_radius_server_type(struct hostapd_radius_server *serv,
+					     const char *val, int udp_port,
+					     int line)
+{
+	if (os_strcmp(val, "UDP") == 0) {
+		serv->tls = 0;
+		return 0;
+	}
+
+	if (os_strcmp(val, "TLS") != 0) {
+		wpa_printf(MSG_ERROR, "Line %d: unknown RADIUS server type '%s'",
+			   line, val);
+		return -1;
+	}
+
+#ifdef CONFIG_RADIUS_TLS
+	serv->tls = 1;
+	if (serv->port == udp_port)
+		serv->port = RADIUS_TLS_PORT;
+	if (!serv->shared_secret) {
+		serv->shared_secret = (u8 *) os_strdup(RADIUS_TLS_SHARED_SECRET);
+		if (!serv->shared_secret)
+			return -1;
+		serv->shared_secret_len = os_strlen(RADIUS_TLS_SHARED_SECRET);
+	}
+	return 0;
+#else /* CONFIG_RADIUS_TLS */
+	wpa_printf(MSG_ERROR, "Line %d: RADIUS/TLS support not included",
+		   line);
+	return -1;
+#endif /* CONFIG_RADIUS_TLS */
+}
+
+
 
 static int hostapd_parse_das_client(struct hostapd_bss_config *bss, char *val)
 {
@@ -2438,6 +2475,18 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			return 1;
 		}
 		bss->macaddr_acl = acl;
+	} else if (os_strcmp(buf, "radius_acl_cache_size") == 0) {
+		bss->radius_acl_cache_size = atoi(pos);
+	} else if (os_strcmp(buf, "radius_acl_reject_timeout") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid radius_acl_reject_timeout %d",
+				   line, val);
+			return 1;
+		}
+		bss->radius_acl_reject_timeout = val;
 	} else if (os_strcmp(buf, "accept_mac_file") == 0) {
 		if (hostapd_config_read_maclist(pos, &bss->accept_mac,
 						&bss->num_accept_mac)) {
@@ -2542,6 +2591,21 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->crl_reload_interval = atoi(pos);
 	} else if (os_strcmp(buf, "tls_session_lifetime") == 0) {
 		bss->tls_session_lifetime = atoi(pos);
+	} else if (os_strcmp(buf, "tls_session_ticket_keys") == 0) {
+		os_free(bss->tls_session_ticket_keys);
+		bss->tls_session_ticket_keys = os_strdup(pos);
+#ifdef CONFIG_WORKER_POOL
+	} else if (os_strcmp(buf, "tls_private_key_threads") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 64) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid tls_private_key_threads=%d; allowed range 0..64",
+				   line, val);
+			return 1;
+		}
+		bss->tls_private_key_threads = val;
+#endif /* CONFIG_WORKER_POOL */
 	} else if (os_strcmp(buf, "tls_flags") == 0) {
 		bss->tls_flags = parse_tls_flags(pos);
 	} else if (os_strcmp(buf, "max_auth_rounds") == 0) {
@@ -2768,6 +2832,53 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		os_free(bss->radius->auth_server->shared_secret);
 		bss->radius->auth_server->shared_secret = (u8 *) os_strdup(pos);
 		bss->radius->auth_server->shared_secret_len = len;
+	} else if (bss->radius->auth_server &&
+		   os_strcmp(buf, "auth_server_type") == 0) {
+		if (hostapd_config_radius_server_type(bss->radius->auth_server,
+						      pos, 1812, line))
+			return 1;
+	} else if (bss->radius->auth_server &&
+		   os_strcmp(buf, "auth_server_ca_cert") == 0) {
+		os_free(bss->radius->auth_server->ca_cert);
+		bss->radius->auth_server->ca_cert = os_strdup(pos);
+	} else if (bss->radius->auth_server &&
+		   os_strcmp(buf, "auth_server_client_cert") == 0) {
+		os_free(bss->radius->auth_server->client_cert);
+		bss->radius->auth_server->client_cert = os_strdup(pos);
+	} else if (bss->radius->auth_server &&
+		   os_strcmp(buf, "auth_server_private_key") == 0) {
+		os_free(bss->radius->auth_server->private_key);
+		bss->radius->auth_server->private_key = os_strdup(pos);
+	} else if (bss->radius->auth_server &&
+		   os_strcmp(buf, "auth_server_private_key_passwd") == 0) {
+		str_clear_free(bss->radius->auth_server->private_key_passwd);
+		bss->radius->auth_server->private_key_passwd = os_strdup(pos);
+	} else if (bss->radius->auth_server &&
+		   os_strcmp(buf, "auth_server_domain_match") == 0) {
+		os_free(bss->radius->auth_server->domain_match);
+		bss->radius->auth_server->domain_match = os_strdup(pos);
+	} else if (bss->radius->auth_server &&
+		   os_strcmp(buf, "auth_server_weight") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid auth_server_weight %d",
+				   line, val);
+			return 1;
+		}
+		bss->radius->auth_server->weight = val;
+	} else if (os_strcmp(buf, "radius_auth_server_policy") == 0) {
+		int val = atoi(pos);
+
+		if (val < RADIUS_AUTH_SERVER_FAILOVER ||
+		    val > RADIUS_AUTH_SERVER_LEAST_OUTSTANDING) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid radius_auth_server_policy %d",
+				   line, val);
+			return 1;
+		}
+		bss->radius->auth_server_policy = val;
 	} else if (os_strcmp(buf, "acct_server_addr") == 0) {
 		if (hostapd_config_read_radius_addr(
 			    &bss->radius->acct_servers,
@@ -2802,10 +2913,50 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		os_free(bss->radius->acct_server->shared_secret);
 		bss->radius->acct_server->shared_secret = (u8 *) os_strdup(pos);
 		bss->radius->acct_server->shared_secret_len = len;
+	} else if (bss->radius->acct_server &&
+		   os_strcmp(buf, "acct_server_type") == 0) {
+		if (hostapd_config_radius_server_type(bss->radius->acct_server,
+						      pos, 1813, line))
+			return 1;
+	} else if (bss->radius->acct_server &&
+		   os_strcmp(buf, "acct_server_ca_cert") == 0) {
+		os_free(bss->radius->acct_server->ca_cert);
+		bss->radius->acct_server->ca_cert = os_strdup(pos);
+	} else if (bss->radius->acct_server &&
+		   os_strcmp(buf, "acct_server_client_cert") == 0) {
+		os_free(bss->radius->acct_server->client_cert);
+		bss->radius->acct_server->client_cert = os_strdup(pos);
+	} else if (bss->radius->acct_server &&
+		   os_strcmp(buf, "acct_server_private_key") == 0) {
+		os_free(bss->radius->acct_server->private_key);
+		bss->radius->acct_server->private_key = os_strdup(pos);
+	} else if (bss->radius->acct_server &&
+		   os_strcmp(buf, "acct_server_private_key_passwd") == 0) {
+		str_clear_free(bss->radius->acct_server->private_key_passwd);
+		bss->radius->acct_server->private_key_passwd = os_strdup(pos);
+	} else if (bss->radius->acct_server &&
+		   os_strcmp(buf, "acct_server_domain_match") == 0) {
+		os_free(bss->radius->acct_server->domain_match);
+		bss->radius->acct_server->domain_match = os_strdup(pos);
 	} else if (os_strcmp(buf, "radius_retry_primary_interval") == 0) {
 		bss->radius->retry_primary_interval = atoi(pos);
 	} else if (os_strcmp(buf, "radius_acct_interim_interval") == 0) {
 		bss->acct_interim_interval = atoi(pos);
+	} else if (os_strcmp(buf, "radius_acct_spool_file") == 0) {
+		os_free(bss->radius_acct_spool_file);
+		bss->radius_acct_spool_file = os_strdup(pos);
+	} else if (os_strcmp(buf, "radius_acct_spool_rate") == 0) {
+		int val = atoi(pos);
+
+		if (val <= 0) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid radius_acct_spool_rate %d",
+				   line, val);
+			return 1;
+		}
+		bss->radius_acct_spool_rate = val;
+	} else if (os_strcmp(buf, "radius_acct_spool_max_size") == 0) {
+		bss->radius_acct_spool_max_size = atoi(pos);
 	} else if (os_strcmp(buf, "radius_request_cui") == 0) {
 		bss->radius_request_cui = atoi(pos);
 	} else if (os_strcmp(buf, "radius_auth_req_attr") == 0) {
@@ -2928,6 +3079,18 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->wpa_pairwise_update_count = (u32) val;
 	} else if (os_strcmp(buf, "wpa_disable_eapol_key_retries") == 0) {
 		bss->wpa_disable_eapol_key_retries = atoi(pos);
+#ifdef CONFIG_WORKER_POOL
+	} else if (os_strcmp(buf, "wpa_psk_trial_threads") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 64) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid wpa_psk_trial_threads=%d; allowed range 0..64",
+				   line, val);
+			return 1;
+		}
+		bss->wpa_psk_trial_threads = val;
+#endif /* CONFIG_WORKER_POOL */
 	} else if (os_strcmp(buf, "wpa_passphrase") == 0) {
 		int len = os_strlen(pos);
 		if (len < 8 || len > 63) {
@@ -2938,11 +3101,11 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		os_free(bss->ssid.wpa_passphrase);
 		bss->ssid.wpa_passphrase = os_strdup(pos);
 		if (bss->ssid.wpa_passphrase) {
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 			bss->ssid.wpa_passphrase_set = 1;
 		}
 	} else if (os_strcmp(buf, "wpa_psk") == 0) {
-		hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+		hostapd_config_clear_wpa_psk(&bss->ssid);
 		bss->ssid.wpa_psk = os_zalloc(sizeof(struct hostapd_wpa_psk));
 		if (bss->ssid.wpa_psk == NULL)
 			return 1;
@@ -2950,7 +3113,7 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		    pos[PMK_LEN * 2] != '\0') {
 			wpa_printf(MSG_ERROR, "Line %d: Invalid PSK '%s'.",
 				   line, pos);
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 			return 1;
 		}
 		bss->ssid.wpa_psk->group = 1;
@@ -3118,6 +3281,14 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->radius_server_acct_port = atoi(pos);
 	} else if (os_strcmp(buf, "radius_server_ipv6") == 0) {
 		bss->radius_server_ipv6 = atoi(pos);
+	} else if (os_strcmp(buf, "radius_server_tls_port") == 0) {
+		bss->radius_server_tls_port = atoi(pos);
+	} else if (os_strcmp(buf, "radius_server_tls_verify_client") == 0) {
+		bss->radius_server_tls_verify_client = atoi(pos);
+	} else if (os_strcmp(buf, "radius_server_workers") == 0) {
+		bss->radius_server_workers = atoi(pos);
+	} else if (os_strcmp(buf, "radius_server_max_sessions") == 0) {
+		bss->radius_server_max_sessions = atoi(pos);
 #endif /* RADIUS_SERVER */
 	} else if (os_strcmp(buf, "use_pae_group_addr") == 0) {
 		bss->use_pae_group_addr = atoi(pos);
@@ -3613,6 +3784,34 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->disable_pmksa_caching = atoi(pos);
 	} else if (os_strcmp(buf, "okc") == 0) {
 		bss->okc = atoi(pos);
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	} else if (os_strcmp(buf, "pmksa_cache_file") == 0) {
+		os_free(bss->pmksa_cache_file);
+		bss->pmksa_cache_file = os_strdup(pos);
+	} else if (os_strcmp(buf, "pmksa_cache_file_key") == 0) {
+		size_t len = os_strlen(pos) / 2;
+
+		bin_clear_free(bss->pmksa_cache_file_key,
+			       bss->pmksa_cache_file_key_len);
+		bss->pmksa_cache_file_key = NULL;
+		bss->pmksa_cache_file_key_len = 0;
+		if ((len != 32 && len != 48 && len != 64) ||
+		    os_strlen(pos) != 2 * len) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid pmksa_cache_file_key length",
+				   line);
+			return 1;
+		}
+		bss->pmksa_cache_file_key = os_malloc(len);
+		if (!bss->pmksa_cache_file_key ||
+		    hexstr2bin(pos, bss->pmksa_cache_file_key, len)) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid pmksa_cache_file_key",
+				   line);
+			return 1;
+		}
+		bss->pmksa_cache_file_key_len = len;
+#endif /* CONFIG_PMKSA_CACHE_FILE */
 #ifdef CONFIG_WPS
 	} else if (os_strcmp(buf, "wps_state") == 0) {
 		bss->wps_state = atoi(pos);
@@ -3741,12 +3940,11 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->multi_ap_backhaul_ssid.wpa_passphrase = os_strdup(pos);
 		if (bss->multi_ap_backhaul_ssid.wpa_passphrase) {
 			hostapd_config_clear_wpa_psk(
-				&bss->multi_ap_backhaul_ssid.wpa_psk);
+				&bss->multi_ap_backhaul_ssid);
 			bss->multi_ap_backhaul_ssid.wpa_passphrase_set = 1;
 		}
 	} else if (os_strcmp(buf, "multi_ap_backhaul_wpa_psk") == 0) {
-		hostapd_config_clear_wpa_psk(
-			&bss->multi_ap_backhaul_ssid.wpa_psk);
+		hostapd_config_clear_wpa_psk(&bss->multi_ap_backhaul_ssid);
 		bss->multi_ap_backhaul_ssid.wpa_psk =
 			os_zalloc(sizeof(struct hostapd_wpa_psk));
 		if (!bss->multi_ap_backhaul_ssid.wpa_psk)
@@ -3757,7 +3955,7 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			wpa_printf(MSG_ERROR, "Line %d: Invalid PSK '%s'.",
 				   line, pos);
 			hostapd_config_clear_wpa_psk(
-				&bss->multi_ap_backhaul_ssid.wpa_psk);
+				&bss->multi_ap_backhaul_ssid);
 			return 1;
 		}
 		bss->multi_ap_backhaul_ssid.wpa_psk->group = 1;
@@ -4234,6 +4432,28 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->sae_anti_clogging_threshold = atoi(pos);
 	} else if (os_strcmp(buf, "sae_sync") == 0) {
 		bss->sae_sync = atoi(pos);
+	} else if (os_strcmp(buf, "sae_commit_queue_len") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1 || val > 10000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid sae_commit_queue_len=%d; allowed range 1..10000",
+				   line, val);
+			return 1;
+		}
+		bss->sae_commit_queue_len = val;
+#ifdef CONFIG_WORKER_POOL
+	} else if (os_strcmp(buf, "sae_commit_threads") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 64) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid sae_commit_threads=%d; allowed range 0..64",
+				   line, val);
+			return 1;
+		}
+		bss->sae_commit_threads = val;
+#endif /* CONFIG_WORKER_POOL */
 	} else if (os_strcmp(buf, "sae_groups") == 0) {
 		if (hostapd_parse_intlist(&bss->sae_groups, pos)) {
 			wpa_printf(MSG_ERROR,
@@ -60,6 +60,7 @@
 #include "ap/rrm.h"
 #include "ap/dpp_hostapd.h"
 #include "ap/dfs.h"
+#include "ap/authsrv.h"
 #include "wps/wps_defs.h"
 #include "wps/wps.h"
 #include "fst/fst_ctrl_iface.h"
@@ -1460,6 +1461,9 @@ static int hostapd_ctrl_iface_set(struct hostapd_data *hapd, char *cmd)
 		ret = hostapd_set_iface(hapd->iconf, hapd->conf, cmd, value);
 		if (ret)
 			return ret;
+		/* Probe Response frames are built from the configuration, e.g.,
+		 * vendor_elements, without waiting for UPDATE_BEACON */
+		hostapd_flush_probe_resp_cache(hapd);
 
 		if (os_strcasecmp(cmd, "deny_mac_file") == 0) {
 			hostapd_disassoc_deny_mac(hapd);
@@ -1540,24 +1544,18 @@ static int
 hostapd_ctrl_iface_kick_mismatch_psk_sta_iter(struct hostapd_data *hapd,
 					      struct sta_info *sta, void *ctx)
 {
-	struct hostapd_wpa_psk *psk;
+	const u8 *psk = NULL;
 	const u8 *pmk;
 	int pmk_len;
-	int pmk_match;
-	int sta_match;
-	int bss_match;
 	int reason;
 
 	pmk = wpa_auth_get_pmk(sta->wpa_sm, &pmk_len);
 
-	for (psk = hapd->conf->ssid.wpa_psk; pmk && psk; psk = psk->next) {
-		pmk_match = PMK_LEN == pmk_len &&
-			os_memcmp(psk->psk, pmk, pmk_len) == 0;
-		sta_match = psk->group == 0 &&
-			os_memcmp(sta->addr, psk->addr, ETH_ALEN) == 0;
-		bss_match = psk->group == 1;
-
-		if (pmk_match && (sta_match || bss_match))
+	/* Go through the group PSKs and the PSKs for this STA */
+	while (pmk && pmk_len == PMK_LEN &&
+	       (psk = hostapd_get_psk(hapd->conf, sta->addr, NULL, psk,
+				      NULL))) {
+		if (os_memcmp(psk, pmk, PMK_LEN) == 0)
 			return 0;
 	}
 
@@ -1577,9 +1575,7 @@ static int hostapd_ctrl_iface_reload_wpa_psk(struct hostapd_data *hapd)
 	struct hostapd_bss_config *conf = hapd->conf;
 	int err;
 
-	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
-
-	err = hostapd_setup_wpa_psk(conf);
+	err = hostapd_reload_wpa_psk(conf);
 	if (err < 0) {
 		wpa_printf(MSG_ERROR, "Reloading WPA-PSK passwords failed: %d",
 			   err);
@@ -2634,6 +2630,22 @@ static int hostapd_ctrl_iface_mib(struct hostapd_data *hapd, char *reply,
 }
 
 
+static int hostapd_ctrl_iface_tls_ticket_key_add(struct hostapd_data *hapd,
+						 const char *cmd)
+{
+	u8 key[TLS_SESSION_TICKET_KEY_LEN];
+	int ret;
+
+	/* cmd: <hex formatted key> */
+	if (os_strlen(cmd) != 2 * TLS_SESSION_TICKET_KEY_LEN ||
+	    hexstr2bin(cmd, key, sizeof(key)) < 0)
+		return -1;
+	ret = authsrv_add_ticket_key(hapd, key);
+	forced_memzero(key, sizeof(key));
+	return ret;
+}
+
+
 static int hostapd_ctrl_iface_vendor(struct hostapd_data *hapd, char *cmd,
 				     char *buf, size_t buflen)
 {
@@ -3386,6 +3398,12 @@ static int hostapd_ctrl_iface_receive_process(struct hostapd_data *hapd,
 	} else if (os_strncmp(buf, "ENABLE", 6) == 0) {
 		if (hostapd_ctrl_iface_enable(hapd->iface))
 			reply_len = -1;
+	} else if (os_strcmp(buf, "TLS_TICKET_KEYS_RELOAD") == 0) {
+		if (authsrv_reload_ticket_keys(hapd))
+			reply_len = -1;
+	} else if (os_strncmp(buf, "TLS_TICKET_KEY_ADD ", 19) == 0) {
+		if (hostapd_ctrl_iface_tls_ticket_key_add(hapd, buf + 19))
+			reply_len = -1;
 	} else if (os_strcmp(buf, "RELOAD_WPA_PSK") == 0) {
 		if (hostapd_ctrl_iface_reload_wpa_psk(hapd))
 			reply_len = -1;
@@ -3758,7 +3776,10 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 
 	if (os_strcmp(pos, "PING") == 0)
 		level = MSG_EXCESSIVE;
-	wpa_hexdump_ascii(level, "RX ctrl_iface", pos, res);
+	if (os_strncmp(pos, "TLS_TICKET_KEY_ADD ", 19) == 0)
+		wpa_hexdump_ascii_key(level, "RX ctrl_iface", pos, res);
+	else
+		wpa_hexdump_ascii(level, "RX ctrl_iface", pos, res);
 
 	reply_len = hostapd_ctrl_iface_receive_process(hapd, pos,
 						       reply, reply_size,
@@ -4292,6 +4313,8 @@ static int hostapd_ctrl_iface_dup_param(struct hostapd_data *src_hapd,
 
 	res = hostapd_set_iface(dst_hapd->iconf, dst_hapd->conf, param, value);
 	os_free(value);
+	if (!res)
+		hostapd_flush_probe_resp_cache(dst_hapd);
 	return res;
 
 error_stringify:
@@ -1502,6 +1502,20 @@ static int hostapd_cli_cmd_reload_wpa_psk(struct wpa_ctrl *ctrl, int argc,
 }
 
 
+static int hostapd_cli_cmd_tls_ticket_keys_reload(struct wpa_ctrl *ctrl,
+						  int argc, char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "TLS_TICKET_KEYS_RELOAD");
+}
+
+
+static int hostapd_cli_cmd_tls_ticket_key_add(struct wpa_ctrl *ctrl,
+					      int argc, char *argv[])
+{
+	return hostapd_cli_cmd(ctrl, "TLS_TICKET_KEY_ADD", 1, argc, argv);
+}
+
+
 struct hostapd_cli_cmd {
 	const char *cmd;
 	int (*handler)(struct wpa_ctrl *ctrl, int argc, char *argv[]);
@@ -1681,6 +1695,10 @@ static const struct hostapd_cli_cmd hostapd_cli_commands[] = {
 	  "<addr> [req_mode=] <measurement request hexdump>  = send a Beacon report request to a station" },
 	{ "reload_wpa_psk", hostapd_cli_cmd_reload_wpa_psk, NULL,
 	  "= reload wpa_psk_file only" },
+	{ "tls_ticket_keys_reload", hostapd_cli_cmd_tls_ticket_keys_reload,
+	  NULL, "= reload tls_session_ticket_keys file" },
+	{ "tls_ticket_key_add", hostapd_cli_cmd_tls_ticket_key_add, NULL,
+	  "<hex key> = add a new current TLS session ticket key" },
 	{ NULL, NULL, NULL, NULL }
 };
 
@@ -19,6 +19,7 @@
 #include "ap_config.h"
 #include "sta_info.h"
 #include "ap_drv_ops.h"
+#include "accounting_spool.h"
 #include "accounting.h"
 
 
@@ -27,8 +28,18 @@
  * input/output octets and updates Acct-{Input,Output}-Gigawords. */
 #define ACCT_DEFAULT_UPDATE_INTERVAL 300
 
+/* Interim updates and polls that are due within this many seconds from the
+ * expiration of the per-BSS timer are processed together. */
+#define ACCT_INTERIM_BATCH_WINDOW 5
+
+/* Interval in seconds for retrying the replay of spooled messages when the
+ * accounting server does not respond */
+#define ACCT_SPOOL_RETRY_INTERVAL 30
+
 static void accounting_sta_interim(struct hostapd_data *hapd,
 				   struct sta_info *sta);
+static void accounting_spool_store(struct hostapd_data *hapd,
+				   struct radius_msg *msg);
 
 
 static struct radius_msg * accounting_msg(struct hostapd_data *hapd,
@@ -198,10 +209,32 @@ static int accounting_sta_update_stats(struct hostapd_data *hapd,
 }
 
 
-static void accounting_interim_update(void *eloop_ctx, void *timeout_ctx)
+static void accounting_interim_timer(void *eloop_ctx, void *timeout_ctx);
+
+
+/* Make sure the per-BSS interim timer expires no later than at @due */
+static void accounting_interim_schedule(struct hostapd_data *hapd,
+					struct os_reltime *due)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	if (os_reltime_before(due, &now))
+		diff.sec = diff.usec = 0;
+	else
+		os_reltime_sub(due, &now, &diff);
+
+	if (eloop_deplete_timeout(diff.sec, diff.usec,
+				  accounting_interim_timer, hapd, NULL) < 0)
+		eloop_register_timeout(diff.sec, diff.usec,
+				       accounting_interim_timer, hapd, NULL);
+}
+
+
+static void accounting_interim_update(struct hostapd_data *hapd,
+				      struct sta_info *sta,
+				      const struct os_reltime *now)
 {
-	struct hostapd_data *hapd = eloop_ctx;
-	struct sta_info *sta = timeout_ctx;
 	int interval;
 
 	if (sta->acct_interim_interval) {
@@ -213,8 +246,47 @@ static void accounting_interim_update(void *eloop_ctx, void *timeout_ctx)
 		interval = ACCT_DEFAULT_UPDATE_INTERVAL;
 	}
 
-	eloop_register_timeout(interval, 0, accounting_interim_update,
-			       hapd, sta);
+	sta->acct_next_update = *now;
+	sta->acct_next_update.sec += interval;
+}
+
+
+/*
+ * Interim updates (and driver statistics polling) of all the stations of a BSS
+ * are handled by a single timer. All the updates that are due within
+ * ACCT_INTERIM_BATCH_WINDOW are sent together, so the updates of stations that
+ * associated at about the same time end up in the same batch.
+ */
+static void accounting_interim_timer(void *eloop_ctx, void *timeout_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	struct sta_info *sta;
+	struct os_reltime now, window, next;
+	int first = 1;
+	unsigned int count = 0;
+
+	os_get_reltime(&now);
+	window = now;
+	window.sec += ACCT_INTERIM_BATCH_WINDOW;
+
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		if (!sta->acct_session_started)
+			continue;
+		if (!os_reltime_before(&window, &sta->acct_next_update)) {
+			accounting_interim_update(hapd, sta, &now);
+			count++;
+		}
+		if (first || os_reltime_before(&sta->acct_next_update, &next))
+			next = sta->acct_next_update;
+		first = 0;
+	}
+
+	if (count)
+		wpa_printf(MSG_DEBUG,
+			   "Accounting: Processed %u interim update(s) for %s",
+			   count, hapd->conf->iface);
+	if (!first)
+		accounting_interim_schedule(hapd, &next);
 }
 
 
@@ -226,7 +298,7 @@ static void accounting_interim_update(void *eloop_ctx, void *timeout_ctx)
 void accounting_sta_start(struct hostapd_data *hapd, struct sta_info *sta)
 {
 	struct radius_msg *msg;
-	int interval;
+	unsigned int interval;
 
 	if (sta->acct_session_started)
 		return;
@@ -250,13 +322,24 @@ void accounting_sta_start(struct hostapd_data *hapd, struct sta_info *sta)
 		interval = sta->acct_interim_interval;
 	else
 		interval = ACCT_DEFAULT_UPDATE_INTERVAL;
-	eloop_register_timeout(interval, 0, accounting_interim_update,
-			       hapd, sta);
+	/* Spread the updates with a random jitter of up to 10% of the
+	 * interval */
+	interval = interval * 1000 + os_random() % (interval * 100 + 1);
+	sta->acct_next_update = sta->acct_session_start;
+	sta->acct_next_update.sec += interval / 1000;
+	sta->acct_next_update.usec += (interval % 1000) * 1000;
+	if (sta->acct_next_update.usec >= 1000000) {
+		sta->acct_next_update.sec++;
+		sta->acct_next_update.usec -= 1000000;
+	}
+	accounting_interim_schedule(hapd, &sta->acct_next_update);
 
 	msg = accounting_msg(hapd, sta, RADIUS_ACCT_STATUS_TYPE_START);
 	if (msg &&
-	    radius_client_send(hapd->radius, msg, RADIUS_ACCT, sta->addr) < 0)
+	    radius_client_send(hapd->radius, msg, RADIUS_ACCT, sta->addr) < 0) {
+		accounting_spool_store(hapd, msg);
 		radius_msg_free(msg);
+	}
 
 	sta->acct_session_started = 1;
 }
@@ -351,8 +434,11 @@ static void accounting_sta_report(struct hostapd_data *hapd,
 
 	if (radius_client_send(hapd->radius, msg,
 			       stop ? RADIUS_ACCT : RADIUS_ACCT_INTERIM,
-			       sta->addr) < 0)
+			       sta->addr) < 0) {
+		if (stop)
+			accounting_spool_store(hapd, msg);
 		goto fail;
+	}
 	return;
 
  fail:
@@ -382,7 +468,6 @@ void accounting_sta_stop(struct hostapd_data *hapd, struct sta_info *sta)
 {
 	if (sta->acct_session_started) {
 		accounting_sta_report(hapd, sta, 1);
-		eloop_cancel_timeout(accounting_interim_update, hapd, sta);
 		hostapd_logger(hapd, sta->addr, HOSTAPD_MODULE_RADIUS,
 			       HOSTAPD_LEVEL_INFO,
 			       "stopped accounting session %016llX",
@@ -399,6 +484,101 @@ int accounting_sta_get_id(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
+static void accounting_spool_replay(void *eloop_ctx, void *timeout_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	struct radius_msg *msg;
+
+	if (hapd->acct_spool_msg || eloop_terminated())
+		return;
+
+	while (accounting_spool_count(hapd->acct_spool)) {
+		msg = accounting_spool_get(hapd->acct_spool);
+		if (msg)
+			break;
+		/* Skip a record that cannot be parsed */
+		if (accounting_spool_remove(hapd->acct_spool) < 0)
+			return;
+	}
+	if (!accounting_spool_count(hapd->acct_spool))
+		return;
+
+	wpa_printf(MSG_DEBUG,
+		   "Accounting: Replay spooled message (%u pending)",
+		   accounting_spool_count(hapd->acct_spool));
+	/* Use a new identifier since Acct-Delay-Time was updated */
+	radius_msg_get_hdr(msg)->identifier =
+		radius_client_get_id(hapd->radius);
+	hapd->acct_spool_msg = msg;
+	if (radius_client_send(hapd->radius, msg, RADIUS_ACCT, NULL) < 0) {
+		/* Not passed to the drop callback, so retry here */
+		hapd->acct_spool_msg = NULL;
+		radius_msg_free(msg);
+		eloop_register_timeout(ACCT_SPOOL_RETRY_INTERVAL, 0,
+				       accounting_spool_replay, hapd, NULL);
+	}
+}
+
+
+/* Replay the next spooled message after the configured rate interval */
+static void accounting_spool_schedule(struct hostapd_data *hapd)
+{
+	unsigned int usec = 1000000 / hapd->conf->radius_acct_spool_rate;
+
+	if (eloop_deplete_timeout(usec / 1000000, usec % 1000000,
+				  accounting_spool_replay, hapd, NULL) < 0)
+		eloop_register_timeout(usec / 1000000, usec % 1000000,
+				       accounting_spool_replay, hapd, NULL);
+}
+
+
+/* Store an unacknowledged Accounting-Request message into the spool */
+static void accounting_spool_store(struct hostapd_data *hapd,
+				   struct radius_msg *msg)
+{
+	u32 status_type;
+
+	if (!hapd->acct_spool)
+		return;
+
+	/* The server is expected to close old sessions on the next
+	 * Accounting-On, so these are not worth replaying later. */
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_STATUS_TYPE,
+				      &status_type) == 0 &&
+	    (status_type == RADIUS_ACCT_STATUS_TYPE_ACCOUNTING_ON ||
+	     status_type == RADIUS_ACCT_STATUS_TYPE_ACCOUNTING_OFF))
+		return;
+
+	if (accounting_spool_add(hapd->acct_spool, msg) < 0)
+		return;
+	wpa_printf(MSG_DEBUG,
+		   "Accounting: Spooled unacknowledged message (%u pending)",
+		   accounting_spool_count(hapd->acct_spool));
+
+	if (!hapd->acct_spool_msg &&
+	    !eloop_is_timeout_registered(accounting_spool_replay, hapd, NULL))
+		eloop_register_timeout(ACCT_SPOOL_RETRY_INTERVAL, 0,
+				       accounting_spool_replay, hapd, NULL);
+}
+
+
+static void accounting_drop_cb(struct radius_msg *msg, void *ctx)
+{
+	struct hostapd_data *hapd = ctx;
+
+	if (msg == hapd->acct_spool_msg) {
+		/* The record stays at the head of the spool */
+		hapd->acct_spool_msg = NULL;
+		eloop_cancel_timeout(accounting_spool_replay, hapd, NULL);
+		eloop_register_timeout(ACCT_SPOOL_RETRY_INTERVAL, 0,
+				       accounting_spool_replay, hapd, NULL);
+		return;
+	}
+
+	accounting_spool_store(hapd, msg);
+}
+
+
 /**
  * accounting_receive - Process the RADIUS frames from Accounting Server
  * @msg: RADIUS response message
@@ -413,6 +593,8 @@ accounting_receive(struct radius_msg *msg, struct radius_msg *req,
 		   const u8 *shared_secret, size_t shared_secret_len,
 		   void *data)
 {
+	struct hostapd_data *hapd = data;
+
 	if (radius_msg_get_hdr(msg)->code != RADIUS_CODE_ACCOUNTING_RESPONSE) {
 		wpa_printf(MSG_INFO, "Unknown RADIUS message code");
 		return RADIUS_RX_UNKNOWN;
@@ -423,6 +605,15 @@ accounting_receive(struct radius_msg *msg, struct radius_msg *req,
 		return RADIUS_RX_INVALID_AUTHENTICATOR;
 	}
 
+	if (req == hapd->acct_spool_msg) {
+		hapd->acct_spool_msg = NULL;
+		accounting_spool_remove(hapd->acct_spool);
+	}
+	/* Any response means the server is reachable, so continue replay
+	 * without waiting for the retry interval */
+	if (accounting_spool_count(hapd->acct_spool) && !hapd->acct_spool_msg)
+		accounting_spool_schedule(hapd);
+
 	return RADIUS_RX_PROCESSED;
 }
 
@@ -462,7 +653,7 @@ static void accounting_interim_error_cb(const u8 *addr, void *ctx)
 	struct hostapd_data *hapd = ctx;
 	struct sta_info *sta;
 	unsigned int i, wait_time;
-	int res;
+	struct os_reltime due;
 
 	sta = ap_get_sta(hapd, addr);
 	if (!sta)
@@ -494,23 +685,22 @@ static void accounting_interim_error_cb(const u8 *addr, void *ctx)
 		for (i = 1; i < sta->acct_interim_errors; i++)
 			wait_time *= 2;
 	}
-	res = eloop_deplete_timeout(wait_time, 0, accounting_interim_update,
-				    hapd, sta);
-	if (res == 1)
+	os_get_reltime(&due);
+	due.sec += wait_time;
+	if (sta->acct_session_started &&
+	    os_reltime_before(&due, &sta->acct_next_update)) {
+		sta->acct_next_update = due;
+		accounting_interim_schedule(hapd, &due);
 		wpa_printf(MSG_DEBUG,
 			   "Interim RADIUS accounting update failed for " MACSTR
 			   " (error count: %u) - schedule next update in %u seconds",
 			   MAC2STR(addr), sta->acct_interim_errors, wait_time);
-	else if (res == 0)
+	} else {
 		wpa_printf(MSG_DEBUG,
 			   "Interim RADIUS accounting update failed for " MACSTR
 			   " (error count: %u)", MAC2STR(addr),
 			   sta->acct_interim_errors);
-	else
-		wpa_printf(MSG_DEBUG,
-			   "Interim RADIUS accounting update failed for " MACSTR
-			   " (error count: %u) - no timer found", MAC2STR(addr),
-			   sta->acct_interim_errors);
+	}
 }
 
 
@@ -531,8 +721,22 @@ int accounting_init(struct hostapd_data *hapd)
 	radius_client_set_interim_error_cb(hapd->radius,
 					   accounting_interim_error_cb, hapd);
 
+	if (hapd->conf->radius_acct_spool_file) {
+		hapd->acct_spool = accounting_spool_init(
+			hapd->conf->radius_acct_spool_file,
+			(size_t) hapd->conf->radius_acct_spool_max_size * 1024);
+		if (!hapd->acct_spool)
+			return -1;
+		radius_client_set_acct_drop_cb(hapd->radius,
+					       accounting_drop_cb, hapd);
+	}
+
 	accounting_report_state(hapd, 1);
 
+	if (accounting_spool_count(hapd->acct_spool))
+		eloop_register_timeout(0, 0, accounting_spool_replay, hapd,
+				       NULL);
+
 	return 0;
 }
 
@@ -543,5 +747,15 @@ int accounting_init(struct hostapd_data *hapd)
  */
 void accounting_deinit(struct hostapd_data *hapd)
 {
+	eloop_cancel_timeout(accounting_interim_timer, hapd, NULL);
 	accounting_report_state(hapd, 0);
+
+	if (hapd->acct_spool) {
+		/* Move the pending Accounting-Request messages to the spool */
+		radius_client_flush(hapd->radius, 0);
+		radius_client_set_acct_drop_cb(hapd->radius, NULL, NULL);
+		eloop_cancel_timeout(accounting_spool_replay, hapd, NULL);
+		accounting_spool_deinit(hapd->acct_spool);
+		hapd->acct_spool = NULL;
+	}
 }
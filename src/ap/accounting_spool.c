@@ -0,0 +1,333 @@
+/*
+ * hostapd / RADIUS Accounting spool file
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Accounting-Request messages that were not acknowledged by the accounting
+ * server are appended to a spool file as records of the following format:
+ *
+ * u16 magic (big endian), u16 message length, u32 time the message was
+ * spooled (seconds since the Epoch), followed by the RADIUS message.
+ *
+ * Records are only ever appended to the end of the file. When the head record
+ * has been acknowledged, its magic value is overwritten to mark it consumed
+ * and the file is truncated once no pending records remain. New records are
+ * dropped when they would make the file exceed the configured maximum size.
+ */
+
+#include "utils/includes.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "utils/common.h"
+#include "radius/radius.h"
+#include "accounting_spool.h"
+
+
+#define ACCT_SPOOL_MAGIC 0x4153
+#define ACCT_SPOOL_CONSUMED 0x4144
+#define ACCT_SPOOL_HDR_LEN 8
+
+struct accounting_spool {
+	int fd;
+	char *fname;
+	off_t head; /* offset of the first pending record */
+	off_t end; /* offset of the end of the last valid record */
+	unsigned int count; /* number of pending records */
+	off_t max_size; /* maximum file size in octets or 0 for no limit */
+};
+
+
+static int accounting_spool_read_hdr(struct accounting_spool *spool,
+				     off_t pos, u16 *magic, u16 *len,
+				     u32 *stamp)
+{
+	u8 hdr[ACCT_SPOOL_HDR_LEN];
+
+	if (pread(spool->fd, hdr, sizeof(hdr), pos) != sizeof(hdr))
+		return -1;
+	*magic = WPA_GET_BE16(hdr);
+	*len = WPA_GET_BE16(&hdr[2]);
+	*stamp = WPA_GET_BE32(&hdr[4]);
+	if ((*magic != ACCT_SPOOL_MAGIC && *magic != ACCT_SPOOL_CONSUMED) ||
+	    *len < sizeof(struct radius_hdr))
+		return -1;
+	return 0;
+}
+
+
+static int accounting_spool_load(struct accounting_spool *spool)
+{
+	struct stat st;
+	off_t pos = 0;
+	u16 magic, len;
+	u32 stamp;
+	int first = 1;
+
+	if (fstat(spool->fd, &st) < 0)
+		return -1;
+
+	while (pos + ACCT_SPOOL_HDR_LEN <= st.st_size) {
+		if (accounting_spool_read_hdr(spool, pos, &magic, &len,
+					      &stamp) < 0 ||
+		    pos + ACCT_SPOOL_HDR_LEN + len > st.st_size)
+			break;
+		if (magic == ACCT_SPOOL_MAGIC) {
+			if (first)
+				spool->head = pos;
+			first = 0;
+			spool->count++;
+		}
+		pos += ACCT_SPOOL_HDR_LEN + len;
+	}
+
+	if (first)
+		spool->head = pos;
+	spool->end = pos;
+
+	if (pos != st.st_size) {
+		wpa_printf(MSG_INFO,
+			   "Accounting spool: Truncate invalid data at the end of %s (offset %lld)",
+			   spool->fname, (long long) pos);
+		if (ftruncate(spool->fd, pos) < 0)
+			return -1;
+	}
+
+	if (!spool->count && spool->end) {
+		/* Only consumed records left */
+		spool->head = spool->end = 0;
+		if (ftruncate(spool->fd, 0) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * accounting_spool_init - Open an accounting spool file
+ * @fname: Path to the spool file; created if it does not exist
+ * @max_size: Maximum size of the spool file in octets or 0 for no limit
+ * Returns: Pointer to the spool or %NULL on failure
+ *
+ * The records that have not been marked consumed are left pending and will be
+ * returned by accounting_spool_get(). Incomplete data at the end of the file,
+ * e.g., from an interrupted write, is removed.
+ */
+struct accounting_spool * accounting_spool_init(const char *fname,
+						size_t max_size)
+{
+	struct accounting_spool *spool;
+
+	spool = os_zalloc(sizeof(*spool));
+	if (!spool)
+		return NULL;
+	spool->max_size = max_size;
+	spool->fname = os_strdup(fname);
+	spool->fd = open(fname, O_RDWR | O_CREAT, 0600);
+	if (!spool->fname || spool->fd < 0) {
+		wpa_printf(MSG_ERROR, "Accounting spool: Could not open %s: %s",
+			   fname, strerror(errno));
+		goto fail;
+	}
+
+	if (accounting_spool_load(spool) < 0) {
+		wpa_printf(MSG_ERROR, "Accounting spool: Could not read %s: %s",
+			   fname, strerror(errno));
+		goto fail;
+	}
+
+	wpa_printf(MSG_DEBUG, "Accounting spool: %s has %u pending message(s)",
+		   fname, spool->count);
+	return spool;
+
+fail:
+	accounting_spool_deinit(spool);
+	return NULL;
+}
+
+
+/**
+ * accounting_spool_deinit - Close an accounting spool file
+ * @spool: Accounting spool from accounting_spool_init()
+ *
+ * Pending records are left in the file for the next accounting_spool_init().
+ */
+void accounting_spool_deinit(struct accounting_spool *spool)
+{
+	if (!spool)
+		return;
+	if (spool->fd >= 0)
+		close(spool->fd);
+	os_free(spool->fname);
+	os_free(spool);
+}
+
+
+/**
+ * accounting_spool_add - Append an Accounting-Request message to the spool
+ * @spool: Accounting spool from accounting_spool_init()
+ * @msg: Accounting-Request message; the caller keeps ownership
+ * Returns: 0 on success, -1 on failure (including the spool file being full)
+ */
+int accounting_spool_add(struct accounting_spool *spool,
+			 struct radius_msg *msg)
+{
+	struct wpabuf *buf = radius_msg_get_buf(msg);
+	u8 hdr[ACCT_SPOOL_HDR_LEN];
+	struct iovec iov[2];
+	struct os_time now;
+	size_t len = wpabuf_len(buf);
+	ssize_t res;
+
+	if (len < sizeof(struct radius_hdr) || len > 0xffff)
+		return -1;
+
+	if (spool->max_size &&
+	    spool->end + (off_t) (sizeof(hdr) + len) > spool->max_size) {
+		wpa_printf(MSG_INFO,
+			   "Accounting spool: %s is full - message dropped",
+			   spool->fname);
+		return -1;
+	}
+
+	os_get_time(&now);
+	WPA_PUT_BE16(hdr, ACCT_SPOOL_MAGIC);
+	WPA_PUT_BE16(&hdr[2], len);
+	WPA_PUT_BE32(&hdr[4], now.sec);
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = (void *) wpabuf_head(buf);
+	iov[1].iov_len = len;
+
+	if (lseek(spool->fd, spool->end, SEEK_SET) < 0)
+		return -1;
+	res = writev(spool->fd, iov, 2);
+	if (res < 0 || (size_t) res != sizeof(hdr) + len || fsync(spool->fd)) {
+		wpa_printf(MSG_ERROR, "Accounting spool: Write to %s failed: %s",
+			   spool->fname, res < 0 ? strerror(errno) : "short");
+		/* Do not leave a partial record behind */
+		if (ftruncate(spool->fd, spool->end) < 0)
+			wpa_printf(MSG_ERROR,
+				   "Accounting spool: Truncate failed: %s",
+				   strerror(errno));
+		return -1;
+	}
+
+	if (spool->count == 0)
+		spool->head = spool->end;
+	spool->end += res;
+	spool->count++;
+	return 0;
+}
+
+
+/**
+ * accounting_spool_get - Get the oldest pending message from the spool
+ * @spool: Accounting spool from accounting_spool_init()
+ * Returns: Parsed RADIUS message (to be freed by the caller) or %NULL if the
+ * spool is empty or the record could not be parsed
+ *
+ * The time spent in the spool is added to the Acct-Delay-Time attribute of the
+ * returned message. The record stays in the spool until
+ * accounting_spool_remove() is called.
+ */
+struct radius_msg * accounting_spool_get(struct accounting_spool *spool)
+{
+	struct radius_msg *msg;
+	struct os_time now;
+	u16 magic, len;
+	u32 stamp, delay;
+	u8 *buf, *attr;
+	size_t attr_len;
+
+	if (!spool->count ||
+	    accounting_spool_read_hdr(spool, spool->head, &magic, &len,
+				      &stamp) < 0 ||
+	    magic != ACCT_SPOOL_MAGIC)
+		return NULL;
+
+	buf = os_malloc(len);
+	if (!buf)
+		return NULL;
+	if (pread(spool->fd, buf, len, spool->head + ACCT_SPOOL_HDR_LEN) !=
+	    len) {
+		os_free(buf);
+		return NULL;
+	}
+	msg = radius_msg_parse(buf, len);
+	os_free(buf);
+	if (!msg) {
+		wpa_printf(MSG_INFO,
+			   "Accounting spool: Invalid message at offset %lld",
+			   (long long) spool->head);
+		return NULL;
+	}
+
+	os_get_time(&now);
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+				    &attr, &attr_len, NULL) == 0 &&
+	    attr_len == 4 && (os_time_t) stamp < now.sec) {
+		delay = WPA_GET_BE32(attr) + (now.sec - stamp);
+		WPA_PUT_BE32(attr, delay);
+	}
+
+	return msg;
+}
+
+
+/**
+ * accounting_spool_remove - Remove the oldest pending message from the spool
+ * @spool: Accounting spool from accounting_spool_init()
+ * Returns: 0 on success, -1 on failure
+ */
+int accounting_spool_remove(struct accounting_spool *spool)
+{
+	u8 magic[2];
+	u16 type, len;
+	u32 stamp;
+	off_t pos;
+
+	if (!spool->count ||
+	    accounting_spool_read_hdr(spool, spool->head, &type, &len,
+				      &stamp) < 0)
+		return -1;
+
+	spool->count--;
+	if (spool->count == 0) {
+		spool->head = spool->end = 0;
+		return ftruncate(spool->fd, 0);
+	}
+
+	WPA_PUT_BE16(magic, ACCT_SPOOL_CONSUMED);
+	if (pwrite(spool->fd, magic, sizeof(magic), spool->head) !=
+	    sizeof(magic))
+		wpa_printf(MSG_INFO,
+			   "Accounting spool: Could not mark record consumed: %s",
+			   strerror(errno));
+
+	/* Skip to the next pending record */
+	pos = spool->head + ACCT_SPOOL_HDR_LEN + len;
+	while (pos < spool->end &&
+	       accounting_spool_read_hdr(spool, pos, &type, &len,
+					 &stamp) == 0 &&
+	       type != ACCT_SPOOL_MAGIC)
+		pos += ACCT_SPOOL_HDR_LEN + len;
+	spool->head = pos;
+
+	return 0;
+}
+
+
+/**
+ * accounting_spool_count - Number of pending messages in the spool
+ * @spool: Accounting spool from accounting_spool_init() or %NULL
+ * Returns: Number of pending messages
+ */
+unsigned int accounting_spool_count(struct accounting_spool *spool)
+{
+	return spool ? spool->count : 0;
+}
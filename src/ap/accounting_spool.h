@@ -0,0 +1,24 @@
+/*
+ * hostapd / RADIUS Accounting spool file
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef ACCOUNTING_SPOOL_H
+#define ACCOUNTING_SPOOL_H
+
+struct accounting_spool;
+struct radius_msg;
+
+struct accounting_spool * accounting_spool_init(const char *fname,
+						size_t max_size);
+void accounting_spool_deinit(struct accounting_spool *spool);
+int accounting_spool_add(struct accounting_spool *spool,
+			 struct radius_msg *msg);
+struct radius_msg * accounting_spool_get(struct accounting_spool *spool);
+int accounting_spool_remove(struct accounting_spool *spool);
+unsigned int accounting_spool_count(struct accounting_spool *spool);
+
+#endif /* ACCOUNTING_SPOOL_H */
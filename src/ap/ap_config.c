@@ -9,6 +9,7 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "crypto/crypto.h"
 #include "crypto/sha1.h"
 #include "crypto/tls.h"
 #include "radius/radius_client.h"
@@ -83,6 +84,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 	bss->dtim_period = 2;
 
 	bss->radius_server_auth_port = 1812;
+	bss->radius_server_tls_verify_client = 1;
 	bss->eap_sim_db_timeout = 1;
 	bss->eap_sim_id = 3;
 	bss->ap_max_inactivity = AP_MAX_INACTIVITY;
@@ -115,9 +117,13 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 #endif /* CONFIG_IEEE80211R_AP */
 
 	bss->radius_das_time_window = 300;
+	bss->radius_acct_spool_rate = 10;
+	bss->radius_acct_spool_max_size = 1024;
+	bss->radius_acl_reject_timeout = 30;
 
 	bss->sae_anti_clogging_threshold = 5;
 	bss->sae_sync = 5;
+	bss->sae_commit_queue_len = 15;
 
 	bss->gas_frag_limit = 1400;
 
@@ -283,8 +289,179 @@ int hostapd_mac_comp(const void *a, const void *b)
 }
 
 
+static int hostapd_psk_group_insert(struct hostapd_psk_index *idx,
+				    struct hostapd_wpa_psk *psk)
+{
+	struct hostapd_wpa_psk **group;
+	size_t start = 0, end = idx->num_group, mid;
+
+	group = os_realloc_array(idx->group, idx->num_group + 1,
+				 sizeof(*group));
+	if (!group)
+		return -1;
+	idx->group = group;
+
+	while (start < end) {
+		mid = start + (end - start) / 2;
+		if (group[mid]->order < psk->order)
+			start = mid + 1;
+		else
+			end = mid;
+	}
+	os_memmove(&group[start + 1], &group[start],
+		   (idx->num_group - start) * sizeof(*group));
+	group[start] = psk;
+	idx->num_group++;
+	return 0;
+}
+
+
+static int hostapd_psk_index_add(struct hostapd_psk_index *idx,
+				 struct hostapd_wpa_psk *psk)
+{
+	if (psk->group)
+		return hostapd_psk_group_insert(idx, psk);
+
+	if (hash_table_add(&idx->addr, &psk->addr_node, psk->addr,
+			   ETH_ALEN) < 0)
+		return -1;
+	if (!is_zero_ether_addr(psk->p2p_dev_addr) &&
+	    hash_table_add(&idx->p2p_dev_addr, &psk->p2p_node,
+			   psk->p2p_dev_addr, ETH_ALEN) < 0) {
+		hash_table_del(&idx->addr, &psk->addr_node);
+		return -1;
+	}
+	return 0;
+}
+
+
+static void hostapd_psk_index_del(struct hostapd_psk_index *idx,
+				  struct hostapd_wpa_psk *psk)
+{
+	size_t i;
+
+	if (!psk->group) {
+		hash_table_del(&idx->addr, &psk->addr_node);
+		if (!is_zero_ether_addr(psk->p2p_dev_addr))
+			hash_table_del(&idx->p2p_dev_addr, &psk->p2p_node);
+		return;
+	}
+
+	for (i = 0; i < idx->num_group; i++) {
+		if (idx->group[i] == psk) {
+			os_memmove(&idx->group[i], &idx->group[i + 1],
+				   (idx->num_group - i - 1) *
+				   sizeof(idx->group[0]));
+			idx->num_group--;
+			break;
+		}
+	}
+}
+
+
+static void hostapd_psk_index_deinit(struct hostapd_psk_index *idx)
+{
+	hash_table_deinit(&idx->addr);
+	hash_table_deinit(&idx->p2p_dev_addr);
+	os_free(idx->group);
+	idx->group = NULL;
+	idx->num_group = 0;
+	idx->valid = 0;
+}
+
+
+static int hostapd_psk_index_build(struct hostapd_ssid *ssid)
+{
+	struct hostapd_psk_index *idx = &ssid->psk_index;
+	struct hostapd_wpa_psk *psk;
+	int order = 0;
+
+	hostapd_psk_index_deinit(idx);
+	for (psk = ssid->wpa_psk; psk; psk = psk->next) {
+		psk->order = order++;
+		if (hostapd_psk_index_add(idx, psk) < 0) {
+			hostapd_psk_index_deinit(idx);
+			return -1;
+		}
+	}
+	idx->valid = 1;
+
+	return 0;
+}
+
+
+static int hostapd_wpa_psk_same(const struct hostapd_wpa_psk *a,
+				const struct hostapd_wpa_psk *b, int cmp_psk)
+{
+	return a->group == b->group && a->wps == b->wps &&
+		a->vlan_id == b->vlan_id &&
+		os_memcmp(a->addr, b->addr, ETH_ALEN) == 0 &&
+		os_memcmp(a->p2p_dev_addr, b->p2p_dev_addr, ETH_ALEN) == 0 &&
+		os_strcmp(a->keyid, b->keyid) == 0 &&
+		os_memcmp(a->src_hash, b->src_hash, SHA256_MAC_LEN) == 0 &&
+		(!cmp_psk || os_memcmp(a->psk, b->psk, PMK_LEN) == 0);
+}
+
+
+/*
+ * Find an indexed entry that was read from wpa_psk_file or added by WPS with
+ * the same parameters as the specified entry and that has not yet been claimed
+ * during the ongoing reload operation.
+ */
+static struct hostapd_wpa_psk *
+hostapd_psk_index_find(struct hostapd_psk_index *idx,
+		       const struct hostapd_wpa_psk *psk, int cmp_psk)
+{
+	struct hostapd_wpa_psk *pos;
+	struct hash_node *node;
+	size_t i;
+
+	if (!idx->valid)
+		return NULL;
+
+	if (psk->group) {
+		for (i = 0; i < idx->num_group; i++) {
+			pos = idx->group[i];
+			if ((pos->from_file || pos->wps) && !pos->reload_keep &&
+			    hostapd_wpa_psk_same(pos, psk, cmp_psk))
+				return pos;
+		}
+		return NULL;
+	}
+
+	for (node = hash_table_get(&idx->addr, psk->addr, ETH_ALEN); node;
+	     node = hash_table_get_next(&idx->addr, node)) {
+		pos = hash_table_entry(node, struct hostapd_wpa_psk, addr_node);
+		if ((pos->from_file || pos->wps) && !pos->reload_keep &&
+		    hostapd_wpa_psk_same(pos, psk, cmp_psk))
+			return pos;
+	}
+
+	return NULL;
+}
+
+
+static void hostapd_wpa_psk_free_list(struct hostapd_wpa_psk *psk)
+{
+	struct hostapd_wpa_psk *tmp;
+
+	while (psk) {
+		tmp = psk;
+		psk = psk->next;
+		bin_clear_free(tmp, sizeof(*tmp));
+	}
+}
+
+
+/*
+ * Read wpa_psk_file and add the entries to the beginning of *list. PSKs that
+ * are derived from a passphrase are copied from a matching entry in the
+ * current index, if available, to avoid the expensive derivation for
+ * unchanged entries.
+ */
 static int hostapd_config_read_wpa_psk(const char *fname,
-				       struct hostapd_ssid *ssid)
+				       struct hostapd_ssid *ssid,
+				       struct hostapd_wpa_psk **list)
 {
 	FILE *f;
 	char buf[128], *pos;
@@ -296,7 +473,9 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 	char *value;
 	int line = 0, ret = 0, len, ok;
 	u8 addr[ETH_ALEN];
-	struct hostapd_wpa_psk *psk;
+	struct hostapd_wpa_psk *psk, *old;
+	const u8 *vec[2];
+	size_t vlen[2];
 
 	if (!fname)
 		return 0;
@@ -392,10 +571,8 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		if (len == 2 * PMK_LEN &&
 		    hexstr2bin(pos, psk->psk, PMK_LEN) == 0)
 			ok = 1;
-		else if (len >= 8 && len < 64 &&
-			 pbkdf2_sha1(pos, ssid->ssid, ssid->ssid_len,
-				     4096, psk->psk, PMK_LEN) == 0)
-			ok = 1;
+		else if (len >= 8 && len < 64)
+			ok = 2;
 		if (!ok) {
 			wpa_printf(MSG_ERROR,
 				   "Invalid PSK '%s' on line %d in '%s'",
@@ -418,9 +595,37 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		}
 
 		psk->wps = wps;
+		psk->from_file = 1;
+
+		if (ok == 2) {
+			/* The SSID may have changed since the previous read,
+			 * so it is included to avoid reusing a PSK derived
+			 * with another SSID. */
+			vec[0] = (const u8 *) pos;
+			vlen[0] = os_strlen(pos);
+			vec[1] = ssid->ssid;
+			vlen[1] = ssid->ssid_len;
+			if (sha256_vector(2, vec, vlen, psk->src_hash) < 0) {
+				os_free(psk);
+				ret = -1;
+				break;
+			}
+			old = hostapd_psk_index_find(&ssid->psk_index, psk, 0);
+			if (old)
+				os_memcpy(psk->psk, old->psk, PMK_LEN);
+			else if (pbkdf2_sha1(pos, ssid->ssid, ssid->ssid_len,
+					     4096, psk->psk, PMK_LEN) != 0) {
+				wpa_printf(MSG_ERROR,
+					   "Invalid PSK '%s' on line %d in '%s'",
+					   pos, line, fname);
+				os_free(psk);
+				ret = -1;
+				break;
+			}
+		}
 
-		psk->next = ssid->wpa_psk;
-		ssid->wpa_psk = psk;
+		psk->next = *list;
+		*list = psk;
 	}
 
 	fclose(f);
@@ -509,7 +714,180 @@ int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
 		ssid->wpa_psk->group = 1;
 	}
 
-	return hostapd_config_read_wpa_psk(ssid->wpa_psk_file, &conf->ssid);
+	if (hostapd_config_read_wpa_psk(ssid->wpa_psk_file, ssid,
+					&ssid->wpa_psk) < 0)
+		return -1;
+
+	if (hostapd_psk_index_build(ssid) < 0)
+		wpa_printf(MSG_INFO,
+			   "Could not build WPA PSK index - use list search");
+	return 0;
+}
+
+
+/**
+ * hostapd_wpa_psk_add - Add a PSK to the beginning of the wpa_psk list
+ * @ssid: SSID configuration
+ * @psk: PSK entry; this is freed with the list
+ * Returns: 0 on success, -1 on failure (the entry is not added)
+ */
+int hostapd_wpa_psk_add(struct hostapd_ssid *ssid,
+			struct hostapd_wpa_psk *psk)
+{
+	struct hostapd_psk_index *idx = &ssid->psk_index;
+
+	psk->order = ssid->wpa_psk ? ssid->wpa_psk->order - 1 : 0;
+	if (idx->valid && hostapd_psk_index_add(idx, psk) < 0)
+		return -1;
+	psk->next = ssid->wpa_psk;
+	ssid->wpa_psk = psk;
+	return 0;
+}
+
+
+/**
+ * hostapd_wpa_psk_del - Remove and free a PSK from the wpa_psk list
+ * @ssid: SSID configuration
+ * @psk: PSK entry from ssid->wpa_psk
+ */
+void hostapd_wpa_psk_del(struct hostapd_ssid *ssid,
+			 struct hostapd_wpa_psk *psk)
+{
+	struct hostapd_wpa_psk **pos;
+
+	for (pos = &ssid->wpa_psk; *pos; pos = &(*pos)->next) {
+		if (*pos == psk) {
+			*pos = psk->next;
+			if (ssid->psk_index.valid)
+				hostapd_psk_index_del(&ssid->psk_index, psk);
+			bin_clear_free(psk, sizeof(*psk));
+			return;
+		}
+	}
+}
+
+
+/**
+ * hostapd_reload_wpa_psk - Reload wpa_psk_file
+ * @conf: BSS configuration
+ * Returns: 0 on success, -1 on failure
+ *
+ * The entries from the previous version of the file (and the ones added with
+ * WPS) that have not changed are kept in the list and in the index, so the
+ * cost of the reload depends mainly on the number of modified entries. The
+ * resulting list order is the same as with a full reconfiguration. On failure,
+ * the old entries are left in place.
+ */
+int hostapd_reload_wpa_psk(struct hostapd_bss_config *conf)
+{
+	struct hostapd_ssid *ssid = &conf->ssid;
+	struct hostapd_psk_index *idx = &ssid->psk_index;
+	struct hostapd_wpa_psk *file_psk = NULL, *psk, *next, *old;
+	struct hostapd_wpa_psk *head = NULL, **tail = &head;
+	struct hostapd_wpa_psk *cfg = NULL, **cfg_tail = &cfg;
+	struct hostapd_wpa_psk **olds = NULL, **group;
+	size_t num_old = 0, i, num_group = 0, added = 0, removed = 0;
+	int order = 0;
+
+	if (!idx->valid) {
+		hostapd_config_clear_wpa_psk(ssid);
+		return hostapd_setup_wpa_psk(conf);
+	}
+
+	if (hostapd_config_read_wpa_psk(ssid->wpa_psk_file, ssid,
+					&file_psk) < 0) {
+		hostapd_wpa_psk_free_list(file_psk);
+		return -1;
+	}
+
+	for (psk = ssid->wpa_psk; psk; psk = psk->next) {
+		num_old++;
+		if (psk->group)
+			num_group++;
+	}
+	for (psk = file_psk; psk; psk = psk->next) {
+		if (psk->group)
+			num_group++;
+	}
+	olds = os_calloc(num_old ? num_old : 1, sizeof(*olds));
+	group = os_calloc(num_group ? num_group : 1, sizeof(*group));
+	if (!olds || !group) {
+		os_free(olds);
+		os_free(group);
+		hostapd_wpa_psk_free_list(file_psk);
+		return -1;
+	}
+
+	/*
+	 * Split the current list into the entries from the main configuration
+	 * (wpa_psk/wpa_passphrase) that are kept as-is and the ones that are
+	 * replaced by the new contents of the file.
+	 */
+	num_old = 0;
+	for (psk = ssid->wpa_psk; psk; psk = next) {
+		next = psk->next;
+		if (!psk->from_file && !psk->wps) {
+			psk->reload_keep = 1;
+			*cfg_tail = psk;
+			cfg_tail = &psk->next;
+		} else {
+			olds[num_old++] = psk;
+		}
+	}
+	*cfg_tail = NULL;
+
+	for (psk = file_psk; psk; psk = next) {
+		next = psk->next;
+		old = hostapd_psk_index_find(idx, psk, 1);
+		if (old) {
+			old->reload_keep = 1;
+			bin_clear_free(psk, sizeof(*psk));
+			psk = old;
+		}
+		*tail = psk;
+		tail = &psk->next;
+	}
+	*tail = cfg;
+
+	for (i = 0; i < num_old; i++) {
+		if (!olds[i]->reload_keep) {
+			hostapd_psk_index_del(idx, olds[i]);
+			bin_clear_free(olds[i], sizeof(*olds[i]));
+			removed++;
+		}
+	}
+	os_free(olds);
+
+	/* Renumber the entries and add the new ones to the index */
+	num_group = 0;
+	for (psk = head; psk; psk = psk->next) {
+		psk->order = order++;
+		if (psk->group)
+			group[num_group++] = psk;
+		if (psk->reload_keep) {
+			psk->reload_keep = 0;
+		} else {
+			added++;
+			if (!psk->group && hostapd_psk_index_add(idx, psk) < 0)
+				idx->valid = 0;
+		}
+	}
+	ssid->wpa_psk = head;
+	os_free(idx->group);
+	idx->group = group;
+	idx->num_group = num_group;
+
+	wpa_printf(MSG_DEBUG,
+		   "Reloaded WPA PSK file: %d entries, %u added, %u removed",
+		   order, (unsigned int) added, (unsigned int) removed);
+
+	if (!idx->valid) {
+		wpa_printf(MSG_INFO,
+			   "Could not update WPA PSK index - use list search");
+		hostapd_psk_index_deinit(idx);
+	}
+
+	return 0;
 }
 
 
@@ -520,6 +898,11 @@ static void hostapd_config_free_radius(struct hostapd_radius_server *servers,
 
 	for (i = 0; i < num_servers; i++) {
 		os_free(servers[i].shared_secret);
+		os_free(servers[i].ca_cert);
+		os_free(servers[i].client_cert);
+		os_free(servers[i].private_key);
+		str_clear_free(servers[i].private_key_passwd);
+		os_free(servers[i].domain_match);
 	}
 	os_free(servers);
 }
@@ -652,16 +1035,11 @@ static void hostapd_config_free_wep(struct hostapd_wep_keys *keys)
 #endif /* CONFIG_WEP */
 
 
-void hostapd_config_clear_wpa_psk(struct hostapd_wpa_psk **l)
+void hostapd_config_clear_wpa_psk(struct hostapd_ssid *ssid)
 {
-	struct hostapd_wpa_psk *psk, *tmp;
-
-	for (psk = *l; psk;) {
-		tmp = psk;
-		psk = psk->next;
-		bin_clear_free(tmp, sizeof(*tmp));
-	}
-	*l = NULL;
+	hostapd_psk_index_deinit(&ssid->psk_index);
+	hostapd_wpa_psk_free_list(ssid->wpa_psk);
+	ssid->wpa_psk = NULL;
 }
 
 
@@ -734,7 +1112,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	if (conf == NULL)
 		return;
 
-	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
+	hostapd_config_clear_wpa_psk(&conf->ssid);
 
 	str_clear_free(conf->ssid.wpa_passphrase);
 	os_free(conf->ssid.wpa_psk_file);
@@ -765,7 +1143,13 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	hostapd_config_free_radius_attr(conf->radius_auth_req_attr);
 	hostapd_config_free_radius_attr(conf->radius_acct_req_attr);
 	os_free(conf->radius_req_attr_sqlite);
+	os_free(conf->radius_acct_spool_file);
 	os_free(conf->rsn_preauth_interfaces);
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	os_free(conf->pmksa_cache_file);
+	bin_clear_free(conf->pmksa_cache_file_key,
+		       conf->pmksa_cache_file_key_len);
+#endif /* CONFIG_PMKSA_CACHE_FILE */
 	os_free(conf->ctrl_interface);
 	os_free(conf->ca_cert);
 	os_free(conf->server_cert);
@@ -775,6 +1159,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	os_free(conf->private_key_passwd);
 	os_free(conf->private_key_passwd2);
 	os_free(conf->check_cert_subject);
+	os_free(conf->tls_session_ticket_keys);
 	os_free(conf->ocsp_stapling_response);
 	os_free(conf->ocsp_stapling_response_multi);
 	os_free(conf->dh_file);
@@ -824,7 +1209,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	os_free(conf->ap_pin);
 	os_free(conf->extra_cred);
 	os_free(conf->ap_settings);
-	hostapd_config_clear_wpa_psk(&conf->multi_ap_backhaul_ssid.wpa_psk);
+	hostapd_config_clear_wpa_psk(&conf->multi_ap_backhaul_ssid);
 	str_clear_free(conf->multi_ap_backhaul_ssid.wpa_passphrase);
 	os_free(conf->upnp_iface);
 	os_free(conf->friendly_name);
@@ -1065,6 +1450,72 @@ const char * hostapd_get_vlan_id_ifname(struct hostapd_vlan *vlan, int vlan_id)
 }
 
 
+static const struct hostapd_wpa_psk *
+hostapd_psk_index_entry(struct hash_node *node, int p2p)
+{
+	if (p2p)
+		return hash_table_entry(node, struct hostapd_wpa_psk, p2p_node);
+	return hash_table_entry(node, struct hostapd_wpa_psk, addr_node);
+}
+
+
+static const struct hostapd_wpa_psk *
+hostapd_get_psk_indexed(const struct hostapd_psk_index *idx, const u8 *addr,
+			const u8 *p2p_dev_addr, const u8 *prev_psk)
+{
+	const struct hash_table *tbl = addr ? &idx->addr : &idx->p2p_dev_addr;
+	const u8 *key = addr ? addr : p2p_dev_addr;
+	const struct hostapd_wpa_psk *psk, *best = NULL;
+	struct hash_node *first, *node;
+	size_t i, start, end, mid;
+	int prev_order = 0, have_prev = prev_psk == NULL;
+
+	/*
+	 * The candidates are the group PSKs and the PSKs for this station.
+	 * Return the first one in list order after prev_psk.
+	 */
+	first = key ? hash_table_get(tbl, key, ETH_ALEN) : NULL;
+	for (i = 0; !have_prev && i < idx->num_group; i++) {
+		if (idx->group[i]->psk == prev_psk) {
+			prev_order = idx->group[i]->order;
+			have_prev = 1;
+		}
+	}
+	for (node = first; !have_prev && node;
+	     node = hash_table_get_next(tbl, node)) {
+		psk = hostapd_psk_index_entry(node, !addr);
+		if (psk->psk == prev_psk) {
+			prev_order = psk->order;
+			have_prev = 1;
+		}
+	}
+	if (!have_prev)
+		return NULL; /* prev_psk is not from this list */
+
+	for (node = first; node; node = hash_table_get_next(tbl, node)) {
+		psk = hostapd_psk_index_entry(node, !addr);
+		if ((!prev_psk || psk->order > prev_order) &&
+		    (!best || psk->order < best->order))
+			best = psk;
+	}
+
+	start = 0;
+	end = idx->num_group;
+	while (prev_psk && start < end) {
+		mid = start + (end - start) / 2;
+		if (idx->group[mid]->order <= prev_order)
+			start = mid + 1;
+		else
+			end = mid;
+	}
+	if (start < idx->num_group &&
+	    (!best || idx->group[start]->order < best->order))
+		best = idx->group[start];
+
+	return best;
+}
+
+
 const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *p2p_dev_addr,
 			   const u8 *prev_psk, int *vlan_id)
@@ -1086,6 +1537,16 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   MAC2STR(addr), prev_psk);
 	}
 
+	if (conf->ssid.psk_index.valid) {
+		const struct hostapd_wpa_psk *found;
+
+		found = hostapd_get_psk_indexed(&conf->ssid.psk_index, addr,
+						p2p_dev_addr, prev_psk);
+		if (found && vlan_id)
+			*vlan_id = found->vlan_id;
+		return found ? found->psk : NULL;
+	}
+
 	for (psk = conf->ssid.wpa_psk; psk != NULL; psk = psk->next) {
 		if (next_ok &&
 		    (psk->group ||
@@ -1106,6 +1567,24 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 }
 
 
+static int hostapd_config_check_radius_tls(struct hostapd_radius_server *servers,
+					   int num_servers, const char *name)
+{
+	int i;
+
+	for (i = 0; i < num_servers; i++) {
+		if (servers[i].tls && !servers[i].ca_cert) {
+			wpa_printf(MSG_ERROR,
+				   "RADIUS/TLS %s server requires %s_server_ca_cert",
+				   name, name);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
 static int hostapd_config_check_bss(struct hostapd_bss_config *bss,
 				    struct hostapd_config *conf,
 				    int full_config)
@@ -1117,6 +1596,14 @@ static int hostapd_config_check_bss(struct hostapd_bss_config *bss,
 		return -1;
 	}
 
+	if (hostapd_config_check_radius_tls(bss->radius->auth_servers,
+					    bss->radius->num_auth_servers,
+					    "auth") ||
+	    hostapd_config_check_radius_tls(bss->radius->acct_servers,
+					    bss->radius->num_acct_servers,
+					    "acct"))
+		return -1;
+
 #ifdef CONFIG_WEP
 	if (bss->wpa) {
 		int wep, i;
@@ -1155,6 +1642,15 @@ static int hostapd_config_check_bss(struct hostapd_bss_config *bss,
 		return -1;
 	}
 
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	if (full_config && bss->pmksa_cache_file &&
+	    !bss->pmksa_cache_file_key) {
+		wpa_printf(MSG_ERROR,
+			   "pmksa_cache_file requires pmksa_cache_file_key");
+		return -1;
+	}
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
 	if (full_config && !is_zero_ether_addr(bss->bssid)) {
 		size_t i;
 
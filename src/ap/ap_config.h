@@ -11,6 +11,7 @@
 
 #include "common/defs.h"
 #include "utils/list.h"
+#include "utils/hash_table.h"
 #include "ip_addr.h"
 #include "common/wpa_common.h"
 #include "common/ieee802_11_defs.h"
@@ -89,6 +90,30 @@ typedef enum hostap_security_policy {
 	SECURITY_OSEN = 5
 } secpolicy;
 
+/**
+ * struct hostapd_psk_index - Lookup index for struct hostapd_ssid::wpa_psk
+ * @addr: Per-station PSKs indexed by the STA MAC address
+ * @p2p_dev_addr: Per-device PSKs indexed by the P2P Device Address
+ * @group: Group PSKs (not bound to any address) sorted in list order
+ * @num_group: Number of entries in @group
+ * @valid: Whether the index covers all entries in the wpa_psk list
+ *
+ * hostapd_get_psk() uses this to find the PSK candidates for a station
+ * without going through the full wpa_psk list that can have tens of thousands
+ * of entries when a per-device wpa_psk_file is used. The index is built by
+ * hostapd_setup_wpa_psk() and maintained by hostapd_wpa_psk_add(),
+ * hostapd_wpa_psk_del(), and hostapd_reload_wpa_psk(). Any other modification
+ * of the wpa_psk list must be done only after hostapd_config_clear_wpa_psk()
+ * has invalidated the index.
+ */
+struct hostapd_psk_index {
+	struct hash_table addr;
+	struct hash_table p2p_dev_addr;
+	struct hostapd_wpa_psk **group;
+	size_t num_group;
+	unsigned int valid:1;
+};
+
 struct hostapd_ssid {
 	u8 ssid[SSID_MAX_LEN];
 	size_t ssid_len;
@@ -102,6 +127,7 @@ struct hostapd_ssid {
 	secpolicy security_policy;
 
 	struct hostapd_wpa_psk *wpa_psk;
+	struct hostapd_psk_index psk_index;
 	char *wpa_passphrase;
 	char *wpa_psk_file;
 	struct sae_pt *pt;
@@ -163,6 +189,15 @@ struct hostapd_wpa_psk {
 	u8 addr[ETH_ALEN];
 	u8 p2p_dev_addr[ETH_ALEN];
 	int vlan_id;
+
+	/* Internal data for struct hostapd_psk_index */
+	struct hash_node addr_node;
+	struct hash_node p2p_node;
+	int order; /* position in the list; increasing towards the tail */
+	unsigned int from_file:1;
+	unsigned int reload_keep:1;
+	u8 src_hash[SHA256_MAC_LEN]; /* hash of the PSK/passphrase in file and
+				      * the SSID */
 };
 
 struct hostapd_eap_user {
@@ -312,6 +347,9 @@ struct hostapd_bss_config {
 	struct hostapd_radius_attr *radius_auth_req_attr;
 	struct hostapd_radius_attr *radius_acct_req_attr;
 	char *radius_req_attr_sqlite;
+	char *radius_acct_spool_file;
+	unsigned int radius_acct_spool_rate;
+	unsigned int radius_acct_spool_max_size; /* in kB; 0 = no limit */
 	int radius_das_port;
 	unsigned int radius_das_time_window;
 	int radius_das_require_event_timestamp;
@@ -342,6 +380,8 @@ struct hostapd_bss_config {
 		DENY_UNLESS_ACCEPTED = 1,
 		USE_EXTERNAL_RADIUS_AUTH = 2
 	} macaddr_acl;
+	unsigned int radius_acl_cache_size;
+	unsigned int radius_acl_reject_timeout;
 	struct mac_acl_entry *accept_mac;
 	int num_accept_mac;
 	struct mac_acl_entry *deny_mac;
@@ -383,6 +423,7 @@ struct hostapd_bss_config {
 	u32 wpa_group_update_count;
 	u32 wpa_pairwise_update_count;
 	int wpa_disable_eapol_key_retries;
+	unsigned int wpa_psk_trial_threads;
 	int rsn_pairwise;
 	int rsn_preauth;
 	char *rsn_preauth_interfaces;
@@ -423,6 +464,8 @@ struct hostapd_bss_config {
 	int check_crl_strict;
 	unsigned int crl_reload_interval;
 	unsigned int tls_session_lifetime;
+	char *tls_session_ticket_keys;
+	unsigned int tls_private_key_threads;
 	unsigned int tls_flags;
 	unsigned int max_auth_rounds;
 	unsigned int max_auth_rounds_short;
@@ -452,6 +495,10 @@ struct hostapd_bss_config {
 	int radius_server_auth_port;
 	int radius_server_acct_port;
 	int radius_server_ipv6;
+	int radius_server_tls_port;
+	int radius_server_tls_verify_client;
+	int radius_server_workers;
+	int radius_server_max_sessions;
 
 	int use_pae_group_addr; /* Whether to send EAPOL frames to PAE group
 				 * address instead of individual address
@@ -478,6 +525,11 @@ struct hostapd_bss_config {
 
 	int disable_pmksa_caching;
 	int okc; /* Opportunistic Key Caching */
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	char *pmksa_cache_file;
+	u8 *pmksa_cache_file_key;
+	size_t pmksa_cache_file_key_len;
+#endif /* CONFIG_PMKSA_CACHE_FILE */
 
 	int wps_state;
 #ifdef CONFIG_WPS
@@ -664,6 +716,8 @@ struct hostapd_bss_config {
 
 	unsigned int sae_anti_clogging_threshold;
 	unsigned int sae_sync;
+	unsigned int sae_commit_queue_len;
+	unsigned int sae_commit_threads;
 	int sae_require_mfp;
 	int sae_confirm_immediate;
 	int sae_pwe;
@@ -1118,7 +1172,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss);
 void hostapd_config_free_radius_attr(struct hostapd_radius_attr *attr);
 void hostapd_config_free_eap_user(struct hostapd_eap_user *user);
 void hostapd_config_free_eap_users(struct hostapd_eap_user *user);
-void hostapd_config_clear_wpa_psk(struct hostapd_wpa_psk **p);
+void hostapd_config_clear_wpa_psk(struct hostapd_ssid *ssid);
 void hostapd_config_free_bss(struct hostapd_bss_config *conf);
 void hostapd_config_free(struct hostapd_config *conf);
 int hostapd_maclist_found(struct mac_acl_entry *list, int num_entries,
@@ -1128,6 +1182,11 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *p2p_dev_addr,
 			   const u8 *prev_psk, int *vlan_id);
 int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf);
+int hostapd_wpa_psk_add(struct hostapd_ssid *ssid,
+			struct hostapd_wpa_psk *psk);
+void hostapd_wpa_psk_del(struct hostapd_ssid *ssid,
+			 struct hostapd_wpa_psk *psk);
+int hostapd_reload_wpa_psk(struct hostapd_bss_config *conf);
 int hostapd_vlan_valid(struct hostapd_vlan *vlan,
 		       struct vlan_description *vlan_desc);
 const char * hostapd_get_vlan_id_ifname(struct hostapd_vlan *vlan,
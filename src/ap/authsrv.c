@@ -9,6 +9,7 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "common/wpa_ctrl.h"
 #include "crypto/tls.h"
 #include "eap_server/eap.h"
 #include "eap_server/eap_sim_db.h"
@@ -24,10 +25,12 @@
 #define EAP_SIM_DB
 #endif /* EAP_SERVER_SIM || EAP_SERVER_AKA */
 
+#define AUTHSRV_MAX_TICKET_KEYS 4
 
-#ifdef EAP_SIM_DB
-static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
-				 struct sta_info *sta, void *ctx)
+
+#if defined(EAP_SIM_DB) || defined(EAP_TLS_FUNCS)
+static int hostapd_eap_pending_cb_sta(struct hostapd_data *hapd,
+				      struct sta_info *sta, void *ctx)
 {
 	if (eapol_auth_eap_pending_cb(sta->eapol_sm, ctx) == 0)
 		return 1;
@@ -35,18 +38,36 @@ static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
 }
 
 
-static void hostapd_sim_db_cb(void *ctx, void *session_ctx)
+/* Continue processing of an EAP session that has completed pending work */
+static void hostapd_eap_pending_cb(struct hostapd_data *hapd,
+				   void *session_ctx)
 {
-	struct hostapd_data *hapd = ctx;
-	if (ap_for_each_sta(hapd, hostapd_sim_db_cb_sta, session_ctx) == 0) {
+	if (ap_for_each_sta(hapd, hostapd_eap_pending_cb_sta,
+			    session_ctx) == 0) {
 #ifdef RADIUS_SERVER
 		radius_server_eap_pending_cb(hapd->radius_srv, session_ctx);
 #endif /* RADIUS_SERVER */
 	}
 }
+#endif /* EAP_SIM_DB || EAP_TLS_FUNCS */
+
+
+#ifdef EAP_SIM_DB
+static void hostapd_sim_db_cb(void *ctx, void *session_ctx)
+{
+	hostapd_eap_pending_cb(ctx, session_ctx);
+}
 #endif /* EAP_SIM_DB */
 
 
+#ifdef EAP_TLS_FUNCS
+static void hostapd_tls_async_cb(void *ctx, void *conn_ctx)
+{
+	hostapd_eap_pending_cb(ctx, conn_ctx);
+}
+#endif /* EAP_TLS_FUNCS */
+
+
 #ifdef RADIUS_SERVER
 
 static int hostapd_radius_get_eap_user(void *ctx, const u8 *identity,
@@ -101,6 +122,24 @@ out:
 }
 
 
+#ifdef EAP_TLS_FUNCS
+static int authsrv_set_ticket_keys(struct hostapd_data *hapd, u8 *keys,
+				   size_t num_keys);
+
+/* Key ring passed from the main process to a RADIUS server worker */
+static int hostapd_radius_set_ticket_keys(void *ctx, const u8 *keys,
+					  size_t num_keys)
+{
+	u8 *copy;
+
+	copy = os_memdup(keys, num_keys * TLS_SESSION_TICKET_KEY_LEN);
+	if (!copy)
+		return -1;
+	return authsrv_set_ticket_keys(ctx, copy, num_keys);
+}
+#endif /* EAP_TLS_FUNCS */
+
+
 static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 {
 	struct radius_server_conf srv;
@@ -111,7 +150,14 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 	srv.acct_port = conf->radius_server_acct_port;
 	srv.conf_ctx = hapd;
 	srv.ipv6 = conf->radius_server_ipv6;
+	srv.tls_port = conf->radius_server_tls_port;
+	srv.tls_verify_client = conf->radius_server_tls_verify_client;
+	srv.workers = conf->radius_server_workers;
+	srv.max_sessions = conf->radius_server_max_sessions;
 	srv.get_eap_user = hostapd_radius_get_eap_user;
+#ifdef EAP_TLS_FUNCS
+	srv.set_ticket_keys = hostapd_radius_set_ticket_keys;
+#endif /* EAP_TLS_FUNCS */
 	srv.eap_req_id_text = conf->eap_req_id_text;
 	srv.eap_req_id_text_len = conf->eap_req_id_text_len;
 	srv.sqlite_file = conf->eap_user_sqlite;
@@ -143,6 +189,8 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 static void authsrv_tls_event(void *ctx, enum tls_event ev,
 			      union tls_event_data *data)
 {
+	struct hostapd_data *hapd = ctx;
+
 	switch (ev) {
 	case TLS_CERT_CHAIN_SUCCESS:
 		wpa_printf(MSG_DEBUG, "authsrv: remote certificate verification success");
@@ -168,11 +216,174 @@ static void authsrv_tls_event(void *ctx, enum tls_event ev,
 			wpa_printf(MSG_DEBUG, "authsrv: remote TLS alert: %s",
 				   data->alert.description);
 		break;
+	case TLS_OCSP_STAPLING_REFRESH:
+		wpa_msg(hapd->msg_ctx, MSG_INFO, OCSP_STAPLING_REFRESH
+			"file=%s valid=%d",
+			data->ocsp_refresh.file, data->ocsp_refresh.valid);
+		break;
+	}
+}
+
+
+/* Take the key ring into use; keys is freed on failure */
+static int authsrv_set_ticket_keys(struct hostapd_data *hapd, u8 *keys,
+				   size_t num_keys)
+{
+	if (tls_global_set_session_ticket_keys(hapd->ssl_ctx, keys,
+					       num_keys) < 0) {
+		bin_clear_free(keys, num_keys * TLS_SESSION_TICKET_KEY_LEN);
+		return -1;
+	}
+
+	bin_clear_free(hapd->tls_ticket_keys,
+		       hapd->num_tls_ticket_keys * TLS_SESSION_TICKET_KEY_LEN);
+	hapd->tls_ticket_keys = keys;
+	hapd->num_tls_ticket_keys = num_keys;
+	if (hapd->eap_cfg)
+		hapd->eap_cfg->tls_session_tickets = num_keys > 0;
+#ifdef RADIUS_SERVER
+	if (radius_server_set_ticket_keys(hapd->radius_srv, keys,
+					  num_keys) < 0)
+		wpa_printf(MSG_INFO,
+			   "Failed to pass TLS session ticket keys to all RADIUS server workers");
+#endif /* RADIUS_SERVER */
+	return 0;
+}
+
+
+static u8 * authsrv_read_ticket_keys(const char *fname, size_t *num_keys)
+{
+	char *buf, *pos, *end, *line;
+	size_t len;
+	u8 *keys;
+	int line_num = 0;
+
+	*num_keys = 0;
+	buf = os_readfile(fname, &len);
+	if (!buf) {
+		wpa_printf(MSG_ERROR, "Could not read TLS session ticket keys from '%s'",
+			   fname);
+		return NULL;
+	}
+
+	keys = os_malloc(AUTHSRV_MAX_TICKET_KEYS * TLS_SESSION_TICKET_KEY_LEN);
+	if (!keys) {
+		bin_clear_free(buf, len);
+		return NULL;
+	}
+
+	pos = buf;
+	end = buf + len;
+	while (pos < end) {
+		line = pos;
+		while (pos < end && *pos != '\n')
+			pos++;
+		len = pos - line;
+		pos++;
+		line_num++;
+
+		while (len > 0 && isspace((unsigned char) line[len - 1]))
+			len--;
+		if (len == 0 || line[0] == '#')
+			continue;
+
+		if (len != 2 * TLS_SESSION_TICKET_KEY_LEN ||
+		    *num_keys == AUTHSRV_MAX_TICKET_KEYS ||
+		    hexstr2bin(line, &keys[*num_keys *
+					   TLS_SESSION_TICKET_KEY_LEN],
+			       TLS_SESSION_TICKET_KEY_LEN) < 0) {
+			wpa_printf(MSG_ERROR,
+				   "%s:%d: Invalid TLS session ticket key (at most %d keys of %d hex digits each)",
+				   fname, line_num, AUTHSRV_MAX_TICKET_KEYS,
+				   2 * TLS_SESSION_TICKET_KEY_LEN);
+			bin_clear_free(keys, AUTHSRV_MAX_TICKET_KEYS *
+				       TLS_SESSION_TICKET_KEY_LEN);
+			bin_clear_free(buf, end - buf);
+			*num_keys = 0;
+			return NULL;
+		}
+		(*num_keys)++;
+	}
+
+	bin_clear_free(buf, end - buf);
+	if (*num_keys == 0) {
+		wpa_printf(MSG_ERROR, "No TLS session ticket keys in '%s'",
+			   fname);
+		os_free(keys);
+		return NULL;
 	}
+
+	return keys;
 }
+
 #endif /* EAP_TLS_FUNCS */
 
 
+/**
+ * authsrv_reload_ticket_keys - Reload TLS session ticket keys
+ * @hapd: Pointer to BSS data
+ * Returns: 0 on success, -1 on failure
+ *
+ * The keys are read from the tls_session_ticket_keys file. The current keys
+ * remain in use if the file cannot be read.
+ */
+int authsrv_reload_ticket_keys(struct hostapd_data *hapd)
+{
+#ifdef EAP_TLS_FUNCS
+	u8 *keys;
+	size_t num_keys;
+
+	if (!hapd->ssl_ctx || !hapd->conf->tls_session_ticket_keys ||
+	    !hapd->conf->tls_session_lifetime)
+		return -1;
+
+	keys = authsrv_read_ticket_keys(hapd->conf->tls_session_ticket_keys,
+					&num_keys);
+	if (!keys)
+		return -1;
+	return authsrv_set_ticket_keys(hapd, keys, num_keys);
+#else /* EAP_TLS_FUNCS */
+	return -1;
+#endif /* EAP_TLS_FUNCS */
+}
+
+
+/**
+ * authsrv_add_ticket_key - Add a new current TLS session ticket key
+ * @hapd: Pointer to BSS data
+ * @key: TLS_SESSION_TICKET_KEY_LEN octet key
+ * Returns: 0 on success, -1 on failure
+ *
+ * The previous keys are still accepted for existing tickets. The oldest key is
+ * dropped once the key ring is full.
+ */
+int authsrv_add_ticket_key(struct hostapd_data *hapd, const u8 *key)
+{
+#ifdef EAP_TLS_FUNCS
+	u8 *keys;
+	size_t num_keys;
+
+	if (!hapd->ssl_ctx || !hapd->conf->tls_session_lifetime)
+		return -1;
+
+	num_keys = hapd->num_tls_ticket_keys + 1;
+	if (num_keys > AUTHSRV_MAX_TICKET_KEYS)
+		num_keys = AUTHSRV_MAX_TICKET_KEYS;
+	keys = os_malloc(num_keys * TLS_SESSION_TICKET_KEY_LEN);
+	if (!keys)
+		return -1;
+	os_memcpy(keys, key, TLS_SESSION_TICKET_KEY_LEN);
+	if (num_keys > 1)
+		os_memcpy(&keys[TLS_SESSION_TICKET_KEY_LEN],
+			  hapd->tls_ticket_keys,
+			  (num_keys - 1) * TLS_SESSION_TICKET_KEY_LEN);
+	return authsrv_set_ticket_keys(hapd, keys, num_keys);
+#else /* EAP_TLS_FUNCS */
+	return -1;
+#endif /* EAP_TLS_FUNCS */
+}
+
+
 static struct eap_config * authsrv_eap_config(struct hostapd_data *hapd)
 {
 	struct eap_config *cfg;
@@ -187,6 +398,7 @@ static struct eap_config * authsrv_eap_config(struct hostapd_data *hapd)
 	cfg->eap_sim_db_priv = hapd->eap_sim_db_priv;
 	cfg->tls_session_lifetime = hapd->conf->tls_session_lifetime;
 	cfg->tls_flags = hapd->conf->tls_flags;
+	cfg->tls_session_tickets = hapd->num_tls_ticket_keys > 0;
 	cfg->max_auth_rounds = hapd->conf->max_auth_rounds;
 	cfg->max_auth_rounds_short = hapd->conf->max_auth_rounds_short;
 	if (hapd->conf->pac_opaque_encr_key)
@@ -250,7 +462,9 @@ int authsrv_init(struct hostapd_data *hapd)
 				   "Enabled CRL reload functionality");
 		}
 		conf.tls_flags = hapd->conf->tls_flags;
+		conf.private_key_threads = hapd->conf->tls_private_key_threads;
 		conf.event_cb = authsrv_tls_event;
+		conf.async_cb = hostapd_tls_async_cb;
 		conf.cb_ctx = hapd;
 		hapd->ssl_ctx = tls_init(&conf);
 		if (hapd->ssl_ctx == NULL) {
@@ -289,6 +503,18 @@ int authsrv_init(struct hostapd_data *hapd)
 			authsrv_deinit(hapd);
 			return -1;
 		}
+
+		if (hapd->conf->tls_session_ticket_keys &&
+		    !hapd->conf->tls_session_lifetime) {
+			wpa_printf(MSG_INFO,
+				   "Cannot enable TLS session tickets - they depend on tls_session_lifetime being set");
+		} else if (hapd->conf->tls_session_ticket_keys &&
+			   authsrv_reload_ticket_keys(hapd) < 0) {
+			wpa_printf(MSG_ERROR,
+				   "Failed to set TLS session ticket keys");
+			authsrv_deinit(hapd);
+			return -1;
+		}
 	}
 #endif /* EAP_TLS_FUNCS */
 
@@ -337,6 +563,10 @@ void authsrv_deinit(struct hostapd_data *hapd)
 		tls_deinit(hapd->ssl_ctx);
 		hapd->ssl_ctx = NULL;
 	}
+	bin_clear_free(hapd->tls_ticket_keys,
+		       hapd->num_tls_ticket_keys * TLS_SESSION_TICKET_KEY_LEN);
+	hapd->tls_ticket_keys = NULL;
+	hapd->num_tls_ticket_keys = 0;
 #endif /* EAP_TLS_FUNCS */
 
 #ifdef EAP_SIM_DB
@@ -11,5 +11,7 @@
 
 int authsrv_init(struct hostapd_data *hapd);
 void authsrv_deinit(struct hostapd_data *hapd);
+int authsrv_reload_ticket_keys(struct hostapd_data *hapd);
+int authsrv_add_ticket_key(struct hostapd_data *hapd, const u8 *key);
 
 #endif /* AUTHSRV_H */
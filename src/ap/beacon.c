@@ -795,6 +795,45 @@ void sta_track_claim_taxonomy_info(struct hostapd_iface *iface, const u8 *addr,
 #endif /* CONFIG_TAXONOMY */
 
 
+/*
+ * Get a Probe Response frame from the cache or build one if the Beacon frame
+ * contents have changed since the previous request. Only the DA and the BSS
+ * Load element change between requests; the CSA countdown is updated by the
+ * driver based on the counter offsets.
+ */
+static u8 * hostapd_get_probe_resp(struct hostapd_data *hapd,
+				   const struct ieee80211_mgmt *req,
+				   int is_p2p, size_t *resp_len)
+{
+	struct hostapd_probe_resp_cache *cache;
+	struct ieee80211_mgmt *resp;
+	const u8 *bss_load;
+	size_t hdr_len;
+
+	cache = &hapd->probe_resp_cache[!!is_p2p];
+	if (!cache->frame) {
+		cache->frame = hostapd_gen_probe_resp(hapd, NULL, is_p2p,
+						      &cache->len);
+		if (!cache->frame)
+			return NULL;
+		resp = (struct ieee80211_mgmt *) cache->frame;
+		hdr_len = resp->u.probe_resp.variable - cache->frame;
+		bss_load = get_ie(resp->u.probe_resp.variable,
+				  cache->len - hdr_len, WLAN_EID_BSS_LOAD);
+		cache->bss_load_off = bss_load ? bss_load - cache->frame : 0;
+	}
+
+	resp = (struct ieee80211_mgmt *) cache->frame;
+	os_memcpy(resp->da, req->sa, ETH_ALEN);
+	if (cache->bss_load_off)
+		hostapd_eid_bss_load(hapd, cache->frame + cache->bss_load_off,
+				     cache->len - cache->bss_load_off);
+
+	*resp_len = cache->len;
+	return cache->frame;
+}
+
+
 void handle_probe_req(struct hostapd_data *hapd,
 		      const struct ieee80211_mgmt *mgmt, size_t len,
 		      int ssi_signal)
@@ -1031,7 +1070,7 @@ void handle_probe_req(struct hostapd_data *hapd,
 	wpa_msg_ctrl(hapd->msg_ctx, MSG_INFO, RX_PROBE_REQUEST "sa=" MACSTR
 		     " signal=%d", MAC2STR(mgmt->sa), ssi_signal);
 
-	resp = hostapd_gen_probe_resp(hapd, mgmt, elems.p2p != NULL,
+	resp = hostapd_get_probe_resp(hapd, mgmt, elems.p2p != NULL,
 				      &resp_len);
 	if (resp == NULL)
 		return;
@@ -1061,8 +1100,6 @@ void handle_probe_req(struct hostapd_data *hapd,
 	if (ret < 0)
 		wpa_printf(MSG_INFO, "handle_probe_req: send failed");
 
-	os_free(resp);
-
 	wpa_printf(MSG_EXCESSIVE, "STA " MACSTR " sent probe request for %s "
 		   "SSID", MAC2STR(mgmt->sa),
 		   elems.ssid_len == 0 ? "broadcast" : "our");
@@ -1107,6 +1144,26 @@ static u8 * hostapd_probe_resp_offloads(struct hostapd_data *hapd,
 #endif /* NEED_AP_MLME */
 
 
+/**
+ * hostapd_flush_probe_resp_cache - Drop the cached Probe Response frames
+ * @hapd: Pointer to BSS data
+ *
+ * This needs to be called whenever the Beacon frame contents change so that
+ * the following Probe Request frames get a response matching the new
+ * contents.
+ */
+void hostapd_flush_probe_resp_cache(struct hostapd_data *hapd)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(hapd->probe_resp_cache); i++) {
+		os_free(hapd->probe_resp_cache[i].frame);
+		os_memset(&hapd->probe_resp_cache[i], 0,
+			  sizeof(hapd->probe_resp_cache[i]));
+	}
+}
+
+
 void sta_track_del(struct hostapd_sta_info *info)
 {
 #ifdef CONFIG_TAXONOMY
@@ -1460,6 +1517,8 @@ int ieee802_11_set_beacon(struct hostapd_data *hapd)
 	struct wpabuf *beacon, *proberesp, *assocresp;
 	int res, ret = -1;
 
+	hostapd_flush_probe_resp_cache(hapd);
+
 	if (hapd->csa_in_progress) {
 		wpa_printf(MSG_ERROR, "Cannot set beacons during CSA period");
 		return -1;
@@ -17,6 +17,7 @@
 #include "common/ieee802_11_defs.h"
 #include "common/wpa_ctrl.h"
 #include "common/hw_features_common.h"
+#include "crypto/crypto.h"
 #include "radius/radius_client.h"
 #include "radius/radius_das.h"
 #include "eap_server/tncs.h"
@@ -118,7 +119,7 @@ static void hostapd_reload_bss(struct hostapd_data *hapd)
 		 * Force PSK to be derived again since SSID or passphrase may
 		 * have changed.
 		 */
-		hostapd_config_clear_wpa_psk(&hapd->conf->ssid.wpa_psk);
+		hostapd_config_clear_wpa_psk(&hapd->conf->ssid);
 	}
 	if (hostapd_setup_wpa_psk(hapd->conf)) {
 		wpa_printf(MSG_ERROR, "Failed to re-configure WPA PSK "
@@ -357,6 +358,7 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	os_free(hapd->probereq_cb);
 	hapd->probereq_cb = NULL;
 	hapd->num_probereq_cb = 0;
+	hostapd_flush_probe_resp_cache(hapd);
 
 #ifdef CONFIG_P2P
 	wpabuf_free(hapd->p2p_beacon_ie);
@@ -438,6 +440,7 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	fils_hlp_deinit(hapd);
 
 #ifdef CONFIG_SAE
+	auth_sae_jobs_deinit(hapd);
 	{
 		struct hostapd_sae_commit_queue *q;
 
@@ -449,6 +452,8 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 		}
 	}
 	eloop_cancel_timeout(auth_sae_process_commit, hapd, NULL);
+	crypto_mac_deinit(hapd->sae_token_mac);
+	hapd->sae_token_mac = NULL;
 #endif /* CONFIG_SAE */
 }
 
@@ -778,159 +783,207 @@ static int hostapd_das_nas_mismatch(struct hostapd_data *hapd,
 }
 
 
-static struct sta_info * hostapd_das_find_sta(struct hostapd_data *hapd,
-					      struct radius_das_attrs *attr,
-					      int *multi)
-{
-	struct sta_info *selected, *sta;
-	char buf[128];
-	int num_attr = 0;
-	int count;
+/*
+ * Index of the session identification attributes of the associated stations.
+ * This is built when a burst of DAS requests is received so that each request
+ * in the burst does not need to go through the full station list. The entries
+ * refer to the stations by address and the station is looked up and all the
+ * attributes are verified for each match, so the index remains safe to use
+ * even if a request in the same burst removes or modifies a station.
+ */
+struct hostapd_das_index {
+	struct hash_table session_id;
+	struct hash_table multi_session_id;
+	struct hash_table cui;
+	struct hash_table user_name;
+	struct dl_list entries; /* struct hostapd_das_index_entry::list */
+};
+
+struct hostapd_das_index_entry {
+	struct dl_list list;
+	struct hash_node node;
+	u8 addr[ETH_ALEN];
+	/* followed by the key */
+};
 
-	*multi = 0;
+/* Do not bother with the index for bursts smaller than this */
+#define HOSTAPD_DAS_INDEX_MIN_BATCH 2
 
-	for (sta = hapd->sta_list; sta; sta = sta->next)
-		sta->radius_das_match = 1;
 
-	if (attr->sta_addr) {
-		num_attr++;
-		sta = ap_get_sta(hapd, attr->sta_addr);
-		if (!sta) {
-			wpa_printf(MSG_DEBUG,
-				   "RADIUS DAS: No Calling-Station-Id match");
-			return NULL;
-		}
+static void hostapd_das_index_free(struct hostapd_das_index *idx)
+{
+	struct hostapd_das_index_entry *e, *prev;
 
-		selected = sta;
-		for (sta = hapd->sta_list; sta; sta = sta->next) {
-			if (sta != selected)
-				sta->radius_das_match = 0;
-		}
-		wpa_printf(MSG_DEBUG, "RADIUS DAS: Calling-Station-Id match");
+	if (!idx)
+		return;
+	hash_table_deinit(&idx->session_id);
+	hash_table_deinit(&idx->multi_session_id);
+	hash_table_deinit(&idx->cui);
+	hash_table_deinit(&idx->user_name);
+	dl_list_for_each_safe(e, prev, &idx->entries,
+			      struct hostapd_das_index_entry, list) {
+		dl_list_del(&e->list);
+		os_free(e);
 	}
+	os_free(idx);
+}
 
-	if (attr->acct_session_id) {
-		num_attr++;
-		if (attr->acct_session_id_len != 16) {
-			wpa_printf(MSG_DEBUG,
-				   "RADIUS DAS: Acct-Session-Id cannot match");
-			return NULL;
-		}
-		count = 0;
 
-		for (sta = hapd->sta_list; sta; sta = sta->next) {
-			if (!sta->radius_das_match)
-				continue;
-			os_snprintf(buf, sizeof(buf), "%016llX",
-				    (unsigned long long) sta->acct_session_id);
-			if (os_memcmp(attr->acct_session_id, buf, 16) != 0)
-				sta->radius_das_match = 0;
-			else
-				count++;
-		}
+static int hostapd_das_index_add(struct hostapd_das_index *idx,
+				 struct hash_table *tbl, const u8 *addr,
+				 const void *key, size_t key_len)
+{
+	struct hostapd_das_index_entry *e;
 
-		if (count == 0) {
-			wpa_printf(MSG_DEBUG,
-				   "RADIUS DAS: No matches remaining after Acct-Session-Id check");
-			return NULL;
-		}
-		wpa_printf(MSG_DEBUG, "RADIUS DAS: Acct-Session-Id match");
-	}
+	e = os_malloc(sizeof(*e) + key_len);
+	if (!e)
+		return -1;
+	os_memcpy(e->addr, addr, ETH_ALEN);
+	os_memcpy(e + 1, key, key_len);
+	dl_list_add(&idx->entries, &e->list);
+	return hash_table_add(tbl, &e->node, e + 1, key_len);
+}
 
-	if (attr->acct_multi_session_id) {
-		num_attr++;
-		if (attr->acct_multi_session_id_len != 16) {
-			wpa_printf(MSG_DEBUG,
-				   "RADIUS DAS: Acct-Multi-Session-Id cannot match");
-			return NULL;
-		}
-		count = 0;
 
-		for (sta = hapd->sta_list; sta; sta = sta->next) {
-			if (!sta->radius_das_match)
-				continue;
-			if (!sta->eapol_sm ||
-			    !sta->eapol_sm->acct_multi_session_id) {
-				sta->radius_das_match = 0;
-				continue;
-			}
+static struct hostapd_das_index *
+hostapd_das_index_build(struct hostapd_data *hapd)
+{
+	struct hostapd_das_index *idx;
+	struct sta_info *sta;
+	char buf[20];
+	struct wpabuf *cui;
+	u8 *identity;
+	size_t identity_len;
+
+	idx = os_zalloc(sizeof(*idx));
+	if (!idx)
+		return NULL;
+	dl_list_init(&idx->entries);
+
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		os_snprintf(buf, sizeof(buf), "%016llX",
+			    (unsigned long long) sta->acct_session_id);
+		if (hostapd_das_index_add(idx, &idx->session_id, sta->addr,
+					  buf, 16) < 0)
+			goto fail;
+
+		if (sta->eapol_sm && sta->eapol_sm->acct_multi_session_id) {
 			os_snprintf(buf, sizeof(buf), "%016llX",
 				    (unsigned long long)
 				    sta->eapol_sm->acct_multi_session_id);
-			if (os_memcmp(attr->acct_multi_session_id, buf, 16) !=
-			    0)
-				sta->radius_das_match = 0;
-			else
-				count++;
+			if (hostapd_das_index_add(idx, &idx->multi_session_id,
+						  sta->addr, buf, 16) < 0)
+				goto fail;
 		}
 
-		if (count == 0) {
-			wpa_printf(MSG_DEBUG,
-				   "RADIUS DAS: No matches remaining after Acct-Multi-Session-Id check");
-			return NULL;
-		}
-		wpa_printf(MSG_DEBUG,
-			   "RADIUS DAS: Acct-Multi-Session-Id match");
+		cui = ieee802_1x_get_radius_cui(sta->eapol_sm);
+		if (cui &&
+		    hostapd_das_index_add(idx, &idx->cui, sta->addr,
+					  wpabuf_head(cui),
+					  wpabuf_len(cui)) < 0)
+			goto fail;
+
+		identity = ieee802_1x_get_identity(sta->eapol_sm,
+						   &identity_len);
+		if (identity &&
+		    hostapd_das_index_add(idx, &idx->user_name, sta->addr,
+					  identity, identity_len) < 0)
+			goto fail;
 	}
 
-	if (attr->cui) {
-		num_attr++;
-		count = 0;
+	return idx;
+fail:
+	hostapd_das_index_free(idx);
+	return NULL;
+}
 
-		for (sta = hapd->sta_list; sta; sta = sta->next) {
-			struct wpabuf *cui;
 
-			if (!sta->radius_das_match)
-				continue;
-			cui = ieee802_1x_get_radius_cui(sta->eapol_sm);
-			if (!cui || wpabuf_len(cui) != attr->cui_len ||
-			    os_memcmp(wpabuf_head(cui), attr->cui,
-				      attr->cui_len) != 0)
-				sta->radius_das_match = 0;
-			else
-				count++;
-		}
+static void hostapd_das_batch_start(void *ctx, size_t num)
+{
+	struct hostapd_data *hapd = ctx;
 
-		if (count == 0) {
-			wpa_printf(MSG_DEBUG,
-				   "RADIUS DAS: No matches remaining after Chargeable-User-Identity check");
-			return NULL;
-		}
+	hostapd_das_index_free(hapd->das_index);
+	hapd->das_index = NULL;
+	if (num < HOSTAPD_DAS_INDEX_MIN_BATCH || !hapd->sta_list)
+		return;
+
+	hapd->das_index = hostapd_das_index_build(hapd);
+	if (!hapd->das_index)
 		wpa_printf(MSG_DEBUG,
-			   "RADIUS DAS: Chargeable-User-Identity match");
+			   "RADIUS DAS: Could not build station index - use linear search");
+}
+
+
+static void hostapd_das_batch_end(void *ctx)
+{
+	struct hostapd_data *hapd = ctx;
+
+	hostapd_das_index_free(hapd->das_index);
+	hapd->das_index = NULL;
+}
+
+
+static int hostapd_das_sta_match(struct sta_info *sta,
+				 struct radius_das_attrs *attr)
+{
+	char buf[20];
+
+	if (attr->acct_session_id) {
+		os_snprintf(buf, sizeof(buf), "%016llX",
+			    (unsigned long long) sta->acct_session_id);
+		if (os_memcmp(attr->acct_session_id, buf, 16) != 0)
+			return 0;
 	}
 
-	if (attr->user_name) {
-		num_attr++;
-		count = 0;
+	if (attr->acct_multi_session_id) {
+		if (!sta->eapol_sm || !sta->eapol_sm->acct_multi_session_id)
+			return 0;
+		os_snprintf(buf, sizeof(buf), "%016llX",
+			    (unsigned long long)
+			    sta->eapol_sm->acct_multi_session_id);
+		if (os_memcmp(attr->acct_multi_session_id, buf, 16) != 0)
+			return 0;
+	}
 
-		for (sta = hapd->sta_list; sta; sta = sta->next) {
-			u8 *identity;
-			size_t identity_len;
+	if (attr->cui) {
+		struct wpabuf *cui;
 
-			if (!sta->radius_das_match)
-				continue;
-			identity = ieee802_1x_get_identity(sta->eapol_sm,
-							   &identity_len);
-			if (!identity ||
-			    identity_len != attr->user_name_len ||
-			    os_memcmp(identity, attr->user_name, identity_len)
-			    != 0)
-				sta->radius_das_match = 0;
-			else
-				count++;
-		}
-
-		if (count == 0) {
-			wpa_printf(MSG_DEBUG,
-				   "RADIUS DAS: No matches remaining after User-Name check");
-			return NULL;
-		}
-		wpa_printf(MSG_DEBUG,
-			   "RADIUS DAS: User-Name match");
+		cui = ieee802_1x_get_radius_cui(sta->eapol_sm);
+		if (!cui || wpabuf_len(cui) != attr->cui_len ||
+		    os_memcmp(wpabuf_head(cui), attr->cui, attr->cui_len) != 0)
+			return 0;
+	}
+
+	if (attr->user_name) {
+		u8 *identity;
+		size_t identity_len;
+
+		identity = ieee802_1x_get_identity(sta->eapol_sm,
+						   &identity_len);
+		if (!identity || identity_len != attr->user_name_len ||
+		    os_memcmp(identity, attr->user_name, identity_len) != 0)
+			return 0;
 	}
 
-	if (num_attr == 0) {
+	return 1;
+}
+
+
+static struct sta_info * hostapd_das_find_sta(struct hostapd_data *hapd,
+					      struct radius_das_attrs *attr,
+					      int *multi)
+{
+	struct hostapd_das_index *idx = hapd->das_index;
+	struct hash_table *tbl = NULL;
+	struct hash_node *node;
+	const u8 *key = NULL;
+	size_t key_len = 0;
+	struct sta_info *selected = NULL, *sta;
+
+	*multi = 0;
+
+	if (!attr->sta_addr && !attr->acct_session_id &&
+	    !attr->acct_multi_session_id && !attr->cui && !attr->user_name) {
 		/*
 		 * In theory, we could match all current associations, but it
 		 * seems safer to just reject requests that do not include any
@@ -941,9 +994,75 @@ static struct sta_info * hostapd_das_find_sta(struct hostapd_data *hapd,
 		return NULL;
 	}
 
-	selected = NULL;
-	for (sta = hapd->sta_list; sta; sta = sta->next) {
-		if (sta->radius_das_match) {
+	if (attr->acct_session_id && attr->acct_session_id_len != 16) {
+		wpa_printf(MSG_DEBUG,
+			   "RADIUS DAS: Acct-Session-Id cannot match");
+		return NULL;
+	}
+
+	if (attr->acct_multi_session_id &&
+	    attr->acct_multi_session_id_len != 16) {
+		wpa_printf(MSG_DEBUG,
+			   "RADIUS DAS: Acct-Multi-Session-Id cannot match");
+		return NULL;
+	}
+
+	if (attr->sta_addr) {
+		sta = ap_get_sta(hapd, attr->sta_addr);
+		if (!sta) {
+			wpa_printf(MSG_DEBUG,
+				   "RADIUS DAS: No Calling-Station-Id match");
+			return NULL;
+		}
+		if (!hostapd_das_sta_match(sta, attr)) {
+			wpa_printf(MSG_DEBUG,
+				   "RADIUS DAS: Calling-Station-Id match, but session attributes do not match");
+			return NULL;
+		}
+		return sta;
+	}
+
+	if (idx) {
+		if (attr->acct_session_id) {
+			tbl = &idx->session_id;
+			key = attr->acct_session_id;
+			key_len = 16;
+		} else if (attr->acct_multi_session_id) {
+			tbl = &idx->multi_session_id;
+			key = attr->acct_multi_session_id;
+			key_len = 16;
+		} else if (attr->cui) {
+			tbl = &idx->cui;
+			key = attr->cui;
+			key_len = attr->cui_len;
+		} else {
+			tbl = &idx->user_name;
+			key = attr->user_name;
+			key_len = attr->user_name_len;
+		}
+	}
+
+	if (tbl) {
+		struct hostapd_das_index_entry *e;
+
+		for (node = hash_table_get(tbl, key, key_len); node;
+		     node = hash_table_get_next(tbl, node)) {
+			e = hash_table_entry(node,
+					     struct hostapd_das_index_entry,
+					     node);
+			sta = ap_get_sta(hapd, e->addr);
+			if (!sta || !hostapd_das_sta_match(sta, attr))
+				continue;
+			if (selected) {
+				*multi = 1;
+				return NULL;
+			}
+			selected = sta;
+		}
+	} else {
+		for (sta = hapd->sta_list; sta; sta = sta->next) {
+			if (!hostapd_das_sta_match(sta, attr))
+				continue;
 			if (selected) {
 				*multi = 1;
 				return NULL;
@@ -952,6 +1071,9 @@ static struct sta_info * hostapd_das_find_sta(struct hostapd_data *hapd,
 		}
 	}
 
+	if (!selected)
+		wpa_printf(MSG_DEBUG,
+			   "RADIUS DAS: No matches for the session identification attributes");
 	return selected;
 }
 
@@ -1282,6 +1404,8 @@ static int hostapd_setup_bss(struct hostapd_data *hapd, int first)
 		das_conf.ctx = hapd;
 		das_conf.disconnect = hostapd_das_disconnect;
 		das_conf.coa = hostapd_das_coa;
+		das_conf.batch_start = hostapd_das_batch_start;
+		das_conf.batch_end = hostapd_das_batch_end;
 		hapd->radius_das = radius_das_init(&das_conf);
 		if (hapd->radius_das == NULL) {
 			wpa_printf(MSG_ERROR, "RADIUS DAS initialization "
@@ -2310,6 +2434,8 @@ hostapd_alloc_bss_data(struct hostapd_iface *hapd_iface,
 	hapd->ctrl_sock = -1;
 	dl_list_init(&hapd->ctrl_dst);
 	dl_list_init(&hapd->nr_db);
+	dl_list_init(&hapd->acl_cache);
+	dl_list_init(&hapd->acl_queries);
 	hapd->dhcp_sock = -1;
 #ifdef CONFIG_IEEE80211R_AP
 	dl_list_init(&hapd->l2_queue);
@@ -2317,6 +2443,7 @@ hostapd_alloc_bss_data(struct hostapd_iface *hapd_iface,
 #endif /* CONFIG_IEEE80211R_AP */
 #ifdef CONFIG_SAE
 	dl_list_init(&hapd->sae_commit_queue);
+	dl_list_init(&hapd->sae_jobs);
 #endif /* CONFIG_SAE */
 
 	return hapd;
@@ -3481,6 +3608,7 @@ static int hostapd_fill_csa_settings(struct hostapd_data *hapd,
 	hapd->cs_freq_params = settings->freq_params;
 	hapd->cs_count = settings->cs_count;
 	hapd->cs_block_tx = settings->block_tx;
+	hostapd_flush_probe_resp_cache(hapd);
 
 	ret = hostapd_build_beacon_data(hapd, &settings->beacon_csa);
 	if (ret) {
@@ -3507,6 +3635,7 @@ void hostapd_cleanup_cs_params(struct hostapd_data *hapd)
 	hapd->csa_in_progress = 0;
 	hapd->cs_c_off_ecsa_beacon = 0;
 	hapd->cs_c_off_ecsa_proberesp = 0;
+	hostapd_flush_probe_resp_cache(hapd);
 }
 
 
@@ -15,6 +15,7 @@
 
 #include "common/defs.h"
 #include "utils/list.h"
+#include "utils/hash_table.h"
 #include "ap_config.h"
 #include "drivers/driver.h"
 
@@ -32,6 +33,10 @@ struct hostapd_data;
 struct sta_info;
 struct ieee80211_ht_capabilities;
 struct full_dynamic_vlan;
+struct accounting_spool;
+struct hostapd_das_index;
+struct radius_msg;
+struct worker_pool;
 enum wps_event;
 union wps_event_data;
 #ifdef CONFIG_MESH
@@ -147,6 +152,25 @@ struct hostapd_sae_commit_queue {
 	u8 msg[];
 };
 
+/**
+ * struct hostapd_sae_job - SAE commit message processing in a worker thread
+ */
+struct hostapd_sae_job {
+	struct dl_list list;
+	struct hostapd_data *hapd;
+	struct sta_info *sta; /* NULL if the STA entry was freed */
+	struct sae_data *sae;
+	u8 own_addr[ETH_ALEN];
+	u8 peer_addr[ETH_ALEN];
+	u8 bssid[ETH_ALEN];
+	u16 status_code;
+	char *password; /* NULL if PWE does not need to be derived */
+	const char *rx_id;
+	int prepare_res;
+	int process_res;
+	int cancel;
+};
+
 /**
  * struct hostapd_data - hostapd per-BSS data structure
  */
@@ -163,9 +187,7 @@ struct hostapd_data {
 
 	int num_sta; /* number of entries in sta_list */
 	struct sta_info *sta_list; /* STA info list head */
-#define STA_HASH_SIZE 256
-#define STA_HASH(sta) (sta[5])
-	struct sta_info *sta_hash[STA_HASH_SIZE];
+	struct hash_table sta_hash; /* STA info entries indexed by address */
 
 	/*
 	 * Bitfield for indicating which AIDs are allocated. Only AID values
@@ -186,10 +208,19 @@ struct hostapd_data {
 
 	struct radius_client_data *radius;
 	u64 acct_session_id;
+	struct accounting_spool *acct_spool;
+	struct radius_msg *acct_spool_msg; /* spooled message being replayed */
 	struct radius_das_data *radius_das;
+	struct hostapd_das_index *das_index; /* station index while processing a
+					      * burst of DAS requests */
 
-	struct hostapd_cached_radius_acl *acl_cache;
-	struct hostapd_acl_query_data *acl_queries;
+	struct dl_list acl_cache; /* struct hostapd_cached_radius_acl::list in
+				   * least recently used first order */
+	struct hash_table acl_cache_hash; /* ACL cache entries by address */
+	struct dl_list acl_queries; /* struct hostapd_acl_query_data::list */
+	struct hash_table acl_query_addr; /* ACL queries by address */
+	struct hash_table acl_query_auth; /* ACL queries by Request
+					   * Authenticator */
 
 	struct wpa_authenticator *wpa_auth;
 	struct eapol_authenticator *eapol_auth;
@@ -204,6 +235,8 @@ struct hostapd_data {
 	struct dl_list ctrl_dst;
 
 	void *ssl_ctx;
+	u8 *tls_ticket_keys; /* current key first */
+	size_t num_tls_ticket_keys;
 	void *eap_sim_db_priv;
 	struct radius_server_data *radius_srv;
 	struct dl_list erp_keys; /* struct eap_server_erp_key */
@@ -292,6 +325,14 @@ struct hostapd_data {
 	unsigned int cs_c_off_ecsa_beacon;
 	unsigned int cs_c_off_ecsa_proberesp;
 
+	/* Probe Response frames built for the current Beacon frame contents;
+	 * index 1 is used for P2P Probe Request frames */
+	struct hostapd_probe_resp_cache {
+		u8 *frame;
+		size_t len;
+		size_t bss_load_off; /* offset of the BSS Load element or 0 */
+	} probe_resp_cache[2];
+
 #ifdef CONFIG_P2P
 	struct p2p_data *p2p;
 	struct p2p_group *p2p_group;
@@ -327,11 +368,16 @@ struct hostapd_data {
 #ifdef CONFIG_SAE
 	/** Key used for generating SAE anti-clogging tokens */
 	u8 sae_token_key[8];
+	/** HMAC-SHA256 context keyed with sae_token_key */
+	struct crypto_mac *sae_token_mac;
 	struct os_reltime last_sae_token_key_update;
 	u16 sae_token_idx;
 	u16 sae_pending_token_idx[256];
 	int dot11RSNASAERetransPeriod; /* msec */
 	struct dl_list sae_commit_queue; /* struct hostapd_sae_commit_queue */
+	struct dl_list sae_jobs; /* struct hostapd_sae_job */
+	struct worker_pool *sae_pool;
+	unsigned int sae_pool_threads;
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_TESTING_OPTIONS
@@ -472,7 +518,7 @@ struct hostapd_iface {
 
 	int num_ap; /* number of entries in ap_list */
 	struct ap_info *ap_list; /* AP info list head */
-	struct ap_info *ap_hash[STA_HASH_SIZE];
+	struct hash_table ap_hash; /* AP info entries indexed by address */
 
 	u64 drv_flags;
 
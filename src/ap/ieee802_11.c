@@ -12,6 +12,7 @@
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "utils/worker_pool.h"
 #include "crypto/crypto.h"
 #include "crypto/sha256.h"
 #include "crypto/sha384.h"
@@ -467,11 +468,12 @@ static void sae_set_state(struct sta_info *sta, enum sae_state state,
 }
 
 
-static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
-					     struct sta_info *sta, int update,
-					     int status_code)
+/* Find the password (and PT) to use with the STA */
+static const char * sae_get_password(struct hostapd_data *hapd,
+				     struct sta_info *sta, int status_code,
+				     struct sae_password_entry **pw_entry,
+				     struct sae_pt **s_pt, int *s_use_pt)
 {
-	struct wpabuf *buf;
 	const char *password = NULL;
 	struct sae_password_entry *pw;
 	const char *rx_id = NULL;
@@ -507,6 +509,29 @@ static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
 		password = hapd->conf->ssid.wpa_passphrase;
 		pt = hapd->conf->ssid.pt;
 	}
+
+	*pw_entry = pw;
+	*s_pt = pt;
+	*s_use_pt = use_pt;
+	return password;
+}
+
+
+static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
+					     struct sta_info *sta, int update,
+					     int status_code)
+{
+	struct wpabuf *buf;
+	const char *password;
+	struct sae_password_entry *pw;
+	const char *rx_id = NULL;
+	int use_pt;
+	struct sae_pt *pt;
+
+	if (sta->sae->tmp)
+		rx_id = sta->sae->tmp->pw_id;
+
+	password = sae_get_password(hapd, sta, status_code, &pw, &pt, &use_pt);
 	if (!password || (use_pt && !pt)) {
 		wpa_printf(MSG_DEBUG, "SAE: No password available");
 		return NULL;
@@ -632,9 +657,10 @@ static int use_sae_anti_clogging(struct hostapd_data *hapd)
 	}
 
 	/* In addition to already existing open SAE sessions, check whether
-	 * there are enough pending commit messages in the processing queue to
-	 * potentially result in too many open sessions. */
-	if (open + dl_list_len(&hapd->sae_commit_queue) >=
+	 * there are enough pending commit messages in the processing queue or
+	 * in worker threads to potentially result in too many open sessions. */
+	if (open + dl_list_len(&hapd->sae_commit_queue) +
+	    dl_list_len(&hapd->sae_jobs) >=
 	    hapd->conf->sae_anti_clogging_threshold)
 		return 1;
 
@@ -644,10 +670,11 @@ static int use_sae_anti_clogging(struct hostapd_data *hapd)
 
 static int sae_token_hash(struct hostapd_data *hapd, const u8 *addr, u8 *idx)
 {
+	size_t len = ETH_ALEN;
 	u8 hash[SHA256_MAC_LEN];
 
-	if (hmac_sha256(hapd->sae_token_key, sizeof(hapd->sae_token_key),
-			addr, ETH_ALEN, hash) < 0)
+	if (!hapd->sae_token_mac ||
+	    crypto_mac_vector(hapd->sae_token_mac, 1, &addr, &len, hash) < 0)
 		return -1;
 	*idx = hash[0];
 	return 0;
@@ -677,8 +704,7 @@ static int check_sae_token(struct hostapd_data *hapd, const u8 *addr,
 	len[0] = ETH_ALEN;
 	addrs[1] = token;
 	len[1] = 2;
-	if (hmac_sha256_vector(hapd->sae_token_key, sizeof(hapd->sae_token_key),
-			       2, addrs, len, mac) < 0 ||
+	if (crypto_mac_vector(hapd->sae_token_mac, 2, addrs, len, mac) < 0 ||
 	    os_memcmp_const(token + 2, &mac[2], SHA256_MAC_LEN - 2) != 0)
 		return -1;
 
@@ -704,9 +730,16 @@ static struct wpabuf * auth_build_token_req(struct hostapd_data *hapd,
 	if (!os_reltime_initialized(&hapd->last_sae_token_key_update) ||
 	    os_reltime_expired(&now, &hapd->last_sae_token_key_update, 60) ||
 	    hapd->sae_token_idx == 0xffff) {
+		crypto_mac_deinit(hapd->sae_token_mac);
+		hapd->sae_token_mac = NULL;
 		if (random_get_bytes(hapd->sae_token_key,
 				     sizeof(hapd->sae_token_key)) < 0)
 			return NULL;
+		hapd->sae_token_mac = crypto_mac_init(
+			CRYPTO_MAC_HMAC_SHA256, hapd->sae_token_key,
+			sizeof(hapd->sae_token_key));
+		if (!hapd->sae_token_mac)
+			return NULL;
 		wpa_hexdump(MSG_DEBUG, "SAE: Updated token key",
 			    hapd->sae_token_key, sizeof(hapd->sae_token_key));
 		hapd->last_sae_token_key_update = now;
@@ -744,8 +777,7 @@ static struct wpabuf * auth_build_token_req(struct hostapd_data *hapd,
 	len[0] = ETH_ALEN;
 	addrs[1] = idx;
 	len[1] = sizeof(idx);
-	if (hmac_sha256_vector(hapd->sae_token_key, sizeof(hapd->sae_token_key),
-			       2, addrs, len, token) < 0) {
+	if (crypto_mac_vector(hapd->sae_token_mac, 2, addrs, len, token) < 0) {
 		wpabuf_free(buf);
 		return NULL;
 	}
@@ -882,6 +914,47 @@ void sae_accept_sta(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
+/* Complete Nothing -> Committed transition after processing the peer Commit */
+static int sae_sm_committed(struct hostapd_data *hapd, struct sta_info *sta,
+			    const u8 *bssid)
+{
+	int ret;
+
+	/*
+	 * In mesh case, both Commit and Confirm are sent immediately. In
+	 * infrastructure BSS, by default, only a single Authentication frame
+	 * (Commit) is expected from the AP here and the second one (Confirm)
+	 * will be sent once the STA has sent its second Authentication frame
+	 * (Confirm). This behavior can be overridden with explicit
+	 * configuration so that the infrastructure BSS case sends both frames
+	 * together.
+	 */
+	if ((hapd->conf->mesh & MESH_ENABLED) ||
+	    hapd->conf->sae_confirm_immediate) {
+		/*
+		 * Send both Commit and Confirm immediately based on SAE finite
+		 * state machine Nothing -> Confirm transition.
+		 */
+		ret = auth_sae_send_confirm(hapd, sta, bssid);
+		if (ret)
+			return ret;
+		sae_set_state(sta, SAE_CONFIRMED, "Sent Confirm (mesh)");
+	} else {
+		/*
+		 * For infrastructure BSS, send only the Commit message now to
+		 * get alternating sequence of Authentication frames between the
+		 * AP and STA. Confirm will be sent in
+		 * Committed -> Confirmed/Accepted transition when receiving
+		 * Confirm from STA.
+		 */
+	}
+	sta->sae->sync = 0;
+	sae_set_retransmit_timer(hapd, sta);
+
+	return WLAN_STATUS_SUCCESS;
+}
+
+
 static int sae_sm_step(struct hostapd_data *hapd, struct sta_info *sta,
 		       const u8 *bssid, u16 auth_transaction, u16 status_code,
 		       int allow_reuse, int *sta_removed)
@@ -911,40 +984,7 @@ static int sae_sm_step(struct hostapd_data *hapd, struct sta_info *sta,
 			if (sae_process_commit(sta->sae) < 0)
 				return WLAN_STATUS_UNSPECIFIED_FAILURE;
 
-			/*
-			 * In mesh case, both Commit and Confirm are sent
-			 * immediately. In infrastructure BSS, by default, only
-			 * a single Authentication frame (Commit) is expected
-			 * from the AP here and the second one (Confirm) will
-			 * be sent once the STA has sent its second
-			 * Authentication frame (Confirm). This behavior can be
-			 * overridden with explicit configuration so that the
-			 * infrastructure BSS case sends both frames together.
-			 */
-			if ((hapd->conf->mesh & MESH_ENABLED) ||
-			    hapd->conf->sae_confirm_immediate) {
-				/*
-				 * Send both Commit and Confirm immediately
-				 * based on SAE finite state machine
-				 * Nothing -> Confirm transition.
-				 */
-				ret = auth_sae_send_confirm(hapd, sta, bssid);
-				if (ret)
-					return ret;
-				sae_set_state(sta, SAE_CONFIRMED,
-					      "Sent Confirm (mesh)");
-			} else {
-				/*
-				 * For infrastructure BSS, send only the Commit
-				 * message now to get alternating sequence of
-				 * Authentication frames between the AP and STA.
-				 * Confirm will be sent in
-				 * Committed -> Confirmed/Accepted transition
-				 * when receiving Confirm from STA.
-				 */
-			}
-			sta->sae->sync = 0;
-			sae_set_retransmit_timer(hapd, sta);
+			return sae_sm_committed(hapd, sta, bssid);
 		} else {
 			hostapd_logger(hapd, sta->addr,
 				       HOSTAPD_MODULE_IEEE80211,
@@ -1174,6 +1214,249 @@ static int check_sae_rejected_groups(struct hostapd_data *hapd,
 }
 
 
+static int auth_sae_job_pending(struct hostapd_data *hapd, const u8 *addr)
+{
+	struct hostapd_sae_job *job;
+
+	dl_list_for_each(job, &hapd->sae_jobs, struct hostapd_sae_job, list) {
+		if (os_memcmp(addr, job->peer_addr, ETH_ALEN) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+static void auth_sae_schedule_commit(struct hostapd_data *hapd,
+				     unsigned int queue_len)
+{
+	if (eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
+		return;
+	/* With worker threads, the number of commit messages in processing is
+	 * limited instead of postponing the processing of the queue. */
+	eloop_register_timeout(0, hapd->sae_pool ? 0 : queue_len * 10000,
+			       auth_sae_process_commit, hapd, NULL);
+}
+
+
+static void auth_sae_update_pool(struct hostapd_data *hapd)
+{
+	unsigned int threads = hapd->conf->sae_commit_threads;
+
+	/* sae_commit_threads may have been changed in configuration reload;
+	 * the pool is replaced only once it is idle. */
+	if (hapd->sae_pool_threads == threads ||
+	    !dl_list_empty(&hapd->sae_jobs))
+		return;
+
+	worker_pool_deinit(hapd->sae_pool);
+	hapd->sae_pool = worker_pool_init(threads);
+	hapd->sae_pool_threads = threads;
+	if (threads && !hapd->sae_pool)
+		wpa_printf(MSG_INFO,
+			   "SAE: Failed to start worker threads - process commit messages in the main thread");
+}
+
+
+static void auth_sae_job_run(void *ctx)
+{
+	struct hostapd_sae_job *job = ctx;
+
+	/* This is called in a worker thread where debug output and the testing
+	 * hooks are disabled; the results are logged in auth_sae_job_finish().
+	 */
+	if (job->password) {
+		job->prepare_res = sae_prepare_commit(
+			job->own_addr, job->peer_addr,
+			(const u8 *) job->password, os_strlen(job->password),
+			job->rx_id, job->sae);
+		if (job->prepare_res < 0)
+			return;
+	}
+	job->process_res = sae_process_commit(job->sae);
+}
+
+
+static int auth_sae_job_finish(struct hostapd_data *hapd, struct sta_info *sta,
+			       struct hostapd_sae_job *job)
+{
+	int ret;
+
+	if (job->prepare_res < 0) {
+		wpa_printf(MSG_DEBUG, "SAE: Could not pick PWE");
+		if (sta->sae->tmp && sta->sae->tmp->pw_id)
+			return WLAN_STATUS_UNKNOWN_PASSWORD_IDENTIFIER;
+		return WLAN_STATUS_UNSPECIFIED_FAILURE;
+	}
+
+	ret = auth_sae_send_commit(hapd, sta, job->bssid, 0, job->status_code);
+	if (ret)
+		return ret;
+	sae_set_state(sta, SAE_COMMITTED, "Sent Commit");
+
+	if (job->process_res < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "SAE: Failed to process peer commit from " MACSTR,
+			   MAC2STR(sta->addr));
+		return WLAN_STATUS_UNSPECIFIED_FAILURE;
+	}
+
+	return sae_sm_committed(hapd, sta, job->bssid);
+}
+
+
+static void auth_sae_job_done(void *ctx)
+{
+	struct hostapd_sae_job *job = ctx;
+	struct hostapd_data *hapd = job->hapd;
+	struct sta_info *sta = job->sta;
+	int resp, cancel = job->cancel;
+
+	dl_list_del(&job->list);
+	str_clear_free(job->password);
+
+	if (!sta) {
+		wpa_printf(MSG_DEBUG,
+			   "SAE: STA " MACSTR
+			   " was removed during commit processing",
+			   MAC2STR(job->peer_addr));
+		sae_clear_data(job->sae);
+		os_free(job->sae);
+		goto out;
+	}
+	sta->sae_job = NULL;
+	if (cancel)
+		goto out;
+
+	resp = auth_sae_job_finish(hapd, sta, job);
+	if (resp != WLAN_STATUS_SUCCESS) {
+		sae_sme_send_external_auth_status(hapd, sta, resp);
+		send_auth_reply(hapd, sta, sta->addr, job->bssid,
+				WLAN_AUTH_SAE, 1, resp, (u8 *) "", 0,
+				"auth-sae");
+	}
+
+	if (sta->added_unassoc &&
+	    (resp != WLAN_STATUS_SUCCESS ||
+	     job->status_code != WLAN_STATUS_SUCCESS)) {
+		hostapd_drv_sta_remove(hapd, sta->addr);
+		sta->added_unassoc = 0;
+	}
+
+out:
+	os_free(job);
+	if (!cancel)
+		auth_sae_schedule_commit(hapd,
+					 dl_list_len(&hapd->sae_commit_queue));
+}
+
+
+/*
+ * Derive PWE and process the peer Commit in a worker thread. The STA remains
+ * in Nothing state and no other Authentication frames from it are processed
+ * until auth_sae_job_done() has sent the Commit and moved to Committed state.
+ */
+static int auth_sae_job_start(struct hostapd_data *hapd, struct sta_info *sta,
+			      const u8 *bssid, u16 status_code,
+			      int allow_reuse)
+{
+	struct hostapd_sae_job *job;
+	struct sae_password_entry *pw;
+	struct sae_pt *pt;
+	const char *password = NULL;
+	int use_pt;
+
+	if (!hapd->sae_pool || (hapd->conf->mesh & MESH_ENABLED) ||
+	    dl_list_len(&hapd->sae_jobs) >= 2 * hapd->sae_pool_threads)
+		return -1;
+
+	if (sta->sae->tmp)
+		sta->sae->tmp->h2e =
+			status_code == WLAN_STATUS_SAE_HASH_TO_ELEMENT;
+
+	if (!allow_reuse) {
+		password = sae_get_password(hapd, sta, status_code, &pw, &pt,
+					    &use_pt);
+		if (!password || (use_pt && !pt))
+			return -1; /* reported through sae_sm_step() */
+		if (use_pt) {
+			/* The PT (and its EC context) is shared between all
+			 * STAs, so PWE is derived from it in this thread. */
+			if (sae_prepare_commit_pt(sta->sae, pt, hapd->own_addr,
+						  sta->addr, NULL) < 0)
+				return -1;
+			password = NULL;
+		}
+	}
+
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return -1;
+	if (password) {
+		job->password = os_strdup(password);
+		if (!job->password) {
+			os_free(job);
+			return -1;
+		}
+	}
+	job->hapd = hapd;
+	job->sta = sta;
+	job->sae = sta->sae;
+	os_memcpy(job->own_addr, hapd->own_addr, ETH_ALEN);
+	os_memcpy(job->peer_addr, sta->addr, ETH_ALEN);
+	os_memcpy(job->bssid, bssid, ETH_ALEN);
+	job->status_code = status_code;
+	if (sta->sae->tmp)
+		job->rx_id = sta->sae->tmp->pw_id;
+
+	sae_clear_retransmit_timer(hapd, sta);
+	if (worker_pool_submit(hapd->sae_pool, auth_sae_job_run,
+			       auth_sae_job_done, job) < 0) {
+		str_clear_free(job->password);
+		os_free(job);
+		return -1;
+	}
+	dl_list_add_tail(&hapd->sae_jobs, &job->list);
+	sta->sae_job = job;
+
+	wpa_printf(MSG_DEBUG,
+		   "SAE: Process commit from " MACSTR " in a worker thread",
+		   MAC2STR(sta->addr));
+	return 0;
+}
+
+
+/**
+ * auth_sae_job_detach - Detach a STA entry that is being freed from its job
+ * @sta: STA entry with sta->sae_job set
+ *
+ * The job takes over sta->sae and frees it once the worker thread is done
+ * with it.
+ */
+void auth_sae_job_detach(struct sta_info *sta)
+{
+	sta->sae_job->sta = NULL;
+	sta->sae_job = NULL;
+	sta->sae = NULL;
+}
+
+
+/**
+ * auth_sae_jobs_deinit - Cancel SAE commit processing and stop the threads
+ * @hapd: BSS data
+ */
+void auth_sae_jobs_deinit(struct hostapd_data *hapd)
+{
+	struct hostapd_sae_job *job;
+
+	dl_list_for_each(job, &hapd->sae_jobs, struct hostapd_sae_job, list)
+		job->cancel = 1;
+	worker_pool_deinit(hapd->sae_pool);
+	hapd->sae_pool = NULL;
+	hapd->sae_pool_threads = 0;
+}
+
+
 static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			    const struct ieee80211_mgmt *mgmt, size_t len,
 			    u16 auth_transaction, u16 status_code)
@@ -1394,6 +1677,11 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			goto reply;
 		}
 
+		if (sta->sae->state == SAE_NOTHING &&
+		    auth_sae_job_start(hapd, sta, mgmt->bssid, status_code,
+				       allow_reuse) == 0)
+			return;
+
 		resp = sae_sm_step(hapd, sta, mgmt->bssid, auth_transaction,
 				   status_code, allow_reuse, &sta_removed);
 	} else if (auth_transaction == 2) {
@@ -1513,25 +1801,34 @@ int auth_sae_init_committed(struct hostapd_data *hapd, struct sta_info *sta)
 void auth_sae_process_commit(void *eloop_ctx, void *user_ctx)
 {
 	struct hostapd_data *hapd = eloop_ctx;
-	struct hostapd_sae_commit_queue *q;
-	unsigned int queue_len;
+	struct hostapd_sae_commit_queue *q, *next = NULL;
+	const struct ieee80211_mgmt *mgmt;
 
-	q = dl_list_first(&hapd->sae_commit_queue,
-			  struct hostapd_sae_commit_queue, list);
-	if (!q)
+	auth_sae_update_pool(hapd);
+	if (hapd->sae_pool &&
+	    dl_list_len(&hapd->sae_jobs) >= 2 * hapd->sae_pool_threads)
+		return; /* continued from auth_sae_job_done() */
+
+	/* Maintain the frame order for a STA whose commit message is being
+	 * processed in a worker thread. */
+	dl_list_for_each(q, &hapd->sae_commit_queue,
+			 struct hostapd_sae_commit_queue, list) {
+		mgmt = (const struct ieee80211_mgmt *) q->msg;
+		if (!auth_sae_job_pending(hapd, mgmt->sa)) {
+			next = q;
+			break;
+		}
+	}
+	if (!next)
 		return;
 	wpa_printf(MSG_DEBUG,
 		   "SAE: Process next available message from queue");
-	dl_list_del(&q->list);
-	handle_auth(hapd, (const struct ieee80211_mgmt *) q->msg, q->len,
-		    q->rssi, 1);
-	os_free(q);
+	dl_list_del(&next->list);
+	handle_auth(hapd, (const struct ieee80211_mgmt *) next->msg, next->len,
+		    next->rssi, 1);
+	os_free(next);
 
-	if (eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
-		return;
-	queue_len = dl_list_len(&hapd->sae_commit_queue);
-	eloop_register_timeout(0, queue_len * 10000, auth_sae_process_commit,
-			       hapd, NULL);
+	auth_sae_schedule_commit(hapd, dl_list_len(&hapd->sae_commit_queue));
 }
 
 
@@ -1544,7 +1841,7 @@ static void auth_sae_queue(struct hostapd_data *hapd,
 	const struct ieee80211_mgmt *mgmt2;
 
 	queue_len = dl_list_len(&hapd->sae_commit_queue);
-	if (queue_len >= 15) {
+	if (queue_len >= hapd->conf->sae_commit_queue_len) {
 		wpa_printf(MSG_DEBUG,
 			   "SAE: No more room in message queue - drop the new frame from "
 			   MACSTR, MAC2STR(mgmt->sa));
@@ -1586,10 +1883,7 @@ static void auth_sae_queue(struct hostapd_data *hapd,
 	dl_list_add_tail(&hapd->sae_commit_queue, &q->list);
 
 queued:
-	if (eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
-		return;
-	eloop_register_timeout(0, queue_len * 10000, auth_sae_process_commit,
-			       hapd, NULL);
+	auth_sae_schedule_commit(hapd, queue_len);
 }
 
 
@@ -1605,7 +1899,7 @@ static int auth_sae_queued_addr(struct hostapd_data *hapd, const u8 *addr)
 			return 1;
 	}
 
-	return 0;
+	return auth_sae_job_pending(hapd, addr);
 }
 
 #endif /* CONFIG_SAE */
@@ -5346,8 +5640,31 @@ void ieee802_11_mgmt_cb(struct hostapd_data *hapd, const u8 *buf, size_t len,
 
 int ieee802_11_get_mib(struct hostapd_data *hapd, char *buf, size_t buflen)
 {
-	/* TODO */
-	return 0;
+	struct hash_table_stats sta, ap;
+	int ret;
+
+	hash_table_get_stats(&hapd->sta_hash, &sta);
+	hash_table_get_stats(&hapd->iface->ap_hash, &ap);
+	ret = os_snprintf(buf, buflen,
+			  "staHashEntries=%u\n"
+			  "staHashBuckets=%u\n"
+			  "staHashUsedBuckets=%u\n"
+			  "staHashMaxChain=%u\n"
+			  "apHashEntries=%u\n"
+			  "apHashBuckets=%u\n"
+			  "apHashUsedBuckets=%u\n"
+			  "apHashMaxChain=%u\n",
+			  (unsigned int) sta.entries,
+			  (unsigned int) sta.buckets,
+			  (unsigned int) sta.used_buckets,
+			  (unsigned int) sta.max_chain,
+			  (unsigned int) ap.entries,
+			  (unsigned int) ap.buckets,
+			  (unsigned int) ap.used_buckets,
+			  (unsigned int) ap.max_chain);
+	if (os_snprintf_error(buflen, ret))
+		return 0;
+	return ret;
 }
 
 
@@ -31,7 +31,8 @@ struct hostapd_cached_radius_acl {
 	struct os_reltime timestamp;
 	macaddr addr;
 	int accepted; /* HOSTAPD_ACL_* */
-	struct hostapd_cached_radius_acl *next;
+	struct dl_list list; /* entry in hapd->acl_cache */
+	struct hash_node hnode; /* entry in hapd->acl_cache_hash */
 	struct radius_sta info;
 };
 
@@ -39,10 +40,13 @@ struct hostapd_cached_radius_acl {
 struct hostapd_acl_query_data {
 	struct os_reltime timestamp;
 	u8 radius_id;
+	u8 radius_authenticator[16]; /* Request Authenticator of the query */
 	macaddr addr;
 	u8 *auth_msg; /* IEEE 802.11 authentication frame from station */
 	size_t auth_msg_len;
-	struct hostapd_acl_query_data *next;
+	struct dl_list list; /* entry in hapd->acl_queries */
+	struct hash_node addr_node; /* entry in hapd->acl_query_addr */
+	struct hash_node auth_node; /* entry in hapd->acl_query_auth */
 };
 
 
@@ -56,15 +60,39 @@ static void hostapd_acl_cache_free_entry(struct hostapd_cached_radius_acl *e)
 }
 
 
-static void hostapd_acl_cache_free(struct hostapd_cached_radius_acl *acl_cache)
+static void hostapd_acl_cache_del(struct hostapd_data *hapd,
+				  struct hostapd_cached_radius_acl *e)
 {
-	struct hostapd_cached_radius_acl *prev;
+	dl_list_del(&e->list);
+	hash_table_del(&hapd->acl_cache_hash, &e->hnode);
+	hostapd_acl_cache_free_entry(e);
+}
 
-	while (acl_cache) {
-		prev = acl_cache;
-		acl_cache = acl_cache->next;
-		hostapd_acl_cache_free_entry(prev);
-	}
+
+static void hostapd_acl_cache_free(struct hostapd_data *hapd)
+{
+	struct hostapd_cached_radius_acl *e, *n;
+
+	dl_list_for_each_safe(e, n, &hapd->acl_cache,
+			      struct hostapd_cached_radius_acl, list)
+		hostapd_acl_cache_free_entry(e);
+	dl_list_init(&hapd->acl_cache);
+	hash_table_deinit(&hapd->acl_cache_hash);
+}
+
+
+static int hostapd_acl_cache_expired(struct hostapd_data *hapd,
+				     struct hostapd_cached_radius_acl *e,
+				     struct os_reltime *now)
+{
+	os_time_t timeout = RADIUS_ACL_TIMEOUT;
+
+	/* Without negative caching, Access-Reject results are removed once the
+	 * authentication frame that triggered the query has been processed */
+	if (e->accepted == HOSTAPD_ACL_REJECT &&
+	    hapd->conf->radius_acl_reject_timeout)
+		timeout = hapd->conf->radius_acl_reject_timeout;
+	return os_reltime_expired(now, &e->timestamp, timeout);
 }
 
 
@@ -72,23 +100,61 @@ static int hostapd_acl_cache_get(struct hostapd_data *hapd, const u8 *addr,
 				 struct radius_sta *out)
 {
 	struct hostapd_cached_radius_acl *entry;
+	struct hash_node *node;
 	struct os_reltime now;
 
+	node = hash_table_get(&hapd->acl_cache_hash, addr, ETH_ALEN);
+	if (!node)
+		return -1;
+	entry = hash_table_entry(node, struct hostapd_cached_radius_acl, hnode);
+
 	os_get_reltime(&now);
+	if (hostapd_acl_cache_expired(hapd, entry, &now))
+		return -1; /* entry has expired */
 
-	for (entry = hapd->acl_cache; entry; entry = entry->next) {
-		if (os_memcmp(entry->addr, addr, ETH_ALEN) != 0)
-			continue;
+	/* Keep the list in least recently used first order */
+	dl_list_del(&entry->list);
+	dl_list_add_tail(&hapd->acl_cache, &entry->list);
 
-		if (os_reltime_expired(&now, &entry->timestamp,
-				       RADIUS_ACL_TIMEOUT))
-			return -1; /* entry has expired */
-		*out = entry->info;
+	*out = entry->info;
 
-		return entry->accepted;
-	}
+	return entry->accepted;
+}
 
-	return -1;
+
+static void hostapd_acl_cache_add(struct hostapd_data *hapd,
+				  struct hostapd_cached_radius_acl *cache)
+{
+	struct hostapd_cached_radius_acl *entry;
+	struct hash_node *node;
+
+	/* Replace a possible expired entry for the same STA */
+	node = hash_table_get(&hapd->acl_cache_hash, cache->addr, ETH_ALEN);
+	if (node)
+		hostapd_acl_cache_del(hapd,
+				      hash_table_entry(
+					      node,
+					      struct hostapd_cached_radius_acl,
+					      hnode));
+
+	if (hash_table_add(&hapd->acl_cache_hash, &cache->hnode, cache->addr,
+			   ETH_ALEN) < 0) {
+		wpa_printf(MSG_DEBUG, "Failed to add ACL cache entry");
+		hostapd_acl_cache_free_entry(cache);
+		return;
+	}
+	dl_list_add_tail(&hapd->acl_cache, &cache->list);
+
+	while (hapd->conf->radius_acl_cache_size &&
+	       hapd->acl_cache_hash.count > hapd->conf->radius_acl_cache_size) {
+		entry = dl_list_first(&hapd->acl_cache,
+				      struct hostapd_cached_radius_acl, list);
+		wpa_printf(MSG_DEBUG, "Removing least recently used ACL entry "
+			   "for " MACSTR " from full cache",
+			   MAC2STR(entry->addr));
+		hostapd_drv_set_radius_acl_expire(hapd, entry->addr);
+		hostapd_acl_cache_del(hapd, entry);
+	}
 }
 #endif /* CONFIG_NO_RADIUS */
 
@@ -102,6 +168,31 @@ static void hostapd_acl_query_free(struct hostapd_acl_query_data *query)
 }
 
 
+#ifndef CONFIG_NO_RADIUS
+static void hostapd_acl_query_del(struct hostapd_data *hapd,
+				  struct hostapd_acl_query_data *query)
+{
+	dl_list_del(&query->list);
+	hash_table_del(&hapd->acl_query_addr, &query->addr_node);
+	hash_table_del(&hapd->acl_query_auth, &query->auth_node);
+	hostapd_acl_query_free(query);
+}
+
+
+static struct hostapd_acl_query_data *
+hostapd_acl_query_get(struct hostapd_data *hapd, const u8 *addr)
+{
+	struct hash_node *node;
+
+	node = hash_table_get(&hapd->acl_query_addr, addr, ETH_ALEN);
+	if (!node)
+		return NULL;
+	return hash_table_entry(node, struct hostapd_acl_query_data,
+				addr_node);
+}
+#endif /* CONFIG_NO_RADIUS */
+
+
 #ifndef CONFIG_NO_RADIUS
 static int hostapd_radius_acl_query(struct hostapd_data *hapd, const u8 *addr,
 				    struct hostapd_acl_query_data *query)
@@ -118,6 +209,9 @@ static int hostapd_radius_acl_query(struct hostapd_data *hapd, const u8 *addr,
 		wpa_printf(MSG_INFO, "Could not make Request Authenticator");
 		goto fail;
 	}
+	os_memcpy(query->radius_authenticator,
+		  radius_msg_get_hdr(msg)->authenticator,
+		  sizeof(query->radius_authenticator));
 
 	os_snprintf(buf, sizeof(buf), RADIUS_ADDR_FORMAT, MAC2STR(addr));
 	if (!radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME, (u8 *) buf,
@@ -245,14 +339,21 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 		if (res == HOSTAPD_ACL_REJECT)
 			return HOSTAPD_ACL_REJECT;
 
-		query = hapd->acl_queries;
-		while (query) {
-			if (os_memcmp(query->addr, addr, ETH_ALEN) == 0) {
-				/* pending query in RADIUS retransmit queue;
-				 * do not generate a new one */
-				return HOSTAPD_ACL_PENDING;
+		query = hostapd_acl_query_get(hapd, addr);
+		if (query) {
+			u8 *auth_msg;
+
+			/* pending query in RADIUS retransmit queue;
+			 * do not generate a new one, but process the latest
+			 * authentication frame from the STA when the response
+			 * is received */
+			auth_msg = os_memdup(msg, len);
+			if (auth_msg) {
+				os_free(query->auth_msg);
+				query->auth_msg = auth_msg;
+				query->auth_msg_len = len;
 			}
-			query = query->next;
+			return HOSTAPD_ACL_PENDING;
 		}
 
 		if (!hapd->conf->radius->auth_server)
@@ -281,8 +382,20 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 			return HOSTAPD_ACL_REJECT;
 		}
 		query->auth_msg_len = len;
-		query->next = hapd->acl_queries;
-		hapd->acl_queries = query;
+		if (hash_table_add(&hapd->acl_query_addr, &query->addr_node,
+				   query->addr, ETH_ALEN) < 0) {
+			hostapd_acl_query_free(query);
+			return HOSTAPD_ACL_REJECT;
+		}
+		if (hash_table_add(&hapd->acl_query_auth, &query->auth_node,
+				   query->radius_authenticator,
+				   sizeof(query->radius_authenticator)) < 0) {
+			hash_table_del(&hapd->acl_query_addr,
+				       &query->addr_node);
+			hostapd_acl_query_free(query);
+			return HOSTAPD_ACL_REJECT;
+		}
+		dl_list_add_tail(&hapd->acl_queries, &query->list);
 
 		/* Queued data will be processed in hostapd_acl_recv_radius()
 		 * when RADIUS server replies to the sent Access-Request. */
@@ -298,29 +411,16 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 static void hostapd_acl_expire_cache(struct hostapd_data *hapd,
 				     struct os_reltime *now)
 {
-	struct hostapd_cached_radius_acl *prev, *entry, *tmp;
-
-	prev = NULL;
-	entry = hapd->acl_cache;
-
-	while (entry) {
-		if (os_reltime_expired(now, &entry->timestamp,
-				       RADIUS_ACL_TIMEOUT)) {
-			wpa_printf(MSG_DEBUG, "Cached ACL entry for " MACSTR
-				   " has expired.", MAC2STR(entry->addr));
-			if (prev)
-				prev->next = entry->next;
-			else
-				hapd->acl_cache = entry->next;
-			hostapd_drv_set_radius_acl_expire(hapd, entry->addr);
-			tmp = entry;
-			entry = entry->next;
-			hostapd_acl_cache_free_entry(tmp);
-			continue;
-		}
+	struct hostapd_cached_radius_acl *entry, *n;
 
-		prev = entry;
-		entry = entry->next;
+	dl_list_for_each_safe(entry, n, &hapd->acl_cache,
+			      struct hostapd_cached_radius_acl, list) {
+		if (!hostapd_acl_cache_expired(hapd, entry, now))
+			continue;
+		wpa_printf(MSG_DEBUG, "Cached ACL entry for " MACSTR
+			   " has expired.", MAC2STR(entry->addr));
+		hostapd_drv_set_radius_acl_expire(hapd, entry->addr);
+		hostapd_acl_cache_del(hapd, entry);
 	}
 }
 
@@ -328,29 +428,17 @@ static void hostapd_acl_expire_cache(struct hostapd_data *hapd,
 static void hostapd_acl_expire_queries(struct hostapd_data *hapd,
 				       struct os_reltime *now)
 {
-	struct hostapd_acl_query_data *prev, *entry, *tmp;
-
-	prev = NULL;
-	entry = hapd->acl_queries;
-
-	while (entry) {
-		if (os_reltime_expired(now, &entry->timestamp,
-				       RADIUS_ACL_TIMEOUT)) {
-			wpa_printf(MSG_DEBUG, "ACL query for " MACSTR
-				   " has expired.", MAC2STR(entry->addr));
-			if (prev)
-				prev->next = entry->next;
-			else
-				hapd->acl_queries = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			hostapd_acl_query_free(tmp);
-			continue;
-		}
+	struct hostapd_acl_query_data *entry;
 
-		prev = entry;
-		entry = entry->next;
+	/* The queries are in the order they were sent */
+	while ((entry = dl_list_first(&hapd->acl_queries,
+				      struct hostapd_acl_query_data, list))) {
+		if (!os_reltime_expired(now, &entry->timestamp,
+					RADIUS_ACL_TIMEOUT))
+			break;
+		wpa_printf(MSG_DEBUG, "ACL query for " MACSTR
+			   " has expired.", MAC2STR(entry->addr));
+		hostapd_acl_query_del(hapd, entry);
 	}
 }
 
@@ -451,18 +539,23 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 			void *data)
 {
 	struct hostapd_data *hapd = data;
-	struct hostapd_acl_query_data *query, *prev;
+	struct hostapd_acl_query_data *query = NULL;
 	struct hostapd_cached_radius_acl *cache;
 	struct radius_sta *info;
 	struct radius_hdr *hdr = radius_msg_get_hdr(msg);
-
-	query = hapd->acl_queries;
-	prev = NULL;
-	while (query) {
-		if (query->radius_id == hdr->identifier)
+	struct radius_hdr *req_hdr = radius_msg_get_hdr(req);
+	struct hash_node *node;
+	int no_cache;
+
+	for (node = hash_table_get(&hapd->acl_query_auth,
+				   req_hdr->authenticator,
+				   sizeof(req_hdr->authenticator));
+	     node; node = hash_table_get_next(&hapd->acl_query_auth, node)) {
+		query = hash_table_entry(node, struct hostapd_acl_query_data,
+					 auth_node);
+		if (query->radius_id == req_hdr->identifier)
 			break;
-		prev = query;
-		query = query->next;
+		query = NULL;
 	}
 	if (query == NULL)
 		return RADIUS_RX_UNKNOWN;
@@ -554,13 +647,17 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 			cache->accepted = HOSTAPD_ACL_REJECT;
 	} else
 		cache->accepted = HOSTAPD_ACL_REJECT;
-	cache->next = hapd->acl_cache;
-	hapd->acl_cache = cache;
+
+	no_cache = cache->accepted == HOSTAPD_ACL_REJECT &&
+		!hapd->conf->radius_acl_reject_timeout;
 
 #ifdef CONFIG_DRIVER_RADIUS_ACL
 	hostapd_drv_set_radius_acl_auth(hapd, query->addr, cache->accepted,
 					info->session_timeout);
-#else /* CONFIG_DRIVER_RADIUS_ACL */
+#endif /* CONFIG_DRIVER_RADIUS_ACL */
+	hostapd_acl_cache_add(hapd, cache);
+
+#ifndef CONFIG_DRIVER_RADIUS_ACL
 #ifdef NEED_AP_MLME
 	/* Re-send original authentication frame for 802.11 processing */
 	wpa_printf(MSG_DEBUG, "Re-sending authentication frame after "
@@ -569,13 +666,18 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 #endif /* NEED_AP_MLME */
 #endif /* CONFIG_DRIVER_RADIUS_ACL */
 
- done:
-	if (prev == NULL)
-		hapd->acl_queries = query->next;
-	else
-		prev->next = query->next;
+	if (no_cache) {
+		node = hash_table_get(&hapd->acl_cache_hash, query->addr,
+				      ETH_ALEN);
+		if (node)
+			hostapd_acl_cache_del(
+				hapd, hash_table_entry(
+					node, struct hostapd_cached_radius_acl,
+					hnode));
+	}
 
-	hostapd_acl_query_free(query);
+ done:
+	hostapd_acl_query_del(hapd, query);
 
 	return RADIUS_RX_PROCESSED;
 }
@@ -605,20 +707,18 @@ int hostapd_acl_init(struct hostapd_data *hapd)
  */
 void hostapd_acl_deinit(struct hostapd_data *hapd)
 {
-	struct hostapd_acl_query_data *query, *prev;
+	struct hostapd_acl_query_data *query, *n;
 
 #ifndef CONFIG_NO_RADIUS
-	hostapd_acl_cache_free(hapd->acl_cache);
-	hapd->acl_cache = NULL;
+	hostapd_acl_cache_free(hapd);
 #endif /* CONFIG_NO_RADIUS */
 
-	query = hapd->acl_queries;
-	hapd->acl_queries = NULL;
-	while (query) {
-		prev = query;
-		query = query->next;
-		hostapd_acl_query_free(prev);
-	}
+	dl_list_for_each_safe(query, n, &hapd->acl_queries,
+			      struct hostapd_acl_query_data, list)
+		hostapd_acl_query_free(query);
+	dl_list_init(&hapd->acl_queries);
+	hash_table_deinit(&hapd->acl_query_addr);
+	hash_table_deinit(&hapd->acl_query_auth);
 }
 
 
@@ -701,6 +701,9 @@ void ieee802_1x_encapsulate_radius(struct hostapd_data *hapd,
 		wpa_printf(MSG_INFO, "Could not make Request Authenticator");
 		goto fail;
 	}
+	os_memcpy(sm->radius_authenticator,
+		  radius_msg_get_hdr(msg)->authenticator,
+		  sizeof(sm->radius_authenticator));
 
 	if (sm->identity &&
 	    !radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME,
@@ -1833,7 +1836,7 @@ static void ieee802_1x_check_hs20(struct hostapd_data *hapd,
 
 
 struct sta_id_search {
-	u8 identifier;
+	const struct radius_hdr *req;
 	struct eapol_state_machine *sm;
 };
 
@@ -1846,7 +1849,9 @@ static int ieee802_1x_select_radius_identifier(struct hostapd_data *hapd,
 	struct eapol_state_machine *sm = sta->eapol_sm;
 
 	if (sm && sm->radius_identifier >= 0 &&
-	    sm->radius_identifier == id_search->identifier) {
+	    sm->radius_identifier == id_search->req->identifier &&
+	    os_memcmp(sm->radius_authenticator, id_search->req->authenticator,
+		      sizeof(sm->radius_authenticator)) == 0) {
 		id_search->sm = sm;
 		return 1;
 	}
@@ -1855,11 +1860,12 @@ static int ieee802_1x_select_radius_identifier(struct hostapd_data *hapd,
 
 
 static struct eapol_state_machine *
-ieee802_1x_search_radius_identifier(struct hostapd_data *hapd, u8 identifier)
+ieee802_1x_search_radius_identifier(struct hostapd_data *hapd,
+				    const struct radius_hdr *req)
 {
 	struct sta_id_search id_search;
 
-	id_search.identifier = identifier;
+	id_search.req = req;
 	id_search.sm = NULL;
 	ap_for_each_sta(hapd, ieee802_1x_select_radius_identifier, &id_search);
 	return id_search.sm;
@@ -1928,7 +1934,8 @@ ieee802_1x_receive_auth(struct radius_msg *msg, struct radius_msg *req,
 	int override_eapReq = 0;
 	struct radius_hdr *hdr = radius_msg_get_hdr(msg);
 
-	sm = ieee802_1x_search_radius_identifier(hapd, hdr->identifier);
+	sm = ieee802_1x_search_radius_identifier(hapd,
+						 radius_msg_get_hdr(req));
 	if (!sm) {
 		wpa_printf(MSG_DEBUG,
 			   "IEEE 802.1X: Could not find matching station for this RADIUS message");
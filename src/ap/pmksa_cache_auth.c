@@ -10,6 +10,8 @@
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "crypto/aes.h"
+#include "crypto/aes_siv.h"
 #include "eapol_auth/eapol_auth_sm.h"
 #include "eapol_auth/eapol_auth_sm_i.h"
 #include "radius/radius_das.h"
@@ -17,17 +19,39 @@
 #include "ap_config.h"
 #include "pmksa_cache_auth.h"
 
+#ifdef CONFIG_PMKSA_CACHE_FILE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
 
 static const int pmksa_cache_max_entries = 1024;
 static const int dot11RSNAConfigPMKLifetime = 43200;
 
 struct rsn_pmksa_cache {
-#define PMKID_HASH_SIZE 128
-#define PMKID_HASH(pmkid) (unsigned int) ((pmkid)[0] & 0x7f)
-	struct rsn_pmksa_cache_entry *pmkid[PMKID_HASH_SIZE];
-	struct rsn_pmksa_cache_entry *pmksa;
+	struct dl_list pmksa; /* struct rsn_pmksa_cache_entry::list */
+	struct hash_table pmkid; /* struct rsn_pmksa_cache_entry::pmkid_node */
+	struct hash_table spa; /* struct rsn_pmksa_cache_entry::spa_node */
 	int pmksa_count;
 
+	/* Binary min-heap of all entries ordered by expiration time; the first
+	 * pmksa_count elements are in use */
+	struct rsn_pmksa_cache_entry **expire;
+	size_t expire_size;
+
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	int file_fd;
+	u8 *file_map;
+	size_t file_len;
+	struct pmksa_file_slot *file_slots;
+	unsigned int file_num_slots;
+	unsigned int *file_free; /* indexes of unused slots */
+	unsigned int file_num_free;
+	u8 file_key[64];
+	size_t file_key_len;
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
 	void (*free_cb)(struct rsn_pmksa_cache_entry *entry, void *ctx);
 	void *ctx;
 };
@@ -36,6 +60,78 @@ struct rsn_pmksa_cache {
 static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa);
 
 
+static void pmksa_heap_set(struct rsn_pmksa_cache *pmksa, size_t idx,
+			   struct rsn_pmksa_cache_entry *entry)
+{
+	pmksa->expire[idx] = entry;
+	entry->expire_idx = idx;
+}
+
+
+static void pmksa_heap_up(struct rsn_pmksa_cache *pmksa, size_t idx)
+{
+	struct rsn_pmksa_cache_entry *entry = pmksa->expire[idx];
+	size_t parent;
+
+	while (idx > 0) {
+		parent = (idx - 1) / 2;
+		if (pmksa->expire[parent]->expiration <= entry->expiration)
+			break;
+		pmksa_heap_set(pmksa, idx, pmksa->expire[parent]);
+		idx = parent;
+	}
+	pmksa_heap_set(pmksa, idx, entry);
+}
+
+
+static void pmksa_heap_down(struct rsn_pmksa_cache *pmksa, size_t idx)
+{
+	struct rsn_pmksa_cache_entry *entry = pmksa->expire[idx];
+	size_t len = pmksa->pmksa_count;
+	size_t child;
+
+	for (;;) {
+		child = 2 * idx + 1;
+		if (child >= len)
+			break;
+		if (child + 1 < len &&
+		    pmksa->expire[child + 1]->expiration <
+		    pmksa->expire[child]->expiration)
+			child++;
+		if (entry->expiration <= pmksa->expire[child]->expiration)
+			break;
+		pmksa_heap_set(pmksa, idx, pmksa->expire[child]);
+		idx = child;
+	}
+	pmksa_heap_set(pmksa, idx, entry);
+}
+
+
+/* Make room for one more entry in the expiration heap */
+static int pmksa_heap_reserve(struct rsn_pmksa_cache *pmksa)
+{
+	struct rsn_pmksa_cache_entry **n;
+	size_t size;
+
+	if ((size_t) pmksa->pmksa_count < pmksa->expire_size)
+		return 0;
+	size = pmksa->expire_size ? 2 * pmksa->expire_size : 16;
+	n = os_realloc_array(pmksa->expire, size, sizeof(*n));
+	if (!n)
+		return -1;
+	pmksa->expire = n;
+	pmksa->expire_size = size;
+	return 0;
+}
+
+
+static struct rsn_pmksa_cache_entry *
+pmksa_cache_first_expiring(struct rsn_pmksa_cache *pmksa)
+{
+	return pmksa->pmksa_count ? pmksa->expire[0] : NULL;
+}
+
+
 static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
 {
 	os_free(entry->vlan_desc);
@@ -48,44 +144,225 @@ static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
 }
 
 
+#ifdef CONFIG_PMKSA_CACHE_FILE
+
+/*
+ * The PMKSA cache file consists of a header and a fixed number of slots that
+ * are updated in place through a shared memory mapping whenever an entry is
+ * added or removed. The PMK is encrypted with AES-SIV and the rest of the slot
+ * is authenticated as associated data. Expiration time is stored as wall clock
+ * time so that the remaining lifetime is maintained over restarts.
+ */
+
+#define PMKSA_FILE_MAGIC "hapdPMKS"
+#define PMKSA_FILE_VERSION 1
+#define PMKSA_FILE_ATTR_LEN 1024
+
+/* Variable length data in struct pmksa_file_slot::attr (type, le16 len) */
+#define PMKSA_FILE_ATTR_IDENTITY 1
+#define PMKSA_FILE_ATTR_CUI 2
+#define PMKSA_FILE_ATTR_CLASS 3
+
+struct pmksa_file_hdr {
+	u8 magic[8];
+	u32 version;
+	u32 slot_len;
+	u32 num_slots;
+	u32 reserved;
+};
+
+struct pmksa_file_slot {
+	u32 used; /* set once the rest of the slot has been written */
+	u32 akmp;
+	/* Beginning of the AES-SIV associated data */
+	s64 expiration;
+	u64 acct_multi_session_id;
+	u8 spa[ETH_ALEN];
+	u8 pmkid[PMKID_LEN];
+	u8 opportunistic;
+	u8 eap_type_authsrv;
+	u8 pmk_len;
+	u8 vlan_set;
+	u16 attr_len;
+	struct vlan_description vlan_desc;
+	u8 attr[PMKSA_FILE_ATTR_LEN];
+	/* End of the AES-SIV associated data */
+	u8 enc_pmk[AES_BLOCK_SIZE + PMK_LEN_MAX];
+};
+
+#define PMKSA_FILE_AD_START offsetof(struct pmksa_file_slot, expiration)
+#define PMKSA_FILE_AD_LEN \
+	(offsetof(struct pmksa_file_slot, enc_pmk) - PMKSA_FILE_AD_START)
+
+
+static int pmksa_file_add_attr(struct pmksa_file_slot *slot, u8 type,
+			       const u8 *data, size_t len)
+{
+	u8 *pos = &slot->attr[slot->attr_len];
+
+	if (len > 0xffff || PMKSA_FILE_ATTR_LEN - slot->attr_len < 3 + len)
+		return -1;
+	*pos++ = type;
+	WPA_PUT_LE16(pos, len);
+	pos += 2;
+	os_memcpy(pos, data, len);
+	slot->attr_len += 3 + len;
+	return 0;
+}
+
+
+static int pmksa_file_fill_slot(struct rsn_pmksa_cache *pmksa,
+				struct pmksa_file_slot *slot,
+				struct rsn_pmksa_cache_entry *entry)
+{
+	struct os_reltime now;
+	struct os_time wall;
+	const u8 *ad;
+	size_t ad_len;
+#ifndef CONFIG_NO_RADIUS
+	size_t i;
+#endif /* CONFIG_NO_RADIUS */
+
+	os_get_reltime(&now);
+	os_get_time(&wall);
+
+	slot->akmp = entry->akmp;
+	slot->expiration = wall.sec + (entry->expiration - now.sec);
+	slot->acct_multi_session_id = entry->acct_multi_session_id;
+	os_memcpy(slot->spa, entry->spa, ETH_ALEN);
+	os_memcpy(slot->pmkid, entry->pmkid, PMKID_LEN);
+	slot->opportunistic = entry->opportunistic;
+	slot->eap_type_authsrv = entry->eap_type_authsrv;
+	slot->pmk_len = entry->pmk_len;
+	if (entry->vlan_desc) {
+		slot->vlan_set = 1;
+		slot->vlan_desc = *entry->vlan_desc;
+	}
+
+	if ((entry->identity &&
+	     pmksa_file_add_attr(slot, PMKSA_FILE_ATTR_IDENTITY,
+				 entry->identity, entry->identity_len) < 0) ||
+	    (entry->cui &&
+	     pmksa_file_add_attr(slot, PMKSA_FILE_ATTR_CUI,
+				 wpabuf_head(entry->cui),
+				 wpabuf_len(entry->cui)) < 0))
+		return -1;
+#ifndef CONFIG_NO_RADIUS
+	for (i = 0; i < entry->radius_class.count; i++) {
+		if (pmksa_file_add_attr(slot, PMKSA_FILE_ATTR_CLASS,
+					entry->radius_class.attr[i].data,
+					entry->radius_class.attr[i].len) < 0)
+			return -1;
+	}
+#endif /* CONFIG_NO_RADIUS */
+
+	ad = ((const u8 *) slot) + PMKSA_FILE_AD_START;
+	ad_len = PMKSA_FILE_AD_LEN;
+	return aes_siv_encrypt(pmksa->file_key, pmksa->file_key_len,
+			       entry->pmk, entry->pmk_len, 1, &ad, &ad_len,
+			       slot->enc_pmk);
+}
+
+
+static void pmksa_file_store(struct rsn_pmksa_cache *pmksa,
+			     struct rsn_pmksa_cache_entry *entry)
+{
+	struct pmksa_file_slot *slot;
+	unsigned int idx;
+
+	if (!pmksa->file_slots || entry->file_slot)
+		return;
+	if (pmksa->file_num_free == 0) {
+		wpa_printf(MSG_DEBUG,
+			   "RSN: No free slot in PMKSA cache file for " MACSTR,
+			   MAC2STR(entry->spa));
+		return;
+	}
+
+	idx = pmksa->file_free[pmksa->file_num_free - 1];
+	slot = &pmksa->file_slots[idx];
+	os_memset(slot, 0, sizeof(*slot));
+	if (pmksa_file_fill_slot(pmksa, slot, entry) < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "RSN: Could not store PMKSA cache entry for " MACSTR
+			   " in the file", MAC2STR(entry->spa));
+		forced_memzero(slot, sizeof(*slot));
+		return;
+	}
+	slot->used = 1;
+	pmksa->file_num_free--;
+	entry->file_slot = idx + 1;
+}
+
+
+static void pmksa_file_remove(struct rsn_pmksa_cache *pmksa,
+			      struct rsn_pmksa_cache_entry *entry)
+{
+	unsigned int idx;
+
+	if (!pmksa->file_slots || !entry->file_slot)
+		return;
+	idx = entry->file_slot - 1;
+	entry->file_slot = 0;
+	pmksa->file_slots[idx].used = 0;
+	forced_memzero(&pmksa->file_slots[idx], sizeof(struct pmksa_file_slot));
+	pmksa->file_free[pmksa->file_num_free++] = idx;
+}
+
+
+static void pmksa_file_deinit(struct rsn_pmksa_cache *pmksa)
+{
+	if (pmksa->file_map)
+		munmap(pmksa->file_map, pmksa->file_len);
+	if (pmksa->file_fd >= 0)
+		close(pmksa->file_fd);
+	pmksa->file_fd = -1;
+	pmksa->file_map = NULL;
+	pmksa->file_slots = NULL;
+	os_free(pmksa->file_free);
+	pmksa->file_free = NULL;
+	forced_memzero(pmksa->file_key, sizeof(pmksa->file_key));
+}
+
+#else /* CONFIG_PMKSA_CACHE_FILE */
+
+static void pmksa_file_store(struct rsn_pmksa_cache *pmksa,
+			     struct rsn_pmksa_cache_entry *entry)
+{
+}
+
+
+static void pmksa_file_remove(struct rsn_pmksa_cache *pmksa,
+			      struct rsn_pmksa_cache_entry *entry)
+{
+}
+
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
+
 void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
 			    struct rsn_pmksa_cache_entry *entry)
 {
-	struct rsn_pmksa_cache_entry *pos, *prev;
-	unsigned int hash;
+	struct rsn_pmksa_cache_entry *last;
+	size_t idx = entry->expire_idx;
 
-	pmksa->pmksa_count--;
 	pmksa->free_cb(entry, pmksa->ctx);
 
-	/* unlink from hash list */
-	hash = PMKID_HASH(entry->pmkid);
-	pos = pmksa->pmkid[hash];
-	prev = NULL;
-	while (pos) {
-		if (pos == entry) {
-			if (prev != NULL)
-				prev->hnext = entry->hnext;
-			else
-				pmksa->pmkid[hash] = entry->hnext;
-			break;
-		}
-		prev = pos;
-		pos = pos->hnext;
-	}
-
-	/* unlink from entry list */
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
-		if (pos == entry) {
-			if (prev != NULL)
-				prev->next = entry->next;
-			else
-				pmksa->pmksa = entry->next;
-			break;
-		}
-		prev = pos;
-		pos = pos->next;
+	pmksa_file_remove(pmksa, entry);
+	dl_list_del(&entry->list);
+	hash_table_del(&pmksa->pmkid, &entry->pmkid_node);
+	hash_table_del(&pmksa->spa, &entry->spa_node);
+
+	/* Replace the entry in the expiration heap with the last one */
+	pmksa->pmksa_count--;
+	last = pmksa->expire[pmksa->pmksa_count];
+	if (idx < (size_t) pmksa->pmksa_count) {
+		pmksa_heap_set(pmksa, idx, last);
+		if (idx > 0 &&
+		    pmksa->expire[(idx - 1) / 2]->expiration > last->expiration)
+			pmksa_heap_up(pmksa, idx);
+		else
+			pmksa_heap_down(pmksa, idx);
 	}
 
 	_pmksa_cache_free_entry(entry);
@@ -98,10 +375,13 @@ void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
  */
 void pmksa_cache_auth_flush(struct rsn_pmksa_cache *pmksa)
 {
-	while (pmksa->pmksa) {
+	struct rsn_pmksa_cache_entry *entry;
+
+	while ((entry = dl_list_first(&pmksa->pmksa,
+				      struct rsn_pmksa_cache_entry, list))) {
 		wpa_printf(MSG_DEBUG, "RSN: Flush PMKSA cache entry for "
-			   MACSTR, MAC2STR(pmksa->pmksa->spa));
-		pmksa_cache_free_entry(pmksa, pmksa->pmksa);
+			   MACSTR, MAC2STR(entry->spa));
+		pmksa_cache_free_entry(pmksa, entry);
 	}
 }
 
@@ -109,13 +389,15 @@ void pmksa_cache_auth_flush(struct rsn_pmksa_cache *pmksa)
 static void pmksa_cache_expire(void *eloop_ctx, void *timeout_ctx)
 {
 	struct rsn_pmksa_cache *pmksa = eloop_ctx;
+	struct rsn_pmksa_cache_entry *entry;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
-	while (pmksa->pmksa && pmksa->pmksa->expiration <= now.sec) {
+	while ((entry = pmksa_cache_first_expiring(pmksa)) &&
+	       entry->expiration <= now.sec) {
 		wpa_printf(MSG_DEBUG, "RSN: expired PMKSA cache entry for "
-			   MACSTR, MAC2STR(pmksa->pmksa->spa));
-		pmksa_cache_free_entry(pmksa, pmksa->pmksa);
+			   MACSTR, MAC2STR(entry->spa));
+		pmksa_cache_free_entry(pmksa, entry);
 	}
 
 	pmksa_cache_set_expiration(pmksa);
@@ -124,14 +406,16 @@ static void pmksa_cache_expire(void *eloop_ctx, void *timeout_ctx)
 
 static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa)
 {
+	struct rsn_pmksa_cache_entry *entry;
 	int sec;
 	struct os_reltime now;
 
 	eloop_cancel_timeout(pmksa_cache_expire, pmksa, NULL);
-	if (pmksa->pmksa == NULL)
+	entry = pmksa_cache_first_expiring(pmksa);
+	if (entry == NULL)
 		return;
 	os_get_reltime(&now);
-	sec = pmksa->pmksa->expiration - now.sec;
+	sec = entry->expiration - now.sec;
 	if (sec < 0)
 		sec = 0;
 	eloop_register_timeout(sec + 1, 0, pmksa_cache_expire, pmksa, NULL);
@@ -219,39 +503,33 @@ void pmksa_cache_to_eapol_data(struct hostapd_data *hapd,
 }
 
 
-static void pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
-				   struct rsn_pmksa_cache_entry *entry)
+static int pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
+				  struct rsn_pmksa_cache_entry *entry)
 {
-	struct rsn_pmksa_cache_entry *pos, *prev;
-	int hash;
-
-	/* Add the new entry; order by expiration time */
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
-		if (pos->expiration > entry->expiration)
-			break;
-		prev = pos;
-		pos = pos->next;
-	}
-	if (prev == NULL) {
-		entry->next = pmksa->pmksa;
-		pmksa->pmksa = entry;
-	} else {
-		entry->next = prev->next;
-		prev->next = entry;
+	if (pmksa_heap_reserve(pmksa) < 0)
+		return -1;
+	if (hash_table_add(&pmksa->pmkid, &entry->pmkid_node, entry->pmkid,
+			   PMKID_LEN) < 0)
+		return -1;
+	if (hash_table_add(&pmksa->spa, &entry->spa_node, entry->spa,
+			   ETH_ALEN) < 0) {
+		hash_table_del(&pmksa->pmkid, &entry->pmkid_node);
+		return -1;
 	}
 
-	hash = PMKID_HASH(entry->pmkid);
-	entry->hnext = pmksa->pmkid[hash];
-	pmksa->pmkid[hash] = entry;
-
+	dl_list_add_tail(&pmksa->pmksa, &entry->list);
+	pmksa_heap_set(pmksa, pmksa->pmksa_count, entry);
 	pmksa->pmksa_count++;
-	if (prev == NULL)
+	pmksa_heap_up(pmksa, entry->expire_idx);
+
+	if (entry->expire_idx == 0)
 		pmksa_cache_set_expiration(pmksa);
+	pmksa_file_store(pmksa, entry);
 	wpa_printf(MSG_DEBUG, "RSN: added PMKSA cache entry for " MACSTR,
 		   MAC2STR(entry->spa));
 	wpa_hexdump(MSG_DEBUG, "RSN: added PMKID", entry->pmkid, PMKID_LEN);
+
+	return 0;
 }
 
 
@@ -288,8 +566,11 @@ pmksa_cache_auth_add(struct rsn_pmksa_cache *pmksa,
 					      aa, spa, session_timeout, eapol,
 					      akmp);
 
-	if (pmksa_cache_auth_add_entry(pmksa, entry) < 0)
+	if (pmksa_cache_auth_add_entry(pmksa, entry) < 0) {
+		if (entry)
+			_pmksa_cache_free_entry(entry);
 		return NULL;
+	}
 
 	return entry;
 }
@@ -376,17 +657,16 @@ int pmksa_cache_auth_add_entry(struct rsn_pmksa_cache *pmksa,
 	if (pos)
 		pmksa_cache_free_entry(pmksa, pos);
 
-	if (pmksa->pmksa_count >= pmksa_cache_max_entries && pmksa->pmksa) {
+	if (pmksa->pmksa_count >= pmksa_cache_max_entries) {
 		/* Remove the oldest entry to make room for the new entry */
+		pos = pmksa_cache_first_expiring(pmksa);
 		wpa_printf(MSG_DEBUG, "RSN: removed the oldest PMKSA cache "
 			   "entry (for " MACSTR ") to make room for new one",
-			   MAC2STR(pmksa->pmksa->spa));
-		pmksa_cache_free_entry(pmksa, pmksa->pmksa);
+			   MAC2STR(pos->spa));
+		pmksa_cache_free_entry(pmksa, pos);
 	}
 
-	pmksa_cache_link_entry(pmksa, entry);
-
-	return 0;
+	return pmksa_cache_link_entry(pmksa, entry);
 }
 
 
@@ -430,7 +710,10 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 	}
 	entry->opportunistic = 1;
 
-	pmksa_cache_link_entry(pmksa, entry);
+	if (pmksa_cache_link_entry(pmksa, entry) < 0) {
+		_pmksa_cache_free_entry(entry);
+		return NULL;
+	}
 
 	return entry;
 }
@@ -443,22 +726,21 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 void pmksa_cache_auth_deinit(struct rsn_pmksa_cache *pmksa)
 {
 	struct rsn_pmksa_cache_entry *entry, *prev;
-	int i;
 
 	if (pmksa == NULL)
 		return;
 
-	entry = pmksa->pmksa;
-	while (entry) {
-		prev = entry;
-		entry = entry->next;
-		_pmksa_cache_free_entry(prev);
-	}
+	dl_list_for_each_safe(entry, prev, &pmksa->pmksa,
+			      struct rsn_pmksa_cache_entry, list)
+		_pmksa_cache_free_entry(entry);
 	eloop_cancel_timeout(pmksa_cache_expire, pmksa, NULL);
 	pmksa->pmksa_count = 0;
-	pmksa->pmksa = NULL;
-	for (i = 0; i < PMKID_HASH_SIZE; i++)
-		pmksa->pmkid[i] = NULL;
+	hash_table_deinit(&pmksa->pmkid);
+	hash_table_deinit(&pmksa->spa);
+	os_free(pmksa->expire);
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	pmksa_file_deinit(pmksa);
+#endif /* CONFIG_PMKSA_CACHE_FILE */
 	os_free(pmksa);
 }
 
@@ -474,25 +756,35 @@ struct rsn_pmksa_cache_entry *
 pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
 		     const u8 *spa, const u8 *pmkid)
 {
-	struct rsn_pmksa_cache_entry *entry;
+	struct rsn_pmksa_cache_entry *entry, *found = NULL;
+	struct hash_node *node;
 
 	if (pmkid) {
-		for (entry = pmksa->pmkid[PMKID_HASH(pmkid)]; entry;
-		     entry = entry->hnext) {
-			if ((spa == NULL ||
-			     os_memcmp(entry->spa, spa, ETH_ALEN) == 0) &&
-			    os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0)
-				return entry;
-		}
-	} else {
-		for (entry = pmksa->pmksa; entry; entry = entry->next) {
+		for (node = hash_table_get(&pmksa->pmkid, pmkid, PMKID_LEN);
+		     node; node = hash_table_get_next(&pmksa->pmkid, node)) {
+			entry = hash_table_entry(node,
+						 struct rsn_pmksa_cache_entry,
+						 pmkid_node);
 			if (spa == NULL ||
 			    os_memcmp(entry->spa, spa, ETH_ALEN) == 0)
 				return entry;
 		}
+	} else if (spa) {
+		/* Prefer the entry that expires first like the full list
+		 * search in expiration order used to do */
+		for (node = hash_table_get(&pmksa->spa, spa, ETH_ALEN);
+		     node; node = hash_table_get_next(&pmksa->spa, node)) {
+			entry = hash_table_entry(node,
+						 struct rsn_pmksa_cache_entry,
+						 spa_node);
+			if (!found || entry->expiration < found->expiration)
+				found = entry;
+		}
+	} else {
+		found = pmksa_cache_first_expiring(pmksa);
 	}
 
-	return NULL;
+	return found;
 }
 
 
@@ -511,11 +803,13 @@ struct rsn_pmksa_cache_entry * pmksa_cache_get_okc(
 	const u8 *pmkid)
 {
 	struct rsn_pmksa_cache_entry *entry;
+	struct hash_node *node;
 	u8 new_pmkid[PMKID_LEN];
 
-	for (entry = pmksa->pmksa; entry; entry = entry->next) {
-		if (os_memcmp(entry->spa, spa, ETH_ALEN) != 0)
-			continue;
+	for (node = hash_table_get(&pmksa->spa, spa, ETH_ALEN); node;
+	     node = hash_table_get_next(&pmksa->spa, node)) {
+		entry = hash_table_entry(node, struct rsn_pmksa_cache_entry,
+					 spa_node);
 		if (wpa_key_mgmt_sae(entry->akmp)) {
 			if (os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0)
 				return entry;
@@ -544,14 +838,254 @@ pmksa_cache_auth_init(void (*free_cb)(struct rsn_pmksa_cache_entry *entry,
 
 	pmksa = os_zalloc(sizeof(*pmksa));
 	if (pmksa) {
+		dl_list_init(&pmksa->pmksa);
 		pmksa->free_cb = free_cb;
 		pmksa->ctx = ctx;
+#ifdef CONFIG_PMKSA_CACHE_FILE
+		pmksa->file_fd = -1;
+#endif /* CONFIG_PMKSA_CACHE_FILE */
 	}
 
 	return pmksa;
 }
 
 
+#ifdef CONFIG_PMKSA_CACHE_FILE
+
+static int pmksa_file_parse_attrs(struct rsn_pmksa_cache_entry *entry,
+				  const struct pmksa_file_slot *slot)
+{
+	const u8 *pos = slot->attr, *end = slot->attr + slot->attr_len;
+	u8 type;
+	u16 len;
+
+	while (end - pos >= 3) {
+		type = *pos++;
+		len = WPA_GET_LE16(pos);
+		pos += 2;
+		if (len > end - pos)
+			return -1;
+
+		switch (type) {
+		case PMKSA_FILE_ATTR_IDENTITY:
+			os_free(entry->identity);
+			entry->identity = os_memdup(pos, len);
+			if (!entry->identity)
+				return -1;
+			entry->identity_len = len;
+			break;
+		case PMKSA_FILE_ATTR_CUI:
+			wpabuf_free(entry->cui);
+			entry->cui = wpabuf_alloc_copy(pos, len);
+			if (!entry->cui)
+				return -1;
+			break;
+#ifndef CONFIG_NO_RADIUS
+		case PMKSA_FILE_ATTR_CLASS: {
+			struct radius_class_data *c = &entry->radius_class;
+			struct radius_attr_data *n;
+
+			n = os_realloc_array(c->attr, c->count + 1,
+					     sizeof(*n));
+			if (!n)
+				return -1;
+			c->attr = n;
+			n = &c->attr[c->count];
+			n->data = os_memdup(pos, len);
+			if (!n->data)
+				return -1;
+			n->len = len;
+			c->count++;
+			break;
+		}
+#endif /* CONFIG_NO_RADIUS */
+		}
+		pos += len;
+	}
+
+	return 0;
+}
+
+
+static struct rsn_pmksa_cache_entry *
+pmksa_file_load_slot(struct rsn_pmksa_cache *pmksa,
+		     const struct pmksa_file_slot *slot, os_time_t now,
+		     os_time_t wall)
+{
+	struct rsn_pmksa_cache_entry *entry;
+	const u8 *ad;
+	size_t ad_len;
+
+	if (slot->pmk_len > PMK_LEN_MAX ||
+	    slot->attr_len > PMKSA_FILE_ATTR_LEN ||
+	    slot->expiration <= wall)
+		return NULL;
+
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return NULL;
+
+	ad = ((const u8 *) slot) + PMKSA_FILE_AD_START;
+	ad_len = PMKSA_FILE_AD_LEN;
+	if (aes_siv_decrypt(pmksa->file_key, pmksa->file_key_len,
+			    slot->enc_pmk, AES_BLOCK_SIZE + slot->pmk_len,
+			    1, &ad, &ad_len, entry->pmk) < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "RSN: Could not decrypt PMKSA cache file entry for "
+			   MACSTR, MAC2STR(slot->spa));
+		goto fail;
+	}
+
+	entry->pmk_len = slot->pmk_len;
+	entry->expiration = now + (slot->expiration - wall);
+	entry->akmp = slot->akmp;
+	entry->acct_multi_session_id = slot->acct_multi_session_id;
+	os_memcpy(entry->spa, slot->spa, ETH_ALEN);
+	os_memcpy(entry->pmkid, slot->pmkid, PMKID_LEN);
+	entry->opportunistic = slot->opportunistic;
+	entry->eap_type_authsrv = slot->eap_type_authsrv;
+	if (slot->vlan_set) {
+		entry->vlan_desc = os_memdup(&slot->vlan_desc,
+					     sizeof(slot->vlan_desc));
+		if (!entry->vlan_desc)
+			goto fail;
+	}
+	if (pmksa_file_parse_attrs(entry, slot) < 0)
+		goto fail;
+
+	return entry;
+fail:
+	_pmksa_cache_free_entry(entry);
+	return NULL;
+}
+
+
+static void pmksa_file_load(struct rsn_pmksa_cache *pmksa)
+{
+	struct rsn_pmksa_cache_entry *entry;
+	struct pmksa_file_slot *slot;
+	struct os_reltime now;
+	struct os_time wall;
+	unsigned int i;
+
+	os_get_reltime(&now);
+	os_get_time(&wall);
+
+	for (i = 0; i < pmksa->file_num_slots; i++) {
+		slot = &pmksa->file_slots[i];
+		if (!slot->used)
+			continue;
+
+		entry = NULL;
+		if (pmksa->pmksa_count < pmksa_cache_max_entries)
+			entry = pmksa_file_load_slot(pmksa, slot, now.sec,
+						     wall.sec);
+		if (entry) {
+			entry->file_slot = i + 1;
+			if (pmksa_cache_link_entry(pmksa, entry) == 0)
+				continue;
+			_pmksa_cache_free_entry(entry);
+		}
+
+		/* Expired or invalid entry */
+		forced_memzero(slot, sizeof(*slot));
+	}
+
+	for (i = pmksa->file_num_slots; i > 0; i--) {
+		if (!pmksa->file_slots[i - 1].used)
+			pmksa->file_free[pmksa->file_num_free++] = i - 1;
+	}
+}
+
+
+/**
+ * pmksa_cache_auth_set_file - Store PMKSA cache entries in a file
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * @fname: File for the PMKSA cache entries
+ * @key: AES-SIV key for protecting the PMKs in the file
+ * @key_len: Length of the key (32, 48, or 64 octets)
+ * Returns: 0 on success, -1 on failure
+ *
+ * This function is called right after pmksa_cache_auth_init() to reload the
+ * entries that were stored by a previous instance and have not yet expired.
+ * After this, entries are written to the file as they are added and cleared
+ * from it as they are removed. pmksa_cache_auth_deinit() leaves the current
+ * entries in the file.
+ */
+int pmksa_cache_auth_set_file(struct rsn_pmksa_cache *pmksa, const char *fname,
+			      const u8 *key, size_t key_len)
+{
+	struct pmksa_file_hdr *hdr;
+	struct stat st;
+	unsigned int num_slots = pmksa_cache_max_entries;
+	size_t len;
+
+	if (pmksa->file_map || pmksa->pmksa_count ||
+	    (key_len != 32 && key_len != 48 && key_len != 64))
+		return -1;
+
+	os_memcpy(pmksa->file_key, key, key_len);
+	pmksa->file_key_len = key_len;
+	len = sizeof(*hdr) + num_slots * sizeof(struct pmksa_file_slot);
+
+	pmksa->file_fd = open(fname, O_RDWR | O_CREAT, 0600);
+	if (pmksa->file_fd < 0) {
+		wpa_printf(MSG_ERROR, "RSN: Could not open %s: %s",
+			   fname, strerror(errno));
+		goto fail;
+	}
+	if (fstat(pmksa->file_fd, &st) < 0 ||
+	    ((size_t) st.st_size != len &&
+	     (ftruncate(pmksa->file_fd, 0) < 0 ||
+	      ftruncate(pmksa->file_fd, len) < 0))) {
+		wpa_printf(MSG_ERROR, "RSN: Could not set size of %s: %s",
+			   fname, strerror(errno));
+		goto fail;
+	}
+
+	pmksa->file_map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+			       pmksa->file_fd, 0);
+	if (pmksa->file_map == MAP_FAILED) {
+		wpa_printf(MSG_ERROR, "RSN: Could not map %s: %s",
+			   fname, strerror(errno));
+		pmksa->file_map = NULL;
+		goto fail;
+	}
+	pmksa->file_len = len;
+
+	pmksa->file_free = os_calloc(num_slots, sizeof(unsigned int));
+	if (!pmksa->file_free)
+		goto fail;
+
+	hdr = (struct pmksa_file_hdr *) pmksa->file_map;
+	if (os_memcmp(hdr->magic, PMKSA_FILE_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != PMKSA_FILE_VERSION ||
+	    hdr->slot_len != sizeof(struct pmksa_file_slot) ||
+	    hdr->num_slots != num_slots) {
+		wpa_printf(MSG_DEBUG, "RSN: Initialize PMKSA cache file %s",
+			   fname);
+		os_memset(pmksa->file_map, 0, len);
+		os_memcpy(hdr->magic, PMKSA_FILE_MAGIC, sizeof(hdr->magic));
+		hdr->version = PMKSA_FILE_VERSION;
+		hdr->slot_len = sizeof(struct pmksa_file_slot);
+		hdr->num_slots = num_slots;
+	}
+	pmksa->file_slots = (struct pmksa_file_slot *) (hdr + 1);
+	pmksa->file_num_slots = num_slots;
+
+	pmksa_file_load(pmksa);
+	wpa_printf(MSG_DEBUG, "RSN: Loaded %d PMKSA cache entries from %s",
+		   pmksa->pmksa_count, fname);
+
+	return 0;
+fail:
+	pmksa_file_deinit(pmksa);
+	return -1;
+}
+
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
+
 static int das_attr_match(struct rsn_pmksa_cache_entry *entry,
 			  struct radius_das_attrs *attr)
 {
@@ -601,21 +1135,17 @@ int pmksa_cache_auth_radius_das_disconnect(struct rsn_pmksa_cache *pmksa,
 					   struct radius_das_attrs *attr)
 {
 	int found = 0;
-	struct rsn_pmksa_cache_entry *entry, *prev;
+	struct rsn_pmksa_cache_entry *entry, *n;
 
 	if (attr->acct_session_id)
 		return -1;
 
-	entry = pmksa->pmksa;
-	while (entry) {
+	dl_list_for_each_safe(entry, n, &pmksa->pmksa,
+			      struct rsn_pmksa_cache_entry, list) {
 		if (das_attr_match(entry, attr)) {
 			found++;
-			prev = entry;
-			entry = entry->next;
-			pmksa_cache_free_entry(pmksa, prev);
-			continue;
+			pmksa_cache_free_entry(pmksa, entry);
 		}
-		entry = entry->next;
 	}
 
 	return found ? 0 : -1;
@@ -646,8 +1176,8 @@ int pmksa_cache_auth_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len)
 		return pos - buf;
 	pos += ret;
 	i = 0;
-	entry = pmksa->pmksa;
-	while (entry) {
+	dl_list_for_each(entry, &pmksa->pmksa, struct rsn_pmksa_cache_entry,
+			 list) {
 		ret = os_snprintf(pos, buf + len - pos, "%d " MACSTR " ",
 				  i, MAC2STR(entry->spa));
 		if (os_snprintf_error(buf + len - pos, ret))
@@ -661,7 +1191,6 @@ int pmksa_cache_auth_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len)
 		if (os_snprintf_error(buf + len - pos, ret))
 			return pos - buf;
 		pos += ret;
-		entry = entry->next;
 	}
 	return pos - buf;
 }
@@ -699,7 +1228,8 @@ int pmksa_cache_auth_list_mesh(struct rsn_pmksa_cache *pmksa, const u8 *addr,
 	 * Entry format:
 	 * <BSSID> <PMKID> <PMK> <expiration in seconds>
 	 */
-	for (entry = pmksa->pmksa; entry; entry = entry->next) {
+	dl_list_for_each(entry, &pmksa->pmksa, struct rsn_pmksa_cache_entry,
+			 list) {
 		if (addr && os_memcmp(entry->spa, addr, ETH_ALEN) != 0)
 			continue;
 
@@ -9,13 +9,19 @@
 #ifndef PMKSA_CACHE_H
 #define PMKSA_CACHE_H
 
+#include "utils/list.h"
+#include "utils/hash_table.h"
 #include "radius/radius.h"
 
 /**
  * struct rsn_pmksa_cache_entry - PMKSA cache entry
  */
 struct rsn_pmksa_cache_entry {
-	struct rsn_pmksa_cache_entry *next, *hnext;
+	struct dl_list list;
+	struct hash_node pmkid_node;
+	struct hash_node spa_node;
+	size_t expire_idx;
+	unsigned int file_slot; /* slot + 1 in pmksa_cache_file or 0 */
 	u8 pmkid[PMKID_LEN];
 	u8 pmk[PMK_LEN_MAX];
 	size_t pmk_len;
@@ -41,6 +47,8 @@ struct rsn_pmksa_cache *
 pmksa_cache_auth_init(void (*free_cb)(struct rsn_pmksa_cache_entry *entry,
 				      void *ctx), void *ctx);
 void pmksa_cache_auth_deinit(struct rsn_pmksa_cache *pmksa);
+int pmksa_cache_auth_set_file(struct rsn_pmksa_cache *pmksa, const char *fname,
+			      const u8 *key, size_t key_len);
 struct rsn_pmksa_cache_entry *
 pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
 		     const u8 *spa, const u8 *pmkid);
@@ -68,12 +68,12 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta)
 {
-	struct sta_info *s;
+	struct hash_node *node;
 
-	s = hapd->sta_hash[STA_HASH(sta)];
-	while (s != NULL && os_memcmp(s->addr, sta, 6) != 0)
-		s = s->hnext;
-	return s;
+	node = hash_table_get(&hapd->sta_hash, sta, ETH_ALEN);
+	if (!node)
+		return NULL;
+	return hash_table_entry(node, struct sta_info, hnode);
 }
 
 
@@ -121,32 +121,16 @@ static void ap_sta_list_del(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
-void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta)
+int ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	sta->hnext = hapd->sta_hash[STA_HASH(sta->addr)];
-	hapd->sta_hash[STA_HASH(sta->addr)] = sta;
+	return hash_table_add(&hapd->sta_hash, &sta->hnode, sta->addr,
+			      ETH_ALEN);
 }
 
 
 static void ap_sta_hash_del(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	struct sta_info *s;
-
-	s = hapd->sta_hash[STA_HASH(sta->addr)];
-	if (s == NULL) return;
-	if (os_memcmp(s->addr, sta->addr, 6) == 0) {
-		hapd->sta_hash[STA_HASH(sta->addr)] = s->hnext;
-		return;
-	}
-
-	while (s->hnext != NULL &&
-	       os_memcmp(s->hnext->addr, sta->addr, ETH_ALEN) != 0)
-		s = s->hnext;
-	if (s->hnext != NULL)
-		s->hnext = s->hnext->hnext;
-	else
-		wpa_printf(MSG_DEBUG, "AP: could not remove STA " MACSTR
-			   " from hash table", MAC2STR(sta->addr));
+	hash_table_del(&hapd->sta_hash, &sta->hnode);
 }
 
 
@@ -335,6 +319,8 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 	os_free(sta->hs20_session_info_url);
 
 #ifdef CONFIG_SAE
+	if (sta->sae_job)
+		auth_sae_job_detach(sta);
 	sae_clear_data(sta->sae);
 	os_free(sta->sae);
 #endif /* CONFIG_SAE */
@@ -397,6 +383,7 @@ void hostapd_free_stas(struct hostapd_data *hapd)
 			   MAC2STR(prev->addr));
 		ap_free_sta(hapd, prev);
 	}
+	hash_table_deinit(&hapd->sta_hash);
 }
 
 
@@ -717,10 +704,14 @@ struct sta_info * ap_sta_add(struct hostapd_data *hapd, const u8 *addr)
 
 	/* initialize STA info data */
 	os_memcpy(sta->addr, addr, ETH_ALEN);
+	if (ap_sta_hash_add(hapd, sta) < 0) {
+		eloop_cancel_timeout(ap_handle_timer, hapd, sta);
+		os_free(sta);
+		return NULL;
+	}
 	sta->next = hapd->sta_list;
 	hapd->sta_list = sta;
 	hapd->num_sta++;
-	ap_sta_hash_add(hapd, sta);
 	ap_sta_remove_in_other_bss(hapd, sta);
 	sta->last_seq_ctrl = WLAN_INVALID_MGMT_SEQ;
 	dl_list_init(&sta->ip6addr);
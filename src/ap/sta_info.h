@@ -11,6 +11,7 @@
 
 #include "common/defs.h"
 #include "list.h"
+#include "hash_table.h"
 #include "vlan.h"
 #include "common/wpa_common.h"
 #include "common/ieee802_11_defs.h"
@@ -64,7 +65,7 @@ struct pending_eapol_rx {
 
 struct sta_info {
 	struct sta_info *next; /* next entry in sta list */
-	struct sta_info *hnext; /* next entry in hash table list */
+	struct hash_node hnode; /* entry in hapd->sta_hash */
 	u8 addr[6];
 	be32 ipaddr;
 	struct dl_list ip6addr; /* list head for struct ip6addr */
@@ -112,7 +113,6 @@ struct sta_info {
 	unsigned int remediation:1;
 	unsigned int hs20_deauth_requested:1;
 	unsigned int session_timeout_set:1;
-	unsigned int radius_das_match:1;
 	unsigned int ecsa_supported:1;
 	unsigned int added_unassoc:1;
 	unsigned int pending_wds_enable:1;
@@ -143,6 +143,7 @@ struct sta_info {
 	int acct_terminate_cause; /* Acct-Terminate-Cause */
 	int acct_interim_interval; /* Acct-Interim-Interval */
 	unsigned int acct_interim_errors;
+	struct os_reltime acct_next_update; /* next interim update/poll */
 
 	/* For extending 32-bit driver counters to 64-bit counters */
 	u32 last_rx_bytes_hi;
@@ -204,6 +205,7 @@ struct sta_info {
 
 #ifdef CONFIG_SAE
 	struct sae_data *sae;
+	struct hostapd_sae_job *sae_job; /* commit processing in progress */
 	unsigned int mesh_sae_pmksa_caching:1;
 #endif /* CONFIG_SAE */
 
@@ -308,7 +310,7 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 		    void *ctx);
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta);
 struct sta_info * ap_get_sta_p2p(struct hostapd_data *hapd, const u8 *addr);
-void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
+int ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_sta_ip6addr_del(struct hostapd_data *hapd, struct sta_info *sta);
 void hostapd_free_stas(struct hostapd_data *hapd);
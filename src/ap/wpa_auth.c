@@ -12,6 +12,7 @@
 #include "utils/eloop.h"
 #include "utils/state_machine.h"
 #include "utils/bitfield.h"
+#include "utils/worker_pool.h"
 #include "common/ieee802_11_defs.h"
 #include "common/ocv.h"
 #include "crypto/aes.h"
@@ -502,6 +503,16 @@ struct wpa_authenticator * wpa_init(const u8 *addr,
 		return NULL;
 	}
 
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	if (conf->pmksa_cache_file &&
+	    pmksa_cache_auth_set_file(wpa_auth->pmksa, conf->pmksa_cache_file,
+				      conf->pmksa_cache_file_key,
+				      conf->pmksa_cache_file_key_len) < 0)
+		wpa_printf(MSG_INFO,
+			   "RSN: Could not use PMKSA cache file %s - entries will not be stored",
+			   conf->pmksa_cache_file);
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
 #ifdef CONFIG_IEEE80211R_AP
 	wpa_auth->ft_pmk_cache = wpa_ft_pmk_cache_init();
 	if (!wpa_auth->ft_pmk_cache) {
@@ -524,6 +535,14 @@ struct wpa_authenticator * wpa_init(const u8 *addr,
 				       wpa_rekey_gtk, wpa_auth, NULL);
 	}
 
+	if (wpa_auth->conf.psk_trial_threads) {
+		wpa_auth->psk_trial_pool =
+			worker_pool_init(wpa_auth->conf.psk_trial_threads);
+		if (!wpa_auth->psk_trial_pool)
+			wpa_printf(MSG_INFO,
+				   "WPA: Could not start PSK trial threads - check candidate PSKs in the main thread");
+	}
+
 #ifdef CONFIG_P2P
 	if (WPA_GET_BE32(conf->ip_addr_start)) {
 		int count = WPA_GET_BE32(conf->ip_addr_end) -
@@ -566,6 +585,7 @@ void wpa_deinit(struct wpa_authenticator *wpa_auth)
 	eloop_cancel_timeout(wpa_rekey_gtk, wpa_auth, NULL);
 
 	pmksa_cache_auth_deinit(wpa_auth->pmksa);
+	worker_pool_deinit(wpa_auth->psk_trial_pool);
 
 #ifdef CONFIG_IEEE80211R_AP
 	wpa_ft_pmk_cache_deinit(wpa_auth->ft_pmk_cache);
@@ -604,6 +624,12 @@ int wpa_reconfig(struct wpa_authenticator *wpa_auth,
 	if (!wpa_auth)
 		return 0;
 
+	if (conf->psk_trial_threads != wpa_auth->conf.psk_trial_threads) {
+		worker_pool_deinit(wpa_auth->psk_trial_pool);
+		wpa_auth->psk_trial_pool =
+			worker_pool_init(conf->psk_trial_threads);
+	}
+
 	os_memcpy(&wpa_auth->conf, conf, sizeof(*conf));
 	if (wpa_auth_gen_wpa_ie(wpa_auth)) {
 		wpa_printf(MSG_ERROR, "Could not generate WPA IE.");
@@ -911,6 +937,89 @@ static int wpa_receive_error_report(struct wpa_authenticator *wpa_auth,
 }
 
 
+/*
+ * Find the PSK that was used for the Key MIC of EAPOL-Key msg 2/4 by checking
+ * all the candidate PSKs for the STA in one batch. Returns 1 if a matching PSK
+ * was found (sm->PMK and ptk have been set), 0 if none of the candidates
+ * matched, or -1 if the batch cannot be used with the negotiated AKM and the
+ * caller needs to go through the candidates with wpa_derive_ptk() and
+ * wpa_verify_key_mic().
+ */
+static int wpa_try_psks(struct wpa_state_machine *sm, const u8 *snonce,
+			const u8 *data, size_t data_len, struct wpa_ptk *ptk,
+			int *vlan_id, int *psk_found)
+{
+	struct wpa_authenticator *wpa_auth = sm->wpa_auth;
+	struct wpa_pmk_trial trial;
+	const u8 **pmk = NULL, **npmk, *psk = NULL;
+	int *vlan = NULL, *nvlan, psk_vlan_id = 0, idx, res = -1;
+	size_t num = 0, size = 0, psk_len;
+
+	if (!wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt) ||
+	    wpa_key_mgmt_sae(sm->wpa_key_mgmt) ||
+	    wpa_key_mgmt_ft(sm->wpa_key_mgmt))
+		return -1;
+
+	if (wpa_pmk_trial_init(&trial, "Pairwise key expansion",
+			       wpa_auth->addr, sm->addr, sm->ANonce, snonce,
+			       sm->wpa_key_mgmt, sm->pairwise, PMK_LEN,
+			       data, data_len) < 0)
+		return -1;
+
+	while ((psk = wpa_auth_get_psk(wpa_auth, sm->addr, sm->p2p_dev_addr,
+				       psk, &psk_len, &psk_vlan_id))) {
+		if (psk_len != PMK_LEN)
+			goto out;
+		if (num == size) {
+			size = size ? 2 * size : 16;
+			npmk = os_realloc_array(pmk, size, sizeof(*pmk));
+			if (!npmk)
+				goto out;
+			pmk = npmk;
+			nvlan = os_realloc_array(vlan, size, sizeof(*vlan));
+			if (!nvlan)
+				goto out;
+			vlan = nvlan;
+		}
+		pmk[num] = psk;
+		vlan[num] = psk_vlan_id;
+		num++;
+	}
+
+	res = 0;
+	if (num == 0)
+		goto out;
+	if (psk_found)
+		*psk_found = 1;
+
+	idx = wpa_pmk_trial_find(&trial, wpa_auth->psk_trial_pool, pmk, num);
+	if (idx < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "WPA: None of the %zu candidate PSKs matched the Key MIC",
+			   num);
+		goto out;
+	}
+	wpa_printf(MSG_DEBUG,
+		   "WPA: Candidate PSK %d/%zu matched the Key MIC",
+		   idx + 1, num);
+
+	if (wpa_derive_ptk(sm, snonce, pmk[idx], PMK_LEN, ptk, 0) < 0)
+		goto out;
+	if (sm->PMK != pmk[idx]) {
+		os_memcpy(sm->PMK, pmk[idx], PMK_LEN);
+		sm->pmk_len = PMK_LEN;
+	}
+	*vlan_id = vlan[idx];
+	res = 1;
+
+out:
+	wpa_pmk_trial_deinit(&trial);
+	os_free(pmk);
+	os_free(vlan);
+	return res;
+}
+
+
 static int wpa_try_alt_snonce(struct wpa_state_machine *sm, u8 *data,
 			      size_t data_len)
 {
@@ -919,8 +1028,16 @@ static int wpa_try_alt_snonce(struct wpa_state_machine *sm, u8 *data,
 	const u8 *pmk = NULL;
 	size_t pmk_len;
 	int vlan_id = 0;
+	int res;
 
 	os_memset(&PTK, 0, sizeof(PTK));
+	res = wpa_try_psks(sm, sm->alt_SNonce, data, data_len, &PTK, &vlan_id,
+			   NULL);
+	if (res >= 0) {
+		ok = res;
+		goto psks_tried;
+	}
+
 	for (;;) {
 		if (wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt) &&
 		    !wpa_key_mgmt_sae(sm->wpa_key_mgmt)) {
@@ -959,6 +1076,7 @@ static int wpa_try_alt_snonce(struct wpa_state_machine *sm, u8 *data,
 			break;
 	}
 
+psks_tried:
 	if (!ok) {
 		wpa_printf(MSG_DEBUG,
 			   "WPA: Earlier SNonce did not result in matching MIC");
@@ -2880,6 +2998,7 @@ SM_STATE(WPA_PTK, PTKCALCNEGOTIATING)
 	struct wpa_eapol_ie_parse kde;
 	int vlan_id = 0;
 	int owe_ptk_workaround = !!wpa_auth->conf.owe_ptk_workaround;
+	int res;
 
 	SM_ENTRY_MA(WPA_PTK, PTKCALCNEGOTIATING, wpa_ptk);
 	sm->EAPOLKeyReceived = FALSE;
@@ -2888,6 +3007,14 @@ SM_STATE(WPA_PTK, PTKCALCNEGOTIATING)
 
 	mic_len = wpa_mic_len(sm->wpa_key_mgmt, sm->pmk_len);
 
+	res = wpa_try_psks(sm, sm->SNonce, sm->last_rx_eapol_key,
+			   sm->last_rx_eapol_key_len, &PTK, &vlan_id,
+			   &psk_found);
+	if (res >= 0) {
+		ok = res;
+		goto psks_tried;
+	}
+
 	/* WPA with IEEE 802.1X: use the derived PMK from EAP
 	 * WPA-PSK: iterate through possible PSKs and select the one matching
 	 * the packet */
@@ -2957,6 +3084,7 @@ SM_STATE(WPA_PTK, PTKCALCNEGOTIATING)
 			break;
 	}
 
+psks_tried:
 	if (!ok) {
 		wpa_auth_logger(sm->wpa_auth, sm->addr, LOGGER_DEBUG,
 				"invalid MIC in msg 2/4 of 4-Way Handshake");
@@ -181,6 +181,7 @@ struct wpa_auth_config {
 	u32 wpa_group_update_count;
 	u32 wpa_pairwise_update_count;
 	int wpa_disable_eapol_key_retries;
+	unsigned int psk_trial_threads;
 	int rsn_pairwise;
 	int rsn_preauth;
 	int eapol_version;
@@ -188,6 +189,11 @@ struct wpa_auth_config {
 	int wmm_uapsd;
 	int disable_pmksa_caching;
 	int okc;
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	const char *pmksa_cache_file;
+	const u8 *pmksa_cache_file_key;
+	size_t pmksa_cache_file_key_len;
+#endif /* CONFIG_PMKSA_CACHE_FILE */
 	int tx_status;
 	enum mfp_options ieee80211w;
 	int beacon_prot;
@@ -52,6 +52,7 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->wpa_group_update_count = conf->wpa_group_update_count;
 	wconf->wpa_disable_eapol_key_retries =
 		conf->wpa_disable_eapol_key_retries;
+	wconf->psk_trial_threads = conf->wpa_psk_trial_threads;
 	wconf->wpa_pairwise_update_count = conf->wpa_pairwise_update_count;
 	wconf->rsn_pairwise = conf->rsn_pairwise;
 	wconf->rsn_preauth = conf->rsn_preauth;
@@ -67,6 +68,11 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->ocv = conf->ocv;
 #endif /* CONFIG_OCV */
 	wconf->okc = conf->okc;
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	wconf->pmksa_cache_file = conf->pmksa_cache_file;
+	wconf->pmksa_cache_file_key = conf->pmksa_cache_file_key;
+	wconf->pmksa_cache_file_key_len = conf->pmksa_cache_file_key_len;
+#endif /* CONFIG_PMKSA_CACHE_FILE */
 	wconf->ieee80211w = conf->ieee80211w;
 	wconf->beacon_prot = conf->beacon_prot;
 	wconf->group_mgmt_cipher = conf->group_mgmt_cipher;
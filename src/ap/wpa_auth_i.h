@@ -232,6 +232,7 @@ struct wpa_authenticator {
 
 	struct rsn_pmksa_cache *pmksa;
 	struct wpa_ft_pmk_cache *ft_pmk_cache;
+	struct worker_pool *psk_trial_pool;
 
 #ifdef CONFIG_P2P
 	struct bitfield *ip_pool;
@@ -132,8 +132,10 @@ static int hostapd_wps_new_psk_cb(void *ctx, const u8 *mac_addr,
 				 psk, psk_len);
 	}
 
-	p->next = ssid->wpa_psk;
-	ssid->wpa_psk = p;
+	if (hostapd_wpa_psk_add(ssid, p) < 0) {
+		bin_clear_free(p, sizeof(*p));
+		return -1;
+	}
 
 	if (ssid->wpa_psk_file) {
 		FILE *f;
@@ -164,6 +166,7 @@ static int hostapd_wps_set_ie_cb(void *ctx, struct wpabuf *beacon_ie,
 	hapd->wps_beacon_ie = beacon_ie;
 	wpabuf_free(hapd->wps_probe_resp_ie);
 	hapd->wps_probe_resp_ie = probe_resp_ie;
+	hostapd_flush_probe_resp_cache(hapd);
 	if (hapd->beacon_set_done)
 		ieee802_11_set_beacon(hapd);
 	return hostapd_set_ap_wps_ie(hapd);
@@ -410,9 +413,9 @@ static int hapd_wps_reconfig_in_memory(struct hostapd_data *hapd,
 			if (bss->ssid.wpa_passphrase)
 				os_memcpy(bss->ssid.wpa_passphrase, cred->key,
 					  cred->key_len);
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 		} else if (cred->key_len == 64) {
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 			bss->ssid.wpa_psk =
 				os_zalloc(sizeof(struct hostapd_wpa_psk));
 			if (bss->ssid.wpa_psk &&
@@ -938,6 +941,7 @@ static void hostapd_wps_clear_ies(struct hostapd_data *hapd, int deinit_only)
 
 	wpabuf_free(hapd->wps_probe_resp_ie);
 	hapd->wps_probe_resp_ie = NULL;
+	hostapd_flush_probe_resp_cache(hapd);
 
 	if (deinit_only) {
 		if (hapd->drv_priv)
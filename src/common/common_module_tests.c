@@ -15,6 +15,7 @@
 #include "ieee802_11_common.h"
 #include "ieee802_11_defs.h"
 #include "gas.h"
+#include "eapol_common.h"
 #include "wpa_common.h"
 #include "sae.h"
 
@@ -548,6 +549,109 @@ fail:
 }
 
 
+static int pmk_trial_tests(void)
+{
+	static const struct {
+		int akmp;
+		int cipher;
+		int ver;
+	} tests[] = {
+		{ WPA_KEY_MGMT_PSK, WPA_CIPHER_CCMP,
+		  WPA_KEY_INFO_TYPE_HMAC_SHA1_AES },
+#ifndef CONFIG_FIPS
+		{ WPA_KEY_MGMT_PSK, WPA_CIPHER_TKIP,
+		  WPA_KEY_INFO_TYPE_HMAC_MD5_RC4 },
+#endif /* CONFIG_FIPS */
+		{ WPA_KEY_MGMT_PSK_SHA256, WPA_CIPHER_CCMP,
+		  WPA_KEY_INFO_TYPE_AES_128_CMAC },
+		{ WPA_KEY_MGMT_PSK_SHA256, WPA_CIPHER_GCMP_256,
+		  WPA_KEY_INFO_TYPE_AES_128_CMAC },
+	};
+	const u8 aa[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+	const u8 spa[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x02, 0x00 };
+	u8 anonce[WPA_NONCE_LEN], snonce[WPA_NONCE_LEN];
+	u8 frame[sizeof(struct ieee802_1x_hdr) + sizeof(struct wpa_eapol_key) +
+		 16 + 2 + 20];
+	u8 pmk[5][PMK_LEN];
+	const u8 *pmks[5];
+	struct wpa_eapol_key *key;
+	struct wpa_pmk_trial trial;
+	struct wpa_ptk ptk;
+	unsigned int i, j;
+	int res;
+
+	wpa_printf(MSG_INFO, "PMK trial tests");
+
+	os_memset(anonce, 0x11, sizeof(anonce));
+	os_memset(snonce, 0x22, sizeof(snonce));
+	for (i = 0; i < ARRAY_SIZE(pmk); i++) {
+		os_memset(pmk[i], 0x30 + i, PMK_LEN);
+		pmks[i] = pmk[i];
+	}
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		for (j = 0; j < sizeof(frame); j++)
+			frame[j] = j;
+		key = (struct wpa_eapol_key *) (frame +
+						sizeof(struct ieee802_1x_hdr));
+		WPA_PUT_BE16(key->key_info, WPA_KEY_INFO_KEY_TYPE |
+			     WPA_KEY_INFO_MIC | tests[i].ver);
+		os_memset(key + 1, 0, 16);
+
+		if (wpa_pmk_to_ptk(pmk[3], PMK_LEN, "Pairwise key expansion",
+				   aa, spa, anonce, snonce, &ptk,
+				   tests[i].akmp, tests[i].cipher,
+				   NULL, 0) < 0 ||
+		    wpa_eapol_key_mic(ptk.kck, ptk.kck_len, tests[i].akmp,
+				      tests[i].ver, frame, sizeof(frame),
+				      (u8 *) (key + 1)) < 0)
+			return -1;
+
+		if (wpa_pmk_trial_init(&trial, "Pairwise key expansion",
+				       aa, spa, anonce, snonce, tests[i].akmp,
+				       tests[i].cipher, PMK_LEN,
+				       frame, sizeof(frame)) < 0) {
+			wpa_printf(MSG_ERROR, "PMK trial %u: init failed", i);
+			return -1;
+		}
+		res = wpa_pmk_trial_find(&trial, NULL, pmks, ARRAY_SIZE(pmks));
+		wpa_pmk_trial_deinit(&trial);
+		if (res != 3) {
+			wpa_printf(MSG_ERROR,
+				   "PMK trial %u: unexpected result %d", i, res);
+			return -1;
+		}
+
+		/* Modified frame must not match any of the PMKs */
+		frame[sizeof(frame) - 1] ^= 0x01;
+		if (wpa_pmk_trial_init(&trial, "Pairwise key expansion",
+				       aa, spa, anonce, snonce, tests[i].akmp,
+				       tests[i].cipher, PMK_LEN,
+				       frame, sizeof(frame)) < 0)
+			return -1;
+		res = wpa_pmk_trial_find(&trial, NULL, pmks, ARRAY_SIZE(pmks));
+		wpa_pmk_trial_deinit(&trial);
+		if (res != -1) {
+			wpa_printf(MSG_ERROR,
+				   "PMK trial %u: unexpected match %d with modified frame",
+				   i, res);
+			return -1;
+		}
+	}
+
+	/* AKMs that need the full key derivation are not supported */
+	if (wpa_pmk_trial_init(&trial, "Pairwise key expansion", aa, spa,
+			       anonce, snonce, WPA_KEY_MGMT_FT_PSK,
+			       WPA_CIPHER_CCMP, PMK_LEN,
+			       frame, sizeof(frame)) == 0) {
+		wpa_pmk_trial_deinit(&trial);
+		return -1;
+	}
+
+	return 0;
+}
+
+
 int common_module_tests(void)
 {
 	int ret = 0;
@@ -557,7 +661,8 @@ int common_module_tests(void)
 	if (ieee802_11_parse_tests() < 0 ||
 	    gas_tests() < 0 ||
 	    sae_tests() < 0 ||
-	    rsn_ie_parse_tests() < 0)
+	    rsn_ie_parse_tests() < 0 ||
+	    pmk_trial_tests() < 0)
 		ret = -1;
 
 	return ret;
@@ -18,7 +18,9 @@
 #include "crypto/crypto.h"
 #include "ieee802_11_defs.h"
 #include "defs.h"
+#include "eapol_common.h"
 #include "wpa_common.h"
+#include "utils/worker_pool.h"
 
 
 static unsigned int wpa_kck_len(int akmp, size_t pmk_len)
@@ -321,6 +323,30 @@ int wpa_eapol_key_mic(const u8 *key, size_t key_len, int akmp, int ver,
 }
 
 
+/* Min(AA, SPA) || Max(AA, SPA) || Min(ANonce, SNonce) || Max(ANonce, SNonce) */
+static void wpa_ptk_prf_data(u8 *data, const u8 *addr1, const u8 *addr2,
+			     const u8 *nonce1, const u8 *nonce2)
+{
+	if (os_memcmp(addr1, addr2, ETH_ALEN) < 0) {
+		os_memcpy(data, addr1, ETH_ALEN);
+		os_memcpy(data + ETH_ALEN, addr2, ETH_ALEN);
+	} else {
+		os_memcpy(data, addr2, ETH_ALEN);
+		os_memcpy(data + ETH_ALEN, addr1, ETH_ALEN);
+	}
+
+	if (os_memcmp(nonce1, nonce2, WPA_NONCE_LEN) < 0) {
+		os_memcpy(data + 2 * ETH_ALEN, nonce1, WPA_NONCE_LEN);
+		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce2,
+			  WPA_NONCE_LEN);
+	} else {
+		os_memcpy(data + 2 * ETH_ALEN, nonce2, WPA_NONCE_LEN);
+		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce1,
+			  WPA_NONCE_LEN);
+	}
+}
+
+
 /**
  * wpa_pmk_to_ptk - Calculate PTK from PMK, addresses, and nonces
  * @pmk: Pairwise master key
@@ -372,23 +398,7 @@ int wpa_pmk_to_ptk(const u8 *pmk, size_t pmk_len, const char *label,
 	if (z_len > MAX_Z_LEN)
 		return -1;
 
-	if (os_memcmp(addr1, addr2, ETH_ALEN) < 0) {
-		os_memcpy(data, addr1, ETH_ALEN);
-		os_memcpy(data + ETH_ALEN, addr2, ETH_ALEN);
-	} else {
-		os_memcpy(data, addr2, ETH_ALEN);
-		os_memcpy(data + ETH_ALEN, addr1, ETH_ALEN);
-	}
-
-	if (os_memcmp(nonce1, nonce2, WPA_NONCE_LEN) < 0) {
-		os_memcpy(data + 2 * ETH_ALEN, nonce1, WPA_NONCE_LEN);
-		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce2,
-			  WPA_NONCE_LEN);
-	} else {
-		os_memcpy(data + 2 * ETH_ALEN, nonce2, WPA_NONCE_LEN);
-		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce1,
-			  WPA_NONCE_LEN);
-	}
+	wpa_ptk_prf_data(data, addr1, addr2, nonce1, nonce2);
 
 	if (z && z_len) {
 		os_memcpy(data + 2 * ETH_ALEN + 2 * WPA_NONCE_LEN, z, z_len);
@@ -496,6 +506,246 @@ int wpa_pmk_to_ptk(const u8 *pmk, size_t pmk_len, const char *label,
 	return 0;
 }
 
+
+/**
+ * wpa_pmk_trial_init - Prepare for matching candidate PMKs to a Key MIC
+ * @trial: Buffer for the trial state
+ * @label: Label to use in PTK derivation
+ * @addr1: AA or SA
+ * @addr2: SA or AA
+ * @nonce1: ANonce or SNonce
+ * @nonce2: SNonce or ANonce
+ * @akmp: Negotiated AKM
+ * @cipher: Negotiated pairwise cipher
+ * @pmk_len: Length of each candidate PMK
+ * @frame: Received EAPOL frame (IEEE 802.1X header and EAPOL-Key)
+ * @frame_len: Length of the frame
+ * Returns: 0 on success, -1 if the AKM, Key Descriptor Version, or frame is
+ *	not supported (the caller needs to use wpa_pmk_to_ptk() and
+ *	wpa_eapol_key_mic() instead)
+ *
+ * Only the KCK part of the PTK is needed to check whether a PMK matches the
+ * Key MIC, so wpa_pmk_trial_check() derives only the first PRF block for each
+ * candidate. The PRF input and the frame with the Key MIC field cleared are
+ * prepared here once for all the candidates. This supports the AKMs that use
+ * PRF-SHA1 or KDF-SHA256 with the HMAC-MD5, HMAC-SHA1, or AES-CMAC Key MIC,
+ * i.e., WPA-PSK and WPA-PSK-SHA256 without FT.
+ */
+int wpa_pmk_trial_init(struct wpa_pmk_trial *trial, const char *label,
+		       const u8 *addr1, const u8 *addr2,
+		       const u8 *nonce1, const u8 *nonce2,
+		       int akmp, int cipher, size_t pmk_len,
+		       const u8 *frame, size_t frame_len)
+{
+	const struct ieee802_1x_hdr *hdr;
+	const struct wpa_eapol_key *key;
+	size_t tk_len;
+
+	os_memset(trial, 0, sizeof(*trial));
+
+	if (pmk_len == 0 || wpa_key_mgmt_sha384(akmp) ||
+	    wpa_key_mgmt_ft(akmp) ||
+	    (akmp & (WPA_KEY_MGMT_OWE | WPA_KEY_MGMT_DPP)))
+		return -1;
+
+	trial->kck_len = wpa_kck_len(akmp, pmk_len);
+	trial->mic_len = wpa_mic_len(akmp, pmk_len);
+	tk_len = wpa_cipher_key_len(cipher);
+	if (trial->kck_len != 16 || trial->mic_len != 16 || tk_len == 0 ||
+	    frame_len < sizeof(*hdr) + sizeof(*key) + trial->mic_len + 2)
+		return -1;
+
+	hdr = (const struct ieee802_1x_hdr *) frame;
+	key = (const struct wpa_eapol_key *) (hdr + 1);
+	trial->ver = WPA_GET_BE16(key->key_info) & WPA_KEY_INFO_TYPE_MASK;
+	switch (trial->ver) {
+#ifndef CONFIG_FIPS
+	case WPA_KEY_INFO_TYPE_HMAC_MD5_RC4:
+#endif /* CONFIG_FIPS */
+	case WPA_KEY_INFO_TYPE_HMAC_SHA1_AES:
+	case WPA_KEY_INFO_TYPE_AES_128_CMAC:
+		break;
+	default:
+		return -1;
+	}
+
+	trial->frame = os_memdup(frame, frame_len);
+	if (!trial->frame)
+		return -1;
+	trial->frame_len = frame_len;
+	os_memcpy(trial->mic, key + 1, trial->mic_len);
+	os_memset(trial->frame + sizeof(*hdr) + sizeof(*key), 0,
+		  trial->mic_len);
+
+	trial->akmp = akmp;
+	trial->sha256 = wpa_key_mgmt_sha256(akmp);
+	trial->label = label;
+	trial->pmk_len = pmk_len;
+	trial->ptk_len = trial->kck_len + wpa_kek_len(akmp, pmk_len) + tk_len;
+	wpa_ptk_prf_data(trial->data, addr1, addr2, nonce1, nonce2);
+
+	return 0;
+}
+
+
+/**
+ * wpa_pmk_trial_deinit - Free the resources used for a PMK trial
+ * @trial: Trial state from wpa_pmk_trial_init()
+ */
+void wpa_pmk_trial_deinit(struct wpa_pmk_trial *trial)
+{
+	os_free(trial->frame);
+	trial->frame = NULL;
+}
+
+
+/**
+ * wpa_pmk_trial_check - Check whether a PMK matches the received Key MIC
+ * @trial: Trial state from wpa_pmk_trial_init()
+ * @pmk: Candidate PMK (trial->pmk_len octets)
+ * Returns: 0 if the Key MIC matches, -1 if not
+ *
+ * This function does not modify the trial state and it can be called from
+ * multiple threads at the same time.
+ */
+int wpa_pmk_trial_check(const struct wpa_pmk_trial *trial, const u8 *pmk)
+{
+	u8 kck[SHA256_MAC_LEN], mic[SHA1_MAC_LEN];
+	int res = -1;
+
+	if (trial->sha256) {
+		u8 counter_le[2], length_le[2];
+		const u8 *addr[4];
+		size_t len[4];
+
+		/*
+		 * First block of sha256_prf_bits(); the length field covers the
+		 * full PTK even though only the KCK is derived here.
+		 */
+		WPA_PUT_LE16(counter_le, 1);
+		WPA_PUT_LE16(length_le, trial->ptk_len * 8);
+		addr[0] = counter_le;
+		len[0] = sizeof(counter_le);
+		addr[1] = (const u8 *) trial->label;
+		len[1] = os_strlen(trial->label);
+		addr[2] = trial->data;
+		len[2] = sizeof(trial->data);
+		addr[3] = length_le;
+		len[3] = sizeof(length_le);
+		if (hmac_sha256_vector(pmk, trial->pmk_len, 4, addr, len,
+				       kck) < 0)
+			goto out;
+	} else if (sha1_prf(pmk, trial->pmk_len, trial->label, trial->data,
+			    sizeof(trial->data), kck, trial->kck_len) < 0) {
+		goto out;
+	}
+
+	switch (trial->ver) {
+#ifndef CONFIG_FIPS
+	case WPA_KEY_INFO_TYPE_HMAC_MD5_RC4:
+		if (hmac_md5(kck, trial->kck_len, trial->frame,
+			     trial->frame_len, mic))
+			goto out;
+		break;
+#endif /* CONFIG_FIPS */
+	case WPA_KEY_INFO_TYPE_HMAC_SHA1_AES:
+		if (hmac_sha1(kck, trial->kck_len, trial->frame,
+			      trial->frame_len, mic))
+			goto out;
+		break;
+	case WPA_KEY_INFO_TYPE_AES_128_CMAC:
+		if (omac1_aes_128(kck, trial->frame, trial->frame_len, mic))
+			goto out;
+		break;
+	default:
+		goto out;
+	}
+
+	if (os_memcmp_const(mic, trial->mic, trial->mic_len) == 0)
+		res = 0;
+out:
+	forced_memzero(kck, sizeof(kck));
+	return res;
+}
+
+
+#define WPA_PMK_TRIAL_CHUNK 64
+
+struct wpa_pmk_trial_batch {
+	const struct wpa_pmk_trial *trial;
+	const u8 * const *pmk;
+	size_t num;
+	int *match; /* first matching index for each chunk or -1 */
+};
+
+
+static int wpa_pmk_trial_chunk(void *ctx, unsigned int idx)
+{
+	struct wpa_pmk_trial_batch *batch = ctx;
+	size_t i, end;
+
+	i = (size_t) idx * WPA_PMK_TRIAL_CHUNK;
+	end = i + WPA_PMK_TRIAL_CHUNK;
+	if (end > batch->num)
+		end = batch->num;
+	for (; i < end; i++) {
+		if (wpa_pmk_trial_check(batch->trial, batch->pmk[i]) == 0) {
+			batch->match[idx] = i;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * wpa_pmk_trial_find - Find the first candidate PMK that matches the Key MIC
+ * @trial: Trial state from wpa_pmk_trial_init()
+ * @pool: Worker pool for checking the candidates in parallel or %NULL to
+ *	check them in the calling thread
+ * @pmk: Array of candidate PMKs (trial->pmk_len octets each)
+ * @num: Number of entries in the pmk array
+ * Returns: Index of the first matching PMK or -1 if none of them matched
+ *
+ * The candidates are checked in chunks in increasing index order and the
+ * remaining chunks are skipped once a match has been found. The result is the
+ * same as with checking the candidates one by one.
+ */
+int wpa_pmk_trial_find(const struct wpa_pmk_trial *trial,
+		       struct worker_pool *pool,
+		       const u8 * const *pmk, size_t num)
+{
+	struct wpa_pmk_trial_batch batch;
+	unsigned int chunks, i;
+	int res = -1;
+
+	if (num == 0 || num > 0x7fffffff)
+		return -1;
+
+	chunks = (num + WPA_PMK_TRIAL_CHUNK - 1) / WPA_PMK_TRIAL_CHUNK;
+	batch.trial = trial;
+	batch.pmk = pmk;
+	batch.num = num;
+	batch.match = os_calloc(chunks, sizeof(int));
+	if (!batch.match)
+		return -1;
+	for (i = 0; i < chunks; i++)
+		batch.match[i] = -1;
+
+	worker_pool_run(pool, wpa_pmk_trial_chunk, &batch, chunks);
+
+	for (i = 0; i < chunks; i++) {
+		if (batch.match[i] >= 0) {
+			res = batch.match[i];
+			break;
+		}
+	}
+	os_free(batch.match);
+
+	return res;
+}
+
 #ifdef CONFIG_FILS
 
 int fils_rmsk_to_pmk(int akmp, const u8 *rmsk, size_t rmsk_len,
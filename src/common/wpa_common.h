@@ -364,6 +364,42 @@ int wpa_pmk_to_ptk(const u8 *pmk, size_t pmk_len, const char *label,
 		   const u8 *nonce1, const u8 *nonce2,
 		   struct wpa_ptk *ptk, int akmp, int cipher,
 		   const u8 *z, size_t z_len);
+
+/**
+ * struct wpa_pmk_trial - Shared state for matching candidate PMKs to a Key MIC
+ *
+ * This is initialized with wpa_pmk_trial_init() for a received EAPOL-Key frame
+ * and is used for checking which one of a set of candidate PMKs (e.g., all
+ * the PSKs that are allowed for a STA) the Key MIC was calculated with.
+ */
+struct wpa_pmk_trial {
+	int akmp;
+	int ver;
+	int sha256;
+	const char *label;
+	u8 data[2 * ETH_ALEN + 2 * WPA_NONCE_LEN];
+	size_t pmk_len;
+	size_t kck_len;
+	size_t ptk_len;
+	u8 mic[WPA_EAPOL_KEY_MIC_MAX_LEN];
+	size_t mic_len;
+	u8 *frame; /* copy of the frame with the Key MIC field cleared */
+	size_t frame_len;
+};
+
+struct worker_pool;
+
+int wpa_pmk_trial_init(struct wpa_pmk_trial *trial, const char *label,
+		       const u8 *addr1, const u8 *addr2,
+		       const u8 *nonce1, const u8 *nonce2,
+		       int akmp, int cipher, size_t pmk_len,
+		       const u8 *frame, size_t frame_len);
+void wpa_pmk_trial_deinit(struct wpa_pmk_trial *trial);
+int wpa_pmk_trial_check(const struct wpa_pmk_trial *trial, const u8 *pmk);
+int wpa_pmk_trial_find(const struct wpa_pmk_trial *trial,
+		       struct worker_pool *pool,
+		       const u8 * const *pmk, size_t num);
+
 int fils_rmsk_to_pmk(int akmp, const u8 *rmsk, size_t rmsk_len,
 		     const u8 *snonce, const u8 *anonce, const u8 *dh_ss,
 		     size_t dh_ss_len, u8 *pmk, size_t *pmk_len);
@@ -386,6 +386,10 @@ extern "C" {
 /* Transition mode disabled indication - followed by bitmap */
 #define TRANSITION_DISABLE "TRANSITION-DISABLE "
 
+/* OCSP stapling response needs to be updated;
+ * parameters: file=<ocsp_stapling_response> valid=<0/1> */
+#define OCSP_STAPLING_REFRESH "OCSP-STAPLING-REFRESH "
+
 #ifndef BIT
 #define BIT(x) (1U << (x))
 #endif
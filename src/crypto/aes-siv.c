@@ -9,6 +9,7 @@
 #include "includes.h"
 
 #include "common.h"
+#include "crypto.h"
 #include "aes.h"
 #include "aes_wrap.h"
 #include "aes_siv.h"
@@ -39,18 +40,6 @@ static void xor(u8 *a, const u8 *b)
 }
 
 
-static void xorend(u8 *a, int alen, const u8 *b, int blen)
-{
-	int i;
-
-	if (alen < blen)
-		return;
-
-	for (i = 0; i < blen; i++)
-		a[alen - blen + i] ^= b[i];
-}
-
-
 static void pad_block(u8 *pad, const u8 *addr, size_t len)
 {
 	os_memset(pad, 0, AES_BLOCK_SIZE);
@@ -65,54 +54,62 @@ static int aes_s2v(const u8 *key, size_t key_len,
 		   size_t num_elem, const u8 *addr[], size_t *len, u8 *mac)
 {
 	u8 tmp[AES_BLOCK_SIZE], tmp2[AES_BLOCK_SIZE];
-	u8 *buf = NULL;
-	int ret;
+	struct crypto_mac *ctx;
+	int ret = -1;
 	size_t i;
-	const u8 *data[1];
-	size_t data_len[1];
+
+	/* All the CMAC invocations use the same key, so set up the AES key
+	 * schedule and the CMAC subkeys only once. */
+	ctx = crypto_mac_init(CRYPTO_MAC_AES_CMAC, key, key_len);
+	if (!ctx)
+		return -1;
 
 	if (!num_elem) {
 		os_memcpy(tmp, zero, sizeof(zero));
 		tmp[AES_BLOCK_SIZE - 1] = 1;
-		data[0] = tmp;
-		data_len[0] = sizeof(tmp);
-		return omac1_aes_vector(key, key_len, 1, data, data_len, mac);
+		if (crypto_mac_update(ctx, tmp, sizeof(tmp)))
+			goto out;
+		ret = crypto_mac_final(ctx, mac);
+		goto out;
 	}
 
-	data[0] = zero;
-	data_len[0] = sizeof(zero);
-	ret = omac1_aes_vector(key, key_len, 1, data, data_len, tmp);
-	if (ret)
-		return ret;
+	if (crypto_mac_update(ctx, zero, sizeof(zero)) ||
+	    crypto_mac_final(ctx, tmp))
+		goto out;
 
 	for (i = 0; i < num_elem - 1; i++) {
-		ret = omac1_aes_vector(key, key_len, 1, &addr[i], &len[i],
-				       tmp2);
-		if (ret)
-			return ret;
+		if (crypto_mac_update(ctx, addr[i], len[i]) ||
+		    crypto_mac_final(ctx, tmp2))
+			goto out;
 
 		dbl(tmp);
 		xor(tmp, tmp2);
 	}
 	if (len[i] >= AES_BLOCK_SIZE) {
-		buf = os_memdup(addr[i], len[i]);
-		if (!buf)
-			return -ENOMEM;
-
-		xorend(buf, len[i], tmp, AES_BLOCK_SIZE);
-		data[0] = buf;
-		ret = omac1_aes_vector(key, key_len, 1, data, &len[i], mac);
-		bin_clear_free(buf, len[i]);
-		return ret;
+		/* Sn xorend D: process the unmodified prefix directly and
+		 * only copy the final block that gets the xor applied */
+		os_memcpy(tmp2, addr[i] + len[i] - AES_BLOCK_SIZE,
+			  AES_BLOCK_SIZE);
+		xor(tmp2, tmp);
+		if (crypto_mac_update(ctx, addr[i], len[i] - AES_BLOCK_SIZE) ||
+		    crypto_mac_update(ctx, tmp2, AES_BLOCK_SIZE))
+			goto out;
+		ret = crypto_mac_final(ctx, mac);
+		goto out;
 	}
 
 	dbl(tmp);
 	pad_block(tmp2, addr[i], len[i]);
 	xor(tmp, tmp2);
 
-	data[0] = tmp;
-	data_len[0] = sizeof(tmp);
-	return omac1_aes_vector(key, key_len, 1, data, data_len, mac);
+	if (crypto_mac_update(ctx, tmp, sizeof(tmp)))
+		goto out;
+	ret = crypto_mac_final(ctx, mac);
+out:
+	forced_memzero(tmp, sizeof(tmp));
+	forced_memzero(tmp2, sizeof(tmp2));
+	crypto_mac_deinit(ctx);
+	return ret;
 }
 
 
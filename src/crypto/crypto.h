@@ -213,6 +213,83 @@ void crypto_hash_update(struct crypto_hash *ctx, const u8 *data, size_t len);
 int crypto_hash_finish(struct crypto_hash *ctx, u8 *hash, size_t *len);
 
 
+enum crypto_mac_alg {
+	CRYPTO_MAC_HMAC_SHA1, CRYPTO_MAC_HMAC_SHA256, CRYPTO_MAC_HMAC_SHA384,
+	CRYPTO_MAC_HMAC_SHA512, CRYPTO_MAC_AES_CMAC
+};
+
+struct crypto_mac;
+
+/**
+ * crypto_mac_init - Initialize a keyed MAC context
+ * @alg: MAC algorithm
+ * @key: Key for the MAC (16 or 32 octets for AES-CMAC)
+ * @key_len: Length of the key in bytes
+ * Returns: Pointer to MAC context or %NULL on failure
+ *
+ * The key is processed (HMAC key padding or AES key expansion and CMAC
+ * subkeys) only once here. The same context can then be used to calculate
+ * the MAC for any number of messages with crypto_mac_update() and
+ * crypto_mac_final(). This is faster than the one-shot functions like
+ * hmac_sha256_vector() and omac1_aes_vector() when the same key is used
+ * repeatedly.
+ */
+struct crypto_mac * crypto_mac_init(enum crypto_mac_alg alg, const u8 *key,
+				    size_t key_len);
+
+/**
+ * crypto_mac_update - Add data to MAC calculation
+ * @ctx: Context pointer from crypto_mac_init()
+ * @data: Data buffer to add
+ * @len: Length of the buffer
+ * Returns: 0 on success, -1 on failure
+ */
+int crypto_mac_update(struct crypto_mac *ctx, const u8 *data, size_t len);
+
+/**
+ * crypto_mac_final - Complete MAC calculation
+ * @ctx: Context pointer from crypto_mac_init()
+ * @mac: Buffer for the MAC (crypto_mac_len() octets)
+ * Returns: 0 on success, -1 on failure
+ *
+ * The context is reset after this call, so it is ready for the next message
+ * with the same key.
+ */
+int crypto_mac_final(struct crypto_mac *ctx, u8 *mac);
+
+/**
+ * crypto_mac_reset - Discard data added to MAC calculation
+ * @ctx: Context pointer from crypto_mac_init()
+ * Returns: 0 on success, -1 on failure
+ */
+int crypto_mac_reset(struct crypto_mac *ctx);
+
+/**
+ * crypto_mac_len - Get the MAC length
+ * @ctx: Context pointer from crypto_mac_init()
+ * Returns: Length of the MAC in octets
+ */
+size_t crypto_mac_len(struct crypto_mac *ctx);
+
+/**
+ * crypto_mac_vector - Calculate MAC over a data vector
+ * @ctx: Context pointer from crypto_mac_init()
+ * @num_elem: Number of elements in the data vector
+ * @addr: Pointers to the data areas
+ * @len: Lengths of the data blocks
+ * @mac: Buffer for the MAC (crypto_mac_len() octets)
+ * Returns: 0 on success, -1 on failure
+ */
+int crypto_mac_vector(struct crypto_mac *ctx, size_t num_elem,
+		      const u8 *addr[], const size_t *len, u8 *mac);
+
+/**
+ * crypto_mac_deinit - Free MAC context
+ * @ctx: Context pointer from crypto_mac_init()
+ */
+void crypto_mac_deinit(struct crypto_mac *ctx);
+
+
 enum crypto_cipher_alg {
 	CRYPTO_CIPHER_NULL = 0, CRYPTO_CIPHER_ALG_AES, CRYPTO_CIPHER_ALG_3DES,
 	CRYPTO_CIPHER_ALG_DES, CRYPTO_CIPHER_ALG_RC2, CRYPTO_CIPHER_ALG_RC4
@@ -443,6 +520,15 @@ int __must_check crypto_global_init(void);
  */
 void crypto_global_deinit(void);
 
+/**
+ * crypto_unload - Release the cached crypto wrapper state
+ *
+ * This function is called when the process is about to exit to free the data
+ * that the crypto wrapper keeps across operations, e.g., precomputed EC group
+ * parameters.
+ */
+void crypto_unload(void);
+
 /**
  * crypto_mod_exp - Modular exponentiation of large integers
  * @base: Base integer (big endian byte array)
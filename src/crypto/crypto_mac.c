@@ -0,0 +1,512 @@
+/*
+ * Keyed MAC contexts built on the crypto wrapper primitives
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This is used with crypto wrappers that do not provide their own
+ * crypto_mac_*() implementation. With the internal hash functions, HMAC keeps
+ * the hash states after the K XOR ipad and K XOR opad blocks, so that only the
+ * message and the outer hash need to be processed for each MAC. With other
+ * hash functions, HMAC uses the one-shot hmac_*_vector() functions. AES-CMAC
+ * keeps the AES key schedule and the CMAC subkeys in the context.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "aes.h"
+#include "sha1.h"
+#include "sha256.h"
+#include "sha384.h"
+#include "sha512.h"
+#include "crypto.h"
+#ifdef CONFIG_CRYPTO_INTERNAL
+#include "sha1_i.h"
+#include "sha256_i.h"
+#include "sha384_i.h"
+#include "sha512_i.h"
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
+#define CRYPTO_MAC_MAX_BLOCK_SIZE 128
+
+#ifdef CONFIG_CRYPTO_INTERNAL
+union crypto_mac_hash_state {
+	struct SHA1Context sha1;
+#ifdef CONFIG_SHA256
+	struct sha256_state sha256;
+#endif /* CONFIG_SHA256 */
+#ifdef CONFIG_INTERNAL_SHA384
+	struct sha384_state sha384;
+#endif /* CONFIG_INTERNAL_SHA384 */
+#ifdef CONFIG_INTERNAL_SHA512
+	struct sha512_state sha512;
+#endif /* CONFIG_INTERNAL_SHA512 */
+};
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
+struct crypto_mac {
+	enum crypto_mac_alg alg;
+	size_t mac_len;
+
+	/* HMAC */
+	size_t block_size;
+#ifdef CONFIG_CRYPTO_INTERNAL
+	int use_state;
+	union crypto_mac_hash_state inner_init; /* after K XOR ipad */
+	union crypto_mac_hash_state outer_init; /* after K XOR opad */
+	union crypto_mac_hash_state inner;
+#endif /* CONFIG_CRYPTO_INTERNAL */
+	u8 key[CRYPTO_MAC_MAX_BLOCK_SIZE];
+	size_t key_len;
+	struct wpabuf *buf;
+
+	/* AES-CMAC */
+	void *aes;
+	u8 k1[AES_BLOCK_SIZE];
+	u8 k2[AES_BLOCK_SIZE];
+	u8 cbc[AES_BLOCK_SIZE];
+	u8 last[AES_BLOCK_SIZE];
+	size_t last_len;
+};
+
+
+static int crypto_mac_hash(enum crypto_mac_alg alg, size_t num_elem,
+			   const u8 *addr[], const size_t *len, u8 *mac)
+{
+	switch (alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		return sha1_vector(num_elem, addr, len, mac);
+#ifdef CONFIG_SHA256
+	case CRYPTO_MAC_HMAC_SHA256:
+		return sha256_vector(num_elem, addr, len, mac);
+#endif /* CONFIG_SHA256 */
+#ifdef CONFIG_SHA384
+	case CRYPTO_MAC_HMAC_SHA384:
+		return sha384_vector(num_elem, addr, len, mac);
+#endif /* CONFIG_SHA384 */
+#ifdef CONFIG_SHA512
+	case CRYPTO_MAC_HMAC_SHA512:
+		return sha512_vector(num_elem, addr, len, mac);
+#endif /* CONFIG_SHA512 */
+	default:
+		return -1;
+	}
+}
+
+
+static int crypto_mac_hmac_vector(struct crypto_mac *ctx, size_t num_elem,
+				  const u8 *addr[], const size_t *len, u8 *mac)
+{
+	switch (ctx->alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		return hmac_sha1_vector(ctx->key, ctx->key_len, num_elem, addr,
+					len, mac);
+#ifdef CONFIG_SHA256
+	case CRYPTO_MAC_HMAC_SHA256:
+		return hmac_sha256_vector(ctx->key, ctx->key_len, num_elem,
+					  addr, len, mac);
+#endif /* CONFIG_SHA256 */
+#ifdef CONFIG_SHA384
+	case CRYPTO_MAC_HMAC_SHA384:
+		return hmac_sha384_vector(ctx->key, ctx->key_len, num_elem,
+					  addr, len, mac);
+#endif /* CONFIG_SHA384 */
+#ifdef CONFIG_SHA512
+	case CRYPTO_MAC_HMAC_SHA512:
+		return hmac_sha512_vector(ctx->key, ctx->key_len, num_elem,
+					  addr, len, mac);
+#endif /* CONFIG_SHA512 */
+	default:
+		return -1;
+	}
+}
+
+
+#ifdef CONFIG_CRYPTO_INTERNAL
+
+/* Returns -1 if the internal hash function is not available for alg */
+static int crypto_mac_state_init(enum crypto_mac_alg alg,
+				 union crypto_mac_hash_state *state)
+{
+	switch (alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		SHA1Init(&state->sha1);
+		return 0;
+#ifdef CONFIG_SHA256
+	case CRYPTO_MAC_HMAC_SHA256:
+		sha256_init(&state->sha256);
+		return 0;
+#endif /* CONFIG_SHA256 */
+#if defined(CONFIG_SHA384) && defined(CONFIG_INTERNAL_SHA384)
+	case CRYPTO_MAC_HMAC_SHA384:
+		sha384_init(&state->sha384);
+		return 0;
+#endif /* CONFIG_SHA384 && CONFIG_INTERNAL_SHA384 */
+#if defined(CONFIG_SHA512) && defined(CONFIG_INTERNAL_SHA512)
+	case CRYPTO_MAC_HMAC_SHA512:
+		sha512_init(&state->sha512);
+		return 0;
+#endif /* CONFIG_SHA512 && CONFIG_INTERNAL_SHA512 */
+	default:
+		return -1;
+	}
+}
+
+
+static int crypto_mac_state_update(enum crypto_mac_alg alg,
+				   union crypto_mac_hash_state *state,
+				   const u8 *data, size_t len)
+{
+	switch (alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		SHA1Update(&state->sha1, data, len);
+		return 0;
+#ifdef CONFIG_SHA256
+	case CRYPTO_MAC_HMAC_SHA256:
+		return sha256_process(&state->sha256, data, len);
+#endif /* CONFIG_SHA256 */
+#if defined(CONFIG_SHA384) && defined(CONFIG_INTERNAL_SHA384)
+	case CRYPTO_MAC_HMAC_SHA384:
+		return sha384_process(&state->sha384, data, len);
+#endif /* CONFIG_SHA384 && CONFIG_INTERNAL_SHA384 */
+#if defined(CONFIG_SHA512) && defined(CONFIG_INTERNAL_SHA512)
+	case CRYPTO_MAC_HMAC_SHA512:
+		return sha512_process(&state->sha512, data, len);
+#endif /* CONFIG_SHA512 && CONFIG_INTERNAL_SHA512 */
+	default:
+		return -1;
+	}
+}
+
+
+static int crypto_mac_state_done(enum crypto_mac_alg alg,
+				 union crypto_mac_hash_state *state, u8 *out)
+{
+	switch (alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		SHA1Final(out, &state->sha1);
+		return 0;
+#ifdef CONFIG_SHA256
+	case CRYPTO_MAC_HMAC_SHA256:
+		return sha256_done(&state->sha256, out);
+#endif /* CONFIG_SHA256 */
+#if defined(CONFIG_SHA384) && defined(CONFIG_INTERNAL_SHA384)
+	case CRYPTO_MAC_HMAC_SHA384:
+		return sha384_done(&state->sha384, out);
+#endif /* CONFIG_SHA384 && CONFIG_INTERNAL_SHA384 */
+#if defined(CONFIG_SHA512) && defined(CONFIG_INTERNAL_SHA512)
+	case CRYPTO_MAC_HMAC_SHA512:
+		return sha512_done(&state->sha512, out);
+#endif /* CONFIG_SHA512 && CONFIG_INTERNAL_SHA512 */
+	default:
+		return -1;
+	}
+}
+
+
+static int crypto_mac_state_setup(struct crypto_mac *ctx)
+{
+	u8 k_pad[CRYPTO_MAC_MAX_BLOCK_SIZE];
+	size_t i;
+	int res = -1;
+
+	if (crypto_mac_state_init(ctx->alg, &ctx->inner_init) < 0 ||
+	    crypto_mac_state_init(ctx->alg, &ctx->outer_init) < 0)
+		return -1;
+
+	os_memset(k_pad, 0, sizeof(k_pad));
+	os_memcpy(k_pad, ctx->key, ctx->key_len);
+	for (i = 0; i < ctx->block_size; i++)
+		k_pad[i] ^= 0x36;
+	if (crypto_mac_state_update(ctx->alg, &ctx->inner_init, k_pad,
+				    ctx->block_size) < 0)
+		goto out;
+
+	for (i = 0; i < ctx->block_size; i++)
+		k_pad[i] ^= 0x36 ^ 0x5c;
+	if (crypto_mac_state_update(ctx->alg, &ctx->outer_init, k_pad,
+				    ctx->block_size) < 0)
+		goto out;
+
+	ctx->inner = ctx->inner_init;
+	ctx->use_state = 1;
+	res = 0;
+out:
+	forced_memzero(k_pad, sizeof(k_pad));
+	return res;
+}
+
+
+static int crypto_mac_state_final(struct crypto_mac *ctx, u8 *mac)
+{
+	union crypto_mac_hash_state outer;
+	int res;
+
+	/* H(K XOR opad, H(K XOR ipad, text)) */
+	outer = ctx->outer_init;
+	res = crypto_mac_state_done(ctx->alg, &ctx->inner, mac) < 0 ||
+		crypto_mac_state_update(ctx->alg, &outer, mac,
+					ctx->mac_len) < 0 ||
+		crypto_mac_state_done(ctx->alg, &outer, mac) < 0 ? -1 : 0;
+	forced_memzero(&outer, sizeof(outer));
+	return res;
+}
+
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
+
+static void gf_mulx(u8 *pad)
+{
+	int i, carry;
+
+	carry = pad[0] & 0x80;
+	for (i = 0; i < AES_BLOCK_SIZE - 1; i++)
+		pad[i] = (pad[i] << 1) | (pad[i + 1] >> 7);
+	pad[AES_BLOCK_SIZE - 1] <<= 1;
+	if (carry)
+		pad[AES_BLOCK_SIZE - 1] ^= 0x87;
+}
+
+
+static int crypto_mac_hmac_init(struct crypto_mac *ctx, const u8 *key,
+				size_t key_len)
+{
+	u8 tk[64];
+
+	switch (ctx->alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		ctx->mac_len = 20;
+		ctx->block_size = 64;
+		break;
+#ifdef CONFIG_SHA256
+	case CRYPTO_MAC_HMAC_SHA256:
+		ctx->mac_len = 32;
+		ctx->block_size = 64;
+		break;
+#endif /* CONFIG_SHA256 */
+#ifdef CONFIG_SHA384
+	case CRYPTO_MAC_HMAC_SHA384:
+		ctx->mac_len = 48;
+		ctx->block_size = 128;
+		break;
+#endif /* CONFIG_SHA384 */
+#ifdef CONFIG_SHA512
+	case CRYPTO_MAC_HMAC_SHA512:
+		ctx->mac_len = 64;
+		ctx->block_size = 128;
+		break;
+#endif /* CONFIG_SHA512 */
+	default:
+		return -1;
+	}
+
+	/* if key is longer than the block size, reset it to key = H(key) */
+	if (key_len > ctx->block_size) {
+		if (crypto_mac_hash(ctx->alg, 1, &key, &key_len, tk) < 0)
+			return -1;
+		key = tk;
+		key_len = ctx->mac_len;
+	}
+
+	os_memcpy(ctx->key, key, key_len);
+	ctx->key_len = key_len;
+	forced_memzero(tk, sizeof(tk));
+
+#ifdef CONFIG_CRYPTO_INTERNAL
+	if (crypto_mac_state_setup(ctx) == 0)
+		return 0;
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
+	ctx->buf = wpabuf_alloc(256);
+	return ctx->buf ? 0 : -1;
+}
+
+
+static int crypto_mac_cmac_init(struct crypto_mac *ctx, const u8 *key,
+				size_t key_len)
+{
+	ctx->mac_len = AES_BLOCK_SIZE;
+	ctx->aes = aes_encrypt_init(key, key_len);
+	if (!ctx->aes)
+		return -1;
+
+	/* Subkeys K1 and K2 from L = AES-K(0^128) */
+	os_memset(ctx->k1, 0, AES_BLOCK_SIZE);
+	if (aes_encrypt(ctx->aes, ctx->k1, ctx->k1))
+		return -1;
+	gf_mulx(ctx->k1);
+	os_memcpy(ctx->k2, ctx->k1, AES_BLOCK_SIZE);
+	gf_mulx(ctx->k2);
+	return 0;
+}
+
+
+struct crypto_mac * crypto_mac_init(enum crypto_mac_alg alg, const u8 *key,
+				    size_t key_len)
+{
+	struct crypto_mac *ctx;
+	int res;
+
+	ctx = os_zalloc(sizeof(*ctx));
+	if (!ctx)
+		return NULL;
+	ctx->alg = alg;
+
+	if (alg == CRYPTO_MAC_AES_CMAC)
+		res = crypto_mac_cmac_init(ctx, key, key_len);
+	else
+		res = crypto_mac_hmac_init(ctx, key, key_len);
+	if (res < 0) {
+		crypto_mac_deinit(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+
+int crypto_mac_update(struct crypto_mac *ctx, const u8 *data, size_t len)
+{
+	size_t i, n;
+
+	if (!ctx->aes) {
+#ifdef CONFIG_CRYPTO_INTERNAL
+		if (ctx->use_state)
+			return crypto_mac_state_update(ctx->alg, &ctx->inner,
+						       data, len);
+#endif /* CONFIG_CRYPTO_INTERNAL */
+		if (wpabuf_resize(&ctx->buf, len) < 0)
+			return -1;
+		wpabuf_put_data(ctx->buf, data, len);
+		return 0;
+	}
+
+	/* The last block is kept in ctx->last until crypto_mac_final() since
+	 * it is processed differently */
+	while (len > 0) {
+		if (ctx->last_len == AES_BLOCK_SIZE) {
+			for (i = 0; i < AES_BLOCK_SIZE; i++)
+				ctx->cbc[i] ^= ctx->last[i];
+			if (aes_encrypt(ctx->aes, ctx->cbc, ctx->cbc))
+				return -1;
+			ctx->last_len = 0;
+		}
+		n = AES_BLOCK_SIZE - ctx->last_len;
+		if (n > len)
+			n = len;
+		os_memcpy(ctx->last + ctx->last_len, data, n);
+		ctx->last_len += n;
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+
+int crypto_mac_reset(struct crypto_mac *ctx)
+{
+#ifdef CONFIG_CRYPTO_INTERNAL
+	if (ctx->use_state)
+		ctx->inner = ctx->inner_init;
+#endif /* CONFIG_CRYPTO_INTERNAL */
+	if (ctx->buf) {
+		os_memset(wpabuf_mhead(ctx->buf), 0, wpabuf_len(ctx->buf));
+		ctx->buf->used = 0;
+	}
+	os_memset(ctx->cbc, 0, AES_BLOCK_SIZE);
+	os_memset(ctx->last, 0, AES_BLOCK_SIZE);
+	ctx->last_len = 0;
+	return 0;
+}
+
+
+static int crypto_mac_hmac_final(struct crypto_mac *ctx, u8 *mac)
+{
+	const u8 *addr;
+	size_t len;
+
+#ifdef CONFIG_CRYPTO_INTERNAL
+	if (ctx->use_state)
+		return crypto_mac_state_final(ctx, mac);
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
+	addr = wpabuf_head(ctx->buf);
+	len = wpabuf_len(ctx->buf);
+	return crypto_mac_hmac_vector(ctx, 1, &addr, &len, mac);
+}
+
+
+static int crypto_mac_cmac_final(struct crypto_mac *ctx, u8 *mac)
+{
+	size_t i;
+
+	if (ctx->last_len == AES_BLOCK_SIZE) {
+		for (i = 0; i < AES_BLOCK_SIZE; i++)
+			ctx->cbc[i] ^= ctx->last[i] ^ ctx->k1[i];
+	} else {
+		ctx->last[ctx->last_len] = 0x80;
+		for (i = ctx->last_len + 1; i < AES_BLOCK_SIZE; i++)
+			ctx->last[i] = 0;
+		for (i = 0; i < AES_BLOCK_SIZE; i++)
+			ctx->cbc[i] ^= ctx->last[i] ^ ctx->k2[i];
+	}
+	return aes_encrypt(ctx->aes, ctx->cbc, mac) ? -1 : 0;
+}
+
+
+int crypto_mac_final(struct crypto_mac *ctx, u8 *mac)
+{
+	int res;
+
+	if (TEST_FAIL())
+		res = -1;
+	else if (ctx->aes)
+		res = crypto_mac_cmac_final(ctx, mac);
+	else
+		res = crypto_mac_hmac_final(ctx, mac);
+	crypto_mac_reset(ctx);
+	return res;
+}
+
+
+size_t crypto_mac_len(struct crypto_mac *ctx)
+{
+	return ctx->mac_len;
+}
+
+
+int crypto_mac_vector(struct crypto_mac *ctx, size_t num_elem,
+		      const u8 *addr[], const size_t *len, u8 *mac)
+{
+	size_t i;
+
+	/* Without a stored hash state, the elements do not need to be
+	 * collected into the buffer */
+	if (ctx->buf && wpabuf_len(ctx->buf) == 0) {
+		if (TEST_FAIL())
+			return -1;
+		return crypto_mac_hmac_vector(ctx, num_elem, addr, len, mac);
+	}
+
+	for (i = 0; i < num_elem; i++) {
+		if (crypto_mac_update(ctx, addr[i], len[i]) < 0) {
+			crypto_mac_reset(ctx);
+			return -1;
+		}
+	}
+	return crypto_mac_final(ctx, mac);
+}
+
+
+void crypto_mac_deinit(struct crypto_mac *ctx)
+{
+	if (!ctx)
+		return;
+	if (ctx->aes)
+		aes_encrypt_deinit(ctx->aes);
+	wpabuf_clear_free(ctx->buf);
+	bin_clear_free(ctx, sizeof(*ctx));
+}
@@ -2143,6 +2143,87 @@ static int test_ms_funcs(void)
 }
 
 
+#ifdef CONFIG_ECC
+static int ecdh_secret_eq(const struct wpabuf *a, const struct wpabuf *b)
+{
+	return wpabuf_len(a) == wpabuf_len(b) &&
+		os_memcmp(wpabuf_head(a), wpabuf_head(b), wpabuf_len(a)) == 0;
+}
+
+
+static int test_ecdh_group(int group)
+{
+	struct crypto_ecdh *a, *b, *c = NULL;
+	struct wpabuf *pub_a = NULL, *pub_b = NULL, *pub_c = NULL;
+	struct wpabuf *secret_ab = NULL, *secret_ba = NULL;
+	struct wpabuf *secret_bc = NULL, *secret_cb = NULL;
+	int ret = -1;
+
+	/*
+	 * All contexts for a group share the same curve parameters; freeing
+	 * one context must not affect the other ones.
+	 */
+	a = crypto_ecdh_init(group);
+	b = crypto_ecdh_init(group);
+	if (!a || !b)
+		goto fail;
+	pub_a = crypto_ecdh_get_pubkey(a, 0);
+	pub_b = crypto_ecdh_get_pubkey(b, 0);
+	if (!pub_a || !pub_b)
+		goto fail;
+	secret_ab = crypto_ecdh_set_peerkey(a, 0, wpabuf_head(pub_b),
+					    wpabuf_len(pub_b));
+	crypto_ecdh_deinit(a);
+	a = NULL;
+
+	c = crypto_ecdh_init(group);
+	if (!c)
+		goto fail;
+	pub_c = crypto_ecdh_get_pubkey(c, 0);
+	if (!pub_c)
+		goto fail;
+	secret_ba = crypto_ecdh_set_peerkey(b, 0, wpabuf_head(pub_a),
+					    wpabuf_len(pub_a));
+	secret_bc = crypto_ecdh_set_peerkey(b, 0, wpabuf_head(pub_c),
+					    wpabuf_len(pub_c));
+	secret_cb = crypto_ecdh_set_peerkey(c, 0, wpabuf_head(pub_b),
+					    wpabuf_len(pub_b));
+	if (!secret_ab || !secret_ba || !secret_bc || !secret_cb ||
+	    wpabuf_len(secret_ab) != crypto_ecdh_prime_len(b) ||
+	    !ecdh_secret_eq(secret_ab, secret_ba) ||
+	    !ecdh_secret_eq(secret_bc, secret_cb) ||
+	    ecdh_secret_eq(secret_ab, secret_bc))
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "ECDH group %d test failed", group);
+	crypto_ecdh_deinit(a);
+	crypto_ecdh_deinit(b);
+	crypto_ecdh_deinit(c);
+	wpabuf_free(pub_a);
+	wpabuf_free(pub_b);
+	wpabuf_free(pub_c);
+	wpabuf_clear_free(secret_ab);
+	wpabuf_clear_free(secret_ba);
+	wpabuf_clear_free(secret_bc);
+	wpabuf_clear_free(secret_cb);
+	return ret;
+}
+
+
+static int test_ecdh(void)
+{
+	if (test_ecdh_group(19) || test_ecdh_group(20) || test_ecdh_group(21))
+		return -1;
+	wpa_printf(MSG_INFO, "ECDH test cases passed");
+	return 0;
+}
+
+#endif /* CONFIG_ECC */
+
+
 int crypto_module_tests(void)
 {
 	int ret = 0;
@@ -2162,6 +2243,10 @@ int crypto_module_tests(void)
 	    test_extract_expand_hkdf() ||
 	    test_ms_funcs())
 		ret = -1;
+#ifdef CONFIG_ECC
+	if (test_ecdh())
+		ret = -1;
+#endif /* CONFIG_ECC */
 
 	return ret;
 }
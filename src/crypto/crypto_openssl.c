@@ -16,11 +16,14 @@
 #include <openssl/dh.h>
 #include <openssl/hmac.h>
 #include <openssl/rand.h>
-#ifdef CONFIG_OPENSSL_CMAC
+#ifndef OPENSSL_NO_CMAC
 #include <openssl/cmac.h>
-#endif /* CONFIG_OPENSSL_CMAC */
+#endif /* OPENSSL_NO_CMAC */
 #ifdef CONFIG_ECC
 #include <openssl/ec.h>
+#ifdef CONFIG_WORKER_POOL
+#include <pthread.h>
+#endif /* CONFIG_WORKER_POOL */
 #endif /* CONFIG_ECC */
 
 #include "common.h"
@@ -1263,6 +1266,168 @@ int omac1_aes_256(const u8 *key, const u8 *data, size_t data_len, u8 *mac)
 #endif /* CONFIG_OPENSSL_CMAC */
 
 
+struct crypto_mac {
+	size_t mac_len;
+	HMAC_CTX *hmac;
+#ifndef OPENSSL_NO_CMAC
+	CMAC_CTX *cmac;
+#endif /* OPENSSL_NO_CMAC */
+};
+
+
+struct crypto_mac * crypto_mac_init(enum crypto_mac_alg alg, const u8 *key,
+				    size_t key_len)
+{
+	struct crypto_mac *ctx;
+	const EVP_MD *md = NULL;
+	const EVP_CIPHER *cipher = NULL;
+
+	switch (alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		md = EVP_sha1();
+		break;
+	case CRYPTO_MAC_HMAC_SHA256:
+		md = EVP_sha256();
+		break;
+	case CRYPTO_MAC_HMAC_SHA384:
+		md = EVP_sha384();
+		break;
+	case CRYPTO_MAC_HMAC_SHA512:
+		md = EVP_sha512();
+		break;
+#ifndef OPENSSL_NO_CMAC
+	case CRYPTO_MAC_AES_CMAC:
+		if (key_len == 16)
+			cipher = EVP_aes_128_cbc();
+		else if (key_len == 32)
+			cipher = EVP_aes_256_cbc();
+		else
+			return NULL;
+		break;
+#endif /* OPENSSL_NO_CMAC */
+	default:
+		return NULL;
+	}
+
+	ctx = os_zalloc(sizeof(*ctx));
+	if (!ctx)
+		return NULL;
+
+	if (md) {
+		ctx->mac_len = EVP_MD_size(md);
+		ctx->hmac = HMAC_CTX_new();
+		if (!ctx->hmac ||
+		    HMAC_Init_ex(ctx->hmac, key, key_len, md, NULL) != 1)
+			goto fail;
+	}
+#ifndef OPENSSL_NO_CMAC
+	if (cipher) {
+		ctx->mac_len = AES_BLOCK_SIZE;
+		ctx->cmac = CMAC_CTX_new();
+		if (!ctx->cmac ||
+		    CMAC_Init(ctx->cmac, key, key_len, cipher, NULL) != 1)
+			goto fail;
+	}
+#endif /* OPENSSL_NO_CMAC */
+
+	return ctx;
+fail:
+	crypto_mac_deinit(ctx);
+	return NULL;
+}
+
+
+int crypto_mac_update(struct crypto_mac *ctx, const u8 *data, size_t len)
+{
+	if (ctx->hmac)
+		return HMAC_Update(ctx->hmac, data, len) == 1 ? 0 : -1;
+#ifndef OPENSSL_NO_CMAC
+	if (ctx->cmac)
+		return CMAC_Update(ctx->cmac, data, len) == 1 ? 0 : -1;
+#endif /* OPENSSL_NO_CMAC */
+	return -1;
+}
+
+
+int crypto_mac_reset(struct crypto_mac *ctx)
+{
+	/* A NULL key restarts the calculation with the previously set key */
+	if (ctx->hmac)
+		return HMAC_Init_ex(ctx->hmac, NULL, 0, NULL, NULL) == 1 ?
+			0 : -1;
+#ifndef OPENSSL_NO_CMAC
+	if (ctx->cmac)
+		return CMAC_Init(ctx->cmac, NULL, 0, NULL, NULL) == 1 ? 0 : -1;
+#endif /* OPENSSL_NO_CMAC */
+	return -1;
+}
+
+
+int crypto_mac_final(struct crypto_mac *ctx, u8 *mac)
+{
+	unsigned int mdlen;
+	int res = -1;
+
+	if (TEST_FAIL()) {
+		crypto_mac_reset(ctx);
+		return -1;
+	}
+
+	if (ctx->hmac) {
+		mdlen = ctx->mac_len;
+		if (HMAC_Final(ctx->hmac, mac, &mdlen) == 1 &&
+		    mdlen == ctx->mac_len)
+			res = 0;
+	}
+#ifndef OPENSSL_NO_CMAC
+	if (ctx->cmac) {
+		size_t outlen;
+
+		if (CMAC_Final(ctx->cmac, mac, &outlen) == 1 &&
+		    outlen == ctx->mac_len)
+			res = 0;
+	}
+#endif /* OPENSSL_NO_CMAC */
+
+	if (crypto_mac_reset(ctx) < 0)
+		res = -1;
+	return res;
+}
+
+
+size_t crypto_mac_len(struct crypto_mac *ctx)
+{
+	return ctx->mac_len;
+}
+
+
+int crypto_mac_vector(struct crypto_mac *ctx, size_t num_elem,
+		      const u8 *addr[], const size_t *len, u8 *mac)
+{
+	size_t i;
+
+	for (i = 0; i < num_elem; i++) {
+		if (crypto_mac_update(ctx, addr[i], len[i]) < 0) {
+			crypto_mac_reset(ctx);
+			return -1;
+		}
+	}
+	return crypto_mac_final(ctx, mac);
+}
+
+
+void crypto_mac_deinit(struct crypto_mac *ctx)
+{
+	if (!ctx)
+		return;
+	HMAC_CTX_free(ctx->hmac);
+#ifndef OPENSSL_NO_CMAC
+	CMAC_CTX_free(ctx->cmac);
+#endif /* OPENSSL_NO_CMAC */
+	bin_clear_free(ctx, sizeof(*ctx));
+}
+
+
 struct crypto_bignum * crypto_bignum_init(void)
 {
 	if (TEST_FAIL())
@@ -1610,77 +1775,212 @@ fail:
 
 #ifdef CONFIG_ECC
 
+/*
+ * Curve parameters are shared by all crypto_ec contexts for the same group.
+ * They are never modified once initialized, so the contexts can be used from
+ * multiple threads at the same time as long as each thread uses its own
+ * context (BN_CTX is not thread-safe). The entries are kept until
+ * crypto_unload() so that the precomputation is not repeated for each session.
+ */
+struct crypto_ec_params {
+	int nid;
+	EC_GROUP *group;
+	BIGNUM *prime;
+	BIGNUM *order;
+	BIGNUM *a;
+	BIGNUM *b;
+	EVP_PKEY *keygen; /* parameters for ECDH key generation */
+};
+
+#define EC_PARAMS_FIRST_GROUP 19
+#define EC_PARAMS_LAST_GROUP 30
+
+static struct crypto_ec_params *
+ec_params[EC_PARAMS_LAST_GROUP - EC_PARAMS_FIRST_GROUP + 1];
+#ifdef CONFIG_WORKER_POOL
+static pthread_mutex_t ec_params_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* CONFIG_WORKER_POOL */
+
 struct crypto_ec {
+	/* Borrowed from struct crypto_ec_params; must not be modified */
 	EC_GROUP *group;
 	int nid;
-	BN_CTX *bnctx;
 	BIGNUM *prime;
 	BIGNUM *order;
 	BIGNUM *a;
 	BIGNUM *b;
+	const struct crypto_ec_params *params;
+
+	BN_CTX *bnctx;
 };
 
-struct crypto_ec * crypto_ec_init(int group)
-{
-	struct crypto_ec *e;
-	int nid;
 
+static int crypto_ec_group_to_nid(int group)
+{
 	/* Map from IANA registry for IKE D-H groups to OpenSSL NID */
 	switch (group) {
 	case 19:
-		nid = NID_X9_62_prime256v1;
-		break;
+		return NID_X9_62_prime256v1;
 	case 20:
-		nid = NID_secp384r1;
-		break;
+		return NID_secp384r1;
 	case 21:
-		nid = NID_secp521r1;
-		break;
+		return NID_secp521r1;
 	case 25:
-		nid = NID_X9_62_prime192v1;
-		break;
+		return NID_X9_62_prime192v1;
 	case 26:
-		nid = NID_secp224r1;
-		break;
+		return NID_secp224r1;
 #ifdef NID_brainpoolP224r1
 	case 27:
-		nid = NID_brainpoolP224r1;
-		break;
+		return NID_brainpoolP224r1;
 #endif /* NID_brainpoolP224r1 */
 #ifdef NID_brainpoolP256r1
 	case 28:
-		nid = NID_brainpoolP256r1;
-		break;
+		return NID_brainpoolP256r1;
 #endif /* NID_brainpoolP256r1 */
 #ifdef NID_brainpoolP384r1
 	case 29:
-		nid = NID_brainpoolP384r1;
-		break;
+		return NID_brainpoolP384r1;
 #endif /* NID_brainpoolP384r1 */
 #ifdef NID_brainpoolP512r1
 	case 30:
-		nid = NID_brainpoolP512r1;
-		break;
+		return NID_brainpoolP512r1;
 #endif /* NID_brainpoolP512r1 */
 	default:
+		return -1;
+	}
+}
+
+
+static void crypto_ec_params_free(struct crypto_ec_params *p)
+{
+	if (!p)
+		return;
+	EVP_PKEY_free(p->keygen);
+	BN_clear_free(p->b);
+	BN_clear_free(p->a);
+	BN_clear_free(p->order);
+	BN_clear_free(p->prime);
+	EC_GROUP_free(p->group);
+	os_free(p);
+}
+
+
+static struct crypto_ec_params * crypto_ec_params_init(int nid)
+{
+	struct crypto_ec_params *p;
+	EC_KEY *ec_key = NULL;
+	BN_CTX *bnctx;
+
+	p = os_zalloc(sizeof(*p));
+	bnctx = BN_CTX_new();
+	if (!p || !bnctx)
+		goto fail;
+
+	p->nid = nid;
+	p->group = EC_GROUP_new_by_curve_name(nid);
+	p->prime = BN_new();
+	p->order = BN_new();
+	p->a = BN_new();
+	p->b = BN_new();
+	if (!p->group || !p->prime || !p->order || !p->a || !p->b ||
+	    !EC_GROUP_get_curve_GFp(p->group, p->prime, p->a, p->b, bnctx) ||
+	    !EC_GROUP_get_order(p->group, p->order, bnctx))
+		goto fail;
+
+	/*
+	 * Precompute multiples of the generator once instead of for each
+	 * session. OpenSSL uses the table for operations with a public scalar;
+	 * secret scalar multiplication uses the constant time ladder.
+	 */
+	if (!EC_GROUP_have_precompute_mult(p->group) &&
+	    !EC_GROUP_precompute_mult(p->group, bnctx))
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Could not precompute generator multiples for curve %d",
+			   nid);
+
+	ec_key = EC_KEY_new_by_curve_name(nid);
+	p->keygen = EVP_PKEY_new();
+	if (!ec_key || !p->keygen)
+		goto fail;
+	EC_KEY_set_asn1_flag(ec_key, OPENSSL_EC_NAMED_CURVE);
+	if (EVP_PKEY_set1_EC_KEY(p->keygen, ec_key) != 1)
+		goto fail;
+
+	EC_KEY_free(ec_key);
+	BN_CTX_free(bnctx);
+	return p;
+
+fail:
+	EC_KEY_free(ec_key);
+	BN_CTX_free(bnctx);
+	crypto_ec_params_free(p);
+	return NULL;
+}
+
+
+static const struct crypto_ec_params * crypto_ec_get_params(int group)
+{
+	struct crypto_ec_params **slot, *p;
+	int nid;
+
+	nid = crypto_ec_group_to_nid(group);
+	if (nid < 0)
 		return NULL;
+	slot = &ec_params[group - EC_PARAMS_FIRST_GROUP];
+
+#ifdef CONFIG_WORKER_POOL
+	pthread_mutex_lock(&ec_params_lock);
+#endif /* CONFIG_WORKER_POOL */
+	p = *slot;
+	if (!p) {
+		p = crypto_ec_params_init(nid);
+		*slot = p;
+		if (p)
+			wpa_printf(MSG_DEBUG,
+				   "OpenSSL: Initialized shared parameters for EC group %d",
+				   group);
 	}
+#ifdef CONFIG_WORKER_POOL
+	pthread_mutex_unlock(&ec_params_lock);
+#endif /* CONFIG_WORKER_POOL */
+
+	return p;
+}
+
+
+static void crypto_ec_params_deinit(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(ec_params); i++) {
+		crypto_ec_params_free(ec_params[i]);
+		ec_params[i] = NULL;
+	}
+}
+
+
+struct crypto_ec * crypto_ec_init(int group)
+{
+	const struct crypto_ec_params *p;
+	struct crypto_ec *e;
+
+	p = crypto_ec_get_params(group);
+	if (!p)
+		return NULL;
 
 	e = os_zalloc(sizeof(*e));
 	if (e == NULL)
 		return NULL;
 
-	e->nid = nid;
+	e->params = p;
+	e->nid = p->nid;
+	e->group = p->group;
+	e->prime = p->prime;
+	e->order = p->order;
+	e->a = p->a;
+	e->b = p->b;
 	e->bnctx = BN_CTX_new();
-	e->group = EC_GROUP_new_by_curve_name(nid);
-	e->prime = BN_new();
-	e->order = BN_new();
-	e->a = BN_new();
-	e->b = BN_new();
-	if (e->group == NULL || e->bnctx == NULL || e->prime == NULL ||
-	    e->order == NULL || e->a == NULL || e->b == NULL ||
-	    !EC_GROUP_get_curve_GFp(e->group, e->prime, e->a, e->b, e->bnctx) ||
-	    !EC_GROUP_get_order(e->group, e->order, e->bnctx)) {
+	if (e->bnctx == NULL) {
 		crypto_ec_deinit(e);
 		e = NULL;
 	}
@@ -1693,11 +1993,6 @@ void crypto_ec_deinit(struct crypto_ec *e)
 {
 	if (e == NULL)
 		return;
-	BN_clear_free(e->b);
-	BN_clear_free(e->a);
-	BN_clear_free(e->order);
-	BN_clear_free(e->prime);
-	EC_GROUP_free(e->group);
 	BN_CTX_free(e->bnctx);
 	os_free(e);
 }
@@ -1948,8 +2243,6 @@ struct crypto_ecdh {
 struct crypto_ecdh * crypto_ecdh_init(int group)
 {
 	struct crypto_ecdh *ecdh;
-	EVP_PKEY *params = NULL;
-	EC_KEY *ec_params = NULL;
 	EVP_PKEY_CTX *kctx = NULL;
 
 	ecdh = os_zalloc(sizeof(*ecdh));
@@ -1960,21 +2253,7 @@ struct crypto_ecdh * crypto_ecdh_init(int group)
 	if (!ecdh->ec)
 		goto fail;
 
-	ec_params = EC_KEY_new_by_curve_name(ecdh->ec->nid);
-	if (!ec_params) {
-		wpa_printf(MSG_ERROR,
-			   "OpenSSL: Failed to generate EC_KEY parameters");
-		goto fail;
-	}
-	EC_KEY_set_asn1_flag(ec_params, OPENSSL_EC_NAMED_CURVE);
-	params = EVP_PKEY_new();
-	if (!params || EVP_PKEY_set1_EC_KEY(params, ec_params) != 1) {
-		wpa_printf(MSG_ERROR,
-			   "OpenSSL: Failed to generate EVP_PKEY parameters");
-		goto fail;
-	}
-
-	kctx = EVP_PKEY_CTX_new(params, NULL);
+	kctx = EVP_PKEY_CTX_new(ecdh->ec->params->keygen, NULL);
 	if (!kctx)
 		goto fail;
 
@@ -1992,8 +2271,6 @@ struct crypto_ecdh * crypto_ecdh_init(int group)
 	}
 
 done:
-	EC_KEY_free(ec_params);
-	EVP_PKEY_free(params);
 	EVP_PKEY_CTX_free(kctx);
 
 	return ecdh;
@@ -2175,3 +2452,11 @@ size_t crypto_ecdh_prime_len(struct crypto_ecdh *ecdh)
 }
 
 #endif /* CONFIG_ECC */
+
+
+void crypto_unload(void)
+{
+#ifdef CONFIG_ECC
+	crypto_ec_params_deinit();
+#endif /* CONFIG_ECC */
+}
@@ -29,6 +29,9 @@
 #include <sys/random.h>
 #endif /* CONFIG_GETRANDOM */
 #endif /* __linux__ */
+#ifdef CONFIG_WORKER_POOL
+#include <pthread.h>
+#endif /* CONFIG_WORKER_POOL */
 
 #include "utils/common.h"
 #include "utils/eloop.h"
@@ -57,6 +60,10 @@ static int random_fd = -1;
 static unsigned int own_pool_ready = 0;
 #define RANDOM_ENTROPY_SIZE 20
 static char *random_entropy_file = NULL;
+#ifdef CONFIG_WORKER_POOL
+/* random_get_bytes() may be called from worker threads */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* CONFIG_WORKER_POOL */
 
 #define MIN_COLLECT_ENTROPY 1000
 static unsigned int entropy = 0;
@@ -128,7 +135,7 @@ static void random_extract(u8 *out)
 }
 
 
-void random_add_randomness(const void *buf, size_t len)
+static void _random_add_randomness(const void *buf, size_t len)
 {
 	struct os_time t;
 	static unsigned int count = 0;
@@ -156,7 +163,19 @@ void random_add_randomness(const void *buf, size_t len)
 }
 
 
-int random_get_bytes(void *buf, size_t len)
+void random_add_randomness(const void *buf, size_t len)
+{
+#ifdef CONFIG_WORKER_POOL
+	pthread_mutex_lock(&pool_lock);
+#endif /* CONFIG_WORKER_POOL */
+	_random_add_randomness(buf, len);
+#ifdef CONFIG_WORKER_POOL
+	pthread_mutex_unlock(&pool_lock);
+#endif /* CONFIG_WORKER_POOL */
+}
+
+
+static int _random_get_bytes(void *buf, size_t len)
 {
 	int ret;
 	u8 *bytes = buf;
@@ -216,6 +235,22 @@ int random_get_bytes(void *buf, size_t len)
 }
 
 
+int random_get_bytes(void *buf, size_t len)
+{
+	int ret;
+
+#ifdef CONFIG_WORKER_POOL
+	pthread_mutex_lock(&pool_lock);
+#endif /* CONFIG_WORKER_POOL */
+	ret = _random_get_bytes(buf, len);
+#ifdef CONFIG_WORKER_POOL
+	pthread_mutex_unlock(&pool_lock);
+#endif /* CONFIG_WORKER_POOL */
+
+	return ret;
+}
+
+
 int random_pool_ready(void)
 {
 #ifdef __linux__
@@ -22,7 +22,8 @@ enum tls_event {
 	TLS_CERT_CHAIN_SUCCESS,
 	TLS_CERT_CHAIN_FAILURE,
 	TLS_PEER_CERTIFICATE,
-	TLS_ALERT
+	TLS_ALERT,
+	TLS_OCSP_STAPLING_REFRESH
 };
 
 /*
@@ -76,6 +77,11 @@ union tls_event_data {
 		const char *type;
 		const char *description;
 	} alert;
+
+	struct {
+		const char *file;
+		int valid;
+	} ocsp_refresh;
 };
 
 struct tls_config {
@@ -88,9 +94,11 @@ struct tls_config {
 	unsigned int tls_session_lifetime;
 	unsigned int crl_reload_interval;
 	unsigned int tls_flags;
+	unsigned int private_key_threads;
 
 	void (*event_cb)(void *ctx, enum tls_event ev,
 			 union tls_event_data *data);
+	void (*async_cb)(void *ctx, void *conn_ctx);
 	void *cb_ctx;
 };
 
@@ -470,6 +478,49 @@ struct wpabuf * tls_connection_server_handshake(void *tls_ctx,
 						const struct wpabuf *in_data,
 						struct wpabuf **appl_data);
 
+/**
+ * tls_connection_set_async - Allow asynchronous server handshake processing
+ * @tls_ctx: TLS context data from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * @conn_ctx: Context data for tls_config::async_cb for this connection
+ * Returns: 0 on success, -1 if not supported
+ *
+ * With tls_config::private_key_threads set, the server private key operations
+ * of this connection are done in worker threads. When
+ * tls_connection_server_handshake() returns %NULL and
+ * tls_connection_async_pending() returns 1, the handshake has not failed, but
+ * is waiting for such an operation. tls_config::async_cb is called once the
+ * operation has been completed and tls_connection_server_handshake() is then
+ * called again without new input data to continue the handshake.
+ */
+int tls_connection_set_async(void *tls_ctx, struct tls_connection *conn,
+			     void *conn_ctx);
+
+/**
+ * tls_connection_async_pending - Check whether handshake is waiting for async op
+ * @tls_ctx: TLS context data from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * Returns: 1 if the previous handshake call is waiting for an asynchronous
+ * private key operation, 0 if not
+ */
+int tls_connection_async_pending(void *tls_ctx, struct tls_connection *conn);
+
+/**
+ * tls_connection_add_input - Queue received handshake data
+ * @tls_ctx: TLS context data from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * @data: Received TLS data
+ * @len: Length of data in octets
+ * Returns: 0 on success, -1 on failure or if not supported
+ *
+ * This can be used to give the fragments of a received TLS message to the TLS
+ * library as they arrive instead of reassembling the full message in a
+ * separate buffer. The queued data is processed in the next
+ * tls_connection_server_handshake() call before its in_data.
+ */
+int tls_connection_add_input(void *tls_ctx, struct tls_connection *conn,
+			     const u8 *data, size_t len);
+
 /**
  * tls_connection_encrypt - Encrypt data into TLS tunnel
  * @tls_ctx: TLS context data from tls_init()
@@ -650,6 +701,61 @@ tls_connection_get_success_data(struct tls_connection *conn);
 
 void tls_connection_remove_session(struct tls_connection *conn);
 
+/**
+ * TLS_SESSION_TICKET_KEY_LEN - Length of a session ticket key
+ *
+ * A session ticket key consists of a 16-octet key name, a 32-octet
+ * HMAC-SHA256 key, and a 32-octet AES-256 key.
+ */
+#define TLS_SESSION_TICKET_KEY_LEN 80
+
+/**
+ * tls_global_set_session_ticket_keys - Set the server session ticket keys
+ * @tls_ctx: TLS context data from tls_init()
+ * @keys: Array of num_keys keys of TLS_SESSION_TICKET_KEY_LEN octets each
+ * @num_keys: Number of keys or 0 to use the library defaults
+ * Returns: 0 on success, -1 on failure (e.g., not supported)
+ *
+ * The first key is used to protect new session tickets; the other keys are
+ * only accepted for tickets that were issued before the key was rotated and
+ * such tickets are replaced with a new one on use. Servers that use the same
+ * keys can resume each other's sessions and the sessions survive a restart.
+ */
+int tls_global_set_session_ticket_keys(void *tls_ctx, const u8 *keys,
+				       size_t num_keys);
+
+/**
+ * tls_connection_set_ticket_data - Set application data for session tickets
+ * @tls_ctx: TLS context data from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * @data: Data to include in the session tickets issued on this connection
+ * Returns: 0 on success, -1 on failure
+ *
+ * The tickets are issued when the handshake completes, i.e., possibly before
+ * tls_connection_set_success_data() is called for the connection. The data
+ * set here is returned by tls_connection_get_success_data() when a session is
+ * resumed with such a ticket, so it must only be set if completing the TLS
+ * handshake is sufficient for the session to be considered valid.
+ */
+int tls_connection_set_ticket_data(void *tls_ctx, struct tls_connection *conn,
+				   const struct wpabuf *data);
+
+/**
+ * struct tls_session_stats - Server side session resumption statistics
+ * @resumed: Number of handshakes that resumed a previous session
+ * @full: Number of full handshakes
+ * @tickets_issued: Number of session tickets issued
+ * @ticket_key_misses: Number of tickets with an unknown or invalid key
+ */
+struct tls_session_stats {
+	unsigned int resumed;
+	unsigned int full;
+	unsigned int tickets_issued;
+	unsigned int ticket_key_misses;
+};
+
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats);
+
 /**
  * tls_get_tls_unique - Fetch "tls-unique" for channel binding
  * @conn: Connection context data from tls_connection_init()
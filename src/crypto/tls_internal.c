@@ -809,3 +809,43 @@ tls_connection_get_success_data(struct tls_connection *conn)
 void tls_connection_remove_session(struct tls_connection *conn)
 {
 }
+
+
+int tls_global_set_session_ticket_keys(void *tls_ctx, const u8 *keys,
+				       size_t num_keys)
+{
+	return -1;
+}
+
+
+int tls_connection_set_ticket_data(void *tls_ctx, struct tls_connection *conn,
+				   const struct wpabuf *data)
+{
+	return -1;
+}
+
+
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats)
+{
+	return -1;
+}
+
+
+int tls_connection_set_async(void *tls_ctx, struct tls_connection *conn,
+			     void *conn_ctx)
+{
+	return -1;
+}
+
+
+int tls_connection_async_pending(void *tls_ctx, struct tls_connection *conn)
+{
+	return 0;
+}
+
+
+int tls_connection_add_input(void *tls_ctx, struct tls_connection *conn,
+			     const u8 *data, size_t len)
+{
+	return -1;
+}
@@ -62,9 +62,34 @@ typedef int stack_index_t;
 #ifndef OPENSSL_NO_TLSEXT
 #define HAVE_OCSP
 #include <openssl/ocsp.h>
+#include <sys/stat.h>
 #endif /* OPENSSL_NO_TLSEXT */
 #endif /* SSL_set_tlsext_status_type */
 
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && \
+	!defined(LIBRESSL_VERSION_NUMBER) && !defined(OPENSSL_IS_BORINGSSL)
+/* Server session tickets with application data and configured keys */
+#define TLS_OPENSSL_TICKET_KEYS
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/rand.h>
+#else /* OpenSSL 3.0 */
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#endif /* OpenSSL 3.0 */
+#endif /* OpenSSL 1.1.1 */
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L && defined(CONFIG_WORKER_POOL) && \
+	!defined(OPENSSL_NO_ASYNC) && !defined(LIBRESSL_VERSION_NUMBER) && \
+	!defined(OPENSSL_IS_BORINGSSL)
+/* Server private key operations in worker threads using async jobs */
+#define TLS_OPENSSL_ASYNC_KEY
+#include <openssl/async.h>
+#include <openssl/ec.h>
+#include <openssl/rsa.h>
+#include "utils/worker_pool.h"
+#endif /* OpenSSL 1.1.0 && CONFIG_WORKER_POOL */
+
 #if (OPENSSL_VERSION_NUMBER < 0x10100000L || \
      (defined(LIBRESSL_VERSION_NUMBER) && \
       LIBRESSL_VERSION_NUMBER < 0x20700000L)) && \
@@ -207,12 +232,37 @@ static int tls_add_ca_from_keystore_encoded(X509_STORE *ctx,
 static int tls_openssl_ref_count = 0;
 static int tls_ex_idx_session = -1;
 
+#ifdef HAVE_OCSP
+/* OCSP stapling response cached from tls_context::ocsp_stapling_response */
+struct tls_ocsp_staple {
+	char *resp;
+	size_t resp_len;
+	/* Identity of the loaded file for detecting changes */
+	int loaded;
+	time_t mtime;
+	off_t size;
+	ino_t ino;
+	/* Whether resp could be parsed as an OCSP response */
+	int parsed;
+	/* thisUpdate/nextUpdate as os_time_t; 0 if not known */
+	os_time_t this_update;
+	os_time_t next_update;
+	struct os_reltime last_check;
+	struct os_reltime last_refresh;
+	int refresh_requested;
+};
+#endif /* HAVE_OCSP */
+
 struct tls_context {
 	void (*event_cb)(void *ctx, enum tls_event ev,
 			 union tls_event_data *data);
 	void *cb_ctx;
 	int cert_in_cb;
 	char *ocsp_stapling_response;
+#ifdef HAVE_OCSP
+	struct tls_ocsp_staple ocsp_staple;
+#endif /* HAVE_OCSP */
+	void (*async_cb)(void *ctx, void *conn_ctx);
 };
 
 static struct tls_context *tls_global = NULL;
@@ -227,6 +277,16 @@ struct tls_data {
 	unsigned int crl_reload_interval;
 	struct os_reltime crl_last_reload;
 	char *check_cert_subject;
+#ifdef TLS_OPENSSL_TICKET_KEYS
+	u8 *ticket_keys; /* TLS_SESSION_TICKET_KEY_LEN octets each; the first
+			  * one is used for new tickets */
+	size_t num_ticket_keys;
+#endif /* TLS_OPENSSL_TICKET_KEYS */
+	struct tls_session_stats session_stats;
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	unsigned int private_key_threads;
+	struct worker_pool *key_pool;
+#endif /* TLS_OPENSSL_ASYNC_KEY */
 };
 
 struct tls_connection {
@@ -250,6 +310,11 @@ struct tls_connection {
 	u8 *session_ticket;
 	size_t session_ticket_len;
 
+	/* Application data for the issued session tickets (server) */
+	struct wpabuf *ticket_data;
+	/* Application data from the session ticket used for resumption */
+	struct wpabuf *ticket_session_data;
+
 	unsigned int ca_cert_verify:1;
 	unsigned int cert_probe:1;
 	unsigned int server_cert_only:1;
@@ -257,6 +322,10 @@ struct tls_connection {
 	unsigned int success_data:1;
 	unsigned int client_hello_generated:1;
 	unsigned int server:1;
+	unsigned int ticket_resumed:1;
+	unsigned int session_counted:1;
+	unsigned int async_pending:1;
+	unsigned int async_deinit:1;
 
 	u8 srv_cert_hash[32];
 
@@ -271,6 +340,12 @@ struct tls_connection {
 
 	u16 cipher_suite;
 	int server_dh_prime_len;
+
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	/* Private key operation in a worker thread (paused async job) */
+	struct tls_async_key_op *async_op;
+	void *async_ctx;
+#endif /* TLS_OPENSSL_ASYNC_KEY */
 };
 
 
@@ -283,6 +358,7 @@ static struct tls_context * tls_context_new(const struct tls_config *conf)
 		context->event_cb = conf->event_cb;
 		context->cb_ctx = conf->cb_ctx;
 		context->cert_in_cb = conf->cert_in_cb;
+		context->async_cb = conf->async_cb;
 	}
 	return context;
 }
@@ -772,6 +848,18 @@ static void ssl_info_cb(const SSL *ssl, int where, int ret)
 		wpa_printf(MSG_DEBUG, "SSL: %s:%s in %s",
 			   str, ret == 0 ? "failed" : "error",
 			   SSL_state_string_long(ssl));
+	} else if ((where & SSL_CB_HANDSHAKE_DONE) &&
+		   SSL_is_server((SSL *) ssl)) {
+		struct tls_connection *conn = SSL_get_app_data((SSL *) ssl);
+
+		/* TLS v1.3 reports this again after each NewSessionTicket */
+		if (conn && !conn->session_counted) {
+			conn->session_counted = 1;
+			if (SSL_session_reused((SSL *) ssl))
+				conn->data->session_stats.resumed++;
+			else
+				conn->data->session_stats.full++;
+		}
 	}
 }
 
@@ -948,6 +1036,432 @@ static void remove_session_cb(SSL_CTX *ctx, SSL_SESSION *sess)
 }
 
 
+#ifdef TLS_OPENSSL_TICKET_KEYS
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int tls_ticket_mac_init(EVP_MAC_CTX *hctx, const u8 *key)
+{
+	OSSL_PARAM params[2];
+
+	params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+						     "SHA256", 0);
+	params[1] = OSSL_PARAM_construct_end();
+	return EVP_MAC_init(hctx, key, 32, params) == 1 ? 0 : -1;
+}
+#else /* OpenSSL 3.0 */
+static int tls_ticket_mac_init(HMAC_CTX *hctx, const u8 *key)
+{
+	return HMAC_Init_ex(hctx, key, 32, EVP_sha256(), NULL) == 1 ? 0 : -1;
+}
+#endif /* OpenSSL 3.0 */
+
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int tls_ticket_key_cb(SSL *ssl, unsigned char *key_name,
+			     unsigned char *iv, EVP_CIPHER_CTX *ctx,
+			     EVP_MAC_CTX *hctx, int enc)
+#else /* OpenSSL 3.0 */
+static int tls_ticket_key_cb(SSL *ssl, unsigned char *key_name,
+			     unsigned char *iv, EVP_CIPHER_CTX *ctx,
+			     HMAC_CTX *hctx, int enc)
+#endif /* OpenSSL 3.0 */
+{
+	struct tls_connection *conn = SSL_get_app_data(ssl);
+	struct tls_data *data = conn->data;
+	const u8 *key;
+	size_t i;
+
+	if (!data->num_ticket_keys)
+		return -1;
+
+	/*
+	 * Key layout: 16-octet key name, 32-octet HMAC-SHA256 key, 32-octet
+	 * AES-256 key
+	 */
+	if (enc) {
+		key = data->ticket_keys;
+		if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) !=
+		    1)
+			return -1;
+		os_memcpy(key_name, key, 16);
+		if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key + 48,
+				       iv) != 1 ||
+		    tls_ticket_mac_init(hctx, key + 16) < 0)
+			return -1;
+		data->session_stats.tickets_issued++;
+		return 1;
+	}
+
+	for (i = 0; i < data->num_ticket_keys; i++) {
+		key = &data->ticket_keys[i * TLS_SESSION_TICKET_KEY_LEN];
+		if (os_memcmp(key_name, key, 16) == 0)
+			break;
+	}
+	if (i == data->num_ticket_keys) {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Session ticket with an unknown key name");
+		return 0;
+	}
+
+	if (tls_ticket_mac_init(hctx, key + 16) < 0 ||
+	    EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key + 48,
+			       iv) != 1)
+		return -1;
+
+	/* Replace tickets protected with an old key */
+	return i == 0 ? 1 : 2;
+}
+
+
+static int tls_ticket_gen_cb(SSL *ssl, void *arg)
+{
+	struct tls_connection *conn = SSL_get_app_data(ssl);
+	SSL_SESSION *sess = SSL_get_session(ssl);
+	const struct wpabuf *buf;
+
+	buf = conn->ticket_data;
+	if (!buf && SSL_session_reused(ssl))
+		buf = conn->ticket_session_data;
+	if (!sess || !buf)
+		return 1;
+	return SSL_SESSION_set1_ticket_appdata(sess, wpabuf_head(buf),
+					       wpabuf_len(buf));
+}
+
+
+static SSL_TICKET_RETURN tls_ticket_dec_cb(SSL *ssl, SSL_SESSION *sess,
+					   const unsigned char *keyname,
+					   size_t keyname_len,
+					   SSL_TICKET_STATUS status,
+					   void *arg)
+{
+	struct tls_data *data = arg;
+	struct tls_connection *conn = SSL_get_app_data(ssl);
+	void *appdata;
+	size_t len;
+
+	switch (status) {
+	case SSL_TICKET_SUCCESS:
+	case SSL_TICKET_SUCCESS_RENEW:
+		break;
+	case SSL_TICKET_NO_DECRYPT:
+		data->session_stats.ticket_key_misses++;
+		return SSL_TICKET_RETURN_IGNORE_RENEW;
+	default:
+		return SSL_TICKET_RETURN_IGNORE_RENEW;
+	}
+
+	wpabuf_free(conn->ticket_session_data);
+	conn->ticket_session_data = NULL;
+	if (SSL_SESSION_get0_ticket_appdata(sess, &appdata, &len) == 1 &&
+	    len > 0) {
+		conn->ticket_session_data = wpabuf_alloc_copy(appdata, len);
+		if (!conn->ticket_session_data)
+			return SSL_TICKET_RETURN_IGNORE_RENEW;
+	}
+	conn->ticket_resumed = 1;
+	wpa_printf(MSG_DEBUG, "OpenSSL: Accepted session ticket (%zu octets of application data)",
+		   len);
+
+	return status == SSL_TICKET_SUCCESS_RENEW ?
+		SSL_TICKET_RETURN_USE_RENEW : SSL_TICKET_RETURN_USE;
+}
+
+#endif /* TLS_OPENSSL_TICKET_KEYS */
+
+
+#ifdef TLS_OPENSSL_ASYNC_KEY
+
+/*
+ * Server private key operations can be done in worker threads. The keys are
+ * wrapped with RSA/EC key methods that submit the operation to the worker pool
+ * and pause the OpenSSL async job that is running the handshake. The EAP
+ * server is notified through tls_config::async_cb once the operation has been
+ * completed and it continues the handshake from where it was paused.
+ */
+
+struct tls_async_key_op {
+	struct tls_connection *conn;
+	RSA *rsa;
+	EC_KEY *ec;
+	int type; /* padding for RSA, digest type for EC */
+	const u8 *in;
+	int in_len;
+	u8 *out;
+	unsigned int out_len;
+	int res;
+	int done;
+};
+
+static RSA_METHOD *tls_async_rsa_meth = NULL;
+static EC_KEY_METHOD *tls_async_ec_meth = NULL;
+static int (*tls_async_rsa_priv_enc_orig)(int flen, const unsigned char *from,
+					  unsigned char *to, RSA *rsa,
+					  int padding);
+static int (*tls_async_ec_sign_orig)(int type, const unsigned char *dgst,
+				     int dlen, unsigned char *sig,
+				     unsigned int *siglen, const BIGNUM *kinv,
+				     const BIGNUM *r, EC_KEY *eckey);
+
+/* Connection for which SSL_accept() is being called */
+static struct tls_connection *tls_async_conn = NULL;
+
+
+/* Called in a worker thread */
+static void tls_async_key_job(void *ctx)
+{
+	struct tls_async_key_op *op = ctx;
+
+	if (op->rsa) {
+		op->res = tls_async_rsa_priv_enc_orig(op->in_len, op->in,
+						      op->out, op->rsa,
+						      op->type);
+	} else {
+		op->res = tls_async_ec_sign_orig(op->type, op->in, op->in_len,
+						 op->out, &op->out_len, NULL,
+						 NULL, op->ec);
+	}
+}
+
+
+static void tls_async_key_done(void *ctx)
+{
+	struct tls_async_key_op *op = ctx;
+	struct tls_connection *conn = op->conn;
+	struct tls_context *context = conn->context;
+
+	op->done = 1;
+	if (conn->async_deinit) {
+		tls_connection_deinit(NULL, conn);
+		return;
+	}
+
+	if (context->async_cb)
+		context->async_cb(context->cb_ctx, conn->async_ctx);
+}
+
+
+/*
+ * Run the private key operation in a worker thread and pause the async job
+ * until it has been completed. Returns 1 if the operation was completed in a
+ * worker thread or 0 if it needs to be done in the calling thread.
+ */
+static int tls_async_key_op(struct tls_async_key_op *op)
+{
+	struct tls_connection *conn = tls_async_conn;
+
+	if (!conn || !ASYNC_get_current_job())
+		return 0;
+
+	op->conn = conn;
+	if (worker_pool_submit(conn->data->key_pool, tls_async_key_job,
+			       tls_async_key_done, op) < 0)
+		return 0;
+	conn->async_op = op;
+
+	while (!op->done) {
+		if (!ASYNC_pause_job()) {
+			/* Not expected to happen since a job is running */
+			wpa_printf(MSG_ERROR,
+				   "OpenSSL: Failed to pause async job");
+			worker_pool_flush(conn->data->key_pool);
+			break;
+		}
+	}
+
+	conn->async_op = NULL;
+	if (conn->async_deinit)
+		op->res = -1;
+	return 1;
+}
+
+
+static int tls_async_rsa_priv_enc(int flen, const unsigned char *from,
+				  unsigned char *to, RSA *rsa, int padding)
+{
+	struct tls_async_key_op op;
+	int len = RSA_size(rsa);
+
+	os_memset(&op, 0, sizeof(op));
+	op.rsa = rsa;
+	op.type = padding;
+	op.in = from;
+	op.in_len = flen;
+	op.out = os_malloc(len);
+	if (!op.out)
+		return -1;
+
+	if (!tls_async_key_op(&op))
+		op.res = tls_async_rsa_priv_enc_orig(flen, from, op.out, rsa,
+						     padding);
+	if (op.res > 0 && op.res <= len)
+		os_memcpy(to, op.out, op.res);
+	bin_clear_free(op.out, len);
+	return op.res;
+}
+
+
+static int tls_async_ec_sign(int type, const unsigned char *dgst, int dlen,
+			     unsigned char *sig, unsigned int *siglen,
+			     const BIGNUM *kinv, const BIGNUM *r,
+			     EC_KEY *eckey)
+{
+	struct tls_async_key_op op;
+	int len = ECDSA_size(eckey);
+
+	if (kinv || r || len <= 0)
+		return tls_async_ec_sign_orig(type, dgst, dlen, sig, siglen,
+					      kinv, r, eckey);
+
+	os_memset(&op, 0, sizeof(op));
+	op.ec = eckey;
+	op.type = type;
+	op.in = dgst;
+	op.in_len = dlen;
+	op.out = os_malloc(len);
+	op.out_len = len;
+	if (!op.out)
+		return 0;
+
+	if (!tls_async_key_op(&op))
+		op.res = tls_async_ec_sign_orig(type, dgst, dlen, op.out,
+						&op.out_len, NULL, NULL,
+						eckey);
+	if (op.res == 1 && op.out_len <= (unsigned int) len) {
+		os_memcpy(sig, op.out, op.out_len);
+		*siglen = op.out_len;
+	} else {
+		op.res = 0;
+	}
+	os_free(op.out);
+	return op.res;
+}
+
+
+static EVP_PKEY * tls_async_wrap_rsa(EVP_PKEY *pkey)
+{
+	EVP_PKEY *wrapped;
+	RSA *rsa;
+
+	rsa = EVP_PKEY_get1_RSA(pkey);
+	if (!rsa)
+		return NULL;
+	if (RSA_get_method(rsa) != RSA_get_default_method()) {
+		/* Engine based keys are used only in the main thread */
+		RSA_free(rsa);
+		return NULL;
+	}
+
+	if (!tls_async_rsa_meth) {
+		tls_async_rsa_meth = RSA_meth_dup(RSA_get_default_method());
+		if (!tls_async_rsa_meth ||
+		    RSA_meth_set1_name(tls_async_rsa_meth,
+				       "hostapd async RSA") != 1) {
+			RSA_meth_free(tls_async_rsa_meth);
+			tls_async_rsa_meth = NULL;
+			RSA_free(rsa);
+			return NULL;
+		}
+		tls_async_rsa_priv_enc_orig =
+			RSA_meth_get_priv_enc(tls_async_rsa_meth);
+		RSA_meth_set_priv_enc(tls_async_rsa_meth,
+				      tls_async_rsa_priv_enc);
+	}
+
+	wrapped = EVP_PKEY_new();
+	if (!wrapped || RSA_set_method(rsa, tls_async_rsa_meth) != 1 ||
+	    EVP_PKEY_assign_RSA(wrapped, rsa) != 1) {
+		EVP_PKEY_free(wrapped);
+		RSA_free(rsa);
+		return NULL;
+	}
+
+	return wrapped;
+}
+
+
+static EVP_PKEY * tls_async_wrap_ec(EVP_PKEY *pkey)
+{
+	EVP_PKEY *wrapped;
+	EC_KEY *ec;
+
+	ec = EVP_PKEY_get1_EC_KEY(pkey);
+	if (!ec)
+		return NULL;
+	if (EC_KEY_get_method(ec) != EC_KEY_get_default_method()) {
+		/* Engine based keys are used only in the main thread */
+		EC_KEY_free(ec);
+		return NULL;
+	}
+
+	if (!tls_async_ec_meth) {
+		int (*sign_setup)(EC_KEY *eckey, BN_CTX *ctx_in,
+				  BIGNUM **kinvp, BIGNUM **rp);
+		ECDSA_SIG * (*sign_sig)(const unsigned char *dgst, int dgst_len,
+					const BIGNUM *in_kinv,
+					const BIGNUM *in_r, EC_KEY *eckey);
+
+		tls_async_ec_meth =
+			EC_KEY_METHOD_new(EC_KEY_get_default_method());
+		if (!tls_async_ec_meth) {
+			EC_KEY_free(ec);
+			return NULL;
+		}
+		EC_KEY_METHOD_get_sign(tls_async_ec_meth,
+				       &tls_async_ec_sign_orig, &sign_setup,
+				       &sign_sig);
+		EC_KEY_METHOD_set_sign(tls_async_ec_meth, tls_async_ec_sign,
+				       sign_setup, sign_sig);
+	}
+
+	wrapped = EVP_PKEY_new();
+	if (!wrapped || EC_KEY_set_method(ec, tls_async_ec_meth) != 1 ||
+	    EVP_PKEY_assign_EC_KEY(wrapped, ec) != 1) {
+		EVP_PKEY_free(wrapped);
+		EC_KEY_free(ec);
+		return NULL;
+	}
+
+	return wrapped;
+}
+
+
+/* Replace the configured server private keys with the async wrapped ones */
+static void tls_async_wrap_keys(struct tls_data *data)
+{
+	SSL_CTX *ssl_ctx = data->ssl;
+	EVP_PKEY *pkey, *wrapped;
+	int res, type;
+
+	res = SSL_CTX_set_current_cert(ssl_ctx, SSL_CERT_SET_FIRST);
+	while (res == 1) {
+		pkey = SSL_CTX_get0_privatekey(ssl_ctx);
+		type = pkey ? EVP_PKEY_base_id(pkey) : EVP_PKEY_NONE;
+		if (type == EVP_PKEY_RSA)
+			wrapped = tls_async_wrap_rsa(pkey);
+		else if (type == EVP_PKEY_EC)
+			wrapped = tls_async_wrap_ec(pkey);
+		else
+			wrapped = NULL;
+
+		if (wrapped) {
+			if (SSL_CTX_use_PrivateKey(ssl_ctx, wrapped) == 1)
+				wpa_printf(MSG_DEBUG,
+					   "OpenSSL: Private key operations for %s key in worker threads",
+					   type == EVP_PKEY_RSA ? "RSA" : "EC");
+			else
+				tls_show_errors(MSG_INFO, __func__,
+						"Failed to use wrapped private key");
+			EVP_PKEY_free(wrapped);
+		}
+
+		res = SSL_CTX_set_current_cert(ssl_ctx, SSL_CERT_SET_NEXT);
+	}
+}
+
+#endif /* TLS_OPENSSL_ASYNC_KEY */
+
+
 void * tls_init(const struct tls_config *conf)
 {
 	struct tls_data *data;
@@ -1041,6 +1555,16 @@ void * tls_init(const struct tls_config *conf)
 		data->crl_reload_interval = conf->crl_reload_interval;
 	}
 
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	if (conf && conf->private_key_threads) {
+		if (!ASYNC_is_capable())
+			wpa_printf(MSG_INFO,
+				   "OpenSSL: Async jobs not supported - private key operations in the main thread");
+		else
+			data->private_key_threads = conf->private_key_threads;
+	}
+#endif /* TLS_OPENSSL_ASYNC_KEY */
+
 	SSL_CTX_set_options(ssl, SSL_OP_NO_SSLv2);
 	SSL_CTX_set_options(ssl, SSL_OP_NO_SSLv3);
 
@@ -1064,6 +1588,10 @@ void * tls_init(const struct tls_config *conf)
 		SSL_CTX_set_session_cache_mode(ssl, SSL_SESS_CACHE_SERVER);
 		SSL_CTX_set_timeout(ssl, data->tls_session_lifetime);
 		SSL_CTX_sess_set_remove_cb(ssl, remove_session_cb);
+#ifdef TLS_OPENSSL_TICKET_KEYS
+		SSL_CTX_set_session_ticket_cb(ssl, tls_ticket_gen_cb,
+					      tls_ticket_dec_cb, data);
+#endif /* TLS_OPENSSL_TICKET_KEYS */
 	} else {
 		SSL_CTX_set_session_cache_mode(ssl, SSL_SESS_CACHE_OFF);
 	}
@@ -1114,11 +1642,20 @@ void tls_deinit(void *ssl_ctx)
 	struct tls_data *data = ssl_ctx;
 	SSL_CTX *ssl = data->ssl;
 	struct tls_context *context = SSL_CTX_get_app_data(ssl);
+
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	/* Complete pending operations, including deferred connection deinit */
+	worker_pool_deinit(data->key_pool);
+#endif /* TLS_OPENSSL_ASYNC_KEY */
 	if (context != tls_global)
 		os_free(context);
 	if (data->tls_session_lifetime > 0)
 		SSL_CTX_flush_sessions(ssl, 0);
 	os_free(data->ca_cert);
+#ifdef TLS_OPENSSL_TICKET_KEYS
+	bin_clear_free(data->ticket_keys,
+		       data->num_ticket_keys * TLS_SESSION_TICKET_KEY_LEN);
+#endif /* TLS_OPENSSL_TICKET_KEYS */
 	SSL_CTX_free(ssl);
 
 	tls_openssl_ref_count--;
@@ -1136,8 +1673,18 @@ void tls_deinit(void *ssl_ctx)
 #endif /* < 1.1.0 */
 		os_free(tls_global->ocsp_stapling_response);
 		tls_global->ocsp_stapling_response = NULL;
+#ifdef HAVE_OCSP
+		os_free(tls_global->ocsp_staple.resp);
+#endif /* HAVE_OCSP */
 		os_free(tls_global);
 		tls_global = NULL;
+#ifdef TLS_OPENSSL_ASYNC_KEY
+		RSA_meth_free(tls_async_rsa_meth);
+		tls_async_rsa_meth = NULL;
+		if (tls_async_ec_meth)
+			EC_KEY_METHOD_free(tls_async_ec_meth);
+		tls_async_ec_meth = NULL;
+#endif /* TLS_OPENSSL_ASYNC_KEY */
 	}
 
 	os_free(data->check_cert_subject);
@@ -1613,6 +2160,17 @@ void tls_connection_deinit(void *ssl_ctx, struct tls_connection *conn)
 {
 	if (conn == NULL)
 		return;
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	if (conn->async_op) {
+		conn->async_deinit = 1;
+		if (!conn->async_op->done) {
+			/* Freed once the operation has been completed */
+			return;
+		}
+		/* Let the paused job terminate before freeing the SSL */
+		SSL_do_handshake(conn->ssl);
+	}
+#endif /* TLS_OPENSSL_ASYNC_KEY */
 	if (conn->success_data) {
 		/*
 		 * Make sure ssl_clear_bad_session() does not remove this
@@ -1629,6 +2187,8 @@ void tls_connection_deinit(void *ssl_ctx, struct tls_connection *conn)
 	os_free(conn->domain_match);
 	os_free(conn->check_cert_subject);
 	os_free(conn->session_ticket);
+	wpabuf_free(conn->ticket_data);
+	wpabuf_free(conn->ticket_session_data);
 	os_free(conn);
 }
 
@@ -1674,6 +2234,10 @@ int tls_connection_shutdown(void *ssl_ctx, struct tls_connection *conn)
 	 * and "close notify" shutdown alert would confuse AS. */
 	SSL_set_quiet_shutdown(conn->ssl, 1);
 	SSL_shutdown(conn->ssl);
+	wpabuf_free(conn->ticket_session_data);
+	conn->ticket_session_data = NULL;
+	conn->ticket_resumed = 0;
+	conn->session_counted = 0;
 	return SSL_clear(conn->ssl) == 1 ? 0 : -1;
 }
 
@@ -4190,6 +4754,16 @@ openssl_handshake(struct tls_connection *conn, const struct wpabuf *in_data)
 	int res;
 	struct wpabuf *out_data;
 
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	conn->async_pending = 0;
+	if (conn->async_op && !conn->async_op->done) {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Private key operation still pending");
+		conn->async_pending = 1;
+		return NULL;
+	}
+#endif /* TLS_OPENSSL_ASYNC_KEY */
+
 	/*
 	 * Give TLS handshake data from the server (if available) to OpenSSL
 	 * for processing.
@@ -4203,10 +4777,17 @@ openssl_handshake(struct tls_connection *conn, const struct wpabuf *in_data)
 	}
 
 	/* Initiate TLS handshake or continue the existing handshake */
-	if (conn->server)
+	if (conn->server) {
+#ifdef TLS_OPENSSL_ASYNC_KEY
+		tls_async_conn = conn->async_ctx ? conn : NULL;
+#endif /* TLS_OPENSSL_ASYNC_KEY */
 		res = SSL_accept(conn->ssl);
-	else
+#ifdef TLS_OPENSSL_ASYNC_KEY
+		tls_async_conn = NULL;
+#endif /* TLS_OPENSSL_ASYNC_KEY */
+	} else {
 		res = SSL_connect(conn->ssl);
+	}
 	if (res != 1) {
 		int err = SSL_get_error(conn->ssl, res);
 		if (err == SSL_ERROR_WANT_READ)
@@ -4215,6 +4796,14 @@ openssl_handshake(struct tls_connection *conn, const struct wpabuf *in_data)
 		else if (err == SSL_ERROR_WANT_WRITE)
 			wpa_printf(MSG_DEBUG, "SSL: SSL_connect - want to "
 				   "write");
+#ifdef TLS_OPENSSL_ASYNC_KEY
+		else if (err == SSL_ERROR_WANT_ASYNC) {
+			wpa_printf(MSG_DEBUG,
+				   "SSL: SSL_accept - private key operation in a worker thread");
+			conn->async_pending = 1;
+			return NULL;
+		}
+#endif /* TLS_OPENSSL_ASYNC_KEY */
 		else {
 			tls_show_errors(MSG_INFO, __func__, "SSL_connect");
 			conn->failed++;
@@ -4413,6 +5002,56 @@ struct wpabuf * tls_connection_server_handshake(void *tls_ctx,
 }
 
 
+int tls_connection_set_async(void *tls_ctx, struct tls_connection *conn,
+			     void *conn_ctx)
+{
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	struct tls_data *data = tls_ctx;
+
+	if (!conn || !data->private_key_threads)
+		return -1;
+	if (!data->key_pool) {
+		/* Threads are started on first use, i.e., after the process
+		 * may have been daemonized. */
+		data->key_pool = worker_pool_init(data->private_key_threads);
+		if (!data->key_pool) {
+			wpa_printf(MSG_INFO,
+				   "OpenSSL: Failed to start worker threads - private key operations in the main thread");
+			data->private_key_threads = 0;
+			return -1;
+		}
+	}
+	SSL_set_mode(conn->ssl, SSL_MODE_ASYNC);
+	conn->async_ctx = conn_ctx;
+	return 0;
+#else /* TLS_OPENSSL_ASYNC_KEY */
+	return -1;
+#endif /* TLS_OPENSSL_ASYNC_KEY */
+}
+
+
+int tls_connection_async_pending(void *tls_ctx, struct tls_connection *conn)
+{
+	return conn ? conn->async_pending : 0;
+}
+
+
+int tls_connection_add_input(void *tls_ctx, struct tls_connection *conn,
+			     const u8 *data, size_t len)
+{
+	if (!conn)
+		return -1;
+	if (len == 0)
+		return 0;
+	/* The memory BIO keeps the data until the next SSL_accept() call */
+	if (BIO_write(conn->ssl_in, data, len) != (int) len) {
+		tls_show_errors(MSG_INFO, __func__, "BIO_write failed");
+		return -1;
+	}
+	return 0;
+}
+
+
 struct wpabuf * tls_connection_encrypt(void *tls_ctx,
 				       struct tls_connection *conn,
 				       const struct wpabuf *in_data)
@@ -4485,10 +5124,20 @@ struct wpabuf * tls_connection_decrypt(void *tls_ctx,
 		return NULL;
 	res = SSL_read(conn->ssl, wpabuf_mhead(buf), wpabuf_size(buf));
 	if (res < 0) {
-		tls_show_errors(MSG_INFO, __func__,
-				"Decryption failed - SSL_read");
-		wpabuf_free(buf);
-		return NULL;
+		int err = SSL_get_error(conn->ssl, res);
+
+		if (err == SSL_ERROR_WANT_READ) {
+			/* TLS v1.3 post-handshake message, e.g.,
+			 * NewSessionTicket, without any application data */
+			wpa_printf(MSG_DEBUG,
+				   "SSL: No Application Data included");
+			res = 0;
+		} else {
+			tls_show_errors(MSG_INFO, __func__,
+					"Decryption failed - SSL_read");
+			wpabuf_free(buf);
+			return NULL;
+		}
 	}
 	wpabuf_put(buf, res);
 
@@ -4874,34 +5523,207 @@ static int ocsp_resp_cb(SSL *s, void *arg)
 }
 
 
+/* Minimum interval in seconds between checks for a changed response file */
+#define OCSP_STAPLE_CHECK_INTERVAL 1
+/* Minimum interval in seconds between refresh requests */
+#define OCSP_STAPLE_REFRESH_INTERVAL 60
+
+
+static os_time_t ocsp_time(ASN1_GENERALIZEDTIME *t, os_time_t now)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L && !defined(LIBRESSL_VERSION_NUMBER)
+	int days, secs;
+
+	if (t && ASN1_TIME_diff(&days, &secs, NULL, t))
+		return now + days * 86400 + secs;
+#endif /* >= 1.0.2 */
+	return 0;
+}
+
+
+/* Find the validity period of the response; the earliest one if there are
+ * multiple single responses */
+static int ocsp_staple_parse(struct tls_ocsp_staple *staple)
+{
+	const unsigned char *p = (const unsigned char *) staple->resp;
+	OCSP_RESPONSE *rsp;
+	OCSP_BASICRESP *basic = NULL;
+	ASN1_GENERALIZEDTIME *this_update, *next_update;
+	struct os_time now;
+	os_time_t t;
+	int i, ret = -1;
+
+	staple->this_update = staple->next_update = 0;
+
+	rsp = d2i_OCSP_RESPONSE(NULL, &p, staple->resp_len);
+	if (!rsp)
+		return -1;
+	if (OCSP_response_status(rsp) != OCSP_RESPONSE_STATUS_SUCCESSFUL)
+		goto fail;
+	basic = OCSP_response_get1_basic(rsp);
+	if (!basic)
+		goto fail;
+
+	os_get_time(&now);
+	for (i = 0; i < OCSP_resp_count(basic); i++) {
+		if (OCSP_single_get0_status(OCSP_resp_get0(basic, i), NULL,
+					    NULL, &this_update,
+					    &next_update) < 0)
+			goto fail;
+		t = ocsp_time(next_update, now.sec);
+		if (t && (!staple->next_update || t < staple->next_update)) {
+			staple->next_update = t;
+			staple->this_update = ocsp_time(this_update, now.sec);
+		}
+	}
+	ret = 0;
+fail:
+	OCSP_BASICRESP_free(basic);
+	OCSP_RESPONSE_free(rsp);
+	return ret;
+}
+
+
+/* Reload the cached response if the file has been changed */
+static void ocsp_staple_update(struct tls_context *context,
+			       struct os_reltime *now)
+{
+	struct tls_ocsp_staple *staple = &context->ocsp_staple;
+	const char *fname = context->ocsp_stapling_response;
+	struct stat st;
+
+	if (staple->last_check.sec &&
+	    !os_reltime_expired(now, &staple->last_check,
+				OCSP_STAPLE_CHECK_INTERVAL))
+		return;
+	staple->last_check = *now;
+
+	if (stat(fname, &st) < 0) {
+		if (staple->loaded)
+			wpa_printf(MSG_INFO,
+				   "OpenSSL: OCSP stapling response file %s removed",
+				   fname);
+		os_free(staple->resp);
+		staple->resp = NULL;
+		staple->loaded = 0;
+		staple->parsed = 0;
+		return;
+	}
+
+	if (staple->loaded && st.st_mtime == staple->mtime &&
+	    st.st_size == staple->size && st.st_ino == staple->ino)
+		return;
+
+	os_free(staple->resp);
+	staple->resp = os_readfile(fname, &staple->resp_len);
+	staple->loaded = 1;
+	staple->mtime = st.st_mtime;
+	staple->size = st.st_size;
+	staple->ino = st.st_ino;
+	staple->refresh_requested = 0;
+	staple->parsed = 0;
+	if (!staple->resp) {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Could not read OCSP stapling response from %s",
+			   fname);
+		return;
+	}
+
+	staple->parsed = ocsp_staple_parse(staple) == 0;
+	if (!staple->parsed) {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Could not parse OCSP stapling response from %s",
+			   fname);
+	} else if (staple->next_update) {
+		struct os_time t;
+
+		os_get_time(&t);
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Loaded OCSP stapling response from %s (nextUpdate in %ld seconds)",
+			   fname, (long) (staple->next_update - t.sec));
+	} else {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Loaded OCSP stapling response from %s (no nextUpdate)",
+			   fname);
+	}
+}
+
+
+/* Request a new response once half of the validity period has passed or if
+ * there is no usable response */
+static void ocsp_staple_check_refresh(struct tls_context *context,
+				      struct tls_context *ev_context,
+				      struct os_reltime *now, os_time_t now_sec,
+				      int valid)
+{
+	struct tls_ocsp_staple *staple = &context->ocsp_staple;
+	union tls_event_data ev;
+
+	if (valid && (!staple->next_update ||
+		      now_sec < staple->next_update -
+		      (staple->next_update - staple->this_update) / 2))
+		return;
+	if (staple->refresh_requested &&
+	    !os_reltime_expired(now, &staple->last_refresh,
+				OCSP_STAPLE_REFRESH_INTERVAL))
+		return;
+	staple->refresh_requested = 1;
+	staple->last_refresh = *now;
+
+	wpa_printf(MSG_DEBUG, "OpenSSL: Request OCSP stapling response refresh");
+	if (!ev_context || !ev_context->event_cb)
+		return;
+	os_memset(&ev, 0, sizeof(ev));
+	ev.ocsp_refresh.file = context->ocsp_stapling_response;
+	ev.ocsp_refresh.valid = valid;
+	ev_context->event_cb(ev_context->cb_ctx, TLS_OCSP_STAPLING_REFRESH,
+			     &ev);
+}
+
+
 static int ocsp_status_cb(SSL *s, void *arg)
 {
+	struct tls_ocsp_staple *staple = &tls_global->ocsp_staple;
+	struct os_reltime now;
+	struct os_time now_time;
 	char *tmp;
-	char *resp;
-	size_t len;
+	int valid;
 
 	if (tls_global->ocsp_stapling_response == NULL) {
 		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - no response configured");
 		return SSL_TLSEXT_ERR_OK;
 	}
 
-	resp = os_readfile(tls_global->ocsp_stapling_response, &len);
-	if (resp == NULL) {
+	os_get_reltime(&now);
+	os_get_time(&now_time);
+	ocsp_staple_update(tls_global, &now);
+
+	/*
+	 * A response that could not be parsed is sent as-is and left for the
+	 * peer to reject, but an expired response is not sent at all.
+	 */
+	valid = staple->resp &&
+		(!staple->next_update || now_time.sec <= staple->next_update);
+	ocsp_staple_check_refresh(tls_global, SSL_CTX_get_app_data(arg), &now,
+				  now_time.sec, valid && staple->parsed);
+
+	if (!staple->resp) {
 		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - could not read response file");
 		/* TODO: Build OCSPResponse with responseStatus = internalError
 		 */
 		return SSL_TLSEXT_ERR_OK;
 	}
+	if (!valid) {
+		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - cached response has expired");
+		return SSL_TLSEXT_ERR_OK;
+	}
 	wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - send cached response");
-	tmp = OPENSSL_malloc(len);
-	if (tmp == NULL) {
-		os_free(resp);
+	tmp = OPENSSL_malloc(staple->resp_len);
+	if (tmp == NULL)
 		return SSL_TLSEXT_ERR_ALERT_FATAL;
-	}
 
-	os_memcpy(tmp, resp, len);
-	os_free(resp);
-	SSL_set_tlsext_status_ocsp_resp(s, tmp, len);
+	os_memcpy(tmp, staple->resp, staple->resp_len);
+	SSL_set_tlsext_status_ocsp_resp(s, tmp, staple->resp_len);
 
 	return SSL_TLSEXT_ERR_OK;
 }
@@ -5417,8 +6239,15 @@ int tls_global_set_params(void *tls_ctx,
 			os_strdup(params->ocsp_stapling_response);
 	else
 		tls_global->ocsp_stapling_response = NULL;
+	os_free(tls_global->ocsp_staple.resp);
+	os_memset(&tls_global->ocsp_staple, 0, sizeof(tls_global->ocsp_staple));
 #endif /* HAVE_OCSP */
 
+#ifdef TLS_OPENSSL_ASYNC_KEY
+	if (data->private_key_threads)
+		tls_async_wrap_keys(data);
+#endif /* TLS_OPENSSL_ASYNC_KEY */
+
 	openssl_debug_dump_ctx(ssl_ctx);
 
 	return 0;
@@ -5557,6 +6386,18 @@ void tls_connection_set_success_data(struct tls_connection *conn,
 	SSL_SESSION *sess;
 	struct wpabuf *old;
 
+	if (conn->ticket_resumed && SSL_session_reused(conn->ssl)) {
+		/*
+		 * A session that was resumed with a session ticket is not
+		 * stored in the session cache, so keep the data with the
+		 * connection.
+		 */
+		wpabuf_free(conn->ticket_session_data);
+		conn->ticket_session_data = data;
+		conn->success_data = 1;
+		return;
+	}
+
 	if (tls_ex_idx_session < 0)
 		goto fail;
 	sess = SSL_get_session(conn->ssl);
@@ -5594,6 +6435,8 @@ tls_connection_get_success_data(struct tls_connection *conn)
 {
 	SSL_SESSION *sess;
 
+	if (conn->ticket_resumed && SSL_session_reused(conn->ssl))
+		return conn->ticket_session_data;
 	if (tls_ex_idx_session < 0 ||
 	    !(sess = SSL_get_session(conn->ssl)))
 		return NULL;
@@ -5618,6 +6461,70 @@ void tls_connection_remove_session(struct tls_connection *conn)
 }
 
 
+int tls_global_set_session_ticket_keys(void *tls_ctx, const u8 *keys,
+				       size_t num_keys)
+{
+#ifdef TLS_OPENSSL_TICKET_KEYS
+	struct tls_data *data = tls_ctx;
+	u8 *copy = NULL;
+
+	if (num_keys) {
+		copy = os_memdup(keys, num_keys * TLS_SESSION_TICKET_KEY_LEN);
+		if (!copy)
+			return -1;
+	}
+
+	bin_clear_free(data->ticket_keys,
+		       data->num_ticket_keys * TLS_SESSION_TICKET_KEY_LEN);
+	data->ticket_keys = copy;
+	data->num_ticket_keys = num_keys;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	SSL_CTX_set_tlsext_ticket_key_evp_cb(data->ssl, num_keys ?
+					     tls_ticket_key_cb : NULL);
+#else /* OpenSSL 3.0 */
+	SSL_CTX_set_tlsext_ticket_key_cb(data->ssl, num_keys ?
+					 tls_ticket_key_cb : NULL);
+#endif /* OpenSSL 3.0 */
+	wpa_printf(MSG_DEBUG, "OpenSSL: Configured %zu session ticket key(s)",
+		   num_keys);
+	return 0;
+#else /* TLS_OPENSSL_TICKET_KEYS */
+	wpa_printf(MSG_INFO,
+		   "OpenSSL: Session ticket keys not supported with this OpenSSL version");
+	return -1;
+#endif /* TLS_OPENSSL_TICKET_KEYS */
+}
+
+
+int tls_connection_set_ticket_data(void *tls_ctx, struct tls_connection *conn,
+				   const struct wpabuf *data)
+{
+#ifdef TLS_OPENSSL_TICKET_KEYS
+	struct wpabuf *copy;
+
+	copy = wpabuf_dup(data);
+	if (!copy)
+		return -1;
+	wpabuf_free(conn->ticket_data);
+	conn->ticket_data = copy;
+	return 0;
+#else /* TLS_OPENSSL_TICKET_KEYS */
+	return -1;
+#endif /* TLS_OPENSSL_TICKET_KEYS */
+}
+
+
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats)
+{
+	struct tls_data *data = tls_ctx;
+
+	if (!data)
+		return -1;
+	*stats = data->session_stats;
+	return 0;
+}
+
+
 int tls_get_tls_unique(struct tls_connection *conn, u8 *buf, size_t max_len)
 {
 	size_t len;
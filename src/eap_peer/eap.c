@@ -2132,6 +2132,8 @@ static void eap_peer_sm_tls_event(void *ctx, enum tls_event ev,
 			eap_notify_status(sm, "remote TLS alert",
 					  data->alert.description);
 		break;
+	case TLS_OCSP_STAPLING_REFRESH:
+		break;
 	}
 
 	os_free(hash_hex);
@@ -256,6 +256,15 @@ struct eap_config {
 	unsigned int tls_session_lifetime;
 	unsigned int tls_flags;
 
+	/**
+	 * tls_session_tickets - Whether EAP-TLS sessions use session tickets
+	 *
+	 * This is set when a shared session ticket key ring has been
+	 * configured. EAP-TLS sessions are then resumed with stateless session
+	 * tickets instead of the local session cache.
+	 */
+	int tls_session_tickets;
+
 	unsigned int max_auth_rounds;
 	unsigned int max_auth_rounds_short;
 };
@@ -88,6 +88,24 @@ static void * eap_tls_init(struct eap_sm *sm)
 
 	data->phase2 = sm->init_phase2;
 
+	if (sm->cfg->tls_session_tickets && !data->phase2 &&
+	    sm->cfg->tls_session_lifetime > 0) {
+		struct wpabuf *buf;
+
+		/*
+		 * Session tickets are issued only after the peer certificate
+		 * has been validated, so the ticket can mark the session valid
+		 * for resumption with EAP-TLS.
+		 */
+		buf = wpabuf_alloc(1);
+		if (buf) {
+			wpabuf_put_u8(buf, data->eap_type);
+			tls_connection_set_ticket_data(sm->cfg->ssl_ctx,
+						       data->ssl.conn, buf);
+			wpabuf_free(buf);
+		}
+	}
+
 	return data;
 }
 
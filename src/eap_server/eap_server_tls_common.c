@@ -71,7 +71,14 @@ int eap_server_tls_ssl_init(struct eap_sm *sm, struct eap_ssl_data *data,
 #endif /* CONFIG_TESTING_OPTIONS */
 #endif /* CONFIG_TLS_INTERNAL */
 
-	if (eap_type != EAP_TYPE_FAST)
+	/*
+	 * EAP-TLS is completed with the TLS handshake, so a session ticket can
+	 * carry all the state needed for resuming the session. The tunneled
+	 * methods need the result of Phase 2 and use the session cache.
+	 */
+	if (eap_type != EAP_TYPE_FAST &&
+	    !(eap_type == EAP_TYPE_TLS && sm->cfg->tls_session_tickets &&
+	      !data->phase2))
 		flags |= TLS_CONN_DISABLE_SESSION_TICKET;
 	os_memcpy(session_ctx, "hostapd", 7);
 	session_ctx[7] = (u8) eap_type;
@@ -85,6 +92,14 @@ int eap_server_tls_ssl_init(struct eap_sm *sm, struct eap_ssl_data *data,
 		return -1;
 	}
 
+	/*
+	 * The inner TLS connection is processed synchronously as part of the
+	 * outer tunnel, so only the outer handshake can wait for an
+	 * asynchronous private key operation.
+	 */
+	if (!data->phase2)
+		tls_connection_set_async(sm->cfg->ssl_ctx, data->conn, sm);
+
 	data->tls_out_limit = sm->cfg->fragment_size > 0 ?
 		sm->cfg->fragment_size : 1398;
 	if (data->phase2) {
@@ -102,6 +117,8 @@ void eap_server_tls_ssl_deinit(struct eap_sm *sm, struct eap_ssl_data *data)
 {
 	tls_connection_deinit(sm->cfg->ssl_ctx, data->conn);
 	eap_server_tls_free_in_buf(data);
+	wpabuf_free(data->tls_in_buf);
+	data->tls_in_buf = NULL;
 	wpabuf_free(data->tls_out);
 	data->tls_out = NULL;
 }
@@ -265,65 +282,106 @@ struct wpabuf * eap_server_tls_build_ack(u8 id, int eap_type, int version)
 }
 
 
-static int eap_server_tls_process_cont(struct eap_ssl_data *data,
+static int eap_server_tls_process_cont(struct eap_sm *sm,
+				       struct eap_ssl_data *data, u8 flags,
 				       const u8 *buf, size_t len)
 {
 	/* Process continuation of a pending message */
-	if (len > wpabuf_tailroom(data->tls_in)) {
+	if (len > data->tls_in_left) {
 		wpa_printf(MSG_DEBUG, "SSL: Fragment overflow");
 		return -1;
 	}
-
-	wpabuf_put_data(data->tls_in, buf, len);
+	data->tls_in_left -= len;
+
+	if (data->tls_in_direct) {
+		if (!(flags & EAP_TLS_FLAGS_MORE_FRAGMENTS)) {
+			/* The last fragment is given to the TLS library as the
+			 * input data of the handshake call */
+			data->tls_in_direct = 0;
+			return 0;
+		}
+		if (tls_connection_add_input(sm->cfg->ssl_ctx, data->conn,
+					     buf, len) < 0)
+			return -1;
+	} else {
+		wpabuf_put_data(data->tls_in, buf, len);
+	}
 	wpa_printf(MSG_DEBUG, "SSL: Received %lu bytes, waiting for %lu "
 		   "bytes more", (unsigned long) len,
-		   (unsigned long) wpabuf_tailroom(data->tls_in));
+		   (unsigned long) data->tls_in_left);
 
 	return 0;
 }
 
 
-static int eap_server_tls_process_fragment(struct eap_ssl_data *data,
+static int eap_server_tls_process_fragment(struct eap_sm *sm,
+					   struct eap_ssl_data *data,
 					   u8 flags, u32 message_length,
 					   const u8 *buf, size_t len)
 {
 	/* Process a fragment that is not the last one of the message */
-	if (data->tls_in == NULL && !(flags & EAP_TLS_FLAGS_LENGTH_INCLUDED)) {
+	if (data->tls_in || data->tls_in_direct)
+		return 0;
+
+	if (!(flags & EAP_TLS_FLAGS_LENGTH_INCLUDED)) {
 		wpa_printf(MSG_DEBUG, "SSL: No Message Length field in a "
 			   "fragmented packet");
 		return -1;
 	}
 
-	if (data->tls_in == NULL) {
-		/* First fragment of the message */
+	/* First fragment of the message */
 
-		/* Limit length to avoid rogue peers from causing large
-		 * memory allocations. */
-		if (message_length > 65536) {
-			wpa_printf(MSG_INFO, "SSL: Too long TLS fragment (size"
-				   " over 64 kB)");
-			return -1;
-		}
+	/* Limit length to avoid rogue peers from causing large memory
+	 * allocations. */
+	if (message_length > 65536) {
+		wpa_printf(MSG_INFO, "SSL: Too long TLS fragment (size"
+			   " over 64 kB)");
+		return -1;
+	}
 
-		if (len > message_length) {
-			wpa_printf(MSG_INFO, "SSL: Too much data (%d bytes) in "
-				   "first fragment of frame (TLS Message "
-				   "Length %d bytes)",
-				   (int) len, (int) message_length);
-			return -1;
-		}
+	if (len > message_length) {
+		wpa_printf(MSG_INFO, "SSL: Too much data (%d bytes) in "
+			   "first fragment of frame (TLS Message "
+			   "Length %d bytes)",
+			   (int) len, (int) message_length);
+		return -1;
+	}
+	data->tls_in_left = message_length - len;
+
+	/*
+	 * Handshake messages are queued in the TLS library one fragment at a
+	 * time, so they do not need to be copied into a re-assembly buffer.
+	 */
+	if (!tls_connection_established(sm->cfg->ssl_ctx, data->conn) &&
+	    tls_connection_add_input(sm->cfg->ssl_ctx, data->conn,
+				     buf, len) == 0) {
+		data->tls_in_direct = 1;
+		wpa_printf(MSG_DEBUG, "SSL: Received %lu bytes in first "
+			   "fragment (queued for TLS), waiting for %lu bytes "
+			   "more",
+			   (unsigned long) len,
+			   (unsigned long) data->tls_in_left);
+		return 0;
+	}
 
-		data->tls_in = wpabuf_alloc(message_length);
-		if (data->tls_in == NULL) {
+	/* Reuse the re-assembly buffer of the previous message if possible */
+	if (data->tls_in_buf &&
+	    wpabuf_size(data->tls_in_buf) >= message_length) {
+		data->tls_in_buf->used = 0;
+	} else {
+		wpabuf_free(data->tls_in_buf);
+		data->tls_in_buf = wpabuf_alloc(message_length);
+		if (!data->tls_in_buf) {
 			wpa_printf(MSG_DEBUG, "SSL: No memory for message");
 			return -1;
 		}
-		wpabuf_put_data(data->tls_in, buf, len);
-		wpa_printf(MSG_DEBUG, "SSL: Received %lu bytes in first "
-			   "fragment, waiting for %lu bytes more",
-			   (unsigned long) len,
-			   (unsigned long) wpabuf_tailroom(data->tls_in));
 	}
+	data->tls_in = data->tls_in_buf;
+	wpabuf_put_data(data->tls_in, buf, len);
+	wpa_printf(MSG_DEBUG, "SSL: Received %lu bytes in first "
+		   "fragment, waiting for %lu bytes more",
+		   (unsigned long) len,
+		   (unsigned long) data->tls_in_left);
 
 	return 0;
 }
@@ -344,6 +402,13 @@ int eap_server_tls_phase1(struct eap_sm *sm, struct eap_ssl_data *data)
 	data->tls_out = tls_connection_server_handshake(sm->cfg->ssl_ctx,
 							data->conn,
 							data->tls_in, NULL);
+	if (data->tls_out == NULL &&
+	    tls_connection_async_pending(sm->cfg->ssl_ctx, data->conn)) {
+		wpa_printf(MSG_DEBUG,
+			   "SSL: Wait for private key operation to complete");
+		data->async_pending = 1;
+		return 0;
+	}
 	if (data->tls_out == NULL) {
 		wpa_printf(MSG_INFO, "SSL: TLS processing failed");
 		return -1;
@@ -370,7 +435,8 @@ int eap_server_tls_phase1(struct eap_sm *sm, struct eap_ssl_data *data)
 }
 
 
-static int eap_server_tls_reassemble(struct eap_ssl_data *data, u8 flags,
+static int eap_server_tls_reassemble(struct eap_sm *sm,
+				     struct eap_ssl_data *data, u8 flags,
 				     const u8 **pos, size_t *left)
 {
 	unsigned int tls_msg_len = 0;
@@ -411,12 +477,13 @@ static int eap_server_tls_reassemble(struct eap_ssl_data *data, u8 flags,
 		return 1;
 	}
 
-	if (data->tls_in &&
-	    eap_server_tls_process_cont(data, *pos, end - *pos) < 0)
+	if ((data->tls_in || data->tls_in_direct) &&
+	    eap_server_tls_process_cont(sm, data, flags, *pos, end - *pos) < 0)
 		return -1;
 
 	if (flags & EAP_TLS_FLAGS_MORE_FRAGMENTS) {
-		if (eap_server_tls_process_fragment(data, flags, tls_msg_len,
+		if (eap_server_tls_process_fragment(sm, data, flags,
+						    tls_msg_len,
 						    *pos, end - *pos) < 0)
 			return -1;
 
@@ -441,9 +508,10 @@ static int eap_server_tls_reassemble(struct eap_ssl_data *data, u8 flags,
 
 static void eap_server_tls_free_in_buf(struct eap_ssl_data *data)
 {
-	if (data->tls_in != &data->tmpbuf)
-		wpabuf_free(data->tls_in);
+	/* tls_in points to tmpbuf or to tls_in_buf that is kept for reuse */
 	data->tls_in = NULL;
+	data->tls_in_left = 0;
+	data->tls_in_direct = 0;
 }
 
 
@@ -475,6 +543,19 @@ int eap_server_tls_process(struct eap_sm *sm, struct eap_ssl_data *data,
 	size_t left;
 	int ret, res = 0;
 
+	if (data->async_pending) {
+		/*
+		 * The pending message has already been given to the TLS
+		 * library, so continue the handshake with no new input data.
+		 */
+		wpa_printf(MSG_DEBUG,
+			   "SSL: Continue handshake after private key operation");
+		data->async_pending = 0;
+		wpabuf_set(&data->tmpbuf, "", 0);
+		data->tls_in = &data->tmpbuf;
+		goto process;
+	}
+
 	if (eap_type == EAP_UNAUTH_TLS_TYPE)
 		pos = eap_hdr_validate(EAP_VENDOR_UNAUTH_TLS,
 				       EAP_VENDOR_TYPE_UNAUTH_TLS, respData,
@@ -497,16 +578,20 @@ int eap_server_tls_process(struct eap_sm *sm, struct eap_ssl_data *data,
 	    proc_version(sm, priv, flags & EAP_TLS_VERSION_MASK) < 0)
 		return -1;
 
-	ret = eap_server_tls_reassemble(data, flags, &pos, &left);
+	ret = eap_server_tls_reassemble(sm, data, flags, &pos, &left);
 	if (ret < 0) {
 		res = -1;
 		goto done;
 	} else if (ret == 1)
 		return 0;
 
+process:
 	if (proc_msg)
 		proc_msg(sm, priv, respData);
 
+	if (data->async_pending)
+		sm->method_pending = METHOD_PENDING_WAIT;
+
 	if (tls_connection_get_write_alerts(sm->cfg->ssl_ctx, data->conn) > 1) {
 		wpa_printf(MSG_INFO, "SSL: Locally detected fatal error in "
 			   "TLS processing");
@@ -22,6 +22,8 @@
 #endif /* CONFIG_SQLITE */
 
 #include "common.h"
+#include "list.h"
+#include "hash_table.h"
 #include "crypto/random.h"
 #include "eap_common/eap_sim_common.h"
 #include "eap_server/eap_sim_db.h"
@@ -57,6 +59,76 @@ struct eap_sim_db_pending {
 	} u;
 };
 
+#ifdef CONFIG_SQLITE
+
+/*
+ * The most recently used pseudonym and reauth entries are kept in memory in
+ * front of the database. Writes go to both the cache and the database, so the
+ * cache only needs to be filled on misses.
+ */
+#define EAP_SIM_DB_CACHE_SIZE 1024
+
+/*
+ * Database writes are grouped into transactions that are committed after
+ * EAP_SIM_DB_COMMIT_WRITES writes or EAP_SIM_DB_COMMIT_DELAY_MS milliseconds,
+ * whichever comes first, to avoid a separate sync for each authentication.
+ * At most that much of the latest changes can be lost on a crash; this only
+ * forces the affected peers to go through full authentication again.
+ */
+#define EAP_SIM_DB_COMMIT_WRITES 64
+#define EAP_SIM_DB_COMMIT_DELAY_MS 100
+
+struct eap_sim_db_cache_entry {
+	struct dl_list list; /* most recently used first */
+	struct hash_node id_node;
+	struct hash_node permanent_node;
+	char *id; /* pseudonym or reauth_id */
+	char *permanent;
+	u16 counter;
+	u8 mk[EAP_SIM_MK_LEN];
+	u8 k_encr[EAP_SIM_K_ENCR_LEN];
+	u8 k_aut[EAP_AKA_PRIME_K_AUT_LEN];
+	u8 k_re[EAP_AKA_PRIME_K_RE_LEN];
+	/* followed by the id and permanent strings */
+};
+
+struct eap_sim_db_cache {
+	struct dl_list lru; /* struct eap_sim_db_cache_entry::list */
+	struct hash_table by_id;
+	struct hash_table by_permanent;
+};
+
+enum db_stmt {
+	DB_STMT_BEGIN,
+	DB_STMT_COMMIT,
+	DB_STMT_ADD_PSEUDONYM,
+	DB_STMT_GET_PSEUDONYM,
+	DB_STMT_ADD_REAUTH,
+	DB_STMT_GET_REAUTH,
+	DB_STMT_DEL_REAUTH,
+	NUM_DB_STMT
+};
+
+static const char *db_stmt_sql[NUM_DB_STMT] = {
+	[DB_STMT_BEGIN] = "BEGIN;",
+	[DB_STMT_COMMIT] = "COMMIT;",
+	[DB_STMT_ADD_PSEUDONYM] =
+	"INSERT OR REPLACE INTO pseudonyms (permanent, pseudonym) "
+	"VALUES (?, ?);",
+	[DB_STMT_GET_PSEUDONYM] =
+	"SELECT permanent FROM pseudonyms WHERE pseudonym=?;",
+	[DB_STMT_ADD_REAUTH] =
+	"INSERT OR REPLACE INTO reauth "
+	"(permanent, reauth_id, counter, mk, k_encr, k_aut, k_re) "
+	"VALUES (?, ?, ?, ?, ?, ?, ?);",
+	[DB_STMT_GET_REAUTH] =
+	"SELECT permanent, counter, mk, k_encr, k_aut, k_re FROM reauth "
+	"WHERE reauth_id=?;",
+	[DB_STMT_DEL_REAUTH] = "DELETE FROM reauth WHERE permanent=?;",
+};
+
+#endif /* CONFIG_SQLITE */
+
 struct eap_sim_db_data {
 	int sock;
 	char *fname;
@@ -69,6 +141,11 @@ struct eap_sim_db_data {
 	unsigned int eap_sim_db_timeout;
 #ifdef CONFIG_SQLITE
 	sqlite3 *sqlite_db;
+	sqlite3_stmt *db_stmt[NUM_DB_STMT];
+	int db_in_txn; /* a transaction is open for pending writes */
+	unsigned int db_writes; /* writes in the open transaction */
+	struct eap_sim_db_cache pseudonym_cache;
+	struct eap_sim_db_cache reauth_cache;
 	char db_tmp_identity[100];
 	char db_tmp_pseudonym_str[100];
 	struct eap_sim_pseudonym db_tmp_pseudonym;
@@ -79,10 +156,109 @@ struct eap_sim_db_data {
 
 static void eap_sim_db_del_timeout(void *eloop_ctx, void *user_ctx);
 static void eap_sim_db_query_timeout(void *eloop_ctx, void *user_ctx);
+#ifdef CONFIG_SQLITE
+static void db_commit_timeout(void *eloop_ctx, void *user_ctx);
+#endif /* CONFIG_SQLITE */
 
 
 #ifdef CONFIG_SQLITE
 
+static void eap_sim_db_cache_del(struct eap_sim_db_cache *cache,
+				 struct eap_sim_db_cache_entry *e)
+{
+	dl_list_del(&e->list);
+	hash_table_del(&cache->by_id, &e->id_node);
+	hash_table_del(&cache->by_permanent, &e->permanent_node);
+	os_free(e);
+}
+
+
+static void eap_sim_db_cache_flush(struct eap_sim_db_cache *cache)
+{
+	struct eap_sim_db_cache_entry *e, *prev;
+
+	if (!cache->lru.next)
+		return;
+	dl_list_for_each_safe(e, prev, &cache->lru,
+			      struct eap_sim_db_cache_entry, list)
+		eap_sim_db_cache_del(cache, e);
+	hash_table_deinit(&cache->by_id);
+	hash_table_deinit(&cache->by_permanent);
+}
+
+
+static struct eap_sim_db_cache_entry *
+eap_sim_db_cache_get(struct eap_sim_db_cache *cache, const char *id)
+{
+	struct hash_node *node;
+	struct eap_sim_db_cache_entry *e;
+
+	node = hash_table_get(&cache->by_id, id, os_strlen(id));
+	if (!node)
+		return NULL;
+	e = hash_table_entry(node, struct eap_sim_db_cache_entry, id_node);
+	dl_list_del(&e->list);
+	dl_list_add(&cache->lru, &e->list);
+	return e;
+}
+
+
+static void eap_sim_db_cache_del_permanent(struct eap_sim_db_cache *cache,
+					   const char *permanent)
+{
+	struct hash_node *node;
+
+	node = hash_table_get(&cache->by_permanent, permanent,
+			      os_strlen(permanent));
+	if (node)
+		eap_sim_db_cache_del(cache,
+				     hash_table_entry(
+					     node,
+					     struct eap_sim_db_cache_entry,
+					     permanent_node));
+}
+
+
+/* Add an entry; an existing entry for the same permanent identity is
+ * replaced in the same way as the matching database row. */
+static struct eap_sim_db_cache_entry *
+eap_sim_db_cache_add(struct eap_sim_db_cache *cache, const char *permanent,
+		     const char *id)
+{
+	struct eap_sim_db_cache_entry *e;
+	size_t id_len = os_strlen(id), permanent_len = os_strlen(permanent);
+
+	eap_sim_db_cache_del_permanent(cache, permanent);
+	if (cache->by_id.count >= EAP_SIM_DB_CACHE_SIZE) {
+		e = dl_list_last(&cache->lru, struct eap_sim_db_cache_entry,
+				 list);
+		if (e)
+			eap_sim_db_cache_del(cache, e);
+	}
+
+	e = os_zalloc(sizeof(*e) + id_len + 1 + permanent_len + 1);
+	if (!e)
+		return NULL;
+	e->id = (char *) (e + 1);
+	os_memcpy(e->id, id, id_len);
+	e->permanent = e->id + id_len + 1;
+	os_memcpy(e->permanent, permanent, permanent_len);
+
+	if (hash_table_add(&cache->by_id, &e->id_node, e->id, id_len) < 0) {
+		os_free(e);
+		return NULL;
+	}
+	if (hash_table_add(&cache->by_permanent, &e->permanent_node,
+			   e->permanent, permanent_len) < 0) {
+		hash_table_del(&cache->by_id, &e->id_node);
+		os_free(e);
+		return NULL;
+	}
+	dl_list_add(&cache->lru, &e->list);
+	return e;
+}
+
+
 static int db_table_exists(sqlite3 *db, const char *name)
 {
 	char cmd[128];
@@ -138,30 +314,151 @@ static int db_table_create_reauth(sqlite3 *db)
 }
 
 
-static sqlite3 * db_open(const char *db_file)
+static int db_table_create_index(sqlite3 *db, const char *name,
+				 const char *table, const char *column)
+{
+	char cmd[128];
+	char *err = NULL;
+
+	os_snprintf(cmd, sizeof(cmd), "CREATE INDEX IF NOT EXISTS %s ON %s(%s);",
+		    name, table, column);
+	if (sqlite3_exec(db, cmd, NULL, NULL, &err) != SQLITE_OK) {
+		wpa_printf(MSG_ERROR, "EAP-SIM DB: SQLite error: %s", err);
+		sqlite3_free(err);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int db_open(struct eap_sim_db_data *data, const char *db_file)
 {
 	sqlite3 *db;
+	char *err = NULL;
+	int i;
 
 	if (sqlite3_open(db_file, &db)) {
 		wpa_printf(MSG_ERROR, "EAP-SIM DB: Failed to open database "
 			   "%s: %s", db_file, sqlite3_errmsg(db));
 		sqlite3_close(db);
-		return NULL;
+		return -1;
 	}
+	data->sqlite_db = db;
 
-	if (!db_table_exists(db, "pseudonyms") &&
-	    db_table_create_pseudonym(db) < 0) {
-		sqlite3_close(db);
-		return NULL;
+	/*
+	 * With write-ahead logging, a commit only appends to the log and the
+	 * log needs to be synced only at checkpoints.
+	 */
+	if (sqlite3_exec(db, "PRAGMA journal_mode=WAL; "
+			 "PRAGMA synchronous=NORMAL;",
+			 NULL, NULL, &err) != SQLITE_OK) {
+		wpa_printf(MSG_INFO,
+			   "EAP-SIM DB: Could not enable WAL mode: %s", err);
+		sqlite3_free(err);
 	}
 
+	if (!db_table_exists(db, "pseudonyms") &&
+	    db_table_create_pseudonym(db) < 0)
+		return -1;
+
 	if (!db_table_exists(db, "reauth") &&
-	    db_table_create_reauth(db) < 0) {
-		sqlite3_close(db);
-		return NULL;
+	    db_table_create_reauth(db) < 0)
+		return -1;
+
+	if (db_table_create_index(db, "pseudonyms_pseudonym", "pseudonyms",
+				  "pseudonym") < 0 ||
+	    db_table_create_index(db, "reauth_reauth_id", "reauth",
+				  "reauth_id") < 0)
+		return -1;
+
+	for (i = 0; i < NUM_DB_STMT; i++) {
+		if (sqlite3_prepare_v2(db, db_stmt_sql[i], -1,
+				       &data->db_stmt[i], NULL) != SQLITE_OK) {
+			wpa_printf(MSG_ERROR,
+				   "EAP-SIM DB: Failed to prepare '%s': %s",
+				   db_stmt_sql[i], sqlite3_errmsg(db));
+			return -1;
+		}
+	}
+
+	dl_list_init(&data->pseudonym_cache.lru);
+	dl_list_init(&data->reauth_cache.lru);
+
+	return 0;
+}
+
+
+/* Run a prepared statement that does not return rows and reset it */
+static int db_exec_stmt(struct eap_sim_db_data *data, enum db_stmt id)
+{
+	sqlite3_stmt *stmt = data->db_stmt[id];
+	int res;
+
+	res = sqlite3_step(stmt);
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	if (res != SQLITE_DONE) {
+		wpa_printf(MSG_ERROR, "EAP-SIM DB: SQLite error: %s",
+			   sqlite3_errmsg(data->sqlite_db));
+		return -1;
 	}
 
-	return db;
+	return 0;
+}
+
+
+static void db_commit(struct eap_sim_db_data *data)
+{
+	if (!data->db_in_txn)
+		return;
+	eloop_cancel_timeout(db_commit_timeout, data, NULL);
+	data->db_in_txn = 0;
+	data->db_writes = 0;
+	if (db_exec_stmt(data, DB_STMT_COMMIT) < 0)
+		sqlite3_exec(data->sqlite_db, "ROLLBACK;", NULL, NULL, NULL);
+}
+
+
+static void db_commit_timeout(void *eloop_ctx, void *user_ctx)
+{
+	db_commit(eloop_ctx);
+}
+
+
+/* Make sure a transaction is open for the next write */
+static void db_write_start(struct eap_sim_db_data *data)
+{
+	if (data->db_in_txn)
+		return;
+	if (db_exec_stmt(data, DB_STMT_BEGIN) < 0)
+		return; /* fall back to autocommit */
+	data->db_in_txn = 1;
+	eloop_register_timeout(0, EAP_SIM_DB_COMMIT_DELAY_MS * 1000,
+			       db_commit_timeout, data, NULL);
+}
+
+
+static void db_write_done(struct eap_sim_db_data *data)
+{
+	if (data->db_in_txn && ++data->db_writes >= EAP_SIM_DB_COMMIT_WRITES)
+		db_commit(data);
+}
+
+
+static void db_close(struct eap_sim_db_data *data)
+{
+	int i;
+
+	db_commit(data);
+	for (i = 0; i < NUM_DB_STMT; i++) {
+		sqlite3_finalize(data->db_stmt[i]);
+		data->db_stmt[i] = NULL;
+	}
+	sqlite3_close(data->sqlite_db);
+	data->sqlite_db = NULL;
+	eap_sim_db_cache_flush(&data->pseudonym_cache);
+	eap_sim_db_cache_flush(&data->reauth_cache);
 }
 
 
@@ -181,193 +478,212 @@ static int valid_db_string(const char *str)
 static int db_add_pseudonym(struct eap_sim_db_data *data,
 			    const char *permanent, char *pseudonym)
 {
-	char cmd[128];
-	char *err = NULL;
+	sqlite3_stmt *stmt = data->db_stmt[DB_STMT_ADD_PSEUDONYM];
+	int res;
 
 	if (!valid_db_string(permanent) || !valid_db_string(pseudonym)) {
 		os_free(pseudonym);
 		return -1;
 	}
 
-	os_snprintf(cmd, sizeof(cmd), "INSERT OR REPLACE INTO pseudonyms "
-		    "(permanent, pseudonym) VALUES ('%s', '%s');",
-		    permanent, pseudonym);
-	os_free(pseudonym);
-	if (sqlite3_exec(data->sqlite_db, cmd, NULL, NULL, &err) != SQLITE_OK)
-	{
-		wpa_printf(MSG_ERROR, "EAP-SIM DB: SQLite error: %s", err);
-		sqlite3_free(err);
-		return -1;
-	}
+	db_write_start(data);
+	sqlite3_bind_text(stmt, 1, permanent, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, pseudonym, -1, SQLITE_STATIC);
+	res = db_exec_stmt(data, DB_STMT_ADD_PSEUDONYM);
+	db_write_done(data);
 
-	return 0;
-}
-
-
-static int get_pseudonym_cb(void *ctx, int argc, char *argv[], char *col[])
-{
-	struct eap_sim_db_data *data = ctx;
-	int i;
-
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "permanent") == 0 && argv[i]) {
-			os_strlcpy(data->db_tmp_identity, argv[i],
-				   sizeof(data->db_tmp_identity));
-		}
-	}
+	if (res == 0)
+		eap_sim_db_cache_add(&data->pseudonym_cache, permanent,
+				     pseudonym);
+	else
+		eap_sim_db_cache_del_permanent(&data->pseudonym_cache,
+					       permanent);
+	os_free(pseudonym);
 
-	return 0;
+	return res;
 }
 
 
 static char *
 db_get_pseudonym(struct eap_sim_db_data *data, const char *pseudonym)
 {
-	char cmd[128];
+	sqlite3_stmt *stmt = data->db_stmt[DB_STMT_GET_PSEUDONYM];
+	struct eap_sim_db_cache_entry *e;
+	const char *permanent;
 
 	if (!valid_db_string(pseudonym))
 		return NULL;
 	os_memset(&data->db_tmp_identity, 0, sizeof(data->db_tmp_identity));
-	os_snprintf(cmd, sizeof(cmd),
-		    "SELECT permanent FROM pseudonyms WHERE pseudonym='%s';",
-		    pseudonym);
-	if (sqlite3_exec(data->sqlite_db, cmd, get_pseudonym_cb, data, NULL) !=
-	    SQLITE_OK)
-		return NULL;
+
+	e = eap_sim_db_cache_get(&data->pseudonym_cache, pseudonym);
+	if (e) {
+		os_strlcpy(data->db_tmp_identity, e->permanent,
+			   sizeof(data->db_tmp_identity));
+		return data->db_tmp_identity;
+	}
+
+	sqlite3_bind_text(stmt, 1, pseudonym, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		permanent = (const char *) sqlite3_column_text(stmt, 0);
+		if (permanent)
+			os_strlcpy(data->db_tmp_identity, permanent,
+				   sizeof(data->db_tmp_identity));
+	}
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
 	if (data->db_tmp_identity[0] == '\0')
 		return NULL;
+	eap_sim_db_cache_add(&data->pseudonym_cache, data->db_tmp_identity,
+			     pseudonym);
 	return data->db_tmp_identity;
 }
 
 
-static int db_add_reauth(struct eap_sim_db_data *data, const char *permanent,
-			 char *reauth_id, u16 counter, const u8 *mk,
-			 const u8 *k_encr, const u8 *k_aut, const u8 *k_re)
+static void db_bind_hex(sqlite3_stmt *stmt, int col, const u8 *val,
+			size_t len)
 {
-	char cmd[2000], *pos, *end;
-	char *err = NULL;
+	char hex[2 * EAP_AKA_PRIME_K_RE_LEN + 1];
 
-	if (!valid_db_string(permanent) || !valid_db_string(reauth_id)) {
-		os_free(reauth_id);
-		return -1;
+	if (!val || 2 * len >= sizeof(hex)) {
+		sqlite3_bind_null(stmt, col);
+		return;
 	}
+	wpa_snprintf_hex(hex, sizeof(hex), val, len);
+	sqlite3_bind_text(stmt, col, hex, -1, SQLITE_TRANSIENT);
+}
 
-	pos = cmd;
-	end = pos + sizeof(cmd);
-	pos += os_snprintf(pos, end - pos, "INSERT OR REPLACE INTO reauth "
-			   "(permanent, reauth_id, counter%s%s%s%s) "
-			   "VALUES ('%s', '%s', %u",
-			   mk ? ", mk" : "",
-			   k_encr ? ", k_encr" : "",
-			   k_aut ? ", k_aut" : "",
-			   k_re ? ", k_re" : "",
-			   permanent, reauth_id, counter);
-	os_free(reauth_id);
-
-	if (mk) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, mk, EAP_SIM_MK_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
 
-	if (k_encr) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, k_encr,
-					EAP_SIM_K_ENCR_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
+static void db_column_hex(sqlite3_stmt *stmt, int col, u8 *buf, size_t len)
+{
+	const char *hex = (const char *) sqlite3_column_text(stmt, col);
 
-	if (k_aut) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, k_aut,
-					EAP_AKA_PRIME_K_AUT_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
+	if (hex)
+		hexstr2bin(hex, buf, len);
+}
 
-	if (k_re) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, k_re,
-					EAP_AKA_PRIME_K_RE_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
 
-	os_snprintf(pos, end - pos, ");");
+static int db_add_reauth(struct eap_sim_db_data *data, const char *permanent,
+			 char *reauth_id, u16 counter, const u8 *mk,
+			 const u8 *k_encr, const u8 *k_aut, const u8 *k_re)
+{
+	sqlite3_stmt *stmt = data->db_stmt[DB_STMT_ADD_REAUTH];
+	struct eap_sim_db_cache_entry *e;
+	int res;
 
-	if (sqlite3_exec(data->sqlite_db, cmd, NULL, NULL, &err) != SQLITE_OK)
-	{
-		wpa_printf(MSG_ERROR, "EAP-SIM DB: SQLite error: %s", err);
-		sqlite3_free(err);
+	if (!valid_db_string(permanent) || !valid_db_string(reauth_id)) {
+		os_free(reauth_id);
 		return -1;
 	}
 
-	return 0;
-}
-
-
-static int get_reauth_cb(void *ctx, int argc, char *argv[], char *col[])
-{
-	struct eap_sim_db_data *data = ctx;
-	int i;
-	struct eap_sim_reauth *reauth = &data->db_tmp_reauth;
-
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "permanent") == 0 && argv[i]) {
-			os_strlcpy(data->db_tmp_identity, argv[i],
-				   sizeof(data->db_tmp_identity));
-			reauth->permanent = data->db_tmp_identity;
-		} else if (os_strcmp(col[i], "counter") == 0 && argv[i]) {
-			reauth->counter = atoi(argv[i]);
-		} else if (os_strcmp(col[i], "mk") == 0 && argv[i]) {
-			hexstr2bin(argv[i], reauth->mk, sizeof(reauth->mk));
-		} else if (os_strcmp(col[i], "k_encr") == 0 && argv[i]) {
-			hexstr2bin(argv[i], reauth->k_encr,
-				   sizeof(reauth->k_encr));
-		} else if (os_strcmp(col[i], "k_aut") == 0 && argv[i]) {
-			hexstr2bin(argv[i], reauth->k_aut,
-				   sizeof(reauth->k_aut));
-		} else if (os_strcmp(col[i], "k_re") == 0 && argv[i]) {
-			hexstr2bin(argv[i], reauth->k_re,
-				   sizeof(reauth->k_re));
-		}
+	db_write_start(data);
+	sqlite3_bind_text(stmt, 1, permanent, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, reauth_id, -1, SQLITE_STATIC);
+	sqlite3_bind_int(stmt, 3, counter);
+	db_bind_hex(stmt, 4, mk, EAP_SIM_MK_LEN);
+	db_bind_hex(stmt, 5, k_encr, EAP_SIM_K_ENCR_LEN);
+	db_bind_hex(stmt, 6, k_aut, EAP_AKA_PRIME_K_AUT_LEN);
+	db_bind_hex(stmt, 7, k_re, EAP_AKA_PRIME_K_RE_LEN);
+	res = db_exec_stmt(data, DB_STMT_ADD_REAUTH);
+	db_write_done(data);
+
+	e = NULL;
+	if (res == 0)
+		e = eap_sim_db_cache_add(&data->reauth_cache, permanent,
+					 reauth_id);
+	else
+		eap_sim_db_cache_del_permanent(&data->reauth_cache, permanent);
+	if (e) {
+		e->counter = counter;
+		if (mk)
+			os_memcpy(e->mk, mk, EAP_SIM_MK_LEN);
+		if (k_encr)
+			os_memcpy(e->k_encr, k_encr, EAP_SIM_K_ENCR_LEN);
+		if (k_aut)
+			os_memcpy(e->k_aut, k_aut, EAP_AKA_PRIME_K_AUT_LEN);
+		if (k_re)
+			os_memcpy(e->k_re, k_re, EAP_AKA_PRIME_K_RE_LEN);
 	}
+	os_free(reauth_id);
 
-	return 0;
+	return res;
 }
 
 
 static struct eap_sim_reauth *
 db_get_reauth(struct eap_sim_db_data *data, const char *reauth_id)
 {
-	char cmd[256];
+	sqlite3_stmt *stmt = data->db_stmt[DB_STMT_GET_REAUTH];
+	struct eap_sim_reauth *reauth = &data->db_tmp_reauth;
+	struct eap_sim_db_cache_entry *e;
+	const char *permanent;
 
 	if (!valid_db_string(reauth_id))
 		return NULL;
-	os_memset(&data->db_tmp_reauth, 0, sizeof(data->db_tmp_reauth));
+	os_memset(reauth, 0, sizeof(*reauth));
 	os_strlcpy(data->db_tmp_pseudonym_str, reauth_id,
 		   sizeof(data->db_tmp_pseudonym_str));
-	data->db_tmp_reauth.reauth_id = data->db_tmp_pseudonym_str;
-	os_snprintf(cmd, sizeof(cmd),
-		    "SELECT * FROM reauth WHERE reauth_id='%s';", reauth_id);
-	if (sqlite3_exec(data->sqlite_db, cmd, get_reauth_cb, data, NULL) !=
-	    SQLITE_OK)
-		return NULL;
-	if (data->db_tmp_reauth.permanent == NULL)
+	reauth->reauth_id = data->db_tmp_pseudonym_str;
+
+	e = eap_sim_db_cache_get(&data->reauth_cache, reauth_id);
+	if (e) {
+		os_strlcpy(data->db_tmp_identity, e->permanent,
+			   sizeof(data->db_tmp_identity));
+		reauth->permanent = data->db_tmp_identity;
+		reauth->counter = e->counter;
+		os_memcpy(reauth->mk, e->mk, EAP_SIM_MK_LEN);
+		os_memcpy(reauth->k_encr, e->k_encr, EAP_SIM_K_ENCR_LEN);
+		os_memcpy(reauth->k_aut, e->k_aut, EAP_AKA_PRIME_K_AUT_LEN);
+		os_memcpy(reauth->k_re, e->k_re, EAP_AKA_PRIME_K_RE_LEN);
+		return reauth;
+	}
+
+	sqlite3_bind_text(stmt, 1, reauth_id, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		permanent = (const char *) sqlite3_column_text(stmt, 0);
+		if (permanent) {
+			os_strlcpy(data->db_tmp_identity, permanent,
+				   sizeof(data->db_tmp_identity));
+			reauth->permanent = data->db_tmp_identity;
+		}
+		reauth->counter = sqlite3_column_int(stmt, 1);
+		db_column_hex(stmt, 2, reauth->mk, sizeof(reauth->mk));
+		db_column_hex(stmt, 3, reauth->k_encr, sizeof(reauth->k_encr));
+		db_column_hex(stmt, 4, reauth->k_aut, sizeof(reauth->k_aut));
+		db_column_hex(stmt, 5, reauth->k_re, sizeof(reauth->k_re));
+	}
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	if (reauth->permanent == NULL)
 		return NULL;
-	return &data->db_tmp_reauth;
+
+	e = eap_sim_db_cache_add(&data->reauth_cache, reauth->permanent,
+				 reauth_id);
+	if (e) {
+		e->counter = reauth->counter;
+		os_memcpy(e->mk, reauth->mk, EAP_SIM_MK_LEN);
+		os_memcpy(e->k_encr, reauth->k_encr, EAP_SIM_K_ENCR_LEN);
+		os_memcpy(e->k_aut, reauth->k_aut, EAP_AKA_PRIME_K_AUT_LEN);
+		os_memcpy(e->k_re, reauth->k_re, EAP_AKA_PRIME_K_RE_LEN);
+	}
+	return reauth;
 }
 
 
 static void db_remove_reauth(struct eap_sim_db_data *data,
 			     struct eap_sim_reauth *reauth)
 {
-	char cmd[256];
+	sqlite3_stmt *stmt = data->db_stmt[DB_STMT_DEL_REAUTH];
 
 	if (!valid_db_string(reauth->permanent))
 		return;
-	os_snprintf(cmd, sizeof(cmd),
-		    "DELETE FROM reauth WHERE permanent='%s';",
-		    reauth->permanent);
-	sqlite3_exec(data->sqlite_db, cmd, NULL, NULL, NULL);
+	eap_sim_db_cache_del_permanent(&data->reauth_cache,
+				       reauth->permanent);
+	db_write_start(data);
+	sqlite3_bind_text(stmt, 1, reauth->permanent, -1, SQLITE_STATIC);
+	db_exec_stmt(data, DB_STMT_DEL_REAUTH);
+	db_write_done(data);
 }
 
 #endif /* CONFIG_SQLITE */
@@ -775,8 +1091,7 @@ eap_sim_db_init(const char *config, unsigned int db_timeout,
 		*pos = '\0';
 #ifdef CONFIG_SQLITE
 		pos += 4;
-		data->sqlite_db = db_open(pos);
-		if (data->sqlite_db == NULL)
+		if (db_open(data, pos) < 0)
 			goto fail;
 #endif /* CONFIG_SQLITE */
 	}
@@ -792,6 +1107,10 @@ eap_sim_db_init(const char *config, unsigned int db_timeout,
 	return data;
 
 fail:
+#ifdef CONFIG_SQLITE
+	if (data->sqlite_db)
+		db_close(data);
+#endif /* CONFIG_SQLITE */
 	eap_sim_db_close_socket(data);
 	os_free(data->fname);
 	os_free(data);
@@ -827,10 +1146,8 @@ void eap_sim_db_deinit(void *priv)
 	struct eap_sim_db_pending *pending, *prev_pending;
 
 #ifdef CONFIG_SQLITE
-	if (data->sqlite_db) {
-		sqlite3_close(data->sqlite_db);
-		data->sqlite_db = NULL;
-	}
+	if (data->sqlite_db)
+		db_close(data);
 #endif /* CONFIG_SQLITE */
 
 	eap_sim_db_close_socket(data);
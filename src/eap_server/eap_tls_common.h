@@ -38,6 +38,23 @@ struct eap_ssl_data {
 	 */
 	struct wpabuf *tls_in;
 
+	/**
+	 * tls_in_buf - Re-assembly buffer reused for all messages of the session
+	 */
+	struct wpabuf *tls_in_buf;
+
+	/**
+	 * tls_in_left - Number of octets still missing from the fragmented
+	 * message that is being received
+	 */
+	size_t tls_in_left;
+
+	/**
+	 * tls_in_direct - Whether the fragments of the message that is being
+	 * received are given directly to the TLS library instead of tls_in
+	 */
+	int tls_in_direct;
+
 	/**
 	 * phase2 - Whether this TLS connection is used in EAP phase 2 (tunnel)
 	 */
@@ -55,6 +72,12 @@ struct eap_ssl_data {
 	 * tls_v13 - Whether TLS v1.3 or newer is used
 	 */
 	int tls_v13;
+
+	/**
+	 * async_pending - Whether the handshake waits for a private key
+	 * operation in a worker thread
+	 */
+	int async_pending;
 };
 
 
@@ -18,6 +18,10 @@
 #include "crypto/crypto.h"
 #include "l2_packet.h"
 
+/* Maximum length of a received frame and number of frames per wakeup */
+#define L2_PACKET_MAX_RX_LEN 2300
+#define L2_PACKET_RX_BATCH 16
+
 
 struct l2_packet_data {
 	int fd; /* packet socket for EAPOL frames */
@@ -145,23 +149,16 @@ int l2_packet_send(struct l2_packet_data *l2, const u8 *dst_addr, u16 proto,
 }
 
 
-static void l2_packet_receive(int sock, void *eloop_ctx, void *sock_ctx)
+static void l2_packet_receive_frame(struct l2_packet_data *l2,
+				    struct eloop_datagram *dgram)
 {
-	struct l2_packet_data *l2 = eloop_ctx;
-	u8 buf[2300];
-	int res;
+	const u8 *buf = dgram->buf;
+	int res = dgram->len;
 	struct sockaddr_ll ll;
-	socklen_t fromlen;
 
 	os_memset(&ll, 0, sizeof(ll));
-	fromlen = sizeof(ll);
-	res = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *) &ll,
-		       &fromlen);
-	if (res < 0) {
-		wpa_printf(MSG_DEBUG, "l2_packet_receive - recvfrom: %s",
-			   strerror(errno));
-		return;
-	}
+	os_memcpy(&ll, dgram->from, dgram->fromlen < sizeof(ll) ?
+		  dgram->fromlen : sizeof(ll));
 
 	wpa_printf(MSG_DEBUG, "%s: src=" MACSTR " len=%d",
 		   __func__, MAC2STR(ll.sll_addr), (int) res);
@@ -215,6 +212,17 @@ static void l2_packet_receive(int sock, void *eloop_ctx, void *sock_ctx)
 }
 
 
+static void l2_packet_receive(int sock, void *eloop_ctx, void *sock_ctx,
+			      struct eloop_datagram_batch *batch)
+{
+	struct l2_packet_data *l2 = eloop_ctx;
+	size_t i;
+
+	for (i = 0; i < batch->num; i++)
+		l2_packet_receive_frame(l2, &batch->msgs[i]);
+}
+
+
 #ifndef CONFIG_NO_LINUX_PACKET_SOCKET_WAR
 static void l2_packet_receive_br(int sock, void *eloop_ctx, void *sock_ctx)
 {
@@ -329,7 +337,9 @@ struct l2_packet_data * l2_packet_init(
 	}
 	os_memcpy(l2->own_addr, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
 
-	eloop_register_read_sock(l2->fd, l2_packet_receive, l2, NULL);
+	eloop_register_read_sock_batch(l2->fd, L2_PACKET_RX_BATCH,
+				       L2_PACKET_MAX_RX_LEN, l2_packet_receive,
+				       l2, NULL);
 
 	return l2;
 }
@@ -414,6 +424,16 @@ struct l2_packet_data * l2_packet_init_bridge(
 	}
 
 	eloop_register_read_sock(l2->fd_br_rx, l2_packet_receive_br, l2, NULL);
+
+	/*
+	 * Duplicate detection between the two sockets depends on the frames
+	 * being processed in the order they were received, so do not batch
+	 * receive operations on the main socket while the workaround socket
+	 * is in use.
+	 */
+	eloop_unregister_read_sock(l2->fd);
+	eloop_register_read_sock_batch(l2->fd, 1, L2_PACKET_MAX_RX_LEN,
+				       l2_packet_receive, l2, NULL);
 #endif /* CONFIG_NO_LINUX_PACKET_SOCKET_WAR */
 
 	return l2;
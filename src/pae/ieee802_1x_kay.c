@@ -16,6 +16,7 @@
 #include "l2_packet/l2_packet.h"
 #include "common/eapol_common.h"
 #include "crypto/aes_wrap.h"
+#include "crypto/crypto.h"
 #include "ieee802_1x_cp.h"
 #include "ieee802_1x_key.h"
 #include "ieee802_1x_kay.h"
@@ -1883,7 +1884,7 @@ ieee802_1x_mka_encode_icv_body(struct ieee802_1x_mka_participant *participant,
 	}
 
 	if (mka_alg_tbl[participant->kay->mka_algindex].icv_hash(
-		    participant->ick.key, participant->ick.len,
+		    participant->ick_mac,
 		    wpabuf_head(buf), wpabuf_len(buf), cmac)) {
 		wpa_printf(MSG_ERROR, "KaY: failed to calculate ICV");
 		return -1;
@@ -3166,7 +3167,7 @@ static int ieee802_1x_kay_mkpdu_sanity_check(struct ieee802_1x_kay *kay,
 	 */
 	if (len < mka_alg_tbl[kay->mka_algindex].icv_len ||
 	    mka_alg_tbl[kay->mka_algindex].icv_hash(
-		    participant->ick.key, participant->ick.len,
+		    participant->ick_mac,
 		    buf, len - mka_alg_tbl[kay->mka_algindex].icv_len, icv)) {
 		wpa_printf(MSG_ERROR, "KaY: Failed to calculate ICV");
 		return -1;
@@ -3761,6 +3762,13 @@ ieee802_1x_kay_create_mka(struct ieee802_1x_kay *kay,
 	}
 	wpa_hexdump_key(MSG_DEBUG, "KaY: Derived ICK",
 			participant->ick.key, participant->ick.len);
+	participant->ick_mac = crypto_mac_init(CRYPTO_MAC_AES_CMAC,
+					       participant->ick.key,
+					       participant->ick.len);
+	if (!participant->ick_mac) {
+		wpa_printf(MSG_ERROR, "KaY: Failed to set up ICV context");
+		goto fail;
+	}
 
 	dl_list_add(&kay->participant_list, &participant->list);
 
@@ -3782,6 +3790,7 @@ ieee802_1x_kay_create_mka(struct ieee802_1x_kay *kay,
 	return participant;
 
 fail:
+	crypto_mac_deinit(participant->ick_mac);
 	os_free(participant->txsc);
 	os_free(participant);
 	return NULL;
@@ -3848,6 +3857,7 @@ ieee802_1x_kay_delete_mka(struct ieee802_1x_kay *kay, struct mka_key_name *ckn)
 	os_memset(&participant->cak, 0, sizeof(participant->cak));
 	os_memset(&participant->kek, 0, sizeof(participant->kek));
 	os_memset(&participant->ick, 0, sizeof(participant->ick));
+	crypto_mac_deinit(participant->ick_mac);
 	os_free(participant);
 }
 
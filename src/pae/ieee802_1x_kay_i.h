@@ -35,6 +35,7 @@ enum mka_packet_type {
 #define MAX_RETRY_CNT                   5
 
 struct ieee802_1x_kay;
+struct crypto_mac;
 
 struct ieee802_1x_mka_peer_id {
 	u8 mi[MI_LEN];
@@ -76,7 +77,7 @@ struct mka_alg {
 	int (*ick_trfm)(const u8 *cak, size_t cak_bytes,
 			const u8 *ckn, size_t ckn_len,
 			u8 *ick, size_t ick_bytes);
-	int (*icv_hash)(const u8 *ick, size_t ick_bytes,
+	int (*icv_hash)(struct crypto_mac *ick,
 			const u8 *msg, size_t msg_len, u8 *icv);
 };
 
@@ -107,6 +108,7 @@ struct ieee802_1x_mka_participant {
 
 	struct mka_key kek;
 	struct mka_key ick;
+	struct crypto_mac *ick_mac; /* AES-CMAC context keyed with ick */
 
 	struct ieee802_1x_mka_ki lki;
 	u8 lan;
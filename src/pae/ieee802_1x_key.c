@@ -175,19 +175,14 @@ int ieee802_1x_ick_aes_cmac(const u8 *cak, size_t cak_bytes, const u8 *ckn,
  *
  * IEEE Std 802.1X-2010, 9.4.1
  * ICV = AES-CMAC(ICK, M, 128)
+ *
+ * @ick is an AES-CMAC context keyed with the ICK so that the AES key schedule
+ * is not recomputed for each MKPDU.
  */
-int ieee802_1x_icv_aes_cmac(const u8 *ick, size_t ick_bytes, const u8 *msg,
+int ieee802_1x_icv_aes_cmac(struct crypto_mac *ick, const u8 *msg,
 			    size_t msg_bytes, u8 *icv)
 {
-	int res;
-
-	if (ick_bytes == 16)
-		res = omac1_aes_128(ick, msg, msg_bytes, icv);
-	else if (ick_bytes == 32)
-		res = omac1_aes_256(ick, msg, msg_bytes, icv);
-	else
-		return -1;
-	if (res) {
+	if (!ick || crypto_mac_vector(ick, 1, &msg, &msg_bytes, icv) < 0) {
 		wpa_printf(MSG_ERROR,
 			   "MKA: AES-CMAC failed for ICV calculation");
 		return -1;
@@ -15,6 +15,14 @@
 #include "radius.h"
 
 
+/* Offsets of the parts of struct radius_msg::attr_index */
+#define RADIUS_ATTR_INDEX_FIRST 0
+#define RADIUS_ATTR_INDEX_NEXT 256
+
+/* Messages with fewer attributes are searched without building the index
+ * since a linear scan of a few attributes is faster than the allocation */
+#define RADIUS_ATTR_INDEX_MIN_ATTRS 32
+
 /**
  * struct radius_msg - RADIUS message structure for new and parsed messages
  */
@@ -46,6 +54,25 @@ struct radius_msg {
 	 * attr_used - Total number of attributes in the array
 	 */
 	size_t attr_used;
+
+	/**
+	 * attr_index - Attribute index by type or %NULL if not yet built
+	 *
+	 * This is an array of 256 + attr_used entries. The first 256 entries
+	 * (RADIUS_ATTR_INDEX_FIRST) are indexed by attribute type and contain
+	 * one plus the index (in attr_pos) of the first attribute of that type
+	 * or 0 if there is no such attribute. The remaining entries
+	 * (RADIUS_ATTR_INDEX_NEXT) are indexed by attribute index and contain
+	 * one plus the index of the next attribute of the same type. Since
+	 * the length of a RADIUS message is limited to 65535 octets, the
+	 * attribute indexes fit in 16 bits.
+	 *
+	 * The index is built on the first lookup if the message has at least
+	 * RADIUS_ATTR_INDEX_MIN_ATTRS attributes and dropped when an attribute
+	 * is added. Otherwise, or if memory allocation fails, lookups scan
+	 * attr_pos.
+	 */
+	u16 *attr_index;
 };
 
 
@@ -69,6 +96,101 @@ radius_get_attr_hdr(struct radius_msg *msg, int idx)
 }
 
 
+static int radius_msg_build_index(struct radius_msg *msg)
+{
+	u16 *index;
+	size_t i;
+	u8 type;
+
+	if (msg->attr_index)
+		return 0;
+	if (msg->attr_used < RADIUS_ATTR_INDEX_MIN_ATTRS)
+		return -1;
+
+	index = os_calloc(RADIUS_ATTR_INDEX_NEXT + msg->attr_used,
+			  sizeof(u16));
+	if (!index)
+		return -1;
+
+	/* Link the attributes of each type in the order they appear in the
+	 * message */
+	for (i = msg->attr_used; i > 0; i--) {
+		type = radius_get_attr_hdr(msg, i - 1)->type;
+		index[RADIUS_ATTR_INDEX_NEXT + i - 1] =
+			index[RADIUS_ATTR_INDEX_FIRST + type];
+		index[RADIUS_ATTR_INDEX_FIRST + type] = i;
+	}
+	msg->attr_index = index;
+
+	return 0;
+}
+
+
+/* Index of the first attribute of the specified type or -1 if not found */
+static int radius_msg_attr_first(struct radius_msg *msg, u8 type)
+{
+	size_t i;
+
+	if (radius_msg_build_index(msg) == 0)
+		return msg->attr_index[RADIUS_ATTR_INDEX_FIRST + type] - 1;
+
+	for (i = 0; i < msg->attr_used; i++) {
+		if (radius_get_attr_hdr(msg, i)->type == type)
+			return i;
+	}
+	return -1;
+}
+
+
+/* Index of the next attribute of the same type or -1 if not found */
+static int radius_msg_attr_next(struct radius_msg *msg, int idx)
+{
+	u8 type;
+	size_t i;
+
+	if (msg->attr_index)
+		return msg->attr_index[RADIUS_ATTR_INDEX_NEXT + idx] - 1;
+
+	type = radius_get_attr_hdr(msg, idx)->type;
+	for (i = idx + 1; i < msg->attr_used; i++) {
+		if (radius_get_attr_hdr(msg, i)->type == type)
+			return i;
+	}
+	return -1;
+}
+
+
+/* Index of the first attribute of the specified type that begins after the
+ * specified position in the message or -1 if not found */
+static int radius_msg_attr_after(struct radius_msg *msg, u8 type,
+				 const u8 *start)
+{
+	const u8 *head = wpabuf_head_u8(msg->buf);
+	size_t left = 0, right = msg->attr_used, mid;
+	int i;
+
+	/* Find the last attribute that begins at or before start; attr_pos is
+	 * in increasing order since attributes are only ever appended */
+	while (left < right) {
+		mid = left + (right - left) / 2;
+		if (head + msg->attr_pos[mid] <= start)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	i = (int) left - 1;
+
+	if (i >= 0 && radius_get_attr_hdr(msg, i)->type == type)
+		return radius_msg_attr_next(msg, i);
+
+	for (i++; i < (int) msg->attr_used; i++) {
+		if (radius_get_attr_hdr(msg, i)->type == type)
+			return i;
+	}
+	return -1;
+}
+
+
 static void radius_msg_set_hdr(struct radius_msg *msg, u8 code, u8 identifier)
 {
 	msg->hdr->code = code;
@@ -131,6 +253,7 @@ void radius_msg_free(struct radius_msg *msg)
 
 	wpabuf_free(msg->buf);
 	os_free(msg->attr_pos);
+	os_free(msg->attr_index);
 	os_free(msg);
 }
 
@@ -550,8 +673,8 @@ int radius_msg_verify_das_req(struct radius_msg *msg, const u8 *secret,
 	u8 auth[MD5_MAC_LEN], orig[MD5_MAC_LEN];
 	u8 orig_authenticator[16];
 
-	struct radius_attr_hdr *attr = NULL, *tmp;
-	size_t i;
+	struct radius_attr_hdr *attr = NULL;
+	int i;
 
 	os_memset(zero, 0, sizeof(zero));
 	addr[0] = (u8 *) msg->hdr;
@@ -566,17 +689,15 @@ int radius_msg_verify_das_req(struct radius_msg *msg, const u8 *secret,
 	if (os_memcmp_const(msg->hdr->authenticator, hash, MD5_MAC_LEN) != 0)
 		return 1;
 
-	for (i = 0; i < msg->attr_used; i++) {
-		tmp = radius_get_attr_hdr(msg, i);
-		if (tmp->type == RADIUS_ATTR_MESSAGE_AUTHENTICATOR) {
-			if (attr != NULL) {
-				wpa_printf(MSG_WARNING, "Multiple "
-					   "Message-Authenticator attributes "
-					   "in RADIUS message");
-				return 1;
-			}
-			attr = tmp;
+	i = radius_msg_attr_first(msg, RADIUS_ATTR_MESSAGE_AUTHENTICATOR);
+	if (i >= 0) {
+		if (radius_msg_attr_next(msg, i) >= 0) {
+			wpa_printf(MSG_WARNING, "Multiple "
+				   "Message-Authenticator attributes "
+				   "in RADIUS message");
+			return 1;
 		}
+		attr = radius_get_attr_hdr(msg, i);
 	}
 
 	if (attr == NULL) {
@@ -623,6 +744,12 @@ static int radius_msg_add_attr_to_array(struct radius_msg *msg,
 	msg->attr_pos[msg->attr_used++] =
 		(unsigned char *) attr - wpabuf_head_u8(msg->buf);
 
+	/* The index is rebuilt on the next lookup */
+	if (msg->attr_index) {
+		os_free(msg->attr_index);
+		msg->attr_index = NULL;
+	}
+
 	return 0;
 }
 
@@ -762,17 +889,18 @@ int radius_msg_add_eap(struct radius_msg *msg, const u8 *data, size_t data_len)
 struct wpabuf * radius_msg_get_eap(struct radius_msg *msg)
 {
 	struct wpabuf *eap;
-	size_t len, i;
+	size_t len;
+	int i;
 	struct radius_attr_hdr *attr;
 
 	if (msg == NULL)
 		return NULL;
 
 	len = 0;
-	for (i = 0; i < msg->attr_used; i++) {
+	for (i = radius_msg_attr_first(msg, RADIUS_ATTR_EAP_MESSAGE); i >= 0;
+	     i = radius_msg_attr_next(msg, i)) {
 		attr = radius_get_attr_hdr(msg, i);
-		if (attr->type == RADIUS_ATTR_EAP_MESSAGE &&
-		    attr->length > sizeof(struct radius_attr_hdr))
+		if (attr->length > sizeof(struct radius_attr_hdr))
 			len += attr->length - sizeof(struct radius_attr_hdr);
 	}
 
@@ -783,10 +911,10 @@ struct wpabuf * radius_msg_get_eap(struct radius_msg *msg)
 	if (eap == NULL)
 		return NULL;
 
-	for (i = 0; i < msg->attr_used; i++) {
+	for (i = radius_msg_attr_first(msg, RADIUS_ATTR_EAP_MESSAGE); i >= 0;
+	     i = radius_msg_attr_next(msg, i)) {
 		attr = radius_get_attr_hdr(msg, i);
-		if (attr->type == RADIUS_ATTR_EAP_MESSAGE &&
-		    attr->length > sizeof(struct radius_attr_hdr)) {
+		if (attr->length > sizeof(struct radius_attr_hdr)) {
 			int flen = attr->length - sizeof(*attr);
 			wpabuf_put_data(eap, attr + 1, flen);
 		}
@@ -801,18 +929,16 @@ int radius_msg_verify_msg_auth(struct radius_msg *msg, const u8 *secret,
 {
 	u8 auth[MD5_MAC_LEN], orig[MD5_MAC_LEN];
 	u8 orig_authenticator[16];
-	struct radius_attr_hdr *attr = NULL, *tmp;
-	size_t i;
+	struct radius_attr_hdr *attr = NULL;
+	int i;
 
-	for (i = 0; i < msg->attr_used; i++) {
-		tmp = radius_get_attr_hdr(msg, i);
-		if (tmp->type == RADIUS_ATTR_MESSAGE_AUTHENTICATOR) {
-			if (attr != NULL) {
-				wpa_printf(MSG_INFO, "Multiple Message-Authenticator attributes in RADIUS message");
-				return 1;
-			}
-			attr = tmp;
+	i = radius_msg_attr_first(msg, RADIUS_ATTR_MESSAGE_AUTHENTICATOR);
+	if (i >= 0) {
+		if (radius_msg_attr_next(msg, i) >= 0) {
+			wpa_printf(MSG_INFO, "Multiple Message-Authenticator attributes in RADIUS message");
+			return 1;
 		}
+		attr = radius_get_attr_hdr(msg, i);
 	}
 
 	if (attr == NULL) {
@@ -887,12 +1013,13 @@ int radius_msg_copy_attr(struct radius_msg *dst, struct radius_msg *src,
 			 u8 type)
 {
 	struct radius_attr_hdr *attr;
-	size_t i;
+	int i;
 	int count = 0;
 
-	for (i = 0; i < src->attr_used; i++) {
+	for (i = radius_msg_attr_first(src, type); i >= 0;
+	     i = radius_msg_attr_next(src, i)) {
 		attr = radius_get_attr_hdr(src, i);
-		if (attr->type == type && attr->length >= sizeof(*attr)) {
+		if (attr->length >= sizeof(*attr)) {
 			if (!radius_msg_add_attr(dst, type, (u8 *) (attr + 1),
 						 attr->length - sizeof(*attr)))
 				return -1;
@@ -924,19 +1051,20 @@ static u8 *radius_msg_get_vendor_attr(struct radius_msg *msg, u32 vendor,
 				      u8 subtype, size_t *alen)
 {
 	u8 *data, *pos;
-	size_t i, len;
+	size_t len;
+	int i;
 
 	if (msg == NULL)
 		return NULL;
 
-	for (i = 0; i < msg->attr_used; i++) {
+	for (i = radius_msg_attr_first(msg, RADIUS_ATTR_VENDOR_SPECIFIC);
+	     i >= 0; i = radius_msg_attr_next(msg, i)) {
 		struct radius_attr_hdr *attr = radius_get_attr_hdr(msg, i);
 		size_t left;
 		u32 vendor_id;
 		struct radius_attr_vendor *vhdr;
 
-		if (attr->type != RADIUS_ATTR_VENDOR_SPECIFIC ||
-		    attr->length < sizeof(*attr))
+		if (attr->length < sizeof(*attr))
 			continue;
 
 		left = attr->length - sizeof(*attr);
@@ -1358,18 +1486,15 @@ radius_msg_add_attr_user_password(struct radius_msg *msg,
 
 int radius_msg_get_attr(struct radius_msg *msg, u8 type, u8 *buf, size_t len)
 {
-	struct radius_attr_hdr *attr = NULL, *tmp;
-	size_t i, dlen;
-
-	for (i = 0; i < msg->attr_used; i++) {
-		tmp = radius_get_attr_hdr(msg, i);
-		if (tmp->type == type) {
-			attr = tmp;
-			break;
-		}
-	}
+	struct radius_attr_hdr *attr;
+	size_t dlen;
+	int i;
 
-	if (!attr || attr->length < sizeof(*attr))
+	i = radius_msg_attr_first(msg, type);
+	if (i < 0)
+		return -1;
+	attr = radius_get_attr_hdr(msg, i);
+	if (attr->length < sizeof(*attr))
 		return -1;
 
 	dlen = attr->length - sizeof(*attr);
@@ -1382,19 +1507,18 @@ int radius_msg_get_attr(struct radius_msg *msg, u8 type, u8 *buf, size_t len)
 int radius_msg_get_attr_ptr(struct radius_msg *msg, u8 type, u8 **buf,
 			    size_t *len, const u8 *start)
 {
-	size_t i;
-	struct radius_attr_hdr *attr = NULL, *tmp;
+	struct radius_attr_hdr *attr;
+	int i;
 
-	for (i = 0; i < msg->attr_used; i++) {
-		tmp = radius_get_attr_hdr(msg, i);
-		if (tmp->type == type &&
-		    (start == NULL || (u8 *) tmp > start)) {
-			attr = tmp;
-			break;
-		}
-	}
+	if (start)
+		i = radius_msg_attr_after(msg, type, start);
+	else
+		i = radius_msg_attr_first(msg, type);
+	if (i < 0)
+		return -1;
 
-	if (!attr || attr->length < sizeof(*attr))
+	attr = radius_get_attr_hdr(msg, i);
+	if (attr->length < sizeof(*attr))
 		return -1;
 
 	*buf = (u8 *) (attr + 1);
@@ -1405,13 +1529,12 @@ int radius_msg_get_attr_ptr(struct radius_msg *msg, u8 type, u8 **buf,
 
 int radius_msg_count_attr(struct radius_msg *msg, u8 type, int min_len)
 {
-	size_t i;
-	int count;
+	int i, count;
 
-	for (count = 0, i = 0; i < msg->attr_used; i++) {
+	for (count = 0, i = radius_msg_attr_first(msg, type); i >= 0;
+	     i = radius_msg_attr_next(msg, i)) {
 		struct radius_attr_hdr *attr = radius_get_attr_hdr(msg, i);
-		if (attr->type == type &&
-		    attr->length >= sizeof(struct radius_attr_hdr) + min_len)
+		if (attr->length >= sizeof(struct radius_attr_hdr) + min_len)
 			count++;
 	}
 
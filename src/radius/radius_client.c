@@ -7,11 +7,17 @@
  */
 
 #include "includes.h"
+#include <fcntl.h>
 
 #include "common.h"
+#include "list.h"
 #include "radius.h"
 #include "radius_client.h"
 #include "eloop.h"
+#ifdef CONFIG_RADIUS_TLS
+#include "crypto/tls.h"
+#include "radius_tls.h"
+#endif /* CONFIG_RADIUS_TLS */
 
 /* Defaults for RADIUS retransmit values (exponential backoff) */
 
@@ -34,12 +40,22 @@
 #define RADIUS_CLIENT_MAX_FAILOVER 3
 
 /**
- * RADIUS_CLIENT_MAX_ENTRIES - RADIUS client maximum pending messages
+ * RADIUS_CLIENT_MAX_SOCKETS - RADIUS client maximum sockets per server type
  *
- * Maximum number of entries in retransmit list (oldest entries will be
- * removed, if this limit is exceeded).
+ * Each socket uses its own source port and RADIUS Identifier space, so this
+ * limits the number of pending authentication (and accounting) messages to
+ * RADIUS_CLIENT_MAX_SOCKETS * 256. If this limit is exceeded, a pending
+ * message is removed to make its Identifier available for the new message.
  */
-#define RADIUS_CLIENT_MAX_ENTRIES 30
+#define RADIUS_CLIENT_MAX_SOCKETS 16
+
+/**
+ * RADIUS_CLIENT_IDLE_SOCKET_TIME - Time in seconds to keep idle sockets open
+ *
+ * Additional sockets for a server are closed once there have been no pending
+ * messages on them for this long. The first socket for each server is kept.
+ */
+#define RADIUS_CLIENT_IDLE_SOCKET_TIME 5
 
 /**
  * RADIUS_CLIENT_NUM_FAILOVER - RADIUS client failover point
@@ -49,6 +65,43 @@
  */
 #define RADIUS_CLIENT_NUM_FAILOVER 4
 
+/**
+ * RADIUS_CLIENT_MAX_RX_LEN - RADIUS client receive buffer size in octets
+ *
+ * Received frames of this length are assumed to have been truncated and are
+ * dropped.
+ */
+#define RADIUS_CLIENT_MAX_RX_LEN 3000
+
+/**
+ * RADIUS_CLIENT_RX_BATCH - RADIUS client maximum frames received per wakeup
+ */
+#define RADIUS_CLIENT_RX_BATCH 16
+
+/**
+ * RADIUS_CLIENT_UNAVAILABLE_TIME - Time to skip a non-responding server
+ *
+ * With authentication server load balancing, a server that does not reply to
+ * RADIUS_CLIENT_NUM_FAILOVER retransmissions of a request is not selected for
+ * new requests for this many seconds unless no other server is available.
+ */
+#define RADIUS_CLIENT_UNAVAILABLE_TIME 30
+
+/**
+ * RADIUS_CLIENT_STATE_LIFETIME - Lifetime of a State to server mapping
+ *
+ * Maximum time in seconds to wait for the next Access-Request of an EAP
+ * session after an Access-Challenge when load balancing is used.
+ */
+#define RADIUS_CLIENT_STATE_LIFETIME 60
+
+/**
+ * RADIUS_CLIENT_MAX_STATES - Maximum number of State to server mappings
+ */
+#define RADIUS_CLIENT_MAX_STATES 4096
+
+#define RADIUS_CLIENT_STATE_HASH_SIZE 256
+
 
 /**
  * struct radius_rx_handler - RADIUS client RX handler
@@ -82,6 +135,11 @@ struct radius_rx_handler {
  * store pending RADIUS requests that may still need to be retransmitted.
  */
 struct radius_msg_list {
+	/**
+	 * list - Entry in struct radius_client_data::msgs
+	 */
+	struct dl_list list;
+
 	/**
 	 * addr - STA/client address
 	 *
@@ -104,6 +162,14 @@ struct radius_msg_list {
 	 */
 	os_time_t first_try;
 
+	/**
+	 * acct_delay_time - Acct-Delay-Time in the first transmission attempt
+	 *
+	 * This is nonzero for accounting messages that are replayed from the
+	 * accounting spool after having been delayed already.
+	 */
+	u32 acct_delay_time;
+
 	/**
 	 * next_try - Time for the next transmission attempt
 	 */
@@ -139,12 +205,114 @@ struct radius_msg_list {
 	 */
 	size_t shared_secret_len;
 
-	/* TODO: server config with failover to backup server(s) */
+	/**
+	 * sock - Socket used for this message or %NULL if not yet assigned
+	 *
+	 * The message is stored in sock->pending[] at the index of its RADIUS
+	 * Identifier while this is set.
+	 */
+	struct radius_client_sock *sock;
+
+	/**
+	 * serv - RADIUS server this message is sent to
+	 */
+	struct hostapd_radius_server *serv;
+};
+
+
+/**
+ * struct radius_client_state - Server that issued an Access-Challenge
+ *
+ * This data structure is used internally inside the RADIUS client module to
+ * send the Access-Request that continues an EAP session to the same server
+ * with authentication server load balancing. The entries are matched based on
+ * the State attribute.
+ */
+struct radius_client_state {
+	/**
+	 * list - Entry in struct radius_client_data::states (oldest first)
+	 */
+	struct dl_list list;
+
+	/**
+	 * hash_list - Entry in struct radius_client_data::state_hash
+	 */
+	struct dl_list hash_list;
+
+	/**
+	 * serv - RADIUS server that sent the State attribute
+	 */
+	struct hostapd_radius_server *serv;
+
+	/**
+	 * expires - Time after which this entry is not used anymore
+	 */
+	os_time_t expires;
+
+	/**
+	 * len - Length of the State attribute value in octets
+	 */
+	size_t len;
+
+	/**
+	 * state - State attribute value
+	 */
+	u8 state[];
+};
+
+
+/**
+ * struct radius_client_sock - RADIUS client socket
+ *
+ * This data structure is used internally inside the RADIUS client module to
+ * store a socket connected to an authentication or accounting server and the
+ * pending messages that were sent on it. Responses are matched to requests
+ * based on the receiving socket and the RADIUS Identifier.
+ */
+struct radius_client_sock {
+	/**
+	 * radius - RADIUS client context
+	 */
+	struct radius_client_data *radius;
+
+	/**
+	 * serv - RADIUS server to which the socket is connected
+	 */
+	struct hostapd_radius_server *serv;
+
+	/**
+	 * s - Socket file descriptor
+	 */
+	int s;
 
 	/**
-	 * next - Next message in the list
+	 * tls - RADIUS/TLS connection or %NULL for a UDP socket
+	 *
+	 * Each TLS connection has its own RADIUS Identifier space in the same
+	 * way as the UDP sockets, so more than 256 pending messages to a
+	 * RADIUS/TLS server are multiplexed over multiple connections.
+	 */
+	struct radius_tls_conn *tls;
+
+	/**
+	 * auth - Whether this is an authentication (1) or accounting (0) socket
+	 */
+	int auth;
+
+	/**
+	 * pending - Pending messages indexed by the RADIUS Identifier
+	 */
+	struct radius_msg_list *pending[256];
+
+	/**
+	 * num_pending - Number of non-NULL entries in pending
+	 */
+	unsigned int num_pending;
+
+	/**
+	 * idle_since - Time when num_pending dropped to zero
 	 */
-	struct radius_msg_list *next;
+	os_time_t idle_since;
 };
 
 
@@ -168,34 +336,24 @@ struct radius_client_data {
 	struct hostapd_radius_servers *conf;
 
 	/**
-	 * auth_serv_sock - IPv4 socket for RADIUS authentication messages
-	 */
-	int auth_serv_sock;
-
-	/**
-	 * acct_serv_sock - IPv4 socket for RADIUS accounting messages
+	 * auth_socks - Sockets for RADIUS authentication server
 	 */
-	int acct_serv_sock;
+	struct radius_client_sock *auth_socks[RADIUS_CLIENT_MAX_SOCKETS];
 
 	/**
-	 * auth_serv_sock6 - IPv6 socket for RADIUS authentication messages
+	 * num_auth_socks - Number of sockets in auth_socks
 	 */
-	int auth_serv_sock6;
+	size_t num_auth_socks;
 
 	/**
-	 * acct_serv_sock6 - IPv6 socket for RADIUS accounting messages
+	 * acct_socks - Sockets for RADIUS accounting server
 	 */
-	int acct_serv_sock6;
+	struct radius_client_sock *acct_socks[RADIUS_CLIENT_MAX_SOCKETS];
 
 	/**
-	 * auth_sock - Currently used socket for RADIUS authentication server
+	 * num_acct_socks - Number of sockets in acct_socks
 	 */
-	int auth_sock;
-
-	/**
-	 * acct_sock - Currently used socket for RADIUS accounting server
-	 */
-	int acct_sock;
+	size_t num_acct_socks;
 
 	/**
 	 * auth_handlers - Authentication message handlers
@@ -218,9 +376,9 @@ struct radius_client_data {
 	size_t num_acct_handlers;
 
 	/**
-	 * msgs - Pending outgoing RADIUS messages
+	 * msgs - Pending outgoing RADIUS messages (struct radius_msg_list)
 	 */
-	struct radius_msg_list *msgs;
+	struct dl_list msgs;
 
 	/**
 	 * num_msgs - Number of pending messages in the msgs list
@@ -241,6 +399,41 @@ struct radius_client_data {
 	 * interim_error_cb_ctx - interim_error_cb() context data
 	 */
 	void *interim_error_cb_ctx;
+
+	/**
+	 * acct_drop_cb - Unacknowledged accounting message callback
+	 */
+	void (*acct_drop_cb)(struct radius_msg *msg, void *ctx);
+
+	/**
+	 * acct_drop_cb_ctx - acct_drop_cb() context data
+	 */
+	void *acct_drop_cb_ctx;
+
+	/**
+	 * next_auth_server - Next server index for round-robin selection
+	 */
+	unsigned int next_auth_server;
+
+	/**
+	 * states - State to server mappings (struct radius_client_state)
+	 */
+	struct dl_list states;
+
+	/**
+	 * state_hash - Hash table of the entries in states
+	 */
+	struct dl_list state_hash[RADIUS_CLIENT_STATE_HASH_SIZE];
+
+	/**
+	 * num_states - Number of entries in states
+	 */
+	unsigned int num_states;
+
+	/**
+	 * tls_ctx - TLS context for RADIUS/TLS connections or %NULL
+	 */
+	void *tls_ctx;
 };
 
 
@@ -248,11 +441,26 @@ static int
 radius_change_server(struct radius_client_data *radius,
 		     struct hostapd_radius_server *nserv,
 		     struct hostapd_radius_server *oserv,
-		     int sock, int sock6, int auth);
+		     int auth);
 static int radius_client_init_acct(struct radius_client_data *radius);
 static int radius_client_init_auth(struct radius_client_data *radius);
 static void radius_client_auth_failover(struct radius_client_data *radius);
 static void radius_client_acct_failover(struct radius_client_data *radius);
+static struct radius_client_sock *
+radius_client_add_sock(struct radius_client_data *radius, int auth,
+		       struct hostapd_radius_server *serv);
+static struct radius_client_sock *
+radius_client_open_sock(struct radius_client_data *radius,
+			struct hostapd_radius_server *nserv, int auth);
+static void radius_client_close_sock(struct radius_client_sock *sock);
+static void radius_client_idle_timer(void *eloop_ctx, void *timeout_ctx);
+
+
+static int radius_client_balanced(struct hostapd_radius_servers *conf)
+{
+	return conf->auth_server_policy != RADIUS_AUTH_SERVER_FAILOVER &&
+		conf->num_auth_servers > 1;
+}
 
 
 static void radius_client_msg_free(struct radius_msg_list *req)
@@ -262,6 +470,200 @@ static void radius_client_msg_free(struct radius_msg_list *req)
 }
 
 
+static struct radius_client_sock **
+radius_client_socks(struct radius_client_data *radius, int auth, size_t **num)
+{
+	if (auth) {
+		*num = &radius->num_auth_socks;
+		return radius->auth_socks;
+	}
+	*num = &radius->num_acct_socks;
+	return radius->acct_socks;
+}
+
+
+static void radius_client_msg_unbind(struct radius_msg_list *entry)
+{
+	struct radius_client_sock *sock = entry->sock;
+	struct radius_client_data *radius;
+	struct os_reltime now;
+	size_t *num;
+
+	if (!sock)
+		return;
+	sock->pending[radius_msg_get_hdr(entry->msg)->identifier] = NULL;
+	sock->num_pending--;
+	entry->sock = NULL;
+
+	/* The socket may be in use by the caller, so idle additional sockets
+	 * are closed from a timeout. */
+	radius = sock->radius;
+	radius_client_socks(radius, sock->auth, &num);
+	if (sock->num_pending == 0 && *num > 1) {
+		os_get_reltime(&now);
+		sock->idle_since = now.sec;
+		if (!eloop_is_timeout_registered(radius_client_idle_timer,
+						 radius, NULL))
+			eloop_register_timeout(RADIUS_CLIENT_IDLE_SOCKET_TIME,
+					       0, radius_client_idle_timer,
+					       radius, NULL);
+	}
+}
+
+
+/*
+ * Close the additional sockets that have been idle for
+ * RADIUS_CLIENT_IDLE_SOCKET_TIME. Returns the number of seconds until the next
+ * idle additional socket expires or 0 if there are none.
+ */
+static os_time_t
+radius_client_close_idle_socks(struct radius_client_data *radius, int auth,
+			       os_time_t now)
+{
+	struct radius_client_sock **socks, *sock;
+	size_t *num, i, j;
+	os_time_t next = 0, left;
+
+	socks = radius_client_socks(radius, auth, &num);
+	for (i = *num; i > 0; i--) {
+		sock = socks[i - 1];
+		if (sock->num_pending)
+			continue;
+		for (j = 0; j < i - 1; j++) {
+			if (socks[j]->serv == sock->serv)
+				break;
+		}
+		if (j == i - 1)
+			continue; /* first socket for the server */
+
+		left = sock->idle_since + RADIUS_CLIENT_IDLE_SOCKET_TIME - now;
+		if (left > 0) {
+			if (!next || left < next)
+				next = left;
+			continue;
+		}
+
+		/* Keep the order so that the first socket remains first */
+		os_memmove(&socks[i - 1], &socks[i],
+			   (*num - i) * sizeof(socks[0]));
+		(*num)--;
+		socks[*num] = NULL;
+		wpa_printf(MSG_DEBUG, "RADIUS: Closed idle %s socket (%u left)",
+			   auth ? "authentication" : "accounting",
+			   (unsigned int) *num);
+		radius_client_close_sock(sock);
+	}
+
+	return next;
+}
+
+
+static void radius_client_idle_timer(void *eloop_ctx, void *timeout_ctx)
+{
+	struct radius_client_data *radius = eloop_ctx;
+	struct os_reltime now;
+	os_time_t next, acct_next;
+
+	os_get_reltime(&now);
+	next = radius_client_close_idle_socks(radius, 1, now.sec);
+	acct_next = radius_client_close_idle_socks(radius, 0, now.sec);
+	if (!next || (acct_next && acct_next < next))
+		next = acct_next;
+	if (next)
+		eloop_register_timeout(next, 0, radius_client_idle_timer,
+				       radius, NULL);
+}
+
+
+static void radius_client_msg_set_serv(struct radius_msg_list *entry,
+				       struct hostapd_radius_server *serv)
+{
+	if (entry->serv)
+		entry->serv->pending--;
+	entry->serv = serv;
+	if (serv)
+		serv->pending++;
+}
+
+
+/* Remove a message from the retransmit list without freeing it */
+static void radius_client_msg_unlink(struct radius_client_data *radius,
+				     struct radius_msg_list *entry)
+{
+	radius_client_msg_unbind(entry);
+	radius_client_msg_set_serv(entry, NULL);
+	dl_list_del(&entry->list);
+	radius->num_msgs--;
+}
+
+
+/* Free an unlinked message that was not acknowledged by the server */
+static void radius_client_msg_drop(struct radius_client_data *radius,
+				   struct radius_msg_list *entry)
+{
+	if (entry->msg_type == RADIUS_ACCT && radius->acct_drop_cb)
+		radius->acct_drop_cb(entry->msg, radius->acct_drop_cb_ctx);
+	radius_client_msg_free(entry);
+}
+
+
+static void radius_client_msg_remove(struct radius_client_data *radius,
+				     struct radius_msg_list *entry)
+{
+	radius_client_msg_unlink(radius, entry);
+	radius_client_msg_drop(radius, entry);
+}
+
+
+/*
+ * Assign a socket for a message based on its RADIUS Identifier and server. A
+ * new socket is opened if the Identifier is already in use on all the current
+ * sockets for the server and as a last resort, the pending message using the
+ * Identifier is removed.
+ */
+static int radius_client_msg_bind(struct radius_client_data *radius,
+				  struct radius_msg_list *entry)
+{
+	struct radius_client_sock **socks, *sock, *used = NULL;
+	size_t *num, i;
+	u8 id = radius_msg_get_hdr(entry->msg)->identifier;
+	int auth = entry->msg_type == RADIUS_AUTH;
+
+	socks = radius_client_socks(radius, auth, &num);
+	for (i = 0; i < *num; i++) {
+		if (socks[i]->serv != entry->serv)
+			continue;
+		if (!socks[i]->pending[id])
+			break;
+		if (!used || socks[i]->pending[id]->first_try <
+		    used->pending[id]->first_try)
+			used = socks[i];
+	}
+
+	if (i < *num) {
+		sock = socks[i];
+	} else {
+		sock = radius_client_add_sock(radius, auth, entry->serv);
+		if (!sock) {
+			if (!used)
+				return -1;
+			sock = used;
+			hostapd_logger(radius->ctx, sock->pending[id]->addr,
+				       HOSTAPD_MODULE_RADIUS,
+				       HOSTAPD_LEVEL_DEBUG,
+				       "Removing pending RADIUS message, "
+				       "since its id (%d) is reused", id);
+			radius_client_msg_remove(radius, sock->pending[id]);
+		}
+	}
+
+	sock->pending[id] = entry;
+	sock->num_pending++;
+	entry->sock = sock;
+	return 0;
+}
+
+
 /**
  * radius_client_register - Register a RADIUS client RX handler
  * @radius: RADIUS client context from radius_client_init()
@@ -331,6 +733,28 @@ void radius_client_set_interim_error_cb(struct radius_client_data *radius,
 }
 
 
+/**
+ * radius_client_set_acct_drop_cb - Register unacknowledged accounting handler
+ * @radius: RADIUS client context from radius_client_init()
+ * @cb: Handler for accounting messages that are dropped without a response
+ * @ctx: Context pointer for handler callbacks
+ *
+ * The handler is called for RADIUS_ACCT messages that are removed from the
+ * retransmit list without having been acknowledged by the accounting server,
+ * e.g., due to too many retransmission attempts, radius_client_flush(), or a
+ * response that none of the registered handlers accepted. The message is freed
+ * after the handler returns.
+ */
+void radius_client_set_acct_drop_cb(struct radius_client_data *radius,
+				    void (*cb)(struct radius_msg *msg,
+					       void *ctx),
+				    void *ctx)
+{
+	radius->acct_drop_cb = cb;
+	radius->acct_drop_cb_ctx = ctx;
+}
+
+
 /*
  * Returns >0 if message queue was flushed (i.e., the message that triggered
  * the error is not available anymore)
@@ -362,76 +786,307 @@ static int radius_client_handle_send_error(struct radius_client_data *radius,
 }
 
 
-static int radius_client_retransmit(struct radius_client_data *radius,
-				    struct radius_msg_list *entry,
-				    os_time_t now)
+static int radius_client_sock_send(struct radius_client_sock *sock,
+				   const struct wpabuf *buf)
 {
-	struct hostapd_radius_servers *conf = radius->conf;
-	int s;
-	struct wpabuf *buf;
-	size_t prev_num_msgs;
-	u8 *acct_delay_time;
-	size_t acct_delay_time_len;
-	int num_servers;
-
-	if (entry->msg_type == RADIUS_ACCT ||
-	    entry->msg_type == RADIUS_ACCT_INTERIM) {
-		num_servers = conf->num_acct_servers;
-		if (radius->acct_sock < 0)
-			radius_client_init_acct(radius);
-		if (radius->acct_sock < 0 && conf->num_acct_servers > 1) {
-			prev_num_msgs = radius->num_msgs;
-			radius_client_acct_failover(radius);
-			if (prev_num_msgs != radius->num_msgs)
-				return 0;
-		}
-		s = radius->acct_sock;
-		if (entry->attempts == 0)
-			conf->acct_server->requests++;
-		else {
-			conf->acct_server->timeouts++;
-			conf->acct_server->retransmissions++;
-		}
-	} else {
-		num_servers = conf->num_auth_servers;
-		if (radius->auth_sock < 0)
-			radius_client_init_auth(radius);
-		if (radius->auth_sock < 0 && conf->num_auth_servers > 1) {
-			prev_num_msgs = radius->num_msgs;
-			radius_client_auth_failover(radius);
-			if (prev_num_msgs != radius->num_msgs)
-				return 0;
-		}
-		s = radius->auth_sock;
-		if (entry->attempts == 0)
-			conf->auth_server->requests++;
-		else {
-			conf->auth_server->timeouts++;
-			conf->auth_server->retransmissions++;
-		}
+#ifdef CONFIG_RADIUS_TLS
+	if (sock->tls) {
+		/* Failures are reported through radius_client_tls_closed() */
+		radius_tls_conn_send(sock->tls, buf);
+		return 0;
 	}
+#endif /* CONFIG_RADIUS_TLS */
 
-	if (entry->msg_type == RADIUS_ACCT_INTERIM) {
-		wpa_printf(MSG_DEBUG,
-			   "RADIUS: Failed to transmit interim accounting update to "
-			   MACSTR " - drop message and request a new update",
-			   MAC2STR(entry->addr));
-		if (radius->interim_error_cb)
-			radius->interim_error_cb(entry->addr,
-						 radius->interim_error_cb_ctx);
-		return 1;
-	}
+	return send(sock->s, wpabuf_head(buf), wpabuf_len(buf), 0);
+}
 
-	if (s < 0) {
-		wpa_printf(MSG_INFO,
-			   "RADIUS: No valid socket for retransmission");
-		return 1;
-	}
 
-	if (entry->msg_type == RADIUS_ACCT &&
-	    radius_msg_get_attr_ptr(entry->msg, RADIUS_ATTR_ACCT_DELAY_TIME,
-				    &acct_delay_time, &acct_delay_time_len,
-				    NULL) == 0 &&
+static unsigned int radius_client_state_hash(const u8 *state, size_t len)
+{
+	unsigned int hash = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		hash = hash * 31 + state[i];
+	return hash % RADIUS_CLIENT_STATE_HASH_SIZE;
+}
+
+
+static void radius_client_state_free(struct radius_client_data *radius,
+				     struct radius_client_state *st)
+{
+	dl_list_del(&st->list);
+	dl_list_del(&st->hash_list);
+	radius->num_states--;
+	os_free(st);
+}
+
+
+static void radius_client_flush_states(struct radius_client_data *radius)
+{
+	struct radius_client_state *st;
+
+	while ((st = dl_list_first(&radius->states, struct radius_client_state,
+				   list)))
+		radius_client_state_free(radius, st);
+}
+
+
+static void radius_client_expire_states(struct radius_client_data *radius,
+					os_time_t now)
+{
+	struct radius_client_state *st;
+
+	while ((st = dl_list_first(&radius->states, struct radius_client_state,
+				   list))) {
+		if (st->expires > now &&
+		    radius->num_states < RADIUS_CLIENT_MAX_STATES)
+			break;
+		radius_client_state_free(radius, st);
+	}
+}
+
+
+/* Find and remove the State to server mapping for an Access-Request */
+static struct hostapd_radius_server *
+radius_client_state_get(struct radius_client_data *radius,
+			struct radius_msg *msg, os_time_t now)
+{
+	struct radius_client_state *st;
+	struct hostapd_radius_server *serv;
+	u8 *state;
+	size_t len;
+	unsigned int hash;
+
+	if (radius->num_states == 0 ||
+	    radius_msg_get_attr_ptr(msg, RADIUS_ATTR_STATE, &state, &len,
+				    NULL) < 0)
+		return NULL;
+
+	hash = radius_client_state_hash(state, len);
+	dl_list_for_each(st, &radius->state_hash[hash],
+			 struct radius_client_state, hash_list) {
+		if (st->len == len && os_memcmp(st->state, state, len) == 0) {
+			serv = st->expires > now ? st->serv : NULL;
+			radius_client_state_free(radius, st);
+			return serv;
+		}
+	}
+
+	return NULL;
+}
+
+
+/* Store the server that sent an Access-Challenge with a State attribute */
+static void radius_client_state_add(struct radius_client_data *radius,
+				    struct radius_msg *msg,
+				    struct hostapd_radius_server *serv)
+{
+	struct radius_client_state *st;
+	struct os_reltime now;
+	u8 *state;
+	size_t len;
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_STATE, &state, &len,
+				    NULL) < 0)
+		return;
+
+	os_get_reltime(&now);
+	radius_client_expire_states(radius, now.sec);
+	st = os_malloc(sizeof(*st) + len);
+	if (!st)
+		return;
+	st->serv = serv;
+	st->expires = now.sec + RADIUS_CLIENT_STATE_LIFETIME;
+	st->len = len;
+	os_memcpy(st->state, state, len);
+	dl_list_add_tail(&radius->states, &st->list);
+	dl_list_add(&radius->state_hash[radius_client_state_hash(state, len)],
+		    &st->hash_list);
+	radius->num_states++;
+}
+
+
+static int radius_client_server_usable(struct hostapd_radius_server *serv,
+				       os_time_t now, int all)
+{
+	return serv->shared_secret && (all || serv->unavailable_until <= now);
+}
+
+
+/*
+ * Select the authentication server for a new request based on the configured
+ * load balancing policy. Servers that have recently failed to reply are used
+ * only if no other server is available.
+ */
+static struct hostapd_radius_server *
+radius_client_select_auth_server(struct radius_client_data *radius,
+				 os_time_t now)
+{
+	struct hostapd_radius_servers *conf = radius->conf;
+	struct hostapd_radius_server *serv, *best = NULL;
+	unsigned int i, num = conf->num_auth_servers, start;
+	int all, weight, total = 0;
+
+	/* Start from a different server each time so that ties are not always
+	 * resolved in favor of the first configured server. */
+	start = radius->next_auth_server++ % num;
+
+	for (all = 0; all < 2 && !best; all++) {
+		for (i = 0; i < num; i++) {
+			serv = &conf->auth_servers[(start + i) % num];
+			if (!radius_client_server_usable(serv, now, all))
+				continue;
+
+			switch (conf->auth_server_policy) {
+			case RADIUS_AUTH_SERVER_ROUND_ROBIN:
+				radius->next_auth_server = start + i + 1;
+				return serv;
+			case RADIUS_AUTH_SERVER_WEIGHTED:
+				/* Smooth weighted round-robin */
+				weight = serv->weight > 0 ? serv->weight : 1;
+				serv->current_weight += weight;
+				total += weight;
+				if (!best ||
+				    serv->current_weight > best->current_weight)
+					best = serv;
+				break;
+			default:
+				if (!best || serv->pending < best->pending ||
+				    (serv->pending == best->pending &&
+				     serv->smoothed_rtt < best->smoothed_rtt))
+					best = serv;
+				break;
+			}
+		}
+	}
+
+	if (!best)
+		return conf->auth_server;
+	if (conf->auth_server_policy == RADIUS_AUTH_SERVER_WEIGHTED)
+		best->current_weight -= total;
+	return best;
+}
+
+
+/*
+ * Mark the server of a message unavailable after it did not reply to the
+ * retransmissions of the message and move the message to another server if
+ * possible.
+ */
+static void radius_client_auth_server_failed(struct radius_client_data *radius,
+					     struct radius_msg_list *entry,
+					     os_time_t now)
+{
+	struct hostapd_radius_server *old = entry->serv, *next;
+	char abuf[50];
+	u8 *state;
+	size_t len;
+
+	if (old->unavailable_until <= now)
+		hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
+			       HOSTAPD_LEVEL_NOTICE,
+			       "No response from Authentication server %s:%d - do not use it for %d seconds",
+			       hostapd_ip_txt(&old->addr, abuf, sizeof(abuf)),
+			       old->port, RADIUS_CLIENT_UNAVAILABLE_TIME);
+	old->unavailable_until = now + RADIUS_CLIENT_UNAVAILABLE_TIME;
+
+	/* A message that continues an EAP session needs the session state from
+	 * the old server and the message authenticators depend on the shared
+	 * secret, so other servers cannot be used in those cases. */
+	if (radius_msg_get_attr_ptr(entry->msg, RADIUS_ATTR_STATE, &state, &len,
+				    NULL) == 0)
+		return;
+	next = radius_client_select_auth_server(radius, now);
+	if (next == old || next->unavailable_until > now ||
+	    next->shared_secret_len != old->shared_secret_len ||
+	    os_memcmp(next->shared_secret, old->shared_secret,
+		      old->shared_secret_len) != 0)
+		return;
+
+	hostapd_logger(radius->ctx, entry->addr, HOSTAPD_MODULE_RADIUS,
+		       HOSTAPD_LEVEL_DEBUG,
+		       "Moving pending RADIUS message (id=%d) to server %s:%d",
+		       radius_msg_get_hdr(entry->msg)->identifier,
+		       hostapd_ip_txt(&next->addr, abuf, sizeof(abuf)),
+		       next->port);
+	radius_client_msg_unbind(entry);
+	radius_client_msg_set_serv(entry, next);
+	entry->attempts = 0;
+}
+
+
+static int radius_client_retransmit(struct radius_client_data *radius,
+				    struct radius_msg_list *entry,
+				    os_time_t now)
+{
+	struct hostapd_radius_servers *conf = radius->conf;
+	int s;
+	struct wpabuf *buf;
+	size_t prev_num_msgs, num_socks;
+	u8 *acct_delay_time;
+	size_t acct_delay_time_len;
+	int num_servers, rebind;
+
+	if (entry->msg_type == RADIUS_ACCT ||
+	    entry->msg_type == RADIUS_ACCT_INTERIM) {
+		num_servers = conf->num_acct_servers;
+		if (radius->num_acct_socks == 0)
+			radius_client_init_acct(radius);
+		if (radius->num_acct_socks == 0 &&
+		    conf->num_acct_servers > 1) {
+			prev_num_msgs = radius->num_msgs;
+			radius_client_acct_failover(radius);
+			if (prev_num_msgs != radius->num_msgs)
+				return 0;
+		}
+		num_socks = radius->num_acct_socks;
+	} else {
+		num_servers = conf->num_auth_servers;
+		if (radius->num_auth_socks == 0)
+			radius_client_init_auth(radius);
+		if (radius_client_balanced(conf)) {
+			if (entry->attempts >= RADIUS_CLIENT_NUM_FAILOVER)
+				radius_client_auth_server_failed(radius, entry,
+								 now);
+		} else if (radius->num_auth_socks == 0 &&
+			   conf->num_auth_servers > 1) {
+			prev_num_msgs = radius->num_msgs;
+			radius_client_auth_failover(radius);
+			if (prev_num_msgs != radius->num_msgs)
+				return 0;
+		}
+		num_socks = radius->num_auth_socks;
+	}
+
+	if (entry->attempts == 0)
+		entry->serv->requests++;
+	else {
+		entry->serv->timeouts++;
+		entry->serv->retransmissions++;
+	}
+
+	if (entry->msg_type == RADIUS_ACCT_INTERIM) {
+		wpa_printf(MSG_DEBUG,
+			   "RADIUS: Failed to transmit interim accounting update to "
+			   MACSTR " - drop message and request a new update",
+			   MAC2STR(entry->addr));
+		if (radius->interim_error_cb)
+			radius->interim_error_cb(entry->addr,
+						 radius->interim_error_cb_ctx);
+		return 1;
+	}
+
+	if (num_socks == 0) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS: No valid socket for retransmission");
+		return 1;
+	}
+
+	if (entry->msg_type == RADIUS_ACCT &&
+	    radius_msg_get_attr_ptr(entry->msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+				    &acct_delay_time, &acct_delay_time_len,
+				    NULL) == 0 &&
 	    acct_delay_time_len == 4) {
 		struct radius_hdr *hdr;
 		u32 delay_time;
@@ -440,11 +1095,12 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 		 * Need to assign a new identifier since attribute contents
 		 * changes.
 		 */
+		radius_client_msg_unbind(entry);
 		hdr = radius_msg_get_hdr(entry->msg);
 		hdr->identifier = radius_client_get_id(radius);
 
 		/* Update Acct-Delay-Time to show wait time in queue */
-		delay_time = now - entry->first_try;
+		delay_time = entry->acct_delay_time + now - entry->first_try;
 		WPA_PUT_BE32(acct_delay_time, delay_time);
 
 		wpa_printf(MSG_DEBUG,
@@ -464,20 +1120,43 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 		return 1;
 	}
 
+	rebind = !entry->sock;
+	if (rebind && radius_client_msg_bind(radius, entry) < 0) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS: No valid socket for retransmission");
+		return 1;
+	}
+	s = entry->sock->s;
+
 	entry->attempts++;
 	entry->accu_attempts++;
+
+	if (entry->sock->tls && !rebind) {
+		/* RFC 6613, Section 2.6.3: A request is not retransmitted on
+		 * the same TCP connection. The timeout is only used for
+		 * failover and the message is sent again if the connection is
+		 * lost. */
+		hostapd_logger(radius->ctx, entry->addr, HOSTAPD_MODULE_RADIUS,
+			       HOSTAPD_LEVEL_DEBUG,
+			       "No response to RADIUS message (id=%d) over TLS",
+			       radius_msg_get_hdr(entry->msg)->identifier);
+		goto next_try;
+	}
+
 	hostapd_logger(radius->ctx, entry->addr, HOSTAPD_MODULE_RADIUS,
 		       HOSTAPD_LEVEL_DEBUG, "Resending RADIUS message (id=%d)",
 		       radius_msg_get_hdr(entry->msg)->identifier);
 
 	os_get_reltime(&entry->last_attempt);
 	buf = radius_msg_get_buf(entry->msg);
-	if (send(s, wpabuf_head(buf), wpabuf_len(buf), 0) < 0) {
+	if (radius_client_sock_send(entry->sock, buf) < 0) {
 		if (radius_client_handle_send_error(radius, s, entry->msg_type)
 		    > 0)
 			return 0;
 	}
 
+next_try:
+
 	entry->next_try = now + entry->next_wait;
 	entry->next_wait *= 2;
 	if (entry->next_wait > RADIUS_CLIENT_MAX_WAIT)
@@ -492,23 +1171,25 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 	struct radius_client_data *radius = eloop_ctx;
 	struct os_reltime now;
 	os_time_t first;
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *tmp;
 	int auth_failover = 0, acct_failover = 0;
-	size_t prev_num_msgs;
-	int s;
+	size_t prev_num_msgs, num_socks;
 
-	entry = radius->msgs;
-	if (!entry)
+	if (dl_list_empty(&radius->msgs))
 		return;
 
 	os_get_reltime(&now);
 
-	while (entry) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (now.sec >= entry->next_try) {
-			s = entry->msg_type == RADIUS_AUTH ? radius->auth_sock :
-				radius->acct_sock;
+			if (entry->msg_type == RADIUS_AUTH &&
+			    radius_client_balanced(radius->conf))
+				continue; /* handled per message */
+			num_socks = entry->msg_type == RADIUS_AUTH ?
+				radius->num_auth_socks :
+				radius->num_acct_socks;
 			if (entry->attempts >= RADIUS_CLIENT_NUM_FAILOVER ||
-			    (s < 0 && entry->attempts > 0)) {
+			    (num_socks == 0 && entry->attempts > 0)) {
 				if (entry->msg_type == RADIUS_ACCT ||
 				    entry->msg_type == RADIUS_ACCT_INTERIM)
 					acct_failover++;
@@ -516,7 +1197,6 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 					auth_failover++;
 			}
 		}
-		entry = entry->next;
 	}
 
 	if (auth_failover)
@@ -525,42 +1205,28 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 	if (acct_failover)
 		radius_client_acct_failover(radius);
 
-	entry = radius->msgs;
+restart:
 	first = 0;
-
-	prev = NULL;
-	while (entry) {
+	dl_list_for_each_safe(entry, tmp, &radius->msgs, struct radius_msg_list,
+			      list) {
 		prev_num_msgs = radius->num_msgs;
 		if (now.sec >= entry->next_try &&
 		    radius_client_retransmit(radius, entry, now.sec)) {
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
+			radius_client_msg_remove(radius, entry);
 			continue;
 		}
 
 		if (prev_num_msgs != radius->num_msgs) {
 			wpa_printf(MSG_DEBUG,
 				   "RADIUS: Message removed from queue - restart from beginning");
-			entry = radius->msgs;
-			prev = NULL;
-			continue;
+			goto restart;
 		}
 
 		if (first == 0 || entry->next_try < first)
 			first = entry->next_try;
-
-		prev = entry;
-		entry = entry->next;
 	}
 
-	if (radius->msgs) {
+	if (!dl_list_empty(&radius->msgs)) {
 		if (first < now.sec)
 			first = now.sec;
 		eloop_cancel_timeout(radius_client_timer, radius, NULL);
@@ -588,7 +1254,7 @@ static void radius_client_auth_failover(struct radius_client_data *radius)
 		       hostapd_ip_txt(&old->addr, abuf, sizeof(abuf)),
 		       old->port);
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_AUTH)
 			old->timeouts++;
 	}
@@ -597,9 +1263,7 @@ static void radius_client_auth_failover(struct radius_client_data *radius)
 	if (next > &(conf->auth_servers[conf->num_auth_servers - 1]))
 		next = conf->auth_servers;
 	conf->auth_server = next;
-	radius_change_server(radius, next, old,
-			     radius->auth_serv_sock,
-			     radius->auth_serv_sock6, 1);
+	radius_change_server(radius, next, old, 1);
 }
 
 
@@ -617,7 +1281,7 @@ static void radius_client_acct_failover(struct radius_client_data *radius)
 		       hostapd_ip_txt(&old->addr, abuf, sizeof(abuf)),
 		       old->port);
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_ACCT ||
 		    entry->msg_type == RADIUS_ACCT_INTERIM)
 			old->timeouts++;
@@ -627,33 +1291,26 @@ static void radius_client_acct_failover(struct radius_client_data *radius)
 	if (next > &conf->acct_servers[conf->num_acct_servers - 1])
 		next = conf->acct_servers;
 	conf->acct_server = next;
-	radius_change_server(radius, next, old,
-			     radius->acct_serv_sock,
-			     radius->acct_serv_sock6, 0);
+	radius_change_server(radius, next, old, 0);
 }
 
 
-static void radius_client_update_timeout(struct radius_client_data *radius)
+static void radius_client_update_timeout(struct radius_client_data *radius,
+					 struct radius_msg_list *entry)
 {
 	struct os_reltime now;
 	os_time_t first;
-	struct radius_msg_list *entry;
-
-	eloop_cancel_timeout(radius_client_timer, radius, NULL);
-
-	if (radius->msgs == NULL) {
-		return;
-	}
-
-	first = 0;
-	for (entry = radius->msgs; entry; entry = entry->next) {
-		if (first == 0 || entry->next_try < first)
-			first = entry->next_try;
-	}
 
+	/* The new entry cannot make the timeout later, so there is no need to
+	 * go through all the pending messages. */
 	os_get_reltime(&now);
+	first = entry->next_try;
 	if (first < now.sec)
 		first = now.sec;
+	if (eloop_deplete_timeout(first - now.sec, 0, radius_client_timer,
+				  radius, NULL) >= 0)
+		return;
+
 	eloop_register_timeout(first - now.sec, 0, radius_client_timer, radius,
 			       NULL);
 	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
@@ -662,26 +1319,30 @@ static void radius_client_update_timeout(struct radius_client_data *radius)
 }
 
 
-static void radius_client_list_add(struct radius_client_data *radius,
-				   struct radius_msg *msg,
-				   RadiusType msg_type,
-				   const u8 *shared_secret,
-				   size_t shared_secret_len, const u8 *addr)
+/*
+ * Returns the new retransmit list entry or %NULL if the message could not be
+ * added to the list. In the latter case, the caller is still responsible for
+ * freeing msg.
+ */
+static struct radius_msg_list *
+radius_client_list_add(struct radius_client_data *radius,
+		       struct radius_msg *msg, RadiusType msg_type,
+		       struct hostapd_radius_server *serv,
+		       const u8 *shared_secret, size_t shared_secret_len,
+		       const u8 *addr)
 {
-	struct radius_msg_list *entry, *prev;
+	struct radius_msg_list *entry;
 
 	if (eloop_terminated()) {
 		/* No point in adding entries to retransmit queue since event
 		 * loop has already been terminated. */
-		radius_msg_free(msg);
-		return;
+		return NULL;
 	}
 
 	entry = os_zalloc(sizeof(*entry));
 	if (entry == NULL) {
 		wpa_printf(MSG_INFO, "RADIUS: Failed to add packet into retransmit list");
-		radius_msg_free(msg);
-		return;
+		return NULL;
 	}
 
 	if (addr)
@@ -690,6 +1351,15 @@ static void radius_client_list_add(struct radius_client_data *radius,
 	entry->msg_type = msg_type;
 	entry->shared_secret = shared_secret;
 	entry->shared_secret_len = shared_secret_len;
+	entry->serv = serv;
+	if (msg_type != RADIUS_AUTH)
+		radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+					  &entry->acct_delay_time);
+	if (radius_client_msg_bind(radius, entry) < 0) {
+		os_free(entry);
+		return NULL;
+	}
+	serv->pending++;
 	os_get_reltime(&entry->last_attempt);
 	entry->first_try = entry->last_attempt.sec;
 	entry->next_try = entry->first_try + RADIUS_CLIENT_FIRST_WAIT;
@@ -698,23 +1368,11 @@ static void radius_client_list_add(struct radius_client_data *radius,
 	entry->next_wait = RADIUS_CLIENT_FIRST_WAIT * 2;
 	if (entry->next_wait > RADIUS_CLIENT_MAX_WAIT)
 		entry->next_wait = RADIUS_CLIENT_MAX_WAIT;
-	entry->next = radius->msgs;
-	radius->msgs = entry;
-	radius_client_update_timeout(radius);
-
-	if (radius->num_msgs >= RADIUS_CLIENT_MAX_ENTRIES) {
-		wpa_printf(MSG_INFO, "RADIUS: Removing the oldest un-ACKed packet due to retransmit list limits");
-		prev = NULL;
-		while (entry->next) {
-			prev = entry;
-			entry = entry->next;
-		}
-		if (prev) {
-			prev->next = NULL;
-			radius_client_msg_free(entry);
-		}
-	} else
-		radius->num_msgs++;
+	dl_list_add_tail(&radius->msgs, &entry->list);
+	radius->num_msgs++;
+	radius_client_update_timeout(radius, entry);
+
+	return entry;
 }
 
 
@@ -753,12 +1411,17 @@ int radius_client_send(struct radius_client_data *radius,
 	char *name;
 	int s, res;
 	struct wpabuf *buf;
+	struct radius_msg_list *entry;
+	struct radius_client_sock **socks, *sock = NULL;
+	struct hostapd_radius_server *serv;
+	struct os_reltime now;
+	size_t *num, i;
 
 	if (msg_type == RADIUS_ACCT || msg_type == RADIUS_ACCT_INTERIM) {
-		if (conf->acct_server && radius->acct_sock < 0)
+		if (conf->acct_server && radius->num_acct_socks == 0)
 			radius_client_init_acct(radius);
 
-		if (conf->acct_server == NULL || radius->acct_sock < 0 ||
+		if (conf->acct_server == NULL || radius->num_acct_socks == 0 ||
 		    conf->acct_server->shared_secret == NULL) {
 			hostapd_logger(radius->ctx, NULL,
 				       HOSTAPD_MODULE_RADIUS,
@@ -766,17 +1429,16 @@ int radius_client_send(struct radius_client_data *radius,
 				       "No accounting server configured");
 			return -1;
 		}
-		shared_secret = conf->acct_server->shared_secret;
-		shared_secret_len = conf->acct_server->shared_secret_len;
+		serv = conf->acct_server;
+		shared_secret = serv->shared_secret;
+		shared_secret_len = serv->shared_secret_len;
 		radius_msg_finish_acct(msg, shared_secret, shared_secret_len);
 		name = "accounting";
-		s = radius->acct_sock;
-		conf->acct_server->requests++;
 	} else {
-		if (conf->auth_server && radius->auth_sock < 0)
+		if (conf->auth_server && radius->num_auth_socks == 0)
 			radius_client_init_auth(radius);
 
-		if (conf->auth_server == NULL || radius->auth_sock < 0 ||
+		if (conf->auth_server == NULL || radius->num_auth_socks == 0 ||
 		    conf->auth_server->shared_secret == NULL) {
 			hostapd_logger(radius->ctx, NULL,
 				       HOSTAPD_MODULE_RADIUS,
@@ -784,13 +1446,20 @@ int radius_client_send(struct radius_client_data *radius,
 				       "No authentication server configured");
 			return -1;
 		}
-		shared_secret = conf->auth_server->shared_secret;
-		shared_secret_len = conf->auth_server->shared_secret_len;
+		serv = conf->auth_server;
+		if (radius_client_balanced(conf)) {
+			os_get_reltime(&now);
+			serv = radius_client_state_get(radius, msg, now.sec);
+			if (!serv)
+				serv = radius_client_select_auth_server(
+					radius, now.sec);
+		}
+		shared_secret = serv->shared_secret;
+		shared_secret_len = serv->shared_secret_len;
 		radius_msg_finish(msg, shared_secret, shared_secret_len);
 		name = "authentication";
-		s = radius->auth_sock;
-		conf->auth_server->requests++;
 	}
+	serv->requests++;
 
 	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
 		       HOSTAPD_LEVEL_DEBUG, "Sending RADIUS message to %s "
@@ -798,53 +1467,89 @@ int radius_client_send(struct radius_client_data *radius,
 	if (conf->msg_dumps)
 		radius_msg_dump(msg);
 
+	/* The socket is selected based on which ones have the RADIUS
+	 * Identifier of this message available. */
+	entry = radius_client_list_add(radius, msg, msg_type, serv,
+				       shared_secret, shared_secret_len, addr);
+	if (entry) {
+		sock = entry->sock;
+	} else {
+		socks = radius_client_socks(radius, msg_type == RADIUS_AUTH,
+					    &num);
+		for (i = 0; !sock && i < *num; i++) {
+			if (socks[i]->serv == serv)
+				sock = socks[i];
+		}
+		if (!sock) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS: No socket available for %s server",
+				   name);
+			return -1;
+		}
+	}
+	s = sock->s;
+
 	buf = radius_msg_get_buf(msg);
-	res = send(s, wpabuf_head(buf), wpabuf_len(buf), 0);
+	res = radius_client_sock_send(sock, buf);
 	if (res < 0)
 		radius_client_handle_send_error(radius, s, msg_type);
 
-	radius_client_list_add(radius, msg, msg_type, shared_secret,
-			       shared_secret_len, addr);
+	if (!entry) {
+		/* Sent only once, so the message may never be acknowledged */
+		if (msg_type == RADIUS_ACCT && radius->acct_drop_cb)
+			radius->acct_drop_cb(msg, radius->acct_drop_cb_ctx);
+		radius_msg_free(msg);
+	}
 
 	return 0;
 }
 
 
-static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
+/*
+ * Update the server round trip time and availability once a handler has
+ * validated the Response Authenticator, so that spoofed responses with a
+ * matching Identifier cannot affect the server selection.
+ */
+static void radius_client_rx_valid(struct hostapd_radius_server *rconf,
+				   int roundtrip)
+{
+	rconf->round_trip_time = roundtrip;
+	if (rconf->smoothed_rtt)
+		rconf->smoothed_rtt += (roundtrip - rconf->smoothed_rtt) / 8;
+	else
+		rconf->smoothed_rtt = roundtrip;
+	rconf->unavailable_until = 0;
+}
+
+
+static void radius_client_receive_msg(struct radius_client_data *radius,
+				      struct radius_client_sock *sock,
+				      const u8 *buf, size_t len)
 {
-	struct radius_client_data *radius = eloop_ctx;
 	struct hostapd_radius_servers *conf = radius->conf;
-	RadiusType msg_type = (RadiusType) sock_ctx;
-	int len, roundtrip;
-	unsigned char buf[3000];
+	RadiusType msg_type = sock->auth ? RADIUS_AUTH : RADIUS_ACCT;
+	int roundtrip;
 	struct radius_msg *msg;
 	struct radius_hdr *hdr;
 	struct radius_rx_handler *handlers;
 	size_t num_handlers, i;
-	struct radius_msg_list *req, *prev_req;
+	struct radius_msg_list *req;
 	struct os_reltime now;
-	struct hostapd_radius_server *rconf;
-	int invalid_authenticator = 0;
+	struct hostapd_radius_server *rconf = sock->serv;
+	int invalid_authenticator = 0, state_added;
 
 	if (msg_type == RADIUS_ACCT) {
 		handlers = radius->acct_handlers;
 		num_handlers = radius->num_acct_handlers;
-		rconf = conf->acct_server;
 	} else {
 		handlers = radius->auth_handlers;
 		num_handlers = radius->num_auth_handlers;
-		rconf = conf->auth_server;
 	}
 
-	len = recv(sock, buf, sizeof(buf), MSG_DONTWAIT);
-	if (len < 0) {
-		wpa_printf(MSG_INFO, "recv[RADIUS]: %s", strerror(errno));
-		return;
-	}
 	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
 		       HOSTAPD_LEVEL_DEBUG, "Received %d bytes from RADIUS "
-		       "server", len);
-	if (len == sizeof(buf)) {
+		       "server", (int) len);
+	if (!sock->tls && len == RADIUS_CLIENT_MAX_RX_LEN) {
 		wpa_printf(MSG_INFO, "RADIUS: Possibly too long UDP frame for our buffer - dropping it");
 		return;
 	}
@@ -877,22 +1582,7 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		break;
 	}
 
-	prev_req = NULL;
-	req = radius->msgs;
-	while (req) {
-		/* TODO: also match by src addr:port of the packet when using
-		 * alternative RADIUS servers (?) */
-		if ((req->msg_type == msg_type ||
-		     (req->msg_type == RADIUS_ACCT_INTERIM &&
-		      msg_type == RADIUS_ACCT)) &&
-		    radius_msg_get_hdr(req->msg)->identifier ==
-		    hdr->identifier)
-			break;
-
-		prev_req = req;
-		req = req->next;
-	}
-
+	req = sock->pending[hdr->identifier];
 	if (req == NULL) {
 		hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
 			       HOSTAPD_LEVEL_DEBUG,
@@ -910,20 +1600,25 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		       "Received RADIUS packet matched with a pending "
 		       "request, round trip time %d.%02d sec",
 		       roundtrip / 100, roundtrip % 100);
-	rconf->round_trip_time = roundtrip;
+
+	/* The State mapping is added before calling the handlers so that a
+	 * request sent from a handler uses the same server. It is removed
+	 * again if no handler accepts the response. */
+	state_added = hdr->code == RADIUS_CODE_ACCESS_CHALLENGE &&
+		radius_client_balanced(conf);
+	if (state_added)
+		radius_client_state_add(radius, msg, rconf);
 
 	/* Remove ACKed RADIUS packet from retransmit list */
-	if (prev_req)
-		prev_req->next = req->next;
-	else
-		radius->msgs = req->next;
-	radius->num_msgs--;
+	radius_client_msg_unlink(radius, req);
 
 	for (i = 0; i < num_handlers; i++) {
 		RadiusRxResult res;
 		res = handlers[i].handler(msg, req->msg, req->shared_secret,
 					  req->shared_secret_len,
 					  handlers[i].data);
+		if (res == RADIUS_RX_PROCESSED || res == RADIUS_RX_QUEUED)
+			radius_client_rx_valid(rconf, roundtrip);
 		switch (res) {
 		case RADIUS_RX_PROCESSED:
 			radius_msg_free(msg);
@@ -950,110 +1645,537 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		       msg_type, hdr->code, hdr->identifier,
 		       invalid_authenticator ? " [INVALID AUTHENTICATOR]" :
 		       "");
-	radius_client_msg_free(req);
+	if (state_added)
+		radius_client_state_get(radius, msg, now.sec);
+	radius_client_msg_drop(radius, req);
 
  fail:
 	radius_msg_free(msg);
 }
 
 
+static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx,
+				  struct eloop_datagram_batch *batch)
+{
+	struct radius_client_data *radius = eloop_ctx;
+	size_t i;
+
+	/* The socket may get closed from the RX handlers, so batch->num needs
+	 * to be checked on each iteration. */
+	for (i = 0; i < batch->num; i++)
+		radius_client_receive_msg(radius, sock_ctx,
+					  batch->msgs[i].buf,
+					  batch->msgs[i].len);
+}
+
+
 /**
  * radius_client_get_id - Get an identifier for a new RADIUS message
  * @radius: RADIUS client context from radius_client_init()
  * Returns: Allocated identifier
  *
- * This function is used to fetch a unique (among pending requests) identifier
- * for a new RADIUS message.
+ * This function is used to fetch an identifier for a new RADIUS message. The
+ * same identifier may be in use for another pending request, but
+ * radius_client_send() sends the message on a socket (i.e., from a source
+ * port) where the identifier is unique among the pending requests.
  */
 u8 radius_client_get_id(struct radius_client_data *radius)
 {
-	struct radius_msg_list *entry, *prev, *_remove;
-	u8 id = radius->next_radius_identifier++;
-
-	/* remove entries with matching id from retransmit list to avoid
-	 * using new reply from the RADIUS server with an old request */
-	entry = radius->msgs;
-	prev = NULL;
-	while (entry) {
-		if (radius_msg_get_hdr(entry->msg)->identifier == id) {
-			hostapd_logger(radius->ctx, entry->addr,
-				       HOSTAPD_MODULE_RADIUS,
-				       HOSTAPD_LEVEL_DEBUG,
-				       "Removing pending RADIUS message, "
-				       "since its id (%d) is reused", id);
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-			_remove = entry;
-		} else {
-			_remove = NULL;
-			prev = entry;
+	return radius->next_radius_identifier++;
+}
+
+
+/**
+ * radius_client_flush - Flush all pending RADIUS client messages
+ * @radius: RADIUS client context from radius_client_init()
+ * @only_auth: Whether only authentication messages are removed
+ */
+void radius_client_flush(struct radius_client_data *radius, int only_auth)
+{
+	struct radius_msg_list *entry, *tmp;
+
+	if (!radius)
+		return;
+
+	dl_list_for_each_safe(entry, tmp, &radius->msgs,
+			      struct radius_msg_list, list) {
+		if (!only_auth || entry->msg_type == RADIUS_AUTH)
+			radius_client_msg_remove(radius, entry);
+	}
+
+	if (dl_list_empty(&radius->msgs))
+		eloop_cancel_timeout(radius_client_timer, radius, NULL);
+}
+
+
+static void radius_client_update_acct_msgs(struct radius_client_data *radius,
+					   const u8 *shared_secret,
+					   size_t shared_secret_len)
+{
+	struct radius_msg_list *entry;
+
+	if (!radius)
+		return;
+
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
+		if (entry->msg_type == RADIUS_ACCT) {
+			entry->shared_secret = shared_secret;
+			entry->shared_secret_len = shared_secret_len;
+			radius_msg_finish_acct(entry->msg, shared_secret,
+					       shared_secret_len);
+		}
+	}
+}
+
+
+static int radius_client_connect(struct radius_client_data *radius,
+				 struct radius_client_sock *sock,
+				 struct hostapd_radius_server *nserv)
+{
+	struct sockaddr_in serv, claddr;
+#ifdef CONFIG_IPV6
+	struct sockaddr_in6 serv6, claddr6;
+	char abuf[50];
+#endif /* CONFIG_IPV6 */
+	struct sockaddr *addr;
+	socklen_t addrlen, claddrlen;
+	struct sockaddr_in disconnect_addr = {
+		.sin_family = AF_UNSPEC,
+	};
+
+	switch (nserv->addr.af) {
+	case AF_INET:
+		os_memset(&serv, 0, sizeof(serv));
+		serv.sin_family = AF_INET;
+		serv.sin_addr.s_addr = nserv->addr.u.v4.s_addr;
+		serv.sin_port = htons(nserv->port);
+		addr = (struct sockaddr *) &serv;
+		addrlen = sizeof(serv);
+		break;
+#ifdef CONFIG_IPV6
+	case AF_INET6:
+		os_memset(&serv6, 0, sizeof(serv6));
+		serv6.sin6_family = AF_INET6;
+		os_memcpy(&serv6.sin6_addr, &nserv->addr.u.v6,
+			  sizeof(struct in6_addr));
+		serv6.sin6_port = htons(nserv->port);
+		addr = (struct sockaddr *) &serv6;
+		addrlen = sizeof(serv6);
+		break;
+#endif /* CONFIG_IPV6 */
+	default:
+		return -1;
+	}
+
+	/* Force a reconnect by disconnecting the socket first */
+	if (!nserv->tls &&
+	    connect(sock->s, (struct sockaddr *) &disconnect_addr,
+		    sizeof(disconnect_addr)) < 0)
+		wpa_printf(MSG_INFO, "disconnect[radius]: %s", strerror(errno));
+
+	/* TCP connections for RADIUS/TLS are completed asynchronously */
+	if (connect(sock->s, addr, addrlen) < 0 &&
+	    (!nserv->tls || errno != EINPROGRESS)) {
+		wpa_printf(MSG_INFO, "connect[radius]: %s", strerror(errno));
+		return -1;
+	}
+
+#ifndef CONFIG_NATIVE_WINDOWS
+	switch (nserv->addr.af) {
+	case AF_INET:
+		claddrlen = sizeof(claddr);
+		if (getsockname(sock->s, (struct sockaddr *) &claddr,
+				&claddrlen) == 0) {
+			wpa_printf(MSG_DEBUG, "RADIUS local address: %s:%u",
+				   inet_ntoa(claddr.sin_addr),
+				   ntohs(claddr.sin_port));
+		}
+		break;
+#ifdef CONFIG_IPV6
+	case AF_INET6: {
+		claddrlen = sizeof(claddr6);
+		if (getsockname(sock->s, (struct sockaddr *) &claddr6,
+				&claddrlen) == 0) {
+			wpa_printf(MSG_DEBUG, "RADIUS local address: %s:%u",
+				   inet_ntop(AF_INET6, &claddr6.sin6_addr,
+					     abuf, sizeof(abuf)),
+				   ntohs(claddr6.sin6_port));
 		}
-		entry = entry->next;
+		break;
+	}
+#endif /* CONFIG_IPV6 */
+	}
+#endif /* CONFIG_NATIVE_WINDOWS */
+
+	return 0;
+}
+
+
+static int radius_client_disable_pmtu_discovery(int s)
+{
+	int r = -1;
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_DONT)
+	/* Turn off Path MTU discovery on IPv4/UDP sockets. */
+	int action = IP_PMTUDISC_DONT;
+	r = setsockopt(s, IPPROTO_IP, IP_MTU_DISCOVER, &action,
+		       sizeof(action));
+	if (r == -1)
+		wpa_printf(MSG_ERROR, "RADIUS: Failed to set IP_MTU_DISCOVER: %s",
+			   strerror(errno));
+#endif
+	return r;
+}
+
+
+static int radius_client_bind(struct radius_client_data *radius, int s)
+{
+	struct hostapd_radius_servers *conf = radius->conf;
+	struct sockaddr_in claddr;
+#ifdef CONFIG_IPV6
+	struct sockaddr_in6 claddr6;
+#endif /* CONFIG_IPV6 */
+	struct sockaddr *cl_addr;
+	socklen_t claddrlen;
+
+	switch (conf->client_addr.af) {
+	case AF_INET:
+		os_memset(&claddr, 0, sizeof(claddr));
+		claddr.sin_family = AF_INET;
+		claddr.sin_addr.s_addr = conf->client_addr.u.v4.s_addr;
+		claddr.sin_port = htons(0);
+		cl_addr = (struct sockaddr *) &claddr;
+		claddrlen = sizeof(claddr);
+		break;
+#ifdef CONFIG_IPV6
+	case AF_INET6:
+		os_memset(&claddr6, 0, sizeof(claddr6));
+		claddr6.sin6_family = AF_INET6;
+		os_memcpy(&claddr6.sin6_addr, &conf->client_addr.u.v6,
+			  sizeof(struct in6_addr));
+		claddr6.sin6_port = htons(0);
+		cl_addr = (struct sockaddr *) &claddr6;
+		claddrlen = sizeof(claddr6);
+		break;
+#endif /* CONFIG_IPV6 */
+	default:
+		return -1;
+	}
+
+	if (bind(s, cl_addr, claddrlen) < 0) {
+		wpa_printf(MSG_INFO, "bind[radius]: %s", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static void radius_client_close_sock(struct radius_client_sock *sock)
+{
+	unsigned int i;
+
+	/* Pending messages are assigned to another socket when they are
+	 * retransmitted. */
+	for (i = 0; sock->num_pending > 0 && i < ARRAY_SIZE(sock->pending);
+	     i++) {
+		if (sock->pending[i])
+			radius_client_msg_unbind(sock->pending[i]);
+	}
+
+#ifdef CONFIG_RADIUS_TLS
+	if (sock->tls) {
+		radius_tls_conn_deinit(sock->tls);
+		os_free(sock);
+		return;
+	}
+#endif /* CONFIG_RADIUS_TLS */
+
+	eloop_unregister_read_sock(sock->s);
+	close(sock->s);
+	os_free(sock);
+}
+
+
+static void radius_close_socks(struct radius_client_data *radius, int auth)
+{
+	struct radius_client_sock **socks;
+	size_t *num;
+
+	socks = radius_client_socks(radius, auth, &num);
+	while (*num > 0) {
+		(*num)--;
+		radius_client_close_sock(socks[*num]);
+		socks[*num] = NULL;
+	}
+}
+
+
+#ifdef CONFIG_RADIUS_TLS
+
+/* Check whether a socket has not been closed without dereferencing it */
+static int radius_client_sock_valid(struct radius_client_data *radius,
+				    struct radius_client_sock *sock)
+{
+	size_t i;
+
+	for (i = 0; i < radius->num_auth_socks; i++) {
+		if (radius->auth_socks[i] == sock)
+			return 1;
+	}
+	for (i = 0; i < radius->num_acct_socks; i++) {
+		if (radius->acct_socks[i] == sock)
+			return 1;
+	}
+	return 0;
+}
+
+
+static int radius_client_tls_msg(void *ctx, const u8 *buf, size_t len)
+{
+	struct radius_client_sock *sock = ctx;
+	struct radius_client_data *radius = sock->radius;
+
+	radius_client_receive_msg(radius, sock, buf, len);
+
+	/* The socket may get closed from the RX handlers */
+	return !radius_client_sock_valid(radius, sock);
+}
+
+
+static void radius_client_tls_closed(void *ctx)
+{
+	struct radius_client_sock *sock = ctx;
+	struct radius_client_data *radius = sock->radius;
+	struct radius_client_sock **socks;
+	struct os_reltime now;
+	size_t *num, i;
+	char abuf[50];
+	int resend;
+
+	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
+		       HOSTAPD_LEVEL_INFO,
+		       "RADIUS/TLS connection to %s:%d closed",
+		       hostapd_ip_txt(&sock->serv->addr, abuf, sizeof(abuf)),
+		       sock->serv->port);
+
+	/* Pending messages from a connection that was working are sent again
+	 * immediately over a new connection. If the connection could not be
+	 * established, the normal retransmission timeouts are used to avoid
+	 * reconnecting continuously. */
+	resend = sock->num_pending && radius_tls_conn_established(sock->tls);
+	if (resend) {
+		os_get_reltime(&now);
+		for (i = 0; i < ARRAY_SIZE(sock->pending); i++) {
+			if (sock->pending[i])
+				sock->pending[i]->next_try = now.sec;
+		}
+	}
+
+	socks = radius_client_socks(radius, sock->auth, &num);
+	for (i = 0; i < *num; i++) {
+		if (socks[i] == sock) {
+			socks[i] = socks[--(*num)];
+			socks[*num] = NULL;
+			break;
+		}
+	}
+
+	if (resend) {
+		/* Open the replacement connection right away so that the lost
+		 * connection is not handled as a server timeout. */
+		if (*num == 0)
+			radius_client_open_sock(radius, sock->serv, sock->auth);
+		eloop_cancel_timeout(radius_client_timer, radius, NULL);
+		eloop_register_timeout(0, 0, radius_client_timer, radius, NULL);
+	}
+
+	radius_client_close_sock(sock);
+}
+
+
+static int radius_client_open_tls(struct radius_client_data *radius,
+				  struct radius_client_sock *sock)
+{
+	struct hostapd_radius_server *serv = sock->serv;
+	struct tls_connection_params params;
+	struct tls_config tconf;
+
+	if (!radius->tls_ctx) {
+		os_memset(&tconf, 0, sizeof(tconf));
+		radius->tls_ctx = tls_init(&tconf);
+		if (!radius->tls_ctx) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS: Failed to initialize TLS");
+			return -1;
+		}
+	}
+
+	/* The shared secret is well known, so the server has to be
+	 * authenticated */
+	if (!serv->ca_cert) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS: No CA certificate configured for RADIUS/TLS server");
+		return -1;
+	}
+
+	if (fcntl(sock->s, F_SETFL, O_NONBLOCK) < 0) {
+		wpa_printf(MSG_INFO, "RADIUS: fcntl(O_NONBLOCK): %s",
+			   strerror(errno));
+		return -1;
+	}
+
+	if (radius_client_connect(radius, sock, serv) < 0)
+		return -1;
 
-		if (_remove)
-			radius_client_msg_free(_remove);
-	}
+	os_memset(&params, 0, sizeof(params));
+	params.ca_cert = serv->ca_cert;
+	params.client_cert = serv->client_cert;
+	params.private_key = serv->private_key;
+	params.private_key_passwd = serv->private_key_passwd;
+	params.domain_match = serv->domain_match;
+	params.flags = serv->tls_flags;
+	sock->tls = radius_tls_client_init(radius->tls_ctx, sock->s, &params,
+					   radius_client_tls_msg,
+					   radius_client_tls_closed, sock);
+	if (!sock->tls)
+		return -1;
 
-	return id;
+	return 0;
 }
 
+#endif /* CONFIG_RADIUS_TLS */
 
-/**
- * radius_client_flush - Flush all pending RADIUS client messages
- * @radius: RADIUS client context from radius_client_init()
- * @only_auth: Whether only authentication messages are removed
- */
-void radius_client_flush(struct radius_client_data *radius, int only_auth)
+
+static void radius_close_auth_sockets(struct radius_client_data *radius)
 {
-	struct radius_msg_list *entry, *prev, *tmp;
+	radius_close_socks(radius, 1);
+}
+
+
+static void radius_close_acct_sockets(struct radius_client_data *radius)
+{
+	radius_close_socks(radius, 0);
+}
 
-	if (!radius)
-		return;
 
-	prev = NULL;
-	entry = radius->msgs;
+/* Open a new socket for the address family of the server */
+static struct radius_client_sock *
+radius_client_open_sock(struct radius_client_data *radius,
+			struct hostapd_radius_server *nserv, int auth)
+{
+	struct radius_client_sock **socks, *sock;
+	size_t *num;
 
-	while (entry) {
-		if (!only_auth || entry->msg_type == RADIUS_AUTH) {
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
+	socks = radius_client_socks(radius, auth, &num);
+	if (*num >= RADIUS_CLIENT_MAX_SOCKETS)
+		return NULL;
 
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-		} else {
-			prev = entry;
-			entry = entry->next;
+	sock = os_zalloc(sizeof(*sock));
+	if (!sock)
+		return NULL;
+	sock->radius = radius;
+	sock->serv = nserv;
+	sock->auth = auth;
+
+	switch (nserv->addr.af) {
+	case AF_INET:
+		sock->s = socket(PF_INET, nserv->tls ? SOCK_STREAM : SOCK_DGRAM,
+				 0);
+		if (sock->s < 0) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS: socket[PF_INET,%s]: %s",
+				   nserv->tls ? "SOCK_STREAM" : "SOCK_DGRAM",
+				   strerror(errno));
+			break;
 		}
+		if (!nserv->tls)
+			radius_client_disable_pmtu_discovery(sock->s);
+		break;
+#ifdef CONFIG_IPV6
+	case AF_INET6:
+		sock->s = socket(PF_INET6,
+				 nserv->tls ? SOCK_STREAM : SOCK_DGRAM, 0);
+		if (sock->s < 0)
+			wpa_printf(MSG_INFO,
+				   "RADIUS: socket[PF_INET6,%s]: %s",
+				   nserv->tls ? "SOCK_STREAM" : "SOCK_DGRAM",
+				   strerror(errno));
+		break;
+#endif /* CONFIG_IPV6 */
+	default:
+		wpa_printf(MSG_INFO,
+			   "RADIUS: No server socket available (af=%d auth=%d)",
+			   nserv->addr.af, auth);
+		sock->s = -1;
+		break;
+	}
+	if (sock->s < 0) {
+		os_free(sock);
+		return NULL;
 	}
 
-	if (radius->msgs == NULL)
-		eloop_cancel_timeout(radius_client_timer, radius, NULL);
+	if (radius->conf->force_client_addr &&
+	    radius_client_bind(radius, sock->s) < 0)
+		goto fail;
+
+	if (nserv->tls) {
+#ifdef CONFIG_RADIUS_TLS
+		if (radius_client_open_tls(radius, sock) < 0)
+			goto fail;
+#else /* CONFIG_RADIUS_TLS */
+		wpa_printf(MSG_INFO, "RADIUS: RADIUS/TLS not supported");
+		goto fail;
+#endif /* CONFIG_RADIUS_TLS */
+	} else if (eloop_register_read_sock_batch(sock->s,
+						  RADIUS_CLIENT_RX_BATCH,
+						  RADIUS_CLIENT_MAX_RX_LEN,
+						  radius_client_receive,
+						  radius, sock)) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS: Could not register read socket for %s server",
+			   auth ? "authentication" : "accounting");
+		goto fail;
+	}
+
+	socks[(*num)++] = sock;
+	return sock;
+
+fail:
+	close(sock->s);
+	os_free(sock);
+	return NULL;
 }
 
 
-static void radius_client_update_acct_msgs(struct radius_client_data *radius,
-					   const u8 *shared_secret,
-					   size_t shared_secret_len)
+/*
+ * Open an additional socket for a server once all the RADIUS Identifier
+ * values are in use on the existing sockets for it.
+ */
+static struct radius_client_sock *
+radius_client_add_sock(struct radius_client_data *radius, int auth,
+		       struct hostapd_radius_server *nserv)
 {
-	struct radius_msg_list *entry;
+	struct radius_client_sock **socks, *sock;
+	size_t *num;
 
-	if (!radius)
-		return;
+	socks = radius_client_socks(radius, auth, &num);
+	if (!nserv || *num == 0)
+		return NULL;
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
-		if (entry->msg_type == RADIUS_ACCT) {
-			entry->shared_secret = shared_secret;
-			entry->shared_secret_len = shared_secret_len;
-			radius_msg_finish_acct(entry->msg, shared_secret,
-					       shared_secret_len);
-		}
+	sock = radius_client_open_sock(radius, nserv, auth);
+	if (!sock)
+		return NULL;
+	if (!nserv->tls && radius_client_connect(radius, sock, nserv) < 0) {
+		(*num)--;
+		socks[*num] = NULL;
+		radius_client_close_sock(sock);
+		return NULL;
 	}
+
+	wpa_printf(MSG_DEBUG, "RADIUS: Opened %s socket %u/%u",
+		   auth ? "authentication" : "accounting",
+		   (unsigned int) *num, RADIUS_CLIENT_MAX_SOCKETS);
+	return sock;
 }
 
 
@@ -1061,21 +2183,12 @@ static int
 radius_change_server(struct radius_client_data *radius,
 		     struct hostapd_radius_server *nserv,
 		     struct hostapd_radius_server *oserv,
-		     int sock, int sock6, int auth)
+		     int auth)
 {
-	struct sockaddr_in serv, claddr;
-#ifdef CONFIG_IPV6
-	struct sockaddr_in6 serv6, claddr6;
-#endif /* CONFIG_IPV6 */
-	struct sockaddr *addr, *cl_addr;
-	socklen_t addrlen, claddrlen;
 	char abuf[50];
-	int sel_sock;
 	struct radius_msg_list *entry;
-	struct hostapd_radius_servers *conf = radius->conf;
-	struct sockaddr_in disconnect_addr = {
-		.sin_family = AF_UNSPEC,
-	};
+	struct radius_client_sock **socks;
+	size_t *num, i;
 
 	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
 		       HOSTAPD_LEVEL_INFO,
@@ -1111,127 +2224,46 @@ radius_change_server(struct radius_client_data *radius,
 	}
 
 	/* Reset retry counters */
-	for (entry = radius->msgs; oserv && entry; entry = entry->next) {
-		if ((auth && entry->msg_type != RADIUS_AUTH) ||
-		    (!auth && entry->msg_type != RADIUS_ACCT))
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
+		if (!oserv)
+			break;
+		if ((entry->msg_type == RADIUS_AUTH) != !!auth)
+			continue;
+		radius_client_msg_set_serv(entry, nserv);
+		if (entry->msg_type == RADIUS_ACCT_INTERIM)
 			continue;
 		entry->next_try = entry->first_try + RADIUS_CLIENT_FIRST_WAIT;
 		entry->attempts = 0;
 		entry->next_wait = RADIUS_CLIENT_FIRST_WAIT * 2;
 	}
 
-	if (radius->msgs) {
+	if (!dl_list_empty(&radius->msgs)) {
 		eloop_cancel_timeout(radius_client_timer, radius, NULL);
 		eloop_register_timeout(RADIUS_CLIENT_FIRST_WAIT, 0,
 				       radius_client_timer, radius, NULL);
 	}
 
-	switch (nserv->addr.af) {
-	case AF_INET:
-		os_memset(&serv, 0, sizeof(serv));
-		serv.sin_family = AF_INET;
-		serv.sin_addr.s_addr = nserv->addr.u.v4.s_addr;
-		serv.sin_port = htons(nserv->port);
-		addr = (struct sockaddr *) &serv;
-		addrlen = sizeof(serv);
-		sel_sock = sock;
-		break;
-#ifdef CONFIG_IPV6
-	case AF_INET6:
-		os_memset(&serv6, 0, sizeof(serv6));
-		serv6.sin6_family = AF_INET6;
-		os_memcpy(&serv6.sin6_addr, &nserv->addr.u.v6,
-			  sizeof(struct in6_addr));
-		serv6.sin6_port = htons(nserv->port);
-		addr = (struct sockaddr *) &serv6;
-		addrlen = sizeof(serv6);
-		sel_sock = sock6;
-		break;
-#endif /* CONFIG_IPV6 */
-	default:
-		return -1;
-	}
-
-	if (sel_sock < 0) {
-		wpa_printf(MSG_INFO,
-			   "RADIUS: No server socket available (af=%d sock=%d sock6=%d auth=%d",
-			   nserv->addr.af, sock, sock6, auth);
-		return -1;
-	}
-
-	if (conf->force_client_addr) {
-		switch (conf->client_addr.af) {
-		case AF_INET:
-			os_memset(&claddr, 0, sizeof(claddr));
-			claddr.sin_family = AF_INET;
-			claddr.sin_addr.s_addr = conf->client_addr.u.v4.s_addr;
-			claddr.sin_port = htons(0);
-			cl_addr = (struct sockaddr *) &claddr;
-			claddrlen = sizeof(claddr);
-			break;
-#ifdef CONFIG_IPV6
-		case AF_INET6:
-			os_memset(&claddr6, 0, sizeof(claddr6));
-			claddr6.sin6_family = AF_INET6;
-			os_memcpy(&claddr6.sin6_addr, &conf->client_addr.u.v6,
-				  sizeof(struct in6_addr));
-			claddr6.sin6_port = htons(0);
-			cl_addr = (struct sockaddr *) &claddr6;
-			claddrlen = sizeof(claddr6);
-			break;
-#endif /* CONFIG_IPV6 */
-		default:
-			return -1;
-		}
-
-		if (bind(sel_sock, cl_addr, claddrlen) < 0) {
-			wpa_printf(MSG_INFO, "bind[radius]: %s",
-				   strerror(errno));
+	/* The existing UDP sockets can be reconnected to the new server if it
+	 * uses the same address family. Otherwise, start over with a new
+	 * socket. */
+	socks = radius_client_socks(radius, auth, &num);
+	if (*num == 0 ||
+	    (oserv && (oserv->addr.af != nserv->addr.af || oserv->tls ||
+		       nserv->tls))) {
+		radius_close_socks(radius, auth);
+		if (!radius_client_open_sock(radius, nserv, auth))
 			return -1;
-		}
-	}
-
-	/* Force a reconnect by disconnecting the socket first */
-	if (connect(sel_sock, (struct sockaddr *) &disconnect_addr,
-		    sizeof(disconnect_addr)) < 0)
-		wpa_printf(MSG_INFO, "disconnect[radius]: %s", strerror(errno));
-
-	if (connect(sel_sock, addr, addrlen) < 0) {
-		wpa_printf(MSG_INFO, "connect[radius]: %s", strerror(errno));
-		return -1;
 	}
 
-#ifndef CONFIG_NATIVE_WINDOWS
-	switch (nserv->addr.af) {
-	case AF_INET:
-		claddrlen = sizeof(claddr);
-		if (getsockname(sel_sock, (struct sockaddr *) &claddr,
-				&claddrlen) == 0) {
-			wpa_printf(MSG_DEBUG, "RADIUS local address: %s:%u",
-				   inet_ntoa(claddr.sin_addr),
-				   ntohs(claddr.sin_port));
-		}
-		break;
-#ifdef CONFIG_IPV6
-	case AF_INET6: {
-		claddrlen = sizeof(claddr6);
-		if (getsockname(sel_sock, (struct sockaddr *) &claddr6,
-				&claddrlen) == 0) {
-			wpa_printf(MSG_DEBUG, "RADIUS local address: %s:%u",
-				   inet_ntop(AF_INET6, &claddr6.sin6_addr,
-					     abuf, sizeof(abuf)),
-				   ntohs(claddr6.sin6_port));
+	for (i = 0; i < *num; i++) {
+		socks[i]->serv = nserv;
+		if (socks[i]->tls)
+			continue; /* connected when opened */
+		if (radius_client_connect(radius, socks[i], nserv) < 0) {
+			radius_close_socks(radius, auth);
+			return -1;
 		}
-		break;
-	}
-#endif /* CONFIG_IPV6 */
 	}
-#endif /* CONFIG_NATIVE_WINDOWS */
-
-	if (auth)
-		radius->auth_sock = sel_sock;
-	else
-		radius->acct_sock = sel_sock;
 
 	return 0;
 }
@@ -1243,31 +2275,28 @@ static void radius_retry_primary_timer(void *eloop_ctx, void *timeout_ctx)
 	struct hostapd_radius_servers *conf = radius->conf;
 	struct hostapd_radius_server *oserv;
 
-	if (radius->auth_sock >= 0 && conf->auth_servers &&
-	    conf->auth_server != conf->auth_servers) {
+	if (radius->num_auth_socks && conf->auth_servers &&
+	    conf->auth_server != conf->auth_servers &&
+	    !radius_client_balanced(conf)) {
 		oserv = conf->auth_server;
 		conf->auth_server = conf->auth_servers;
 		if (radius_change_server(radius, conf->auth_server, oserv,
-					 radius->auth_serv_sock,
-					 radius->auth_serv_sock6, 1) < 0) {
+					 1) < 0) {
 			conf->auth_server = oserv;
 			radius_change_server(radius, oserv, conf->auth_server,
-					     radius->auth_serv_sock,
-					     radius->auth_serv_sock6, 1);
+					     1);
 		}
 	}
 
-	if (radius->acct_sock >= 0 && conf->acct_servers &&
+	if (radius->num_acct_socks && conf->acct_servers &&
 	    conf->acct_server != conf->acct_servers) {
 		oserv = conf->acct_server;
 		conf->acct_server = conf->acct_servers;
 		if (radius_change_server(radius, conf->acct_server, oserv,
-					 radius->acct_serv_sock,
-					 radius->acct_serv_sock6, 0) < 0) {
+					 0) < 0) {
 			conf->acct_server = oserv;
 			radius_change_server(radius, oserv, conf->acct_server,
-					     radius->acct_serv_sock,
-					     radius->acct_serv_sock6, 0);
+					     0);
 		}
 	}
 
@@ -1278,111 +2307,16 @@ static void radius_retry_primary_timer(void *eloop_ctx, void *timeout_ctx)
 }
 
 
-static int radius_client_disable_pmtu_discovery(int s)
-{
-	int r = -1;
-#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_DONT)
-	/* Turn off Path MTU discovery on IPv4/UDP sockets. */
-	int action = IP_PMTUDISC_DONT;
-	r = setsockopt(s, IPPROTO_IP, IP_MTU_DISCOVER, &action,
-		       sizeof(action));
-	if (r == -1)
-		wpa_printf(MSG_ERROR, "RADIUS: Failed to set IP_MTU_DISCOVER: %s",
-			   strerror(errno));
-#endif
-	return r;
-}
-
-
-static void radius_close_auth_sockets(struct radius_client_data *radius)
-{
-	radius->auth_sock = -1;
-
-	if (radius->auth_serv_sock >= 0) {
-		eloop_unregister_read_sock(radius->auth_serv_sock);
-		close(radius->auth_serv_sock);
-		radius->auth_serv_sock = -1;
-	}
-#ifdef CONFIG_IPV6
-	if (radius->auth_serv_sock6 >= 0) {
-		eloop_unregister_read_sock(radius->auth_serv_sock6);
-		close(radius->auth_serv_sock6);
-		radius->auth_serv_sock6 = -1;
-	}
-#endif /* CONFIG_IPV6 */
-}
-
-
-static void radius_close_acct_sockets(struct radius_client_data *radius)
-{
-	radius->acct_sock = -1;
-
-	if (radius->acct_serv_sock >= 0) {
-		eloop_unregister_read_sock(radius->acct_serv_sock);
-		close(radius->acct_serv_sock);
-		radius->acct_serv_sock = -1;
-	}
-#ifdef CONFIG_IPV6
-	if (radius->acct_serv_sock6 >= 0) {
-		eloop_unregister_read_sock(radius->acct_serv_sock6);
-		close(radius->acct_serv_sock6);
-		radius->acct_serv_sock6 = -1;
-	}
-#endif /* CONFIG_IPV6 */
-}
-
-
 static int radius_client_init_auth(struct radius_client_data *radius)
 {
 	struct hostapd_radius_servers *conf = radius->conf;
-	int ok = 0;
 
 	radius_close_auth_sockets(radius);
 
-	radius->auth_serv_sock = socket(PF_INET, SOCK_DGRAM, 0);
-	if (radius->auth_serv_sock < 0)
-		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET,SOCK_DGRAM]: %s",
-			   strerror(errno));
-	else {
-		radius_client_disable_pmtu_discovery(radius->auth_serv_sock);
-		ok++;
-	}
-
-#ifdef CONFIG_IPV6
-	radius->auth_serv_sock6 = socket(PF_INET6, SOCK_DGRAM, 0);
-	if (radius->auth_serv_sock6 < 0)
-		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET6,SOCK_DGRAM]: %s",
-			   strerror(errno));
-	else
-		ok++;
-#endif /* CONFIG_IPV6 */
-
-	if (ok == 0)
-		return -1;
-
-	radius_change_server(radius, conf->auth_server, NULL,
-			     radius->auth_serv_sock, radius->auth_serv_sock6,
-			     1);
-
-	if (radius->auth_serv_sock >= 0 &&
-	    eloop_register_read_sock(radius->auth_serv_sock,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_AUTH)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for authentication server");
-		radius_close_auth_sockets(radius);
+	if (!radius_client_open_sock(radius, conf->auth_server, 1))
 		return -1;
-	}
 
-#ifdef CONFIG_IPV6
-	if (radius->auth_serv_sock6 >= 0 &&
-	    eloop_register_read_sock(radius->auth_serv_sock6,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_AUTH)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for authentication server");
-		radius_close_auth_sockets(radius);
-		return -1;
-	}
-#endif /* CONFIG_IPV6 */
+	radius_change_server(radius, conf->auth_server, NULL, 1);
 
 	return 0;
 }
@@ -1391,54 +2325,13 @@ static int radius_client_init_auth(struct radius_client_data *radius)
 static int radius_client_init_acct(struct radius_client_data *radius)
 {
 	struct hostapd_radius_servers *conf = radius->conf;
-	int ok = 0;
 
 	radius_close_acct_sockets(radius);
 
-	radius->acct_serv_sock = socket(PF_INET, SOCK_DGRAM, 0);
-	if (radius->acct_serv_sock < 0)
-		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET,SOCK_DGRAM]: %s",
-			   strerror(errno));
-	else {
-		radius_client_disable_pmtu_discovery(radius->acct_serv_sock);
-		ok++;
-	}
-
-#ifdef CONFIG_IPV6
-	radius->acct_serv_sock6 = socket(PF_INET6, SOCK_DGRAM, 0);
-	if (radius->acct_serv_sock6 < 0)
-		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET6,SOCK_DGRAM]: %s",
-			   strerror(errno));
-	else
-		ok++;
-#endif /* CONFIG_IPV6 */
-
-	if (ok == 0)
+	if (!radius_client_open_sock(radius, conf->acct_server, 0))
 		return -1;
 
-	radius_change_server(radius, conf->acct_server, NULL,
-			     radius->acct_serv_sock, radius->acct_serv_sock6,
-			     0);
-
-	if (radius->acct_serv_sock >= 0 &&
-	    eloop_register_read_sock(radius->acct_serv_sock,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_ACCT)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for accounting server");
-		radius_close_acct_sockets(radius);
-		return -1;
-	}
-
-#ifdef CONFIG_IPV6
-	if (radius->acct_serv_sock6 >= 0 &&
-	    eloop_register_read_sock(radius->acct_serv_sock6,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_ACCT)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for accounting server");
-		radius_close_acct_sockets(radius);
-		return -1;
-	}
-#endif /* CONFIG_IPV6 */
+	radius_change_server(radius, conf->acct_server, NULL, 0);
 
 	return 0;
 }
@@ -1458,6 +2351,7 @@ struct radius_client_data *
 radius_client_init(void *ctx, struct hostapd_radius_servers *conf)
 {
 	struct radius_client_data *radius;
+	unsigned int i;
 
 	radius = os_zalloc(sizeof(struct radius_client_data));
 	if (radius == NULL)
@@ -1465,9 +2359,10 @@ radius_client_init(void *ctx, struct hostapd_radius_servers *conf)
 
 	radius->ctx = ctx;
 	radius->conf = conf;
-	radius->auth_serv_sock = radius->acct_serv_sock =
-		radius->auth_serv_sock6 = radius->acct_serv_sock6 =
-		radius->auth_sock = radius->acct_sock = -1;
+	dl_list_init(&radius->msgs);
+	dl_list_init(&radius->states);
+	for (i = 0; i < RADIUS_CLIENT_STATE_HASH_SIZE; i++)
+		dl_list_init(&radius->state_hash[i]);
 
 	if (conf->auth_server && radius_client_init_auth(radius)) {
 		radius_client_deinit(radius);
@@ -1503,6 +2398,12 @@ void radius_client_deinit(struct radius_client_data *radius)
 	eloop_cancel_timeout(radius_retry_primary_timer, radius, NULL);
 
 	radius_client_flush(radius, 0);
+	radius_client_flush_states(radius);
+	eloop_cancel_timeout(radius_client_idle_timer, radius, NULL);
+#ifdef CONFIG_RADIUS_TLS
+	if (radius->tls_ctx)
+		tls_deinit(radius->tls_ctx);
+#endif /* CONFIG_RADIUS_TLS */
 	os_free(radius->auth_handlers);
 	os_free(radius->acct_handlers);
 	os_free(radius);
@@ -1522,11 +2423,10 @@ void radius_client_deinit(struct radius_client_data *radius)
 void radius_client_flush_auth(struct radius_client_data *radius,
 			      const u8 *addr)
 {
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *tmp;
 
-	prev = NULL;
-	entry = radius->msgs;
-	while (entry) {
+	dl_list_for_each_safe(entry, tmp, &radius->msgs,
+			      struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_AUTH &&
 		    os_memcmp(entry->addr, addr, ETH_ALEN) == 0) {
 			hostapd_logger(radius->ctx, addr,
@@ -1534,40 +2434,18 @@ void radius_client_flush_auth(struct radius_client_data *radius,
 				       HOSTAPD_LEVEL_DEBUG,
 				       "Removing pending RADIUS authentication"
 				       " message for removed client");
-
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-			continue;
+			radius_client_msg_remove(radius, entry);
 		}
-
-		prev = entry;
-		entry = entry->next;
 	}
 }
 
 
 static int radius_client_dump_auth_server(char *buf, size_t buflen,
 					  struct hostapd_radius_server *serv,
-					  struct radius_client_data *cli)
+					  struct os_reltime *now)
 {
-	int pending = 0;
-	struct radius_msg_list *msg;
 	char abuf[50];
 
-	if (cli) {
-		for (msg = cli->msgs; msg; msg = msg->next) {
-			if (msg->msg_type == RADIUS_AUTH)
-				pending++;
-		}
-	}
-
 	return os_snprintf(buf, buflen,
 			   "radiusAuthServerIndex=%d\n"
 			   "radiusAuthServerAddress=%s\n"
@@ -1583,7 +2461,10 @@ static int radius_client_dump_auth_server(char *buf, size_t buflen,
 			   "radiusAuthClientPendingRequests=%u\n"
 			   "radiusAuthClientTimeouts=%u\n"
 			   "radiusAuthClientUnknownTypes=%u\n"
-			   "radiusAuthClientPacketsDropped=%u\n",
+			   "radiusAuthClientPacketsDropped=%u\n"
+			   "radiusAuthClientSmoothedRoundTripTime=%d\n"
+			   "radiusAuthClientServerWeight=%d\n"
+			   "radiusAuthClientServerAvailable=%d\n",
 			   serv->index,
 			   hostapd_ip_txt(&serv->addr, abuf, sizeof(abuf)),
 			   serv->port,
@@ -1595,29 +2476,21 @@ static int radius_client_dump_auth_server(char *buf, size_t buflen,
 			   serv->access_challenges,
 			   serv->malformed_responses,
 			   serv->bad_authenticators,
-			   pending,
+			   serv->pending,
 			   serv->timeouts,
 			   serv->unknown_types,
-			   serv->packets_dropped);
+			   serv->packets_dropped,
+			   serv->smoothed_rtt,
+			   serv->weight > 0 ? serv->weight : 1,
+			   serv->unavailable_until <= now->sec);
 }
 
 
 static int radius_client_dump_acct_server(char *buf, size_t buflen,
-					  struct hostapd_radius_server *serv,
-					  struct radius_client_data *cli)
+					  struct hostapd_radius_server *serv)
 {
-	int pending = 0;
-	struct radius_msg_list *msg;
 	char abuf[50];
 
-	if (cli) {
-		for (msg = cli->msgs; msg; msg = msg->next) {
-			if (msg->msg_type == RADIUS_ACCT ||
-			    msg->msg_type == RADIUS_ACCT_INTERIM)
-				pending++;
-		}
-	}
-
 	return os_snprintf(buf, buflen,
 			   "radiusAccServerIndex=%d\n"
 			   "radiusAccServerAddress=%s\n"
@@ -1641,7 +2514,7 @@ static int radius_client_dump_acct_server(char *buf, size_t buflen,
 			   serv->responses,
 			   serv->malformed_responses,
 			   serv->bad_authenticators,
-			   pending,
+			   serv->pending,
 			   serv->timeouts,
 			   serv->unknown_types,
 			   serv->packets_dropped);
@@ -1661,20 +2534,20 @@ int radius_client_get_mib(struct radius_client_data *radius, char *buf,
 	struct hostapd_radius_servers *conf;
 	int i;
 	struct hostapd_radius_server *serv;
+	struct os_reltime now;
 	int count = 0;
 
 	if (!radius)
 		return 0;
 
 	conf = radius->conf;
+	os_get_reltime(&now);
 
 	if (conf->auth_servers) {
 		for (i = 0; i < conf->num_auth_servers; i++) {
 			serv = &conf->auth_servers[i];
 			count += radius_client_dump_auth_server(
-				buf + count, buflen - count, serv,
-				serv == conf->auth_server ?
-				radius : NULL);
+				buf + count, buflen - count, serv, &now);
 		}
 	}
 
@@ -1682,9 +2555,7 @@ int radius_client_get_mib(struct radius_client_data *radius, char *buf,
 		for (i = 0; i < conf->num_acct_servers; i++) {
 			serv = &conf->acct_servers[i];
 			count += radius_client_dump_acct_server(
-				buf + count, buflen - count, serv,
-				serv == conf->acct_server ?
-				radius : NULL);
+				buf + count, buflen - count, serv);
 		}
 	}
 
@@ -1692,9 +2563,67 @@ int radius_client_get_mib(struct radius_client_data *radius, char *buf,
 }
 
 
+static struct hostapd_radius_server *
+radius_client_reconfig_server(struct hostapd_radius_servers *old,
+			      struct hostapd_radius_servers *conf,
+			      struct radius_msg_list *entry)
+{
+	ptrdiff_t idx;
+
+	if (entry->msg_type != RADIUS_AUTH)
+		return conf->acct_server;
+	if (!radius_client_balanced(conf))
+		return conf->auth_server;
+
+	idx = entry->serv - old->auth_servers;
+	if (idx >= 0 && idx < conf->num_auth_servers)
+		return &conf->auth_servers[idx];
+	return conf->auth_server;
+}
+
+
 void radius_client_reconfig(struct radius_client_data *radius,
 			    struct hostapd_radius_servers *conf)
 {
-	if (radius)
-		radius->conf = conf;
+	struct hostapd_radius_servers *old;
+	struct hostapd_radius_server *serv;
+	struct radius_msg_list *entry, *tmp;
+
+	if (!radius)
+		return;
+
+	old = radius->conf;
+	radius->conf = conf;
+	if (old == conf)
+		return;
+
+	/* The old configuration is freed after this, so the sockets are opened
+	 * again on demand for the new servers and the pending messages are
+	 * moved to the corresponding servers in the new configuration. */
+	radius_client_flush_states(radius);
+	radius_close_auth_sockets(radius);
+	radius_close_acct_sockets(radius);
+
+	dl_list_for_each_safe(entry, tmp, &radius->msgs,
+			      struct radius_msg_list, list) {
+		serv = radius_client_reconfig_server(old, conf, entry);
+		entry->serv = NULL;
+		if (!serv || !serv->shared_secret ||
+		    (entry->msg_type == RADIUS_AUTH &&
+		     (serv->shared_secret_len != entry->shared_secret_len ||
+		      os_memcmp(serv->shared_secret, entry->shared_secret,
+				entry->shared_secret_len) != 0))) {
+			radius_client_msg_remove(radius, entry);
+			continue;
+		}
+		radius_client_msg_set_serv(entry, serv);
+		entry->shared_secret = serv->shared_secret;
+		entry->shared_secret_len = serv->shared_secret_len;
+		if (entry->msg_type != RADIUS_AUTH)
+			radius_msg_finish_acct(entry->msg, serv->shared_secret,
+					       serv->shared_secret_len);
+	}
+
+	if (dl_list_empty(&radius->msgs))
+		eloop_cancel_timeout(radius_client_timer, radius, NULL);
 }
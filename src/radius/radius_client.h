@@ -45,6 +45,50 @@ struct hostapd_radius_server {
 	 */
 	size_t shared_secret_len;
 
+	/**
+	 * weight - Relative share of Access-Requests for this server
+	 *
+	 * This is used with RADIUS_AUTH_SERVER_WEIGHTED policy. Value 0 is
+	 * handled as 1.
+	 */
+	int weight;
+
+	/**
+	 * tls - Whether to use RADIUS over TLS (RFC 6614) with this server
+	 */
+	int tls;
+
+	/**
+	 * ca_cert - CA certificate for validating the server (RADIUS/TLS)
+	 */
+	char *ca_cert;
+
+	/**
+	 * client_cert - Client certificate (RADIUS/TLS)
+	 */
+	char *client_cert;
+
+	/**
+	 * private_key - Private key for client_cert (RADIUS/TLS)
+	 */
+	char *private_key;
+
+	/**
+	 * private_key_passwd - Password for private_key (RADIUS/TLS)
+	 */
+	char *private_key_passwd;
+
+	/**
+	 * domain_match - Domain name to match against the dNSName or CN of the
+	 * server certificate (RADIUS/TLS)
+	 */
+	char *domain_match;
+
+	/**
+	 * tls_flags - TLS_CONN_* flags for the connection (RADIUS/TLS)
+	 */
+	unsigned int tls_flags;
+
 	/* Dynamic (not from configuration file) MIB data */
 
 	/**
@@ -112,6 +156,53 @@ struct hostapd_radius_server {
 	 * packets_dropped - radiusAuthClientPacketsDropped or radiusAccClientPacketsDropped
 	 */
 	u32 packets_dropped;
+
+	/**
+	 * pending - radiusAuthClientPendingRequests or radiusAccClientPendingRequests
+	 */
+	u32 pending;
+
+	/**
+	 * smoothed_rtt - Smoothed round-trip time in hundredths of a second
+	 */
+	int smoothed_rtt;
+
+	/* Dynamic state for authentication server load balancing */
+
+	/**
+	 * current_weight - Current weight for smooth weighted round-robin
+	 */
+	int current_weight;
+
+	/**
+	 * unavailable_until - Time until which the server is not selected
+	 *
+	 * This is set when the server does not reply to a request and cleared
+	 * when a response is received from it.
+	 */
+	os_time_t unavailable_until;
+};
+
+/**
+ * enum radius_auth_server_policy - RADIUS authentication server selection
+ * @RADIUS_AUTH_SERVER_FAILOVER: Use the current server until it stops
+ *	replying and then fail over to the next one (default)
+ * @RADIUS_AUTH_SERVER_ROUND_ROBIN: Send each new request to the next server
+ * @RADIUS_AUTH_SERVER_WEIGHTED: Distribute new requests in proportion to the
+ *	configured server weights
+ * @RADIUS_AUTH_SERVER_LEAST_OUTSTANDING: Send each new request to the server
+ *	with the smallest number of pending requests
+ *
+ * With all the policies other than RADIUS_AUTH_SERVER_FAILOVER, an
+ * Access-Request that includes a State attribute from an Access-Challenge is
+ * sent to the server that issued the challenge so that an EAP session stays on
+ * a single server.
+ */
+enum radius_auth_server_policy {
+	RADIUS_AUTH_SERVER_FAILOVER = 0,
+	RADIUS_AUTH_SERVER_ROUND_ROBIN = 1,
+	RADIUS_AUTH_SERVER_WEIGHTED = 2,
+	RADIUS_AUTH_SERVER_LEAST_OUTSTANDING = 3,
 };
 
 /**
@@ -174,6 +265,13 @@ struct hostapd_radius_servers {
 	 * force_client_addr - Whether to force client (local) address
 	 */
 	int force_client_addr;
+
+	/**
+	 * auth_server_policy - Authentication server selection policy
+	 *
+	 * enum radius_auth_server_policy value
+	 */
+	int auth_server_policy;
 };
 
 
@@ -244,6 +342,10 @@ int radius_client_register(struct radius_client_data *radius,
 void radius_client_set_interim_error_cb(struct radius_client_data *radius,
 					void (*cb)(const u8 *addr, void *ctx),
 					void *ctx);
+void radius_client_set_acct_drop_cb(struct radius_client_data *radius,
+				    void (*cb)(struct radius_msg *msg,
+					       void *ctx),
+				    void *ctx);
 int radius_client_send(struct radius_client_data *radius,
 		       struct radius_msg *msg,
 		       RadiusType msg_type, const u8 *addr);
@@ -15,6 +15,19 @@
 #include "radius.h"
 #include "radius_das.h"
 
+/**
+ * RADIUS_DAS_RX_BATCH - Maximum number of requests received per wakeup
+ *
+ * The requests received on a single wakeup are processed as a batch between
+ * the batch_start() and batch_end() callbacks.
+ */
+#define RADIUS_DAS_RX_BATCH 64
+
+/**
+ * RADIUS_DAS_MAX_MSG_LEN - Maximum length of a received request
+ */
+#define RADIUS_DAS_MAX_MSG_LEN 1500
+
 
 struct radius_das_data {
 	int sock;
@@ -28,6 +41,8 @@ struct radius_das_data {
 	enum radius_das_res (*disconnect)(void *ctx,
 					  struct radius_das_attrs *attr);
 	enum radius_das_res (*coa)(void *ctx, struct radius_das_attrs *attr);
+	void (*batch_start)(void *ctx, size_t num);
+	void (*batch_end)(void *ctx);
 };
 
 
@@ -378,10 +393,10 @@ fail:
 }
 
 
-static void radius_das_receive(int sock, void *eloop_ctx, void *sock_ctx)
+static void radius_das_receive_msg(struct radius_das_data *das,
+				   const u8 *buf, size_t len,
+				   const void *addr, socklen_t addrlen)
 {
-	struct radius_das_data *das = eloop_ctx;
-	u8 buf[1500];
 	union {
 		struct sockaddr_storage ss;
 		struct sockaddr_in sin;
@@ -392,7 +407,6 @@ static void radius_das_receive(int sock, void *eloop_ctx, void *sock_ctx)
 	char abuf[50];
 	int from_port = 0;
 	socklen_t fromlen;
-	int len;
 	struct radius_msg *msg, *reply = NULL;
 	struct radius_hdr *hdr;
 	struct wpabuf *rbuf;
@@ -400,19 +414,16 @@ static void radius_das_receive(int sock, void *eloop_ctx, void *sock_ctx)
 	int res;
 	struct os_time now;
 
-	fromlen = sizeof(from);
-	len = recvfrom(sock, buf, sizeof(buf), 0,
-		       (struct sockaddr *) &from.ss, &fromlen);
-	if (len < 0) {
-		wpa_printf(MSG_ERROR, "DAS: recvfrom: %s", strerror(errno));
-		return;
-	}
+	fromlen = addrlen;
+	if (fromlen > sizeof(from))
+		fromlen = sizeof(from);
+	os_memcpy(&from, addr, fromlen);
 
 	os_strlcpy(abuf, inet_ntoa(from.sin.sin_addr), sizeof(abuf));
 	from_port = ntohs(from.sin.sin_port);
 
 	wpa_printf(MSG_DEBUG, "DAS: Received %d bytes from %s:%d",
-		   len, abuf, from_port);
+		   (int) len, abuf, from_port);
 	if (das->client_addr.u.v4.s_addr &&
 	    das->client_addr.u.v4.s_addr != from.sin.sin_addr.s_addr) {
 		wpa_printf(MSG_DEBUG, "DAS: Drop message from unknown client");
@@ -509,6 +520,27 @@ fail:
 }
 
 
+static void radius_das_receive(int sock, void *eloop_ctx, void *sock_ctx,
+			       struct eloop_datagram_batch *batch)
+{
+	struct radius_das_data *das = eloop_ctx;
+	size_t i;
+
+	if (das->batch_start)
+		das->batch_start(das->ctx, batch->num);
+
+	for (i = 0; i < batch->num; i++) {
+		struct eloop_datagram *dgram = &batch->msgs[i];
+
+		radius_das_receive_msg(das, dgram->buf, dgram->len,
+				       dgram->from, dgram->fromlen);
+	}
+
+	if (das->batch_end)
+		das->batch_end(das->ctx);
+}
+
+
 static int radius_das_open_socket(int port)
 {
 	int s;
@@ -553,6 +585,8 @@ radius_das_init(struct radius_das_conf *conf)
 	das->ctx = conf->ctx;
 	das->disconnect = conf->disconnect;
 	das->coa = conf->coa;
+	das->batch_start = conf->batch_start;
+	das->batch_end = conf->batch_end;
 
 	os_memcpy(&das->client_addr, conf->client_addr,
 		  sizeof(das->client_addr));
@@ -573,8 +607,9 @@ radius_das_init(struct radius_das_conf *conf)
 		return NULL;
 	}
 
-	if (eloop_register_read_sock(das->sock, radius_das_receive, das, NULL))
-	{
+	if (eloop_register_read_sock_batch(das->sock, RADIUS_DAS_RX_BATCH,
+					   RADIUS_DAS_MAX_MSG_LEN,
+					   radius_das_receive, das, NULL)) {
 		radius_das_deinit(das);
 		return NULL;
 	}
@@ -53,6 +53,24 @@ struct radius_das_conf {
 	enum radius_das_res (*disconnect)(void *ctx,
 					  struct radius_das_attrs *attr);
 	enum radius_das_res (*coa)(void *ctx, struct radius_das_attrs *attr);
+
+	/**
+	 * batch_start - Start processing a batch of requests (optional)
+	 * @ctx: Context data from ctx
+	 * @num: Number of requests in the batch
+	 *
+	 * The requests received on a single wakeup are passed to disconnect()
+	 * and coa() between batch_start() and batch_end() calls. This allows
+	 * the station lookups for a burst of requests to share state that is
+	 * only valid while no other events are processed.
+	 */
+	void (*batch_start)(void *ctx, size_t num);
+
+	/**
+	 * batch_end - End processing a batch of requests (optional)
+	 * @ctx: Context data from ctx
+	 */
+	void (*batch_end)(void *ctx);
 };
 
 struct radius_das_data *
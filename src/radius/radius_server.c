@@ -8,6 +8,11 @@
 
 #include "includes.h"
 #include <net/if.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif /* __linux__ */
 #ifdef CONFIG_SQLITE
 #include <sqlite3.h>
 #endif /* CONFIG_SQLITE */
@@ -15,10 +20,14 @@
 #include "common.h"
 #include "radius.h"
 #include "eloop.h"
+#include "hash_table.h"
 #include "eap_server/eap.h"
 #include "ap/ap_config.h"
 #include "crypto/tls.h"
 #include "radius_server.h"
+#ifdef CONFIG_RADIUS_TLS
+#include "radius_tls.h"
+#endif /* CONFIG_RADIUS_TLS */
 
 /**
  * RADIUS_SESSION_TIMEOUT - Session timeout in seconds
@@ -31,19 +40,53 @@
 #define RADIUS_SESSION_MAINTAIN 5
 
 /**
- * RADIUS_MAX_SESSION - Maximum number of active sessions
+ * RADIUS_MAX_SESSION - Default maximum number of active sessions
  */
 #define RADIUS_MAX_SESSION 1000
 
+/**
+ * RADIUS_SERVER_MAX_WORKERS - Maximum number of worker processes
+ */
+#define RADIUS_SERVER_MAX_WORKERS 64
+
+/**
+ * RADIUS_SERVER_WORKER_SHIFT - Location of the worker index in session ids
+ *
+ * The most significant octet of the session identifier (and as such, of the
+ * State attribute) identifies the worker process that owns the session.
+ */
+#define RADIUS_SERVER_WORKER_SHIFT 24
+
+/**
+ * RADIUS_SERVER_DB_BUSY_TIMEOUT - SQLite busy timeout with workers in ms
+ */
+#define RADIUS_SERVER_DB_BUSY_TIMEOUT 1000
+
+/**
+ * RADIUS_SERVER_TLS_STATS_INTERVAL - Worker TLS statistics report interval
+ */
+#define RADIUS_SERVER_TLS_STATS_INTERVAL 1
+
 /**
  * RADIUS_MAX_MSG_LEN - Maximum message length for incoming RADIUS messages
  */
 #define RADIUS_MAX_MSG_LEN 3000
 
+/**
+ * RADIUS_SERVER_RX_BATCH - Maximum number of messages received per wakeup
+ */
+#define RADIUS_SERVER_RX_BATCH 16
+
+/**
+ * RADIUS_SERVER_MAX_TLS_CONNS - Maximum number of RADIUS/TLS connections
+ */
+#define RADIUS_SERVER_MAX_TLS_CONNS 100
+
 static const struct eapol_callbacks radius_server_eapol_cb;
 
 struct radius_client;
 struct radius_server_data;
+struct radius_server_tls_conn;
 
 /**
  * struct radius_server_counters - RADIUS server statistics counters
@@ -72,7 +115,8 @@ struct radius_server_counters {
  * struct radius_session - Internal RADIUS server data for a session
  */
 struct radius_session {
-	struct radius_session *next;
+	struct dl_list list; /* in struct radius_client::sessions */
+	struct hash_node hnode; /* in struct radius_server_data::sessions */
 	struct radius_client *client;
 	struct radius_server_data *server;
 	unsigned int sess_id;
@@ -87,6 +131,7 @@ struct radius_session {
 	int last_from_port;
 	struct sockaddr_storage last_from;
 	socklen_t last_fromlen;
+	struct radius_server_tls_conn *last_tls_conn; /* NULL for UDP */
 	u8 last_identifier;
 	struct radius_msg *last_reply;
 	u8 last_authenticator[16];
@@ -111,9 +156,10 @@ struct radius_client {
 	struct in6_addr addr6;
 	struct in6_addr mask6;
 #endif /* CONFIG_IPV6 */
+	int prefix_len;
 	char *shared_secret;
 	int shared_secret_len;
-	struct radius_session *sessions;
+	struct dl_list sessions; /* struct radius_session */
 	struct radius_server_counters counters;
 
 	u8 next_dac_identifier;
@@ -125,6 +171,21 @@ struct radius_client {
 	u8 pending_dac_disconnect_addr[ETH_ALEN];
 };
 
+/**
+ * struct radius_client_node - Node in the client address prefix trie
+ *
+ * The configured client prefixes are stored in a path-compressed binary trie
+ * for longest prefix match of the source address. Each node covers the first
+ * prefix_len bits of prefix and the subtrees are selected by the following bit.
+ * client is %NULL in the nodes that only join two subtrees.
+ */
+struct radius_client_node {
+	struct radius_client_node *child[2];
+	struct radius_client *client;
+	u8 prefix[16];
+	int prefix_len;
+};
+
 /**
  * struct radius_server_data - Internal RADIUS server data
  */
@@ -144,6 +205,46 @@ struct radius_server_data {
 	 */
 	struct radius_client *clients;
 
+	/**
+	 * client_trie - Prefix trie for finding the client of a source address
+	 */
+	struct radius_client_node *client_trie;
+
+	/**
+	 * client_trie_nodes - Number of nodes in client_trie
+	 */
+	unsigned int client_trie_nodes;
+
+	/**
+	 * client_lookups - Number of client lookups
+	 */
+	u32 client_lookups;
+
+	/**
+	 * client_lookup_nodes - Number of trie nodes visited in client lookups
+	 */
+	u32 client_lookup_nodes;
+
+	/**
+	 * sessions - Active sessions of all clients by session identifier
+	 */
+	struct hash_table sessions; /* struct radius_session */
+
+	/**
+	 * session_lookups - Number of session lookups based on State
+	 */
+	u32 session_lookups;
+
+	/**
+	 * session_lookup_misses - Number of session lookups without a match
+	 */
+	u32 session_lookup_misses;
+
+	/**
+	 * max_sess - Maximum number of active sessions
+	 */
+	int max_sess;
+
 	/**
 	 * next_sess_id - Next session identifier
 	 */
@@ -199,6 +300,11 @@ struct radius_server_data {
 	int (*get_eap_user)(void *ctx, const u8 *identity, size_t identity_len,
 			    int phase2, struct eap_user *user);
 
+	/**
+	 * set_ticket_keys - Callback for updating TLS session ticket keys
+	 */
+	int (*set_ticket_keys)(void *ctx, const u8 *keys, size_t num_keys);
+
 	/**
 	 * eap_req_id_text - Optional data for EAP-Request/Identity
 	 *
@@ -231,7 +337,131 @@ struct radius_server_data {
 #endif /* CONFIG_SQLITE */
 
 	const struct eap_config *eap_cfg;
+
+#ifdef CONFIG_RADIUS_TLS
+	/**
+	 * tls_sock - Listening socket for RADIUS/TLS connections
+	 */
+	int tls_sock;
+
+	/**
+	 * tls_conns - Accepted RADIUS/TLS connections
+	 */
+	struct dl_list tls_conns; /* struct radius_server_tls_conn */
+
+	/**
+	 * num_tls_conns - Number of entries in tls_conns
+	 */
+	unsigned int num_tls_conns;
+
+	/**
+	 * tls_verify_client - Whether RADIUS/TLS clients need a certificate
+	 */
+	int tls_verify_client;
+#endif /* CONFIG_RADIUS_TLS */
+
+	/**
+	 * num_workers - Number of processes sharing the authentication port
+	 */
+	int num_workers;
+
+	/**
+	 * worker_id - Index of this process; 0 for the main process
+	 */
+	int worker_id;
+
+	/**
+	 * worker_socks - Datagram socket pairs between the worker processes
+	 *
+	 * Worker i receives from worker_socks[2 * i] and the other processes
+	 * send to it through worker_socks[2 * i + 1]. Unused receive sockets
+	 * are closed, so the entries are -1 in all but the owning process.
+	 */
+	int *worker_socks;
+
+	/**
+	 * worker_pids - Process ids of the forked workers (main process only)
+	 */
+	pid_t *worker_pids;
+
+	/**
+	 * worker_tls_stats - Latest TLS statistics of the workers
+	 *
+	 * This is used only in the main process and the entry for index 0 is
+	 * unused.
+	 */
+	struct tls_session_stats *worker_tls_stats;
+
+	/**
+	 * tls_stats_sent - TLS statistics last reported to the main process
+	 */
+	struct tls_session_stats tls_stats_sent;
+
+	/**
+	 * workers_started - Whether the worker processes have been forked
+	 */
+	int workers_started;
+
+	/**
+	 * auth_port - UDP port of the authentication server
+	 */
+	int auth_port;
+
+#ifdef CONFIG_SQLITE
+	/**
+	 * sqlite_file - SQLite database file for the worker connections
+	 */
+	char *sqlite_file;
+#endif /* CONFIG_SQLITE */
+};
+
+/**
+ * enum radius_server_worker_msg_type - Message type between worker processes
+ * @RADIUS_WORKER_AUTH_REQUEST: Access-Request for a session that is owned by
+ *	the receiving process
+ * @RADIUS_WORKER_ERP_KEY: New ERP key for the main process
+ * @RADIUS_WORKER_TICKET_KEYS: New TLS session ticket key ring for a worker
+ * @RADIUS_WORKER_TLS_STATS: TLS statistics of a worker for the main process
+ */
+enum radius_server_worker_msg_type {
+	RADIUS_WORKER_AUTH_REQUEST = 1,
+	RADIUS_WORKER_ERP_KEY = 2,
+	RADIUS_WORKER_TICKET_KEYS = 3,
+	RADIUS_WORKER_TLS_STATS = 4,
+};
+
+/**
+ * struct radius_server_worker_hdr - Header for messages between workers
+ *
+ * RADIUS_WORKER_AUTH_REQUEST is followed by the received datagram.
+ * RADIUS_WORKER_ERP_KEY is followed by struct eap_server_erp_key without the
+ * list head and the nul terminated keyName-NAI.
+ * RADIUS_WORKER_TICKET_KEYS is followed by the keys (TLS_SESSION_TICKET_KEY_LEN
+ * octets each) and RADIUS_WORKER_TLS_STATS by the index of the sending worker
+ * (int) and struct tls_session_stats.
+ */
+struct radius_server_worker_hdr {
+	u8 type;
+	socklen_t fromlen;
+	struct sockaddr_storage from;
+};
+
+#ifdef CONFIG_RADIUS_TLS
+/**
+ * struct radius_server_tls_conn - RADIUS/TLS connection from a client
+ *
+ * RADIUS/TLS (RFC 6614) carries both authentication and accounting messages
+ * over the same connection. Replies are sent back over the connection on which
+ * the request was received.
+ */
+struct radius_server_tls_conn {
+	struct dl_list list;
+	struct radius_server_data *server;
+	struct radius_tls_conn *conn;
+	struct sockaddr_storage addr;
+	socklen_t addrlen;
 };
+#endif /* CONFIG_RADIUS_TLS */
 
 
 #define RADIUS_DEBUG(args...) \
@@ -333,39 +563,176 @@ void srv_log(struct radius_session *sess, const char *fmt, ...)
 }
 
 
-static struct radius_client *
-radius_server_get_client(struct radius_server_data *data, struct in_addr *addr,
-			 int ipv6)
+static int radius_prefix_bit(const u8 *addr, int bit)
 {
-	struct radius_client *client = data->clients;
+	return (addr[bit / 8] >> (7 - bit % 8)) & 1;
+}
 
-	while (client) {
-#ifdef CONFIG_IPV6
-		if (ipv6) {
-			struct in6_addr *addr6;
-			int i;
-
-			addr6 = (struct in6_addr *) addr;
-			for (i = 0; i < 16; i++) {
-				if ((addr6->s6_addr[i] &
-				     client->mask6.s6_addr[i]) !=
-				    (client->addr6.s6_addr[i] &
-				     client->mask6.s6_addr[i])) {
-					i = 17;
-					break;
-				}
+
+static int radius_prefix_common(const u8 *a, const u8 *b, int max_bits)
+{
+	int i = 0;
+
+	while (i + 8 <= max_bits && a[i / 8] == b[i / 8])
+		i += 8;
+	while (i < max_bits && radius_prefix_bit(a, i) == radius_prefix_bit(b, i))
+		i++;
+
+	return i;
+}
+
+
+static struct radius_client_node *
+radius_client_node_alloc(struct radius_server_data *data, const u8 *prefix,
+			 int prefix_len, struct radius_client *client)
+{
+	struct radius_client_node *node;
+	int i;
+
+	node = os_zalloc(sizeof(*node));
+	if (!node)
+		return NULL;
+	os_memcpy(node->prefix, prefix, (prefix_len + 7) / 8);
+	if (prefix_len % 8)
+		node->prefix[prefix_len / 8] &= 0xff << (8 - prefix_len % 8);
+	for (i = (prefix_len + 7) / 8; i < (int) sizeof(node->prefix); i++)
+		node->prefix[i] = 0;
+	node->prefix_len = prefix_len;
+	node->client = client;
+	data->client_trie_nodes++;
+
+	return node;
+}
+
+
+static int radius_server_client_trie_add(struct radius_server_data *data,
+					 struct radius_client *client,
+					 const u8 *prefix, int prefix_len)
+{
+	struct radius_client_node **pos = &data->client_trie;
+	struct radius_client_node *node, *leaf, *glue;
+	int common;
+
+	while ((node = *pos)) {
+		common = radius_prefix_common(node->prefix, prefix,
+					      node->prefix_len < prefix_len ?
+					      node->prefix_len : prefix_len);
+		if (common < node->prefix_len) {
+			/* Insert a new node above the existing one */
+			if (common == prefix_len) {
+				leaf = radius_client_node_alloc(
+					data, prefix, prefix_len, client);
+				if (!leaf)
+					return -1;
+				leaf->child[radius_prefix_bit(node->prefix,
+							      common)] = node;
+				*pos = leaf;
+				return 0;
 			}
-			if (i == 16) {
-				break;
+
+			leaf = radius_client_node_alloc(data, prefix,
+							prefix_len, client);
+			glue = radius_client_node_alloc(data, prefix, common,
+							NULL);
+			if (!leaf || !glue) {
+				os_free(leaf);
+				os_free(glue);
+				return -1;
 			}
+			glue->child[radius_prefix_bit(node->prefix, common)] =
+				node;
+			glue->child[radius_prefix_bit(prefix, common)] = leaf;
+			*pos = glue;
+			return 0;
 		}
-#endif /* CONFIG_IPV6 */
-		if (!ipv6 && (client->addr.s_addr & client->mask.s_addr) ==
-		    (addr->s_addr & client->mask.s_addr)) {
-			break;
+
+		if (node->prefix_len == prefix_len) {
+			/* The first entry in the client file wins for duplicate
+			 * prefixes. */
+			if (!node->client)
+				node->client = client;
+			return 0;
 		}
 
-		client = client->next;
+		pos = &node->child[radius_prefix_bit(prefix,
+						     node->prefix_len)];
+	}
+
+	node = radius_client_node_alloc(data, prefix, prefix_len, client);
+	if (!node)
+		return -1;
+	*pos = node;
+	return 0;
+}
+
+
+static void radius_client_node_free(struct radius_client_node *node)
+{
+	if (!node)
+		return;
+	radius_client_node_free(node->child[0]);
+	radius_client_node_free(node->child[1]);
+	os_free(node);
+}
+
+
+static int radius_server_build_client_trie(struct radius_server_data *data)
+{
+	struct radius_client *client;
+	const u8 *prefix;
+
+	for (client = data->clients; client; client = client->next) {
+#ifdef CONFIG_IPV6
+		if (data->ipv6)
+			prefix = client->addr6.s6_addr;
+		else
+#endif /* CONFIG_IPV6 */
+		prefix = (const u8 *) &client->addr.s_addr;
+		if (radius_server_client_trie_add(data, client, prefix,
+						  client->prefix_len) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+
+static struct radius_client *
+radius_server_get_client(struct radius_server_data *data, struct in_addr *addr,
+			 int ipv6)
+{
+	struct radius_client_node *node = data->client_trie;
+	struct radius_client *client = NULL;
+	const u8 *key = (const u8 *) &addr->s_addr;
+	int key_len = 32;
+#ifdef CONFIG_IPV6
+	u8 mapped[16];
+
+	if (ipv6) {
+		key = ((struct in6_addr *) addr)->s6_addr;
+		key_len = 128;
+	} else if (data->ipv6) {
+		/* IPv4 addresses are stored as IPv4-mapped IPv6 addresses */
+		os_memset(mapped, 0, 10);
+		mapped[10] = 0xff;
+		mapped[11] = 0xff;
+		os_memcpy(&mapped[12], &addr->s_addr, 4);
+		key = mapped;
+		key_len = 128;
+	}
+#endif /* CONFIG_IPV6 */
+
+	data->client_lookups++;
+	while (node) {
+		data->client_lookup_nodes++;
+		if (radius_prefix_common(node->prefix, key, node->prefix_len) <
+		    node->prefix_len)
+			break;
+		if (node->client)
+			client = node->client;
+		if (node->prefix_len >= key_len)
+			break;
+		node = node->child[radius_prefix_bit(key, node->prefix_len)];
 	}
 
 	return client;
@@ -373,18 +740,22 @@ radius_server_get_client(struct radius_server_data *data, struct in_addr *addr,
 
 
 static struct radius_session *
-radius_server_get_session(struct radius_client *client, unsigned int sess_id)
+radius_server_get_session(struct radius_server_data *data,
+			  struct radius_client *client, unsigned int sess_id)
 {
-	struct radius_session *sess = client->sessions;
+	struct hash_node *node;
+	struct radius_session *sess;
 
-	while (sess) {
-		if (sess->sess_id == sess_id) {
-			break;
-		}
-		sess = sess->next;
+	data->session_lookups++;
+	for (node = hash_table_get(&data->sessions, &sess_id, sizeof(sess_id));
+	     node; node = hash_table_get_next(&data->sessions, node)) {
+		sess = hash_table_entry(node, struct radius_session, hnode);
+		if (sess->client == client)
+			return sess;
 	}
+	data->session_lookup_misses++;
 
-	return sess;
+	return NULL;
 }
 
 
@@ -393,6 +764,8 @@ static void radius_server_session_free(struct radius_server_data *data,
 {
 	eloop_cancel_timeout(radius_server_session_timeout, data, sess);
 	eloop_cancel_timeout(radius_server_session_remove_timeout, data, sess);
+	dl_list_del(&sess->list);
+	hash_table_del(&data->sessions, &sess->hnode);
 	eap_server_sm_deinit(sess->eap);
 	radius_msg_free(sess->last_msg);
 	os_free(sess->last_from_addr);
@@ -407,26 +780,8 @@ static void radius_server_session_free(struct radius_server_data *data,
 static void radius_server_session_remove(struct radius_server_data *data,
 					 struct radius_session *sess)
 {
-	struct radius_client *client = sess->client;
-	struct radius_session *session, *prev;
-
 	eloop_cancel_timeout(radius_server_session_remove_timeout, data, sess);
-
-	prev = NULL;
-	session = client->sessions;
-	while (session) {
-		if (session == sess) {
-			if (prev == NULL) {
-				client->sessions = sess->next;
-			} else {
-				prev->next = sess->next;
-			}
-			radius_server_session_free(data, sess);
-			break;
-		}
-		prev = session;
-		session = session->next;
-	}
+	radius_server_session_free(data, sess);
 }
 
 
@@ -456,7 +811,7 @@ radius_server_new_session(struct radius_server_data *data,
 {
 	struct radius_session *sess;
 
-	if (data->num_sess >= RADIUS_MAX_SESSION) {
+	if (data->num_sess >= data->max_sess) {
 		RADIUS_DEBUG("Maximum number of existing session - no room "
 			     "for a new session");
 		return NULL;
@@ -469,8 +824,17 @@ radius_server_new_session(struct radius_server_data *data,
 	sess->server = data;
 	sess->client = client;
 	sess->sess_id = data->next_sess_id++;
-	sess->next = client->sessions;
-	client->sessions = sess;
+	if (data->num_workers > 1)
+		sess->sess_id = (sess->sess_id &
+				 ((1U << RADIUS_SERVER_WORKER_SHIFT) - 1)) |
+			((unsigned int) data->worker_id <<
+			 RADIUS_SERVER_WORKER_SHIFT);
+	if (hash_table_add(&data->sessions, &sess->hnode, &sess->sess_id,
+			   sizeof(sess->sess_id)) < 0) {
+		os_free(sess);
+		return NULL;
+	}
+	dl_list_add(&client->sessions, &sess->list);
 	eloop_register_timeout(RADIUS_SESSION_TIMEOUT, 0,
 			       radius_server_session_timeout, data, sess);
 	data->num_sess++;
@@ -1238,10 +1602,29 @@ radius_server_macacl(struct radius_server_data *data,
 }
 
 
+static int radius_server_send(int s, struct radius_server_tls_conn *conn,
+			      const struct wpabuf *buf,
+			      struct sockaddr *to, socklen_t tolen)
+{
+#ifdef CONFIG_RADIUS_TLS
+	if (conn)
+		return radius_tls_conn_send(conn->conn, buf);
+#endif /* CONFIG_RADIUS_TLS */
+
+	if (sendto(s, wpabuf_head(buf), wpabuf_len(buf), 0, to, tolen) < 0) {
+		wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+
 static int radius_server_reject(struct radius_server_data *data,
 				struct radius_client *client,
 				struct radius_msg *request,
 				struct sockaddr *from, socklen_t fromlen,
+				struct radius_server_tls_conn *conn,
 				const char *from_addr, int from_port)
 {
 	struct radius_msg *msg;
@@ -1287,11 +1670,8 @@ static int radius_server_reject(struct radius_server_data *data,
 	data->counters.access_rejects++;
 	client->counters.access_rejects++;
 	buf = radius_msg_get_buf(msg);
-	if (sendto(data->auth_sock, wpabuf_head(buf), wpabuf_len(buf), 0,
-		   (struct sockaddr *) from, sizeof(*from)) < 0) {
-		wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s", strerror(errno));
+	if (radius_server_send(data->auth_sock, conn, buf, from, fromlen) < 0)
 		ret = -1;
-	}
 
 	radius_msg_free(msg);
 
@@ -1347,6 +1727,7 @@ static void radius_server_hs20_t_c_check(struct radius_session *sess,
 static int radius_server_request(struct radius_server_data *data,
 				 struct radius_msg *msg,
 				 struct sockaddr *from, socklen_t fromlen,
+				 struct radius_server_tls_conn *conn,
 				 struct radius_client *client,
 				 const char *from_addr, int from_port,
 				 struct radius_session *force_sess)
@@ -1367,7 +1748,8 @@ static int radius_server_request(struct radius_server_data *data,
 		state_included = res >= 0;
 		if (res == sizeof(statebuf)) {
 			state = WPA_GET_BE32(statebuf);
-			sess = radius_server_get_session(client, state);
+			sess = radius_server_get_session(data, client,
+							 state);
 		} else {
 			sess = NULL;
 		}
@@ -1377,7 +1759,7 @@ static int radius_server_request(struct radius_server_data *data,
 		RADIUS_DEBUG("Request for session 0x%x", sess->sess_id);
 	} else if (state_included) {
 		RADIUS_DEBUG("State attribute included but no session found");
-		radius_server_reject(data, client, msg, from, fromlen,
+		radius_server_reject(data, client, msg, from, fromlen, conn,
 				     from_addr, from_port);
 		return -1;
 	} else {
@@ -1386,7 +1768,7 @@ static int radius_server_request(struct radius_server_data *data,
 		if (sess == NULL) {
 			RADIUS_DEBUG("Could not create a new session");
 			radius_server_reject(data, client, msg, from, fromlen,
-					     from_addr, from_port);
+					     conn, from_addr, from_port);
 			return -1;
 		}
 	}
@@ -1402,13 +1784,8 @@ static int radius_server_request(struct radius_server_data *data,
 		if (sess->last_reply) {
 			struct wpabuf *buf;
 			buf = radius_msg_get_buf(sess->last_reply);
-			res = sendto(data->auth_sock, wpabuf_head(buf),
-				     wpabuf_len(buf), 0,
-				     (struct sockaddr *) from, fromlen);
-			if (res < 0) {
-				wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
-					   strerror(errno));
-			}
+			radius_server_send(data->auth_sock, conn, buf, from,
+					   fromlen);
 			return 0;
 		}
 
@@ -1462,6 +1839,7 @@ static int radius_server_request(struct radius_server_data *data,
 		sess->last_from_addr = os_strdup(from_addr);
 		sess->last_fromlen = fromlen;
 		os_memcpy(&sess->last_from, from, fromlen);
+		sess->last_tls_conn = conn;
 		return -2;
 	} else {
 		RADIUS_DEBUG("No EAP data from the state machine - ignore this"
@@ -1513,13 +1891,7 @@ send_reply:
 			break;
 		}
 		buf = radius_msg_get_buf(reply);
-		res = sendto(data->auth_sock, wpabuf_head(buf),
-			     wpabuf_len(buf), 0,
-			     (struct sockaddr *) from, fromlen);
-		if (res < 0) {
-			wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
-				   strerror(errno));
-		}
+		radius_server_send(data->auth_sock, conn, buf, from, fromlen);
 		radius_msg_free(sess->last_reply);
 		sess->last_reply = reply;
 		sess->last_from_port = from_port;
@@ -1655,11 +2027,84 @@ static void radius_server_receive_coa_resp(struct radius_server_data *data,
 }
 
 
-static void radius_server_receive_auth(int sock, void *eloop_ctx,
-				       void *sock_ctx)
+static int radius_server_worker_send(struct radius_server_data *data,
+				     int worker, u8 type,
+				     const void *from, socklen_t fromlen,
+				     const void *buf, size_t len)
+{
+	struct radius_server_worker_hdr hdr;
+	struct iovec iov[2];
+	struct msghdr mh;
+
+	os_memset(&hdr, 0, sizeof(hdr));
+	hdr.type = type;
+	if (from) {
+		if (fromlen > sizeof(hdr.from))
+			fromlen = sizeof(hdr.from);
+		os_memcpy(&hdr.from, from, fromlen);
+		hdr.fromlen = fromlen;
+	}
+
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = (void *) buf;
+	iov[1].iov_len = len;
+	os_memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = iov;
+	mh.msg_iovlen = 2;
+
+	/* Do not block the event loop on a busy worker; the RADIUS client
+	 * will retransmit dropped requests. */
+	if (sendmsg(data->worker_socks[2 * worker + 1], &mh, MSG_DONTWAIT) <
+	    0) {
+		wpa_printf(MSG_INFO, "RADIUS SRV: Failed to pass message to worker %d: %s",
+			   worker, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int radius_server_worker_owner(struct radius_server_data *data,
+				      struct radius_msg *msg)
+{
+	u8 statebuf[4];
+	int owner;
+
+	if (radius_msg_get_attr(msg, RADIUS_ATTR_STATE, statebuf,
+				sizeof(statebuf)) == sizeof(statebuf)) {
+		owner = WPA_GET_BE32(statebuf) >> RADIUS_SERVER_WORKER_SHIFT;
+		if (owner < data->num_workers)
+			return owner;
+		return data->worker_id;
+	}
+
+#ifdef CONFIG_ERP
+	/* ERP keys are stored in the main process */
+	if (data->eap_cfg->erp) {
+		struct wpabuf *eap;
+		int initiate;
+
+		eap = radius_msg_get_eap(msg);
+		initiate = eap && wpabuf_len(eap) > 0 &&
+			wpabuf_head_u8(eap)[0] == EAP_CODE_INITIATE;
+		wpabuf_free(eap);
+		if (initiate)
+			return 0;
+	}
+#endif /* CONFIG_ERP */
+
+	return data->worker_id;
+}
+
+
+static void radius_server_receive_auth_msg(struct radius_server_data *data,
+					   const u8 *buf, int len,
+					   const void *addr,
+					   socklen_t addrlen,
+					   struct radius_server_tls_conn *conn)
 {
-	struct radius_server_data *data = eloop_ctx;
-	u8 *buf = NULL;
 	union {
 		struct sockaddr_storage ss;
 		struct sockaddr_in sin;
@@ -1668,25 +2113,15 @@ static void radius_server_receive_auth(int sock, void *eloop_ctx,
 #endif /* CONFIG_IPV6 */
 	} from;
 	socklen_t fromlen;
-	int len;
 	struct radius_client *client = NULL;
 	struct radius_msg *msg = NULL;
 	char abuf[50];
 	int from_port = 0;
 
-	buf = os_malloc(RADIUS_MAX_MSG_LEN);
-	if (buf == NULL) {
-		goto fail;
-	}
-
-	fromlen = sizeof(from);
-	len = recvfrom(sock, buf, RADIUS_MAX_MSG_LEN, 0,
-		       (struct sockaddr *) &from.ss, &fromlen);
-	if (len < 0) {
-		wpa_printf(MSG_INFO, "recvfrom[radius_server]: %s",
-			   strerror(errno));
-		goto fail;
-	}
+	fromlen = addrlen;
+	if (fromlen > sizeof(from))
+		fromlen = sizeof(from);
+	os_memcpy(&from, addr, fromlen);
 
 #ifdef CONFIG_IPV6
 	if (data->ipv6) {
@@ -1728,9 +2163,6 @@ static void radius_server_receive_auth(int sock, void *eloop_ctx,
 		goto fail;
 	}
 
-	os_free(buf);
-	buf = NULL;
-
 	if (wpa_debug_level <= MSG_MSGDUMP) {
 		radius_msg_dump(msg);
 	}
@@ -1774,31 +2206,143 @@ static void radius_server_receive_auth(int sock, void *eloop_ctx,
 		goto fail;
 	}
 
+	if (!conn && data->num_workers > 1) {
+		int owner = radius_server_worker_owner(data, msg);
+
+		if (owner != data->worker_id) {
+			RADIUS_DEBUG("Pass the request to worker %d", owner);
+			radius_server_worker_send(data, owner,
+						  RADIUS_WORKER_AUTH_REQUEST,
+						  &from, fromlen, buf, len);
+			goto fail;
+		}
+	}
+
 	if (radius_server_request(data, msg, (struct sockaddr *) &from,
-				  fromlen, client, abuf, from_port, NULL) ==
-	    -2)
+				  fromlen, conn, client, abuf, from_port,
+				  NULL) == -2)
 		return; /* msg was stored with the session */
 
 fail:
 	radius_msg_free(msg);
-	os_free(buf);
 }
 
 
-static void radius_server_receive_acct(int sock, void *eloop_ctx,
-				       void *sock_ctx)
+static void radius_server_receive_auth(int sock, void *eloop_ctx,
+				       void *sock_ctx,
+				       struct eloop_datagram_batch *batch)
 {
 	struct radius_server_data *data = eloop_ctx;
-	u8 *buf = NULL;
-	union {
-		struct sockaddr_storage ss;
-		struct sockaddr_in sin;
-#ifdef CONFIG_IPV6
-		struct sockaddr_in6 sin6;
-#endif /* CONFIG_IPV6 */
-	} from;
+	size_t i;
+
+	for (i = 0; i < batch->num; i++) {
+		struct eloop_datagram *dgram = &batch->msgs[i];
+
+		radius_server_receive_auth_msg(data, dgram->buf, dgram->len,
+					       dgram->from, dgram->fromlen,
+					       NULL);
+	}
+}
+
+
+static void radius_server_receive_worker(int sock, void *eloop_ctx,
+					 void *sock_ctx)
+{
+	struct radius_server_data *data = eloop_ctx;
+	struct radius_server_worker_hdr hdr;
+	u8 buf[RADIUS_MAX_MSG_LEN];
+	struct iovec iov[2];
+	ssize_t res;
+	size_t len;
+
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = buf;
+	iov[1].iov_len = sizeof(buf);
+	res = readv(sock, iov, 2);
+	if (res < 0) {
+		wpa_printf(MSG_INFO, "RADIUS SRV: worker recv: %s",
+			   strerror(errno));
+		return;
+	}
+	if ((size_t) res < sizeof(hdr))
+		return;
+	len = res - sizeof(hdr);
+
+	switch (hdr.type) {
+	case RADIUS_WORKER_AUTH_REQUEST:
+		if (hdr.fromlen > sizeof(hdr.from))
+			break;
+		radius_server_receive_auth_msg(data, buf, len, &hdr.from,
+					       hdr.fromlen, NULL);
+		break;
+#ifdef CONFIG_ERP
+	case RADIUS_WORKER_ERP_KEY: {
+		struct eap_server_erp_key *erp;
+		size_t fixed = offsetof(struct eap_server_erp_key,
+					keyname_nai) -
+			offsetof(struct eap_server_erp_key, rRK_len);
+
+		if (data->worker_id != 0 || len <= fixed ||
+		    buf[len - 1] != '\0')
+			break;
+		erp = os_zalloc(sizeof(*erp) + len - fixed);
+		if (!erp)
+			break;
+		os_memcpy(&erp->rRK_len, buf, len);
+		RADIUS_DEBUG("Received ERP key '%s' from a worker",
+			     erp->keyname_nai);
+		dl_list_add(&data->erp_keys, &erp->list);
+		break;
+	}
+#endif /* CONFIG_ERP */
+	case RADIUS_WORKER_TICKET_KEYS:
+		if (data->worker_id == 0 ||
+		    len % TLS_SESSION_TICKET_KEY_LEN || !data->set_ticket_keys)
+			break;
+		RADIUS_DEBUG("Received %u TLS session ticket keys",
+			     (unsigned int) (len / TLS_SESSION_TICKET_KEY_LEN));
+		if (data->set_ticket_keys(data->conf_ctx, buf,
+					  len / TLS_SESSION_TICKET_KEY_LEN) < 0)
+			wpa_printf(MSG_ERROR,
+				   "RADIUS SRV: Worker %d failed to set TLS session ticket keys",
+				   data->worker_id);
+		break;
+	case RADIUS_WORKER_TLS_STATS: {
+		int worker;
+
+		if (data->worker_id != 0 || !data->worker_tls_stats ||
+		    len != sizeof(worker) + sizeof(struct tls_session_stats))
+			break;
+		os_memcpy(&worker, buf, sizeof(worker));
+		if (worker <= 0 || worker >= data->num_workers)
+			break;
+		os_memcpy(&data->worker_tls_stats[worker], buf + sizeof(worker),
+			  sizeof(struct tls_session_stats));
+		break;
+	}
+	default:
+		break;
+	}
+
+	forced_memzero(buf, len);
+}
+
+
+static void radius_server_receive_acct_msg(struct radius_server_data *data,
+					   const u8 *buf, int len,
+					   const void *addr,
+					   socklen_t addrlen,
+					   struct radius_server_tls_conn *conn)
+{
+	union {
+		struct sockaddr_storage ss;
+		struct sockaddr_in sin;
+#ifdef CONFIG_IPV6
+		struct sockaddr_in6 sin6;
+#endif /* CONFIG_IPV6 */
+	} from;
 	socklen_t fromlen;
-	int len, res;
 	struct radius_client *client = NULL;
 	struct radius_msg *msg = NULL, *resp = NULL;
 	char abuf[50];
@@ -1806,19 +2350,10 @@ static void radius_server_receive_acct(int sock, void *eloop_ctx,
 	struct radius_hdr *hdr;
 	struct wpabuf *rbuf;
 
-	buf = os_malloc(RADIUS_MAX_MSG_LEN);
-	if (buf == NULL) {
-		goto fail;
-	}
-
-	fromlen = sizeof(from);
-	len = recvfrom(sock, buf, RADIUS_MAX_MSG_LEN, 0,
-		       (struct sockaddr *) &from.ss, &fromlen);
-	if (len < 0) {
-		wpa_printf(MSG_INFO, "recvfrom[radius_server]: %s",
-			   strerror(errno));
-		goto fail;
-	}
+	fromlen = addrlen;
+	if (fromlen > sizeof(from))
+		fromlen = sizeof(from);
+	os_memcpy(&from, addr, fromlen);
 
 #ifdef CONFIG_IPV6
 	if (data->ipv6) {
@@ -1860,9 +2395,6 @@ static void radius_server_receive_acct(int sock, void *eloop_ctx,
 		goto fail;
 	}
 
-	os_free(buf);
-	buf = NULL;
-
 	if (wpa_debug_level <= MSG_MSGDUMP) {
 		radius_msg_dump(msg);
 	}
@@ -1905,17 +2437,29 @@ static void radius_server_receive_acct(int sock, void *eloop_ctx,
 	rbuf = radius_msg_get_buf(resp);
 	data->counters.acct_responses++;
 	client->counters.acct_responses++;
-	res = sendto(data->acct_sock, wpabuf_head(rbuf), wpabuf_len(rbuf), 0,
-		     (struct sockaddr *) &from.ss, fromlen);
-	if (res < 0) {
-		wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
-			   strerror(errno));
-	}
+	radius_server_send(data->acct_sock, conn, rbuf,
+			   (struct sockaddr *) &from.ss, fromlen);
 
 fail:
 	radius_msg_free(resp);
 	radius_msg_free(msg);
-	os_free(buf);
+}
+
+
+static void radius_server_receive_acct(int sock, void *eloop_ctx,
+				       void *sock_ctx,
+				       struct eloop_datagram_batch *batch)
+{
+	struct radius_server_data *data = eloop_ctx;
+	size_t i;
+
+	for (i = 0; i < batch->num; i++) {
+		struct eloop_datagram *dgram = &batch->msgs[i];
+
+		radius_server_receive_acct_msg(data, dgram->buf, dgram->len,
+					       dgram->from, dgram->fromlen,
+					       NULL);
+	}
 }
 
 
@@ -1935,7 +2479,23 @@ static int radius_server_disable_pmtu_discovery(int s)
 }
 
 
-static int radius_server_open_socket(int port)
+static int radius_server_set_reuseport(int s, int reuseport)
+{
+#ifdef SO_REUSEPORT
+	int one = 1;
+
+	if (reuseport &&
+	    setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+		wpa_printf(MSG_INFO, "RADIUS: setsockopt(SO_REUSEPORT): %s",
+			   strerror(errno));
+		return -1;
+	}
+#endif /* SO_REUSEPORT */
+	return 0;
+}
+
+
+static int radius_server_open_socket(int port, int reuseport)
 {
 	int s;
 	struct sockaddr_in addr;
@@ -1947,6 +2507,10 @@ static int radius_server_open_socket(int port)
 	}
 
 	radius_server_disable_pmtu_discovery(s);
+	if (radius_server_set_reuseport(s, reuseport) < 0) {
+		close(s);
+		return -1;
+	}
 
 	os_memset(&addr, 0, sizeof(addr));
 	addr.sin_family = AF_INET;
@@ -1962,7 +2526,7 @@ static int radius_server_open_socket(int port)
 
 
 #ifdef CONFIG_IPV6
-static int radius_server_open_socket6(int port)
+static int radius_server_open_socket6(int port, int reuseport)
 {
 	int s;
 	struct sockaddr_in6 addr;
@@ -1974,6 +2538,11 @@ static int radius_server_open_socket6(int port)
 		return -1;
 	}
 
+	if (radius_server_set_reuseport(s, reuseport) < 0) {
+		close(s);
+		return -1;
+	}
+
 	os_memset(&addr, 0, sizeof(addr));
 	addr.sin6_family = AF_INET6;
 	os_memcpy(&addr.sin6_addr, &in6addr_any, sizeof(in6addr_any));
@@ -1989,17 +2558,200 @@ static int radius_server_open_socket6(int port)
 #endif /* CONFIG_IPV6 */
 
 
+#ifdef CONFIG_RADIUS_TLS
+
+static void radius_server_tls_conn_free(struct radius_server_data *data,
+					struct radius_server_tls_conn *conn)
+{
+	struct radius_client *client;
+	struct radius_session *sess;
+
+	/* Drop requests waiting for a pending EAP operation since the reply
+	 * could not be delivered anymore. */
+	for (client = data->clients; client; client = client->next) {
+		dl_list_for_each(sess, &client->sessions,
+				 struct radius_session, list) {
+			if (sess->last_tls_conn != conn)
+				continue;
+			sess->last_tls_conn = NULL;
+			radius_msg_free(sess->last_msg);
+			sess->last_msg = NULL;
+		}
+	}
+
+	dl_list_del(&conn->list);
+	data->num_tls_conns--;
+	radius_tls_conn_deinit(conn->conn);
+	os_free(conn);
+}
+
+
+static int radius_server_tls_msg(void *ctx, const u8 *buf, size_t len)
+{
+	struct radius_server_tls_conn *conn = ctx;
+	struct radius_server_data *data = conn->server;
+
+	if (buf[0] == RADIUS_CODE_ACCOUNTING_REQUEST && data->acct_sock >= 0)
+		radius_server_receive_acct_msg(data, buf, len, &conn->addr,
+					       conn->addrlen, conn);
+	else
+		radius_server_receive_auth_msg(data, buf, len, &conn->addr,
+					       conn->addrlen, conn);
+
+	return 0;
+}
+
+
+static void radius_server_tls_closed(void *ctx)
+{
+	struct radius_server_tls_conn *conn = ctx;
+
+	RADIUS_DEBUG("RADIUS/TLS connection closed");
+	radius_server_tls_conn_free(conn->server, conn);
+}
+
+
+static void radius_server_tls_accept(int sock, void *eloop_ctx,
+				     void *sock_ctx)
+{
+	struct radius_server_data *data = eloop_ctx;
+	struct radius_server_tls_conn *conn;
+	union {
+		struct sockaddr_storage ss;
+		struct sockaddr_in sin;
+#ifdef CONFIG_IPV6
+		struct sockaddr_in6 sin6;
+#endif /* CONFIG_IPV6 */
+	} from;
+	socklen_t fromlen = sizeof(from);
+	struct radius_client *client;
+	int s;
+
+	s = accept(sock, (struct sockaddr *) &from.ss, &fromlen);
+	if (s < 0) {
+		wpa_printf(MSG_INFO, "RADIUS SRV: accept: %s", strerror(errno));
+		return;
+	}
+
+#ifdef CONFIG_IPV6
+	if (data->ipv6)
+		client = radius_server_get_client(data,
+						  (struct in_addr *)
+						  &from.sin6.sin6_addr, 1);
+	else
+#endif /* CONFIG_IPV6 */
+	client = radius_server_get_client(data, &from.sin.sin_addr, 0);
+	if (!client) {
+		RADIUS_DEBUG("Unknown client - RADIUS/TLS connection rejected");
+		data->counters.invalid_requests++;
+		close(s);
+		return;
+	}
+
+	if (data->num_tls_conns >= RADIUS_SERVER_MAX_TLS_CONNS) {
+		RADIUS_DEBUG("Too many RADIUS/TLS connections - reject new connection");
+		close(s);
+		return;
+	}
+
+	if (fcntl(s, F_SETFL, O_NONBLOCK) < 0) {
+		wpa_printf(MSG_INFO, "RADIUS SRV: fcntl(O_NONBLOCK): %s",
+			   strerror(errno));
+		close(s);
+		return;
+	}
+
+	conn = os_zalloc(sizeof(*conn));
+	if (!conn) {
+		close(s);
+		return;
+	}
+	conn->server = data;
+	os_memcpy(&conn->addr, &from.ss, fromlen);
+	conn->addrlen = fromlen;
+	conn->conn = radius_tls_server_init(data->eap_cfg->ssl_ctx, s,
+					    data->tls_verify_client,
+					    radius_server_tls_msg,
+					    radius_server_tls_closed, conn);
+	if (!conn->conn) {
+		close(s);
+		os_free(conn);
+		return;
+	}
+
+	dl_list_add(&data->tls_conns, &conn->list);
+	data->num_tls_conns++;
+	RADIUS_DEBUG("New RADIUS/TLS connection (%u active)",
+		     data->num_tls_conns);
+}
+
+
+static int radius_server_open_tls_socket(int port, int ipv6)
+{
+	int s, on = 1;
+	struct sockaddr_in addr;
+#ifdef CONFIG_IPV6
+	struct sockaddr_in6 addr6;
+#endif /* CONFIG_IPV6 */
+	struct sockaddr *sa;
+	socklen_t salen;
+
+#ifdef CONFIG_IPV6
+	if (ipv6) {
+		os_memset(&addr6, 0, sizeof(addr6));
+		addr6.sin6_family = AF_INET6;
+		os_memcpy(&addr6.sin6_addr, &in6addr_any, sizeof(in6addr_any));
+		addr6.sin6_port = htons(port);
+		sa = (struct sockaddr *) &addr6;
+		salen = sizeof(addr6);
+	} else
+#endif /* CONFIG_IPV6 */
+	{
+		os_memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		sa = (struct sockaddr *) &addr;
+		salen = sizeof(addr);
+	}
+
+	s = socket(sa->sa_family, SOCK_STREAM, 0);
+	if (s < 0) {
+		wpa_printf(MSG_INFO, "RADIUS: socket[TLS]: %s",
+			   strerror(errno));
+		return -1;
+	}
+
+	if (setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0)
+		wpa_printf(MSG_DEBUG, "RADIUS: setsockopt(SO_REUSEADDR): %s",
+			   strerror(errno));
+
+	if (bind(s, sa, salen) < 0) {
+		wpa_printf(MSG_INFO, "RADIUS: bind[TLS]: %s", strerror(errno));
+		close(s);
+		return -1;
+	}
+
+	if (listen(s, 10) < 0 || fcntl(s, F_SETFL, O_NONBLOCK) < 0) {
+		wpa_printf(MSG_INFO, "RADIUS: listen[TLS]: %s",
+			   strerror(errno));
+		close(s);
+		return -1;
+	}
+
+	return s;
+}
+
+#endif /* CONFIG_RADIUS_TLS */
+
+
 static void radius_server_free_sessions(struct radius_server_data *data,
-					struct radius_session *sessions)
+					struct dl_list *sessions)
 {
 	struct radius_session *session, *prev;
 
-	session = sessions;
-	while (session) {
-		prev = session;
-		session = session->next;
-		radius_server_session_free(data, prev);
-	}
+	dl_list_for_each_safe(session, prev, sessions, struct radius_session,
+			      list)
+		radius_server_session_free(data, session);
 }
 
 
@@ -2013,7 +2765,7 @@ static void radius_server_free_clients(struct radius_server_data *data,
 		prev = client;
 		client = client->next;
 
-		radius_server_free_sessions(data, prev->sessions);
+		radius_server_free_sessions(data, &prev->sessions);
 		os_free(prev->shared_secret);
 		radius_msg_free(prev->pending_dac_coa_req);
 		radius_msg_free(prev->pending_dac_disconnect_req);
@@ -2134,6 +2886,8 @@ radius_server_read_clients(const char *client_file, int ipv6)
 			break;
 		}
 		entry->shared_secret_len = os_strlen(entry->shared_secret);
+		entry->prefix_len = mask;
+		dl_list_init(&entry->sessions);
 		if (!ipv6) {
 			entry->addr.s_addr = addr.s_addr;
 			val = 0;
@@ -2176,6 +2930,285 @@ radius_server_read_clients(const char *client_file, int ipv6)
 }
 
 
+#ifdef CONFIG_SQLITE
+static int radius_server_open_db(struct radius_server_data *data,
+				 const char *file, int workers)
+{
+	if (sqlite3_open(file, &data->db)) {
+		RADIUS_ERROR("Could not open SQLite file '%s'", file);
+		return -1;
+	}
+
+	/* Each worker process uses its own connection to the database, so
+	 * wait for the locks held by the other processes to be released. */
+	if (workers > 1)
+		sqlite3_busy_timeout(data->db, RADIUS_SERVER_DB_BUSY_TIMEOUT);
+
+	return 0;
+}
+#endif /* CONFIG_SQLITE */
+
+
+static int radius_server_open_auth_socket(struct radius_server_data *data)
+{
+	int reuseport = data->num_workers > 1;
+
+#ifdef CONFIG_IPV6
+	if (data->ipv6)
+		data->auth_sock = radius_server_open_socket6(data->auth_port,
+							     reuseport);
+	else
+#endif /* CONFIG_IPV6 */
+	data->auth_sock = radius_server_open_socket(data->auth_port,
+						    reuseport);
+	if (data->auth_sock < 0) {
+		wpa_printf(MSG_ERROR, "Failed to open UDP socket for RADIUS authentication server");
+		return -1;
+	}
+	if (eloop_register_read_sock_batch(data->auth_sock,
+					   RADIUS_SERVER_RX_BATCH,
+					   RADIUS_MAX_MSG_LEN,
+					   radius_server_receive_auth,
+					   data, NULL))
+		return -1;
+
+	return 0;
+}
+
+
+static void radius_server_workers_fork(void *eloop_ctx, void *user_ctx);
+static void radius_server_worker_tls_stats(void *eloop_ctx, void *user_ctx);
+
+static void radius_server_workers_deinit(struct radius_server_data *data)
+{
+	int i;
+
+	eloop_cancel_timeout(radius_server_workers_fork, data, ELOOP_ALL_CTX);
+	eloop_cancel_timeout(radius_server_worker_tls_stats, data,
+			     ELOOP_ALL_CTX);
+	os_free(data->worker_tls_stats);
+	data->worker_tls_stats = NULL;
+
+	if (data->worker_pids) {
+		for (i = 1; i < data->num_workers; i++) {
+			if (data->worker_pids[i] <= 0)
+				continue;
+			kill(data->worker_pids[i], SIGTERM);
+			waitpid(data->worker_pids[i], NULL, 0);
+		}
+		os_free(data->worker_pids);
+		data->worker_pids = NULL;
+	}
+
+	if (data->worker_socks) {
+		for (i = 0; i < 2 * data->num_workers; i++) {
+			if (data->worker_socks[i] < 0)
+				continue;
+			if (i == 2 * data->worker_id && data->workers_started)
+				eloop_unregister_read_sock(
+					data->worker_socks[i]);
+			close(data->worker_socks[i]);
+		}
+		os_free(data->worker_socks);
+		data->worker_socks = NULL;
+	}
+}
+
+
+static int radius_server_worker_start(struct radius_server_data *data)
+{
+	int i;
+
+	/* Keep only the receive socket of this process and the sockets for
+	 * sending to the other processes. */
+	for (i = 0; i < data->num_workers; i++) {
+		if (i == data->worker_id)
+			continue;
+		close(data->worker_socks[2 * i]);
+		data->worker_socks[2 * i] = -1;
+	}
+
+	data->workers_started = 1;
+	return eloop_register_read_sock(data->worker_socks[2 * data->worker_id],
+					radius_server_receive_worker, data,
+					NULL);
+}
+
+
+static void radius_server_worker_terminate(int sig, void *signal_ctx)
+{
+	eloop_terminate();
+}
+
+
+/* The TLS statistics are per process, so report them to the main process that
+ * serves the MIB. */
+static void radius_server_worker_tls_stats(void *eloop_ctx, void *user_ctx)
+{
+	struct radius_server_data *data = eloop_ctx;
+	struct tls_session_stats stats;
+	u8 buf[sizeof(int) + sizeof(stats)];
+
+	if (data->eap_cfg->ssl_ctx &&
+	    tls_get_session_stats(data->eap_cfg->ssl_ctx, &stats) == 0 &&
+	    os_memcmp(&stats, &data->tls_stats_sent, sizeof(stats)) != 0) {
+		os_memcpy(buf, &data->worker_id, sizeof(int));
+		os_memcpy(buf + sizeof(int), &stats, sizeof(stats));
+		if (radius_server_worker_send(data, 0, RADIUS_WORKER_TLS_STATS,
+					      NULL, 0, buf, sizeof(buf)) == 0)
+			data->tls_stats_sent = stats;
+	}
+
+	eloop_register_timeout(RADIUS_SERVER_TLS_STATS_INTERVAL, 0,
+			       radius_server_worker_tls_stats, data, NULL);
+}
+
+
+static void radius_server_worker_run(struct radius_server_data *data, int id,
+				     pid_t parent)
+{
+	int ret = 1;
+
+	data->worker_id = id;
+	os_free(data->worker_pids);
+	data->worker_pids = NULL;
+	os_free(data->worker_tls_stats);
+	data->worker_tls_stats = NULL;
+#ifdef __linux__
+	/* The workers are forked by the process that is left after
+	 * daemonizing, so exit together with it. */
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+	if (getppid() != parent)
+		exit(1);
+#endif /* __linux__ */
+
+	/* This closes the sockets registered by the main process (driver,
+	 * control interface, RADIUS client and server sockets). The workers
+	 * are forked from an eloop timeout before any RADIUS/TLS connection
+	 * could have been accepted, so only the listening sockets need to be
+	 * forgotten here. */
+	if (eloop_fork_reinit() < 0)
+		exit(1);
+	data->auth_sock = -1;
+	data->acct_sock = -1;
+#ifdef CONFIG_RADIUS_TLS
+	data->tls_sock = -1;
+#endif /* CONFIG_RADIUS_TLS */
+
+#ifdef CONFIG_SQLITE
+	/* SQLite connections cannot be used across fork(), so leave the
+	 * connection of the main process alone and open a new one. */
+	data->db = NULL;
+	if (data->sqlite_file &&
+	    radius_server_open_db(data, data->sqlite_file,
+				  data->num_workers) < 0)
+		goto out;
+#endif /* CONFIG_SQLITE */
+
+	if (radius_server_worker_start(data) < 0 ||
+	    radius_server_open_auth_socket(data) < 0)
+		goto out;
+
+	eloop_register_signal_terminate(radius_server_worker_terminate, data);
+	eloop_register_timeout(RADIUS_SERVER_TLS_STATS_INTERVAL, 0,
+			       radius_server_worker_tls_stats, data, NULL);
+	wpa_printf(MSG_DEBUG, "RADIUS SRV: Worker %d started (pid %d)",
+		   id, (int) getpid());
+	eloop_run();
+	ret = 0;
+out:
+	radius_server_deinit(data);
+	eloop_destroy();
+	exit(ret);
+}
+
+
+static void radius_server_workers_fork(void *eloop_ctx, void *user_ctx)
+{
+	struct radius_server_data *data = eloop_ctx;
+	pid_t parent = getpid();
+	int i;
+
+	/* Do not let the workers write out buffered output again */
+	fflush(NULL);
+
+	for (i = 1; i < data->num_workers; i++) {
+		pid_t pid;
+
+		pid = fork();
+		if (pid < 0) {
+			wpa_printf(MSG_ERROR, "RADIUS: fork: %s",
+				   strerror(errno));
+			break;
+		}
+		if (pid == 0)
+			radius_server_worker_run(data, i, parent);
+		data->worker_pids[i] = pid;
+	}
+
+	/* Requests owned by a worker that could not be started are dropped
+	 * by the kernel (nobody reads the socket), so keep serving the rest
+	 * instead of failing at runtime. */
+	if (radius_server_worker_start(data) < 0)
+		wpa_printf(MSG_ERROR,
+			   "RADIUS: Failed to register worker socket");
+}
+
+
+static int radius_server_workers_init(struct radius_server_data *data,
+				      struct radius_server_conf *conf)
+{
+#ifdef SO_REUSEPORT
+	int i;
+
+	if (conf->workers > RADIUS_SERVER_MAX_WORKERS) {
+		wpa_printf(MSG_ERROR,
+			   "Too many RADIUS server workers (max %d)",
+			   RADIUS_SERVER_MAX_WORKERS);
+		return -1;
+	}
+
+	if (conf->eap_cfg->eap_sim_db_priv) {
+		wpa_printf(MSG_ERROR,
+			   "RADIUS server workers cannot be used with EAP-SIM DB");
+		return -1;
+	}
+
+	data->num_workers = conf->workers;
+	data->worker_socks = os_calloc(2 * data->num_workers, sizeof(int));
+	data->worker_pids = os_calloc(data->num_workers, sizeof(pid_t));
+	data->worker_tls_stats = os_calloc(data->num_workers,
+					   sizeof(struct tls_session_stats));
+	if (!data->worker_socks || !data->worker_pids ||
+	    !data->worker_tls_stats)
+		return -1;
+	for (i = 0; i < 2 * data->num_workers; i++)
+		data->worker_socks[i] = -1;
+
+	for (i = 0; i < data->num_workers; i++) {
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0,
+			       &data->worker_socks[2 * i]) < 0) {
+			wpa_printf(MSG_ERROR, "RADIUS: socketpair: %s",
+				   strerror(errno));
+			return -1;
+		}
+	}
+
+	/* This is called while the interfaces are set up, i.e., before
+	 * hostapd has daemonized itself. Fork the workers only once the event
+	 * loop is running so that they are children of the daemon process.
+	 * Messages passed to them before that are queued in the socket
+	 * pairs. */
+	return eloop_register_timeout(0, 0, radius_server_workers_fork, data,
+				      NULL);
+#else /* SO_REUSEPORT */
+	wpa_printf(MSG_ERROR,
+		   "RADIUS server workers require SO_REUSEPORT support");
+	return -1;
+#endif /* SO_REUSEPORT */
+}
+
+
 /**
  * radius_server_init - Initialize RADIUS server
  * @conf: Configuration for the RADIUS server
@@ -2204,13 +3237,20 @@ radius_server_init(struct radius_server_conf *conf)
 	data->eap_cfg = conf->eap_cfg;
 	data->auth_sock = -1;
 	data->acct_sock = -1;
+#ifdef CONFIG_RADIUS_TLS
+	data->tls_sock = -1;
+	dl_list_init(&data->tls_conns);
+#endif /* CONFIG_RADIUS_TLS */
 	dl_list_init(&data->erp_keys);
 	os_get_reltime(&data->start_time);
 	data->conf_ctx = conf->conf_ctx;
 	conf->eap_cfg->backend_auth = TRUE;
 	conf->eap_cfg->eap_server = 1;
 	data->ipv6 = conf->ipv6;
+	data->max_sess = conf->max_sessions > 0 ? conf->max_sessions :
+		RADIUS_MAX_SESSION;
 	data->get_eap_user = conf->get_eap_user;
+	data->set_ticket_keys = conf->set_ticket_keys;
 	if (conf->eap_req_id_text) {
 		data->eap_req_id_text = os_malloc(conf->eap_req_id_text_len);
 		if (!data->eap_req_id_text)
@@ -2243,11 +3283,11 @@ radius_server_init(struct radius_server_conf *conf)
 
 #ifdef CONFIG_SQLITE
 	if (conf->sqlite_file) {
-		if (sqlite3_open(conf->sqlite_file, &data->db)) {
-			RADIUS_ERROR("Could not open SQLite file '%s'",
-				     conf->sqlite_file);
+		data->sqlite_file = os_strdup(conf->sqlite_file);
+		if (!data->sqlite_file ||
+		    radius_server_open_db(data, conf->sqlite_file,
+					  conf->workers) < 0)
 			goto fail;
-		}
 	}
 #endif /* CONFIG_SQLITE */
 
@@ -2262,43 +3302,64 @@ radius_server_init(struct radius_server_conf *conf)
 		wpa_printf(MSG_ERROR, "No RADIUS clients configured");
 		goto fail;
 	}
+	if (radius_server_build_client_trie(data) < 0)
+		goto fail;
 
-#ifdef CONFIG_IPV6
-	if (conf->ipv6)
-		data->auth_sock = radius_server_open_socket6(conf->auth_port);
-	else
-#endif /* CONFIG_IPV6 */
-	data->auth_sock = radius_server_open_socket(conf->auth_port);
-	if (data->auth_sock < 0) {
-		wpa_printf(MSG_ERROR, "Failed to open UDP socket for RADIUS authentication server");
+	if (conf->workers > 1 && radius_server_workers_init(data, conf) < 0)
 		goto fail;
-	}
-	if (eloop_register_read_sock(data->auth_sock,
-				     radius_server_receive_auth,
-				     data, NULL)) {
+
+	data->auth_port = conf->auth_port;
+	if (radius_server_open_auth_socket(data) < 0)
 		goto fail;
-	}
 
 	if (conf->acct_port) {
 #ifdef CONFIG_IPV6
 		if (conf->ipv6)
 			data->acct_sock = radius_server_open_socket6(
-				conf->acct_port);
+				conf->acct_port, 0);
 		else
 #endif /* CONFIG_IPV6 */
-		data->acct_sock = radius_server_open_socket(conf->acct_port);
+		data->acct_sock = radius_server_open_socket(conf->acct_port,
+							    0);
 		if (data->acct_sock < 0) {
 			wpa_printf(MSG_ERROR, "Failed to open UDP socket for RADIUS accounting server");
 			goto fail;
 		}
-		if (eloop_register_read_sock(data->acct_sock,
-					     radius_server_receive_acct,
-					     data, NULL))
+		if (eloop_register_read_sock_batch(data->acct_sock,
+						   RADIUS_SERVER_RX_BATCH,
+						   RADIUS_MAX_MSG_LEN,
+						   radius_server_receive_acct,
+						   data, NULL))
 			goto fail;
 	} else {
 		data->acct_sock = -1;
 	}
 
+	if (conf->tls_port) {
+#ifdef CONFIG_RADIUS_TLS
+		if (!conf->eap_cfg->ssl_ctx) {
+			wpa_printf(MSG_ERROR,
+				   "RADIUS/TLS server requires server certificate configuration");
+			goto fail;
+		}
+		data->tls_verify_client = conf->tls_verify_client;
+		data->tls_sock = radius_server_open_tls_socket(conf->tls_port,
+							       conf->ipv6);
+		if (data->tls_sock < 0) {
+			wpa_printf(MSG_ERROR, "Failed to open TCP socket for RADIUS/TLS server");
+			goto fail;
+		}
+		if (eloop_register_read_sock(data->tls_sock,
+					     radius_server_tls_accept,
+					     data, NULL))
+			goto fail;
+#else /* CONFIG_RADIUS_TLS */
+		wpa_printf(MSG_ERROR,
+			   "RADIUS server compiled without RADIUS/TLS support");
+		goto fail;
+#endif /* CONFIG_RADIUS_TLS */
+	}
+
 	return data;
 fail:
 	radius_server_deinit(data);
@@ -2338,12 +3399,29 @@ void radius_server_deinit(struct radius_server_data *data)
 		close(data->auth_sock);
 	}
 
+	radius_server_workers_deinit(data);
+
 	if (data->acct_sock >= 0) {
 		eloop_unregister_read_sock(data->acct_sock);
 		close(data->acct_sock);
 	}
 
+#ifdef CONFIG_RADIUS_TLS
+	if (data->tls_sock >= 0) {
+		eloop_unregister_read_sock(data->tls_sock);
+		close(data->tls_sock);
+	}
+
+	while (!dl_list_empty(&data->tls_conns))
+		radius_server_tls_conn_free(
+			data, dl_list_first(&data->tls_conns,
+					    struct radius_server_tls_conn,
+					    list));
+#endif /* CONFIG_RADIUS_TLS */
+
+	radius_client_node_free(data->client_trie);
 	radius_server_free_clients(data, data->clients);
+	hash_table_deinit(&data->sessions);
 
 	os_free(data->eap_req_id_text);
 #ifdef CONFIG_RADIUS_TEST
@@ -2356,6 +3434,7 @@ void radius_server_deinit(struct radius_server_data *data)
 #ifdef CONFIG_SQLITE
 	if (data->db)
 		sqlite3_close(data->db);
+	os_free(data->sqlite_file);
 #endif /* CONFIG_SQLITE */
 
 	radius_server_erp_flush(data);
@@ -2374,11 +3453,13 @@ void radius_server_deinit(struct radius_server_data *data)
 int radius_server_get_mib(struct radius_server_data *data, char *buf,
 			  size_t buflen)
 {
-	int ret, uptime;
+	int ret, uptime, i;
 	unsigned int idx;
 	char *end, *pos;
 	struct os_reltime now;
 	struct radius_client *cli;
+	struct hash_table_stats sess_stats;
+	struct tls_session_stats tls_stats;
 
 	/* RFC 2619 - RADIUS Authentication Server MIB */
 
@@ -2443,6 +3524,59 @@ int radius_server_get_mib(struct radius_server_data *data, char *buf,
 	}
 	pos += ret;
 
+	hash_table_get_stats(&data->sessions, &sess_stats);
+	ret = os_snprintf(pos, end - pos,
+			  "radiusServClientTrieNodes=%u\n"
+			  "radiusServClientLookups=%u\n"
+			  "radiusServClientLookupNodes=%u\n"
+			  "radiusServSessionLookups=%u\n"
+			  "radiusServSessionLookupMisses=%u\n"
+			  "radiusServSessionHashEntries=%u\n"
+			  "radiusServSessionHashBuckets=%u\n"
+			  "radiusServSessionHashUsedBuckets=%u\n"
+			  "radiusServSessionHashMaxChain=%u\n",
+			  data->client_trie_nodes,
+			  data->client_lookups,
+			  data->client_lookup_nodes,
+			  data->session_lookups,
+			  data->session_lookup_misses,
+			  (unsigned int) sess_stats.entries,
+			  (unsigned int) sess_stats.buckets,
+			  (unsigned int) sess_stats.used_buckets,
+			  (unsigned int) sess_stats.max_chain);
+	if (os_snprintf_error(end - pos, ret)) {
+		*pos = '\0';
+		return pos - buf;
+	}
+	pos += ret;
+
+	if (data->eap_cfg->ssl_ctx &&
+	    tls_get_session_stats(data->eap_cfg->ssl_ctx, &tls_stats) == 0) {
+		/* Include the latest reports from the workers */
+		for (i = 1; data->worker_tls_stats && i < data->num_workers;
+		     i++) {
+			struct tls_session_stats *w = &data->worker_tls_stats[i];
+
+			tls_stats.resumed += w->resumed;
+			tls_stats.full += w->full;
+			tls_stats.tickets_issued += w->tickets_issued;
+			tls_stats.ticket_key_misses += w->ticket_key_misses;
+		}
+		ret = os_snprintf(pos, end - pos,
+				  "radiusServTlsSessionResumptions=%u\n"
+				  "radiusServTlsFullHandshakes=%u\n"
+				  "radiusServTlsTicketsIssued=%u\n"
+				  "radiusServTlsTicketKeyMisses=%u\n",
+				  tls_stats.resumed, tls_stats.full,
+				  tls_stats.tickets_issued,
+				  tls_stats.ticket_key_misses);
+		if (os_snprintf_error(end - pos, ret)) {
+			*pos = '\0';
+			return pos - buf;
+		}
+		pos += ret;
+	}
+
 	for (cli = data->clients, idx = 0; cli; cli = cli->next, idx++) {
 		char abuf[50], mbuf[50];
 #ifdef CONFIG_IPV6
@@ -2574,6 +3708,16 @@ static int radius_server_erp_add_key(void *ctx, struct eap_server_erp_key *erp)
 	struct radius_session *sess = ctx;
 	struct radius_server_data *data = sess->server;
 
+	if (data->num_workers > 1 && data->worker_id != 0) {
+		/* Hand the key over to the main process that processes all
+		 * EAP-Initiate/Re-auth messages. The local copy is kept only
+		 * since the caller still references it. */
+		radius_server_worker_send(
+			data, 0, RADIUS_WORKER_ERP_KEY, NULL, 0, &erp->rRK_len,
+			offsetof(struct eap_server_erp_key, keyname_nai) -
+			offsetof(struct eap_server_erp_key, rRK_len) +
+			os_strlen(erp->keyname_nai) + 1);
+	}
 	dl_list_add(&data->erp_keys, &erp->list);
 	return 0;
 }
@@ -2595,6 +3739,37 @@ static const struct eapol_callbacks radius_server_eapol_cb =
 };
 
 
+/**
+ * radius_server_set_ticket_keys - Pass TLS session ticket keys to the workers
+ * @data: RADIUS server context from radius_server_init()
+ * @keys: Array of num_keys keys of TLS_SESSION_TICKET_KEY_LEN octets each
+ * @num_keys: Number of keys
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is called after the main process has taken a new key ring into use.
+ * The worker processes take it into use with the set_ticket_keys() callback.
+ */
+int radius_server_set_ticket_keys(struct radius_server_data *data,
+				  const u8 *keys, size_t num_keys)
+{
+	int i, ret = 0;
+
+	if (!data || data->num_workers <= 1 || data->worker_id != 0)
+		return 0;
+
+	for (i = 1; i < data->num_workers; i++) {
+		if (radius_server_worker_send(data, i,
+					      RADIUS_WORKER_TICKET_KEYS,
+					      NULL, 0, keys,
+					      num_keys *
+					      TLS_SESSION_TICKET_KEY_LEN) < 0)
+			ret = -1;
+	}
+
+	return ret;
+}
+
+
 /**
  * radius_server_eap_pending_cb - Pending EAP data notification
  * @data: RADIUS server context from radius_server_init()
@@ -2613,7 +3788,8 @@ void radius_server_eap_pending_cb(struct radius_server_data *data, void *ctx)
 		return;
 
 	for (cli = data->clients; cli; cli = cli->next) {
-		for (s = cli->sessions; s; s = s->next) {
+		dl_list_for_each(s, &cli->sessions, struct radius_session,
+				 list) {
 			if (s->eap == ctx && s->last_msg) {
 				sess = s;
 				break;
@@ -2633,7 +3809,7 @@ void radius_server_eap_pending_cb(struct radius_server_data *data, void *ctx)
 	eap_sm_pending_cb(sess->eap);
 	if (radius_server_request(data, msg,
 				  (struct sockaddr *) &sess->last_from,
-				  sess->last_fromlen, cli,
+				  sess->last_fromlen, sess->last_tls_conn, cli,
 				  sess->last_from_addr,
 				  sess->last_from_port, sess) == -2)
 		return; /* msg was stored with the session */
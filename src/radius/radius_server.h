@@ -26,6 +26,40 @@ struct radius_server_conf {
 	 */
 	int acct_port;
 
+	/**
+	 * tls_port - TCP port to listen to as a RADIUS/TLS server or 0
+	 *
+	 * RADIUS/TLS (RFC 6614) connections use the TLS server credentials
+	 * from eap_cfg->ssl_ctx and the same client file as the UDP server.
+	 * The shared secret configured for the client is expected to be
+	 * "radsec".
+	 */
+	int tls_port;
+
+	/**
+	 * tls_verify_client - Whether to require RADIUS/TLS client certificate
+	 */
+	int tls_verify_client;
+
+	/**
+	 * workers - Number of processes serving authentication requests
+	 *
+	 * With a value larger than one, the server forks workers - 1 child
+	 * processes that share auth_port with SO_REUSEPORT. Access-Requests
+	 * that continue an EAP session (State attribute) are handed over to
+	 * the process that owns the session and ERP keys are stored in the
+	 * main process. Accounting, RADIUS/TLS, and Dynamic Authorization are
+	 * handled only by the main process. TLS session ticket keys updated
+	 * with radius_server_set_ticket_keys() are passed to the workers and
+	 * the TLS statistics in the MIB include the workers.
+	 */
+	int workers;
+
+	/**
+	 * max_sessions - Maximum number of active sessions or 0 for default
+	 */
+	int max_sessions;
+
 	/**
 	 * client_file - RADIUS client configuration file
 	 *
@@ -35,7 +69,9 @@ struct radius_server_conf {
 	 * with an optional address mask to allow full network to be specified
 	 * (e.g., 192.168.1.2 or 192.168.1.0/24). This is followed by white
 	 * space (space or tabulator) and the shared secret. Lines starting
-	 * with '#' are skipped and can be used as comments.
+	 * with '#' are skipped and can be used as comments. If the source
+	 * address matches multiple entries, the one with the longest prefix is
+	 * used.
 	 */
 	char *client_file;
 
@@ -75,6 +111,18 @@ struct radius_server_conf {
 	int (*get_eap_user)(void *ctx, const u8 *identity, size_t identity_len,
 			    int phase2, struct eap_user *user);
 
+	/**
+	 * set_ticket_keys - Callback for updating TLS session ticket keys
+	 * @ctx: Context data from conf_ctx
+	 * @keys: Array of num_keys keys of TLS_SESSION_TICKET_KEY_LEN octets
+	 * @num_keys: Number of keys
+	 * Returns: 0 on success, -1 on failure
+	 *
+	 * This is called in the worker processes when the main process has
+	 * passed a new key ring with radius_server_set_ticket_keys().
+	 */
+	int (*set_ticket_keys)(void *ctx, const u8 *keys, size_t num_keys);
+
 	/**
 	 * eap_req_id_text - Optional data for EAP-Request/Identity
 	 *
@@ -115,6 +163,8 @@ void radius_server_deinit(struct radius_server_data *data);
 int radius_server_get_mib(struct radius_server_data *data, char *buf,
 			  size_t buflen);
 
+int radius_server_set_ticket_keys(struct radius_server_data *data,
+				  const u8 *keys, size_t num_keys);
 void radius_server_eap_pending_cb(struct radius_server_data *data, void *ctx);
 int radius_server_dac_request(struct radius_server_data *data, const char *req);
 
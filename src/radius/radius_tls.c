@@ -0,0 +1,587 @@
+/*
+ * RADIUS over TLS (RadSec) connections
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This implements the TCP and TLS framing of RFC 6614 on top of the TLS
+ * library wrapper (crypto/tls.h) so that the same code can be used for both
+ * the RADIUS client and the RADIUS server.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "crypto/tls.h"
+#include "radius.h"
+#include "radius_tls.h"
+
+/**
+ * RADIUS_TLS_HANDSHAKE_TIMEOUT - Time limit for connection setup in seconds
+ */
+#define RADIUS_TLS_HANDSHAKE_TIMEOUT 10
+
+/**
+ * RADIUS_TLS_MAX_RECORD_LEN - Maximum TLS record length including the header
+ */
+#define RADIUS_TLS_MAX_RECORD_LEN (5 + 16384 + 2048)
+
+#define RADIUS_TLS_MAX_MSG_LEN 4096
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif /* MSG_NOSIGNAL */
+
+
+struct radius_tls_conn {
+	void *tls_ctx;
+	struct tls_connection *tls;
+	int s;
+	int server;
+	int connecting;
+	int established;
+	int write_registered;
+
+	struct wpabuf *in; /* received data that is not yet a full record */
+	struct wpabuf *appl; /* decrypted data that is not yet a full message */
+	struct wpabuf *out; /* TLS records waiting for the socket */
+	struct wpabuf *queued; /* RADIUS messages waiting for the handshake */
+
+	radius_tls_msg_cb msg_cb;
+	radius_tls_close_cb close_cb;
+	void *ctx;
+};
+
+
+/* Remove len octets from the beginning of the buffer */
+static void radius_tls_consume(struct wpabuf *buf, size_t len)
+{
+	u8 *pos = wpabuf_mhead_u8(buf);
+
+	os_memmove(pos, pos + len, wpabuf_len(buf) - len);
+	buf->used -= len;
+}
+
+
+static int radius_tls_append(struct wpabuf **buf, const u8 *data, size_t len)
+{
+	if (wpabuf_resize(buf, len) < 0)
+		return -1;
+	wpabuf_put_data(*buf, data, len);
+	return 0;
+}
+
+
+static void radius_tls_conn_failed(struct radius_tls_conn *conn)
+{
+	wpa_printf(MSG_DEBUG, "RADIUS/TLS: Connection failed (s=%d)", conn->s);
+	conn->close_cb(conn->ctx);
+}
+
+
+static void radius_tls_conn_fail_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	radius_tls_conn_failed(eloop_ctx);
+}
+
+
+/* Report a failure from a context where the connection cannot be freed */
+static void radius_tls_conn_fail_later(struct radius_tls_conn *conn)
+{
+	eloop_cancel_timeout(radius_tls_conn_fail_timeout, conn, NULL);
+	eloop_register_timeout(0, 0, radius_tls_conn_fail_timeout, conn, NULL);
+}
+
+
+static void radius_tls_conn_writable(int sock, void *eloop_ctx,
+				     void *sock_ctx);
+
+
+static int radius_tls_conn_flush(struct radius_tls_conn *conn)
+{
+	int res;
+
+	while (conn->out && wpabuf_len(conn->out) > 0) {
+		res = send(conn->s, wpabuf_head(conn->out),
+			   wpabuf_len(conn->out), MSG_NOSIGNAL);
+		if (res < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK &&
+			    errno != EINTR) {
+				wpa_printf(MSG_INFO, "send[RADIUS/TLS]: %s",
+					   strerror(errno));
+				return -1;
+			}
+			if (!conn->write_registered &&
+			    eloop_register_sock(conn->s, EVENT_TYPE_WRITE,
+						radius_tls_conn_writable, conn,
+						NULL) < 0)
+				return -1;
+			conn->write_registered = 1;
+			return 0;
+		}
+		radius_tls_consume(conn->out, res);
+	}
+
+	if (conn->write_registered) {
+		eloop_unregister_sock(conn->s, EVENT_TYPE_WRITE);
+		conn->write_registered = 0;
+	}
+	return 0;
+}
+
+
+static int radius_tls_conn_output(struct radius_tls_conn *conn,
+				  const struct wpabuf *data)
+{
+	if (!data || wpabuf_len(data) == 0)
+		return 0;
+	if (radius_tls_append(&conn->out, wpabuf_head(data),
+			      wpabuf_len(data)) < 0)
+		return -1;
+	return radius_tls_conn_flush(conn);
+}
+
+
+static int radius_tls_conn_encrypt(struct radius_tls_conn *conn,
+				   const u8 *msg, size_t len)
+{
+	struct wpabuf in, *out;
+	int res;
+
+	wpabuf_set(&in, msg, len);
+	out = tls_connection_encrypt(conn->tls_ctx, conn->tls, &in);
+	if (!out) {
+		wpa_printf(MSG_INFO, "RADIUS/TLS: Failed to encrypt message");
+		return -1;
+	}
+	res = radius_tls_conn_output(conn, out);
+	wpabuf_free(out);
+	return res;
+}
+
+
+/* Send the messages that were queued while the handshake was in progress */
+static int radius_tls_conn_send_queued(struct radius_tls_conn *conn)
+{
+	const u8 *pos, *end;
+	size_t len;
+	int res = 0;
+
+	if (!conn->queued)
+		return 0;
+
+	pos = wpabuf_head(conn->queued);
+	end = pos + wpabuf_len(conn->queued);
+	while (res == 0 && end - pos >= 4) {
+		len = WPA_GET_BE16(pos + 2);
+		if (len > (size_t) (end - pos))
+			break;
+		res = radius_tls_conn_encrypt(conn, pos, len);
+		pos += len;
+	}
+
+	wpabuf_free(conn->queued);
+	conn->queued = NULL;
+	return res;
+}
+
+
+static int radius_tls_conn_start(struct radius_tls_conn *conn)
+{
+	struct wpabuf *out;
+	int res;
+
+	out = tls_connection_handshake(conn->tls_ctx, conn->tls, NULL, NULL);
+	if (!out) {
+		wpa_printf(MSG_INFO, "RADIUS/TLS: Failed to start handshake");
+		return -1;
+	}
+	res = radius_tls_conn_output(conn, out);
+	wpabuf_free(out);
+	return res;
+}
+
+
+static void radius_tls_conn_writable(int sock, void *eloop_ctx,
+				     void *sock_ctx)
+{
+	struct radius_tls_conn *conn = eloop_ctx;
+	int err = 0;
+	socklen_t optlen = sizeof(err);
+
+	if (conn->connecting) {
+		conn->connecting = 0;
+		if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (void *) &err,
+			       &optlen) < 0)
+			err = errno;
+		if (err) {
+			wpa_printf(MSG_INFO, "RADIUS/TLS: connect: %s",
+				   strerror(err));
+			radius_tls_conn_failed(conn);
+			return;
+		}
+		wpa_printf(MSG_DEBUG, "RADIUS/TLS: TCP connection established");
+		if (radius_tls_conn_start(conn) < 0) {
+			radius_tls_conn_failed(conn);
+			return;
+		}
+	}
+
+	if (radius_tls_conn_flush(conn) < 0)
+		radius_tls_conn_failed(conn);
+}
+
+
+/* Process a single complete TLS record */
+static int radius_tls_conn_process_record(struct radius_tls_conn *conn,
+					  const u8 *rec, size_t len)
+{
+	struct wpabuf in, *out, *appl = NULL;
+	int res = 0;
+
+	wpabuf_set(&in, rec, len);
+
+	if (conn->established) {
+		/* With TLS v1.3, post-handshake messages (NewSessionTicket and
+		 * KeyUpdate) use records that do not contain any application
+		 * data, i.e., an empty buffer is not an error. */
+		appl = tls_connection_decrypt(conn->tls_ctx, conn->tls, &in);
+		if (!appl) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS/TLS: Failed to decrypt record");
+			return -1;
+		}
+		goto appl_data;
+	}
+
+	if (conn->server)
+		out = tls_connection_server_handshake(conn->tls_ctx, conn->tls,
+						      &in, &appl);
+	else
+		out = tls_connection_handshake(conn->tls_ctx, conn->tls, &in,
+					       &appl);
+	/* No output is not an error as such since a record may contain only
+	 * a part of the peer's handshake flight. A client side failure
+	 * results in the server closing the connection. */
+	if (out)
+		res = radius_tls_conn_output(conn, out);
+	wpabuf_free(out);
+	if (res < 0 || tls_connection_get_failed(conn->tls_ctx, conn->tls)) {
+		wpa_printf(MSG_INFO, "RADIUS/TLS: TLS handshake failed");
+		wpabuf_free(appl);
+		return -1;
+	}
+
+	if (tls_connection_established(conn->tls_ctx, conn->tls)) {
+		wpa_printf(MSG_DEBUG, "RADIUS/TLS: TLS connection established");
+		conn->established = 1;
+		eloop_cancel_timeout(radius_tls_conn_fail_timeout, conn, NULL);
+		if (radius_tls_conn_send_queued(conn) < 0) {
+			wpabuf_free(appl);
+			return -1;
+		}
+	}
+
+appl_data:
+	if (appl && wpabuf_len(appl) > 0)
+		res = radius_tls_append(&conn->appl, wpabuf_head(appl),
+					wpabuf_len(appl));
+	wpabuf_free(appl);
+	return res;
+}
+
+
+/*
+ * Deliver the complete RADIUS messages from the decrypted data. Returns 1 if
+ * the connection was freed by the message handler.
+ */
+static int radius_tls_conn_deliver(struct radius_tls_conn *conn)
+{
+	const u8 *pos;
+	size_t len, used = 0, avail;
+
+	while (conn->appl) {
+		pos = wpabuf_head_u8(conn->appl) + used;
+		avail = wpabuf_len(conn->appl) - used;
+		if (avail < 4)
+			break;
+		len = WPA_GET_BE16(pos + 2);
+		if (len < sizeof(struct radius_hdr) ||
+		    len > RADIUS_TLS_MAX_MSG_LEN) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS/TLS: Invalid RADIUS message length %u",
+				   (unsigned int) len);
+			return -1;
+		}
+		if (len > avail)
+			break;
+		used += len;
+		if (conn->msg_cb(conn->ctx, pos, len))
+			return 1;
+	}
+
+	if (used)
+		radius_tls_consume(conn->appl, used);
+	return 0;
+}
+
+
+static void radius_tls_conn_receive(int sock, void *eloop_ctx,
+				    void *sock_ctx)
+{
+	struct radius_tls_conn *conn = eloop_ctx;
+	u8 buf[4096];
+	const u8 *pos, *end;
+	size_t len;
+	int res;
+
+	res = recv(sock, buf, sizeof(buf), 0);
+	if (res < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return;
+		wpa_printf(MSG_INFO, "recv[RADIUS/TLS]: %s", strerror(errno));
+		radius_tls_conn_failed(conn);
+		return;
+	}
+	if (res == 0) {
+		wpa_printf(MSG_DEBUG, "RADIUS/TLS: Connection closed by peer");
+		radius_tls_conn_failed(conn);
+		return;
+	}
+
+	if (radius_tls_append(&conn->in, buf, res) < 0) {
+		radius_tls_conn_failed(conn);
+		return;
+	}
+
+	/* The TLS library is given one complete record at a time since TCP
+	 * does not preserve the record boundaries. */
+	pos = wpabuf_head(conn->in);
+	end = pos + wpabuf_len(conn->in);
+	while (end - pos >= 5) {
+		len = 5 + WPA_GET_BE16(pos + 3);
+		if (len > RADIUS_TLS_MAX_RECORD_LEN) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS/TLS: Too long TLS record (%u)",
+				   (unsigned int) len);
+			radius_tls_conn_failed(conn);
+			return;
+		}
+		if (len > (size_t) (end - pos))
+			break;
+		if (radius_tls_conn_process_record(conn, pos, len) < 0) {
+			radius_tls_conn_failed(conn);
+			return;
+		}
+		pos += len;
+	}
+	radius_tls_consume(conn->in, pos - wpabuf_head_u8(conn->in));
+
+	res = radius_tls_conn_deliver(conn);
+	if (res < 0)
+		radius_tls_conn_failed(conn);
+}
+
+
+static struct radius_tls_conn *
+radius_tls_conn_alloc(void *tls_ctx, int s, int server,
+		      radius_tls_msg_cb msg_cb, radius_tls_close_cb close_cb,
+		      void *ctx)
+{
+	struct radius_tls_conn *conn;
+
+	conn = os_zalloc(sizeof(*conn));
+	if (!conn)
+		return NULL;
+	conn->tls_ctx = tls_ctx;
+	conn->s = s;
+	conn->server = server;
+	conn->msg_cb = msg_cb;
+	conn->close_cb = close_cb;
+	conn->ctx = ctx;
+
+	conn->tls = tls_connection_init(tls_ctx);
+	if (!conn->tls) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS/TLS: Failed to initialize TLS connection");
+		os_free(conn);
+		return NULL;
+	}
+
+	return conn;
+}
+
+
+static int radius_tls_conn_register(struct radius_tls_conn *conn)
+{
+	if (eloop_register_read_sock(conn->s, radius_tls_conn_receive, conn,
+				     NULL) < 0)
+		return -1;
+	eloop_register_timeout(RADIUS_TLS_HANDSHAKE_TIMEOUT, 0,
+			       radius_tls_conn_fail_timeout, conn, NULL);
+	return 0;
+}
+
+
+static void radius_tls_conn_free(struct radius_tls_conn *conn)
+{
+	tls_connection_deinit(conn->tls_ctx, conn->tls);
+	os_free(conn);
+}
+
+
+/**
+ * radius_tls_client_init - Start RADIUS over TLS as a client
+ * @tls_ctx: TLS context from tls_init()
+ * @s: Non-blocking TCP socket on which connect() has been started
+ * @params: TLS connection parameters
+ * @msg_cb: Handler for received RADIUS messages
+ * @close_cb: Handler for connection failures
+ * @ctx: Context data for the handlers
+ * Returns: Pointer to the connection or %NULL on failure
+ *
+ * The socket is owned by the connection once this function returns
+ * successfully and it is closed in radius_tls_conn_deinit(). The TLS handshake
+ * is started once the TCP connection has been established.
+ */
+struct radius_tls_conn *
+radius_tls_client_init(void *tls_ctx, int s,
+		       const struct tls_connection_params *params,
+		       radius_tls_msg_cb msg_cb, radius_tls_close_cb close_cb,
+		       void *ctx)
+{
+	struct radius_tls_conn *conn;
+
+	conn = radius_tls_conn_alloc(tls_ctx, s, 0, msg_cb, close_cb, ctx);
+	if (!conn)
+		return NULL;
+
+	if (tls_connection_set_params(tls_ctx, conn->tls, params)) {
+		wpa_printf(MSG_INFO, "RADIUS/TLS: Failed to set TLS parameters");
+		goto fail;
+	}
+
+	conn->connecting = 1;
+	if (eloop_register_sock(s, EVENT_TYPE_WRITE, radius_tls_conn_writable,
+				conn, NULL) < 0)
+		goto fail;
+	conn->write_registered = 1;
+
+	if (radius_tls_conn_register(conn) < 0) {
+		eloop_unregister_sock(s, EVENT_TYPE_WRITE);
+		goto fail;
+	}
+
+	return conn;
+
+fail:
+	radius_tls_conn_free(conn);
+	return NULL;
+}
+
+
+/**
+ * radius_tls_server_init - Start RADIUS over TLS as a server
+ * @tls_ctx: TLS context from tls_init() with the server credentials
+ * @s: Non-blocking TCP socket from accept()
+ * @verify_peer: Whether to require a valid client certificate
+ * @msg_cb: Handler for received RADIUS messages
+ * @close_cb: Handler for connection failures
+ * @ctx: Context data for the handlers
+ * Returns: Pointer to the connection or %NULL on failure
+ *
+ * The socket is owned by the connection once this function returns
+ * successfully and it is closed in radius_tls_conn_deinit().
+ */
+struct radius_tls_conn *
+radius_tls_server_init(void *tls_ctx, int s, int verify_peer,
+		       radius_tls_msg_cb msg_cb, radius_tls_close_cb close_cb,
+		       void *ctx)
+{
+	struct radius_tls_conn *conn;
+
+	conn = radius_tls_conn_alloc(tls_ctx, s, 1, msg_cb, close_cb, ctx);
+	if (!conn)
+		return NULL;
+
+	if (tls_connection_set_verify(tls_ctx, conn->tls, verify_peer, 0,
+				      NULL, 0)) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS/TLS: Failed to configure peer verification");
+		goto fail;
+	}
+
+	if (radius_tls_conn_register(conn) < 0)
+		goto fail;
+
+	return conn;
+
+fail:
+	radius_tls_conn_free(conn);
+	return NULL;
+}
+
+
+/**
+ * radius_tls_conn_deinit - Close a RADIUS over TLS connection
+ * @conn: Connection from radius_tls_client_init() or
+ *	radius_tls_server_init() or %NULL
+ */
+void radius_tls_conn_deinit(struct radius_tls_conn *conn)
+{
+	if (!conn)
+		return;
+
+	eloop_cancel_timeout(radius_tls_conn_fail_timeout, conn, NULL);
+	eloop_unregister_read_sock(conn->s);
+	if (conn->write_registered)
+		eloop_unregister_sock(conn->s, EVENT_TYPE_WRITE);
+	close(conn->s);
+	wpabuf_free(conn->in);
+	wpabuf_free(conn->appl);
+	wpabuf_free(conn->out);
+	wpabuf_free(conn->queued);
+	radius_tls_conn_free(conn);
+}
+
+
+/**
+ * radius_tls_conn_send - Send a RADIUS message over a TLS connection
+ * @conn: Connection from radius_tls_client_init() or
+ *	radius_tls_server_init()
+ * @msg: RADIUS message
+ * Returns: 0 on success, -1 on failure
+ *
+ * Messages that are sent before the TLS handshake has been completed are
+ * queued and sent once the connection is established. Failures to send the
+ * data are reported asynchronously through the close_cb() handler.
+ */
+int radius_tls_conn_send(struct radius_tls_conn *conn,
+			 const struct wpabuf *msg)
+{
+	if (!conn->established)
+		return radius_tls_append(&conn->queued, wpabuf_head(msg),
+					 wpabuf_len(msg));
+
+	if (radius_tls_conn_encrypt(conn, wpabuf_head(msg),
+				    wpabuf_len(msg)) < 0) {
+		radius_tls_conn_fail_later(conn);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * radius_tls_conn_established - Whether the TLS handshake has been completed
+ * @conn: Connection from radius_tls_client_init() or
+ *	radius_tls_server_init()
+ * Returns: 1 if the connection can be used for sending messages, 0 if not
+ */
+int radius_tls_conn_established(struct radius_tls_conn *conn)
+{
+	return conn->established;
+}
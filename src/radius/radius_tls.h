@@ -0,0 +1,60 @@
+/*
+ * RADIUS over TLS (RadSec) connections
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef RADIUS_TLS_H
+#define RADIUS_TLS_H
+
+struct radius_tls_conn;
+struct tls_connection_params;
+
+/**
+ * RADIUS_TLS_PORT - Default TCP port for RADIUS over TLS (RFC 6614)
+ */
+#define RADIUS_TLS_PORT 2083
+
+/**
+ * RADIUS_TLS_SHARED_SECRET - Shared secret used with RADIUS over TLS
+ */
+#define RADIUS_TLS_SHARED_SECRET "radsec"
+
+/**
+ * radius_tls_msg_cb - Received RADIUS message handler
+ * @ctx: Context data from radius_tls_client_init() or
+ *	radius_tls_server_init()
+ * @buf: RADIUS message
+ * @len: Length of the RADIUS message in octets
+ * Returns: 0 to continue or 1 if the connection was freed by the handler
+ */
+typedef int (*radius_tls_msg_cb)(void *ctx, const u8 *buf, size_t len);
+
+/**
+ * radius_tls_close_cb - Connection failure handler
+ * @ctx: Context data from radius_tls_client_init() or
+ *	radius_tls_server_init()
+ *
+ * This is called when the TCP connection is closed by the peer or the TLS
+ * handshake or the connection fails. The handler is expected to free the
+ * connection with radius_tls_conn_deinit().
+ */
+typedef void (*radius_tls_close_cb)(void *ctx);
+
+struct radius_tls_conn *
+radius_tls_client_init(void *tls_ctx, int s,
+		       const struct tls_connection_params *params,
+		       radius_tls_msg_cb msg_cb, radius_tls_close_cb close_cb,
+		       void *ctx);
+struct radius_tls_conn *
+radius_tls_server_init(void *tls_ctx, int s, int verify_peer,
+		       radius_tls_msg_cb msg_cb, radius_tls_close_cb close_cb,
+		       void *ctx);
+void radius_tls_conn_deinit(struct radius_tls_conn *conn);
+int radius_tls_conn_send(struct radius_tls_conn *conn,
+			 const struct wpabuf *msg);
+int radius_tls_conn_established(struct radius_tls_conn *conn);
+
+#endif /* RADIUS_TLS_H */
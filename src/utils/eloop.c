@@ -6,6 +6,13 @@
  * See README for more details.
  */
 
+#if defined(__linux__) && !defined(CONFIG_NO_RECVMMSG)
+#define ELOOP_RECVMMSG
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* recvmmsg() */
+#endif /* _GNU_SOURCE */
+#endif /* __linux__ && !CONFIG_NO_RECVMMSG */
+
 #include "includes.h"
 #include <assert.h>
 
@@ -50,8 +57,10 @@ struct eloop_sock {
 };
 
 struct eloop_timeout {
-	struct dl_list list;
+	struct dl_list list; /* eloop.timeout_hash bucket */
 	struct os_reltime time;
+	u64 seq; /* registration order for timeouts with equal expiry time */
+	size_t heap_idx; /* index in eloop.timeout_heap */
 	void *eloop_data;
 	void *user_data;
 	eloop_timeout_handler handler;
@@ -60,6 +69,26 @@ struct eloop_timeout {
 	WPA_TRACE_INFO
 };
 
+struct eloop_batch_sock {
+	struct dl_list list;
+	int sock;
+	eloop_batch_handler handler;
+	void *eloop_data;
+	void *user_data;
+	size_t max_msgs;
+	size_t max_len;
+	u8 *bufs;
+	struct sockaddr_storage *from;
+	struct eloop_datagram *msgs;
+	struct eloop_datagram_batch batch;
+#ifdef ELOOP_RECVMMSG
+	struct mmsghdr *mmsg;
+	struct iovec *iov;
+#endif /* ELOOP_RECVMMSG */
+	int in_handler;
+	int removed;
+};
+
 struct eloop_signal {
 	int sig;
 	void *user_data;
@@ -102,7 +131,21 @@ struct eloop_data {
 	struct eloop_sock_table writers;
 	struct eloop_sock_table exceptions;
 
-	struct dl_list timeout;
+	struct dl_list batch_socks; /* struct eloop_batch_sock */
+
+	/*
+	 * Registered timeouts are kept in a binary min-heap ordered by expiry
+	 * time (and registration order for equal times) and indexed by a hash
+	 * table keyed by (handler, eloop_data, user_data) so that
+	 * registration, cancellation, and lookups do not need to go through
+	 * all the pending timeouts.
+	 */
+	struct eloop_timeout **timeout_heap;
+	size_t timeout_count;
+	size_t timeout_heap_size;
+	struct dl_list *timeout_hash;
+	size_t timeout_hash_size; /* number of buckets; power of two */
+	u64 timeout_seq;
 
 	size_t signal_count;
 	struct eloop_signal *signals;
@@ -163,7 +206,7 @@ static void eloop_trace_sock_remove_ref(struct eloop_sock_table *table)
 int eloop_init(void)
 {
 	os_memset(&eloop, 0, sizeof(eloop));
-	dl_list_init(&eloop.timeout);
+	dl_list_init(&eloop.batch_socks);
 #ifdef CONFIG_ELOOP_EPOLL
 	eloop.epollfd = epoll_create1(0);
 	if (eloop.epollfd < 0) {
@@ -695,12 +738,13 @@ int eloop_sock_requeue(void)
 }
 
 
-static void eloop_sock_table_destroy(struct eloop_sock_table *table)
+static void eloop_sock_table_destroy(struct eloop_sock_table *table,
+				     int report)
 {
 	if (table) {
 		size_t i;
 
-		for (i = 0; i < table->count && table->table; i++) {
+		for (i = 0; report && i < table->count && table->table; i++) {
 			wpa_printf(MSG_INFO, "ELOOP: remaining socket: "
 				   "sock=%d eloop_data=%p user_data=%p "
 				   "handler=%p",
@@ -732,6 +776,172 @@ void eloop_unregister_read_sock(int sock)
 }
 
 
+static void eloop_batch_sock_free(struct eloop_batch_sock *b)
+{
+#ifdef ELOOP_RECVMMSG
+	os_free(b->mmsg);
+	os_free(b->iov);
+#endif /* ELOOP_RECVMMSG */
+	os_free(b->msgs);
+	os_free(b->from);
+	os_free(b->bufs);
+	os_free(b);
+}
+
+
+static void eloop_batch_sock_remove(struct eloop_batch_sock *b)
+{
+	dl_list_del(&b->list);
+	if (b->in_handler) {
+		/* Freed once the handler returns */
+		b->removed = 1;
+		b->batch.num = 0;
+	} else {
+		eloop_batch_sock_free(b);
+	}
+}
+
+
+static void eloop_batch_sock_receive(int sock, void *eloop_ctx,
+				     void *sock_ctx)
+{
+	struct eloop_batch_sock *b = eloop_ctx;
+	size_t i, num = 0;
+#ifdef ELOOP_RECVMMSG
+	int res;
+
+	for (i = 0; i < b->max_msgs; i++) {
+		b->iov[i].iov_base = b->msgs[i].buf;
+		b->iov[i].iov_len = b->max_len;
+		os_memset(&b->mmsg[i], 0, sizeof(b->mmsg[i]));
+		b->mmsg[i].msg_hdr.msg_name = &b->from[i];
+		b->mmsg[i].msg_hdr.msg_namelen = sizeof(b->from[i]);
+		b->mmsg[i].msg_hdr.msg_iov = &b->iov[i];
+		b->mmsg[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	res = recvmmsg(sock, b->mmsg, b->max_msgs, MSG_DONTWAIT, NULL);
+	if (res < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			wpa_printf(MSG_INFO, "eloop: recvmmsg(sock=%d): %s",
+				   sock, strerror(errno));
+		return;
+	}
+
+	for (i = 0; i < (size_t) res; i++) {
+		b->msgs[i].len = b->mmsg[i].msg_len;
+		b->msgs[i].fromlen = b->mmsg[i].msg_hdr.msg_namelen;
+	}
+	num = res;
+#else /* ELOOP_RECVMMSG */
+	for (i = 0; i < b->max_msgs; i++) {
+		socklen_t fromlen = sizeof(b->from[i]);
+		int flags = 0, res;
+
+		if (i > 0) {
+#ifdef MSG_DONTWAIT
+			/* The first read is known not to block */
+			flags = MSG_DONTWAIT;
+#else /* MSG_DONTWAIT */
+			break;
+#endif /* MSG_DONTWAIT */
+		}
+		res = recvfrom(sock, b->msgs[i].buf, b->max_len, flags,
+			       (struct sockaddr *) &b->from[i], &fromlen);
+		if (res < 0) {
+			if (i == 0)
+				wpa_printf(MSG_INFO,
+					   "eloop: recvfrom(sock=%d): %s",
+					   sock, strerror(errno));
+			break;
+		}
+		b->msgs[i].len = res;
+		b->msgs[i].fromlen = fromlen;
+		num++;
+	}
+#endif /* ELOOP_RECVMMSG */
+
+	if (num == 0)
+		return;
+
+	b->batch.msgs = b->msgs;
+	b->batch.num = num;
+	b->in_handler = 1;
+	b->handler(sock, b->eloop_data, b->user_data, &b->batch);
+	b->in_handler = 0;
+	if (b->removed)
+		eloop_batch_sock_free(b);
+}
+
+
+/* Find the batch context of the reader that eloop_unregister_sock() removes */
+static struct eloop_batch_sock *
+eloop_batch_sock_get(struct eloop_sock_table *table, int sock)
+{
+	size_t i;
+
+	for (i = 0; i < table->count; i++) {
+		if (table->table[i].sock != sock)
+			continue;
+		if (table->table[i].handler != eloop_batch_sock_receive)
+			return NULL;
+		return table->table[i].eloop_data;
+	}
+
+	return NULL;
+}
+
+
+int eloop_register_read_sock_batch(int sock, size_t max_msgs, size_t max_len,
+				   eloop_batch_handler handler,
+				   void *eloop_data, void *user_data)
+{
+	struct eloop_batch_sock *b;
+	size_t i;
+
+	if (max_msgs == 0 || max_len == 0)
+		return -1;
+
+	b = os_zalloc(sizeof(*b));
+	if (!b)
+		return -1;
+	b->sock = sock;
+	b->handler = handler;
+	b->eloop_data = eloop_data;
+	b->user_data = user_data;
+	b->max_msgs = max_msgs;
+	b->max_len = max_len;
+	b->bufs = os_malloc(max_msgs * max_len);
+	b->from = os_calloc(max_msgs, sizeof(*b->from));
+	b->msgs = os_calloc(max_msgs, sizeof(*b->msgs));
+#ifdef ELOOP_RECVMMSG
+	b->mmsg = os_calloc(max_msgs, sizeof(*b->mmsg));
+	b->iov = os_calloc(max_msgs, sizeof(*b->iov));
+	if (!b->mmsg || !b->iov) {
+		eloop_batch_sock_free(b);
+		return -1;
+	}
+#endif /* ELOOP_RECVMMSG */
+	if (!b->bufs || !b->from || !b->msgs) {
+		eloop_batch_sock_free(b);
+		return -1;
+	}
+	for (i = 0; i < max_msgs; i++) {
+		b->msgs[i].buf = b->bufs + i * max_len;
+		b->msgs[i].from = &b->from[i];
+	}
+
+	if (eloop_register_read_sock(sock, eloop_batch_sock_receive, b,
+				     NULL) < 0) {
+		eloop_batch_sock_free(b);
+		return -1;
+	}
+	dl_list_add(&eloop.batch_socks, &b->list);
+
+	return 0;
+}
+
+
 static struct eloop_sock_table *eloop_get_sock_table(eloop_event_type type)
 {
 	switch (type) {
@@ -763,9 +973,184 @@ int eloop_register_sock(int sock, eloop_event_type type,
 void eloop_unregister_sock(int sock, eloop_event_type type)
 {
 	struct eloop_sock_table *table;
+	struct eloop_batch_sock *batch = NULL;
 
 	table = eloop_get_sock_table(type);
+	if (type == EVENT_TYPE_READ && table->table)
+		batch = eloop_batch_sock_get(table, sock);
 	eloop_sock_table_remove_sock(table, sock);
+	if (batch)
+		eloop_batch_sock_remove(batch);
+}
+
+
+#define ELOOP_TIMEOUT_MIN_SIZE 64
+
+static int eloop_timeout_before(const struct eloop_timeout *a,
+				const struct eloop_timeout *b)
+{
+	if (a->time.sec != b->time.sec)
+		return a->time.sec < b->time.sec;
+	if (a->time.usec != b->time.usec)
+		return a->time.usec < b->time.usec;
+	return a->seq < b->seq;
+}
+
+
+static void eloop_timeout_heap_set(size_t idx, struct eloop_timeout *timeout)
+{
+	eloop.timeout_heap[idx] = timeout;
+	timeout->heap_idx = idx;
+}
+
+
+static void eloop_timeout_heap_up(size_t idx)
+{
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
+
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
+
+		if (!eloop_timeout_before(timeout, eloop.timeout_heap[parent]))
+			break;
+		eloop_timeout_heap_set(idx, eloop.timeout_heap[parent]);
+		idx = parent;
+	}
+	eloop_timeout_heap_set(idx, timeout);
+}
+
+
+static void eloop_timeout_heap_down(size_t idx)
+{
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
+
+	for (;;) {
+		size_t child = 2 * idx + 1;
+
+		if (child >= eloop.timeout_count)
+			break;
+		if (child + 1 < eloop.timeout_count &&
+		    eloop_timeout_before(eloop.timeout_heap[child + 1],
+					 eloop.timeout_heap[child]))
+			child++;
+		if (!eloop_timeout_before(eloop.timeout_heap[child], timeout))
+			break;
+		eloop_timeout_heap_set(idx, eloop.timeout_heap[child]);
+		idx = child;
+	}
+	eloop_timeout_heap_set(idx, timeout);
+}
+
+
+static struct eloop_timeout * eloop_first_timeout(void)
+{
+	if (eloop.timeout_count == 0)
+		return NULL;
+	return eloop.timeout_heap[0];
+}
+
+
+static size_t eloop_timeout_hash(eloop_timeout_handler handler,
+				 void *eloop_data, void *user_data)
+{
+	u64 h;
+
+	h = (uintptr_t) handler;
+	h = (h ^ (uintptr_t) eloop_data) * 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (uintptr_t) user_data) * 0x9e3779b97f4a7c15ULL;
+	return (size_t) (h >> 32) & (eloop.timeout_hash_size - 1);
+}
+
+
+static struct dl_list * eloop_timeout_bucket(eloop_timeout_handler handler,
+					     void *eloop_data,
+					     void *user_data)
+{
+	return &eloop.timeout_hash[eloop_timeout_hash(handler, eloop_data,
+						      user_data)];
+}
+
+
+static int eloop_timeout_hash_resize(size_t size)
+{
+	struct dl_list *hash;
+	size_t i;
+
+	hash = os_calloc(size, sizeof(*hash));
+	if (!hash)
+		return -1;
+	for (i = 0; i < size; i++)
+		dl_list_init(&hash[i]);
+
+	os_free(eloop.timeout_hash);
+	eloop.timeout_hash = hash;
+	eloop.timeout_hash_size = size;
+
+	for (i = 0; i < eloop.timeout_count; i++) {
+		struct eloop_timeout *timeout = eloop.timeout_heap[i];
+
+		dl_list_add_tail(eloop_timeout_bucket(timeout->handler,
+						      timeout->eloop_data,
+						      timeout->user_data),
+				 &timeout->list);
+	}
+
+	return 0;
+}
+
+
+static int eloop_timeout_reserve(void)
+{
+	if (eloop.timeout_count == eloop.timeout_heap_size) {
+		struct eloop_timeout **heap;
+		size_t size;
+
+		size = eloop.timeout_heap_size ? 2 * eloop.timeout_heap_size :
+			ELOOP_TIMEOUT_MIN_SIZE;
+		heap = os_realloc_array(eloop.timeout_heap, size,
+					sizeof(*heap));
+		if (!heap)
+			return -1;
+		eloop.timeout_heap = heap;
+		eloop.timeout_heap_size = size;
+	}
+
+	if (!eloop.timeout_hash) {
+		if (eloop_timeout_hash_resize(ELOOP_TIMEOUT_MIN_SIZE) < 0)
+			return -1;
+	} else if (eloop.timeout_count >= eloop.timeout_hash_size) {
+		/*
+		 * Failure to grow the index is not fatal; lookups just end up
+		 * going through longer bucket chains.
+		 */
+		eloop_timeout_hash_resize(2 * eloop.timeout_hash_size);
+	}
+
+	return 0;
+}
+
+
+/* Returns the matching timeout that expires first */
+static struct eloop_timeout *
+eloop_find_timeout(eloop_timeout_handler handler, void *eloop_data,
+		   void *user_data)
+{
+	struct eloop_timeout *tmp, *found = NULL;
+
+	if (eloop.timeout_count == 0)
+		return NULL;
+
+	dl_list_for_each(tmp, eloop_timeout_bucket(handler, eloop_data,
+						   user_data),
+			 struct eloop_timeout, list) {
+		if (tmp->handler == handler &&
+		    tmp->eloop_data == eloop_data &&
+		    tmp->user_data == user_data &&
+		    (!found || eloop_timeout_before(tmp, found)))
+			found = tmp;
+	}
+
+	return found;
 }
 
 
@@ -773,7 +1158,7 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 			   eloop_timeout_handler handler,
 			   void *eloop_data, void *user_data)
 {
-	struct eloop_timeout *timeout, *tmp;
+	struct eloop_timeout *timeout;
 	os_time_t now_sec;
 
 	timeout = os_zalloc(sizeof(*timeout));
@@ -800,21 +1185,22 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 		timeout->time.sec++;
 		timeout->time.usec -= 1000000;
 	}
+	if (eloop_timeout_reserve() < 0) {
+		os_free(timeout);
+		return -1;
+	}
 	timeout->eloop_data = eloop_data;
 	timeout->user_data = user_data;
 	timeout->handler = handler;
+	timeout->seq = eloop.timeout_seq++;
 	wpa_trace_add_ref(timeout, eloop, eloop_data);
 	wpa_trace_add_ref(timeout, user, user_data);
 	wpa_trace_record(timeout);
 
-	/* Maintain timeouts in order of increasing time */
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (os_reltime_before(&timeout->time, &tmp->time)) {
-			dl_list_add(tmp->list.prev, &timeout->list);
-			return 0;
-		}
-	}
-	dl_list_add_tail(&eloop.timeout, &timeout->list);
+	dl_list_add_tail(eloop_timeout_bucket(handler, eloop_data, user_data),
+			 &timeout->list);
+	eloop_timeout_heap_set(eloop.timeout_count++, timeout);
+	eloop_timeout_heap_up(timeout->heap_idx);
 
 	return 0;
 }
@@ -822,7 +1208,22 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 
 static void eloop_remove_timeout(struct eloop_timeout *timeout)
 {
+	size_t idx = timeout->heap_idx;
+
 	dl_list_del(&timeout->list);
+	eloop.timeout_count--;
+	if (idx < eloop.timeout_count) {
+		struct eloop_timeout *last;
+
+		last = eloop.timeout_heap[eloop.timeout_count];
+		eloop_timeout_heap_set(idx, last);
+		if (idx > 0 &&
+		    eloop_timeout_before(last,
+					 eloop.timeout_heap[(idx - 1) / 2]))
+			eloop_timeout_heap_up(idx);
+		else
+			eloop_timeout_heap_down(idx);
+	}
 	wpa_trace_remove_ref(timeout, eloop, timeout->eloop_data);
 	wpa_trace_remove_ref(timeout, user, timeout->user_data);
 	os_free(timeout);
@@ -834,16 +1235,38 @@ int eloop_cancel_timeout(eloop_timeout_handler handler,
 {
 	struct eloop_timeout *timeout, *prev;
 	int removed = 0;
+	size_t i;
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data ||
-		     eloop_data == ELOOP_ALL_CTX) &&
-		    (timeout->user_data == user_data ||
-		     user_data == ELOOP_ALL_CTX)) {
-			eloop_remove_timeout(timeout);
-			removed++;
+	if (eloop.timeout_count == 0)
+		return 0;
+
+	if (eloop_data != ELOOP_ALL_CTX && user_data != ELOOP_ALL_CTX) {
+		dl_list_for_each_safe(timeout, prev,
+				      eloop_timeout_bucket(handler, eloop_data,
+							   user_data),
+				      struct eloop_timeout, list) {
+			if (timeout->handler == handler &&
+			    timeout->eloop_data == eloop_data &&
+			    timeout->user_data == user_data) {
+				eloop_remove_timeout(timeout);
+				removed++;
+			}
+		}
+		return removed;
+	}
+
+	/* Wildcard matches cannot use the index, so go through all buckets */
+	for (i = 0; i < eloop.timeout_hash_size; i++) {
+		dl_list_for_each_safe(timeout, prev, &eloop.timeout_hash[i],
+				      struct eloop_timeout, list) {
+			if (timeout->handler == handler &&
+			    (timeout->eloop_data == eloop_data ||
+			     eloop_data == ELOOP_ALL_CTX) &&
+			    (timeout->user_data == user_data ||
+			     user_data == ELOOP_ALL_CTX)) {
+				eloop_remove_timeout(timeout);
+				removed++;
+			}
 		}
 	}
 
@@ -855,42 +1278,26 @@ int eloop_cancel_timeout_one(eloop_timeout_handler handler,
 			     void *eloop_data, void *user_data,
 			     struct os_reltime *remaining)
 {
-	struct eloop_timeout *timeout, *prev;
-	int removed = 0;
+	struct eloop_timeout *timeout;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
 	remaining->sec = remaining->usec = 0;
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data) &&
-		    (timeout->user_data == user_data)) {
-			removed = 1;
-			if (os_reltime_before(&now, &timeout->time))
-				os_reltime_sub(&timeout->time, &now, remaining);
-			eloop_remove_timeout(timeout);
-			break;
-		}
-	}
-	return removed;
+	timeout = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!timeout)
+		return 0;
+	if (os_reltime_before(&now, &timeout->time))
+		os_reltime_sub(&timeout->time, &now, remaining);
+	eloop_remove_timeout(timeout);
+	return 1;
 }
 
 
 int eloop_is_timeout_registered(eloop_timeout_handler handler,
 				void *eloop_data, void *user_data)
 {
-	struct eloop_timeout *tmp;
-
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data)
-			return 1;
-	}
-
-	return 0;
+	return eloop_find_timeout(handler, eloop_data, user_data) != NULL;
 }
 
 
@@ -901,28 +1308,21 @@ int eloop_deplete_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&requested, &remaining)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
-		}
-	}
+	tmp = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!tmp)
+		return -1;
 
-	return -1;
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&requested, &remaining)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
+	}
+	return 0;
 }
 
 
@@ -933,28 +1333,21 @@ int eloop_replenish_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&remaining, &requested)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
-		}
-	}
+	tmp = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!tmp)
+		return -1;
 
-	return -1;
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&remaining, &requested)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
+	}
+	return 0;
 }
 
 
@@ -1091,7 +1484,7 @@ void eloop_run(void)
 #endif /* CONFIG_ELOOP_SELECT */
 
 	while (!eloop.terminate &&
-	       (!dl_list_empty(&eloop.timeout) || eloop.readers.count > 0 ||
+	       (eloop.timeout_count > 0 || eloop.readers.count > 0 ||
 		eloop.writers.count > 0 || eloop.exceptions.count > 0)) {
 		struct eloop_timeout *timeout;
 
@@ -1108,8 +1501,7 @@ void eloop_run(void)
 				break;
 		}
 
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (os_reltime_before(&now, &timeout->time))
@@ -1188,8 +1580,7 @@ void eloop_run(void)
 
 
 		/* check if some registered timeouts have occurred */
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (!os_reltime_before(&now, &timeout->time)) {
@@ -1254,15 +1645,20 @@ void eloop_terminate(void)
 }
 
 
-void eloop_destroy(void)
+static void eloop_free(int report)
 {
-	struct eloop_timeout *timeout, *prev;
+	struct eloop_timeout *timeout;
+	struct eloop_batch_sock *batch;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
+	while ((timeout = eloop_first_timeout())) {
 		int sec, usec;
+
+		if (!report) {
+			eloop_remove_timeout(timeout);
+			continue;
+		}
 		sec = timeout->time.sec - now.sec;
 		usec = timeout->time.usec - now.usec;
 		if (timeout->time.usec < now.usec) {
@@ -1278,9 +1674,20 @@ void eloop_destroy(void)
 		wpa_trace_dump("eloop timeout", timeout);
 		eloop_remove_timeout(timeout);
 	}
-	eloop_sock_table_destroy(&eloop.readers);
-	eloop_sock_table_destroy(&eloop.writers);
-	eloop_sock_table_destroy(&eloop.exceptions);
+	os_free(eloop.timeout_heap);
+	eloop.timeout_heap = NULL;
+	eloop.timeout_heap_size = 0;
+	os_free(eloop.timeout_hash);
+	eloop.timeout_hash = NULL;
+	eloop.timeout_hash_size = 0;
+	while ((batch = dl_list_first(&eloop.batch_socks,
+				      struct eloop_batch_sock, list))) {
+		dl_list_del(&batch->list);
+		eloop_batch_sock_free(batch);
+	}
+	eloop_sock_table_destroy(&eloop.readers, report);
+	eloop_sock_table_destroy(&eloop.writers, report);
+	eloop_sock_table_destroy(&eloop.exceptions, report);
 	os_free(eloop.signals);
 
 #ifdef CONFIG_ELOOP_POLL
@@ -1301,6 +1708,39 @@ void eloop_destroy(void)
 }
 
 
+void eloop_destroy(void)
+{
+	eloop_free(1);
+}
+
+
+static void eloop_sock_table_close(struct eloop_sock_table *table)
+{
+	size_t i;
+
+	/* A socket registered in more than one table gets closed again here,
+	 * but that only fails with EBADF since no new descriptors are opened
+	 * in between. */
+	for (i = 0; i < table->count && table->table; i++)
+		close(table->table[i].sock);
+	eloop_trace_sock_remove_ref(table);
+	table->count = 0;
+}
+
+
+int eloop_fork_reinit(void)
+{
+	/* The registrations belong to the parent process, so they are dropped
+	 * silently. The child process has no use for the sockets of the
+	 * parent (driver, control interface, etc.), so close its copies. */
+	eloop_sock_table_close(&eloop.readers);
+	eloop_sock_table_close(&eloop.writers);
+	eloop_sock_table_close(&eloop.exceptions);
+	eloop_free(0);
+	return eloop_init();
+}
+
+
 int eloop_terminated(void)
 {
 	return eloop.terminate || eloop.pending_terminate;
@@ -42,6 +42,46 @@ typedef enum {
  */
 typedef void (*eloop_sock_handler)(int sock, void *eloop_ctx, void *sock_ctx);
 
+/**
+ * struct eloop_datagram - Datagram received as part of a batch
+ * @buf: Received data
+ * @len: Length of the received data in octets; if this is equal to the
+ *	max_len value used in registration, the datagram may have been
+ *	truncated
+ * @from: Source address of the datagram (struct sockaddr)
+ * @fromlen: Length of the source address in octets
+ */
+struct eloop_datagram {
+	u8 *buf;
+	size_t len;
+	void *from;
+	unsigned int fromlen;
+};
+
+/**
+ * struct eloop_datagram_batch - Datagrams received on a single wakeup
+ * @msgs: Received datagrams in the order they were received
+ * @num: Number of entries in msgs
+ *
+ * If the socket is unregistered from within the batch handler, @num is set to
+ * zero and the remaining datagrams are dropped. Handlers must therefore
+ * re-check @num on each iteration instead of caching it.
+ */
+struct eloop_datagram_batch {
+	struct eloop_datagram *msgs;
+	size_t num;
+};
+
+/**
+ * eloop_batch_handler - eloop batched socket receive callback type
+ * @sock: File descriptor number for the socket
+ * @eloop_ctx: Registered callback context data (eloop_data)
+ * @sock_ctx: Registered callback context data (user_data)
+ * @batch: Datagrams received from the socket
+ */
+typedef void (*eloop_batch_handler)(int sock, void *eloop_ctx, void *sock_ctx,
+				    struct eloop_datagram_batch *batch);
+
 /**
  * eloop_event_handler - eloop generic event callback type
  * @eloop_ctx: Registered callback context data (eloop_data)
@@ -95,10 +135,32 @@ int eloop_register_read_sock(int sock, eloop_sock_handler handler,
  * @sock: File descriptor number for the socket
  *
  * Unregister a read socket notifier that was previously registered with
- * eloop_register_read_sock().
+ * eloop_register_read_sock() or eloop_register_read_sock_batch().
  */
 void eloop_unregister_read_sock(int sock);
 
+/**
+ * eloop_register_read_sock_batch - Register batched handler for read events
+ * @sock: File descriptor number for a datagram socket
+ * @max_msgs: Maximum number of datagrams to receive per wakeup
+ * @max_len: Maximum length of a single datagram in octets
+ * @handler: Callback function to be called with the received datagrams
+ * @eloop_data: Callback context data (eloop_ctx)
+ * @user_data: Callback context data (sock_ctx)
+ * Returns: 0 on success, -1 on failure
+ *
+ * Register a read socket notifier for the given file descriptor. Unlike with
+ * eloop_register_read_sock(), eloop receives the pending datagrams itself
+ * (up to @max_msgs of them with a single recvmmsg() call when supported by
+ * the platform) and passes them to the handler function as a vector. This
+ * reduces the number of wakeups and system calls needed for processing
+ * bursts of datagrams. The registration is removed with
+ * eloop_unregister_read_sock().
+ */
+int eloop_register_read_sock_batch(int sock, size_t max_msgs, size_t max_len,
+				   eloop_batch_handler handler,
+				   void *eloop_data, void *user_data);
+
 /**
  * eloop_register_sock - Register handler for socket events
  * @sock: File descriptor number for the socket
@@ -345,6 +407,19 @@ void eloop_terminate(void);
  */
 void eloop_destroy(void);
 
+/**
+ * eloop_fork_reinit - Start a new event loop in a forked child process
+ * Returns: 0 on success, -1 on failure
+ *
+ * This drops all the sockets, timeouts, and signal handlers that were
+ * registered before fork() without calling or reporting them and initializes
+ * an empty event loop for the child process. The child's copies of the
+ * registered sockets are closed; the parent process keeps using its own. Any
+ * code that tracks these descriptors in the child must forget them without
+ * closing them again.
+ */
+int eloop_fork_reinit(void);
+
 /**
  * eloop_terminated - Check whether event loop has been terminated
  * Returns: 1 = event loop terminate, 0 = event loop still running
@@ -0,0 +1,285 @@
+/*
+ * Resizable hash table with a randomized hash function
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "hash_table.h"
+
+#define HASH_TABLE_MIN_SIZE 16
+
+static u64 hash_seed[2];
+static int hash_seed_set = 0;
+
+
+static void hash_table_init_seed(void)
+{
+#ifdef TEST_FUZZ
+	/* Keep fuzzing runs reproducible */
+	hash_seed[0] = 0x0123456789abcdefULL;
+	hash_seed[1] = 0xfedcba9876543210ULL;
+#else /* TEST_FUZZ */
+	if (os_get_random((u8 *) hash_seed, sizeof(hash_seed)) < 0) {
+		struct os_reltime now;
+
+		wpa_printf(MSG_INFO,
+			   "hash_table: Could not get random seed - use time");
+		os_get_reltime(&now);
+		hash_seed[0] = ((u64) now.sec << 32) ^ now.usec;
+		hash_seed[1] = (uintptr_t) &now ^ ((u64) getpid() << 16);
+	}
+#endif /* TEST_FUZZ */
+	hash_seed_set = 1;
+}
+
+
+static u64 hash_mix(u64 h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+
+/**
+ * hash_table_hash - Calculate a randomized hash value for a key
+ * @key: Key
+ * @key_len: Length of the key in octets
+ * Returns: Hash value
+ *
+ * The hash function is keyed with a per-process random value, so the same key
+ * maps to different values in different processes.
+ */
+u32 hash_table_hash(const void *key, size_t key_len)
+{
+	const u8 *pos = key;
+	u64 h, v;
+	size_t i, left = key_len;
+
+	if (!hash_seed_set)
+		hash_table_init_seed();
+
+	h = hash_seed[0] ^ (key_len * 0x9e3779b97f4a7c15ULL);
+	while (left > 0) {
+		size_t blen = left > 8 ? 8 : left;
+
+		v = 0;
+		for (i = 0; i < blen; i++)
+			v |= (u64) pos[i] << (8 * i);
+		h = hash_mix(h ^ v ^ hash_seed[1]);
+		pos += blen;
+		left -= blen;
+	}
+
+	return (u32) (hash_mix(h ^ hash_seed[1]) >> 32);
+}
+
+
+static int hash_node_match(const struct hash_node *node, u32 hash,
+			   const void *key, size_t key_len)
+{
+	return node->hash == hash && node->key_len == key_len &&
+		os_memcmp(node->key, key, key_len) == 0;
+}
+
+
+static int hash_table_resize(struct hash_table *tbl, size_t size)
+{
+	struct hash_node **buckets, *node, *next;
+	size_t i;
+
+	buckets = os_calloc(size, sizeof(*buckets));
+	if (!buckets)
+		return -1;
+
+	for (i = 0; i < tbl->size; i++) {
+		for (node = tbl->buckets[i]; node; node = next) {
+			struct hash_node **pos;
+
+			next = node->next;
+			/* Maintain the insertion order within a bucket */
+			pos = &buckets[node->hash & (size - 1)];
+			while (*pos)
+				pos = &(*pos)->next;
+			node->next = NULL;
+			*pos = node;
+		}
+	}
+
+	os_free(tbl->buckets);
+	tbl->buckets = buckets;
+	tbl->size = size;
+	return 0;
+}
+
+
+/**
+ * hash_table_deinit - Free the resources used by a hash table
+ * @tbl: Hash table
+ *
+ * The entries themselves are not freed. The table is left in the same state
+ * as a zero-initialized table and can be used again.
+ */
+void hash_table_deinit(struct hash_table *tbl)
+{
+	os_free(tbl->buckets);
+	tbl->buckets = NULL;
+	tbl->size = 0;
+	tbl->count = 0;
+}
+
+
+/**
+ * hash_table_add - Add an entry to a hash table
+ * @tbl: Hash table
+ * @node: Hash table node embedded in the entry
+ * @key: Key for the entry; this is not copied
+ * @key_len: Length of the key in octets
+ * Returns: 0 on success, -1 on failure
+ *
+ * Multiple entries with the same key can be added. hash_table_get() returns
+ * the one that was added first and hash_table_get_next() can be used to find
+ * the others in the order they were added.
+ */
+int hash_table_add(struct hash_table *tbl, struct hash_node *node,
+		   const void *key, size_t key_len)
+{
+	struct hash_node **pos;
+
+	if (!tbl->buckets) {
+		if (hash_table_resize(tbl, HASH_TABLE_MIN_SIZE) < 0)
+			return -1;
+	} else if (tbl->count >= tbl->size) {
+		/*
+		 * Failure to grow the table is not fatal; lookups just end up
+		 * going through longer bucket chains.
+		 */
+		hash_table_resize(tbl, 2 * tbl->size);
+	}
+
+	node->key = key;
+	node->key_len = key_len;
+	node->hash = hash_table_hash(key, key_len);
+	node->next = NULL;
+	pos = &tbl->buckets[node->hash & (tbl->size - 1)];
+	while (*pos)
+		pos = &(*pos)->next;
+	*pos = node;
+	tbl->count++;
+
+	return 0;
+}
+
+
+/**
+ * hash_table_del - Remove an entry from a hash table
+ * @tbl: Hash table
+ * @node: Hash table node embedded in the entry
+ */
+void hash_table_del(struct hash_table *tbl, struct hash_node *node)
+{
+	struct hash_node **pos;
+
+	if (!tbl->buckets)
+		return;
+
+	pos = &tbl->buckets[node->hash & (tbl->size - 1)];
+	while (*pos && *pos != node)
+		pos = &(*pos)->next;
+	if (!*pos) {
+		wpa_printf(MSG_DEBUG, "hash_table: Entry %p not found", node);
+		return;
+	}
+	*pos = node->next;
+	node->next = NULL;
+	tbl->count--;
+
+	if (tbl->count == 0) {
+		hash_table_deinit(tbl);
+	} else if (tbl->size > HASH_TABLE_MIN_SIZE &&
+		   tbl->count < tbl->size / 8) {
+		/* Failure to shrink the table is not fatal */
+		hash_table_resize(tbl, tbl->size / 2);
+	}
+}
+
+
+/**
+ * hash_table_get - Find an entry from a hash table
+ * @tbl: Hash table
+ * @key: Key to search for
+ * @key_len: Length of the key in octets
+ * Returns: Pointer to the first matching node or %NULL if not found
+ */
+struct hash_node * hash_table_get(const struct hash_table *tbl,
+				  const void *key, size_t key_len)
+{
+	struct hash_node *node;
+	u32 hash;
+
+	if (!tbl->buckets)
+		return NULL;
+
+	hash = hash_table_hash(key, key_len);
+	for (node = tbl->buckets[hash & (tbl->size - 1)]; node;
+	     node = node->next) {
+		if (hash_node_match(node, hash, key, key_len))
+			return node;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * hash_table_get_next - Find the next entry with the same key
+ * @tbl: Hash table
+ * @node: Node returned by hash_table_get() or hash_table_get_next()
+ * Returns: Pointer to the next node with the same key or %NULL if not found
+ */
+struct hash_node * hash_table_get_next(const struct hash_table *tbl,
+				       struct hash_node *node)
+{
+	struct hash_node *pos;
+
+	for (pos = node->next; pos; pos = pos->next) {
+		if (hash_node_match(pos, node->hash, node->key, node->key_len))
+			return pos;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * hash_table_get_stats - Get hash table statistics
+ * @tbl: Hash table
+ * @stats: Buffer for returning the statistics
+ */
+void hash_table_get_stats(const struct hash_table *tbl,
+			  struct hash_table_stats *stats)
+{
+	struct hash_node *node;
+	size_t i, len;
+
+	os_memset(stats, 0, sizeof(*stats));
+	stats->entries = tbl->count;
+	stats->buckets = tbl->size;
+	for (i = 0; i < tbl->size; i++) {
+		len = 0;
+		for (node = tbl->buckets[i]; node; node = node->next)
+			len++;
+		if (len)
+			stats->used_buckets++;
+		if (len > stats->max_chain)
+			stats->max_chain = len;
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * Resizable hash table with a randomized hash function
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
+/**
+ * struct hash_node - Hash table entry
+ *
+ * This is embedded in the data structure that is stored in the hash table
+ * (similarly to struct dl_list) and the containing entry is found with
+ * hash_table_entry(). The key is not copied; it must remain valid and
+ * unmodified for as long as the entry is in the table.
+ */
+struct hash_node {
+	struct hash_node *next;
+	const void *key;
+	size_t key_len;
+	u32 hash;
+};
+
+/**
+ * struct hash_table - Resizable hash table
+ *
+ * A zero-initialized struct hash_table is a valid empty table; the buckets are
+ * allocated when the first entry is added. The number of buckets is adjusted
+ * based on the number of entries. Bucket selection uses a hash function that
+ * is keyed with a per-process random value so that the distribution of
+ * entries cannot be controlled by selecting the keys (e.g., MAC addresses).
+ */
+struct hash_table {
+	struct hash_node **buckets;
+	size_t size; /* number of buckets; zero or a power of two */
+	size_t count; /* number of entries */
+};
+
+/**
+ * struct hash_table_stats - Hash table statistics
+ * @entries: Number of entries in the table
+ * @buckets: Number of buckets
+ * @used_buckets: Number of non-empty buckets
+ * @max_chain: Length of the longest bucket chain
+ */
+struct hash_table_stats {
+	size_t entries;
+	size_t buckets;
+	size_t used_buckets;
+	size_t max_chain;
+};
+
+#define hash_table_entry(node, type, member) \
+	((type *) ((char *) (node) - offsetof(type, member)))
+
+void hash_table_deinit(struct hash_table *tbl);
+int hash_table_add(struct hash_table *tbl, struct hash_node *node,
+		   const void *key, size_t key_len);
+void hash_table_del(struct hash_table *tbl, struct hash_node *node);
+struct hash_node * hash_table_get(const struct hash_table *tbl,
+				  const void *key, size_t key_len);
+struct hash_node * hash_table_get_next(const struct hash_table *tbl,
+				       struct hash_node *node);
+void hash_table_get_stats(const struct hash_table *tbl,
+			  struct hash_table_stats *stats);
+u32 hash_table_hash(const void *key, size_t key_len);
+
+#endif /* HASH_TABLE_H */
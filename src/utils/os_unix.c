@@ -33,6 +33,16 @@
 #include "list.h"
 
 static struct dl_list alloc_list = DL_LIST_HEAD_INIT(alloc_list);
+#ifdef CONFIG_WORKER_POOL
+#include <pthread.h>
+/* Allocations may be done from worker threads */
+static pthread_mutex_t alloc_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define alloc_list_lock() pthread_mutex_lock(&alloc_mutex)
+#define alloc_list_unlock() pthread_mutex_unlock(&alloc_mutex)
+#else /* CONFIG_WORKER_POOL */
+#define alloc_list_lock() do { } while (0)
+#define alloc_list_unlock() do { } while (0)
+#endif /* CONFIG_WORKER_POOL */
 
 #define ALLOC_MAGIC 0xa84ef1b2
 #define FREED_MAGIC 0x67fd487a
@@ -550,7 +560,8 @@ static int testing_fail_alloc(void)
 	char *pos, *next;
 	int match;
 
-	if (!wpa_trace_fail_after)
+	/* The failure counters are not shared with the worker threads */
+	if (!wpa_trace_fail_after || wpa_debug_in_worker())
 		return 0;
 
 	res = wpa_trace_calling_func(func, WPA_TRACE_LEN);
@@ -636,7 +647,7 @@ int testing_test_fail(void)
 	char *pos, *next;
 	int match;
 
-	if (!wpa_trace_test_fail_after)
+	if (!wpa_trace_test_fail_after || wpa_debug_in_worker())
 		return 0;
 
 	res = wpa_trace_calling_func(func, WPA_TRACE_LEN);
@@ -716,7 +727,9 @@ void * os_malloc(size_t size)
 	if (a == NULL)
 		return NULL;
 	a->magic = ALLOC_MAGIC;
+	alloc_list_lock();
 	dl_list_add(&alloc_list, &a->list);
+	alloc_list_unlock();
 	a->len = size;
 	wpa_trace_record(a);
 	return a + 1;
@@ -766,7 +779,9 @@ void os_free(void *ptr)
 		wpa_trace_show("Invalid os_free() call");
 		abort();
 	}
+	alloc_list_lock();
 	dl_list_del(&a->list);
+	alloc_list_unlock();
 	a->magic = FREED_MAGIC;
 
 	wpa_trace_check_ref(ptr);
@@ -17,6 +17,7 @@
 #include "utils/base64.h"
 #include "utils/ip_addr.h"
 #include "utils/eloop.h"
+#include "utils/hash_table.h"
 #include "utils/json.h"
 #include "utils/module_tests.h"
 
@@ -842,6 +843,227 @@ static int eloop_tests(void)
 }
 
 
+static void eloop_test_dummy_timeout(void *eloop_data, void *user_ctx)
+{
+	wpa_printf(MSG_ERROR, "%s: FAIL - should not have been called",
+		   __func__);
+}
+
+
+static int eloop_timeout_tests(void)
+{
+	int errors = 0, i, ret;
+	u8 ctx[100];
+	struct os_reltime remaining;
+
+	wpa_printf(MSG_INFO, "eloop timeout tests");
+
+	/* Use long timeouts so that none of these expire during the test */
+	for (i = 0; i < (int) ARRAY_SIZE(ctx); i++) {
+		if (eloop_register_timeout(1000 + i, 0,
+					   eloop_test_dummy_timeout,
+					   &ctx[i], NULL) < 0 ||
+		    eloop_register_timeout(1000 + i, 0,
+					   eloop_test_dummy_timeout,
+					   &ctx[i], &ctx[0]) < 0)
+			errors++;
+	}
+
+	for (i = 0; i < (int) ARRAY_SIZE(ctx); i++) {
+		if (!eloop_is_timeout_registered(eloop_test_dummy_timeout,
+						 &ctx[i], NULL) ||
+		    !eloop_is_timeout_registered(eloop_test_dummy_timeout,
+						 &ctx[i], &ctx[0])) {
+			wpa_printf(MSG_ERROR, "eloop: timeout %d not found", i);
+			errors++;
+		}
+	}
+	if (eloop_is_timeout_registered(eloop_test_dummy_timeout,
+					&ctx[1], &ctx[1]) ||
+	    eloop_is_timeout_registered(eloop_test_dummy_timeout,
+					NULL, NULL)) {
+		wpa_printf(MSG_ERROR, "eloop: unexpected timeout found");
+		errors++;
+	}
+
+	ret = eloop_cancel_timeout(eloop_test_dummy_timeout, &ctx[0], NULL);
+	if (ret != 1) {
+		wpa_printf(MSG_ERROR, "eloop: cancel_timeout returned %d", ret);
+		errors++;
+	}
+	ret = eloop_cancel_timeout(eloop_test_dummy_timeout, ELOOP_ALL_CTX,
+				   &ctx[0]);
+	if (ret != (int) ARRAY_SIZE(ctx)) {
+		wpa_printf(MSG_ERROR,
+			   "eloop: wildcard cancel_timeout returned %d", ret);
+		errors++;
+	}
+
+	ret = eloop_deplete_timeout(10, 0, eloop_test_dummy_timeout, &ctx[1],
+				    NULL);
+	if (ret != 1) {
+		wpa_printf(MSG_ERROR, "eloop: deplete_timeout returned %d", ret);
+		errors++;
+	}
+	ret = eloop_deplete_timeout(20, 0, eloop_test_dummy_timeout, &ctx[1],
+				    NULL);
+	if (ret != 0) {
+		wpa_printf(MSG_ERROR, "eloop: deplete_timeout returned %d", ret);
+		errors++;
+	}
+	ret = eloop_replenish_timeout(500, 0, eloop_test_dummy_timeout,
+				      &ctx[1], NULL);
+	if (ret != 1) {
+		wpa_printf(MSG_ERROR, "eloop: replenish_timeout returned %d",
+			   ret);
+		errors++;
+	}
+	ret = eloop_replenish_timeout(5, 0, eloop_test_dummy_timeout, &ctx[0],
+				      NULL);
+	if (ret != -1) {
+		wpa_printf(MSG_ERROR, "eloop: replenish_timeout returned %d",
+			   ret);
+		errors++;
+	}
+	if (eloop_cancel_timeout_one(eloop_test_dummy_timeout, &ctx[1], NULL,
+				     &remaining) != 1 ||
+	    remaining.sec < 490 || remaining.sec >= 500) {
+		wpa_printf(MSG_ERROR,
+			   "eloop: cancel_timeout_one failed (remaining=%ld)",
+			   (long) remaining.sec);
+		errors++;
+	}
+
+	ret = eloop_cancel_timeout(eloop_test_dummy_timeout, ELOOP_ALL_CTX,
+				   ELOOP_ALL_CTX);
+	if (ret != (int) ARRAY_SIZE(ctx) - 2) {
+		wpa_printf(MSG_ERROR,
+			   "eloop: wildcard cancel_timeout returned %d", ret);
+		errors++;
+	}
+
+	if (errors) {
+		wpa_printf(MSG_ERROR, "%d eloop timeout test(s) failed",
+			   errors);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+struct hash_test_entry {
+	struct hash_node node;
+	u8 addr[ETH_ALEN];
+};
+
+
+static int hash_table_tests(void)
+{
+	struct hash_table tbl;
+	struct hash_test_entry *entries, dup;
+	struct hash_table_stats stats;
+	struct hash_node *node;
+	const int num = 1000;
+	int errors = 0, i;
+
+	wpa_printf(MSG_INFO, "hash_table tests");
+
+	os_memset(&tbl, 0, sizeof(tbl));
+	entries = os_calloc(num, sizeof(*entries));
+	if (!entries)
+		return -1;
+
+	if (hash_table_get(&tbl, entries[0].addr, ETH_ALEN)) {
+		wpa_printf(MSG_ERROR, "hash_table: entry found in empty table");
+		errors++;
+	}
+
+	/* Addresses that differ only in the first octet */
+	for (i = 0; i < num; i++) {
+		WPA_PUT_BE16(entries[i].addr, i);
+		if (hash_table_add(&tbl, &entries[i].node, entries[i].addr,
+				   ETH_ALEN) < 0)
+			errors++;
+	}
+
+	hash_table_get_stats(&tbl, &stats);
+	if (stats.entries != (size_t) num || stats.buckets < (size_t) num ||
+	    stats.max_chain > 10) {
+		wpa_printf(MSG_ERROR,
+			   "hash_table: unexpected stats: entries=%u buckets=%u max_chain=%u",
+			   (unsigned int) stats.entries,
+			   (unsigned int) stats.buckets,
+			   (unsigned int) stats.max_chain);
+		errors++;
+	}
+
+	for (i = 0; i < num; i++) {
+		node = hash_table_get(&tbl, entries[i].addr, ETH_ALEN);
+		if (!node ||
+		    hash_table_entry(node, struct hash_test_entry, node) !=
+		    &entries[i]) {
+			wpa_printf(MSG_ERROR, "hash_table: entry %d not found",
+				   i);
+			errors++;
+		}
+	}
+
+	/* Multiple entries with the same key are returned in order */
+	os_memcpy(dup.addr, entries[5].addr, ETH_ALEN);
+	if (hash_table_add(&tbl, &dup.node, dup.addr, ETH_ALEN) < 0 ||
+	    hash_table_get(&tbl, dup.addr, ETH_ALEN) != &entries[5].node ||
+	    hash_table_get_next(&tbl, &entries[5].node) != &dup.node ||
+	    hash_table_get_next(&tbl, &dup.node)) {
+		wpa_printf(MSG_ERROR, "hash_table: duplicate key test failed");
+		errors++;
+	}
+	hash_table_del(&tbl, &entries[5].node);
+	if (hash_table_get(&tbl, dup.addr, ETH_ALEN) != &dup.node) {
+		wpa_printf(MSG_ERROR, "hash_table: duplicate removal failed");
+		errors++;
+	}
+	hash_table_del(&tbl, &dup.node);
+
+	for (i = 0; i < num; i++) {
+		if (i != 5 && i % 10)
+			hash_table_del(&tbl, &entries[i].node);
+	}
+	hash_table_get_stats(&tbl, &stats);
+	if (stats.entries != (size_t) num / 10 ||
+	    stats.buckets >= (size_t) num) {
+		wpa_printf(MSG_ERROR,
+			   "hash_table: table not shrunk: entries=%u buckets=%u",
+			   (unsigned int) stats.entries,
+			   (unsigned int) stats.buckets);
+		errors++;
+	}
+	for (i = 0; i < num; i++) {
+		node = hash_table_get(&tbl, entries[i].addr, ETH_ALEN);
+		if ((i % 10 == 0) != !!node) {
+			wpa_printf(MSG_ERROR,
+				   "hash_table: unexpected lookup result for entry %d",
+				   i);
+			errors++;
+		}
+	}
+
+	hash_table_deinit(&tbl);
+	if (hash_table_get(&tbl, entries[0].addr, ETH_ALEN)) {
+		wpa_printf(MSG_ERROR, "hash_table: entry found after deinit");
+		errors++;
+	}
+	os_free(entries);
+
+	if (errors) {
+		wpa_printf(MSG_ERROR, "%d hash_table test(s) failed", errors);
+		return -1;
+	}
+
+	return 0;
+}
+
+
 #ifdef CONFIG_JSON
 struct json_test_data {
 	const char *json;
@@ -1225,6 +1447,8 @@ int utils_module_tests(void)
 	    wpabuf_tests() < 0 ||
 	    ip_addr_tests() < 0 ||
 	    eloop_tests() < 0 ||
+	    eloop_timeout_tests() < 0 ||
+	    hash_table_tests() < 0 ||
 	    json_tests() < 0 ||
 	    const_time_tests() < 0 ||
 	    int_array_tests() < 0)
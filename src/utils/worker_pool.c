@@ -0,0 +1,419 @@
+/*
+ * Pool of worker threads for CPU intensive operations
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+#include <pthread.h>
+#include <signal.h>
+
+#include "common.h"
+#include "list.h"
+#include "eloop.h"
+#include "worker_pool.h"
+
+
+struct worker_pool_job {
+	struct dl_list list;
+	worker_pool_job_func func;
+	worker_pool_done_func done;
+	void *ctx;
+};
+
+
+struct worker_pool {
+	pthread_t *threads;
+	unsigned int num_threads;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	int stop;
+
+	/* Current batch from worker_pool_run(); protected by lock */
+	worker_pool_func func;
+	void *ctx;
+	unsigned int count;
+	unsigned int next;
+	unsigned int running;
+	int cancel;
+
+	/* Jobs from worker_pool_submit(); protected by lock */
+	struct dl_list jobs; /* struct worker_pool_job */
+	struct dl_list completed; /* struct worker_pool_job */
+	unsigned int jobs_running;
+	int notified;
+
+	/* Pipe for waking up the eloop thread when jobs have been completed */
+	int notify[2];
+};
+
+
+/* Marks the worker threads of all pools */
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t worker_key;
+static int worker_key_ready = 0;
+
+
+static void worker_pool_key_init(void)
+{
+	if (pthread_key_create(&worker_key, NULL) == 0) {
+		worker_key_ready = 1;
+		wpa_debug_set_worker_cb(worker_pool_in_worker);
+	}
+}
+
+
+/**
+ * worker_pool_in_worker - Check whether the caller is a worker thread
+ * Returns: 1 if called from a worker thread of any pool, 0 otherwise
+ */
+int worker_pool_in_worker(void)
+{
+	return worker_key_ready && pthread_getspecific(worker_key);
+}
+
+
+static int worker_pool_has_work(struct worker_pool *pool)
+{
+	return pool->func && !pool->cancel && pool->next < pool->count;
+}
+
+
+/* Run work items from the current batch; called with pool->lock held */
+static void worker_pool_process(struct worker_pool *pool)
+{
+	worker_pool_func func = pool->func;
+	void *ctx = pool->ctx;
+	unsigned int idx;
+	int res;
+
+	while (worker_pool_has_work(pool)) {
+		idx = pool->next++;
+		pool->running++;
+		pthread_mutex_unlock(&pool->lock);
+		res = func(ctx, idx);
+		pthread_mutex_lock(&pool->lock);
+		pool->running--;
+		if (res)
+			pool->cancel = 1;
+	}
+
+	if (pool->running == 0)
+		pthread_cond_signal(&pool->done_cond);
+}
+
+
+/* Run the first pending job; called with pool->lock held */
+static void worker_pool_run_job(struct worker_pool *pool)
+{
+	struct worker_pool_job *job;
+
+	job = dl_list_first(&pool->jobs, struct worker_pool_job, list);
+	dl_list_del(&job->list);
+	pool->jobs_running++;
+	pthread_mutex_unlock(&pool->lock);
+	job->func(job->ctx);
+	pthread_mutex_lock(&pool->lock);
+	pool->jobs_running--;
+	dl_list_add_tail(&pool->completed, &job->list);
+
+	if (!pool->notified) {
+		pool->notified = 1;
+		if (write(pool->notify[1], "", 1) < 0)
+			wpa_printf(MSG_ERROR,
+				   "worker_pool: Failed to notify completion: %s",
+				   strerror(errno));
+	}
+
+	if (pool->jobs_running == 0 && dl_list_empty(&pool->jobs))
+		pthread_cond_broadcast(&pool->done_cond);
+}
+
+
+static void * worker_pool_thread(void *arg)
+{
+	struct worker_pool *pool = arg;
+
+	if (worker_key_ready)
+		pthread_setspecific(worker_key, pool);
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->stop && !worker_pool_has_work(pool) &&
+		       dl_list_empty(&pool->jobs))
+			pthread_cond_wait(&pool->work_cond, &pool->lock);
+		if (pool->stop)
+			break;
+		if (worker_pool_has_work(pool))
+			worker_pool_process(pool);
+		else
+			worker_pool_run_job(pool);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+
+/**
+ * worker_pool_init - Start a pool of worker threads
+ * @num_threads: Number of worker threads to start
+ * Returns: Pointer to the worker pool or %NULL on failure
+ *
+ * All signals are blocked in the worker threads so that signals are delivered
+ * to the thread that is running the eloop. Debug output and the testing hooks
+ * are disabled in the worker threads, see wpa_debug_set_worker_cb().
+ */
+struct worker_pool * worker_pool_init(unsigned int num_threads)
+{
+	struct worker_pool *pool;
+	sigset_t all, old;
+	unsigned int i;
+
+	if (num_threads == 0)
+		return NULL;
+
+	pthread_once(&worker_key_once, worker_pool_key_init);
+	pool = os_zalloc(sizeof(*pool));
+	if (!pool)
+		return NULL;
+	pool->threads = os_calloc(num_threads, sizeof(pthread_t));
+	if (!pool->threads) {
+		os_free(pool);
+		return NULL;
+	}
+	dl_list_init(&pool->jobs);
+	dl_list_init(&pool->completed);
+	pool->notify[0] = pool->notify[1] = -1;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	for (i = 0; i < num_threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, worker_pool_thread,
+				   pool) != 0) {
+			wpa_printf(MSG_ERROR,
+				   "worker_pool: Failed to create thread: %s",
+				   strerror(errno));
+			break;
+		}
+		pool->num_threads++;
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (pool->num_threads < num_threads) {
+		worker_pool_deinit(pool);
+		return NULL;
+	}
+
+	wpa_printf(MSG_DEBUG, "worker_pool: Started %u worker threads",
+		   pool->num_threads);
+	return pool;
+}
+
+
+/**
+ * worker_pool_deinit - Stop the worker threads and free the pool
+ * @pool: Worker pool from worker_pool_init() or %NULL
+ *
+ * Pending jobs from worker_pool_submit() are completed and their done
+ * callbacks are called before the pool is freed.
+ */
+void worker_pool_deinit(struct worker_pool *pool)
+{
+	unsigned int i;
+
+	if (!pool)
+		return;
+
+	worker_pool_flush(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	if (pool->notify[0] >= 0) {
+		eloop_unregister_read_sock(pool->notify[0]);
+		close(pool->notify[0]);
+		close(pool->notify[1]);
+	}
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->lock);
+	os_free(pool->threads);
+	os_free(pool);
+}
+
+
+/**
+ * worker_pool_run - Process a batch of work items
+ * @pool: Worker pool from worker_pool_init() or %NULL to process the items in
+ *	the calling thread
+ * @func: Handler for the work items
+ * @ctx: Context data for the handler
+ * @count: Number of work items
+ *
+ * The work items are started in increasing index order and they are divided
+ * between the worker threads and the calling thread. If a handler returns 1,
+ * no new work items are started, but the ones that were already started are
+ * completed. In other words, all items with a smaller index than the one that
+ * stopped the batch are processed. This function returns once all started
+ * work items have been completed.
+ */
+void worker_pool_run(struct worker_pool *pool, worker_pool_func func,
+		     void *ctx, unsigned int count)
+{
+	unsigned int i;
+
+	if (!pool || count <= 1) {
+		for (i = 0; i < count; i++) {
+			if (func(ctx, i))
+				break;
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->func = func;
+	pool->ctx = ctx;
+	pool->count = count;
+	pool->next = 0;
+	pool->running = 0;
+	pool->cancel = 0;
+	pthread_cond_broadcast(&pool->work_cond);
+
+	worker_pool_process(pool);
+	while (pool->running > 0)
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+
+	pool->func = NULL;
+	pool->ctx = NULL;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+
+/* Call the done callbacks for completed jobs in the eloop thread */
+static void worker_pool_complete(struct worker_pool *pool)
+{
+	struct dl_list completed;
+	struct worker_pool_job *job;
+
+	dl_list_init(&completed);
+	pthread_mutex_lock(&pool->lock);
+	while ((job = dl_list_first(&pool->completed, struct worker_pool_job,
+				    list))) {
+		dl_list_del(&job->list);
+		dl_list_add_tail(&completed, &job->list);
+	}
+	pool->notified = 0;
+	pthread_mutex_unlock(&pool->lock);
+
+	while ((job = dl_list_first(&completed, struct worker_pool_job,
+				    list))) {
+		dl_list_del(&job->list);
+		job->done(job->ctx);
+		os_free(job);
+	}
+}
+
+
+static void worker_pool_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct worker_pool *pool = eloop_ctx;
+	char buf[16];
+
+	if (read(sock, buf, sizeof(buf)) < 0)
+		wpa_printf(MSG_ERROR, "worker_pool: read: %s", strerror(errno));
+	worker_pool_complete(pool);
+}
+
+
+static int worker_pool_init_notify(struct worker_pool *pool)
+{
+	if (pipe(pool->notify) < 0) {
+		wpa_printf(MSG_ERROR, "worker_pool: pipe: %s", strerror(errno));
+		pool->notify[0] = pool->notify[1] = -1;
+		return -1;
+	}
+
+	if (eloop_register_read_sock(pool->notify[0], worker_pool_receive,
+				     pool, NULL) < 0) {
+		close(pool->notify[0]);
+		close(pool->notify[1]);
+		pool->notify[0] = pool->notify[1] = -1;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * worker_pool_submit - Run a job asynchronously in a worker thread
+ * @pool: Worker pool from worker_pool_init()
+ * @func: Handler for the job; called in a worker thread
+ * @done: Completion handler; called in the eloop thread once func returns
+ * @ctx: Context data for the handlers
+ * Returns: 0 on success, -1 on failure
+ *
+ * Jobs are started in the order they were submitted, but they may complete
+ * in a different order when more than one worker thread is used. The done
+ * callback is always called, i.e., the caller must keep ctx valid until then.
+ */
+int worker_pool_submit(struct worker_pool *pool, worker_pool_job_func func,
+		       worker_pool_done_func done, void *ctx)
+{
+	struct worker_pool_job *job;
+
+	if (!pool)
+		return -1;
+
+	if (pool->notify[0] < 0 && worker_pool_init_notify(pool) < 0)
+		return -1;
+
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return -1;
+	job->func = func;
+	job->done = done;
+	job->ctx = ctx;
+
+	pthread_mutex_lock(&pool->lock);
+	dl_list_add_tail(&pool->jobs, &job->list);
+	pthread_cond_signal(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+
+/**
+ * worker_pool_flush - Wait for all submitted jobs to complete
+ * @pool: Worker pool from worker_pool_init() or %NULL
+ *
+ * The done callbacks for all completed jobs are called before this function
+ * returns. Jobs that are submitted from the done callbacks are not waited for.
+ */
+void worker_pool_flush(struct worker_pool *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->jobs_running > 0 || !dl_list_empty(&pool->jobs))
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	worker_pool_complete(pool);
+}
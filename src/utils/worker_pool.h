@@ -0,0 +1,98 @@
+/*
+ * Pool of worker threads for CPU intensive operations
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+struct worker_pool;
+
+/**
+ * worker_pool_func - Work item handler
+ * @ctx: Context data from worker_pool_run()
+ * @idx: Index of the work item (0 .. count - 1)
+ * Returns: 0 to continue, 1 to stop starting new work items
+ *
+ * This is called in a worker thread (or in the calling thread), so it must not
+ * use eloop or any other non-thread-safe functionality and it must not modify
+ * data that other work items may be accessing at the same time. Debug output
+ * (wpa_printf() and wpa_hexdump*()) and the TEST_FAIL() and allocation failure
+ * testing hooks are ignored in the worker threads, so any errors need to be
+ * reported by the caller once the work item has been completed.
+ */
+typedef int (*worker_pool_func)(void *ctx, unsigned int idx);
+
+/**
+ * worker_pool_job_func - Job handler
+ * @ctx: Context data from worker_pool_submit()
+ *
+ * This is called in a worker thread with the same restrictions as
+ * worker_pool_func. The results can be logged from the completion handler.
+ */
+typedef void (*worker_pool_job_func)(void *ctx);
+
+/**
+ * worker_pool_done_func - Job completion handler
+ * @ctx: Context data from worker_pool_submit()
+ *
+ * This is called in the eloop thread after the job handler has returned.
+ */
+typedef void (*worker_pool_done_func)(void *ctx);
+
+#ifdef CONFIG_WORKER_POOL
+
+struct worker_pool * worker_pool_init(unsigned int num_threads);
+void worker_pool_deinit(struct worker_pool *pool);
+void worker_pool_run(struct worker_pool *pool, worker_pool_func func,
+		     void *ctx, unsigned int count);
+int worker_pool_submit(struct worker_pool *pool, worker_pool_job_func func,
+		       worker_pool_done_func done, void *ctx);
+void worker_pool_flush(struct worker_pool *pool);
+int worker_pool_in_worker(void);
+
+#else /* CONFIG_WORKER_POOL */
+
+static inline struct worker_pool * worker_pool_init(unsigned int num_threads)
+{
+	return NULL;
+}
+
+static inline void worker_pool_deinit(struct worker_pool *pool)
+{
+}
+
+static inline void worker_pool_run(struct worker_pool *pool,
+				   worker_pool_func func, void *ctx,
+				   unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (func(ctx, i))
+			break;
+	}
+}
+
+static inline int worker_pool_submit(struct worker_pool *pool,
+				     worker_pool_job_func func,
+				     worker_pool_done_func done, void *ctx)
+{
+	return -1;
+}
+
+static inline void worker_pool_flush(struct worker_pool *pool)
+{
+}
+
+static inline int worker_pool_in_worker(void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_WORKER_POOL */
+
+#endif /* WORKER_POOL_H */
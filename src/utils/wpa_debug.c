@@ -57,6 +57,31 @@ static int wpa_to_android_level(int level)
 
 #endif /* CONFIG_ANDROID_LOG */
 
+#ifdef CONFIG_WORKER_POOL
+
+static int (*wpa_debug_in_worker_cb)(void) = NULL;
+
+/**
+ * wpa_debug_set_worker_cb - Register a worker thread check
+ * @cb: Callback returning 1 when called from a worker thread
+ *
+ * The debug output and the testing hooks are not synchronized with the eloop
+ * thread, so they are disabled in the threads identified by this callback.
+ */
+void wpa_debug_set_worker_cb(int (*cb)(void))
+{
+	wpa_debug_in_worker_cb = cb;
+}
+
+
+int wpa_debug_in_worker(void)
+{
+	return wpa_debug_in_worker_cb && wpa_debug_in_worker_cb();
+}
+
+#endif /* CONFIG_WORKER_POOL */
+
+
 #ifndef CONFIG_NO_STDOUT_DEBUG
 
 #ifdef CONFIG_DEBUG_FILE
@@ -210,6 +235,10 @@ void wpa_printf(int level, const char *fmt, ...)
 {
 	va_list ap;
 
+	/* The debug output is not synchronized with the eloop thread */
+	if (wpa_debug_in_worker())
+		return;
+
 	if (level >= wpa_debug_level) {
 #ifdef CONFIG_ANDROID_LOG
 		va_start(ap, fmt);
@@ -260,6 +289,9 @@ static void _wpa_hexdump(int level, const char *title, const u8 *buf,
 {
 	size_t i;
 
+	if (wpa_debug_in_worker())
+		return;
+
 #ifdef CONFIG_DEBUG_LINUX_TRACING
 	if (wpa_debug_tracing_file != NULL) {
 		fprintf(wpa_debug_tracing_file,
@@ -401,6 +433,9 @@ static void _wpa_hexdump_ascii(int level, const char *title, const void *buf,
 	const u8 *pos = buf;
 	const size_t line_len = 16;
 
+	if (wpa_debug_in_worker())
+		return;
+
 #ifdef CONFIG_DEBUG_LINUX_TRACING
 	if (wpa_debug_tracing_file != NULL) {
 		fprintf(wpa_debug_tracing_file,
@@ -349,6 +349,20 @@ static inline void wpa_debug_close_linux_tracing(void)
 
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
+#ifdef CONFIG_WORKER_POOL
+
+void wpa_debug_set_worker_cb(int (*cb)(void));
+int wpa_debug_in_worker(void);
+
+#else /* CONFIG_WORKER_POOL */
+
+static inline int wpa_debug_in_worker(void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_WORKER_POOL */
+
 
 #ifdef EAPOL_TEST
 #define WPA_ASSERT(a)						       \
@@ -0,0 +1,95 @@
+#!/bin/bash
+
+# EAP-TLS authentication rate of the integrated RADIUS server as a function of
+# the number of worker processes (radius_server_workers).
+#
+# A temporary PKI is generated with openssl and hostapd is started with
+# driver=none as a RADIUS server. A set of concurrent eapol_test processes then
+# perform full EAP-TLS authentications against it.
+
+if [ -z "$2" ]; then
+    echo "usage: $0 <path to hostapd> <path to eapol_test> [workers...]"
+    echo "environment: CLIENTS=<parallel eapol_test> (default 8)"
+    echo "             AUTHS=<authentications per client> (default 50)"
+    echo "             PORT=<UDP port> (default 18120)"
+    exit 1
+fi
+
+HOSTAPD=$(realpath $1)
+EAPOL_TEST=$(realpath $2)
+shift 2
+WORKERS=${@:-1 2 4}
+CLIENTS=${CLIENTS:-8}
+AUTHS=${AUTHS:-50}
+PORT=${PORT:-18120}
+
+DIR=$(mktemp -d)
+trap "rm -rf $DIR" EXIT
+cd $DIR
+
+openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj "/CN=Bench CA" \
+	-keyout ca.key -out ca.pem 2>/dev/null || exit 1
+for name in server client; do
+    openssl req -newkey rsa:2048 -nodes -subj "/CN=$name.example.com" \
+	    -keyout $name.key -out $name.csr 2>/dev/null || exit 1
+    openssl x509 -req -days 1 -in $name.csr -CA ca.pem -CAkey ca.key \
+	    -set_serial $RANDOM -out $name.pem 2>/dev/null || exit 1
+done
+
+echo "127.0.0.1/32 radius" > clients
+echo '* TLS' > users
+
+cat > eapol.conf <<EOF
+network={
+	key_mgmt=WPA-EAP
+	eap=TLS
+	identity="client.example.com"
+	ca_cert="$DIR/ca.pem"
+	client_cert="$DIR/client.pem"
+	private_key="$DIR/client.key"
+}
+EOF
+
+for workers in $WORKERS; do
+    cat > hostapd.conf <<EOF
+driver=none
+interface=bench0
+eap_server=1
+eap_user_file=$DIR/users
+ca_cert=$DIR/ca.pem
+server_cert=$DIR/server.pem
+private_key=$DIR/server.key
+radius_server_clients=$DIR/clients
+radius_server_auth_port=$PORT
+radius_server_workers=$workers
+EOF
+
+    $HOSTAPD hostapd.conf > hostapd.log 2>&1 &
+    PID=$!
+    sleep 1
+    if ! kill -0 $PID 2>/dev/null; then
+	echo "hostapd failed to start:"
+	cat hostapd.log
+	exit 1
+    fi
+
+    START=$(date +%s.%N)
+    for i in $(seq 1 $CLIENTS); do
+	$EAPOL_TEST -c eapol.conf -a 127.0.0.1 -p $PORT -s radius \
+		    -r $((AUTHS - 1)) -M 02:00:00:00:01:$(printf %02x $i) \
+		    > eapol_test.$i.log 2>&1 &
+    done
+    FAILED=0
+    for job in $(jobs -p); do
+	[ $job = $PID ] && continue
+	wait $job || FAILED=$((FAILED + 1))
+    done
+    END=$(date +%s.%N)
+
+    kill $PID
+    wait $PID 2>/dev/null
+
+    awk -v w=$workers -v c=$CLIENTS -v a=$AUTHS -v f=$FAILED \
+	-v t=$(awk -v s=$START -v e=$END 'BEGIN { print e - s }') \
+	'BEGIN { printf "workers=%d clients=%d auths=%d failed_clients=%d time=%.2fs auths/s=%.1f\n", w, c, c * a, f, t, c * a / t }'
+done
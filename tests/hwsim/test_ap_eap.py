@@ -2191,6 +2191,19 @@ def test_ap_wpa2_eap_peap_eap_tls(dev, apdev):
                 private_key2="auth_serv/user.key")
     eap_reauth(dev[0], "PEAP")
 
+def test_ap_wpa2_eap_peap_eap_tls_frag(dev, apdev):
+    """WPA2-Enterprise connection using EAP-PEAP/EAP-TLS with fragmentation"""
+    params = hostapd.wpa2_eap_params(ssid="test-wpa2-eap")
+    hapd = hostapd.add_ap(apdev[0], params)
+    # Both the outer handshake and the tunneled inner handshake messages from
+    # the peer are fragmented.
+    eap_connect(dev[0], hapd, "PEAP", "cert user",
+                ca_cert="auth_serv/ca.pem", phase2="auth=TLS",
+                ca_cert2="auth_serv/ca.pem",
+                client_cert2="auth_serv/user.pem",
+                private_key2="auth_serv/user.key", fragment_size="100")
+    eap_reauth(dev[0], "PEAP")
+
 def test_ap_wpa2_eap_peap_eap_vendor(dev, apdev):
     """WPA2-Enterprise connection using EAP-PEAP/EAP-vendor"""
     params = hostapd.wpa2_eap_params(ssid="test-wpa2-eap")
@@ -4168,6 +4181,75 @@ def test_ap_wpa2_eap_tls_ocsp_key_id(dev, apdev, params):
                    private_key_passwd="whatever", ocsp=2,
                    scan_freq="2412")
 
+def test_ap_wpa2_eap_tls_ocsp_refresh(dev, apdev, params):
+    """EAP-TLS and OCSP stapling response file updated at runtime"""
+    check_ocsp_support(dev[0])
+    check_pkcs12_support(dev[0])
+    ocsp = os.path.join(params['logdir'], "ocsp-server-cache-key-id.der")
+    ocsp_cache_key_id(ocsp)
+    if not os.path.exists(ocsp):
+        raise HwsimSkip("No OCSP response available")
+    cache = os.path.join(params['logdir'], "ocsp-refresh.der")
+    tmp = cache + ".tmp"
+    params = int_eap_server_params()
+    params["ocsp_stapling_response"] = cache
+    hapd = hostapd.add_ap(apdev[0], params)
+    tls = hapd.request("GET tls_library")
+    if not tls.startswith("OpenSSL"):
+        raise HwsimSkip("OCSP stapling response refresh not supported with this TLS library: " + tls)
+
+    dev[0].connect("test-wpa2-eap", key_mgmt="WPA-EAP", eap="TLS",
+                   identity="tls user", ca_cert="auth_serv/ca.pem",
+                   private_key="auth_serv/user.pkcs12",
+                   private_key_passwd="whatever", ocsp=2,
+                   wait_connect=False, scan_freq="2412")
+    ev = hapd.wait_event(["OCSP-STAPLING-REFRESH"], timeout=10)
+    if ev is None:
+        raise Exception("OCSP stapling response refresh not requested")
+    if "valid=0" not in ev:
+        raise Exception("Unexpected refresh event: " + ev)
+    ev = dev[0].wait_event(["CTRL-EVENT-EAP-FAILURE"], timeout=10)
+    if ev is None:
+        raise Exception("Timeout on EAP failure report")
+    dev[0].request("REMOVE_NETWORK all")
+    dev[0].wait_disconnected()
+
+    # A response that cannot be parsed is replaced as well
+    with open(tmp, "wb") as f:
+        f.write(b"not an OCSP response")
+    os.rename(tmp, cache)
+    # Allow the file modification check interval to pass
+    time.sleep(1.1)
+    dev[0].connect("test-wpa2-eap", key_mgmt="WPA-EAP", eap="TLS",
+                   identity="tls user", ca_cert="auth_serv/ca.pem",
+                   private_key="auth_serv/user.pkcs12",
+                   private_key_passwd="whatever", ocsp=2,
+                   wait_connect=False, scan_freq="2412")
+    ev = hapd.wait_event(["OCSP-STAPLING-REFRESH"], timeout=10)
+    if ev is None:
+        raise Exception("OCSP stapling response refresh not requested for an invalid file")
+    if "valid=0" not in ev:
+        raise Exception("Unexpected refresh event: " + ev)
+    ev = dev[0].wait_event(["CTRL-EVENT-EAP-FAILURE"], timeout=10)
+    if ev is None:
+        raise Exception("Timeout on EAP failure report")
+    dev[0].request("REMOVE_NETWORK all")
+    dev[0].wait_disconnected()
+
+    with open(ocsp, "rb") as f, open(tmp, "wb") as f2:
+        f2.write(f.read())
+    os.rename(tmp, cache)
+    # Allow the file modification check interval to pass
+    time.sleep(1.1)
+    dev[0].connect("test-wpa2-eap", key_mgmt="WPA-EAP", eap="TLS",
+                   identity="tls user", ca_cert="auth_serv/ca.pem",
+                   private_key="auth_serv/user.pkcs12",
+                   private_key_passwd="whatever", ocsp=2,
+                   scan_freq="2412")
+    ev = hapd.wait_event(["OCSP-STAPLING-REFRESH"], timeout=0.1)
+    if ev is not None:
+        raise Exception("Unexpected refresh event with a valid response")
+
 def ocsp_req(outfile):
     if os.path.exists(outfile):
         return
@@ -6341,6 +6423,77 @@ def test_eap_tls_session_resumption_expiration(dev, apdev):
     if dev[0].get_status_field("tls_session_reused") != '0':
         raise Exception("Session resumption used after lifetime expiration")
 
+def test_eap_tls_session_ticket_keys(dev, apdev):
+    """EAP-TLS session resumption with session ticket key rotation"""
+    keys = [binascii.hexlify(os.urandom(80)).decode() for i in range(3)]
+    fd, fname = tempfile.mkstemp()
+    try:
+        with os.fdopen(fd, "w") as f:
+            f.write("# current key\n" + keys[0] + "\n")
+        params = int_eap_server_params()
+        params['tls_session_lifetime'] = '60'
+        params['tls_session_ticket_keys'] = fname
+        hapd = hostapd.add_ap(apdev[0], params)
+        check_tls_session_resumption_capa(dev[0], hapd)
+        eap_connect(dev[0], hapd, "TLS", "tls user", ca_cert="auth_serv/ca.pem",
+                    client_cert="auth_serv/user.pem",
+                    private_key="auth_serv/user.key",
+                    phase1="tls_disable_session_ticket=0")
+        if dev[0].get_status_field("tls_session_reused") != '0':
+            raise Exception("Unexpected session resumption on the first connection")
+
+        res = eap_reauth(dev[0], "TLS")
+        if res['tls_session_reused'] != '1':
+            raise Exception("Session ticket not used on the second connection")
+
+        if "FAIL" not in hapd.request("TLS_TICKET_KEY_ADD 0011"):
+            raise Exception("Invalid session ticket key accepted")
+        if "OK" not in hapd.request("TLS_TICKET_KEY_ADD " + keys[1]):
+            raise Exception("TLS_TICKET_KEY_ADD failed")
+        res = eap_reauth(dev[0], "TLS")
+        if res['tls_session_reused'] != '1':
+            raise Exception("Ticket from the previous key not accepted")
+
+        with open(fname, "w") as f:
+            f.write(keys[2] + "\n")
+        if "OK" not in hapd.request("TLS_TICKET_KEYS_RELOAD"):
+            raise Exception("TLS_TICKET_KEYS_RELOAD failed")
+        res = eap_reauth(dev[0], "TLS")
+        if res['tls_session_reused'] != '0':
+            raise Exception("Ticket from a removed key accepted")
+        res = eap_reauth(dev[0], "TLS")
+        if res['tls_session_reused'] != '1':
+            raise Exception("Session ticket not used after key reload")
+
+        with open(fname, "w") as f:
+            f.write("invalid\n")
+        if "FAIL" not in hapd.request("TLS_TICKET_KEYS_RELOAD"):
+            raise Exception("Invalid key file accepted")
+        res = eap_reauth(dev[0], "TLS")
+        if res['tls_session_reused'] != '1':
+            raise Exception("Session ticket keys changed on failed reload")
+    finally:
+        os.unlink(fname)
+
+def test_eap_tls_private_key_threads(dev, apdev):
+    """EAP-TLS and PEAP server private key operations in worker threads"""
+    params = int_eap_server_params()
+    params['tls_private_key_threads'] = '2'
+    try:
+        hapd = hostapd.add_ap(apdev[0], params)
+    except Exception as e:
+        if "Failed to set hostapd parameter tls_private_key_threads" in str(e):
+            raise HwsimSkip("tls_private_key_threads not supported")
+        raise
+    eap_connect(dev[0], hapd, "TLS", "tls user", ca_cert="auth_serv/ca.pem",
+                client_cert="auth_serv/user.pem",
+                private_key="auth_serv/user.key")
+    eap_reauth(dev[0], "TLS")
+    eap_connect(dev[1], hapd, "PEAP", "user", anonymous_identity="peap",
+                ca_cert="auth_serv/ca.pem", password="password",
+                phase2="auth=MSCHAPV2")
+    eap_reauth(dev[1], "PEAP")
+
 def test_eap_tls_no_session_resumption(dev, apdev):
     """EAP-TLS session resumption disabled on server"""
     params = int_eap_server_params()
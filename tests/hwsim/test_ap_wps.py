@@ -145,6 +145,42 @@ def test_ap_wps_init_2ap_pbc(dev, apdev):
     if "[WPS-PBC]" in bss['flags']:
         raise Exception("WPS-PBC flag not cleared from AP2")
 
+def test_ap_wps_probe_resp_update(dev, apdev):
+    """WPS AP Probe Response frame updated after WPS state changes"""
+    ssid = "test-wps-probe-resp"
+    params = {"ssid": ssid, "eap_server": "1", "wps_state": "2",
+              "wpa_passphrase": "12345678", "wpa": "2",
+              "wpa_key_mgmt": "WPA-PSK", "rsn_pairwise": "CCMP"}
+    hapd = hostapd.add_ap(apdev[0], params)
+    bssid = apdev[0]['bssid']
+
+    def probe_resp_ies():
+        dev[0].request("BSS_FLUSH 0")
+        dev[0].scan_for_bss(bssid, freq="2412", force_scan=True)
+        return dev[0].get_bss(bssid)
+
+    bss = probe_resp_ies()
+    if "[WPS]" not in bss['flags'] or "[WPS-PBC]" in bss['flags']:
+        raise Exception("Unexpected flags before WPS_PBC: " + bss['flags'])
+
+    if "OK" not in hapd.request("WPS_PBC"):
+        raise Exception("WPS_PBC failed")
+    bss = probe_resp_ies()
+    if "[WPS-PBC]" not in bss['flags']:
+        raise Exception("WPS-PBC flag missing after WPS_PBC")
+
+    if "OK" not in hapd.request("WPS_CANCEL"):
+        raise Exception("WPS_CANCEL failed")
+    bss = probe_resp_ies()
+    if "[WPS-PBC]" in bss['flags']:
+        raise Exception("WPS-PBC flag not cleared after WPS_CANCEL")
+
+    # Vendor elements are included without UPDATE_BEACON
+    hapd.set("vendor_elements", "dd0411223301")
+    bss = probe_resp_ies()
+    if "dd0411223301" not in bss['ie']:
+        raise Exception("Vendor element missing from Probe Response")
+
 def test_ap_wps_init_2ap_pin(dev, apdev):
     """Initial two-radio AP configuration with first WPS PIN Enrollee"""
     ssid = "test-wps"
@@ -1362,7 +1362,7 @@ def test_mesh_wpa_init_fail(dev, apdev):
         dev[1].mesh_group_add(id)
         wait_fail_trigger(dev[0], "GET_FAIL")
 
-    with fail_test(dev[0], 2, "=omac1_aes_vector;aes_siv_encrypt"):
+    with fail_test(dev[0], 2, "=crypto_mac_final;aes_siv_encrypt"):
         id = add_mesh_secure_net(dev[2])
         dev[0].mesh_group_add(id)
         dev[2].request("SET sae_groups ")
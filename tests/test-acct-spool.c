@@ -0,0 +1,435 @@
+/*
+ * Test program for the RADIUS accounting spool file
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "radius/radius.h"
+#include "radius/radius_client.h"
+#include "ap/accounting_spool.h"
+
+#define NUM_MSGS 10
+#define DELAY_TIME 7
+
+static const u8 secret[] = "secret";
+static const u8 wrong_secret[] = "wrong secret";
+
+/*
+ * Accounting server stand-in that replies with an invalid Response
+ * Authenticator
+ */
+struct drop_test {
+	int s;
+	struct radius_client_data *radius;
+	struct accounting_spool *spool;
+	struct radius_msg *sent;
+	unsigned int responses;
+	unsigned int rejected;
+	unsigned int dropped;
+	int errors;
+};
+
+
+static struct radius_msg * build_msg(int i)
+{
+	struct radius_msg *msg;
+
+	msg = radius_msg_new(RADIUS_CODE_ACCOUNTING_REQUEST, i);
+	if (!msg ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_ACCT_STATUS_TYPE,
+				       RADIUS_ACCT_STATUS_TYPE_STOP) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_ACCT_SESSION_TIME,
+				       1000 + i) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+				       DELAY_TIME)) {
+		radius_msg_free(msg);
+		return NULL;
+	}
+	radius_msg_finish_acct(msg, secret, sizeof(secret) - 1);
+	return msg;
+}
+
+
+/* Check that the head of the spool is the message built with index i */
+static int check_head(struct accounting_spool *spool, int i)
+{
+	struct radius_msg *msg;
+	u32 val;
+	int errors = 0;
+
+	msg = accounting_spool_get(spool);
+	if (!msg) {
+		printf("no message for index %d\n", i);
+		return 1;
+	}
+
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_SESSION_TIME,
+				      &val) < 0 ||
+	    val != (u32) (1000 + i)) {
+		printf("unexpected message for index %d\n", i);
+		errors++;
+	}
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+				      &val) < 0 || val < DELAY_TIME) {
+		printf("invalid Acct-Delay-Time for index %d\n", i);
+		errors++;
+	}
+
+	radius_msg_free(msg);
+	return errors;
+}
+
+
+static off_t file_size(const char *fname)
+{
+	struct stat st;
+
+	if (stat(fname, &st) < 0)
+		return -1;
+	return st.st_size;
+}
+
+
+static void server_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct drop_test *dt = eloop_ctx;
+	struct radius_msg *req, *resp = NULL;
+	struct sockaddr_in from;
+	socklen_t fromlen = sizeof(from);
+	u8 buf[1000];
+	int len;
+
+	len = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *) &from,
+		       &fromlen);
+	if (len < 0)
+		return;
+	req = radius_msg_parse(buf, len);
+	if (req)
+		resp = radius_msg_new(RADIUS_CODE_ACCOUNTING_RESPONSE,
+				      radius_msg_get_hdr(req)->identifier);
+	if (!resp ||
+	    radius_msg_finish_srv(resp, wrong_secret, sizeof(wrong_secret) - 1,
+				  radius_msg_get_hdr(req)->authenticator) < 0 ||
+	    sendto(sock, wpabuf_head(radius_msg_get_buf(resp)),
+		   wpabuf_len(radius_msg_get_buf(resp)), 0,
+		   (struct sockaddr *) &from, fromlen) < 0) {
+		printf("failed to send Accounting-Response\n");
+		dt->errors++;
+	}
+	dt->responses++;
+	radius_msg_free(req);
+	radius_msg_free(resp);
+}
+
+
+static RadiusRxResult client_receive(struct radius_msg *msg,
+				     struct radius_msg *req,
+				     const u8 *shared_secret,
+				     size_t shared_secret_len, void *data)
+{
+	struct drop_test *dt = data;
+
+	if (radius_msg_verify(msg, shared_secret, shared_secret_len, req, 0)) {
+		dt->rejected++;
+		return RADIUS_RX_INVALID_AUTHENTICATOR;
+	}
+
+	printf("response with invalid authenticator accepted\n");
+	dt->errors++;
+	eloop_terminate();
+	return RADIUS_RX_PROCESSED;
+}
+
+
+static void client_drop(struct radius_msg *msg, void *ctx)
+{
+	struct drop_test *dt = ctx;
+
+	if (msg != dt->sent) {
+		printf("unexpected message dropped\n");
+		dt->errors++;
+	}
+	dt->dropped++;
+	if (accounting_spool_add(dt->spool, msg) < 0)
+		dt->errors++;
+	eloop_terminate();
+}
+
+
+static void drop_test_timeout(void *eloop_ctx, void *user_ctx)
+{
+	struct drop_test *dt = eloop_ctx;
+
+	printf("timeout waiting for the rejected response\n");
+	dt->errors++;
+	eloop_terminate();
+}
+
+
+/*
+ * An Accounting-Request that gets a response none of the handlers accept must
+ * be passed to the drop callback like one that got no response at all.
+ */
+static int test_rejected_response(const char *fname)
+{
+	struct drop_test dt;
+	struct hostapd_radius_servers conf;
+	struct hostapd_radius_server serv;
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	struct radius_msg *msg;
+
+	os_memset(&dt, 0, sizeof(dt));
+	os_memset(&conf, 0, sizeof(conf));
+	os_memset(&serv, 0, sizeof(serv));
+	if (eloop_init())
+		return 1;
+
+	dt.spool = accounting_spool_init(fname, 0);
+	dt.s = socket(PF_INET, SOCK_DGRAM, 0);
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (!dt.spool || dt.s < 0 ||
+	    bind(dt.s, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(dt.s, (struct sockaddr *) &addr, &addrlen) < 0 ||
+	    eloop_register_read_sock(dt.s, server_receive, &dt, NULL) < 0) {
+		printf("failed to initialize accounting server\n");
+		dt.errors++;
+		goto out;
+	}
+
+	serv.addr.af = AF_INET;
+	serv.addr.u.v4.s_addr = htonl(INADDR_LOOPBACK);
+	serv.port = ntohs(addr.sin_port);
+	serv.shared_secret = (u8 *) secret;
+	serv.shared_secret_len = sizeof(secret) - 1;
+	conf.acct_servers = conf.acct_server = &serv;
+	conf.num_acct_servers = 1;
+
+	dt.radius = radius_client_init(NULL, &conf);
+	if (!dt.radius ||
+	    radius_client_register(dt.radius, RADIUS_ACCT, client_receive,
+				   &dt) < 0) {
+		printf("failed to initialize RADIUS client\n");
+		dt.errors++;
+		goto out;
+	}
+	radius_client_set_acct_drop_cb(dt.radius, client_drop, &dt);
+
+	msg = build_msg(0);
+	if (!msg) {
+		dt.errors++;
+		goto out;
+	}
+	dt.sent = msg;
+	if (radius_client_send(dt.radius, msg, RADIUS_ACCT, NULL) < 0) {
+		printf("failed to send Accounting-Request\n");
+		radius_msg_free(msg);
+		dt.errors++;
+		goto out;
+	}
+
+	eloop_register_timeout(10, 0, drop_test_timeout, &dt, NULL);
+	eloop_run();
+	eloop_cancel_timeout(drop_test_timeout, &dt, NULL);
+
+	if (dt.responses != 1 || dt.rejected != 1 || dt.dropped != 1) {
+		printf("unexpected rejected response handling (responses=%u rejected=%u dropped=%u)\n",
+		       dt.responses, dt.rejected, dt.dropped);
+		dt.errors++;
+	}
+	if (accounting_spool_count(dt.spool) != 1) {
+		printf("rejected message not spooled\n");
+		dt.errors++;
+	} else {
+		dt.errors += check_head(dt.spool, 0);
+	}
+
+out:
+	radius_client_deinit(dt.radius);
+	if (dt.s >= 0) {
+		eloop_unregister_read_sock(dt.s);
+		close(dt.s);
+	}
+	accounting_spool_deinit(dt.spool);
+	eloop_destroy();
+	return dt.errors;
+}
+
+
+/* Records that would exceed the maximum file size are not added */
+static int test_max_size(const char *fname)
+{
+	struct accounting_spool *spool;
+	struct radius_msg *msg;
+	off_t size;
+	int i, errors = 0;
+
+	spool = accounting_spool_init(fname, 0);
+	msg = build_msg(0);
+	if (!spool || !msg || accounting_spool_add(spool, msg) < 0) {
+		printf("failed to add message to unlimited spool\n");
+		errors++;
+		goto out;
+	}
+	size = file_size(fname);
+	accounting_spool_remove(spool);
+	accounting_spool_deinit(spool);
+
+	/* Room for two records */
+	spool = accounting_spool_init(fname, 2 * size + size / 2);
+	if (!spool) {
+		errors++;
+		goto out;
+	}
+	for (i = 0; i < 3; i++) {
+		if ((accounting_spool_add(spool, msg) < 0) != (i == 2)) {
+			printf("unexpected result for message %d in limited spool\n",
+			       i);
+			errors++;
+		}
+	}
+	if (accounting_spool_count(spool) != 2 ||
+	    file_size(fname) != 2 * size) {
+		printf("limited spool has unexpected size\n");
+		errors++;
+	}
+
+	/* Space is available again once the spool has been replayed */
+	while (accounting_spool_count(spool))
+		accounting_spool_remove(spool);
+	if (accounting_spool_add(spool, msg) < 0) {
+		printf("failed to add message to emptied spool\n");
+		errors++;
+	}
+	accounting_spool_remove(spool);
+
+out:
+	radius_msg_free(msg);
+	accounting_spool_deinit(spool);
+	return errors;
+}
+
+
+int main(int argc, char *argv[])
+{
+	char fname[] = "/tmp/test-acct-spool.XXXXXX";
+	struct accounting_spool *spool = NULL;
+	struct radius_msg *msg;
+	off_t size;
+	int fd, i, errors = 0;
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+
+	fd = mkstemp(fname);
+	if (fd < 0)
+		return -1;
+	close(fd);
+
+	spool = accounting_spool_init(fname, 0);
+	if (!spool || accounting_spool_count(spool) != 0 ||
+	    accounting_spool_get(spool)) {
+		printf("new spool not empty\n");
+		goto fail;
+	}
+
+	for (i = 0; i < NUM_MSGS; i++) {
+		msg = build_msg(i);
+		if (!msg || accounting_spool_add(spool, msg) < 0) {
+			printf("failed to add message %d\n", i);
+			radius_msg_free(msg);
+			goto fail;
+		}
+		radius_msg_free(msg);
+	}
+	if (accounting_spool_count(spool) != NUM_MSGS) {
+		printf("unexpected count after add\n");
+		errors++;
+	}
+
+	/* The head stays in place until it is removed */
+	errors += check_head(spool, 0);
+	errors += check_head(spool, 0);
+	for (i = 0; i < 3; i++) {
+		if (accounting_spool_remove(spool) < 0) {
+			printf("failed to remove message %d\n", i);
+			errors++;
+		}
+	}
+	errors += check_head(spool, 3);
+
+	/* Removed records are not returned again after reopening */
+	accounting_spool_deinit(spool);
+	spool = accounting_spool_init(fname, 0);
+	if (!spool || accounting_spool_count(spool) != NUM_MSGS - 3) {
+		printf("unexpected count after reopen\n");
+		goto fail;
+	}
+	errors += check_head(spool, 3);
+
+	/* A partial record at the end of the file is removed on open */
+	accounting_spool_deinit(spool);
+	spool = NULL;
+	size = file_size(fname);
+	fd = open(fname, O_WRONLY | O_APPEND);
+	if (fd < 0 || write(fd, "\x41\x53\x00\x40\x00", 5) != 5) {
+		printf("failed to append garbage\n");
+		if (fd >= 0)
+			close(fd);
+		goto fail;
+	}
+	close(fd);
+	spool = accounting_spool_init(fname, 0);
+	if (!spool || accounting_spool_count(spool) != NUM_MSGS - 3 ||
+	    file_size(fname) != size) {
+		printf("partial record not truncated\n");
+		goto fail;
+	}
+
+	/* The file is truncated once the last record has been removed */
+	for (i = 3; i < NUM_MSGS; i++) {
+		errors += check_head(spool, i);
+		if (accounting_spool_remove(spool) < 0) {
+			printf("failed to remove message %d\n", i);
+			errors++;
+		}
+	}
+	if (accounting_spool_count(spool) != 0 ||
+	    accounting_spool_remove(spool) == 0 || file_size(fname) != 0) {
+		printf("spool not empty after removing all messages\n");
+		errors++;
+	}
+	accounting_spool_deinit(spool);
+	spool = NULL;
+
+	errors += test_max_size(fname);
+	errors += test_rejected_response(fname);
+
+	if (errors) {
+		printf("%d errors\n", errors);
+		goto fail;
+	}
+
+	accounting_spool_deinit(spool);
+	unlink(fname);
+	os_program_deinit();
+	printf("Accounting spool tests completed successfully\n");
+	return 0;
+
+fail:
+	accounting_spool_deinit(spool);
+	unlink(fname);
+	os_program_deinit();
+	return -1;
+}
@@ -0,0 +1,385 @@
+/*
+ * Test program for the RADIUS MAC ACL cache
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "radius/radius.h"
+#include "radius/radius_client.h"
+#include "ap/hostapd.h"
+#include "ap/ieee802_11_auth.h"
+#include "test_util.h"
+
+#define NUM_STA 1000
+#define NUM_BENCH_STA 20000
+#define NUM_LOOKUP_ROUNDS 20
+#define QUERY_CHUNK 250
+#define CACHE_SIZE 100
+
+static const char *secret = "acl cache test";
+
+
+const struct wpa_driver_ops *const wpa_drivers[] =
+{
+	NULL
+};
+
+
+/* Local RADIUS server stand-in that accepts even and rejects odd addresses */
+struct acl_server {
+	int s;
+	unsigned int received;
+	int errors;
+};
+
+struct test_ctx {
+	struct hostapd_iface iface;
+	struct hostapd_data hapd;
+	struct wpa_driver_ops driver;
+	struct hostapd_radius_server serv;
+	struct acl_server srv;
+};
+
+
+static void sta_addr(u8 *addr, int i)
+{
+	os_memcpy(addr, "\x02\x00\x00\x00\x00\x00", ETH_ALEN);
+	WPA_PUT_BE24(&addr[3], i);
+}
+
+
+static void server_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct acl_server *srv = eloop_ctx;
+	struct radius_msg *msg, *resp = NULL;
+	struct sockaddr_in from;
+	socklen_t fromlen = sizeof(from);
+	u8 buf[3000], addr[ETH_ALEN], *pos;
+	char name[13];
+	size_t len;
+	int res;
+	u8 code;
+
+	res = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *) &from,
+		       &fromlen);
+	if (res < 0)
+		return;
+
+	msg = radius_msg_parse(buf, res);
+	if (!msg ||
+	    radius_msg_get_attr_ptr(msg, RADIUS_ATTR_USER_NAME, &pos, &len,
+				    NULL) < 0 ||
+	    len != 2 * ETH_ALEN) {
+		printf("Invalid request received\n");
+		srv->errors++;
+		goto out;
+	}
+	os_memcpy(name, pos, len);
+	name[len] = '\0';
+	if (hexstr2bin(name, addr, ETH_ALEN) < 0) {
+		srv->errors++;
+		goto out;
+	}
+	srv->received++;
+
+	code = addr[5] & 1 ? RADIUS_CODE_ACCESS_REJECT :
+		RADIUS_CODE_ACCESS_ACCEPT;
+	resp = radius_msg_new(code, radius_msg_get_hdr(msg)->identifier);
+	if (!resp ||
+	    radius_msg_finish_srv(resp, (const u8 *) secret, os_strlen(secret),
+				  radius_msg_get_hdr(msg)->authenticator) < 0 ||
+	    sendto(sock, wpabuf_head(radius_msg_get_buf(resp)),
+		   wpabuf_len(radius_msg_get_buf(resp)), 0,
+		   (struct sockaddr *) &from, fromlen) < 0) {
+		printf("Failed to send response\n");
+		srv->errors++;
+	}
+
+out:
+	radius_msg_free(resp);
+	radius_msg_free(msg);
+}
+
+
+static int server_init(struct acl_server *srv,
+		       struct hostapd_radius_server *serv)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	srv->s = socket(PF_INET, SOCK_DGRAM, 0);
+	if (srv->s < 0)
+		return -1;
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(srv->s, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(srv->s, (struct sockaddr *) &addr, &addrlen) < 0 ||
+	    eloop_register_read_sock(srv->s, server_receive, srv, NULL) < 0) {
+		printf("Failed to initialize RADIUS server socket: %s\n",
+		       strerror(errno));
+		close(srv->s);
+		srv->s = -1;
+		return -1;
+	}
+
+	serv->addr.af = AF_INET;
+	serv->addr.u.v4.s_addr = htonl(INADDR_LOOPBACK);
+	serv->port = ntohs(addr.sin_port);
+	serv->shared_secret = (u8 *) secret;
+	serv->shared_secret_len = os_strlen(secret);
+
+	return 0;
+}
+
+
+static void server_deinit(struct acl_server *srv)
+{
+	if (srv->s >= 0) {
+		eloop_unregister_read_sock(srv->s);
+		close(srv->s);
+	}
+}
+
+
+static void queries_done(void *eloop_ctx, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+
+	if (dl_list_empty(&hapd->acl_queries))
+		eloop_terminate();
+	else
+		eloop_register_timeout(0, 1000, queries_done, hapd, NULL);
+}
+
+
+static void queries_timeout(void *eloop_ctx, void *user_ctx)
+{
+	printf("Timeout waiting for ACL query responses\n");
+	eloop_terminate();
+}
+
+
+/* Wait for the responses to all pending queries */
+static int wait_queries(struct hostapd_data *hapd)
+{
+	eloop_register_timeout(0, 1000, queries_done, hapd, NULL);
+	eloop_register_timeout(5, 0, queries_timeout, hapd, NULL);
+	eloop_run();
+	eloop_cancel_timeout(queries_done, hapd, NULL);
+	eloop_cancel_timeout(queries_timeout, hapd, NULL);
+	return dl_list_empty(&hapd->acl_queries) ? 0 : -1;
+}
+
+
+static int check_address(struct hostapd_data *hapd, int i)
+{
+	/* Too short to be processed as a frame when it is re-sent after the
+	 * query has been completed */
+	static const u8 frame[1];
+	struct radius_sta info;
+	u8 addr[ETH_ALEN];
+	int res;
+
+	sta_addr(addr, i);
+	res = hostapd_allowed_address(hapd, addr, frame, sizeof(frame), &info,
+				      0);
+	if (res == HOSTAPD_ACL_ACCEPT || res == HOSTAPD_ACL_ACCEPT_TIMEOUT)
+		return HOSTAPD_ACL_ACCEPT;
+	return res;
+}
+
+
+/* Query the addresses first..first+num-1 from the server and check that
+ * results are returned from the cache after that */
+static int query_addresses(struct test_ctx *ctx, int first, int num)
+{
+	struct hostapd_data *hapd = &ctx->hapd;
+	unsigned int received = ctx->srv.received;
+	int i, j, end, errors = 0;
+
+	for (i = first; i < first + num; i += QUERY_CHUNK) {
+		end = i + QUERY_CHUNK < first + num ? i + QUERY_CHUNK :
+			first + num;
+		/* Retries while the query is pending do not generate new
+		 * queries */
+		for (j = i; j < end; j++) {
+			if (check_address(hapd, j) != HOSTAPD_ACL_PENDING ||
+			    check_address(hapd, j) != HOSTAPD_ACL_PENDING)
+				errors++;
+		}
+		if (wait_queries(hapd) < 0)
+			return -1;
+	}
+
+	if (ctx->srv.received - received != (unsigned int) num) {
+		printf("%u queries sent for %d addresses\n",
+		       ctx->srv.received - received, num);
+		errors++;
+	}
+
+	return errors;
+}
+
+
+static int test_cache(struct test_ctx *ctx)
+{
+	struct hostapd_data *hapd = &ctx->hapd;
+	unsigned int received;
+	int i, res, errors = 0;
+
+	errors += query_addresses(ctx, 0, NUM_STA);
+	received = ctx->srv.received;
+	for (i = 0; i < NUM_STA; i++) {
+		res = check_address(hapd, i);
+		if (res != (i & 1 ? HOSTAPD_ACL_REJECT : HOSTAPD_ACL_ACCEPT))
+			errors++;
+	}
+	if (ctx->srv.received != received) {
+		printf("Cached results were queried again\n");
+		errors++;
+	}
+
+	/* Without negative caching, rejected addresses are queried again */
+	hostapd_acl_deinit(hapd);
+	hapd->conf->radius_acl_reject_timeout = 0;
+	errors += query_addresses(ctx, 0, NUM_STA);
+	if (hapd->acl_cache_hash.count != NUM_STA / 2) {
+		printf("Unexpected number of cached entries %u\n",
+		       (unsigned int) hapd->acl_cache_hash.count);
+		errors++;
+	}
+	for (i = 0; i < NUM_STA; i++) {
+		res = check_address(hapd, i);
+		if (res != (i & 1 ? HOSTAPD_ACL_PENDING : HOSTAPD_ACL_ACCEPT))
+			errors++;
+	}
+	if (wait_queries(hapd) < 0)
+		errors++;
+	hapd->conf->radius_acl_reject_timeout = 30;
+
+	/* The least recently used entries are removed from a full cache */
+	hostapd_acl_deinit(hapd);
+	hapd->conf->radius_acl_cache_size = CACHE_SIZE;
+	errors += query_addresses(ctx, 0, CACHE_SIZE);
+	for (i = 0; i < CACHE_SIZE / 2; i++) {
+		if (check_address(hapd, i) == HOSTAPD_ACL_PENDING)
+			errors++;
+	}
+	errors += query_addresses(ctx, CACHE_SIZE, CACHE_SIZE / 2);
+	if (hapd->acl_cache_hash.count != CACHE_SIZE ||
+	    dl_list_len(&hapd->acl_cache) != CACHE_SIZE) {
+		printf("Cache size not limited\n");
+		errors++;
+	}
+	received = ctx->srv.received;
+	for (i = 0; i < CACHE_SIZE / 2; i++) {
+		if (check_address(hapd, i) == HOSTAPD_ACL_PENDING)
+			errors++;
+	}
+	if (ctx->srv.received != received) {
+		printf("Recently used entries were removed\n");
+		errors++;
+	}
+	if (check_address(hapd, CACHE_SIZE / 2) != HOSTAPD_ACL_PENDING) {
+		printf("Least recently used entry was not removed\n");
+		errors++;
+	}
+	if (wait_queries(hapd) < 0)
+		errors++;
+	hapd->conf->radius_acl_cache_size = 0;
+
+	if (errors)
+		printf("ACL cache tests: %d errors\n", errors);
+	return errors;
+}
+
+
+static int benchmark(struct test_ctx *ctx)
+{
+	struct hostapd_data *hapd = &ctx->hapd;
+	struct os_reltime start;
+	unsigned int usec;
+	int i, r, errors = 0;
+
+	hostapd_acl_deinit(hapd);
+	errors += query_addresses(ctx, 0, NUM_BENCH_STA);
+
+	os_get_reltime(&start);
+	for (r = 0; r < NUM_LOOKUP_ROUNDS; r++) {
+		for (i = 0; i < NUM_BENCH_STA; i++) {
+			if (check_address(hapd, (i * 7) % NUM_BENCH_STA) ==
+			    HOSTAPD_ACL_PENDING)
+				errors++;
+		}
+	}
+	usec = time_diff_usec(&start);
+	printf("%d cached entries: %d lookups in %u usec (%u nsec/op)\n",
+	       NUM_BENCH_STA, NUM_BENCH_STA * NUM_LOOKUP_ROUNDS, usec,
+	       (unsigned int) ((u64) usec * 1000 /
+			       (NUM_BENCH_STA * NUM_LOOKUP_ROUNDS)));
+
+	return errors;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct test_ctx ctx;
+	struct hostapd_data *hapd = &ctx.hapd;
+	struct hostapd_radius_servers *radius = NULL;
+	int ret = -1;
+
+	if (os_program_init())
+		return -1;
+	if (eloop_init() < 0)
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+
+	os_memset(&ctx, 0, sizeof(ctx));
+	ctx.srv.s = -1;
+	dl_list_init(&hapd->acl_cache);
+	dl_list_init(&hapd->acl_queries);
+	hapd->driver = &ctx.driver;
+	os_memcpy(hapd->own_addr, "\x02\x00\x00\x00\x03\x00", ETH_ALEN);
+	hapd->iface = &ctx.iface;
+	hapd->iface->conf = hostapd_config_defaults();
+	if (!hapd->iface->conf)
+		goto fail;
+	hapd->iconf = hapd->iface->conf;
+	hapd->conf = hapd->iconf->bss[0];
+	hapd->conf->macaddr_acl = USE_EXTERNAL_RADIUS_AUTH;
+
+	if (server_init(&ctx.srv, &ctx.serv) < 0)
+		goto fail;
+	radius = hapd->conf->radius;
+	radius->auth_servers = radius->auth_server = &ctx.serv;
+	radius->num_auth_servers = 1;
+	hapd->radius = radius_client_init(hapd, radius);
+	if (!hapd->radius || hostapd_acl_init(hapd) < 0)
+		goto fail;
+
+	if (test_cache(&ctx) || benchmark(&ctx) || ctx.srv.errors)
+		goto fail;
+
+	ret = 0;
+	printf("ACL cache tests completed successfully\n");
+fail:
+	hostapd_acl_deinit(hapd);
+	radius_client_deinit(hapd->radius);
+	server_deinit(&ctx.srv);
+	if (radius) {
+		radius->auth_servers = radius->auth_server = NULL;
+		radius->num_auth_servers = 0;
+	}
+	hostapd_config_free(hapd->iconf);
+	eloop_destroy();
+	os_program_deinit();
+	return ret;
+}
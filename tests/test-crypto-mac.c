@@ -0,0 +1,303 @@
+/*
+ * Test program for keyed MAC contexts
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "crypto/crypto.h"
+#include "crypto/aes_wrap.h"
+#include "crypto/sha1.h"
+#include "crypto/sha256.h"
+#include "crypto/sha384.h"
+#include "crypto/sha512.h"
+#include "test_util.h"
+
+#define NUM_BENCH 100000
+#define BENCH_MSG_LEN 64
+
+
+/* RFC 4493, 4. Test Vectors */
+static const u8 cmac_key[] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const u8 cmac_msg[] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+	0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+	0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+	0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+	0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+static const struct {
+	size_t len;
+	u8 tag[16];
+} cmac_tests[] = {
+	{ 0, { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28,
+	       0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+	{ 16, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44,
+		0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+	{ 40, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30,
+		0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+	{ 64, { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92,
+		0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } },
+};
+
+
+/* Feed the message in uneven pieces to exercise partial block handling */
+static int mac_chunked(struct crypto_mac *ctx, const u8 *data, size_t len,
+		       size_t chunk, u8 *mac)
+{
+	size_t pos = 0, n;
+
+	while (pos < len) {
+		n = len - pos < chunk ? len - pos : chunk;
+		if (crypto_mac_update(ctx, data + pos, n) < 0)
+			return -1;
+		pos += n;
+	}
+	return crypto_mac_final(ctx, mac);
+}
+
+
+static int test_cmac(void)
+{
+	struct crypto_mac *ctx;
+	u8 mac[16], ref[16], key256[32], msg[100];
+	size_t i, len, chunk;
+	int errors = 0;
+
+	ctx = crypto_mac_init(CRYPTO_MAC_AES_CMAC, cmac_key, sizeof(cmac_key));
+	if (!ctx) {
+		printf("AES-CMAC: crypto_mac_init failed\n");
+		return 1;
+	}
+	if (crypto_mac_len(ctx) != 16) {
+		printf("AES-CMAC: unexpected MAC length\n");
+		errors++;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(cmac_tests); i++) {
+		for (chunk = 1; chunk <= 17; chunk++) {
+			if (mac_chunked(ctx, cmac_msg, cmac_tests[i].len,
+					chunk, mac) < 0 ||
+			    os_memcmp(mac, cmac_tests[i].tag, 16) != 0) {
+				printf("AES-CMAC: RFC 4493 len=%u chunk=%u mismatch\n",
+				       (unsigned int) cmac_tests[i].len,
+				       (unsigned int) chunk);
+				errors++;
+				break;
+			}
+		}
+	}
+
+	/* A reset discards the pending data */
+	if (crypto_mac_update(ctx, cmac_msg, 23) < 0 ||
+	    crypto_mac_reset(ctx) < 0 ||
+	    crypto_mac_final(ctx, mac) < 0 ||
+	    os_memcmp(mac, cmac_tests[0].tag, 16) != 0) {
+		printf("AES-CMAC: reset did not clear state\n");
+		errors++;
+	}
+	crypto_mac_deinit(ctx);
+
+	for (i = 0; i < sizeof(key256); i++)
+		key256[i] = i * 7 + 1;
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = i ^ 0x5a;
+	ctx = crypto_mac_init(CRYPTO_MAC_AES_CMAC, key256, sizeof(key256));
+	if (!ctx) {
+		printf("AES-CMAC: crypto_mac_init failed for 256-bit key\n");
+		return errors + 1;
+	}
+	for (len = 0; len <= sizeof(msg); len++) {
+		if (omac1_aes_256(key256, msg, len, ref) < 0 ||
+		    mac_chunked(ctx, msg, len, 5, mac) < 0 ||
+		    os_memcmp(mac, ref, 16) != 0) {
+			printf("AES-CMAC-256: len=%u mismatch\n",
+			       (unsigned int) len);
+			errors++;
+			break;
+		}
+	}
+	crypto_mac_deinit(ctx);
+
+	return errors;
+}
+
+
+static int hmac_ref(enum crypto_mac_alg alg, const u8 *key, size_t key_len,
+		    const u8 *data, size_t len, u8 *mac)
+{
+	switch (alg) {
+	case CRYPTO_MAC_HMAC_SHA1:
+		return hmac_sha1(key, key_len, data, len, mac);
+	case CRYPTO_MAC_HMAC_SHA256:
+		return hmac_sha256(key, key_len, data, len, mac);
+	case CRYPTO_MAC_HMAC_SHA384:
+		return hmac_sha384(key, key_len, data, len, mac);
+	case CRYPTO_MAC_HMAC_SHA512:
+		return hmac_sha512(key, key_len, data, len, mac);
+	default:
+		return -1;
+	}
+}
+
+
+static int test_hmac(void)
+{
+	static const struct {
+		enum crypto_mac_alg alg;
+		const char *name;
+		size_t mac_len;
+	} algs[] = {
+		{ CRYPTO_MAC_HMAC_SHA1, "HMAC-SHA1", SHA1_MAC_LEN },
+		{ CRYPTO_MAC_HMAC_SHA256, "HMAC-SHA256", SHA256_MAC_LEN },
+		{ CRYPTO_MAC_HMAC_SHA384, "HMAC-SHA384", SHA384_MAC_LEN },
+		{ CRYPTO_MAC_HMAC_SHA512, "HMAC-SHA512", SHA512_MAC_LEN },
+	};
+	/* RFC 4231, Test Case 2 */
+	static const u8 rfc4231_mac[] = {
+		0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+		0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+		0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+		0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+	};
+	static const size_t key_lens[] = { 4, 20, 64, 65, 128, 131 };
+	const char *rfc_data = "what do ya want for nothing?";
+	struct crypto_mac *ctx;
+	u8 key[131], msg[300], mac[64], ref[64];
+	size_t a, k, len;
+	int errors = 0;
+
+	for (k = 0; k < sizeof(key); k++)
+		key[k] = k * 13 + 3;
+	for (k = 0; k < sizeof(msg); k++)
+		msg[k] = k * 31;
+
+	ctx = crypto_mac_init(CRYPTO_MAC_HMAC_SHA256, (const u8 *) "Jefe", 4);
+	if (!ctx ||
+	    mac_chunked(ctx, (const u8 *) rfc_data, os_strlen(rfc_data), 3,
+			mac) < 0 ||
+	    os_memcmp(mac, rfc4231_mac, sizeof(rfc4231_mac)) != 0) {
+		printf("HMAC-SHA256: RFC 4231 test case 2 mismatch\n");
+		errors++;
+	}
+	crypto_mac_deinit(ctx);
+
+	for (a = 0; a < ARRAY_SIZE(algs); a++) {
+		for (k = 0; k < ARRAY_SIZE(key_lens); k++) {
+			ctx = crypto_mac_init(algs[a].alg, key, key_lens[k]);
+			if (!ctx) {
+				printf("%s: not supported in this build\n",
+				       algs[a].name);
+				break;
+			}
+			if (crypto_mac_len(ctx) != algs[a].mac_len) {
+				printf("%s: unexpected MAC length\n",
+				       algs[a].name);
+				errors++;
+			}
+			/* The same context is used for all the messages */
+			for (len = 0; len <= sizeof(msg); len += 13) {
+				if (hmac_ref(algs[a].alg, key, key_lens[k],
+					     msg, len, ref) < 0 ||
+				    mac_chunked(ctx, msg, len, 7, mac) < 0 ||
+				    os_memcmp(mac, ref, algs[a].mac_len) != 0) {
+					printf("%s: key_len=%u len=%u mismatch\n",
+					       algs[a].name,
+					       (unsigned int) key_lens[k],
+					       (unsigned int) len);
+					errors++;
+					break;
+				}
+			}
+			crypto_mac_deinit(ctx);
+		}
+	}
+
+	return errors;
+}
+
+
+static int benchmark(void)
+{
+	struct crypto_mac *ctx;
+	struct os_reltime start;
+	unsigned int oneshot, keyed;
+	u8 key[32], msg[BENCH_MSG_LEN], mac[SHA256_MAC_LEN];
+	int i, errors = 0;
+
+	os_memset(key, 0x11, sizeof(key));
+	os_memset(msg, 0x22, sizeof(msg));
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_BENCH; i++)
+		errors += hmac_sha256(key, sizeof(key), msg, sizeof(msg),
+				      mac) < 0;
+	oneshot = time_diff_usec(&start);
+	ctx = crypto_mac_init(CRYPTO_MAC_HMAC_SHA256, key, sizeof(key));
+	if (!ctx)
+		return errors + 1;
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_BENCH; i++)
+		errors += crypto_mac_update(ctx, msg, sizeof(msg)) < 0 ||
+			crypto_mac_final(ctx, mac) < 0;
+	keyed = time_diff_usec(&start);
+	crypto_mac_deinit(ctx);
+	printf("HMAC-SHA256 %d-octet messages: one-shot %u nsec/op, keyed context %u nsec/op\n",
+	       BENCH_MSG_LEN,
+	       (unsigned int) ((u64) oneshot * 1000 / NUM_BENCH),
+	       (unsigned int) ((u64) keyed * 1000 / NUM_BENCH));
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_BENCH; i++)
+		errors += omac1_aes_128(key, msg, sizeof(msg), mac) < 0;
+	oneshot = time_diff_usec(&start);
+	ctx = crypto_mac_init(CRYPTO_MAC_AES_CMAC, key, 16);
+	if (!ctx)
+		return errors + 1;
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_BENCH; i++)
+		errors += crypto_mac_update(ctx, msg, sizeof(msg)) < 0 ||
+			crypto_mac_final(ctx, mac) < 0;
+	keyed = time_diff_usec(&start);
+	crypto_mac_deinit(ctx);
+	printf("AES-CMAC %d-octet messages: one-shot %u nsec/op, keyed context %u nsec/op\n",
+	       BENCH_MSG_LEN,
+	       (unsigned int) ((u64) oneshot * 1000 / NUM_BENCH),
+	       (unsigned int) ((u64) keyed * 1000 / NUM_BENCH));
+
+	return errors;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int errors = 0;
+
+	if (os_program_init())
+		return -1;
+
+	errors += test_cmac();
+	errors += test_hmac();
+	if (!errors)
+		errors += benchmark();
+
+	if (errors)
+		printf("%d keyed MAC test(s) failed\n", errors);
+	else
+		printf("Keyed MAC tests completed successfully\n");
+
+	os_program_deinit();
+	return errors ? -1 : 0;
+}
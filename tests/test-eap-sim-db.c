@@ -0,0 +1,303 @@
+/*
+ * Test program for the EAP-SIM/AKA pseudonym and reauth database
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This runs simulated EAP-AKA logins through eap_sim_db: authentication
+ * vector request over the HLR/AuC gateway interface, new pseudonym and
+ * reauth_id, and then pseudonym and fast re-authentication lookups. By
+ * default, a local stand-in for hlr_auc_gw is used. A running hlr_auc_gw can
+ * be used instead with "-s <socket path>"; the IMSIs 232010000000000.. need to
+ * be configured in its Milenage file in that case.
+ */
+
+#include "utils/includes.h"
+#include <sys/un.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "eap_common/eap_sim_common.h"
+#include "eap_server/eap_sim_db.h"
+#include "test_util.h"
+
+#define NUM_LOGINS 3000
+#define IMSI_BASE "2320100000"
+
+struct login_test {
+	struct eap_sim_db_data *db;
+	int hlr; /* local hlr_auc_gw stand-in or -1 */
+	char hlr_path[100];
+	int cur;
+	char username[30];
+	char first_pseudonym[30];
+	char first_permanent[30];
+	struct os_reltime start;
+	unsigned int db_usec;
+	int errors;
+};
+
+
+static void hlr_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	char buf[200], reply[300], *imsi;
+	struct sockaddr_un from;
+	socklen_t fromlen = sizeof(from);
+	int len;
+
+	len = recvfrom(sock, buf, sizeof(buf) - 1, 0,
+		       (struct sockaddr *) &from, &fromlen);
+	if (len < 0)
+		return;
+	buf[len] = '\0';
+	if (os_strncmp(buf, "AKA-REQ-AUTH ", 13) != 0)
+		return;
+	imsi = buf + 13;
+
+	/* RAND AUTN IK CK RES */
+	len = os_snprintf(reply, sizeof(reply),
+			  "AKA-RESP-AUTH %s "
+			  "00112233445566778899aabbccddeeff "
+			  "00112233445566778899aabbccddeeff "
+			  "00112233445566778899aabbccddeeff "
+			  "00112233445566778899aabbccddeeff "
+			  "0011223344556677", imsi);
+	sendto(sock, reply, len, 0, (struct sockaddr *) &from, fromlen);
+}
+
+
+static int hlr_init(struct login_test *t)
+{
+	struct sockaddr_un addr;
+
+	os_snprintf(t->hlr_path, sizeof(t->hlr_path),
+		    "/tmp/test-eap-sim-db-hlr-%d", getpid());
+	t->hlr = socket(PF_UNIX, SOCK_DGRAM, 0);
+	if (t->hlr < 0)
+		return -1;
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	os_strlcpy(addr.sun_path, t->hlr_path, sizeof(addr.sun_path));
+	unlink(t->hlr_path);
+	if (bind(t->hlr, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+		return -1;
+	return eloop_register_read_sock(t->hlr, hlr_receive, t, NULL);
+}
+
+
+static void hlr_deinit(struct login_test *t)
+{
+	if (t->hlr < 0)
+		return;
+	eloop_unregister_read_sock(t->hlr);
+	close(t->hlr);
+	unlink(t->hlr_path);
+}
+
+
+static void start_login(struct login_test *t);
+
+
+/* Store the new identities and run the lookups of the following logins */
+static int finish_login(struct login_test *t)
+{
+	struct os_reltime start;
+	char *pseudonym, *reauth_id, pseudonym_str[30], reauth_str[30];
+	const char *permanent;
+	struct eap_sim_reauth *reauth;
+	u8 mk[EAP_SIM_MK_LEN];
+
+	os_memset(mk, t->cur & 0xff, sizeof(mk));
+	os_get_reltime(&start);
+
+	pseudonym = eap_sim_db_get_next_pseudonym(t->db, EAP_SIM_DB_AKA);
+	reauth_id = eap_sim_db_get_next_reauth_id(t->db, EAP_SIM_DB_AKA);
+	if (!pseudonym || !reauth_id) {
+		os_free(pseudonym);
+		os_free(reauth_id);
+		return -1;
+	}
+	os_strlcpy(pseudonym_str, pseudonym, sizeof(pseudonym_str));
+	os_strlcpy(reauth_str, reauth_id, sizeof(reauth_str));
+	if (eap_sim_db_add_pseudonym(t->db, t->username, pseudonym) < 0 ||
+	    eap_sim_db_add_reauth(t->db, t->username, reauth_id, t->cur,
+				  mk) < 0) {
+		printf("failed to add identities for %s\n", t->username);
+		return -1;
+	}
+
+	permanent = eap_sim_db_get_permanent(t->db, pseudonym_str);
+	if (!permanent || os_strcmp(permanent, t->username) != 0) {
+		printf("pseudonym lookup failed for %s\n", t->username);
+		t->errors++;
+	}
+
+	reauth = eap_sim_db_get_reauth_entry(t->db, reauth_str);
+	if (!reauth || !reauth->permanent ||
+	    os_strcmp(reauth->permanent, t->username) != 0 ||
+	    reauth->counter != t->cur ||
+	    os_memcmp(reauth->mk, mk, EAP_SIM_MK_LEN) != 0) {
+		printf("reauth lookup failed for %s\n", t->username);
+		t->errors++;
+	} else {
+		eap_sim_db_remove_reauth(t->db, reauth);
+		if (eap_sim_db_get_reauth_entry(t->db, reauth_str)) {
+			printf("reauth entry not removed for %s\n",
+			       t->username);
+			t->errors++;
+		}
+	}
+
+	t->db_usec += time_diff_usec(&start);
+
+	if (t->cur == 0) {
+		os_strlcpy(t->first_pseudonym, pseudonym_str,
+			   sizeof(t->first_pseudonym));
+		os_strlcpy(t->first_permanent, t->username,
+			   sizeof(t->first_permanent));
+	}
+
+	return 0;
+}
+
+
+static void login_step(struct login_test *t)
+{
+	u8 _rand[EAP_AKA_RAND_LEN], autn[EAP_AKA_AUTN_LEN];
+	u8 ik[EAP_AKA_IK_LEN], ck[EAP_AKA_CK_LEN], res[EAP_AKA_RES_MAX_LEN];
+	size_t res_len;
+	int ret;
+
+	ret = eap_sim_db_get_aka_auth(t->db, t->username, _rand, autn, ik, ck,
+				      res, &res_len, t);
+	if (ret == EAP_SIM_DB_PENDING)
+		return;
+	if (ret != 0 || finish_login(t) < 0) {
+		printf("login %d failed\n", t->cur);
+		t->errors++;
+		eloop_terminate();
+		return;
+	}
+
+	t->cur++;
+	if (t->cur == NUM_LOGINS)
+		eloop_terminate();
+	else
+		start_login(t);
+}
+
+
+static void start_login(struct login_test *t)
+{
+	os_snprintf(t->username, sizeof(t->username), "%c%s%05d",
+		    EAP_AKA_PERMANENT_PREFIX, IMSI_BASE, t->cur);
+	login_step(t);
+}
+
+
+static void get_complete_cb(void *ctx, void *session_ctx)
+{
+	login_step(session_ctx);
+}
+
+
+static void login_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct login_test *t = eloop_ctx;
+
+	printf("timeout after %d logins\n", t->cur);
+	t->errors++;
+	eloop_terminate();
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct login_test t;
+	char db_file[] = "/tmp/test-eap-sim-db.XXXXXX";
+	char conf[300], path[200];
+	const char *permanent;
+	unsigned int total;
+	int fd, ret = -1;
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+	if (eloop_init() < 0)
+		return -1;
+
+	os_memset(&t, 0, sizeof(t));
+	t.hlr = -1;
+
+	fd = mkstemp(db_file);
+	if (fd < 0)
+		return -1;
+	close(fd);
+
+	if (argc == 3 && os_strcmp(argv[1], "-s") == 0) {
+		os_strlcpy(path, argv[2], sizeof(path));
+	} else if (hlr_init(&t) < 0) {
+		printf("could not start hlr_auc_gw stand-in\n");
+		goto fail;
+	} else {
+		os_strlcpy(path, t.hlr_path, sizeof(path));
+	}
+
+	os_snprintf(conf, sizeof(conf), "unix:%s db=%s", path, db_file);
+	t.db = eap_sim_db_init(conf, 1, get_complete_cb, &t);
+	if (!t.db) {
+		printf("eap_sim_db_init failed\n");
+		goto fail;
+	}
+
+	eloop_register_timeout(60, 0, login_timeout, &t, NULL);
+	os_get_reltime(&t.start);
+	start_login(&t);
+	eloop_run();
+	total = time_diff_usec(&t.start);
+	eloop_cancel_timeout(login_timeout, &t, NULL);
+
+	if (t.cur != NUM_LOGINS)
+		goto fail;
+
+	printf("%d EAP-AKA logins: %u usec/login, %u usec/login in database operations\n",
+	       NUM_LOGINS, total / NUM_LOGINS, t.db_usec / NUM_LOGINS);
+
+	/* The oldest pseudonym has been evicted from the memory cache */
+	permanent = eap_sim_db_get_permanent(t.db, t.first_pseudonym);
+	if (!permanent || os_strcmp(permanent, t.first_permanent) != 0) {
+		printf("pseudonym lookup from the database failed\n");
+		t.errors++;
+	}
+
+	/* Pending writes are committed on deinit */
+	eap_sim_db_deinit(t.db);
+	t.db = eap_sim_db_init(conf, 1, get_complete_cb, &t);
+	permanent = t.db ? eap_sim_db_get_permanent(t.db, t.first_pseudonym) :
+		NULL;
+	if (!permanent || os_strcmp(permanent, t.first_permanent) != 0) {
+		printf("pseudonym not found after reopening the database\n");
+		t.errors++;
+	}
+
+	if (t.errors) {
+		printf("%d errors\n", t.errors);
+		goto fail;
+	}
+
+	printf("EAP-SIM DB tests completed successfully\n");
+	ret = 0;
+fail:
+	if (t.db)
+		eap_sim_db_deinit(t.db);
+	hlr_deinit(&t);
+	unlink(db_file);
+	os_snprintf(path, sizeof(path), "%s-wal", db_file);
+	unlink(path);
+	os_snprintf(path, sizeof(path), "%s-shm", db_file);
+	unlink(path);
+	eloop_destroy();
+	os_program_deinit();
+	return ret;
+}
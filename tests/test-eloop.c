@@ -0,0 +1,402 @@
+/*
+ * Test program for eloop timeouts, batched socket receive, and fork
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "test_util.h"
+
+#define NUM_PERF_TIMEOUTS 100000
+#define NUM_ORDER_TIMEOUTS 1000
+#define NUM_BATCH_MSGS 5
+
+struct order_test {
+	int registered;
+	int fired;
+	int errors;
+	int last;
+};
+
+static struct order_test order;
+
+
+static void perf_timeout(void *eloop_ctx, void *user_ctx)
+{
+}
+
+
+static void order_timeout(void *eloop_ctx, void *user_ctx)
+{
+	int val = (int) (intptr_t) user_ctx;
+
+	/*
+	 * Values were registered so that a timeout with a larger value never
+	 * expires before one with a smaller value and timeouts with equal
+	 * expiry time have to be processed in the order of registration.
+	 */
+	if (val < order.last) {
+		printf("order: timeout %d expired after %d\n", val, order.last);
+		order.errors++;
+	}
+	order.last = val;
+	if (++order.fired == order.registered)
+		eloop_terminate();
+}
+
+
+static int test_order(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_ORDER_TIMEOUTS; i++) {
+		/*
+		 * Register groups of ten timeouts sharing the same expiry time
+		 * with the groups in reverse order of expiry.
+		 */
+		int val = (NUM_ORDER_TIMEOUTS / 10 - 1 - i / 10) * 10 + i % 10;
+
+		if (eloop_register_timeout(0, (val / 10) * 100, order_timeout,
+					   NULL, (void *) (intptr_t) val) < 0)
+			return -1;
+		order.registered++;
+	}
+	/* Cancel every third timeout to exercise removal from the middle */
+	for (i = 0; i < NUM_ORDER_TIMEOUTS; i += 3) {
+		if (eloop_cancel_timeout(order_timeout, NULL,
+					 (void *) (intptr_t) i) != 1) {
+			printf("order: failed to cancel timeout %d\n", i);
+			return -1;
+		}
+		order.registered--;
+	}
+
+	eloop_run();
+
+	if (order.errors || order.fired != order.registered) {
+		printf("order: %d errors, %d/%d timeouts fired\n",
+		       order.errors, order.fired, order.registered);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int test_fifo(void)
+{
+	int i;
+
+	order.registered = order.fired = order.errors = 0;
+	order.last = 0;
+	for (i = 0; i < NUM_ORDER_TIMEOUTS; i++) {
+		if (eloop_register_timeout(0, 1000, order_timeout, NULL,
+					   (void *) (intptr_t) i) < 0)
+			return -1;
+		order.registered++;
+	}
+
+	eloop_run();
+
+	if (order.errors || order.fired != order.registered) {
+		printf("fifo: %d errors, %d/%d timeouts fired\n",
+		       order.errors, order.fired, order.registered);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int test_perf(void)
+{
+	struct os_reltime start;
+	unsigned int usec;
+	int *ctx, i, errors = 0;
+
+	ctx = os_calloc(NUM_PERF_TIMEOUTS, sizeof(int));
+	if (!ctx)
+		return -1;
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_PERF_TIMEOUTS; i++) {
+		/* Spread the expiry times to avoid trivial heap insertions */
+		if (eloop_register_timeout(1000 + (i * 7919) % 3600,
+					   ((unsigned int) i * 104729) % 1000000,
+					   perf_timeout, &ctx[i], NULL) < 0)
+			errors++;
+	}
+	usec = time_diff_usec(&start);
+	printf("register: %d timeouts in %u usec (%u nsec/op)\n",
+	       NUM_PERF_TIMEOUTS, usec,
+	       (unsigned int) ((u64) usec * 1000 / NUM_PERF_TIMEOUTS));
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_PERF_TIMEOUTS; i++) {
+		if (!eloop_is_timeout_registered(perf_timeout,
+						 &ctx[(i * 7) % NUM_PERF_TIMEOUTS],
+						 NULL))
+			errors++;
+	}
+	usec = time_diff_usec(&start);
+	printf("lookup: %d timeouts in %u usec (%u nsec/op)\n",
+	       NUM_PERF_TIMEOUTS, usec,
+	       (unsigned int) ((u64) usec * 1000 / NUM_PERF_TIMEOUTS));
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_PERF_TIMEOUTS; i++) {
+		/* 7 is coprime with the count, so this cancels each once */
+		if (eloop_cancel_timeout(perf_timeout,
+					 &ctx[(i * 7) % NUM_PERF_TIMEOUTS],
+					 NULL) != 1)
+			errors++;
+	}
+	usec = time_diff_usec(&start);
+	printf("cancel: %d timeouts in %u usec (%u nsec/op)\n",
+	       NUM_PERF_TIMEOUTS, usec,
+	       (unsigned int) ((u64) usec * 1000 / NUM_PERF_TIMEOUTS));
+
+	os_free(ctx);
+
+	if (errors) {
+		printf("perf: %d errors\n", errors);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+struct batch_test {
+	int calls;
+	int received;
+	int errors;
+};
+
+
+static void batch_receive(int sock, void *eloop_ctx, void *sock_ctx,
+			  struct eloop_datagram_batch *batch)
+{
+	struct batch_test *t = eloop_ctx;
+	size_t i;
+	char expected[20];
+
+	t->calls++;
+	for (i = 0; i < batch->num; i++) {
+		os_snprintf(expected, sizeof(expected), "msg-%d", t->received);
+		if (batch->msgs[i].len != os_strlen(expected) ||
+		    os_memcmp(batch->msgs[i].buf, expected,
+			      batch->msgs[i].len) != 0) {
+			printf("batch: unexpected datagram %d\n", t->received);
+			t->errors++;
+		}
+		t->received++;
+	}
+
+	if (t->received == NUM_BATCH_MSGS) {
+		/* Unregistering truncates the rest of the batch */
+		eloop_unregister_read_sock(sock);
+		if (batch->num != 0) {
+			printf("batch: not truncated on unregistration\n");
+			t->errors++;
+		}
+		eloop_terminate();
+	}
+}
+
+
+static int test_batch(void)
+{
+	struct batch_test t;
+	int s[2], i;
+	char buf[20];
+
+	os_memset(&t, 0, sizeof(t));
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, s) < 0) {
+		printf("batch: socketpair: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < NUM_BATCH_MSGS; i++) {
+		os_snprintf(buf, sizeof(buf), "msg-%d", i);
+		if (send(s[1], buf, os_strlen(buf), 0) < 0) {
+			printf("batch: send: %s\n", strerror(errno));
+			t.errors++;
+		}
+	}
+
+	if (eloop_register_read_sock_batch(s[0], 3, 100, batch_receive, &t,
+					   NULL) < 0) {
+		t.errors++;
+	} else {
+		eloop_run();
+	}
+
+	close(s[0]);
+	close(s[1]);
+
+	printf("batch: %d datagrams in %d handler calls\n",
+	       t.received, t.calls);
+	if (t.errors || t.received != NUM_BATCH_MSGS)
+		return -1;
+
+	return 0;
+}
+
+
+static void shared_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct batch_test *t = eloop_ctx;
+
+	printf("batch: unregistered reader called\n");
+	t->errors++;
+	eloop_unregister_read_sock(sock);
+	eloop_terminate();
+}
+
+
+static void shared_batch_receive(int sock, void *eloop_ctx, void *sock_ctx,
+				 struct eloop_datagram_batch *batch)
+{
+	struct batch_test *t = eloop_ctx;
+
+	t->calls++;
+	t->received += batch->num;
+	eloop_unregister_read_sock(sock);
+	eloop_terminate();
+}
+
+
+/* Unregistering a socket removes the batch context of that reader only */
+static int test_batch_shared(void)
+{
+	struct batch_test t;
+	int s[2];
+
+	os_memset(&t, 0, sizeof(t));
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, s) < 0) {
+		printf("batch: socketpair: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (eloop_register_read_sock(s[0], shared_receive, &t, NULL) < 0) {
+		t.errors++;
+	} else if (eloop_register_read_sock_batch(s[0], 3, 100,
+						  shared_batch_receive, &t,
+						  NULL) < 0) {
+		/* The same socket cannot be registered twice with epoll and
+		 * kqueue */
+		eloop_unregister_read_sock(s[0]);
+		t.received = 1;
+	} else {
+		/* Removes the reader that was registered first */
+		eloop_unregister_read_sock(s[0]);
+		if (send(s[1], "msg", 3, 0) < 0) {
+			printf("batch: send: %s\n", strerror(errno));
+			t.errors++;
+			eloop_unregister_read_sock(s[0]);
+		} else {
+			eloop_run();
+		}
+	}
+
+	close(s[0]);
+	close(s[1]);
+
+	if (t.errors || t.received != 1)
+		return -1;
+
+	return 0;
+}
+
+
+static void fork_parent_timeout(void *eloop_ctx, void *user_ctx)
+{
+	int *fired = eloop_ctx;
+
+	(*fired)++;
+	eloop_terminate();
+}
+
+
+static void fork_child_timeout(void *eloop_ctx, void *user_ctx)
+{
+	eloop_terminate();
+}
+
+
+static void fork_parent_sock(int sock, void *eloop_ctx, void *sock_ctx)
+{
+}
+
+
+static int test_fork(void)
+{
+	int fired = 0, status, sv[2];
+	pid_t pid;
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0 ||
+	    eloop_register_read_sock(sv[0], fork_parent_sock, NULL, NULL) < 0)
+		return -1;
+	eloop_register_timeout(0, 0, fork_parent_timeout, &fired, NULL);
+
+	pid = fork();
+	if (pid < 0) {
+		printf("fork: %s\n", strerror(errno));
+		return -1;
+	}
+	if (pid == 0) {
+		/* The timeout of the parent process must not be called */
+		if (eloop_fork_reinit() < 0)
+			exit(2);
+		/* The registered socket of the parent process is closed, but
+		 * the unregistered one is left alone */
+		if (fcntl(sv[0], F_GETFD) != -1 || errno != EBADF ||
+		    fcntl(sv[1], F_GETFD) == -1)
+			exit(3);
+		eloop_register_timeout(0, 1000, fork_child_timeout, NULL,
+				       NULL);
+		eloop_run();
+		eloop_destroy();
+		exit(fired ? 1 : 0);
+	}
+
+	eloop_run();
+	eloop_unregister_read_sock(sv[0]);
+	close(sv[0]);
+	close(sv[1]);
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != 0 || fired != 1) {
+		printf("fork: child status %d, parent timeout fired %d times\n",
+		       status, fired);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int ret = 0;
+
+	if (eloop_init() < 0)
+		return -1;
+
+	if (test_perf() < 0 || test_order() < 0 || test_fifo() < 0 ||
+	    test_batch() < 0 || test_batch_shared() < 0 || test_fork() < 0)
+		ret = -1;
+
+	eloop_destroy();
+
+	if (ret == 0)
+		printf("eloop tests completed successfully\n");
+	return ret;
+}
@@ -0,0 +1,473 @@
+/*
+ * Test program for the indexed PMKSA cache on the authenticator
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "common/defs.h"
+#include "common/wpa_common.h"
+#include "eapol_auth/eapol_auth_sm.h"
+#include "ap/hostapd.h"
+#include "ap/pmksa_cache_auth.h"
+#include "test_util.h"
+
+/* pmksa_cache_max_entries in pmksa_cache_auth.c */
+#define MAX_ENTRIES 1024
+#define NUM_LOOKUPS 100000
+
+const struct wpa_driver_ops *const wpa_drivers[] =
+{
+	NULL
+};
+
+static const u8 aa[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+static const u8 aa2[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x01 };
+static unsigned int freed;
+static os_time_t freed_expiration;
+
+
+static void report(const char *name, unsigned int num, unsigned int usec)
+{
+	printf("%s: %u lookups in %u usec (%u nsec/op)\n", name, num, usec,
+	       (unsigned int) ((u64) usec * 1000 / num));
+}
+
+
+static void free_cb(struct rsn_pmksa_cache_entry *entry, void *ctx)
+{
+	freed++;
+	freed_expiration = entry->expiration;
+}
+
+
+static void sta_addr(u8 *addr, int i)
+{
+	os_memcpy(addr, "\x02\x00\x00\x00\x00\x00", ETH_ALEN);
+	WPA_PUT_BE24(&addr[3], i);
+}
+
+
+static int session_timeout(int i)
+{
+	/* Expiration times that are not in the order of addition */
+	return 1000 + (i * 7919) % 50000;
+}
+
+
+static struct rsn_pmksa_cache_entry *
+add_entry(struct rsn_pmksa_cache *pmksa, int i)
+{
+	u8 pmk[PMK_LEN], spa[ETH_ALEN];
+
+	os_memset(pmk, 0, sizeof(pmk));
+	WPA_PUT_BE32(pmk, i);
+	sta_addr(spa, i);
+	return pmksa_cache_auth_add(pmksa, pmk, PMK_LEN, NULL, NULL, 0, aa,
+				    spa, session_timeout(i), NULL,
+				    WPA_KEY_MGMT_IEEE8021X);
+}
+
+
+/* Reference for the lookup cost without the indexes */
+static struct rsn_pmksa_cache_entry *
+array_get(struct rsn_pmksa_cache_entry **entries, int num, const u8 *spa)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (os_memcmp(entries[i]->spa, spa, ETH_ALEN) == 0)
+			return entries[i];
+	}
+	return NULL;
+}
+
+
+static os_time_t first_expiration(struct rsn_pmksa_cache_entry **entries,
+				  int num)
+{
+	struct rsn_pmksa_cache_entry *first = NULL;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (entries[i] &&
+		    (!first || entries[i]->expiration < first->expiration))
+			first = entries[i];
+	}
+	return first ? first->expiration : 0;
+}
+
+
+/* Entries with the same expiration time may be returned in any order */
+static int first_expiring_ok(struct rsn_pmksa_cache *pmksa,
+			     struct rsn_pmksa_cache_entry **entries, int num)
+{
+	struct rsn_pmksa_cache_entry *entry;
+
+	entry = pmksa_cache_auth_get(pmksa, NULL, NULL);
+	return (entry ? entry->expiration : 0) ==
+		first_expiration(entries, num);
+}
+
+
+static int check_lookups(struct rsn_pmksa_cache *pmksa,
+			 struct rsn_pmksa_cache_entry **entries, int num)
+{
+	u8 spa[ETH_ALEN], pmkid[PMKID_LEN];
+	int i, errors = 0;
+
+	for (i = 0; i < num; i++) {
+		sta_addr(spa, i);
+		if (pmksa_cache_auth_get(pmksa, spa, NULL) != entries[i] ||
+		    pmksa_cache_auth_get(pmksa, NULL, entries[i]->pmkid) !=
+		    entries[i] ||
+		    pmksa_cache_auth_get(pmksa, spa, entries[i]->pmkid) !=
+		    entries[i]) {
+			printf("lookup mismatch for entry %d\n", i);
+			errors++;
+		}
+
+		/* PMKID of another STA */
+		if (pmksa_cache_auth_get(pmksa, spa,
+					 entries[(i + 1) % num]->pmkid)) {
+			printf("unexpected match for entry %d\n", i);
+			errors++;
+		}
+
+		/* OKC: the STA uses the PMKID for another AP */
+		rsn_pmkid(entries[i]->pmk, entries[i]->pmk_len, aa2, spa, pmkid,
+			  entries[i]->akmp);
+		if (i % 10 == 0 &&
+		    pmksa_cache_get_okc(pmksa, aa2, spa, pmkid) != entries[i]) {
+			printf("OKC lookup failed for entry %d\n", i);
+			errors++;
+		}
+	}
+
+	sta_addr(spa, MAX_ENTRIES + 1);
+	if (pmksa_cache_auth_get(pmksa, spa, NULL)) {
+		printf("unexpected match for unknown STA\n");
+		errors++;
+	}
+
+	if (!first_expiring_ok(pmksa, entries, num)) {
+		printf("unexpected first expiring entry\n");
+		errors++;
+	}
+
+	return errors;
+}
+
+
+static int benchmark(struct rsn_pmksa_cache *pmksa,
+		     struct rsn_pmksa_cache_entry **entries, int num)
+{
+	struct os_reltime start;
+	u8 spa[ETH_ALEN], pmkid[PMKID_LEN];
+	int i, idx, found = 0;
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_LOOKUPS; i++) {
+		idx = (i * 7) % num;
+		if (pmksa_cache_auth_get(pmksa, NULL, entries[idx]->pmkid))
+			found++;
+	}
+	report("PMKID index", NUM_LOOKUPS, time_diff_usec(&start));
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_LOOKUPS; i++) {
+		sta_addr(spa, (i * 7) % num);
+		if (pmksa_cache_auth_get(pmksa, spa, NULL))
+			found++;
+	}
+	report("SPA index", NUM_LOOKUPS, time_diff_usec(&start));
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_LOOKUPS / 10; i++) {
+		sta_addr(spa, (i * 7) % num);
+		if (array_get(entries, num, spa))
+			found++;
+	}
+	report("SPA list search", NUM_LOOKUPS / 10, time_diff_usec(&start));
+
+	/* OKC lookup for a STA that has no match */
+	os_memset(pmkid, 0, sizeof(pmkid));
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_LOOKUPS / 10; i++) {
+		sta_addr(spa, (i * 7) % num);
+		if (pmksa_cache_get_okc(pmksa, aa2, spa, pmkid))
+			found++;
+	}
+	report("OKC", NUM_LOOKUPS / 10, time_diff_usec(&start));
+
+	if (found != 2 * NUM_LOOKUPS + NUM_LOOKUPS / 10) {
+		printf("unexpected number of matches in benchmark\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+/* Remove entries in a pseudo random order and verify the expiration order */
+static int check_removal(struct rsn_pmksa_cache *pmksa,
+			 struct rsn_pmksa_cache_entry **entries, int num)
+{
+	int i, idx, errors = 0;
+
+	for (i = 0; i < num; i++) {
+		idx = (i * 389) % num;
+		pmksa_cache_free_entry(pmksa, entries[idx]);
+		entries[idx] = NULL;
+		if (!first_expiring_ok(pmksa, entries, num)) {
+			printf("expiration order broken after removing %d\n",
+			       idx);
+			errors++;
+			break;
+		}
+	}
+
+	return errors;
+}
+
+
+#ifdef CONFIG_PMKSA_CACHE_FILE
+
+#define NUM_FILE_ENTRIES 100
+
+static const u8 file_key[32] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+};
+
+
+static struct rsn_pmksa_cache * open_file_cache(const char *fname,
+						const u8 *key)
+{
+	struct rsn_pmksa_cache *pmksa;
+
+	pmksa = pmksa_cache_auth_init(free_cb, NULL);
+	if (pmksa &&
+	    pmksa_cache_auth_set_file(pmksa, fname, key, sizeof(file_key)) < 0) {
+		pmksa_cache_auth_deinit(pmksa);
+		pmksa = NULL;
+	}
+	return pmksa;
+}
+
+
+static int count_entries(struct rsn_pmksa_cache *pmksa)
+{
+	u8 spa[ETH_ALEN];
+	int i, count = 0;
+
+	for (i = 0; i < NUM_FILE_ENTRIES; i++) {
+		sta_addr(spa, i);
+		if (pmksa_cache_auth_get(pmksa, spa, NULL))
+			count++;
+	}
+	return count;
+}
+
+
+static int check_file(void)
+{
+	struct rsn_pmksa_cache *pmksa;
+	struct rsn_pmksa_cache_entry *entry, *saved[NUM_FILE_ENTRIES];
+	u8 spa[ETH_ALEN], wrong_key[sizeof(file_key)];
+	char fname[] = "/tmp/test-pmksa-cache.XXXXXX";
+	int fd, i, errors = 0;
+
+	fd = mkstemp(fname);
+	if (fd < 0)
+		return 1;
+	close(fd);
+	unlink(fname);
+
+	pmksa = open_file_cache(fname, file_key);
+	if (!pmksa)
+		return 1;
+	for (i = 0; i < NUM_FILE_ENTRIES; i++) {
+		u8 pmk[PMK_LEN];
+
+		os_memset(pmk, 0, sizeof(pmk));
+		WPA_PUT_BE32(pmk, i);
+		sta_addr(spa, i);
+		entry = pmksa_cache_auth_create_entry(pmk, PMK_LEN, NULL, NULL,
+						      0, aa, spa,
+						      session_timeout(i), NULL,
+						      WPA_KEY_MGMT_IEEE8021X);
+		if (entry && i % 2 == 0) {
+			entry->identity = (u8 *) os_strdup("user@example.com");
+			entry->identity_len = os_strlen("user@example.com");
+		}
+		if (pmksa_cache_auth_add_entry(pmksa, entry) < 0) {
+			errors++;
+			break;
+		}
+	}
+	/* Entries that are removed are removed from the file as well */
+	for (i = 0; i < NUM_FILE_ENTRIES; i += 10) {
+		sta_addr(spa, i);
+		entry = pmksa_cache_auth_get(pmksa, spa, NULL);
+		if (entry)
+			pmksa_cache_free_entry(pmksa, entry);
+	}
+
+	/* Keep copies of the entries for comparison after reload */
+	for (i = 0; i < NUM_FILE_ENTRIES; i++) {
+		sta_addr(spa, i);
+		entry = pmksa_cache_auth_get(pmksa, spa, NULL);
+		saved[i] = entry ? os_memdup(entry, sizeof(*entry)) : NULL;
+	}
+	pmksa_cache_auth_deinit(pmksa);
+
+	pmksa = open_file_cache(fname, file_key);
+	if (!pmksa) {
+		errors++;
+		goto out;
+	}
+	for (i = 0; i < NUM_FILE_ENTRIES; i++) {
+		sta_addr(spa, i);
+		entry = pmksa_cache_auth_get(pmksa, spa, NULL);
+		if (!saved[i] != !entry ||
+		    (entry &&
+		     (entry->pmk_len != saved[i]->pmk_len ||
+		      os_memcmp(entry->pmk, saved[i]->pmk,
+				entry->pmk_len) != 0 ||
+		      os_memcmp(entry->pmkid, saved[i]->pmkid,
+				PMKID_LEN) != 0 ||
+		      entry->akmp != saved[i]->akmp ||
+		      entry->expiration < saved[i]->expiration - 1 ||
+		      entry->expiration > saved[i]->expiration + 1 ||
+		      !entry->identity != (i % 2 != 0)))) {
+			printf("PMKSA cache file entry %d mismatch\n", i);
+			errors++;
+		}
+	}
+	pmksa_cache_auth_deinit(pmksa);
+
+	/* Entries cannot be decrypted with another key */
+	os_memcpy(wrong_key, file_key, sizeof(file_key));
+	wrong_key[0] ^= 0x01;
+	pmksa = open_file_cache(fname, wrong_key);
+	if (!pmksa || count_entries(pmksa) != 0) {
+		printf("PMKSA cache file entries loaded with a wrong key\n");
+		errors++;
+	}
+	pmksa_cache_auth_deinit(pmksa);
+
+	/* The invalid entries were dropped from the file */
+	pmksa = open_file_cache(fname, file_key);
+	if (!pmksa || count_entries(pmksa) != 0) {
+		printf("invalid PMKSA cache file entries not removed\n");
+		errors++;
+	}
+	pmksa_cache_auth_deinit(pmksa);
+
+out:
+	for (i = 0; i < NUM_FILE_ENTRIES; i++)
+		os_free(saved[i]);
+	unlink(fname);
+	if (!errors)
+		printf("PMKSA cache file: %d entries reloaded\n",
+		       NUM_FILE_ENTRIES - NUM_FILE_ENTRIES / 10);
+	return errors;
+}
+
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
+
+int main(int argc, char *argv[])
+{
+	struct rsn_pmksa_cache *pmksa;
+	struct rsn_pmksa_cache_entry **entries, *entry;
+	os_time_t first;
+	struct os_reltime start;
+	unsigned int usec;
+	u8 spa[ETH_ALEN];
+	int i, errors = 0;
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+	if (eloop_init())
+		return -1;
+
+	pmksa = pmksa_cache_auth_init(free_cb, NULL);
+	entries = os_calloc(MAX_ENTRIES, sizeof(*entries));
+	if (!pmksa || !entries)
+		goto fail;
+
+	os_get_reltime(&start);
+	for (i = 0; i < MAX_ENTRIES; i++) {
+		entries[i] = add_entry(pmksa, i);
+		if (!entries[i])
+			goto fail;
+	}
+	usec = time_diff_usec(&start);
+	printf("add: %d entries in %u usec\n", MAX_ENTRIES, usec);
+
+	errors += check_lookups(pmksa, entries, MAX_ENTRIES);
+	errors += benchmark(pmksa, entries, MAX_ENTRIES);
+
+	/* A new entry for the same STA replaces the old one */
+	freed = 0;
+	entry = add_entry(pmksa, 5);
+	sta_addr(spa, 5);
+	if (!entry || freed != 1 ||
+	    pmksa_cache_auth_get(pmksa, spa, NULL) != entry) {
+		printf("replacing an entry failed\n");
+		errors++;
+	}
+	entries[5] = entry;
+
+	/* A full cache drops the entry that expires first */
+	first = first_expiration(entries, MAX_ENTRIES);
+	freed = 0;
+	entry = add_entry(pmksa, MAX_ENTRIES);
+	if (!entry || freed != 1 || freed_expiration != first) {
+		printf("replacing the first expiring entry failed\n");
+		errors++;
+	}
+	for (i = 0; i < MAX_ENTRIES; i++) {
+		sta_addr(spa, i);
+		if (!pmksa_cache_auth_get(pmksa, spa, NULL))
+			entries[i] = entry;
+	}
+
+	errors += check_removal(pmksa, entries, MAX_ENTRIES);
+	if (pmksa_cache_auth_get(pmksa, NULL, NULL)) {
+		printf("cache not empty\n");
+		errors++;
+	}
+
+#ifdef CONFIG_PMKSA_CACHE_FILE
+	errors += check_file();
+#endif /* CONFIG_PMKSA_CACHE_FILE */
+
+	if (errors) {
+		printf("%d errors\n", errors);
+		goto fail;
+	}
+
+	os_free(entries);
+	pmksa_cache_auth_deinit(pmksa);
+	eloop_destroy();
+	os_program_deinit();
+	printf("PMKSA cache tests completed successfully\n");
+	return 0;
+
+fail:
+	os_free(entries);
+	pmksa_cache_auth_deinit(pmksa);
+	eloop_destroy();
+	os_program_deinit();
+	return -1;
+}
@@ -0,0 +1,201 @@
+/*
+ * Test program for matching candidate PSKs to EAPOL-Key msg 2/4 Key MIC
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/worker_pool.h"
+#include "common/defs.h"
+#include "common/eapol_common.h"
+#include "common/wpa_common.h"
+#include "test_util.h"
+
+#define NUM_THREADS 3
+#define KEY_DATA_LEN 22
+#define FRAME_LEN (sizeof(struct ieee802_1x_hdr) + \
+		   sizeof(struct wpa_eapol_key) + 16 + 2 + KEY_DATA_LEN)
+
+static const char *label = "Pairwise key expansion";
+static const u8 aa[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+static const u8 spa[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x02, 0x00 };
+static u8 anonce[WPA_NONCE_LEN], snonce[WPA_NONCE_LEN];
+
+
+static int build_frame(u8 *frame, int akmp, int cipher, int ver,
+		       const u8 *pmk)
+{
+	struct wpa_eapol_key *key;
+	struct wpa_ptk ptk;
+	size_t i;
+
+	for (i = 0; i < FRAME_LEN; i++)
+		frame[i] = i;
+	key = (struct wpa_eapol_key *) (frame + sizeof(struct ieee802_1x_hdr));
+	WPA_PUT_BE16(key->key_info,
+		     WPA_KEY_INFO_KEY_TYPE | WPA_KEY_INFO_MIC | ver);
+	os_memcpy(key->key_nonce, snonce, WPA_NONCE_LEN);
+	os_memset(key + 1, 0, 16);
+
+	if (wpa_pmk_to_ptk(pmk, PMK_LEN, label, aa, spa, anonce, snonce, &ptk,
+			   akmp, cipher, NULL, 0) < 0 ||
+	    wpa_eapol_key_mic(ptk.kck, ptk.kck_len, akmp, ver, frame,
+			      FRAME_LEN, (u8 *) (key + 1)) < 0)
+		return -1;
+	return 0;
+}
+
+
+/* Candidate loop as it was done in the 4-way handshake before the batch */
+static int find_full_ptk(int akmp, int cipher, int ver, u8 *frame,
+			 const u8 * const *pmk, size_t num)
+{
+	struct wpa_eapol_key *key;
+	u8 mic[16], calc[16];
+	struct wpa_ptk ptk;
+	size_t i;
+	int res = -1;
+
+	key = (struct wpa_eapol_key *) (frame + sizeof(struct ieee802_1x_hdr));
+	for (i = 0; i < num; i++) {
+		if (wpa_pmk_to_ptk(pmk[i], PMK_LEN, label, aa, spa, anonce,
+				   snonce, &ptk, akmp, cipher, NULL, 0) < 0)
+			break;
+		os_memcpy(mic, key + 1, sizeof(mic));
+		os_memset(key + 1, 0, sizeof(mic));
+		if (wpa_eapol_key_mic(ptk.kck, ptk.kck_len, akmp, ver, frame,
+				      FRAME_LEN, calc) == 0 &&
+		    os_memcmp_const(mic, calc, sizeof(mic)) == 0)
+			res = i;
+		os_memcpy(key + 1, mic, sizeof(mic));
+		if (res >= 0)
+			break;
+	}
+
+	return res;
+}
+
+
+static int run_test(const char *name, int akmp, int cipher, int ver,
+		    struct worker_pool *pool, size_t num)
+{
+	u8 **pmk, frame[FRAME_LEN];
+	struct wpa_pmk_trial trial;
+	struct os_reltime start;
+	unsigned int usec_full, usec_batch, usec_pool;
+	int res_full, res_batch, res_pool, expected = num - 1;
+	size_t i;
+	int ret = -1;
+
+	pmk = os_calloc(num, sizeof(u8 *));
+	if (!pmk)
+		return -1;
+	for (i = 0; i < num; i++) {
+		pmk[i] = os_malloc(PMK_LEN);
+		if (!pmk[i])
+			goto fail;
+		os_memset(pmk[i], 0, PMK_LEN);
+		WPA_PUT_BE32(pmk[i], i);
+	}
+
+	/* Worst case: the STA used the last candidate */
+	if (build_frame(frame, akmp, cipher, ver, pmk[expected]) < 0)
+		goto fail;
+
+	os_get_reltime(&start);
+	res_full = find_full_ptk(akmp, cipher, ver, frame,
+				 (const u8 * const *) pmk, num);
+	usec_full = time_diff_usec(&start);
+
+	os_get_reltime(&start);
+	if (wpa_pmk_trial_init(&trial, label, aa, spa, anonce, snonce, akmp,
+			       cipher, PMK_LEN, frame, FRAME_LEN) < 0)
+		goto fail;
+	res_batch = wpa_pmk_trial_find(&trial, NULL, (const u8 * const *) pmk,
+				       num);
+	wpa_pmk_trial_deinit(&trial);
+	usec_batch = time_diff_usec(&start);
+
+	os_get_reltime(&start);
+	if (wpa_pmk_trial_init(&trial, label, aa, spa, anonce, snonce, akmp,
+			       cipher, PMK_LEN, frame, FRAME_LEN) < 0)
+		goto fail;
+	res_pool = wpa_pmk_trial_find(&trial, pool, (const u8 * const *) pmk,
+				      num);
+	wpa_pmk_trial_deinit(&trial);
+	usec_pool = time_diff_usec(&start);
+
+	printf("%s, %zu candidates: full PTK %u usec, batch %u usec, batch with %d threads %u usec\n",
+	       name, num, usec_full, usec_batch, NUM_THREADS + 1, usec_pool);
+
+	if (res_full != expected || res_batch != expected ||
+	    res_pool != expected) {
+		printf("%s: unexpected result full=%d batch=%d pool=%d (expected %d)\n",
+		       name, res_full, res_batch, res_pool, expected);
+		goto fail;
+	}
+
+	/* Only the first match is reported */
+	os_memcpy(pmk[num / 3], pmk[expected], PMK_LEN);
+	if (wpa_pmk_trial_init(&trial, label, aa, spa, anonce, snonce, akmp,
+			       cipher, PMK_LEN, frame, FRAME_LEN) < 0)
+		goto fail;
+	res_pool = wpa_pmk_trial_find(&trial, pool, (const u8 * const *) pmk,
+				      num);
+	wpa_pmk_trial_deinit(&trial);
+	if (res_pool != (int) (num / 3)) {
+		printf("%s: unexpected first match %d (expected %zu)\n",
+		       name, res_pool, num / 3);
+		goto fail;
+	}
+
+	ret = 0;
+fail:
+	for (i = 0; i < num; i++)
+		os_free(pmk[i]);
+	os_free(pmk);
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct worker_pool *pool;
+	int ret = -1;
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+
+	os_memset(anonce, 0x11, sizeof(anonce));
+	os_memset(snonce, 0x22, sizeof(snonce));
+
+	pool = worker_pool_init(NUM_THREADS);
+	if (!pool) {
+		printf("Failed to start worker threads\n");
+		goto fail;
+	}
+
+	if (run_test("WPA-PSK", WPA_KEY_MGMT_PSK, WPA_CIPHER_CCMP,
+		     WPA_KEY_INFO_TYPE_HMAC_SHA1_AES, pool, 1000) < 0 ||
+	    run_test("WPA-PSK", WPA_KEY_MGMT_PSK, WPA_CIPHER_CCMP,
+		     WPA_KEY_INFO_TYPE_HMAC_SHA1_AES, pool, 10000) < 0 ||
+	    run_test("WPA-PSK-SHA256", WPA_KEY_MGMT_PSK_SHA256,
+		     WPA_CIPHER_CCMP, WPA_KEY_INFO_TYPE_AES_128_CMAC, pool,
+		     1000) < 0 ||
+	    run_test("WPA-PSK-SHA256", WPA_KEY_MGMT_PSK_SHA256,
+		     WPA_CIPHER_CCMP, WPA_KEY_INFO_TYPE_AES_128_CMAC, pool,
+		     10000) < 0)
+		goto fail;
+
+	ret = 0;
+	printf("PSK trial tests completed successfully\n");
+fail:
+	worker_pool_deinit(pool);
+	os_program_deinit();
+	return ret;
+}
@@ -0,0 +1,964 @@
+/*
+ * Load test for RADIUS client with a large number of pending requests
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+#include <dirent.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "radius/radius.h"
+#include "radius/radius_client.h"
+#include "eap_server/eap.h"
+#include "radius/radius_server.h"
+#ifdef CONFIG_RADIUS_TLS
+#include "crypto/tls.h"
+#include "radius/radius_tls.h"
+#endif /* CONFIG_RADIUS_TLS */
+#include "test_util.h"
+
+#define MAX_REQUESTS 4096
+#define MAX_SERVERS 4
+#define SEND_CHUNK 128
+
+static const char *secret = "radius load test";
+
+struct server_req {
+	struct radius_msg *msg;
+	struct sockaddr_in from;
+};
+
+/*
+ * Local RADIUS server stand-in. Requests are either replied to immediately or
+ * held until they are released with server_release().
+ */
+struct load_server {
+	int s;
+	int id;
+	int challenge;
+	int hold;
+	struct server_req *reqs;
+	unsigned int num;
+	unsigned int received;
+	unsigned int replied;
+	u16 ports[MAX_REQUESTS];
+	unsigned int num_ports;
+	int errors;
+};
+
+struct load_test {
+	struct radius_client_data *radius;
+	struct load_server srv[MAX_SERVERS];
+	unsigned int num_servers;
+	unsigned int num;
+	unsigned int sent;
+	unsigned int chunk;
+	unsigned int accepted;
+	unsigned int challenges;
+	const char *password;
+	const char *password_secret;
+	int errors;
+};
+
+
+static unsigned int count_open_fds(void)
+{
+	DIR *dir;
+	unsigned int num = 0;
+
+	dir = opendir("/proc/self/fd");
+	if (!dir)
+		return 0;
+	while (readdir(dir))
+		num++;
+	closedir(dir);
+	return num;
+}
+
+
+static void wait_done(void *eloop_ctx, void *user_ctx)
+{
+	eloop_terminate();
+}
+
+
+static int get_index(struct radius_msg *msg, unsigned int num)
+{
+	u8 *pos;
+	size_t len;
+	char buf[20];
+	int idx;
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_USER_NAME, &pos, &len,
+				    NULL) < 0 ||
+	    len < 5 || len >= sizeof(buf) || os_memcmp(pos, "user-", 5) != 0)
+		return -1;
+	os_memcpy(buf, pos + 5, len - 5);
+	buf[len - 5] = '\0';
+	idx = atoi(buf);
+	if (idx < 0 || (unsigned int) idx >= num)
+		return -1;
+	return idx;
+}
+
+
+static int send_request(struct load_test *lt, unsigned int idx,
+			const u8 *state, size_t state_len)
+{
+	struct radius_msg *msg;
+	char name[20];
+
+	os_snprintf(name, sizeof(name), "user-%u", idx);
+	msg = radius_msg_new(RADIUS_CODE_ACCESS_REQUEST,
+			     radius_client_get_id(lt->radius));
+	if (!msg || radius_msg_make_authenticator(msg) < 0 ||
+	    !radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME,
+				 (u8 *) name, os_strlen(name)) ||
+	    (state && !radius_msg_add_attr(msg, RADIUS_ATTR_STATE, state,
+					   state_len)) ||
+	    (lt->password &&
+	     !radius_msg_add_attr_user_password(
+		     msg, (const u8 *) lt->password, os_strlen(lt->password),
+		     (const u8 *) lt->password_secret,
+		     os_strlen(lt->password_secret))) ||
+	    radius_client_send(lt->radius, msg, RADIUS_AUTH, NULL) < 0) {
+		printf("Failed to send Access-Request\n");
+		radius_msg_free(msg);
+		return -1;
+	}
+	return 0;
+}
+
+
+static void server_send_reply(struct load_server *srv, struct radius_msg *req,
+			      const struct sockaddr_in *from)
+{
+	struct radius_msg *resp;
+	struct radius_hdr *hdr = radius_msg_get_hdr(req);
+	u8 *pos, *state;
+	size_t len, state_len;
+	char buf[30];
+	u8 code = RADIUS_CODE_ACCESS_ACCEPT;
+
+	if (radius_msg_get_attr_ptr(req, RADIUS_ATTR_STATE, &state, &state_len,
+				    NULL) == 0) {
+		/* The State attribute identifies the server that sent the
+		 * Access-Challenge */
+		os_snprintf(buf, sizeof(buf), "server-%d-", srv->id);
+		if (state_len < os_strlen(buf) ||
+		    os_memcmp(state, buf, os_strlen(buf)) != 0) {
+			printf("Server %d received State from another server\n",
+			       srv->id);
+			srv->errors++;
+		}
+	} else if (srv->challenge) {
+		code = RADIUS_CODE_ACCESS_CHALLENGE;
+	}
+
+	resp = radius_msg_new(code, hdr->identifier);
+	if (!resp ||
+	    radius_msg_get_attr_ptr(req, RADIUS_ATTR_USER_NAME, &pos, &len,
+				    NULL) < 0 ||
+	    !radius_msg_add_attr(resp, RADIUS_ATTR_USER_NAME, pos, len))
+		goto fail;
+	if (code == RADIUS_CODE_ACCESS_CHALLENGE) {
+		os_snprintf(buf, sizeof(buf), "server-%d-%u", srv->id,
+			    srv->received);
+		if (!radius_msg_add_attr(resp, RADIUS_ATTR_STATE, (u8 *) buf,
+					 os_strlen(buf)))
+			goto fail;
+	}
+	if (radius_msg_finish_srv(resp, (const u8 *) secret, os_strlen(secret),
+				  hdr->authenticator) < 0 ||
+	    sendto(srv->s, wpabuf_head(radius_msg_get_buf(resp)),
+		   wpabuf_len(radius_msg_get_buf(resp)), 0,
+		   (const struct sockaddr *) from, sizeof(*from)) < 0)
+		goto fail;
+	radius_msg_free(resp);
+	return;
+
+fail:
+	printf("Failed to send response\n");
+	srv->errors++;
+	radius_msg_free(resp);
+}
+
+
+static void server_reply(void *eloop_ctx, void *user_ctx)
+{
+	struct load_server *srv = eloop_ctx;
+	struct server_req *req;
+	unsigned int i;
+
+	/* Reply in reverse order to make sure responses are not matched
+	 * based on the order of the requests. */
+	for (i = 0; i < SEND_CHUNK && srv->replied < srv->num; i++) {
+		req = &srv->reqs[srv->num - 1 - srv->replied++];
+		if (req->msg)
+			server_send_reply(srv, req->msg, &req->from);
+	}
+
+	if (srv->replied < srv->num)
+		eloop_register_timeout(0, 0, server_reply, srv, NULL);
+}
+
+
+static void server_release(struct load_server *srv)
+{
+	srv->hold = 0;
+	eloop_register_timeout(0, 0, server_reply, srv, NULL);
+}
+
+
+static void server_receive_msg(struct load_server *srv, const u8 *buf,
+			       size_t len, const struct sockaddr_in *from)
+{
+	struct radius_msg *msg;
+	int idx;
+	unsigned int i;
+
+	msg = radius_msg_parse(buf, len);
+	idx = msg ? get_index(msg, srv->num) : -1;
+	if (idx < 0 ||
+	    radius_msg_verify_msg_auth(msg, (const u8 *) secret,
+				       os_strlen(secret), NULL)) {
+		printf("Invalid request received\n");
+		radius_msg_free(msg);
+		srv->errors++;
+		return;
+	}
+
+	for (i = 0; i < srv->num_ports; i++) {
+		if (srv->ports[i] == from->sin_port)
+			break;
+	}
+	if (i == srv->num_ports && srv->num_ports < MAX_REQUESTS)
+		srv->ports[srv->num_ports++] = from->sin_port;
+
+	if (!srv->hold) {
+		srv->received++;
+		server_send_reply(srv, msg, from);
+		radius_msg_free(msg);
+		return;
+	}
+
+	if (srv->reqs[idx].msg) {
+		/* Retransmission */
+		radius_msg_free(msg);
+		return;
+	}
+	srv->reqs[idx].msg = msg;
+	srv->reqs[idx].from = *from;
+	srv->received++;
+}
+
+
+static void server_receive(int sock, void *eloop_ctx, void *sock_ctx,
+			   struct eloop_datagram_batch *batch)
+{
+	struct load_server *srv = eloop_ctx;
+	size_t i;
+
+	for (i = 0; i < batch->num; i++) {
+		if (batch->msgs[i].fromlen != sizeof(struct sockaddr_in))
+			continue;
+		server_receive_msg(srv, batch->msgs[i].buf, batch->msgs[i].len,
+				   batch->msgs[i].from);
+	}
+}
+
+
+static int server_init(struct load_server *srv, int id, unsigned int num,
+		       struct hostapd_radius_server *serv)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	srv->s = -1;
+	srv->id = id;
+	srv->num = num;
+	srv->reqs = os_calloc(num, sizeof(struct server_req));
+	if (!srv->reqs)
+		return -1;
+
+	srv->s = socket(PF_INET, SOCK_DGRAM, 0);
+	if (srv->s < 0)
+		return -1;
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(srv->s, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(srv->s, (struct sockaddr *) &addr, &addrlen) < 0 ||
+	    eloop_register_read_sock_batch(srv->s, 2 * SEND_CHUNK, 1000,
+					   server_receive, srv, NULL) < 0) {
+		printf("Failed to initialize RADIUS server socket: %s\n",
+		       strerror(errno));
+		close(srv->s);
+		srv->s = -1;
+		return -1;
+	}
+
+	serv->addr.af = AF_INET;
+	serv->addr.u.v4.s_addr = htonl(INADDR_LOOPBACK);
+	serv->port = ntohs(addr.sin_port);
+	serv->shared_secret = (u8 *) secret;
+	serv->shared_secret_len = os_strlen(secret);
+
+	return 0;
+}
+
+
+static void server_deinit(struct load_server *srv)
+{
+	unsigned int i;
+
+	eloop_cancel_timeout(server_reply, srv, NULL);
+	if (srv->s >= 0) {
+		eloop_unregister_read_sock(srv->s);
+		close(srv->s);
+	}
+	for (i = 0; srv->reqs && i < srv->num; i++)
+		radius_msg_free(srv->reqs[i].msg);
+	os_free(srv->reqs);
+}
+
+
+static RadiusRxResult client_receive(struct radius_msg *msg,
+				     struct radius_msg *req,
+				     const u8 *shared_secret,
+				     size_t shared_secret_len, void *data)
+{
+	struct load_test *lt = data;
+	struct radius_hdr *hdr = radius_msg_get_hdr(msg);
+	u8 *state;
+	size_t state_len;
+	int idx;
+
+	/* The integrated RADIUS server does not include User-Name in MAC ACL
+	 * replies, so the index is taken from the request in that case. */
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_USER_NAME, &state,
+				    &state_len, NULL) < 0)
+		idx = get_index(req, lt->num);
+	else
+		idx = get_index(msg, lt->num);
+	if (radius_msg_verify(msg, shared_secret, shared_secret_len, req, 1)) {
+		printf("Response authenticator did not match\n");
+		lt->errors++;
+		return RADIUS_RX_INVALID_AUTHENTICATOR;
+	}
+
+	if ((hdr->code != RADIUS_CODE_ACCESS_ACCEPT &&
+	     hdr->code != RADIUS_CODE_ACCESS_CHALLENGE) ||
+	    idx < 0 || idx != get_index(req, lt->num)) {
+		printf("Response did not match the request\n");
+		lt->errors++;
+	} else if (hdr->code == RADIUS_CODE_ACCESS_CHALLENGE) {
+		/* Continue the session like an EAP authenticator would */
+		lt->challenges++;
+		if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_STATE, &state,
+					    &state_len, NULL) < 0 ||
+		    send_request(lt, idx, state, state_len) < 0)
+			lt->errors++;
+	} else {
+		lt->accepted++;
+	}
+
+	if (lt->accepted + lt->errors >= lt->num)
+		eloop_terminate();
+
+	return RADIUS_RX_PROCESSED;
+}
+
+
+static void client_send(void *eloop_ctx, void *user_ctx)
+{
+	struct load_test *lt = eloop_ctx;
+	unsigned int i;
+
+	/* Let the server stand-ins read the requests between the bursts so that
+	 * the socket receive buffers do not overflow. */
+	for (i = 0; i < lt->chunk && lt->sent < lt->num; i++) {
+		if (send_request(lt, lt->sent++, NULL, 0) < 0) {
+			lt->errors++;
+			eloop_terminate();
+			return;
+		}
+	}
+
+	if (lt->sent < lt->num) {
+		eloop_register_timeout(0, 0, client_send, lt, NULL);
+		return;
+	}
+
+	for (i = 0; i < lt->num_servers; i++) {
+		if (lt->srv[i].hold)
+			server_release(&lt->srv[i]);
+	}
+}
+
+
+static void load_test_timeout(void *eloop_ctx, void *user_ctx)
+{
+	struct load_test *lt = eloop_ctx;
+
+	printf("Timeout: %u/%u requests sent, %u responses accepted\n",
+	       lt->sent, lt->num, lt->accepted);
+	lt->errors++;
+	eloop_terminate();
+}
+
+
+static void load_test_deinit(struct load_test *lt)
+{
+	unsigned int i;
+
+	radius_client_deinit(lt->radius);
+	lt->radius = NULL;
+	for (i = 0; i < lt->num_servers; i++)
+		server_deinit(&lt->srv[i]);
+}
+
+
+static int load_test_init(struct load_test *lt,
+			  struct hostapd_radius_servers *conf,
+			  struct hostapd_radius_server *servers,
+			  unsigned int num_servers, unsigned int num, int policy)
+{
+	unsigned int i;
+
+	os_memset(lt, 0, sizeof(*lt));
+	os_memset(conf, 0, sizeof(*conf));
+	lt->num = num;
+	lt->chunk = SEND_CHUNK;
+
+	for (i = 0; i < num_servers; i++) {
+		lt->num_servers++;
+		if (server_init(&lt->srv[i], i, num, &servers[i]) < 0)
+			return -1;
+	}
+
+	conf->auth_servers = conf->auth_server = servers;
+	conf->num_auth_servers = num_servers;
+	conf->auth_server_policy = policy;
+
+	lt->radius = radius_client_init(NULL, conf);
+	if (!lt->radius ||
+	    radius_client_register(lt->radius, RADIUS_AUTH, client_receive,
+				   lt) < 0)
+		return -1;
+
+	return 0;
+}
+
+
+static unsigned int load_test_run(struct load_test *lt)
+{
+	struct os_reltime start;
+	unsigned int usec, i;
+
+	os_get_reltime(&start);
+	eloop_register_timeout(0, 0, client_send, lt, NULL);
+	eloop_register_timeout(30, 0, load_test_timeout, lt, NULL);
+	eloop_run();
+	usec = time_diff_usec(&start);
+	eloop_cancel_timeout(load_test_timeout, lt, NULL);
+	eloop_cancel_timeout(client_send, lt, NULL);
+
+	if (lt->accepted != lt->num)
+		lt->errors++;
+	for (i = 0; i < lt->num_servers; i++)
+		lt->errors += lt->srv[i].errors;
+
+	return usec;
+}
+
+
+static int run_pending_test(unsigned int num)
+{
+	struct load_test lt;
+	struct hostapd_radius_servers conf;
+	struct hostapd_radius_server serv;
+	unsigned int usec, fds;
+
+	os_memset(&serv, 0, sizeof(serv));
+	if (load_test_init(&lt, &conf, &serv, 1, num,
+			   RADIUS_AUTH_SERVER_FAILOVER) < 0) {
+		load_test_deinit(&lt);
+		return -1;
+	}
+
+	/* Hold all the requests in the server until the last one has been
+	 * sent to get the maximum number of pending requests */
+	lt.srv[0].hold = 1;
+	usec = load_test_run(&lt);
+
+	printf("%u Access-Requests in %u usec (%u requests/s) from %u source ports\n",
+	       num, usec,
+	       usec ? (unsigned int) ((u64) num * 1000000 / usec) : 0,
+	       lt.srv[0].num_ports);
+
+	if (lt.srv[0].num_ports < (num + 255) / 256) {
+		printf("Too few source ports (%u) for %u pending requests\n",
+		       lt.srv[0].num_ports, num);
+		lt.errors++;
+	}
+
+	/* Only the first socket is kept open once the additional ones have
+	 * been idle for a while */
+	fds = count_open_fds();
+	eloop_register_timeout(7, 0, wait_done, NULL, NULL);
+	eloop_run();
+	if (fds && count_open_fds() + lt.srv[0].num_ports - 1 != fds) {
+		printf("Idle sockets not closed: %u open fds before and %u after waiting\n",
+		       fds, count_open_fds());
+		lt.errors++;
+	}
+
+	load_test_deinit(&lt);
+	return lt.errors ? -1 : 0;
+}
+
+
+/* Compare per-server request counters from the MIB with the server side */
+static int check_mib(struct load_test *lt)
+{
+	char buf[4000], *pos;
+	unsigned int i, val;
+	const char *req = "radiusAuthClientAccessRequests=";
+	const char *pending = "radiusAuthClientPendingRequests=";
+	int errors = 0;
+
+	radius_client_get_mib(lt->radius, buf, sizeof(buf));
+	buf[sizeof(buf) - 1] = '\0';
+	pos = buf;
+	for (i = 0; i < lt->num_servers; i++) {
+		pos = os_strstr(pos, req);
+		if (!pos)
+			return -1;
+		pos += os_strlen(req);
+		val = atoi(pos);
+		if (val != lt->srv[i].received) {
+			printf("MIB: %u requests to server %u, but %u received\n",
+			       val, i, lt->srv[i].received);
+			errors++;
+		}
+		pos = os_strstr(pos, pending);
+		if (!pos)
+			return -1;
+		pos += os_strlen(pending);
+		if (atoi(pos) != 0) {
+			printf("MIB: %d pending requests for server %u\n",
+			       atoi(pos), i);
+			errors++;
+		}
+	}
+
+	return errors ? -1 : 0;
+}
+
+
+static int run_balance_test(const char *name, int policy, const int *weights,
+			    int slow, int challenge)
+{
+	struct load_test lt;
+	struct hostapd_radius_servers conf;
+	struct hostapd_radius_server servers[MAX_SERVERS];
+	unsigned int i, num = 400, total_weight = 0, expected;
+	int ret = -1;
+
+	os_memset(servers, 0, sizeof(servers));
+	if (load_test_init(&lt, &conf, servers, MAX_SERVERS, num, policy) < 0)
+		goto fail;
+
+	for (i = 0; i < MAX_SERVERS; i++) {
+		servers[i].weight = weights ? weights[i] : 1;
+		total_weight += servers[i].weight;
+		lt.srv[i].challenge = challenge;
+	}
+	if (slow) {
+		/* Server 0 does not reply before all the requests have been
+		 * sent, so it should not be selected after the first few. */
+		lt.srv[0].hold = 1;
+		lt.chunk = 1;
+	}
+
+	load_test_run(&lt);
+
+	printf("%s:", name);
+	for (i = 0; i < MAX_SERVERS; i++)
+		printf(" %u", lt.srv[i].received);
+	printf(" requests (%u challenges)\n", lt.challenges);
+
+	for (i = 0; !slow && !challenge && i < MAX_SERVERS; i++) {
+		expected = num * servers[i].weight / total_weight;
+		if (lt.srv[i].received + 1 < expected ||
+		    lt.srv[i].received > expected + 1) {
+			printf("Unexpected distribution for server %u (expected %u)\n",
+			       i, expected);
+			lt.errors++;
+		}
+	}
+	if (slow && lt.srv[0].received > num / 10) {
+		printf("Too many requests to the slow server\n");
+		lt.errors++;
+	}
+	if (challenge && lt.challenges != num) {
+		printf("Unexpected number of challenges\n");
+		lt.errors++;
+	}
+	if (check_mib(&lt) < 0)
+		lt.errors++;
+
+	if (!lt.errors)
+		ret = 0;
+fail:
+	load_test_deinit(&lt);
+	return ret;
+}
+
+
+static int run_balance_tests(void)
+{
+	static const int weights[MAX_SERVERS] = { 1, 2, 3, 4 };
+
+	if (run_balance_test("round-robin", RADIUS_AUTH_SERVER_ROUND_ROBIN,
+			     NULL, 0, 0) < 0 ||
+	    run_balance_test("weighted", RADIUS_AUTH_SERVER_WEIGHTED,
+			     weights, 0, 0) < 0 ||
+	    run_balance_test("least outstanding",
+			     RADIUS_AUTH_SERVER_LEAST_OUTSTANDING,
+			     NULL, 1, 0) < 0 ||
+	    run_balance_test("sticky sessions", RADIUS_AUTH_SERVER_ROUND_ROBIN,
+			     NULL, 0, 1) < 0) {
+		printf("RADIUS server load balancing test failed\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+#define MACACL_PASSWORD "macacl password"
+
+static int macacl_get_eap_user(void *ctx, const u8 *identity,
+			       size_t identity_len, int phase2,
+			       struct eap_user *user)
+{
+	/* Every user is a MAC ACL entry so that each Access-Request gets an
+	 * Access-Accept in a single round trip. */
+	user->macacl = 1;
+	user->password = (u8 *) os_strdup(MACACL_PASSWORD);
+	if (!user->password)
+		return -1;
+	user->password_len = os_strlen(MACACL_PASSWORD);
+	return 0;
+}
+
+
+static int get_free_port(int type)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	int s, port = -1;
+
+	s = socket(PF_INET, type, 0);
+	if (s < 0)
+		return -1;
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) == 0 &&
+	    getsockname(s, (struct sockaddr *) &addr, &addrlen) == 0)
+		port = ntohs(addr.sin_port);
+	close(s);
+	return port;
+}
+
+
+static int get_mib_value(const char *mib, const char *name)
+{
+	const char *pos;
+
+	pos = os_strstr(mib, name);
+	if (!pos || pos[os_strlen(name)] != '=')
+		return -1;
+	return atoi(pos + os_strlen(name) + 1);
+}
+
+
+/* MAC ACL Access-Requests to the integrated RADIUS server with a large client
+ * file. The correct shared secret is only in the most specific entry for the
+ * source address, which is the last line of the file, so this checks the
+ * longest prefix match. Every request creates a session in the server. */
+static int run_client_lookup_test(unsigned int num)
+{
+	struct load_test lt;
+	struct hostapd_radius_servers conf;
+	struct hostapd_radius_server serv;
+	struct radius_server_conf sconf;
+	struct radius_server_data *rs = NULL;
+	struct eap_config eap_cfg;
+	char client_file[] = "/tmp/test-radius-client-XXXXXX";
+	char *mib = NULL;
+	unsigned int usec, i;
+	int fd, port;
+	FILE *f;
+
+	os_memset(&lt, 0, sizeof(lt));
+	os_memset(&eap_cfg, 0, sizeof(eap_cfg));
+
+	fd = mkstemp(client_file);
+	f = fd < 0 ? NULL : fdopen(fd, "w");
+	if (!f) {
+		printf("Could not create RADIUS client file\n");
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	fprintf(f, "0.0.0.0/0 wrong secret\n127.0.0.0/8 wrong secret\n");
+	for (i = 0; i < 4000; i++)
+		fprintf(f, "10.%u.%u.0/24 secret-%u\n",
+			i / 256, i % 256, i);
+	fprintf(f, "127.0.0.1 %s\n", secret);
+	fclose(f);
+
+	port = get_free_port(SOCK_DGRAM);
+	os_memset(&sconf, 0, sizeof(sconf));
+	sconf.auth_port = port;
+	sconf.client_file = client_file;
+	sconf.get_eap_user = macacl_get_eap_user;
+	sconf.eap_cfg = &eap_cfg;
+	sconf.max_sessions = num;
+	rs = port < 0 ? NULL : radius_server_init(&sconf);
+	if (!rs) {
+		printf("Could not initialize RADIUS server\n");
+		lt.errors++;
+		goto done;
+	}
+
+	os_memset(&serv, 0, sizeof(serv));
+	serv.addr.af = AF_INET;
+	serv.addr.u.v4.s_addr = htonl(INADDR_LOOPBACK);
+	serv.port = port;
+	serv.shared_secret = (u8 *) secret;
+	serv.shared_secret_len = os_strlen(secret);
+	os_memset(&conf, 0, sizeof(conf));
+	conf.auth_servers = conf.auth_server = &serv;
+	conf.num_auth_servers = 1;
+
+	/* The server reads 16 datagrams per event loop iteration */
+	lt.num = num;
+	lt.chunk = 16;
+	lt.password = MACACL_PASSWORD;
+	lt.password_secret = secret;
+	lt.radius = radius_client_init(NULL, &conf);
+	if (!lt.radius ||
+	    radius_client_register(lt.radius, RADIUS_AUTH, client_receive,
+				   &lt) < 0) {
+		lt.errors++;
+		goto done;
+	}
+
+	usec = load_test_run(&lt);
+	printf("RADIUS server: %u Access-Requests with %u clients in %u usec (%u requests/s)\n",
+	       num, i + 4, usec,
+	       usec ? (unsigned int) ((u64) num * 1000000 / usec) : 0);
+
+	mib = os_malloc(10000);
+	if (!mib || radius_server_get_mib(rs, mib, 10000) <= 0) {
+		lt.errors++;
+		goto done;
+	}
+	printf("RADIUS server: client trie nodes=%d lookups=%d nodes visited=%d sessions=%d buckets=%d max chain=%d\n",
+	       get_mib_value(mib, "radiusServClientTrieNodes"),
+	       get_mib_value(mib, "radiusServClientLookups"),
+	       get_mib_value(mib, "radiusServClientLookupNodes"),
+	       get_mib_value(mib, "radiusServSessionHashEntries"),
+	       get_mib_value(mib, "radiusServSessionHashBuckets"),
+	       get_mib_value(mib, "radiusServSessionHashMaxChain"));
+	if (get_mib_value(mib, "radiusServClientLookups") < (int) num ||
+	    get_mib_value(mib, "radiusServSessionHashEntries") != (int) num) {
+		printf("Unexpected RADIUS server lookup statistics\n");
+		lt.errors++;
+	}
+
+done:
+	os_free(mib);
+	radius_client_deinit(lt.radius);
+	radius_server_deinit(rs);
+	unlink(client_file);
+	return lt.errors ? -1 : 0;
+}
+
+
+#ifdef CONFIG_RADIUS_TLS
+
+static struct radius_server_data *
+tls_server_init(struct radius_server_conf *sconf, struct eap_config *eap_cfg,
+		const char *client_file, int port)
+{
+	/* auth_port 0 binds the UDP socket to an ephemeral port */
+	os_memset(sconf, 0, sizeof(*sconf));
+	sconf->tls_port = port;
+	sconf->client_file = (char *) client_file;
+	sconf->get_eap_user = macacl_get_eap_user;
+	sconf->eap_cfg = eap_cfg;
+	return radius_server_init(sconf);
+}
+
+
+/* Access-Requests over RADIUS/TLS to the integrated RADIUS server. More than
+ * 256 requests use multiple TLS connections and the second round checks that
+ * the client reconnects after the server has closed the connections. With
+ * TLS v1.3, the client receives NewSessionTicket messages after the
+ * handshake. */
+static int run_tls_test(unsigned int num, unsigned int tls_flags,
+			const char *name)
+{
+	struct load_test lt;
+	struct hostapd_radius_servers conf;
+	struct hostapd_radius_server serv;
+	struct radius_server_conf sconf;
+	struct radius_server_data *rs = NULL;
+	struct eap_config eap_cfg;
+	struct tls_config tconf;
+	struct tls_connection_params params;
+	char client_file[] = "/tmp/test-radius-client-XXXXXX";
+	char line[50];
+	unsigned int usec, round;
+	int fd, port;
+
+	os_memset(&lt, 0, sizeof(lt));
+	os_memset(&eap_cfg, 0, sizeof(eap_cfg));
+
+	fd = mkstemp(client_file);
+	if (fd < 0) {
+		printf("Could not create RADIUS client file\n");
+		return -1;
+	}
+	os_snprintf(line, sizeof(line), "127.0.0.1/32 %s\n",
+		    RADIUS_TLS_SHARED_SECRET);
+	if (write(fd, line, os_strlen(line)) < 0)
+		lt.errors++;
+	close(fd);
+
+	os_memset(&tconf, 0, sizeof(tconf));
+	eap_cfg.ssl_ctx = tls_init(&tconf);
+	os_memset(&params, 0, sizeof(params));
+	params.ca_cert = "hwsim/auth_serv/ca.pem";
+	params.client_cert = "hwsim/auth_serv/server.pem";
+	params.private_key = "hwsim/auth_serv/server.key";
+	params.dh_file = "hwsim/auth_serv/dh.conf";
+	port = get_free_port(SOCK_STREAM);
+	if (!eap_cfg.ssl_ctx || tls_global_set_params(eap_cfg.ssl_ctx, &params) ||
+	    port < 0) {
+		printf("Could not initialize TLS server\n");
+		lt.errors++;
+		goto done;
+	}
+
+	rs = tls_server_init(&sconf, &eap_cfg, client_file, port);
+	if (!rs) {
+		printf("Could not initialize RADIUS/TLS server\n");
+		lt.errors++;
+		goto done;
+	}
+
+	/* Time checks are disabled since the test certificates may have
+	 * expired. */
+	os_memset(&serv, 0, sizeof(serv));
+	serv.addr.af = AF_INET;
+	serv.addr.u.v4.s_addr = htonl(INADDR_LOOPBACK);
+	serv.port = port;
+	serv.shared_secret = (u8 *) RADIUS_TLS_SHARED_SECRET;
+	serv.shared_secret_len = os_strlen(RADIUS_TLS_SHARED_SECRET);
+	serv.tls = 1;
+	serv.ca_cert = "hwsim/auth_serv/ca.pem";
+	serv.tls_flags = TLS_CONN_DISABLE_TIME_CHECKS | tls_flags;
+	os_memset(&conf, 0, sizeof(conf));
+	conf.auth_servers = conf.auth_server = &serv;
+	conf.num_auth_servers = 1;
+
+	lt.num = num;
+	lt.chunk = SEND_CHUNK;
+	lt.password = MACACL_PASSWORD;
+	lt.password_secret = RADIUS_TLS_SHARED_SECRET;
+	lt.radius = radius_client_init(NULL, &conf);
+	if (!lt.radius ||
+	    radius_client_register(lt.radius, RADIUS_AUTH, client_receive,
+				   &lt) < 0) {
+		lt.errors++;
+		goto done;
+	}
+
+	for (round = 0; round < 2 && !lt.errors; round++) {
+		if (round > 0) {
+			radius_server_deinit(rs);
+			rs = tls_server_init(&sconf, &eap_cfg, client_file,
+					     port);
+			if (!rs) {
+				printf("Could not restart RADIUS/TLS server\n");
+				lt.errors++;
+				break;
+			}
+		}
+
+		lt.sent = 0;
+		lt.accepted = 0;
+		usec = load_test_run(&lt);
+		printf("RADIUS/TLS (%s)%s: %u Access-Requests in %u usec (%u requests/s)\n",
+		       name, round ? " (reconnect)" : "", num, usec,
+		       usec ? (unsigned int) ((u64) num * 1000000 / usec) : 0);
+	}
+
+done:
+	radius_client_deinit(lt.radius);
+	radius_server_deinit(rs);
+	tls_deinit(eap_cfg.ssl_ctx);
+	unlink(client_file);
+	return lt.errors ? -1 : 0;
+}
+
+#endif /* CONFIG_RADIUS_TLS */
+
+
+int main(int argc, char *argv[])
+{
+	unsigned int num = 4000;
+	int ret = -1;
+
+	if (argc > 1)
+		num = atoi(argv[1]);
+	if (num == 0 || num > MAX_REQUESTS) {
+		printf("usage: test-radius-client [requests (1..%u)]\n",
+		       MAX_REQUESTS);
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+	if (eloop_init())
+		goto fail;
+
+	if (run_pending_test(num) < 0 || run_balance_tests() < 0 ||
+	    run_client_lookup_test(num) < 0)
+		goto fail;
+#ifdef CONFIG_RADIUS_TLS
+	if (run_tls_test(num < 512 ? num : 512, 0, "default") < 0 ||
+	    run_tls_test(num < 512 ? num : 512, TLS_CONN_DISABLE_TLSv1_3,
+			 "TLS v1.2") < 0)
+		goto fail;
+#endif /* CONFIG_RADIUS_TLS */
+
+	ret = 0;
+	printf("RADIUS client load tests completed successfully\n");
+fail:
+	eloop_destroy();
+	os_program_deinit();
+	return ret;
+}
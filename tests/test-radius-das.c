@@ -0,0 +1,261 @@
+/*
+ * Test program for batched RADIUS DAS request processing
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/ip_addr.h"
+#include "radius/radius.h"
+#include "radius/radius_das.h"
+
+#define NUM_REQS 48
+#define FIRST_PORT 13799
+#define NUM_PORTS 100
+
+static const u8 secret[] = "das test";
+
+struct das_test {
+	struct radius_das_data *das;
+	int s;
+	int in_batch;
+	size_t max_batch;
+	unsigned int batches;
+	unsigned int requests;
+	unsigned int replies;
+	int reply_seen[NUM_REQS];
+	int errors;
+};
+
+
+static void das_batch_start(void *ctx, size_t num)
+{
+	struct das_test *t = ctx;
+
+	if (t->in_batch) {
+		printf("nested batch_start\n");
+		t->errors++;
+	}
+	t->in_batch = 1;
+	t->batches++;
+	if (num > t->max_batch)
+		t->max_batch = num;
+}
+
+
+static void das_batch_end(void *ctx)
+{
+	struct das_test *t = ctx;
+
+	if (!t->in_batch) {
+		printf("batch_end without batch_start\n");
+		t->errors++;
+	}
+	t->in_batch = 0;
+}
+
+
+/* Sessions with an even index are found, the others are not */
+static enum radius_das_res das_disconnect(void *ctx,
+					  struct radius_das_attrs *attr)
+{
+	struct das_test *t = ctx;
+	char buf[20];
+	int i;
+
+	if (!t->in_batch) {
+		printf("request processed outside a batch\n");
+		t->errors++;
+	}
+	t->requests++;
+
+	if (!attr->acct_session_id || attr->acct_session_id_len != 16)
+		return RADIUS_DAS_SESSION_NOT_FOUND;
+	os_memcpy(buf, attr->acct_session_id, 16);
+	buf[16] = '\0';
+	i = atoi(buf);
+	return i % 2 ? RADIUS_DAS_SESSION_NOT_FOUND : RADIUS_DAS_SUCCESS;
+}
+
+
+static enum radius_das_res das_coa(void *ctx, struct radius_das_attrs *attr)
+{
+	return RADIUS_DAS_COA_FAILED;
+}
+
+
+static void das_receive_reply(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct das_test *t = eloop_ctx;
+	struct radius_msg *msg;
+	struct radius_hdr *hdr;
+	u8 buf[1500];
+	int len;
+	u8 expect;
+
+	len = recv(sock, buf, sizeof(buf), 0);
+	if (len < 0)
+		return;
+
+	msg = radius_msg_parse(buf, len);
+	if (!msg) {
+		printf("could not parse reply\n");
+		t->errors++;
+		return;
+	}
+	hdr = radius_msg_get_hdr(msg);
+	expect = hdr->identifier % 2 ? RADIUS_CODE_DISCONNECT_NAK :
+		RADIUS_CODE_DISCONNECT_ACK;
+	if (hdr->identifier >= NUM_REQS || t->reply_seen[hdr->identifier] ||
+	    hdr->code != expect) {
+		printf("unexpected reply %u (code %u)\n",
+		       hdr->identifier, hdr->code);
+		t->errors++;
+	} else {
+		t->reply_seen[hdr->identifier] = 1;
+	}
+	radius_msg_free(msg);
+
+	if (++t->replies == NUM_REQS)
+		eloop_terminate();
+}
+
+
+static void das_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct das_test *t = eloop_ctx;
+
+	printf("timeout - %u/%u replies received\n", t->replies, NUM_REQS);
+	t->errors++;
+	eloop_terminate();
+}
+
+
+static int send_requests(struct das_test *t)
+{
+	struct radius_msg *msg;
+	struct wpabuf *buf;
+	char id[20];
+	int i;
+
+	for (i = 0; i < NUM_REQS; i++) {
+		msg = radius_msg_new(RADIUS_CODE_DISCONNECT_REQUEST, i);
+		os_snprintf(id, sizeof(id), "%016d", i);
+		if (!msg ||
+		    !radius_msg_add_attr(msg, RADIUS_ATTR_ACCT_SESSION_ID,
+					 (u8 *) id, 16)) {
+			radius_msg_free(msg);
+			return -1;
+		}
+		radius_msg_finish_acct(msg, secret, sizeof(secret) - 1);
+		buf = radius_msg_get_buf(msg);
+		if (send(t->s, wpabuf_head(buf), wpabuf_len(buf), 0) < 0) {
+			perror("send");
+			radius_msg_free(msg);
+			return -1;
+		}
+		radius_msg_free(msg);
+	}
+
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct das_test t;
+	struct radius_das_conf conf;
+	struct hostapd_ip_addr client_addr;
+	struct sockaddr_in addr;
+	int port, ret = -1;
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+	if (eloop_init() < 0)
+		return -1;
+
+	os_memset(&t, 0, sizeof(t));
+	t.s = -1;
+
+	os_memset(&client_addr, 0, sizeof(client_addr));
+	client_addr.af = AF_INET;
+	client_addr.u.v4.s_addr = htonl(INADDR_LOOPBACK);
+
+	os_memset(&conf, 0, sizeof(conf));
+	conf.shared_secret = secret;
+	conf.shared_secret_len = sizeof(secret) - 1;
+	conf.client_addr = &client_addr;
+	conf.time_window = 300;
+	conf.ctx = &t;
+	conf.disconnect = das_disconnect;
+	conf.coa = das_coa;
+	conf.batch_start = das_batch_start;
+	conf.batch_end = das_batch_end;
+
+	for (port = FIRST_PORT; port < FIRST_PORT + NUM_PORTS; port++) {
+		conf.port = port;
+		t.das = radius_das_init(&conf);
+		if (t.das)
+			break;
+	}
+	if (!t.das) {
+		printf("could not initialize DAS\n");
+		goto fail;
+	}
+
+	t.s = socket(AF_INET, SOCK_DGRAM, 0);
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (t.s < 0 ||
+	    connect(t.s, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		perror("socket");
+		goto fail;
+	}
+
+	/*
+	 * All requests are queued on the DAS socket before the event loop is
+	 * started, so they are expected to be processed in batches.
+	 */
+	if (send_requests(&t) < 0 ||
+	    eloop_register_read_sock(t.s, das_receive_reply, &t, NULL) < 0 ||
+	    eloop_register_timeout(5, 0, das_timeout, &t, NULL) < 0)
+		goto fail;
+	eloop_run();
+	eloop_cancel_timeout(das_timeout, &t, NULL);
+	eloop_unregister_read_sock(t.s);
+
+	if (t.requests != NUM_REQS || t.replies != NUM_REQS) {
+		printf("%u requests processed, %u replies\n",
+		       t.requests, t.replies);
+		t.errors++;
+	}
+	if (t.max_batch < 2) {
+		printf("requests were not processed in batches\n");
+		t.errors++;
+	}
+
+	if (t.errors) {
+		printf("%d errors\n", t.errors);
+		goto fail;
+	}
+
+	printf("%u DAS requests processed in %u batches (largest %zu)\n",
+	       t.requests, t.batches, t.max_batch);
+	printf("RADIUS DAS tests completed successfully\n");
+	ret = 0;
+fail:
+	if (t.s >= 0)
+		close(t.s);
+	radius_das_deinit(t.das);
+	eloop_destroy();
+	os_program_deinit();
+	return ret;
+}
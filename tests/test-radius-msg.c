@@ -0,0 +1,419 @@
+/*
+ * Test program for RADIUS message attribute lookups
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "radius/radius.h"
+#include "test_util.h"
+
+#define NUM_ITERATIONS 20000
+#define NUM_ROUNDS 5
+#define NUM_CLASS 4
+#define NUM_AVPAIRS 40
+#define VENDOR_ID_CISCO 9
+
+static const u8 secret[] = "radius";
+static const u8 req_auth[16] = {
+	0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+	0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00
+};
+
+
+/*
+ * Build an Access-Accept with the attributes that a typical RADIUS server
+ * includes for an 802.1X/EAP authentication with dynamic VLAN assignment: EAP
+ * Success, Message-Authenticator, MS-MPPE keys, Class, CUI, session and
+ * interim accounting parameters, a set of tunnel attributes, and some
+ * attributes that hostapd does not use. num_avpairs Cisco-AVPair attributes
+ * are added before the EAP and key attributes to model a server policy with a
+ * large number of vendor-specific attributes.
+ */
+static struct wpabuf * build_accept(int num_avpairs)
+{
+	struct radius_msg *msg;
+	struct wpabuf *buf = NULL;
+	u8 eap[4] = { 3, 1, 0, 4 }; /* EAP-Success */
+	u8 key[32], cls[40], tunnel[4], reply[64], avpair[4 + 2 + 32];
+	int i, len;
+
+	msg = radius_msg_new(RADIUS_CODE_ACCESS_ACCEPT, 1);
+	if (!msg)
+		return NULL;
+	os_memset(key, 0x42, sizeof(key));
+	os_memset(reply, 'x', sizeof(reply));
+
+	if (!radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME,
+				 (u8 *) "user@example.com", 16) ||
+	    !radius_msg_add_attr(msg, RADIUS_ATTR_REPLY_MESSAGE, reply,
+				 sizeof(reply)) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_SERVICE_TYPE, 2) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_FRAMED_MTU, 1400) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_SESSION_TIMEOUT,
+				       3600) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_TERMINATION_ACTION,
+				       1) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_ACCT_INTERIM_INTERVAL,
+				       600))
+		goto fail;
+
+	for (i = 0; i < NUM_CLASS; i++) {
+		os_memset(cls, 'a' + i, sizeof(cls));
+		if (!radius_msg_add_attr(msg, RADIUS_ATTR_CLASS, cls,
+					 sizeof(cls)))
+			goto fail;
+	}
+
+	tunnel[0] = 1; /* tag */
+	WPA_PUT_BE24(&tunnel[1], RADIUS_TUNNEL_TYPE_VLAN);
+	if (!radius_msg_add_attr(msg, RADIUS_ATTR_TUNNEL_TYPE, tunnel, 4))
+		goto fail;
+	WPA_PUT_BE24(&tunnel[1], RADIUS_TUNNEL_MEDIUM_TYPE_802);
+	if (!radius_msg_add_attr(msg, RADIUS_ATTR_TUNNEL_MEDIUM_TYPE, tunnel,
+				 4) ||
+	    !radius_msg_add_attr(msg, RADIUS_ATTR_TUNNEL_PRIVATE_GROUP_ID,
+				 (u8 *) "\x01" "123", 4) ||
+	    !radius_msg_add_attr(msg, RADIUS_ATTR_CHARGEABLE_USER_IDENTITY,
+				 (u8 *) "cui-0123456789", 14))
+		goto fail;
+
+	for (i = 0; i < num_avpairs; i++) {
+		len = os_snprintf((char *) &avpair[6], sizeof(avpair) - 6,
+				  "ip:inacl#%d=permit ip any any", i);
+		WPA_PUT_BE32(avpair, VENDOR_ID_CISCO);
+		avpair[4] = 1; /* Cisco-AVPair */
+		avpair[5] = 2 + len;
+		if (!radius_msg_add_attr(msg, RADIUS_ATTR_VENDOR_SPECIFIC,
+					 avpair, 6 + len))
+			goto fail;
+	}
+
+	if (!radius_msg_add_attr(msg, RADIUS_ATTR_EAP_MESSAGE, eap,
+				 sizeof(eap)) ||
+	    !radius_msg_add_mppe_keys(msg, req_auth, secret,
+				      sizeof(secret) - 1, key, sizeof(key),
+				      key, sizeof(key)) ||
+	    radius_msg_finish_srv(msg, secret, sizeof(secret) - 1, req_auth))
+		goto fail;
+
+	buf = wpabuf_dup(radius_msg_get_buf(msg));
+fail:
+	radius_msg_free(msg);
+	return buf;
+}
+
+
+/* Attribute lookups done by hostapd when processing an Access-Accept */
+static int lookup_attrs(struct radius_msg *msg)
+{
+	struct wpabuf *eap;
+	u32 val;
+	u8 *buf, *pos;
+	size_t len;
+	int i, count, untagged, tagged[1], res = 0;
+
+	if (radius_msg_get_attr(msg, RADIUS_ATTR_EAP_MESSAGE, NULL, 0) < 0)
+		return -1;
+
+	eap = radius_msg_get_eap(msg);
+	if (!eap)
+		return -1;
+	wpabuf_free(eap);
+
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_SESSION_TIMEOUT,
+				      &val) == 0)
+		res++;
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_TERMINATION_ACTION,
+				      &val) == 0)
+		res++;
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_INTERIM_INTERVAL,
+				      &val) == 0)
+		res++;
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_WLAN_REASON_CODE,
+				      &val) == 0)
+		res++;
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_EAP_KEY_NAME, &buf, &len,
+				    NULL) == 0)
+		res++;
+
+	count = radius_msg_count_attr(msg, RADIUS_ATTR_CLASS, 1);
+	pos = NULL;
+	for (i = 0; i < count; i++) {
+		if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CLASS, &buf, &len,
+					    pos) < 0)
+			break;
+		pos = buf;
+		res++;
+	}
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_USER_NAME, &buf, &len,
+				    NULL) == 0)
+		res++;
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CHARGEABLE_USER_IDENTITY,
+				    &buf, &len, NULL) == 0)
+		res++;
+
+	pos = NULL;
+	while (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_VENDOR_SPECIFIC,
+				       &buf, &len, pos) == 0) {
+		pos = buf;
+		res++;
+	}
+
+	if (radius_msg_get_vlanid(msg, &untagged, 1, tagged) && untagged == 123)
+		res++;
+
+	return res;
+}
+
+
+/* Full Access-Accept processing including the cryptographic operations */
+static int process_accept(struct radius_msg *msg, struct radius_msg *req)
+{
+	struct radius_ms_mppe_keys *keys;
+	int res;
+
+	if (radius_msg_verify_msg_auth(msg, secret, sizeof(secret) - 1,
+				       req_auth))
+		return -1;
+
+	res = lookup_attrs(msg);
+	if (res < 0)
+		return -1;
+
+	keys = radius_msg_get_ms_keys(msg, req, secret, sizeof(secret) - 1);
+	if (keys && keys->send && keys->recv)
+		res++;
+	if (keys) {
+		bin_clear_free(keys->send, keys->send_len);
+		bin_clear_free(keys->recv, keys->recv_len);
+		os_free(keys);
+	}
+
+	return res;
+}
+
+
+static int check_lookups(const struct wpabuf *accept, int num_avpairs)
+{
+	struct radius_msg *msg, *req;
+	u8 *buf, *prev;
+	size_t len;
+	u32 val;
+	int i, res, errors = 0;
+
+	req = radius_msg_new(RADIUS_CODE_ACCESS_REQUEST, 1);
+	msg = radius_msg_parse(wpabuf_head(accept), wpabuf_len(accept));
+	if (!req || !msg) {
+		printf("Failed to parse Access-Accept\n");
+		radius_msg_free(req);
+		radius_msg_free(msg);
+		return 1;
+	}
+	os_memcpy(radius_msg_get_hdr(req)->authenticator, req_auth,
+		  sizeof(req_auth));
+
+	/* Session-Timeout, Termination-Action, Acct-Interim-Interval, MS-MPPE
+	 * keys, Class attributes, User-Name, CUI, VSAs, VLAN ID */
+	res = process_accept(msg, req);
+	if (res != 3 + 1 + NUM_CLASS + 2 + num_avpairs + 2 + 1) {
+		printf("Unexpected Access-Accept processing result %d\n", res);
+		errors++;
+	}
+
+	/* Multiple attributes of the same type are returned in order */
+	prev = NULL;
+	for (i = 0; i < NUM_CLASS; i++) {
+		if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CLASS, &buf, &len,
+					    prev) < 0 ||
+		    len != 40 || buf[0] != 'a' + i) {
+			printf("Class attribute %d not found\n", i);
+			errors++;
+			break;
+		}
+		prev = buf;
+	}
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CLASS, &buf, &len,
+				    prev) == 0) {
+		printf("Extra Class attribute found\n");
+		errors++;
+	}
+
+	/* Attributes added to a parsed message are found as well */
+	if (!radius_msg_add_attr(msg, RADIUS_ATTR_CLASS, (u8 *) "new", 3) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_WLAN_REASON_CODE, 7) ||
+	    radius_msg_count_attr(msg, RADIUS_ATTR_CLASS, 1) != NUM_CLASS + 1 ||
+	    radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CLASS, &buf, &len,
+				    prev) < 0 ||
+	    len != 3 ||
+	    radius_msg_get_attr_int32(msg, RADIUS_ATTR_WLAN_REASON_CODE,
+				      &val) < 0 || val != 7) {
+		printf("Added attributes not found\n");
+		errors++;
+	}
+
+	/* A new message grows past the default attribute array size */
+	radius_msg_free(msg);
+	msg = radius_msg_new(RADIUS_CODE_ACCOUNTING_REQUEST, 2);
+	if (!msg)
+		return errors + 1;
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+				      &val) == 0) {
+		printf("Attribute found in an empty message\n");
+		errors++;
+	}
+	for (i = 0; i < 5 * RADIUS_DEFAULT_ATTR_COUNT; i++) {
+		if (!radius_msg_add_attr_int32(msg, i % 2 ?
+					       RADIUS_ATTR_ACCT_DELAY_TIME :
+					       RADIUS_ATTR_CLASS, i))
+			break;
+	}
+	if (radius_msg_count_attr(msg, RADIUS_ATTR_CLASS, 4) !=
+	    5 * RADIUS_DEFAULT_ATTR_COUNT / 2 ||
+	    radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+				      &val) < 0 || val != 1) {
+		printf("Lookup from a new message failed\n");
+		errors++;
+	}
+
+	radius_msg_free(msg);
+	radius_msg_free(req);
+	return errors;
+}
+
+
+/* Average time in nanoseconds of parsing the message and then processing it
+ * with the specified function. The fastest of NUM_ROUNDS rounds is used to
+ * reduce the effect of other activity on the system. */
+static unsigned int bench_loop(const struct wpabuf *accept,
+			       struct radius_msg *req,
+			       int (*process)(struct radius_msg *msg,
+					      struct radius_msg *req),
+			       int *res)
+{
+	struct radius_msg *msg;
+	struct os_reltime start;
+	unsigned int usec, best = 0;
+	int i, round;
+
+	for (round = 0; round < NUM_ROUNDS; round++) {
+		os_get_reltime(&start);
+		for (i = 0; i < NUM_ITERATIONS; i++) {
+			msg = radius_msg_parse(wpabuf_head(accept),
+					       wpabuf_len(accept));
+			if (!msg) {
+				*res = -1;
+				return 0;
+			}
+			if (process && process(msg, req) < 0)
+				*res = -1;
+			radius_msg_free(msg);
+		}
+		usec = time_diff_usec(&start);
+		if (round == 0 || usec < best)
+			best = usec;
+	}
+	return (u64) best * 1000 / NUM_ITERATIONS;
+}
+
+
+static int lookup_only(struct radius_msg *msg, struct radius_msg *req)
+{
+	return lookup_attrs(msg);
+}
+
+
+static int benchmark(const struct wpabuf *accept)
+{
+	struct radius_msg *req;
+	unsigned int parse, lookup, total;
+	int res = 0;
+
+	req = radius_msg_new(RADIUS_CODE_ACCESS_REQUEST, 1);
+	if (!req)
+		return -1;
+	os_memcpy(radius_msg_get_hdr(req)->authenticator, req_auth,
+		  sizeof(req_auth));
+
+	parse = bench_loop(accept, req, NULL, &res);
+	lookup = bench_loop(accept, req, lookup_only, &res);
+	total = bench_loop(accept, req, process_accept, &res);
+	radius_msg_free(req);
+
+	printf("Access-Accept (%u octets): parse %u nsec, attribute lookups %u nsec, crypto %u nsec\n",
+	       (unsigned int) wpabuf_len(accept), parse,
+	       lookup > parse ? lookup - parse : 0,
+	       total > lookup ? total - lookup : 0);
+	return res;
+}
+
+
+/*
+ * Usage: test-radius-msg [Access-Accept file(s)]
+ *
+ * Each optional argument is a file with a raw RADIUS Access-Accept message,
+ * e.g., the UDP payload of a packet captured from a RADIUS server, to be
+ * benchmarked in addition to the built-in message.
+ */
+int main(int argc, char *argv[])
+{
+	struct wpabuf *accept;
+	char *data;
+	size_t len;
+	int i, errors = 0;
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+
+	accept = build_accept(0);
+	if (!accept) {
+		printf("Failed to build Access-Accept\n");
+		return -1;
+	}
+	errors += check_lookups(accept, 0);
+	if (benchmark(accept) < 0)
+		errors++;
+	wpabuf_free(accept);
+
+	/* Large enough for the attribute index to be used */
+	accept = build_accept(NUM_AVPAIRS);
+	if (!accept) {
+		printf("Failed to build Access-Accept\n");
+		return -1;
+	}
+	errors += check_lookups(accept, NUM_AVPAIRS);
+	if (benchmark(accept) < 0)
+		errors++;
+	wpabuf_free(accept);
+
+	for (i = 1; i < argc; i++) {
+		data = os_readfile(argv[i], &len);
+		if (!data) {
+			printf("Could not read %s\n", argv[i]);
+			errors++;
+			continue;
+		}
+		accept = wpabuf_alloc_copy(data, len);
+		os_free(data);
+		printf("%s: ", argv[i]);
+		if (!accept || benchmark(accept) < 0)
+			printf("parsing failed\n");
+		wpabuf_free(accept);
+	}
+
+	if (errors) {
+		printf("%d errors\n", errors);
+		return -1;
+	}
+
+	os_program_deinit();
+	printf("RADIUS message tests completed successfully\n");
+	return 0;
+}
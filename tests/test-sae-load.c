@@ -0,0 +1,320 @@
+/*
+ * Load test for SAE commit message processing in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/worker_pool.h"
+#include "common/ieee802_11_defs.h"
+#include "common/sae.h"
+#include "test_util.h"
+
+#define SAE_GROUP 19
+
+static const u8 ap_addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+static const char *password = "load test password";
+static int groups[] = { SAE_GROUP, 0 };
+
+struct load_test;
+
+struct sae_auth {
+	struct load_test *lt;
+	struct sae_data ap;
+	struct sae_data sta;
+	u8 sta_addr[ETH_ALEN];
+	struct wpabuf *sta_commit;
+	int res;
+};
+
+struct load_test {
+	struct sae_auth *auths;
+	unsigned int num;
+	unsigned int next;
+	unsigned int completed;
+	unsigned int max_in_flight;
+	struct worker_pool *pool;
+	int errors;
+};
+
+
+static void report(const char *name, unsigned int num, unsigned int usec)
+{
+	printf("%s: %u authentications in %u usec (%u authentications/s)\n",
+	       name, num, usec,
+	       usec ? (unsigned int) ((u64) num * 1000000 / usec) : 0);
+}
+
+
+/* STA: Commit */
+static int sta_start(struct sae_auth *auth, unsigned int idx)
+{
+	os_memcpy(auth->sta_addr, "\x02\x00\x00\x00\x00\x00", ETH_ALEN);
+	WPA_PUT_BE24(&auth->sta_addr[3], idx);
+
+	auth->sta_commit = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (!auth->sta_commit ||
+	    sae_set_group(&auth->sta, SAE_GROUP) < 0 ||
+	    sae_prepare_commit(auth->sta_addr, ap_addr, (const u8 *) password,
+			       os_strlen(password), NULL, &auth->sta) < 0 ||
+	    sae_write_commit(&auth->sta, auth->sta_commit, NULL, NULL) < 0)
+		return -1;
+	return 0;
+}
+
+
+/* AP: Parse the received Commit; done in the main thread in hostapd */
+static int ap_parse_commit(struct sae_auth *auth)
+{
+	const u8 *token = NULL;
+	size_t token_len = 0;
+
+	return sae_parse_commit(&auth->ap, wpabuf_head(auth->sta_commit),
+				wpabuf_len(auth->sta_commit), &token,
+				&token_len, groups, 0) == WLAN_STATUS_SUCCESS ?
+		0 : -1;
+}
+
+
+/* AP: Derive PWE and process the Commit; done in a worker thread */
+static void ap_process_commit(void *ctx)
+{
+	struct sae_auth *auth = ctx;
+
+	auth->res = -1;
+	if (sae_prepare_commit(ap_addr, auth->sta_addr, (const u8 *) password,
+			       os_strlen(password), NULL, &auth->ap) < 0 ||
+	    sae_process_commit(&auth->ap) < 0)
+		return;
+	auth->res = 0;
+}
+
+
+/* Complete the exchange and verify that both sides derived the same PMK */
+static int finish_auth(struct sae_auth *auth)
+{
+	struct wpabuf *buf;
+	const u8 *token = NULL;
+	size_t token_len = 0;
+	int ret = -1;
+
+	buf = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (!buf || auth->res < 0 ||
+	    sae_write_commit(&auth->ap, buf, NULL, NULL) < 0 ||
+	    sae_parse_commit(&auth->sta, wpabuf_head(buf), wpabuf_len(buf),
+			     &token, &token_len, groups, 0) !=
+	    WLAN_STATUS_SUCCESS ||
+	    sae_process_commit(&auth->sta) < 0)
+		goto fail;
+
+	wpabuf_free(buf);
+	buf = wpabuf_alloc(SAE_CONFIRM_MAX_LEN);
+	if (!buf)
+		goto fail;
+	sae_write_confirm(&auth->sta, buf);
+	if (sae_check_confirm(&auth->ap, wpabuf_head(buf),
+			      wpabuf_len(buf)) < 0)
+		goto fail;
+	wpabuf_free(buf);
+	buf = wpabuf_alloc(SAE_CONFIRM_MAX_LEN);
+	if (!buf)
+		goto fail;
+	sae_write_confirm(&auth->ap, buf);
+	if (sae_check_confirm(&auth->sta, wpabuf_head(buf),
+			      wpabuf_len(buf)) < 0 ||
+	    os_memcmp(auth->ap.pmk, auth->sta.pmk, SAE_PMK_LEN) != 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	wpabuf_free(buf);
+	return ret;
+}
+
+
+static void free_auths(struct sae_auth *auths, unsigned int num)
+{
+	unsigned int i;
+
+	if (!auths)
+		return;
+	for (i = 0; i < num; i++) {
+		sae_clear_data(&auths[i].ap);
+		sae_clear_data(&auths[i].sta);
+		wpabuf_free(auths[i].sta_commit);
+	}
+	os_free(auths);
+}
+
+
+static struct sae_auth * init_auths(unsigned int num)
+{
+	struct sae_auth *auths;
+	unsigned int i;
+
+	auths = os_calloc(num, sizeof(*auths));
+	if (!auths)
+		return NULL;
+	for (i = 0; i < num; i++) {
+		if (sta_start(&auths[i], i) < 0) {
+			free_auths(auths, num);
+			return NULL;
+		}
+	}
+	return auths;
+}
+
+
+static int check_auths(struct sae_auth *auths, unsigned int num)
+{
+	unsigned int i;
+	int errors = 0;
+
+	for (i = 0; i < num; i++) {
+		if (finish_auth(&auths[i]) < 0) {
+			printf("SAE authentication %u failed\n", i);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+
+static int run_serial(unsigned int num)
+{
+	struct sae_auth *auths;
+	struct os_reltime start;
+	unsigned int i, usec;
+	int errors = 0;
+
+	auths = init_auths(num);
+	if (!auths)
+		return -1;
+
+	os_get_reltime(&start);
+	for (i = 0; i < num; i++) {
+		if (ap_parse_commit(&auths[i]) < 0)
+			errors++;
+		else
+			ap_process_commit(&auths[i]);
+	}
+	usec = time_diff_usec(&start);
+	report("main thread", num, usec);
+
+	errors += check_auths(auths, num);
+	free_auths(auths, num);
+	return errors ? -1 : 0;
+}
+
+
+static void load_test_submit(struct load_test *lt);
+
+static void load_test_done(void *ctx)
+{
+	struct sae_auth *auth = ctx;
+	struct load_test *lt = auth->lt;
+
+	lt->completed++;
+	load_test_submit(lt);
+}
+
+
+static void load_test_submit(struct load_test *lt)
+{
+	struct sae_auth *auth;
+
+	/* Keep a limited number of commit messages in processing like the
+	 * hostapd commit queue does. */
+	while (lt->next < lt->num &&
+	       lt->next - lt->completed < lt->max_in_flight) {
+		auth = &lt->auths[lt->next++];
+		auth->lt = lt;
+		if (ap_parse_commit(auth) < 0 ||
+		    worker_pool_submit(lt->pool, ap_process_commit,
+				       load_test_done, auth) < 0) {
+			lt->errors++;
+			lt->completed++;
+		}
+	}
+
+	if (lt->completed == lt->num)
+		eloop_terminate();
+}
+
+
+static void load_test_start(void *eloop_ctx, void *user_ctx)
+{
+	load_test_submit(eloop_ctx);
+}
+
+
+static int run_pool(unsigned int num, unsigned int threads)
+{
+	struct load_test lt;
+	struct os_reltime start;
+	unsigned int usec;
+	char name[50];
+
+	os_memset(&lt, 0, sizeof(lt));
+	lt.num = num;
+	lt.max_in_flight = 2 * threads;
+	lt.auths = init_auths(num);
+	lt.pool = worker_pool_init(threads);
+	if (!lt.auths || !lt.pool) {
+		printf("Failed to initialize %u worker threads\n", threads);
+		free_auths(lt.auths, num);
+		worker_pool_deinit(lt.pool);
+		return -1;
+	}
+
+	os_get_reltime(&start);
+	eloop_register_timeout(0, 0, load_test_start, &lt, NULL);
+	eloop_run();
+	usec = time_diff_usec(&start);
+	os_snprintf(name, sizeof(name), "%u worker threads", threads);
+	report(name, num, usec);
+
+	worker_pool_deinit(lt.pool);
+	lt.errors += check_auths(lt.auths, num);
+	free_auths(lt.auths, num);
+	return lt.errors ? -1 : 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	unsigned int num = 200, threads = 4;
+	int ret = -1;
+
+	if (argc > 1)
+		num = atoi(argv[1]);
+	if (argc > 2)
+		threads = atoi(argv[2]);
+	if (num == 0 || threads == 0) {
+		printf("usage: test-sae-load [authentications] [threads]\n");
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+	if (eloop_init())
+		goto fail;
+
+	if (run_serial(num) < 0 ||
+	    run_pool(num, 1) < 0 ||
+	    (threads > 1 && run_pool(num, threads) < 0))
+		goto fail;
+
+	ret = 0;
+	printf("SAE load tests completed successfully\n");
+fail:
+	eloop_destroy();
+	os_program_deinit();
+	return ret;
+}
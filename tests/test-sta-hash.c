@@ -0,0 +1,142 @@
+/*
+ * Test program for station table lookups
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "ap/hostapd.h"
+#include "ap/ieee802_11.h"
+#include "ap/sta_info.h"
+#include "ap/ap_list.h"
+#include "test_util.h"
+
+#define NUM_STA 10000
+#define NUM_LOOKUP_ROUNDS 20
+
+
+const struct wpa_driver_ops *const wpa_drivers[] =
+{
+	NULL
+};
+
+
+struct test_ctx {
+	struct hostapd_iface iface;
+	struct hostapd_data hapd;
+	struct wpa_driver_ops driver;
+};
+
+
+static void sta_addr(u8 *addr, int i, int same_last_octet)
+{
+	os_memcpy(addr, "\x02\x00\x00\x00\x00\x00", ETH_ALEN);
+	if (same_last_octet) {
+		/*
+		 * Worst case for a hash that uses only the last octet of the
+		 * address as was done with the earlier fixed-size table.
+		 */
+		WPA_PUT_BE16(&addr[3], i);
+		addr[5] = 0x42;
+	} else {
+		WPA_PUT_BE16(&addr[4], i);
+	}
+}
+
+
+static int test_lookup(struct test_ctx *ctx, int same_last_octet)
+{
+	struct hostapd_data *hapd = &ctx->hapd;
+	struct os_reltime start;
+	unsigned int usec;
+	u8 addr[ETH_ALEN];
+	struct sta_info *sta;
+	char mib[500];
+	int i, r, errors = 0;
+	const char *name = same_last_octet ? "same last octet" : "sequential";
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_STA; i++) {
+		sta_addr(addr, i, same_last_octet);
+		if (!ap_sta_add(hapd, addr))
+			errors++;
+	}
+	usec = time_diff_usec(&start);
+	printf("%s: added %d STAs in %u usec\n", name, NUM_STA, usec);
+
+	os_get_reltime(&start);
+	for (r = 0; r < NUM_LOOKUP_ROUNDS; r++) {
+		for (i = 0; i < NUM_STA; i++) {
+			sta_addr(addr, (i * 7) % NUM_STA, same_last_octet);
+			sta = ap_get_sta(hapd, addr);
+			if (!sta || os_memcmp(sta->addr, addr, ETH_ALEN) != 0)
+				errors++;
+		}
+	}
+	usec = time_diff_usec(&start);
+	printf("%s: %d ap_get_sta() lookups in %u usec (%u nsec/op)\n",
+	       name, NUM_STA * NUM_LOOKUP_ROUNDS, usec,
+	       (unsigned int) ((u64) usec * 1000 /
+			       (NUM_STA * NUM_LOOKUP_ROUNDS)));
+
+	/* Addresses that are not in the table */
+	addr[0] = 0x06;
+	if (ap_get_sta(hapd, addr))
+		errors++;
+
+	if (ieee802_11_get_mib(hapd, mib, sizeof(mib)) > 0)
+		printf("%s", mib);
+
+	hostapd_free_stas(hapd);
+	if (hapd->num_sta || hapd->sta_hash.count)
+		errors++;
+
+	if (errors) {
+		printf("%s: %d errors\n", name, errors);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct test_ctx ctx;
+	struct hostapd_data *hapd = &ctx.hapd;
+	int ret = -1;
+
+	if (os_program_init())
+		return -1;
+	if (eloop_init() < 0)
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+
+	os_memset(&ctx, 0, sizeof(ctx));
+	hapd->driver = &ctx.driver;
+	os_memcpy(hapd->own_addr, "\x02\x00\x00\x00\x03\x00", ETH_ALEN);
+	hapd->iface = &ctx.iface;
+	hapd->iface->conf = hostapd_config_defaults();
+	if (!hapd->iface->conf)
+		goto fail;
+	hapd->iconf = hapd->iface->conf;
+	hapd->conf = hapd->iconf->bss[0];
+	hapd->conf->max_num_sta = NUM_STA;
+
+	if (test_lookup(&ctx, 0) < 0 || test_lookup(&ctx, 1) < 0)
+		goto fail;
+
+	ret = 0;
+	printf("sta hash tests completed successfully\n");
+fail:
+	hostapd_config_free(hapd->iconf);
+	ap_list_deinit(&ctx.iface);
+	eloop_destroy();
+	os_program_deinit();
+	return ret;
+}
@@ -0,0 +1,286 @@
+/*
+ * Load test for TLS server private key operations in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This runs full TLS handshakes between in-process client and server
+ * connections. The server uses an RSA 3072-bit key and its signature is
+ * computed either in the main thread or in worker threads like with the
+ * hostapd tls_private_key_threads parameter.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "crypto/tls.h"
+#include "test_util.h"
+
+#define SERVER_CERT "hwsim/auth_serv/rsa3072-server.pem"
+#define SERVER_KEY "hwsim/auth_serv/rsa3072-server.key"
+
+struct load_test;
+
+struct tls_handshake {
+	struct load_test *lt;
+	struct tls_connection *client;
+	struct tls_connection *server;
+	struct wpabuf *client_out;
+	int pending;
+};
+
+struct load_test {
+	void *client_ctx;
+	void *server_ctx;
+	struct tls_handshake *hs;
+	unsigned int num;
+	unsigned int next;
+	unsigned int completed;
+	unsigned int max_in_flight;
+	unsigned int async;
+	int errors;
+};
+
+
+static void report(const char *name, unsigned int num, unsigned int usec)
+{
+	printf("%s: %u handshakes in %u usec (%u handshakes/s)\n",
+	       name, num, usec,
+	       usec ? (unsigned int) ((u64) num * 1000000 / usec) : 0);
+}
+
+
+static void handshake_free(struct load_test *lt, struct tls_handshake *hs)
+{
+	tls_connection_deinit(lt->client_ctx, hs->client);
+	tls_connection_deinit(lt->server_ctx, hs->server);
+	wpabuf_free(hs->client_out);
+	hs->client = NULL;
+	hs->server = NULL;
+	hs->client_out = NULL;
+}
+
+
+static void load_test_start(void *eloop_ctx, void *user_ctx);
+
+
+static void handshake_done(struct load_test *lt, struct tls_handshake *hs,
+			   int res)
+{
+	if (res < 0)
+		lt->errors++;
+	handshake_free(lt, hs);
+	lt->completed++;
+	/* Start the next handshake from the eloop to avoid deep recursion */
+	eloop_register_timeout(0, 0, load_test_start, lt, NULL);
+}
+
+
+/* Exchange messages until the handshake completes or the server waits */
+static void handshake_step(struct load_test *lt, struct tls_handshake *hs)
+{
+	struct wpabuf *server_out;
+
+	for (;;) {
+		server_out = tls_connection_server_handshake(lt->server_ctx,
+							     hs->server,
+							     hs->client_out,
+							     NULL);
+		wpabuf_free(hs->client_out);
+		hs->client_out = NULL;
+		if (!server_out &&
+		    tls_connection_async_pending(lt->server_ctx, hs->server)) {
+			hs->pending = 1;
+			lt->async++;
+			return;
+		}
+		if (!server_out ||
+		    tls_connection_get_failed(lt->server_ctx, hs->server)) {
+			printf("Server handshake failed\n");
+			handshake_done(lt, hs, -1);
+			return;
+		}
+
+		if (tls_connection_established(lt->client_ctx, hs->client) &&
+		    tls_connection_established(lt->server_ctx, hs->server)) {
+			wpabuf_free(server_out);
+			handshake_done(lt, hs, 0);
+			return;
+		}
+
+		hs->client_out = tls_connection_handshake(lt->client_ctx,
+							  hs->client,
+							  server_out, NULL);
+		wpabuf_free(server_out);
+		if (!hs->client_out ||
+		    tls_connection_get_failed(lt->client_ctx, hs->client)) {
+			printf("Client handshake failed\n");
+			handshake_done(lt, hs, -1);
+			return;
+		}
+	}
+}
+
+
+static int handshake_start(struct load_test *lt, struct tls_handshake *hs)
+{
+	struct tls_connection_params params;
+
+	hs->lt = lt;
+	hs->client = tls_connection_init(lt->client_ctx);
+	hs->server = tls_connection_init(lt->server_ctx);
+	if (!hs->client || !hs->server)
+		return -1;
+
+	/* The client does not validate the server certificate */
+	os_memset(&params, 0, sizeof(params));
+	params.flags = TLS_CONN_DISABLE_SESSION_TICKET;
+	if (tls_connection_set_params(lt->client_ctx, hs->client,
+				      &params) < 0 ||
+	    tls_connection_set_verify(lt->server_ctx, hs->server, 0,
+				      TLS_CONN_DISABLE_SESSION_TICKET,
+				      NULL, 0) < 0)
+		return -1;
+	tls_connection_set_async(lt->server_ctx, hs->server, hs);
+
+	hs->client_out = tls_connection_handshake(lt->client_ctx, hs->client,
+						  NULL, NULL);
+	if (!hs->client_out)
+		return -1;
+
+	handshake_step(lt, hs);
+	return 0;
+}
+
+
+static void handshake_start_next(struct load_test *lt)
+{
+	struct tls_handshake *hs;
+
+	while (lt->next < lt->num &&
+	       lt->next - lt->completed < lt->max_in_flight) {
+		hs = &lt->hs[lt->next++];
+		if (handshake_start(lt, hs) < 0) {
+			printf("Failed to start handshake\n");
+			handshake_done(lt, hs, -1);
+		}
+	}
+
+	if (lt->completed == lt->num)
+		eloop_terminate();
+}
+
+
+static void tls_async_done(void *ctx, void *conn_ctx)
+{
+	struct load_test *lt = ctx;
+	struct tls_handshake *hs = conn_ctx;
+
+	hs->pending = 0;
+	handshake_step(lt, hs);
+}
+
+
+static void load_test_start(void *eloop_ctx, void *user_ctx)
+{
+	handshake_start_next(eloop_ctx);
+}
+
+
+static int run_test(unsigned int num, unsigned int threads)
+{
+	struct load_test lt;
+	struct tls_config conf;
+	struct tls_connection_params params;
+	struct os_reltime start;
+	unsigned int usec;
+	char name[50];
+
+	os_memset(&lt, 0, sizeof(lt));
+	lt.num = num;
+	lt.max_in_flight = threads ? 2 * threads : 1;
+
+	os_memset(&conf, 0, sizeof(conf));
+	lt.client_ctx = tls_init(&conf);
+	conf.private_key_threads = threads;
+	conf.async_cb = tls_async_done;
+	conf.cb_ctx = &lt;
+	lt.server_ctx = tls_init(&conf);
+	lt.hs = os_calloc(num, sizeof(*lt.hs));
+	if (!lt.client_ctx || !lt.server_ctx || !lt.hs)
+		goto fail;
+
+	os_memset(&params, 0, sizeof(params));
+	params.client_cert = SERVER_CERT;
+	params.private_key = SERVER_KEY;
+	if (tls_global_set_params(lt.server_ctx, &params) < 0) {
+		printf("Failed to load %s\n", SERVER_KEY);
+		goto fail;
+	}
+
+	os_get_reltime(&start);
+	eloop_register_timeout(0, 0, load_test_start, &lt, NULL);
+	eloop_run();
+	usec = time_diff_usec(&start);
+	eloop_cancel_timeout(load_test_start, &lt, NULL);
+	if (threads)
+		os_snprintf(name, sizeof(name), "%u worker threads", threads);
+	else
+		os_snprintf(name, sizeof(name), "main thread");
+	report(name, num, usec);
+
+	if (threads && lt.async == 0) {
+		printf("No private key operations in worker threads\n");
+		lt.errors++;
+	}
+
+	os_free(lt.hs);
+	tls_deinit(lt.server_ctx);
+	tls_deinit(lt.client_ctx);
+	return lt.errors ? -1 : 0;
+
+fail:
+	printf("Failed to initialize TLS\n");
+	os_free(lt.hs);
+	if (lt.server_ctx)
+		tls_deinit(lt.server_ctx);
+	if (lt.client_ctx)
+		tls_deinit(lt.client_ctx);
+	return -1;
+}
+
+
+int main(int argc, char *argv[])
+{
+	unsigned int num = 200, threads = 4;
+	int ret = -1;
+
+	if (argc > 1)
+		num = atoi(argv[1]);
+	if (argc > 2)
+		threads = atoi(argv[2]);
+	if (num == 0 || threads == 0) {
+		printf("usage: test-tls-load [handshakes] [threads]\n");
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+	if (eloop_init())
+		goto fail;
+
+	if (run_test(num, 0) < 0 ||
+	    run_test(num, 1) < 0 ||
+	    (threads > 1 && run_test(num, threads) < 0))
+		goto fail;
+
+	ret = 0;
+	printf("TLS load tests completed successfully\n");
+fail:
+	eloop_destroy();
+	os_program_deinit();
+	return ret;
+}
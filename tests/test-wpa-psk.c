@@ -0,0 +1,282 @@
+/*
+ * Test program for the indexed wpa_psk_file store
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "ap/ap_config.h"
+#include "test_util.h"
+
+#define NUM_PSK 20000
+#define NUM_PASSPHRASE 20
+#define NUM_GROUP 3
+#define NUM_CHANGED 10
+
+
+static void psk_addr(u8 *addr, int i)
+{
+	os_memcpy(addr, "\x02\x00\x00\x00\x00\x00", ETH_ALEN);
+	WPA_PUT_BE24(&addr[3], i);
+}
+
+
+static int write_psk_file(const char *fname, int changed)
+{
+	FILE *f;
+	u8 addr[ETH_ALEN];
+	int i;
+
+	f = fopen(fname, "w");
+	if (!f)
+		return -1;
+
+	for (i = 0; i < NUM_GROUP; i++)
+		fprintf(f, "keyid=group%d 00:00:00:00:00:00 group-pw-%d\n",
+			i, i);
+	for (i = 0; i < NUM_PSK; i++) {
+		psk_addr(addr, i);
+		if (i < NUM_PASSPHRASE)
+			fprintf(f, "vlanid=%d " MACSTR " passphrase-%d-%d\n",
+				i % 5, MAC2STR(addr), i, i < changed);
+		else
+			fprintf(f, "vlanid=%d " MACSTR " %08x%056x\n",
+				i % 5, MAC2STR(addr), i, i < changed);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+
+/* Compare the indexed lookup results against the full list search */
+static int check_lookups(struct hostapd_bss_config *bss, int step)
+{
+	const u8 *psk, *lpsk, *prev = NULL;
+	int vlan_id, lvlan_id, i, errors = 0, count;
+	u8 addr[ETH_ALEN];
+
+	for (i = 0; i < NUM_PSK + 5; i += step) {
+		psk_addr(addr, i);
+		prev = NULL;
+		count = 0;
+		do {
+			psk = hostapd_get_psk(bss, addr, NULL, prev, &vlan_id);
+			bss->ssid.psk_index.valid = 0;
+			lpsk = hostapd_get_psk(bss, addr, NULL, prev,
+					       &lvlan_id);
+			bss->ssid.psk_index.valid = 1;
+			if (psk != lpsk || vlan_id != lvlan_id) {
+				printf("lookup mismatch for " MACSTR
+				       " (candidate %d)\n", MAC2STR(addr),
+				       count);
+				errors++;
+				break;
+			}
+			prev = psk;
+			count++;
+		} while (psk);
+
+		/*
+		 * Per-STA PSK (if any), group PSKs from the file, the PSK from
+		 * wpa_passphrase, and the final NULL
+		 */
+		if (count != (i < NUM_PSK ? 1 : 0) + NUM_GROUP + 2) {
+			printf("unexpected number of candidates (%d) for "
+			       MACSTR "\n", count, MAC2STR(addr));
+			errors++;
+		}
+	}
+
+	/* A prev_psk that is not from the list ends the iteration */
+	psk_addr(addr, 1);
+	if (hostapd_get_psk(bss, addr, NULL, addr, NULL)) {
+		printf("unexpected PSK with foreign prev_psk\n");
+		errors++;
+	}
+
+	return errors;
+}
+
+
+/* Store the first two PSK candidates for each STA */
+static void snapshot_psks(struct hostapd_bss_config *bss, u8 *buf)
+{
+	u8 addr[ETH_ALEN];
+	const u8 *psk;
+	int i;
+
+	for (i = 0; i < NUM_PSK; i++) {
+		psk_addr(addr, i);
+		psk = hostapd_get_psk(bss, addr, NULL, NULL, NULL);
+		os_memcpy(&buf[2 * i * PMK_LEN], psk, PMK_LEN);
+		psk = hostapd_get_psk(bss, addr, NULL, psk, NULL);
+		os_memcpy(&buf[(2 * i + 1) * PMK_LEN], psk, PMK_LEN);
+	}
+}
+
+
+static int compare_psks(struct hostapd_bss_config *bss, const u8 *snap)
+{
+	u8 *buf;
+	int ret;
+
+	buf = os_malloc(NUM_PSK * 2 * PMK_LEN);
+	if (!buf)
+		return 0;
+	snapshot_psks(bss, buf);
+	ret = os_memcmp(buf, snap, NUM_PSK * 2 * PMK_LEN) == 0;
+	os_free(buf);
+	return ret;
+}
+
+
+static int count_psks(struct hostapd_ssid *ssid)
+{
+	struct hostapd_wpa_psk *psk;
+	int count = 0;
+
+	for (psk = ssid->wpa_psk; psk; psk = psk->next)
+		count++;
+	return count;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct hostapd_config *conf;
+	struct hostapd_bss_config *bss;
+	struct os_reltime start;
+	unsigned int usec;
+	char fname[] = "/tmp/test-wpa-psk.XXXXXX";
+	u8 addr[ETH_ALEN];
+	const u8 *psk;
+	u8 *snap;
+	int i, fd, errors = 0;
+
+	if (os_program_init())
+		return -1;
+	wpa_debug_level = MSG_ERROR;
+
+	fd = mkstemp(fname);
+	if (fd < 0)
+		return -1;
+	close(fd);
+
+	conf = hostapd_config_defaults();
+	if (!conf || write_psk_file(fname, 0) < 0)
+		goto fail;
+	bss = conf->bss[0];
+	os_memcpy(bss->ssid.ssid, "test", 4);
+	bss->ssid.ssid_len = 4;
+	bss->ssid.ssid_set = 1;
+	bss->ssid.wpa_passphrase = os_strdup("config passphrase");
+	bss->ssid.wpa_psk_file = os_strdup(fname);
+	if (!bss->ssid.wpa_passphrase || !bss->ssid.wpa_psk_file)
+		goto fail;
+
+	os_get_reltime(&start);
+	if (hostapd_setup_wpa_psk(bss) < 0 || !bss->ssid.psk_index.valid) {
+		printf("Failed to set up WPA PSKs\n");
+		goto fail;
+	}
+	usec = time_diff_usec(&start);
+	printf("setup: %d entries in %u usec\n", count_psks(&bss->ssid), usec);
+
+	errors += check_lookups(bss, 97);
+
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_PSK; i++) {
+		psk_addr(addr, (i * 7) % NUM_PSK);
+		psk = hostapd_get_psk(bss, addr, NULL, NULL, NULL);
+		psk = hostapd_get_psk(bss, addr, NULL, psk, NULL);
+		if (!psk)
+			errors++;
+	}
+	usec = time_diff_usec(&start);
+	printf("indexed: %d lookups in %u usec (%u nsec/op)\n",
+	       2 * NUM_PSK, usec,
+	       (unsigned int) ((u64) usec * 1000 / (2 * NUM_PSK)));
+
+	bss->ssid.psk_index.valid = 0;
+	os_get_reltime(&start);
+	for (i = 0; i < NUM_PSK / 10; i++) {
+		psk_addr(addr, (i * 7) % NUM_PSK);
+		psk = hostapd_get_psk(bss, addr, NULL, NULL, NULL);
+		psk = hostapd_get_psk(bss, addr, NULL, psk, NULL);
+	}
+	usec = time_diff_usec(&start);
+	bss->ssid.psk_index.valid = 1;
+	printf("list search: %d lookups in %u usec (%u nsec/op)\n",
+	       2 * NUM_PSK / 10, usec,
+	       (unsigned int) ((u64) usec * 1000 / (2 * NUM_PSK / 10)));
+
+	/*
+	 * Reload with a few modified entries; unchanged passphrases must not
+	 * need to be derived again.
+	 */
+	if (write_psk_file(fname, NUM_CHANGED) < 0)
+		goto fail;
+	os_get_reltime(&start);
+	if (hostapd_reload_wpa_psk(bss) < 0 || !bss->ssid.psk_index.valid) {
+		printf("Failed to reload WPA PSKs\n");
+		goto fail;
+	}
+	usec = time_diff_usec(&start);
+	printf("reload: %d entries in %u usec\n", count_psks(&bss->ssid),
+	       usec);
+	if (count_psks(&bss->ssid) != NUM_PSK + NUM_GROUP + 1) {
+		printf("unexpected number of entries after reload\n");
+		errors++;
+	}
+
+	errors += check_lookups(bss, 1);
+
+	/* The result must match a full reconfiguration */
+	snap = os_malloc(NUM_PSK * 2 * PMK_LEN);
+	if (!snap)
+		goto fail;
+	snapshot_psks(bss, snap);
+	hostapd_config_clear_wpa_psk(&bss->ssid);
+	if (hostapd_setup_wpa_psk(bss) < 0 || !compare_psks(bss, snap)) {
+		printf("reload result differs from full reconfiguration\n");
+		errors++;
+	}
+
+	/* SET ssid updates the SSID in place; a reload must not reuse the
+	 * PSKs derived with the previous SSID */
+	os_memcpy(bss->ssid.ssid, "test2", 5);
+	bss->ssid.ssid_len = 5;
+	if (hostapd_reload_wpa_psk(bss) < 0) {
+		printf("Failed to reload WPA PSKs after SSID change\n");
+		errors++;
+	}
+	snapshot_psks(bss, snap);
+	hostapd_config_clear_wpa_psk(&bss->ssid);
+	if (hostapd_setup_wpa_psk(bss) < 0 || !compare_psks(bss, snap)) {
+		printf("reload after SSID change used stale PSKs\n");
+		errors++;
+	}
+	os_free(snap);
+
+	if (errors) {
+		printf("%d errors\n", errors);
+		goto fail;
+	}
+
+	unlink(fname);
+	hostapd_config_free(conf);
+	os_program_deinit();
+	printf("wpa_psk tests completed successfully\n");
+	return 0;
+
+fail:
+	unlink(fname);
+	hostapd_config_free(conf);
+	os_program_deinit();
+	return -1;
+}
@@ -0,0 +1,27 @@
+/*
+ * Shared helpers for the test programs
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "test_util.h"
+
+
+/**
+ * time_diff_usec - Time elapsed since start
+ * @start: Start time from os_get_reltime()
+ * Returns: Elapsed time in microseconds
+ */
+unsigned int time_diff_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
@@ -0,0 +1,14 @@
+/*
+ * Shared helpers for the test programs
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+unsigned int time_diff_usec(struct os_reltime *start);
+
+#endif /* TEST_UTIL_H */
@@ -23,6 +23,7 @@
 #include "ap/wps_hostapd.h"
 #include "ap/p2p_hostapd.h"
 #include "ap/dfs.h"
+#include "ap/beacon.h"
 #include "eapol_supp/eapol_supp_sm.h"
 #include "rsn_supp/wpa.h"
 #include "wpa_supplicant_i.h"
@@ -1714,8 +1715,10 @@ static void wpas_p2p_add_psk_list(struct wpa_supplicant *wpa_s,
 			os_memcpy(hpsk->p2p_dev_addr, psk->addr, ETH_ALEN);
 		else
 			os_memcpy(hpsk->addr, psk->addr, ETH_ALEN);
-		hpsk->next = hapd->conf->ssid.wpa_psk;
-		hapd->conf->ssid.wpa_psk = hpsk;
+		if (hostapd_wpa_psk_add(&hapd->conf->ssid, hpsk) < 0) {
+			bin_clear_free(hpsk, sizeof(*hpsk));
+			break;
+		}
 	}
 }
 
@@ -6697,6 +6700,7 @@ static void wpas_p2p_ie_update(void *ctx, struct wpabuf *beacon_ies,
 		}
 		wpabuf_free(hapd->p2p_probe_resp_ie);
 		hapd->p2p_probe_resp_ie = proberesp_ies;
+		hostapd_flush_probe_resp_cache(hapd);
 	} else {
 		wpabuf_free(beacon_ies);
 		wpabuf_free(proberesp_ies);
@@ -8438,7 +8442,7 @@ static void wpas_p2p_remove_client_go(struct wpa_supplicant *wpa_s,
 				      const u8 *peer, int iface_addr)
 {
 	struct hostapd_data *hapd;
-	struct hostapd_wpa_psk *psk, *prev, *rem;
+	struct hostapd_wpa_psk *psk, *rem;
 	struct sta_info *sta;
 
 	if (wpa_s->ap_iface == NULL || wpa_s->current_ssid == NULL ||
@@ -8447,25 +8451,17 @@ static void wpas_p2p_remove_client_go(struct wpa_supplicant *wpa_s,
 
 	/* Remove per-station PSK entry */
 	hapd = wpa_s->ap_iface->bss[0];
-	prev = NULL;
 	psk = hapd->conf->ssid.wpa_psk;
 	while (psk) {
-		if ((iface_addr && os_memcmp(peer, psk->addr, ETH_ALEN) == 0) ||
+		rem = psk;
+		psk = psk->next;
+		if ((iface_addr && os_memcmp(peer, rem->addr, ETH_ALEN) == 0) ||
 		    (!iface_addr &&
-		     os_memcmp(peer, psk->p2p_dev_addr, ETH_ALEN) == 0)) {
+		     os_memcmp(peer, rem->p2p_dev_addr, ETH_ALEN) == 0)) {
 			wpa_dbg(wpa_s, MSG_DEBUG, "P2P: Remove operating group PSK entry for "
 				MACSTR " iface_addr=%d",
 				MAC2STR(peer), iface_addr);
-			if (prev)
-				prev->next = psk->next;
-			else
-				hapd->conf->ssid.wpa_psk = psk->next;
-			rem = psk;
-			psk = psk->next;
-			os_free(rem);
-		} else {
-			prev = psk;
-			psk = psk->next;
+			hostapd_wpa_psk_del(&hapd->conf->ssid, rem);
 		}
 	}
 